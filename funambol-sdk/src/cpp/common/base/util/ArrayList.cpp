@@ -79,6 +79,10 @@ int ArrayList::add(int index, ArrayElement& element) {
     if (index < 0) {
         return -1;
     }
+    return insert(index, element.clone());
+}
+
+int ArrayList::insert(int index, ArrayElement* element) {
 
     int s = size();
     if (index > s) {
@@ -87,7 +91,7 @@ int ArrayList::add(int index, ArrayElement& element) {
 
     Element* newElement = new Element();
 
-    newElement->e = element.clone();
+    newElement->e = element;
     newElement->n = NULL;
 
     Element* e;
@@ -165,12 +169,57 @@ int ArrayList::add(ArrayList* list) {
         return -1;
     }
     int ret = 0;
-    for (int i = 0; i < list->size(); i++) {
-        ret = ret + add(*(ArrayElement*)list->get(i));
+    for (Element* p = list->head; p; p = p->n) {
+        ret = ret + add(*(p->e));
     }
     return ret;
 }
 
+/**
+ * Appends the element without cloning it: the list owns it from now on.
+ *
+ * @param element the element to insert - NULL is not allowed!
+ */
+int ArrayList::adopt(ArrayElement* element) {
+    if (!element) {
+        return -1;
+    }
+    return insert(size(), element);
+}
+
+/**
+ * Moves the elements of the given list at the end of this one, relinking
+ * them: nothing is cloned and the given list is left empty.
+ */
+int ArrayList::adopt(ArrayList* list) {
+    if (!list) {
+        return -1;
+    }
+    if (list == this || list->head == NULL) {
+        return 0;
+    }
+    int moved = list->count;
+
+    // An iterator past the removed last element goes on with the new ones
+    if (iterator == &ghost && ghost.n == NULL) {
+        ghost.n = list->head;
+    }
+    if (lastElement) {
+        lastElement->n = list->head;
+    } else {
+        head = list->head;
+    }
+    lastElement = list->lastElement;
+    count += moved;
+
+    list->head = NULL;
+    list->lastElement = NULL;
+    list->iterator = NULL;
+    list->count = 0;
+
+    return moved;
+}
+
 
 int ArrayList::removeElementAt(int index) {
 
@@ -358,10 +407,8 @@ ArrayList& ArrayList::operator= (const ArrayList &v) {
 ArrayList* ArrayList::clone() {
 
     ArrayList* ret = new ArrayList();
-    int dim = size();
-    for (int i = 0; i < dim; i++) {
-
-        ret->add(*((ArrayElement*)get(i)));
+    for (Element* p = head; p; p = p->n) {
+        ret->add(*(p->e));
     }
     return ret;
 
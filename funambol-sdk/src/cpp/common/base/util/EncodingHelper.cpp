@@ -36,6 +36,7 @@
 #include "base/util/utils.h"
 #include "base/util/EncodingHelper.h"
 #include "base/Log.h"
+#include "base/base64.h"
 #include "spds/DataTransformerFactory.h"
 
 USE_NAMESPACE
@@ -115,6 +116,26 @@ char* EncodingHelper::encode(const char* from, char* buffer, unsigned long *len)
     return transform(from, buffer, len);
 }
 
+long EncodingHelper::encodeTo(char* dest, const char* src, unsigned long len) {
+
+    if (!dest || !src || encryption == "des") {
+        return -1;
+    }
+
+    long ret = 0;
+    if (encoding == encodings::escaped) {
+        ret = b64_encode(dest, src, len);
+    } else if (encoding == encodings::plain) {
+        memcpy(dest, src, len);
+        ret = len;
+    } else {
+        return -1;
+    }
+    dest[ret] = 0;
+    setDataEncoding(encoding.c_str());
+    return ret;
+}
+
 char* EncodingHelper::decode(const char* from, char* buffer, unsigned long *len) {
     return transform(from, buffer, len);
 }
@@ -0,0 +1,360 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include "base/util/JsonWriter.h"
+#include "base/Log.h"
+#include "ioStream/OutputStream.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+static const char hexDigits[] = "0123456789abcdef";
+
+JsonWriter::JsonWriter(StringBuffer& out, bool prettyPrint) : outBuffer(&out), outStream(NULL)
+{
+    init(prettyPrint);
+}
+
+JsonWriter::JsonWriter(OutputStream& out, bool prettyPrint) : outBuffer(NULL), outStream(&out)
+{
+    init(prettyPrint);
+}
+
+JsonWriter::~JsonWriter()
+{
+    flush();
+}
+
+void JsonWriter::init(bool prettyPrint)
+{
+    pretty = prettyPrint;
+    bufferLen = 0;
+    depth = 0;
+    written = false;
+    error = false;
+    first[0] = true;
+}
+
+bool JsonWriter::flush()
+{
+    if (bufferLen == 0) {
+        return !error;
+    }
+
+    if (outBuffer) {
+        outBuffer->append(buffer, (unsigned long)bufferLen);
+    } else if (outStream) {
+        if (outStream->write(buffer, (int64_t)bufferLen) != (int64_t)bufferLen) {
+            LOG.error("%s: error writing JSON data to output stream", __FUNCTION__);
+            error = true;
+        }
+    }
+    bufferLen = 0;
+
+    return !error;
+}
+
+void JsonWriter::writeRaw(const char* data, size_t len)
+{
+    while (len > 0) {
+        if (bufferLen == JSON_WRITER_BUFFER_SIZE) {
+            flush();
+        }
+        size_t chunk = JSON_WRITER_BUFFER_SIZE - bufferLen;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(buffer + bufferLen, data, chunk);
+        bufferLen += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void JsonWriter::writeChar(char c)
+{
+    if (bufferLen == JSON_WRITER_BUFFER_SIZE) {
+        flush();
+    }
+    buffer[bufferLen++] = c;
+}
+
+void JsonWriter::writeEscaped(const char* value)
+{
+    const char* run = value;
+    const char* p = value;
+
+    writeChar('"');
+    for (; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // flush the run of characters that need no escaping
+        writeRaw(run, p - run);
+        run = p + 1;
+
+        writeChar('\\');
+        switch (c) {
+            case '"':  writeChar('"');  break;
+            case '\\': writeChar('\\'); break;
+            case '\b': writeChar('b');  break;
+            case '\f': writeChar('f');  break;
+            case '\n': writeChar('n');  break;
+            case '\r': writeChar('r');  break;
+            case '\t': writeChar('t');  break;
+            default: {
+                char esc[5] = { 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0x0f] };
+                writeRaw(esc, sizeof(esc));
+                break;
+            }
+        }
+    }
+    writeRaw(run, p - run);
+    writeChar('"');
+}
+
+void JsonWriter::writeIndent()
+{
+    writeChar('\n');
+    for (int i = 0; i < depth; i++) {
+        writeChar('\t');
+    }
+}
+
+void JsonWriter::beginValue(const char* key)
+{
+    if (depth > 0) {
+        if (first[depth]) {
+            first[depth] = false;
+        } else {
+            writeChar(',');
+        }
+        if (pretty) {
+            writeIndent();
+        }
+    } else if (written) {
+        LOG.error("%s: JSON root value already written", __FUNCTION__);
+        error = true;
+    }
+
+    if (key && depth > 0) {
+        writeEscaped(key);
+        writeChar(':');
+        if (pretty) {
+            writeChar('\t');
+        }
+    }
+}
+
+JsonWriter& JsonWriter::open(const char* key, char bracket)
+{
+    if (depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        LOG.error("%s: JSON nesting level exceeds %d", __FUNCTION__, JSON_WRITER_MAX_DEPTH);
+        error = true;
+        return *this;
+    }
+
+    beginValue(key);
+    writeChar(bracket);
+    depth++;
+    first[depth] = true;
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::close(char bracket)
+{
+    if (depth == 0) {
+        LOG.error("%s: unbalanced JSON container close", __FUNCTION__);
+        error = true;
+        return *this;
+    }
+
+    bool empty = first[depth];
+    depth--;
+    if (pretty && !empty) {
+        writeIndent();
+    }
+    writeChar(bracket);
+
+    if (depth == 0) {
+        written = true;
+        flush();
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject(const char* key)
+{
+    return open(key, '{');
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    return close('}');
+}
+
+JsonWriter& JsonWriter::beginArray(const char* key)
+{
+    return open(key, '[');
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    return close(']');
+}
+
+JsonWriter& JsonWriter::addString(const char* key, const char* value)
+{
+    if (value == NULL) {
+        return addNull(key);
+    }
+
+    beginValue(key);
+    writeEscaped(value);
+    if (depth == 0) {
+        written = true;
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::addInt(const char* key, int64_t value)
+{
+    char digits[24];
+    int pos = sizeof(digits);
+    uint64_t u = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+
+    do {
+        digits[--pos] = (char)('0' + (u % 10));
+        u /= 10;
+    } while (u > 0);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+
+    beginValue(key);
+    writeRaw(digits + pos, sizeof(digits) - pos);
+    if (depth == 0) {
+        written = true;
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::addDouble(const char* key, double value, int decimals)
+{
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 9) {
+        decimals = 9;
+    }
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    // NaN fails every comparison; beyond the limit the scaled value
+    // doesn't fit 64 bits
+    double limit = 9.2e18 / (double)scale;
+    if (!(value > -limit && value < limit)) {
+        return addNull(key);
+    }
+
+    bool negative = value < 0;
+    uint64_t u = (uint64_t)((negative ? -value : value) * (double)scale + 0.5);
+    if (u == 0) {
+        negative = false;
+    }
+
+    char digits[32];
+    int pos = sizeof(digits);
+    for (int i = 0; i < decimals; i++) {
+        digits[--pos] = (char)('0' + (u % 10));
+        u /= 10;
+    }
+    if (decimals > 0) {
+        digits[--pos] = '.';
+    }
+    do {
+        digits[--pos] = (char)('0' + (u % 10));
+        u /= 10;
+    } while (u > 0);
+    if (negative) {
+        digits[--pos] = '-';
+    }
+
+    beginValue(key);
+    writeRaw(digits + pos, sizeof(digits) - pos);
+    if (depth == 0) {
+        written = true;
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::addBool(const char* key, bool value)
+{
+    beginValue(key);
+    if (value) {
+        writeRaw("true", 4);
+    } else {
+        writeRaw("false", 5);
+    }
+    if (depth == 0) {
+        written = true;
+    }
+
+    return *this;
+}
+
+JsonWriter& JsonWriter::addNull(const char* key)
+{
+    beginValue(key);
+    writeRaw("null", 4);
+    if (depth == 0) {
+        written = true;
+    }
+
+    return *this;
+}
+
+END_FUNAMBOL_NAMESPACE
+
+/** @endcond */
@@ -43,6 +43,13 @@ USE_NAMESPACE
 StringBuffer MemoryKeyValueStore::readPropertyValue(const char *prop) const {
     
     StringBuffer ret(NULL);
+    if (batchIndex) {
+        std::map<std::string, KeyValuePair*>::const_iterator it = batchIndex->find(prop);
+        if (it != batchIndex->end()) {
+            ret = it->second->getValue();
+        }
+        return ret;
+    }
     for(int index = 0; index < data.size(); index++) {
         KeyValuePair *kvp = (KeyValuePair *)data.get(index);
         if (strcmp(prop, kvp->getKey()) == 0) {
@@ -56,6 +63,17 @@ StringBuffer MemoryKeyValueStore::readPropertyValue(const char *prop) const {
 int MemoryKeyValueStore::setPropertyValue(const char *prop, const char *value) {
     
     int ret = 0;
+    if (batchIndex) {
+        std::map<std::string, KeyValuePair*>::iterator it = batchIndex->find(prop);
+        if (it != batchIndex->end()) {
+            it->second->setValue(value);
+        } else {
+            KeyValuePair* kvp = new KeyValuePair(prop, value);
+            data.adopt(kvp);
+            (*batchIndex)[prop] = kvp;
+        }
+        return ret;
+    }
     for(KeyValuePair* kvp = (KeyValuePair *)data.front();
         kvp;
         kvp = (KeyValuePair *)data.next()) {
@@ -71,6 +89,15 @@ int MemoryKeyValueStore::setPropertyValue(const char *prop, const char *value) {
     
 int MemoryKeyValueStore::removeProperty(const char *prop) {
 
+    if (batchIndex) {
+        // nothing to scan for if the key is not there
+        std::map<std::string, KeyValuePair*>::iterator it = batchIndex->find(prop);
+        if (it == batchIndex->end()) {
+            return 0;
+        }
+        batchIndex->erase(it);
+    }
+
     int counter = 0;
     for(KeyValuePair* kvp = (KeyValuePair *)data.front();
         kvp;
@@ -87,6 +114,29 @@ int MemoryKeyValueStore::removeProperty(const char *prop) {
         
 int MemoryKeyValueStore::removeAllProperties() {
     data.clear();
+    if (batchIndex) {
+        batchIndex->clear();
+    }
     return 0;
 }
 
+void MemoryKeyValueStore::beginBatch() {
+    if (batchIndex) {
+        return;
+    }
+    batchIndex = new std::map<std::string, KeyValuePair*>();
+    for(KeyValuePair* kvp = (KeyValuePair *)data.front();
+        kvp;
+        kvp = (KeyValuePair *)data.next()) {
+        // like the scans, the first pair with a key wins
+        if (kvp->getKey().c_str()) {
+            batchIndex->insert(std::make_pair(std::string(kvp->getKey().c_str()), kvp));
+        }
+    }
+}
+
+int MemoryKeyValueStore::endBatch() {
+    delete batchIndex;
+    batchIndex = NULL;
+    return 0;
+}
@@ -97,6 +97,10 @@ int PropertyFile::read() {
     
     char line[512];
     FILE* f;
+
+    // the journal can set a key more times: the pairs are indexed meanwhile
+    MemoryKeyValueStore::beginBatch();
+
     f = fileOpen(node, "r");
     if (!f) {
         //LOG.debug("PropertyFile: the file '%s' doesn't exist. Try the journal file '%s'", node.c_str(), nodeJour.c_str());        
@@ -136,11 +140,18 @@ int PropertyFile::read() {
         }       
         fclose(f);         
     }
+    MemoryKeyValueStore::endBatch();
     return 0;
 }
 
 int PropertyFile::close() {
 
+    // the journal is going to be removed
+    if (journal) {
+        fclose(journal);
+        journal = NULL;
+    }
+
     FILE* file;
     file = fileOpen(node, "w");
     int ret = 0;   
@@ -178,11 +189,7 @@ int PropertyFile::setPropertyValue(const char *prop, const char *value) {
         return ret;
     }
 
-    FILE* file = fileOpen(nodeJour, "a+");    
-    if (file) {
-        fprintf(file, "%s=%s\n", escapeString(prop).c_str(), escapeString(value).c_str());
-        fclose(file);
-    } else {        
+    if (writeJournal(prop, value)) {        
         LOG.error("PropertyFile setProperty: it is not possible to save the journal file: '%s'", node.c_str());
         ret = -1;
     }
@@ -195,11 +202,7 @@ int PropertyFile::removeProperty(const char *prop) {
     
     int ret = 0;
 
-    FILE* file = fileOpen(nodeJour, "a+");    
-    if (file) {
-        fprintf(file, "%s=%s\n", escapeString(prop).c_str(), escapeString(REMOVED).c_str());
-        fclose(file);
-    } else {        
+    if (writeJournal(prop, REMOVED)) {        
         LOG.error("PropertyFile removeProperty: it is not possible to save the journal file: '%s'", node.c_str());        
     }
     
@@ -223,6 +226,55 @@ int PropertyFile::removeAllProperties() {
     if (existsFile(node) && !removeFile(node)) {
         LOG.error("There are problem in removing the file %s", node.c_str());
     }            
+    // and the changes not written in the file yet, or they would be
+    // read again
+    bool inBatch = (journal != NULL);
+    if (journal) {
+        fclose(journal);
+        journal = NULL;
+    }
+    if (existsFile(nodeJour) && !removeFile(nodeJour)) {
+        LOG.error("There are problem in removing journal file");
+    }
+    if (inBatch) {
+        journal = fileOpen(nodeJour, "a+");
+    }
+    return ret;
+}
+
+int PropertyFile::writeJournal(const char* prop, const char* value) {
+
+    FILE* file = journal ? journal : fileOpen(nodeJour, "a+");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "%s=%s\n", escapeString(prop).c_str(), escapeString(value).c_str());
+    if (file != journal) {
+        fclose(file);
+    }
+    return 0;
+}
+
+void PropertyFile::beginBatch() {
+
+    MemoryKeyValueStore::beginBatch();
+    if (!journal) {
+        // if it can't be opened, every change tries again on its own
+        journal = fileOpen(nodeJour, "a+");
+    }
+}
+
+int PropertyFile::endBatch() {
+
+    int ret = 0;
+    if (journal) {
+        if (fclose(journal)) {
+            LOG.error("PropertyFile: it is not possible to save the journal file: '%s'", nodeJour.c_str());
+            ret = -1;
+        }
+        journal = NULL;
+    }
+    MemoryKeyValueStore::endBatch();
     return ret;
 }
 
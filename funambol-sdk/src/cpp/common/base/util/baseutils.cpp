@@ -41,6 +41,10 @@
 #include "base/oauth2/OAuth2JsonParser.h"
 #include "base/oauth2/OAuth2Credentials.h"
 
+#ifdef USE_ZLIB
+#include "zlib.h"
+#endif
+
 #include <string>
 #include <vector>
 #include <iostream>
@@ -361,6 +365,46 @@ int64_t fgetsize(const char* fileName) {
 //    return 0;
 }
 
+bool gzipFile(const char* source, const char* dest) {
+#ifdef USE_ZLIB
+    if (!source || !dest) {
+        return false;
+    }
+    FILE* in = fileOpen(source, "rb");
+    if (!in) {
+        return false;
+    }
+    gzFile out = gzopen(dest, "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+
+    char buffer[16 * 1024];
+    bool ret = true;
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (gzwrite(out, buffer, (unsigned int)len) != (int)len) {
+            ret = false;
+            break;
+        }
+    }
+    if (ferror(in)) {
+        ret = false;
+    }
+    fclose(in);
+    if (gzclose(out) != Z_OK) {
+        ret = false;
+    }
+    if (!ret) {
+        remove(dest);
+    }
+    return ret;
+#else
+    return false;
+#endif
+}
+
 //Returns the file name, given its full (absolute path) name.
 StringBuffer getFileNameFromPath(const StringBuffer& fullName) {
     
@@ -159,6 +159,18 @@ void CacheSyncSource::setItemStatus(const WCHAR* wkey, int status, const char* c
 
 }
 
+/**
+* The statuses of a whole message are applied to the cache in one batch
+*/
+void CacheSyncSource::setItemStatuses(const std::vector<ItemStatus>& statuses) {
+
+    cache->beginBatch();
+    SyncSource::setItemStatuses(statuses);
+    if (cache->endBatch()) {
+        LOG.error("[%s] %s: error updating the cache", getConfig().getName(), __FUNCTION__);
+    }
+}
+
 
 StringBuffer CacheSyncSource::getItemSignature(StringBuffer& key) 
 {
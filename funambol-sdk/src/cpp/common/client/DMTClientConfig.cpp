@@ -1092,6 +1092,14 @@ bool DMTClientConfig::readConnConfig(ConfigurationNode* /* syncMLNode */,
     accessConfig.setCompression((strcmp(tmp,  "1")==0) ? true : false);
     delete [] tmp;
 
+    tmp = connNode->readPropertyValue(PROPERTY_ENABLE_WBXML);
+    accessConfig.setWBXML((strcmp(tmp,  "1")==0) ? true : false);
+    delete [] tmp;
+
+    tmp = connNode->readPropertyValue(PROPERTY_ENABLE_CHECKPOINTS);
+    accessConfig.setCheckpoints((strcmp(tmp,  "1")==0) ? true : false);
+    delete [] tmp;
+
     return true;
 }
 
@@ -1125,6 +1133,8 @@ void DMTClientConfig::saveConnConfig(ConfigurationNode* /* syncMLNode */,
     connNode->setPropertyValue(PROPERTY_READ_BUFFER_SIZE, buf);
     connNode->setPropertyValue(PROPERTY_USER_AGENT, accessConfig.getUserAgent());
     connNode->setPropertyValue(PROPERTY_ENABLE_COMPRESSION, accessConfig.getCompression() ? "1": "0");
+    connNode->setPropertyValue(PROPERTY_ENABLE_WBXML, accessConfig.getWBXML() ? "1": "0");
+    connNode->setPropertyValue(PROPERTY_ENABLE_CHECKPOINTS, accessConfig.getCheckpoints() ? "1": "0");
 }
 
 bool DMTClientConfig::readExtAccessConfig(ConfigurationNode* /* syncMLNode */,
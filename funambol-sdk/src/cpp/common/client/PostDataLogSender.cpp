@@ -41,6 +41,9 @@
 
 USE_NAMESPACE
 
+PostDataLogSender::PostDataLogSender() : agent(NULL), partSize(LOG_SEGMENT_PART_SIZE) {
+}
+
 StringBuffer PostDataLogSender::send(const StringBuffer& msg) {
     StringBuffer buf;
     this->header.append("\n");
@@ -58,6 +61,72 @@ StringBuffer PostDataLogSender::send(const StringBuffer& msg) {
     return buf;
 }
 
+StringBuffer PostDataLogSender::sendSegment(LogAccessor& accessor, int index, int count) {
+    size_t size = 0;
+    bool compressed = false;
+    if (!accessor.getSegmentInfo(index, &size, &compressed)) {
+        LOG.error("%s: no log segment %d/%d", __FUNCTION__, index + 1, count);
+        return StringBuffer(NULL);
+    }
+
+    // An empty segment is still sent, in one part
+    size_t parts = size ? (size + partSize - 1) / partSize : 1;
+    StringBuffer buf;
+    for (size_t part = 0; part < parts; part++) {
+        StringBuffer partHeader(header);
+        StringBuffer value;
+        value.sprintf("%d/%d", index + 1, count);
+        partHeader.append("Log-Segment:");
+        partHeader.append(value);
+        partHeader.append("\n");
+        if (parts > 1) {
+            value.sprintf("%lu/%lu", (unsigned long)part + 1, (unsigned long)parts);
+            partHeader.append("Log-Segment-Part:");
+            partHeader.append(value);
+            partHeader.append("\n");
+        }
+        if (compressed) {
+            partHeader.append("Content-Encoding:gzip\n");
+        }
+        partHeader.append("\n");
+        partHeader.append("\n");
+
+        // The segment may be binary: read after the header and sent with its size
+        size_t offset = part * partSize;
+        size_t length = size - offset < partSize ? size - offset : partSize;
+        size_t headerLength = partHeader.length();
+        char* message = new char[headerLength + length];
+        memcpy(message, partHeader.c_str(), headerLength);
+        size_t done = 0;
+        while (done < length) {
+            long read = accessor.readSegment(index, offset + done,
+                                             &message[headerLength + done], length - done);
+            if (read <= 0) {
+                break;
+            }
+            done += read;
+        }
+        if (done < length) {
+            LOG.error("%s: unable to read the log segment %d/%d", __FUNCTION__, index + 1, count);
+            delete [] message;
+            return StringBuffer(NULL);
+        }
+
+        LogLevel oldlevel = Log::instance().getLevel();
+        Log::instance().setLevel(LOG_LEVEL_NONE);
+        char* temp = agent->sendMessage(message, (unsigned int)(headerLength + length));
+        Log::instance().setLevel(oldlevel);
+        delete [] message;
+        if (!temp) {
+            LOG.error("%s: unable to send the log segment %d/%d", __FUNCTION__, index + 1, count);
+            return StringBuffer(NULL);
+        }
+        buf = temp;
+        delete [] temp;
+    }
+    return buf;
+}
+
 void PostDataLogSender::addHeader(const StringBuffer& name, const StringBuffer& value) {
     this->header.append(name);
     this->header.append(":");
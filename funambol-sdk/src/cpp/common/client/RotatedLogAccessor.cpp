@@ -0,0 +1,142 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "client/RotatedLogAccessor.h"
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/utils.h"
+#include "base/Log.h"
+
+USE_NAMESPACE
+
+RotatedLogAccessor::RotatedLogAccessor(const StringBuffer& filePath, unsigned int maxCount) {
+	this->filePath = filePath;
+	this->maxCount = maxCount;
+}
+
+StringBuffer RotatedLogAccessor::getLog() {
+	StringBuffer result;
+	char* content = NULL;
+	size_t len = 0;
+
+	if (readFile(filePath.c_str(), &content, &len, false)) {
+		result = content;
+	}
+	delete [] content;
+	return result;
+}
+
+/**
+ * Opens the segment and adds it to the snapshot.
+ * @return false if the file does not exist
+ */
+bool RotatedLogAccessor::openSegment(const StringBuffer& name) {
+	FILE* file = fopen(name.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+	long size = -1;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		size = ftell(file);
+	}
+	if (size < 0) {
+		LOG.error("%s: unable to read %s", __FUNCTION__, name.c_str());
+		fclose(file);
+		return false;
+	}
+
+	Segment segment;
+	segment.name       = name;
+	segment.file       = file;
+	segment.size       = (size_t)size;
+	segment.compressed = name.endsWith(".gz");
+	segments.push_back(segment);
+	return true;
+}
+
+int RotatedLogAccessor::getSegmentCount() {
+	StringBuffer name;
+
+	releaseSegments();
+	for (unsigned int i = maxCount; i >= 1; i--) {
+		// While being compressed both files may exist: the plain one is complete
+		name.sprintf("%s.%u", filePath.c_str(), i);
+		if (!openSegment(name)) {
+			name.append(".gz");
+			openSegment(name);
+		}
+	}
+	openSegment(filePath);
+	return (int)segments.size();
+}
+
+bool RotatedLogAccessor::getSegmentInfo(int index, size_t* size, bool* compressed) {
+	if (index < 0 || index >= (int)segments.size()) {
+		return false;
+	}
+	*size       = segments[index].size;
+	*compressed = segments[index].compressed;
+	return true;
+}
+
+long RotatedLogAccessor::readSegment(int index, size_t offset, char* buffer, size_t size) {
+	if (index < 0 || index >= (int)segments.size()) {
+		return -1;
+	}
+	Segment& segment = segments[index];
+	if (offset >= segment.size) {
+		return 0;
+	}
+	if (size > segment.size - offset) {
+		size = segment.size - offset;
+	}
+	if (fseek(segment.file, (long)offset, SEEK_SET) != 0) {
+		LOG.error("%s: unable to read %s", __FUNCTION__, segment.name.c_str());
+		return -1;
+	}
+	size_t read = fread(buffer, 1, size, segment.file);
+	if (read < size && ferror(segment.file)) {
+		LOG.error("%s: unable to read %s", __FUNCTION__, segment.name.c_str());
+		return -1;
+	}
+	return (long)read;
+}
+
+void RotatedLogAccessor::releaseSegments() {
+	for (size_t i = 0; i < segments.size(); i++) {
+		fclose(segments[i].file);
+	}
+	segments.clear();
+}
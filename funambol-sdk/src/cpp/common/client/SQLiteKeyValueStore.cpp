@@ -52,6 +52,7 @@ SQLiteKeyValueStore::SQLiteKeyValueStore(const StringBuffer & table, const Strin
     statement = NULL;
     
     this->isTransactional = isTransactional; 
+    inBatch = false;
     
     //bool toInit =!checkIfTableExists(table);
     bool toInit = true;
@@ -200,6 +201,23 @@ int SQLiteKeyValueStore::close()
     return 0;
 }
 
+void SQLiteKeyValueStore::beginBatch()
+{
+    if (isTransactional || inBatch) {
+        return;
+    }
+    inBatch = (execute("BEGIN TRANSACTION;") == SQLITE_OK);
+}
+
+int SQLiteKeyValueStore::endBatch()
+{
+    if (!inBatch) {
+        return 0;
+    }
+    inBatch = false;
+    return (execute("COMMIT TRANSACTION;") == SQLITE_OK) ? 0 : 1;
+}
+
 
 bool SQLiteKeyValueStore::checkIfTableExists(const char* tableName){
 /*    StringBuffer sql;
@@ -69,6 +69,7 @@ StringBuffer SendLogHandler::createLogHeader() {
     ret += "syncURL:\t"; ret += accessConfig.getSyncURL(); ret += "\r\n";
     ret += "userAgent:\t"; ret += accessConfig.getUserAgent(); ret += "\r\n";
     ret += "enableCompress:\t"; ret += convertBoolToStringBuffer(accessConfig.getCompression()); ret += "\r\n";
+    ret += "enableWbxml:\t"; ret += convertBoolToStringBuffer(accessConfig.getWBXML()); ret += "\r\n";
     ret += "\r\n";
     
     ret += "** DEVDETAIL **\r\n";
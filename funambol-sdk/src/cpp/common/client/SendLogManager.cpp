@@ -47,5 +47,23 @@ StringBuffer SendLogManager::sendLog(LogAccessor* accessor, LogSender* sender) {
     if (accessor == NULL || sender == NULL) {
         return NULL;
     }
-    return sender->send(accessor->getLog());
+
+    // One segment at a time, from a snapshot: the whole log is never
+    // loaded and a rotation meanwhile does not shift the segments
+    int count = accessor->getSegmentCount();
+    if (count <= 0) {
+        return sender->send(accessor->getLog());
+    }
+
+    StringBuffer reply;
+    for (int i = 0; i < count; i++) {
+        reply = sender->sendSegment(*accessor, i, count);
+        if (reply.null()) {
+            // The server would get a log with a hole
+            LOG.error("%s: unable to send the log segment %d", __FUNCTION__, i);
+            break;
+        }
+    }
+    accessor->releaseSegments();
+    return reply;
 }
\ No newline at end of file
@@ -36,54 +36,329 @@
 #include "base/fscapi.h"
 #include "event/FireEvent.h"
 #include "event/ManageListener.h"
+#include "base/util/utils.h"
 #include "base/globalsdef.h"
 
 BEGIN_FUNAMBOL_NAMESPACE
 
+//------------------------------------------------------------- Listener calls
+
+static bool notifySyncListener(SyncListener* listener, SyncEvent& event) {
+
+    switch(event.getType()) {
+        case SYNC_BEGIN:
+            listener->syncBegin(event);
+            break;
+        case SYNC_END:
+            listener->syncEnd(event);
+            break;
+        case SEND_INITIALIZATION:
+            listener->sendInitialization(event);
+            break;
+        case SEND_MODIFICATION:
+            listener->sendModifications(event);
+            break;
+        case SEND_FINALIZATION:
+            listener->sendFinalization(event);
+            break;
+        case SYNC_ERROR:
+            listener->syncError(event);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool notifyTransportListener(TransportListener* listener, TransportEvent& event) {
+
+    switch(event.getType()) {
+        case SEND_DATA_BEGIN:
+          listener->sendDataBegin(event);
+          break;
+        case DATA_SENT:
+          listener->sendingData(event);
+          break;
+        case SEND_DATA_END:
+          listener->sendDataEnd(event);
+          break;
+        case RECEIVE_DATA_BEGIN:
+          listener->receiveDataBegin(event);
+          break;
+        case RECEIVE_DATA_END:
+          listener->receiveDataEnd(event);
+          break;
+        case DATA_RECEIVED:
+          listener->receivingData(event);
+          break;
+        case DATA_ALREADY_COMPLETED:
+          listener->partialData(event);
+          break;
+        default:
+          return false;
+    }
+    return true;
+}
+
+static bool notifySyncSourceListener(SyncSourceListener* listener, SyncSourceEvent& event) {
+
+    switch(event.getType()) {
+            
+        case METADATA_SYNC_BEGIN:
+            listener->metadataSyncBegin(event);
+            break;
+        case METADATA_SYNC_END:
+            listener->metadataSyncEnd(event);
+            break;
+        case SYNC_SOURCE_BEGIN:
+            listener->syncSourceBegin(event);
+            break;
+        case SYNC_SOURCE_END:
+            listener->syncSourceEnd(event);
+            break;
+        case SYNC_SOURCE_SERVER_BEGIN:
+            listener->syncSourceServerBegin(event);
+            break;
+        case SYNC_SOURCE_SERVER_END:
+            listener->syncSourceServerEnd(event);
+            break;
+        case SYNC_SOURCE_SYNCMODE_REQUESTED:
+            listener->syncSourceSyncModeRequested(event);
+            break;
+        case SYNC_SOURCE_TOTAL_CLIENT_ITEMS:
+            listener->syncSourceTotalClientItems(event);
+            break;
+        case SYNC_SOURCE_TOTAL_SERVER_ITEMS:
+            listener->syncSourceTotalServerItems(event);
+            break;
+        case SYNC_SOURCE_RESETTING:
+            listener->syncSourceResetting(event);
+            break;
+        case SYNC_SOURCE_RETRY:
+            listener->syncSourceRetry(event);
+            break;
+            
+        case SYNC_SOURCE_UPLOAD_PHASE_STARTED:
+            listener->syncSourceUploadPhaseStarted(event);
+            break;
+        case SYNC_SOURCE_UPLOAD_PHASE_ENDED:
+            listener->syncSourceUploadPhaseEnded(event);
+            break;
+        case SYNC_SOURCE_DOWNLOAD_PHASE_STARTED:
+            listener->syncSourceDownloadPhaseStarted(event);
+            break;
+        case SYNC_SOURCE_DOWNLOAD_PHASE_ENDED:
+            listener->syncSourceDownloadPhaseEnded(event);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool notifySyncItemListener(SyncItemListener* listener, SyncItemEvent& event) {
+
+    switch(event.getType()) {
+        case ITEM_ADDED_BY_SERVER:
+          listener->itemAddedByServer(event);
+          break;
+        case ITEM_DELETED_BY_SERVER:
+          listener->itemDeletedByServer(event);
+          break;
+        case ITEM_UPDATED_BY_SERVER:
+          listener->itemUpdatedByServer(event);
+          break;
+        case ITEM_ADDED_BY_CLIENT:
+          listener->itemAddedByClient(event);
+          break;
+        case ITEM_DELETED_BY_CLIENT:
+          listener->itemDeletedByClient(event);
+          break;
+        case ITEM_UPDATED_BY_CLIENT:
+          listener->itemUpdatedByClient(event);
+          break;
+        case ITEM_UPLOADED_BY_CLIENT:
+          listener->itemUploadedByClient(event);
+          break;
+
+        // Media sync:
+        case ITEM_UPLOADING:
+          listener->itemUploading(event);
+          break;
+        case ITEM_UPLOADED:
+          listener->itemUploaded(event);
+          break;
+        case ITEM_DOWNLOADING:
+          listener->itemDownloading(event);
+          break;
+        case ITEM_DOWNLOADED:
+          listener->itemDownloaded(event);
+          break;
+        default:
+          return false;
+    }
+    return true;
+}
+
+static bool notifySyncStatusListener(SyncStatusListener* listener, SyncStatusEvent& event) {
+
+    switch(event.getType()) {
+        case CLIENT_STATUS:
+            listener->statusSending(event);
+            break;
+        case SERVER_STATUS:
+            listener->statusReceived(event);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+
+//------------------------------------------------------------- Delivery
+
+// The listeners are called with the ManageListener locked: they are not
+// replaced nor deleted meanwhile. The counts checked by the fire functions
+// before the lock only save the creation of events nobody listens to.
+
+static bool deliverSyncEvent(SyncEvent& event) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countSyncListeners();
+    bool ret = (n > 0);
+    for(int i=0; ret && i<n; i++) {
+        ret = notifySyncListener(m.getSyncListener(i), event);
+    }
+    m.unlock();
+    return ret;
+}
+
+static bool deliverTransportEvent(TransportEvent& event) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countTransportListeners();
+    bool ret = (n > 0);
+    for(int i=0; ret && i<n; i++) {
+        ret = notifyTransportListener(m.getTransportListener(i), event);
+    }
+    m.unlock();
+    return ret;
+}
+
+static bool deliverSyncSourceEvent(SyncSourceEvent& event) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countSyncSourceListeners();
+    bool ret = (n > 0);
+    for(int i=0; ret && i<n; i++) {
+        ret = notifySyncSourceListener(m.getSyncSourceListener(i), event);
+    }
+    m.unlock();
+    return ret;
+}
+
+static bool deliverSyncItemEvent(SyncItemEvent& event) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countSyncItemListeners();
+    bool ret = (n > 0);
+    for(int i=0; ret && i<n; i++) {
+        ret = notifySyncItemListener(m.getSyncItemListener(i), event);
+    }
+    m.unlock();
+    return ret;
+}
+
+static bool deliverSyncStatusEvent(SyncStatusEvent& event) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countSyncStatusListeners();
+    bool ret = (n > 0);
+    for(int i=0; ret && i<n; i++) {
+        ret = notifySyncStatusListener(m.getSyncStatusListener(i), event);
+    }
+    m.unlock();
+    return ret;
+}
+
+bool deliverEvent(EventFamily family, BaseEvent& event) {
+
+    switch (family) {
+        case SYNC_EVENT_FAMILY:
+            return deliverSyncEvent(static_cast<SyncEvent&>(event));
+        case TRANSPORT_EVENT_FAMILY:
+            return deliverTransportEvent(static_cast<TransportEvent&>(event));
+        case SYNC_SOURCE_EVENT_FAMILY:
+            return deliverSyncSourceEvent(static_cast<SyncSourceEvent&>(event));
+        case SYNC_ITEM_EVENT_FAMILY:
+            return deliverSyncItemEvent(static_cast<SyncItemEvent&>(event));
+        case SYNC_STATUS_EVENT_FAMILY:
+            return deliverSyncStatusEvent(static_cast<SyncStatusEvent&>(event));
+        default:
+            return false;
+    }
+}
+
+bool deliverSyncItemEvents(SyncItemEvent** events, int count) {
+
+    ManageListener& m = ManageListener::getInstance();
+    m.lock();
+    int n = m.countSyncItemListeners();
+    for(int i=0; i<n; i++) {
+        m.getSyncItemListener(i)->itemEvents(events, count);
+    }
+    m.unlock();
+    return n > 0;
+}
+
+/*
+ * Hands the event over to the dispatcher, if one is set.
+ * @return true if the event is queued, false if it must be
+ *         delivered synchronously (the caller still owns it)
+ */
+static bool dispatchEvent(EventFamily family, BaseEvent* event) {
+
+    EventDispatcher* dispatcher = ManageListener::getInstance().getEventDispatcher();
+    return (dispatcher != NULL) && dispatcher->dispatch(family, event);
+}
+
+
+//------------------------------------------------------------- Fire functions
+
 //
 // Fire a SyncEvent
 //
 bool fireSyncEvent(const char* msg, int type) {
 
     ManageListener& m = ManageListener::getInstance();
-    int n = m.countSyncListeners();
-    if(n == 0) {
+    if(m.countSyncListeners() == 0) {
         return false;
     }
 
+    if (m.getEventDispatcher()) {
+        SyncEvent* event = new SyncEvent(type, (unsigned long)time(NULL));
+        if(msg) {
+            event->setMessage(msg);
+        }
+        if (dispatchEvent(SYNC_EVENT_FAMILY, event)) {
+            return true;
+        }
+        bool ret = deliverSyncEvent(*event);
+        delete event;
+        return ret;
+    }
+
     SyncEvent event(type, (unsigned long)time(NULL));
     if(msg) {
         event.setMessage(msg);
     }
-    
-    for(int i=0; i<n; i++) {
-        SyncListener* listener = m.getSyncListener(i);
-        
-        switch(type) {
-            case SYNC_BEGIN:
-                listener->syncBegin(event);
-                break;
-            case SYNC_END:
-                listener->syncEnd(event);
-                break;
-            case SEND_INITIALIZATION:
-                listener->sendInitialization(event);
-                break;
-            case SEND_MODIFICATION:
-                listener->sendModifications(event);
-                break;
-            case SEND_FINALIZATION:
-                listener->sendFinalization(event);
-                break;
-            case SYNC_ERROR:
-                listener->syncError(event);
-                break;
-            default:
-                return false;
-        }
-    }
-    
-    return true;
+    return deliverSyncEvent(event);
 }
 
 
@@ -93,44 +368,22 @@ bool fireSyncEvent(const char* msg, int type) {
 bool fireTransportEvent(unsigned long size, int type) {
 
     ManageListener& m = ManageListener::getInstance();
-    int n = m.countTransportListeners();
-    if(n == 0) {
+    if(m.countTransportListeners() == 0) {
         return false;
     }
 
-    TransportEvent event(size, type, (unsigned long)time(NULL));
-
-    for(int i=0; i<n; i++) {
-        TransportListener* listener = m.getTransportListener(i);
-
-        switch(type) {
-            case SEND_DATA_BEGIN:
-              listener->sendDataBegin(event);
-              break;
-            case DATA_SENT:
-              listener->sendingData(event);
-              break;
-            case SEND_DATA_END:
-              listener->sendDataEnd(event);
-              break;
-            case RECEIVE_DATA_BEGIN:
-              listener->receiveDataBegin(event);
-              break;
-            case RECEIVE_DATA_END:
-              listener->receiveDataEnd(event);
-              break;
-            case DATA_RECEIVED:
-              listener->receivingData(event);
-              break;
-            case DATA_ALREADY_COMPLETED:
-              listener->partialData(event);
-              break;
-            default:
-              return false;
+    if (m.getEventDispatcher()) {
+        TransportEvent* event = new TransportEvent(size, type, (unsigned long)time(NULL));
+        if (dispatchEvent(TRANSPORT_EVENT_FAMILY, event)) {
+            return true;
         }
+        bool ret = deliverTransportEvent(*event);
+        delete event;
+        return ret;
     }
 
-    return true;
+    TransportEvent event(size, type, (unsigned long)time(NULL));
+    return deliverTransportEvent(event);
 }
 
 
@@ -140,70 +393,22 @@ bool fireTransportEvent(unsigned long size, int type) {
 bool fireSyncSourceEvent(const char* sourceURI, const char* sourceName, SyncMode mode, int data, int type) {
 
     ManageListener& m = ManageListener::getInstance();
-    int n = m.countSyncSourceListeners();
-    if(n == 0) {
+    if(m.countSyncSourceListeners() == 0) {
         return false;
     }
 
-    SyncSourceEvent event(sourceURI, sourceName, mode, data, type, (unsigned long)time(NULL));
-
-    for(int i=0; i<n; i++) {
-        SyncSourceListener *listener = m.getSyncSourceListener(i);
-        
-        switch(type) {
-                
-            case METADATA_SYNC_BEGIN:
-                listener->metadataSyncBegin(event);
-                break;
-            case METADATA_SYNC_END:
-                listener->metadataSyncEnd(event);
-                break;
-            case SYNC_SOURCE_BEGIN:
-                listener->syncSourceBegin(event);
-                break;
-            case SYNC_SOURCE_END:
-                listener->syncSourceEnd(event);
-                break;
-            case SYNC_SOURCE_SERVER_BEGIN:
-                listener->syncSourceServerBegin(event);
-                break;
-            case SYNC_SOURCE_SERVER_END:
-                listener->syncSourceServerEnd(event);
-                break;
-            case SYNC_SOURCE_SYNCMODE_REQUESTED:
-                listener->syncSourceSyncModeRequested(event);
-                break;
-            case SYNC_SOURCE_TOTAL_CLIENT_ITEMS:
-                listener->syncSourceTotalClientItems(event);
-                break;
-            case SYNC_SOURCE_TOTAL_SERVER_ITEMS:
-                listener->syncSourceTotalServerItems(event);
-                break;
-            case SYNC_SOURCE_RESETTING:
-                listener->syncSourceResetting(event);
-                break;
-            case SYNC_SOURCE_RETRY:
-                listener->syncSourceRetry(event);
-                break;
-                
-            case SYNC_SOURCE_UPLOAD_PHASE_STARTED:
-                listener->syncSourceUploadPhaseStarted(event);
-                break;
-            case SYNC_SOURCE_UPLOAD_PHASE_ENDED:
-                listener->syncSourceUploadPhaseEnded(event);
-                break;
-            case SYNC_SOURCE_DOWNLOAD_PHASE_STARTED:
-                listener->syncSourceDownloadPhaseStarted(event);
-                break;
-            case SYNC_SOURCE_DOWNLOAD_PHASE_ENDED:
-                listener->syncSourceDownloadPhaseEnded(event);
-                break;
-            default:
-                return false;
+    if (m.getEventDispatcher()) {
+        SyncSourceEvent* event = new SyncSourceEvent(sourceURI, sourceName, mode, data, type, (unsigned long)time(NULL));
+        if (dispatchEvent(SYNC_SOURCE_EVENT_FAMILY, event)) {
+            return true;
         }
+        bool ret = deliverSyncSourceEvent(*event);
+        delete event;
+        return ret;
     }
 
-    return true;
+    SyncSourceEvent event(sourceURI, sourceName, mode, data, type, (unsigned long)time(NULL));
+    return deliverSyncSourceEvent(event);
 }
 
 
@@ -213,58 +418,22 @@ bool fireSyncSourceEvent(const char* sourceURI, const char* sourceName, SyncMode
 bool fireSyncItemEvent(const char* sourceURI, const char* sourcename, const WCHAR* itemKey, int type, int data) {
 
     ManageListener& m = ManageListener::getInstance();
-    int n = m.countSyncItemListeners();
-    if(n == 0) {
+    if(m.countSyncItemListeners() == 0) {
         return false;
     }
 
-    SyncItemEvent event(itemKey, sourcename, sourceURI, type, (unsigned long)time(NULL), data);
-
-    for(int i=0; i<n; i++) {
-        SyncItemListener *listener = m.getSyncItemListener(i);
-
-        switch(type) {
-            case ITEM_ADDED_BY_SERVER:
-              listener->itemAddedByServer(event);
-              break;
-            case ITEM_DELETED_BY_SERVER:
-              listener->itemDeletedByServer(event);
-              break;
-            case ITEM_UPDATED_BY_SERVER:
-              listener->itemUpdatedByServer(event);
-              break;
-            case ITEM_ADDED_BY_CLIENT:
-              listener->itemAddedByClient(event);
-              break;
-            case ITEM_DELETED_BY_CLIENT:
-              listener->itemDeletedByClient(event);
-              break;
-            case ITEM_UPDATED_BY_CLIENT:
-              listener->itemUpdatedByClient(event);
-              break;
-            case ITEM_UPLOADED_BY_CLIENT:
-              listener->itemUploadedByClient(event);
-              break;
-
-            // Media sync:
-            case ITEM_UPLOADING:
-              listener->itemUploading(event);
-              break;
-            case ITEM_UPLOADED:
-              listener->itemUploaded(event);
-              break;
-            case ITEM_DOWNLOADING:
-              listener->itemDownloading(event);
-              break;
-            case ITEM_DOWNLOADED:
-              listener->itemDownloaded(event);
-              break;
-            default:
-              return false;
+    if (m.getEventDispatcher()) {
+        SyncItemEvent* event = new SyncItemEvent(itemKey, sourcename, sourceURI, type, (unsigned long)time(NULL), data);
+        if (dispatchEvent(SYNC_ITEM_EVENT_FAMILY, event)) {
+            return true;
         }
+        bool ret = deliverSyncItemEvent(*event);
+        delete event;
+        return ret;
     }
 
-    return true;
+    SyncItemEvent event(itemKey, sourcename, sourceURI, type, (unsigned long)time(NULL), data);
+    return deliverSyncItemEvent(event);
 }
 
 
@@ -274,42 +443,61 @@ bool fireSyncItemEvent(const char* sourceURI, const char* sourcename, const WCHA
 bool fireSyncStatusEvent(const char* command, int statusCode, const char* name, const char* uri, const WCHAR* itemKey, int type) {
 
     ManageListener& m = ManageListener::getInstance();
-    int n = m.countSyncStatusListeners();
-    if(n == 0) {
+    if(m.countSyncStatusListeners() == 0) {
         return false;
     }
 
     unsigned long timestamp = (unsigned long)time(NULL);
+
+    if (m.getEventDispatcher()) {
+        SyncStatusEvent* event = new SyncStatusEvent(statusCode, command, itemKey, name, uri, type, timestamp);
+        if (dispatchEvent(SYNC_STATUS_EVENT_FAMILY, event)) {
+            return true;
+        }
+        bool ret = deliverSyncStatusEvent(*event);
+        delete event;
+        return ret;
+    }
+
     // Create event (object alive in the scope of this function)
     SyncStatusEvent event(statusCode, command, itemKey, name, uri, type, timestamp);
+    return deliverSyncStatusEvent(event);
+}
 
-    for(int i=0; i<n; i++) {
-        SyncStatusListener *listener = m.getSyncStatusListener(i);
+#ifndef WCHAR_IS_CHAR
+bool fireSyncItemEvent(const char* sourceURI, const char* sourcename, const char* itemKey, int type, int data) {
 
-        switch(type) {
-            case CLIENT_STATUS:
-                listener->statusSending(event);
-                break;
-            case SERVER_STATUS:
-                listener->statusReceived(event);
-                break;
-            default:
-                return false;
-        }
+    if (ManageListener::getInstance().countSyncItemListeners() == 0) {
+        return false;
     }
+    return fireSyncItemEvent(sourceURI, sourcename, CharAsWChar(itemKey).c_str(), type, data);
+}
 
-    return true;
+bool fireSyncStatusEvent(const char* command, int statusCode, const char* name, const char* uri, const char* itemKey, int type) {
+
+    if (ManageListener::getInstance().countSyncStatusListeners() == 0) {
+        return false;
+    }
+    return fireSyncStatusEvent(command, statusCode, name, uri, CharAsWChar(itemKey).c_str(), type);
 }
+#endif
 
+//
+// Fire a MediaHub ItemStatusEvent: always delivered synchronously,
+// as the event refers to the MHSyncItemInfo owned by the caller.
+//
 bool fireItemStatusEvent(const char* sourceName, const MHSyncItemInfo* MHItemInfo, int type)
 {
     ManageListener& m = ManageListener::getInstance();
     int listenersNum = 0;
-    if ((listenersNum = m.countItemStatusListeners()) == 0) {
+    if (m.countItemStatusListeners() == 0) {
         return false;
     }
     
-    for(int i=0; i < listenersNum; i++) {
+    bool ret = true;
+    m.lock();
+    listenersNum = m.countItemStatusListeners();
+    for(int i=0; ret && i < listenersNum; i++) {
         ItemStatusListener *listener = m.getItemStatusListener(i);
 
         switch (type) 
@@ -327,12 +515,14 @@ bool fireItemStatusEvent(const char* sourceName, const MHSyncItemInfo* MHItemInf
                 break;
             }
             default:
-                return false;
+                ret = false;
+                break;
         }        
         
     }
+    m.unlock();
     
-    return true;
+    return ret;
 }
 
 
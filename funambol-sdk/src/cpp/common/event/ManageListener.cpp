@@ -48,57 +48,40 @@ public:
 
 DestroyManageListener destroyManageListener;
 
-/** 
- * ArrayElement container for the Listeners. It does not clone the inner
- * Listener pointer, nor deletes it. Cloning the element does not clone
- * the Listener, which is managed by ManageListener.
- * The only method which deletes the Listener is set(), to replace it
- * with the new one.
- */
-class ListenerElement: public ArrayElement {
-
-  public:
-
-    ListenerElement(Listener *_l) : l(_l) {} ;
-    ListenerElement(ListenerElement &other) : l(other.l) {} ;
-
-    ~ListenerElement() {}
-
-    void set(Listener *_l) { delete l; l = _l; };
-    Listener* get() { return l; };
-
-    ArrayElement* clone() {return new ListenerElement(*this);};
-
-  private:
-
-    Listener *l;
-};
-
-
 /* Static Variables */
 
 ManageListener * ManageListener::instance = 0;
 
 /* Release all the listeners for the given list */
-static void releaseListeners(ArrayList &list) {
-    ListenerElement *l=NULL;
-
-    for(l = (ListenerElement*)list.front(); l; l = (ListenerElement*)list.next()) {
-        l->set(NULL);
+static void releaseListeners(std::vector<Listener*> &list) {
+    for (size_t i = 0; i < list.size(); i++) {
+        delete list[i];
     }
     list.clear();
 }
 
 //-------------------------------- Private Methods ------------------------------
 
+ManageListener::ManageListener() : dispatcher(NULL) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
 /* Release all the listeners on all the lists */
 ManageListener::~ManageListener() {
+    flushEvents();
+    lock();
     releaseListeners(synclisteners);
     releaseListeners(transportlisteners);
     releaseListeners(syncstatuslisteners);
     releaseListeners(syncitemlisteners);
     releaseListeners(syncsourcelisteners);
     releaseListeners(itemstatuslisteners);
+    unlock();
+    pthread_mutex_destroy(&mutex);
 }
 
 /*
@@ -107,45 +90,70 @@ ManageListener::~ManageListener() {
  * @return the pointer to the element with the same name, 
  *         or NULL otherwise.
  */
-Listener *ManageListener::lookupListener(const char* name, ArrayList &list) {
-    ListenerElement *l=NULL;
-
-    for(l = (ListenerElement*)list.front(); l; l = (ListenerElement*)list.next()) {
-        if (l->get()->getName() == name) {
-            return l->get();
+Listener *ManageListener::lookupListener(const char* name, ListenerList &list) {
+
+    Listener* ret = NULL;
+    lock();
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i]->getName() == name) {
+            ret = list[i];
+            break;
         }
     }
-    return NULL;
+    unlock();
+    return ret;
 }
 
 /* Set a new listener, replacing an existen one or adding it to the list. */
-bool ManageListener::setListener(Listener* listener, ArrayList &list) {
-    ListenerElement *l=NULL;
-
-    for(l = (ListenerElement*)list.front(); l; l = (ListenerElement*)list.next()) {
-        if (l->get()->getName() == listener->getName()) {
-            l->set(listener);
-            return false;       // Element already in the list, just change it
+bool ManageListener::setListener(Listener* listener, ListenerList &list) {
+
+    // The events fired so far go to the old listeners; the dispatcher
+    // needs the lock to deliver them
+    flushEvents();
+
+    bool added = true;
+    lock();
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i]->getName() == listener->getName()) {
+            delete list[i];
+            list[i] = listener;
+            added = false;      // Element already in the list, just change it
+            break;
         }
     }
-
-    // Not found, add it to the list
-    ListenerElement newElement(listener);
-    list.add(newElement);
-    return true;
+    if (added) {
+        // Not found, add it to the list
+        list.push_back(listener);
+    }
+    unlock();
+    return added;
 }
 
 
 /* Unset a listener, referenced by name. If the listener with that name is
  * not found, it does nothing. */
-void ManageListener::unsetListener(const char* name, ArrayList &list) {
-    for(int i=0; i<list.size(); i++) {
-        ListenerElement *l = static_cast<ListenerElement*>(list[i]);
-        if (l->get()->getName() == name) {
-            l->set(NULL);
-            list.removeElementAt(i);
+void ManageListener::unsetListener(const char* name, ListenerList &list) {
+
+    flushEvents();
+
+    lock();
+    ListenerList::iterator it = list.begin();
+    while (it != list.end()) {
+        if ((*it)->getName() == name) {
+            delete *it;
+            it = list.erase(it);
+        } else {
+            ++it;
         }
     }
+    unlock();
+}
+
+/* Wait for the queued events, before a listener is deleted. */
+void ManageListener::flushEvents() {
+    if (dispatcher) {
+        dispatcher->flush();
+    }
 }
 
 
@@ -200,33 +208,27 @@ ItemStatusListener*  ManageListener::getItemStatusListener(const char *name) {
 
 // Get listeners by position.
 SyncListener* ManageListener::getSyncListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(synclisteners[pos]);
-    return static_cast<SyncListener*>(le->get());
+    return static_cast<SyncListener*>(synclisteners[pos]);
 }
 
 TransportListener* ManageListener::getTransportListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(transportlisteners[pos]);
-    return static_cast<TransportListener*>(le->get());
+    return static_cast<TransportListener*>(transportlisteners[pos]);
 }
 
 SyncSourceListener* ManageListener::getSyncSourceListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(syncsourcelisteners[pos]);
-    return static_cast<SyncSourceListener*>(le->get());
+    return static_cast<SyncSourceListener*>(syncsourcelisteners[pos]);
 }
 
 SyncItemListener* ManageListener::getSyncItemListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(syncitemlisteners[pos]);
-    return static_cast<SyncItemListener*>(le->get());
+    return static_cast<SyncItemListener*>(syncitemlisteners[pos]);
 }
 
 SyncStatusListener* ManageListener::getSyncStatusListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(syncstatuslisteners[pos]);
-    return static_cast<SyncStatusListener*>(le->get());
+    return static_cast<SyncStatusListener*>(syncstatuslisteners[pos]);
 }
 
 ItemStatusListener* ManageListener::getItemStatusListener(int pos) {
-    ListenerElement* le = static_cast<ListenerElement*>(itemstatuslisteners[pos]);
-    return static_cast<ItemStatusListener*>(le->get());
+    return static_cast<ItemStatusListener*>(itemstatuslisteners[pos]);
 }
 
 //
@@ -255,6 +257,16 @@ void ManageListener::setSyncStatusListener(SyncStatusListener* listener) {
 void ManageListener::setItemStatusListener(ItemStatusListener* listener) {
     setListener(listener, itemstatuslisteners);
 }
+//
+// Event dispatcher:
+//
+void ManageListener::setEventDispatcher(EventDispatcher* d) {
+    if (dispatcher && dispatcher != d) {
+        dispatcher->flush();
+    }
+    dispatcher = d;
+}
+
 //
 // Unset listeners:
 //
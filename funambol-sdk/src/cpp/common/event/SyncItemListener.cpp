@@ -35,6 +35,7 @@
 
 #include "base/Log.h"
 #include "event/SyncItemListener.h"
+#include "event/FireEvent.h"
 
 BEGIN_NAMESPACE
 
@@ -92,4 +93,11 @@ void SyncItemListener::itemDownloaded(SyncItemEvent& event) {
     logEvent("download complete", event);
 }
 
+// Batch of events, from the EventDispatcher
+void SyncItemListener::itemEvents(SyncItemEvent** events, int count) {
+    for (int i = 0; i < count; i++) {
+        notifySyncItemListener(this, *events[i]);
+    }
+}
+
 END_NAMESPACE
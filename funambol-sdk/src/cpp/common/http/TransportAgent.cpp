@@ -62,6 +62,7 @@ TransportAgent::TransportAgent() {
     SSLVerifyHost = true;
     responseSize = 0;
     responseCode = -1;
+    sendTime = waitTime = receiveTime = -1;
     // Set the default content type in the SyncManager::initTransportAgent    
 }
 
@@ -81,6 +82,7 @@ TransportAgent::TransportAgent(const URL& newURL,
     SSLVerifyHost = true;
     responseSize = 0;
     responseCode = -1;
+    sendTime = waitTime = receiveTime = -1;
     // Set the default content type in the SyncManager::initTransportAgent     
 }
 
@@ -136,6 +138,16 @@ int TransportAgent::getResponseCode() {
     return responseCode;
 }
 
+bool TransportAgent::getLastTimings(int64_t* send, int64_t* wait, int64_t* receive) {
+    if (sendTime < 0 || waitTime < 0 || receiveTime < 0) {
+        return false;
+    }
+    if (send)    *send    = sendTime;
+    if (wait)    *wait    = waitTime;
+    if (receive) *receive = receiveTime;
+    return true;
+}
+
 void TransportAgent::setUserAgent(const char* ua) {
     userAgent = ua;
 }
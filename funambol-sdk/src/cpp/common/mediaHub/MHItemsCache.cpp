@@ -0,0 +1,316 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "MediaHub/MHItemsCache.h"
+#include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHSyncItemInfo.h"
+#include "base/Log.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+MHItemsCache::MHItemsCache(const MHItemsStore& store_, size_t maxEntries) : store(store_), generation(0)
+{
+    maxEntriesPerShard = maxEntries / MH_ITEMS_CACHE_SHARDS;
+    if (maxEntriesPerShard == 0) {
+        maxEntriesPerShard = 1;
+    }
+    
+    for (int i = 0; i < MH_ITEMS_CACHE_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].mutex, NULL);
+    }
+    pthread_mutex_init(&generation_mutex, NULL);
+}
+
+MHItemsCache::~MHItemsCache()
+{
+    for (int i = 0; i < MH_ITEMS_CACHE_SHARDS; i++) {
+        std::map<unsigned long, Node>::iterator it;
+        for (it = shards[i].items.begin(); it != shards[i].items.end(); ++it) {
+            delete it->second.item;
+        }
+        pthread_mutex_destroy(&shards[i].mutex);
+    }
+    pthread_mutex_destroy(&generation_mutex);
+}
+
+MHItemsCache::Shard& MHItemsCache::keyShard(const std::string& key)
+{
+    // FNV-1a
+    unsigned long hash = 2166136261UL;
+    for (size_t i = 0; i < key.size(); i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619UL;
+    }
+    return shards[hash % MH_ITEMS_CACHE_SHARDS];
+}
+
+
+MHSyncItemInfo* MHItemsCache::getById(unsigned long id)
+{
+    return getCopy(id, NULL, NULL);
+}
+
+MHSyncItemInfo* MHItemsCache::getByGuid(const char* guid)
+{
+    if ((guid == NULL) || (*guid == 0)) {
+        return NULL;
+    }
+    
+    unsigned long id = lookupIndex(true, guid);
+    if (id == 0) {
+        return NULL;
+    }
+    MHSyncItemInfo* copy = getCopy(id, guid, NULL);
+    if (copy == NULL) {
+        // stale index entry
+        removeIndex(true, guid, id);
+    }
+    return copy;
+}
+
+MHSyncItemInfo* MHItemsCache::getByLocalPath(const char* localPath)
+{
+    if ((localPath == NULL) || (*localPath == 0)) {
+        return NULL;
+    }
+    
+    unsigned long id = lookupIndex(false, localPath);
+    if (id == 0) {
+        return NULL;
+    }
+    MHSyncItemInfo* copy = getCopy(id, NULL, localPath);
+    if (copy == NULL) {
+        // stale index entry
+        removeIndex(false, localPath, id);
+    }
+    return copy;
+}
+
+MHSyncItemInfo* MHItemsCache::getCopy(unsigned long id, const char* guid, const char* path)
+{
+    MHSyncItemInfo* copy = NULL;
+    Shard& shard = idShard(id);
+    
+    pthread_mutex_lock(&shard.mutex);
+    
+    std::map<unsigned long, Node>::iterator it = shard.items.find(id);
+    if (it != shard.items.end()) {
+        MHSyncItemInfo* item = it->second.item;
+        
+        // the index may be behind: check the key on the entry itself
+        if ((guid == NULL || item->getGuid() == guid) &&
+            (path == NULL || item->getLocalItemPath() == path)) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruPos);
+            copy = store.copyEntry(item);
+        }
+    }
+    
+    pthread_mutex_unlock(&shard.mutex);
+    
+    return copy;
+}
+
+unsigned long MHItemsCache::lookupIndex(bool guidIndex, const char* key)
+{
+    unsigned long id = 0;
+    std::string k(key);
+    Shard& shard = keyShard(k);
+    
+    pthread_mutex_lock(&shard.mutex);
+    std::map<std::string, unsigned long>& index = guidIndex ? shard.guidIndex : shard.pathIndex;
+    std::map<std::string, unsigned long>::iterator it = index.find(k);
+    if (it != index.end()) {
+        id = it->second;
+    }
+    pthread_mutex_unlock(&shard.mutex);
+    
+    return id;
+}
+
+void MHItemsCache::addIndex(bool guidIndex, const std::string& key, unsigned long id)
+{
+    if (key.empty()) {
+        return;
+    }
+    
+    Shard& shard = keyShard(key);
+    pthread_mutex_lock(&shard.mutex);
+    if (guidIndex) {
+        shard.guidIndex[key] = id;
+    } else {
+        shard.pathIndex[key] = id;
+    }
+    pthread_mutex_unlock(&shard.mutex);
+}
+
+void MHItemsCache::removeIndex(bool guidIndex, const std::string& key, unsigned long id)
+{
+    if (key.empty()) {
+        return;
+    }
+    
+    Shard& shard = keyShard(key);
+    pthread_mutex_lock(&shard.mutex);
+    std::map<std::string, unsigned long>& index = guidIndex ? shard.guidIndex : shard.pathIndex;
+    std::map<std::string, unsigned long>::iterator it = index.find(key);
+    // the key may have been reassigned to another entry meanwhile
+    if (it != index.end() && it->second == id) {
+        index.erase(it);
+    }
+    pthread_mutex_unlock(&shard.mutex);
+}
+
+
+unsigned long MHItemsCache::getGeneration()
+{
+    pthread_mutex_lock(&generation_mutex);
+    unsigned long gen = generation;
+    pthread_mutex_unlock(&generation_mutex);
+    
+    return gen;
+}
+
+void MHItemsCache::bumpGeneration()
+{
+    pthread_mutex_lock(&generation_mutex);
+    generation++;
+    pthread_mutex_unlock(&generation_mutex);
+}
+
+void MHItemsCache::put(MHSyncItemInfo* item, unsigned long readGeneration)
+{
+    if ((item == NULL) || (item->getId() == 0)) {
+        return;
+    }
+    
+    unsigned long id = item->getId();
+    std::vector<MHSyncItemInfo*> dropped;
+    Shard& shard = idShard(id);
+    
+    pthread_mutex_lock(&shard.mutex);
+    
+    // checked with the shard locked: invalidate() bumps the generation
+    // before locking the shard, so it can't be missed
+    if (getGeneration() != readGeneration) {
+        pthread_mutex_unlock(&shard.mutex);
+        return;
+    }
+    
+    std::map<unsigned long, Node>::iterator it = shard.items.find(id);
+    if (it != shard.items.end()) {
+        dropped.push_back(unlink(shard, it));
+    }
+    
+    while (shard.items.size() >= maxEntriesPerShard && !shard.lru.empty()) {
+        dropped.push_back(unlink(shard, shard.items.find(shard.lru.back())));
+    }
+    
+    MHSyncItemInfo* copy = store.copyEntry(item);
+    Node node;
+    node.item = copy;
+    node.lruPos = shard.lru.insert(shard.lru.begin(), id);
+    shard.items[id] = node;
+    
+    std::string guid(copy->getGuid().c_str());
+    std::string path(copy->getLocalItemPath().c_str());
+    
+    pthread_mutex_unlock(&shard.mutex);
+    
+    release(dropped);
+    
+    addIndex(true, guid, id);
+    addIndex(false, path, id);
+}
+
+void MHItemsCache::invalidate(unsigned long id)
+{
+    std::vector<MHSyncItemInfo*> dropped;
+    Shard& shard = idShard(id);
+    
+    bumpGeneration();
+    
+    pthread_mutex_lock(&shard.mutex);
+    std::map<unsigned long, Node>::iterator it = shard.items.find(id);
+    if (it != shard.items.end()) {
+        dropped.push_back(unlink(shard, it));
+    }
+    pthread_mutex_unlock(&shard.mutex);
+    
+    release(dropped);
+}
+
+void MHItemsCache::invalidateAll()
+{
+    bumpGeneration();
+    
+    for (int i = 0; i < MH_ITEMS_CACHE_SHARDS; i++) {
+        Shard& shard = shards[i];
+        
+        pthread_mutex_lock(&shard.mutex);
+        std::map<unsigned long, Node>::iterator it;
+        for (it = shard.items.begin(); it != shard.items.end(); ++it) {
+            delete it->second.item;
+        }
+        shard.items.clear();
+        shard.lru.clear();
+        shard.guidIndex.clear();
+        shard.pathIndex.clear();
+        pthread_mutex_unlock(&shard.mutex);
+    }
+}
+
+
+MHSyncItemInfo* MHItemsCache::unlink(Shard& shard, std::map<unsigned long, Node>::iterator it)
+{
+    MHSyncItemInfo* item = it->second.item;
+    shard.lru.erase(it->second.lruPos);
+    shard.items.erase(it);
+    
+    return item;
+}
+
+void MHItemsCache::release(std::vector<MHSyncItemInfo*>& items)
+{
+    std::vector<MHSyncItemInfo*>::iterator it;
+    for (it = items.begin(); it != items.end(); ++it) {
+        MHSyncItemInfo* item = *it;
+        removeIndex(true, item->getGuid().c_str(), item->getId());
+        removeIndex(false, item->getLocalItemPath().c_str(), item->getId());
+        delete item;
+    }
+    items.clear();
+}
+
+END_FUNAMBOL_NAMESPACE
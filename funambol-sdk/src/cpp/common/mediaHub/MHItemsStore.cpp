@@ -35,6 +35,7 @@
 
 #include <string>
 #include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHItemsCache.h"
 #include "base/Log.h"
 #include "string.h"
 #include "errno.h"
@@ -156,12 +157,13 @@ const char* MHItemsStore::select_all_labels_filter_ordered_stmt_fmt   = "SELECT
  %s=%d ORDER BY %s %s";
 const char* MHItemsStore::select_entry_id_stmt_fmt      = "SELECT * from %s WHERE id = %lu";
 const char* MHItemsStore::delete_row_id_stmt_fmt        = "DELETE FROM %s WHERE id = %lu";
+const char* MHItemsStore::update_local_file_stmt_fmt    = "UPDATE %s SET %s = %Q, %s = %Q WHERE id = %lu";
 const char* MHItemsStore::select_count_with_status      = "SELECT COUNT(*) FROM %s WHERE status = %lu";
 
 MHItemsStore::MHItemsStore(const char* storeName, const char* storePath,
                            int funambolSavedVersionNumber,
                            int funambolCurrentVersionNumber,
-                           bool init) : MHStore(storeName, storePath), listener(NULL)
+                           bool init) : MHStore(storeName, storePath), listener(NULL), itemsCache(NULL)
 {
     if (init) {
         if (store_status == store_status_not_initialized) {
@@ -231,7 +233,22 @@ void MHItemsStore::initializeColumns() {
     numColumns = j;
 }
 
-MHItemsStore::~MHItemsStore() {}
+MHItemsStore::~MHItemsStore()
+{
+    delete itemsCache;
+}
+
+void MHItemsStore::setEntriesCacheSize(size_t maxEntries)
+{
+    delete itemsCache;
+    itemsCache = NULL;
+    
+    if (maxEntries > 0) {
+        LOG.debug("%s: caching up to %lu entries of store %s", __FUNCTION__,
+                  (unsigned long)maxEntries, store_name.c_str());
+        itemsCache = new MHItemsCache(*this, maxEntries);
+    }
+}
 
 bool MHItemsStore::initializeTable()
 {
@@ -456,6 +473,10 @@ bool MHItemsStore::UpdateEntry(MHStoreEntry* entry)
     }
     
     bool res = MHStore::UpdateEntry(entry);
+    
+    if (itemsCache) {
+        itemsCache->invalidate(itemInfo->getId());
+    }
 
     if (res && listener != NULL) {
         listener->itemUpdated(itemInfo);
@@ -466,12 +487,107 @@ bool MHItemsStore::UpdateEntry(MHStoreEntry* entry)
 
 bool MHItemsStore::updateEntries(std::vector<MHStoreEntry*>& entries) {
     bool ret = MHStore::updateEntries(entries);
+    
+    if (itemsCache) {
+        std::vector<MHStoreEntry*>::iterator it;
+        for (it = entries.begin(); it != entries.end(); ++it) {
+            itemsCache->invalidate(((MHSyncItemInfo*)*it)->getId());
+        }
+    }
     if (listener != NULL) {
         listener->itemsUpdated(entries);
     }
     return ret;
 }
 
+bool MHItemsStore::storeEntries(std::vector<MHStoreEntry*>& newEntries, std::vector<MHStoreEntry*>& updatedEntries) {
+    std::vector<uint64_t> entriesId;
+    bool ret = MHStore::storeEntries(newEntries, entriesId, updatedEntries);
+    
+    std::vector<uint64_t>::iterator it = entriesId.begin();
+    std::vector<MHStoreEntry*>::iterator entriesIt = newEntries.begin();
+    for(;it != entriesId.end() && entriesIt != newEntries.end();++it,++entriesIt) {
+        MHSyncItemInfo* itemInfo = (MHSyncItemInfo*)*entriesIt;
+        itemInfo->setId(*it);
+    }
+    
+    // the updated items are invalidated even if the transaction was rolled back
+    if (itemsCache) {
+        for (entriesIt = updatedEntries.begin(); entriesIt != updatedEntries.end(); ++entriesIt) {
+            itemsCache->invalidate(((MHSyncItemInfo*)*entriesIt)->getId());
+        }
+    }
+    if (ret && listener != NULL) {
+        if (!newEntries.empty()) {
+            listener->itemsAdded(newEntries);
+        }
+        if (!updatedEntries.empty()) {
+            listener->itemsUpdated(updatedEntries);
+        }
+    }
+    return ret;
+}
+
+bool MHItemsStore::updateLocalFileFields(const std::map<unsigned long, std::pair<std::string, std::string> >& updates,
+                                         const char* pathFieldName, const char* etagFieldName)
+{
+    if ((pathFieldName == NULL) || (etagFieldName == NULL)) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return false;
+    }
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: can't update entries: cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    if (updates.empty()) {
+        return true;
+    }
+    
+    bool ret = true;
+    
+    pthread_mutex_lock(&store_access_mutex);
+    bool ownTransaction = beginBulkTransaction();
+    
+    std::map<unsigned long, std::pair<std::string, std::string> >::const_iterator it;
+    for (it = updates.begin(); it != updates.end(); ++it) {
+        const std::string& path = it->second.first;
+        const std::string& etag = it->second.second;
+        
+        // NULL values clear the fields
+        char* sql = sqlite3_mprintf(update_local_file_stmt_fmt, store_name.c_str(),
+                                    pathFieldName, path.empty() ? NULL : path.c_str(),
+                                    etagFieldName, etag.empty() ? NULL : etag.c_str(),
+                                    it->first);
+        if (sql == NULL) {
+            LOG.error("%s: error formatting update statement", __FUNCTION__);
+            ret = false;
+            break;
+        }
+        
+        int res = sqlite3_exec(db, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+        
+        if (res != SQLITE_OK) {
+            LOG.error("%s: error executing SQL statement: %s", __FUNCTION__, sqlite3_errmsg(db));
+            ret = false;
+            break;
+        }
+    }
+    
+    endBulkTransaction(ownTransaction);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    if (itemsCache) {
+        for (it = updates.begin(); it != updates.end(); ++it) {
+            itemsCache->invalidate(it->first);
+        }
+    }
+    
+    return ret;
+}
+
 bool MHItemsStore::RemoveEntry(MHStoreEntry* entry)
 {
     if (entry == NULL) {
@@ -505,6 +621,10 @@ bool MHItemsStore::RemoveEntry(MHStoreEntry* entry)
     int changes = sqlite3_changes(db);
     pthread_mutex_unlock(&store_access_mutex);
     
+    if (itemsCache) {
+        itemsCache->invalidate(itemInfo->getId());
+    }
+    
     if (ret != SQLITE_OK) {
         LOG.error("%s: error executing SQL statement: %s", __FUNCTION__, sqlite3_errmsg(db));
         return false;
@@ -524,6 +644,16 @@ bool MHItemsStore::RemoveEntry(MHStoreEntry* entry)
     }
 }
 
+bool MHItemsStore::removeAllEntries()
+{
+    bool ret = MHStore::removeAllEntries();
+    
+    if (itemsCache) {
+        itemsCache->invalidateAll();
+    }
+    
+    return ret;
+}
 
 bool MHItemsStore::getAllEntries(CacheItemsList& entryList)
 {
@@ -612,6 +742,15 @@ MHStoreEntry* MHItemsStore::getEntry(const unsigned long itemID) const
         return NULL;
     }
     
+    unsigned long cacheGeneration = 0;
+    if (itemsCache) {
+        MHSyncItemInfo* cachedItem = itemsCache->getById(itemID);
+        if (cachedItem) {
+            return cachedItem;
+        }
+        cacheGeneration = itemsCache->getGeneration();
+    }
+    
     StringBuffer select_entry_stmt;
     select_entry_stmt.sprintf(select_entry_id_stmt_fmt, store_name.c_str(), itemID);
    
@@ -630,9 +769,75 @@ MHStoreEntry* MHItemsStore::getEntry(const unsigned long itemID) const
     sqlite3_finalize( stmt );
     pthread_mutex_unlock(&store_access_mutex);
     
+    if (entry && itemsCache) {
+        itemsCache->put((MHSyncItemInfo*)entry, cacheGeneration);
+    }
+    
     return entry;
 }
 
+MHStoreEntry* MHItemsStore::getEntry(const char* fieldName, const char* fieldValue) const
+{
+    if ((itemsCache == NULL) || (fieldName == NULL)) {
+        return MHStore::getEntry(fieldName, fieldValue);
+    }
+    
+    // only the guid and the local path are indexed by the cache
+    bool byGuid = (strcmp(fieldName, guid_field_name) == 0);
+    bool byPath = (strcmp(fieldName, local_item_path_field_name) == 0);
+    if (!byGuid && !byPath) {
+        return MHStore::getEntry(fieldName, fieldValue);
+    }
+    
+    MHSyncItemInfo* cachedItem = byGuid ? itemsCache->getByGuid(fieldValue)
+                                        : itemsCache->getByLocalPath(fieldValue);
+    if (cachedItem) {
+        return cachedItem;
+    }
+    
+    unsigned long cacheGeneration = itemsCache->getGeneration();
+    MHStoreEntry* entry = MHStore::getEntry(fieldName, fieldValue);
+    if (entry) {
+        itemsCache->put((MHSyncItemInfo*)entry, cacheGeneration);
+    }
+    
+    return entry;
+}
+
+MHSyncItemInfo* MHItemsStore::copyEntry(MHSyncItemInfo* item) const
+{
+    if (item == NULL) {
+        return NULL;
+    }
+    
+    // built like in readEntry(), so that the concrete type is kept
+    MHSyncItemInfo* copy = (MHSyncItemInfo*)createEntry(item->getId(), item->getGuid().c_str(),
+                                  item->getLuid().c_str(), item->getName().c_str(), item->getSize(),
+                                  item->getServerUrl().c_str(), item->getContentType().c_str(),
+                                  item->getCreationDate(), item->getModificationDate(), item->getStatus(),
+                                  item->getServerLastUpdate(), item->getRemoteItemUrl().c_str(),
+                                  item->getRemoteThumbUrl().c_str(), item->getRemotePreviewUrl().c_str(),
+                                  item->getLocalThumbPath().c_str(), item->getLocalPreviewPath().c_str(),
+                                  item->getLocalItemPath().c_str(), item->getRemoteItemETag().c_str(),
+                                  item->getRemoteThumbETag().c_str(), item->getRemotePreviewETag().c_str());
+    
+    copy->setShared(item->getShared());
+    copy->setNumUploadFailures(item->getNumUploadFailures());
+    copy->setValidationStatus(item->getValidationStatus());
+    copy->setLocalItemETag(item->getLocalItemETag().c_str());
+    copy->setLocalThumbETag(item->getLocalThumbETag().c_str());
+    copy->setLocalPreviewETag(item->getLocalPreviewETag().c_str());
+    copy->setItemExifData(item->getItemExifData());
+    copy->setItemVideoMetadata(item->getItemVideoMetadata());
+    
+    StringBuffer services = item->formatExportedServices();
+    if (!services.empty()) {
+        copy->setExportedServicesFromString(services.c_str());
+    }
+    
+    return copy;
+}
+
 
 MHStoreEntry* MHItemsStore::readEntry(sqlite3_stmt *stmt) const
 {
@@ -1216,7 +1421,7 @@ int32_t MHItemsStore::addLabelsToItem(MHSyncItemInfo* itemInfo, std::vector<MHLa
     }
     int count = 0;
     pthread_mutex_lock(&store_access_mutex);
-    sqlite3_exec(db, "BEGIN", 0, 0, 0);
+    bool ownTransaction = beginBulkTransaction();
     std::vector<MHLabelInfo*>::iterator labelsIt = labels->begin();
     
     for(;labelsIt != labels->end();++labelsIt) {
@@ -1232,7 +1437,7 @@ int32_t MHItemsStore::addLabelsToItem(MHSyncItemInfo* itemInfo, std::vector<MHLa
             count++;
         }
     }
-    sqlite3_exec(db, "COMMIT", 0, 0, 0);
+    endBulkTransaction(ownTransaction);
     pthread_mutex_unlock(&store_access_mutex);
     return count;
 }
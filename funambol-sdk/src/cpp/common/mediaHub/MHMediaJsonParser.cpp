@@ -39,11 +39,29 @@
 #include "MediaHub/ExternalServiceAlbum.h"
 #include "base/Log.h"
 #include "base/util/utils.h"
+#include "base/util/JsonWriter.h"
 #include "sapi/SapiPayment.h"
 #include <string.h>
 
 BEGIN_FUNAMBOL_NAMESPACE
 
+/**
+ * Writes the numeric item IDs (stored as StringBuffers) as elements
+ * of the currently open JSON array; empty IDs are skipped.
+ */
+static void writeItemIds(JsonWriter& writer, const ArrayList& itemsIDs)
+{
+    int itemsCount = itemsIDs.size();
+    
+    for (int i = 0; i < itemsCount; i++) {
+        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
+        
+        if ((itemIdStr) && (itemIdStr->empty() == false)) {
+            writer.addInt(NULL, atoi(itemIdStr->c_str()));
+        }
+    }
+}
+
 MHMediaJsonParser::MHMediaJsonParser()
 {
     errorCode.reset();
@@ -429,50 +447,21 @@ bool MHMediaJsonParser::parseExternalServicesListObject(const char* externalServ
     return true;
 }
         
-bool MHMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, bool prettyPrint)
+bool MHMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, bool prettyPrint)
 {
-    cJSON *root = NULL, *ids = NULL; 
-    int itemsCount = 0;
-    
-    if ((itemsCount = itemsIDs.size()) == 0) {
+    if (itemsIDs.size() == 0) {
         return false;
     }
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-   
-    if ((ids = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-     
-    for (int i = 0; i < itemsCount; i++) {
-        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
-        
-        if ((itemIdStr) && (itemIdStr->empty() == false)) {
-            int itemId = atoi(itemIdStr->c_str());
-            cJSON* jsonItemId = cJSON_CreateInt((long)itemId);
-            
-            cJSON_AddItemToArray(ids, jsonItemId);
-        }
-    }
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    cJSON_AddItemToObject(root, "ids", ids);
-    
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
-    
-    cJSON_Delete(root);
+    writer.beginObject();
+    writer.beginArray("ids");
+    writeItemIds(writer, itemsIDs);
+    writer.endArray();
+    writer.endObject();
    
-    if (*itemsListJsonObject == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -480,107 +469,86 @@ bool MHMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, char **
     return true;
 }
 
-bool MHMediaJsonParser::formatMediaItemMetaData(MHSyncItemInfo* itemInfo, char** itemJsonMetaData, bool metaDataOnlyUpdate, bool prettyPrint)
+bool MHMediaJsonParser::formatMediaItemMetaData(MHSyncItemInfo* itemInfo, StringBuffer& itemJsonMetaData, bool metaDataOnlyUpdate, bool prettyPrint)
 {
-    cJSON *root = NULL, *data = NULL;
     const char* itemGuid = NULL;
     const char* itemName = NULL;
     const char* itemContentType = NULL;
     int64_t itemSize = 0;
     time_t itemCreationDate = 0, itemModificationDate = 0;
-    StringBuffer utcDate;
+    StringBuffer creationDate, modificationDate;
     
     if (itemInfo == NULL) {
         return false;
     }
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
- 
-     if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-
-    itemGuid = itemInfo->getGuid();
-    
-    if ((itemGuid != NULL) && (strlen(itemGuid) > 0)) {
-        LOG.debug("%s: formatting item GUID '%s' into json message",
-            __FUNCTION__, itemGuid);
-            
-        cJSON_AddStringToObject(data, "id", itemGuid);
-    }
-    
+    // validate all fields before emitting anything
     itemName = itemInfo->getName();
     if ((itemName == NULL) || (strlen(itemName) == 0)) {
         LOG.error("%s: missing name in item info", __FUNCTION__);
-        cJSON_Delete(root);
         
         return false;
     }
-        
-    cJSON_AddStringToObject(data, "name", itemName);
-    
-    itemContentType = itemInfo->getContentType();
-    if (itemContentType) {
-        cJSON_AddStringToObject(data, "contenttype", itemContentType);
-    }
    
     // if client requests an update only for meta data
     // don't send item size
     if (metaDataOnlyUpdate == false) {
         if ((itemSize = itemInfo->getSize()) == 0) {
             LOG.error("%s: invalid size parameter in item info", __FUNCTION__);
-            cJSON_Delete(root);
             
             return false;
         }
-        
-        cJSON_AddIntToObject(data, "size", itemSize);
     }
     
     itemCreationDate = itemInfo->getCreationDateSecs();
-    utcDate = unixTimeToString((unsigned long)itemCreationDate, true);
-    if (utcDate.empty()) {
+    creationDate = unixTimeToString((unsigned long)itemCreationDate, true);
+    if (creationDate.empty()) {
         LOG.error("%s: error convering item creation date in UTC string", __FUNCTION__);
         
-        cJSON_Delete(root);
-        
         return false;
     }
-    cJSON_AddStringToObject(data, "creationdate", utcDate.c_str());
-    //LOG.debug("%s: upload: creationdate = %li -> %s", __FUNCTION__, itemCreationDate, utcDate.c_str());
-    
+    //LOG.debug("%s: upload: creationdate = %li -> %s", __FUNCTION__, itemCreationDate, creationDate.c_str());
     
     itemModificationDate = itemInfo->getModificationDateSecs();
-    utcDate = unixTimeToString((unsigned long)itemModificationDate, true);
-    if (utcDate.empty()) {
+    modificationDate = unixTimeToString((unsigned long)itemModificationDate, true);
+    if (modificationDate.empty()) {
         LOG.error("%s: error converting item modification date in UTC string", __FUNCTION__);
         
-        cJSON_Delete(root);
-        
         return false;
     }
-    cJSON_AddStringToObject(data, "modificationdate", utcDate.c_str());
-    //LOG.debug("%s: upload: modificationdate = %li -> %s", __FUNCTION__, itemModificationDate, utcDate.c_str());
+    //LOG.debug("%s: upload: modificationdate = %li -> %s", __FUNCTION__, itemModificationDate, modificationDate.c_str());
     
+    JsonWriter writer(itemJsonMetaData, prettyPrint);
     
-    cJSON_AddItemToObject(root, "data", data);
+    writer.beginObject();
+    writer.beginObject("data");
     
-    if (prettyPrint) {
-        *itemJsonMetaData = cJSON_Print(root);
-    } else {
-        *itemJsonMetaData = cJSON_PrintUnformatted(root);
+    itemGuid = itemInfo->getGuid();
+    if ((itemGuid != NULL) && (strlen(itemGuid) > 0)) {
+        LOG.debug("%s: formatting item GUID '%s' into json message",
+            __FUNCTION__, itemGuid);
+            
+        writer.addString("id", itemGuid);
     }
+    
+    writer.addString("name", itemName);
+    
+    itemContentType = itemInfo->getContentType();
+    if (itemContentType) {
+        writer.addString("contenttype", itemContentType);
+    }
+    
+    if (metaDataOnlyUpdate == false) {
+        writer.addInt("size", itemSize);
+    }
+    
+    writer.addString("creationdate", creationDate.c_str());
+    writer.addString("modificationdate", modificationDate.c_str());
+    
+    writer.endObject();
+    writer.endObject();
    
-    cJSON_Delete(root);
-   
-    if ((*itemJsonMetaData == NULL) || (strlen(*itemJsonMetaData) == 0)) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
     
         return false;
@@ -590,24 +558,8 @@ bool MHMediaJsonParser::formatMediaItemMetaData(MHSyncItemInfo* itemInfo, char**
 }
 
 bool MHMediaJsonParser::formatJsonExportedItem(std::vector<ExportedItem*>& exportedItems,
-                                               char** exportedItemJson, bool prettyPrint)
+                                               StringBuffer& exportedItemJson, bool prettyPrint)
 {
-    cJSON *root = NULL, 
-          *data = NULL,
-          *itemIdArray = NULL,
-          *itemAttributes = NULL,
-          *itemPrivacyVal = NULL,
-          *itemNameVal = NULL,
-          *itemDescriptionVal = NULL,
-          *itemTitleVal = NULL,
-          *itemTagsArray = NULL,
-          *recipientsArray = NULL,
-          *itemNameObj = NULL,
-          *itemDescriptionObj = NULL,
-          *itemTitleObj = NULL,
-          *itemTagsArrayObj = NULL,
-          *itemIdObject = NULL;
-          
     const char *serviceName = NULL,
                *albumId     = NULL,
                *itemId       = NULL,
@@ -616,142 +568,89 @@ bool MHMediaJsonParser::formatJsonExportedItem(std::vector<ExportedItem*>& expor
                *itemDescription = NULL,
                *itemTitle = NULL;
                
-    int itemIdNum = 0, itemTagsNum = 0;
+    int itemIdNum = 0, itemTagsNum = 0, recipientsNum = 0;
     ArrayList itemTags, recipients;
    
-    *exportedItemJson = NULL;
-    
     if (exportedItems.size() == 0) {
         LOG.error("%s: invalid exported item argument", __FUNCTION__);
-        return ESMPInvalidArgument;
-    }
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
         return false;
     }
- 
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-
+    
     serviceName = exportedItems[0]->getServiceName();
     
     if ((serviceName == NULL) || (strlen(serviceName)== 0)) {
         LOG.error("%s: no service name set in exported item", __FUNCTION__);
-        cJSON_Delete(root);
             
         return false;
     }
     
-    cJSON_AddStringToObject(data, "servicename", serviceName);
-    
-    albumId = exportedItems[0]->getAlbumId();
-    if ((albumId != NULL) || (strlen(albumId) > 0)) {
-        cJSON_AddStringToObject(data, "albumid", albumId);
-    }
-    
-    // Create array with the GUIDs
-    itemIdArray = cJSON_CreateArray();
-    for(unsigned int i=0;i<exportedItems.size();++i) {
-        ExportedItem* exportedItem = exportedItems[i];
-        itemId = exportedItem->getItemGuid();
+    for (unsigned int i = 0; i < exportedItems.size(); ++i) {
+        itemId = exportedItems[i]->getItemGuid();
         if ((itemId == NULL) || (strlen(itemId) == 0))  {
             LOG.error("%s: missing item id in exported item", __FUNCTION__);
-            cJSON_Delete(root);
             
             return false;
         }
+    }
     
-        itemIdNum = atoi(itemId);
-        LOG.debug("%s: exporting item with GUID=%d", __FUNCTION__, itemIdNum);
+    JsonWriter writer(exportedItemJson, prettyPrint);
     
-        itemIdObject = cJSON_CreateInt(itemIdNum);
-        if (!itemIdArray || !itemIdObject) {
-            LOG.error("%s: error creating item id array", __FUNCTION__);
-            cJSON_Delete(root);
-            
-            return false;
-        }
-        cJSON_AddItemToArray(itemIdArray, itemIdObject);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.addString("servicename", serviceName);
+    
+    albumId = exportedItems[0]->getAlbumId();
+    if (albumId != NULL) {
+        writer.addString("albumid", albumId);
     }
     
-    cJSON_AddItemToObject(data, "items", itemIdArray);
+    // Create array with the GUIDs
+    writer.beginArray("items");
+    for (unsigned int i = 0; i < exportedItems.size(); ++i) {
+        itemIdNum = atoi(exportedItems[i]->getItemGuid());
+        LOG.debug("%s: exporting item with GUID=%d", __FUNCTION__, itemIdNum);
     
-    itemPrivacy = exportedItems[0]->getItemPrivacy();
-    itemPrivacyVal = cJSON_CreateString(itemPrivacy ? itemPrivacy : "");
-    if (itemPrivacyVal == NULL) {
-        LOG.error("%s: error creating item name json string object", 
-            __FUNCTION__);
-        cJSON_Delete(root);
-        cJSON_Delete(itemAttributes);
-        
-        return false;
+        writer.addInt(NULL, itemIdNum);
     }
- 
-    cJSON_AddItemToObject(data, "itemprivacy", itemPrivacyVal);
+    writer.endArray();
     
-    // item attributes array
-    itemAttributes = cJSON_CreateArray();
+    itemPrivacy = exportedItems[0]->getItemPrivacy();
+    writer.addString("itemprivacy", itemPrivacy ? itemPrivacy : "");
     
     // recipients array
     recipients = exportedItems[0]->getRecipients();
-    int recipientsNum = recipients.size();
+    recipientsNum = recipients.size();
     if (recipientsNum > 0) {
-        recipientsArray = cJSON_CreateArray();
+        writer.beginArray("recipients");
         for (int i = 0; i < recipientsNum; i++) {
             StringBuffer* recipient = (StringBuffer*)recipients.get(i);
-            cJSON* recipientVal = cJSON_CreateString(recipient ? recipient->c_str() : "");
-            cJSON_AddItemToArray(recipientsArray, recipientVal);
-            
-            cJSON* recipientObj = cJSON_CreateObject();
-            recipientVal = cJSON_CreateString(recipient ? recipient->c_str() : ""); 
-            cJSON_AddItemToObject(recipientObj, "recipient", recipientVal);        
-            cJSON_AddItemToArray(itemAttributes, recipientObj);
+            writer.addString(NULL, recipient ? recipient->c_str() : "");
         }
-        
-        cJSON_AddItemToObject(data, "recipients", recipientsArray);    
+        writer.endArray();
     }
     
-    itemName = exportedItems[0]->getItemName();
-    itemNameVal = cJSON_CreateString(itemName ? itemName : "");
-    if (itemNameVal == NULL) {
-        LOG.error("%s: error creating item name json string object", 
-            __FUNCTION__);
-        cJSON_Delete(root);
-        cJSON_Delete(itemAttributes);
-        
-        return false;
+    // item attributes array: recipients are repeated here as single objects
+    writer.beginArray("itemattributes");
+    for (int i = 0; i < recipientsNum; i++) {
+        StringBuffer* recipient = (StringBuffer*)recipients.get(i);
+        writer.beginObject();
+        writer.addString("recipient", recipient ? recipient->c_str() : "");
+        writer.endObject();
     }
     
-    itemNameObj = cJSON_CreateObject();
-    cJSON_AddItemToObject(itemNameObj, "name", itemNameVal);
-    cJSON_AddItemToArray(itemAttributes, itemNameObj);
+    itemName = exportedItems[0]->getItemName();
+    writer.beginObject();
+    writer.addString("name", itemName ? itemName : "");
+    writer.endObject();
     
     //
     // item title: only if NOT empty
     //
     itemTitle = exportedItems[0]->getItemTitle();
     if (itemTitle && strlen(itemTitle) > 0) {
-        itemTitleVal = cJSON_CreateString(itemTitle ? itemTitle : "");
-        
-        if (itemTitleVal == NULL) {
-            LOG.error("%s: error creating item title json string object", 
-                __FUNCTION__);
-            cJSON_Delete(root);
-            cJSON_Delete(itemAttributes);
-            
-            return false;
-        }
-        
-        itemTitleObj = cJSON_CreateObject();
-        
-        cJSON_AddItemToObject(itemTitleObj, "title", itemTitleVal);
-        cJSON_AddItemToArray(itemAttributes, itemTitleObj);
+        writer.beginObject();
+        writer.addString("title", itemTitle);
+        writer.endObject();
     }
     
     //
@@ -759,58 +658,36 @@ bool MHMediaJsonParser::formatJsonExportedItem(std::vector<ExportedItem*>& expor
     //
     itemDescription = exportedItems[0]->getItemDescription();
     if (itemDescription && strlen(itemDescription) > 0 ) {
-        itemDescriptionVal = cJSON_CreateString(itemDescription ? itemDescription : "");
-        
-        if (itemDescriptionVal == NULL) {
-            LOG.error("%s: error creating item description json string object", 
-                      __FUNCTION__);
-            cJSON_Delete(root);
-            cJSON_Delete(itemAttributes);
-            
-            return false;
-        }
-        
-        itemDescriptionObj = cJSON_CreateObject();
-        
         const char *descriptionAttributeKey = (strcmp(serviceName, "mms") == 0) ? "message" : "description";
-        cJSON_AddItemToObject(itemDescriptionObj, descriptionAttributeKey, itemDescriptionVal);
-        cJSON_AddItemToArray(itemAttributes, itemDescriptionObj);
+        
+        writer.beginObject();
+        writer.addString(descriptionAttributeKey, itemDescription);
+        writer.endObject();
     }
     
     itemTags = exportedItems[0]->getItemTags();
     itemTagsNum = itemTags.size();
     
-    itemTagsArray = cJSON_CreateArray();
+    writer.beginObject();
+    writer.beginArray("tags");
     for (int i = 0; i < itemTagsNum; i++) {
         StringBuffer* itemTag = (StringBuffer*)itemTags.get(i);
-        cJSON* itemTagVal = cJSON_CreateString(itemTag ? itemTag->c_str() : "");
- 
-        cJSON_AddItemToArray(itemTagsArray, itemTagVal);
+        writer.addString(NULL, itemTag ? itemTag->c_str() : "");
     }
-   
-    itemTagsArrayObj = cJSON_CreateObject();
-    
-    cJSON_AddItemToObject(itemTagsArrayObj, "tags", itemTagsArray);
-    cJSON_AddItemToArray(itemAttributes, itemTagsArrayObj);
+    writer.endArray();
+    writer.endObject();
     
-    cJSON_AddItemToObject(data, "itemattributes", itemAttributes);
-    cJSON_AddItemToObject(root, "data", data);
-    
-    if (prettyPrint) {
-        *exportedItemJson = cJSON_Print(root);
-    } else {
-        *exportedItemJson = cJSON_PrintUnformatted(root);
-    }
-   
-    cJSON_Delete(root);
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
    
-    if ((*exportedItemJson == NULL) || (strlen(*exportedItemJson) == 0)) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
     
     LOG.debug("%s: formatted JSON object for export request: %s", __FUNCTION__,
-        *exportedItemJson);
+        exportedItemJson.c_str());
         
     return true;
 }
@@ -2371,7 +2248,7 @@ bool MHMediaJsonParser::parseMediaSetResponse(const char* responseBody, StringBu
 }
 
 
-bool MHMediaJsonParser::formatStatusReport(SapiStatusReport* statusReport, char** statusReportJson){
+bool MHMediaJsonParser::formatStatusReport(SapiStatusReport* statusReport, StringBuffer& statusReportJson){
     /*
     { 
         "data": { 
@@ -2407,58 +2284,48 @@ bool MHMediaJsonParser::formatStatusReport(SapiStatusReport* statusReport, char*
         } 
     }
     */
-    std::vector<const SapiStatusReportActivity*> activities = statusReport->getActivities();
-    int itemsCount = activities.size();
-    
-    cJSON *root = NULL, *data = NULL, *act = NULL; 
-
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object", __FUNCTION__);
+    if (statusReport == NULL) {
+        LOG.error("%s: invalid status report argument", __FUNCTION__);
         return false;
     }
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'data'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    if ((act = cJSON_CreateArray()) == NULL) {
-        LOG.error("%s: error creating JSON object 'items'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    cJSON_AddStringToObject(data, "deviceid", statusReport->getDeviceID());
-    cJSON_AddIntToObject(data, "starttime", statusReport->getStartTime());
-    cJSON_AddIntToObject(data, "endtime", statusReport->getEndTime());
-    cJSON_AddIntToObject(data, "status", statusReport->getStatus());
-
     
+    const std::vector<const SapiStatusReportActivity*>& activities = statusReport->getActivities();
+    int itemsCount = activities.size();
+    
+    JsonWriter writer(statusReportJson, true);
+    
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.addString("deviceid", statusReport->getDeviceID());
+    writer.addInt("starttime", statusReport->getStartTime());
+    writer.addInt("endtime", statusReport->getEndTime());
+    writer.addInt("status", statusReport->getStatus());
+
+    writer.beginArray("activities");
     for (int i = 0; i < itemsCount; i++) {
-        cJSON* item;
-        
-        if ((item = cJSON_CreateObject()) == NULL) {
-            LOG.error("%s: error creating JSON object 'data'", __FUNCTION__);
-            cJSON_Delete(root);
-            return false;
-        }
-        
         const SapiStatusReportActivity* activity = activities.at(i);
         
-        cJSON_AddStringToObject(item, "activitytype", activity->getActivityType());
-        cJSON_AddStringToObject(item, "source", activity->getSource());
-        cJSON_AddIntToObject(item, "sent", activity->getSent());
-        cJSON_AddIntToObject(item, "received", activity->getReceived());
-        cJSON_AddItemToArray(act, item);
+        writer.beginObject();
+        writer.addString("activitytype", activity->getActivityType());
+        writer.addString("source", activity->getSource());
+        writer.addInt("sent", activity->getSent());
+        writer.addInt("received", activity->getReceived());
+        writer.endObject();
     }
+    writer.endArray();
     
-    cJSON_AddItemToObject(data, "activities", act);
-    cJSON_AddItemToObject(root, "data", data);
+    writer.endObject();
+    writer.endObject();
     
-    *statusReportJson = cJSON_Print(root);
+    if (!writer.isComplete()) {
+        LOG.error("%s: error formatting JSON object", __FUNCTION__);
+        return false;
+    }
     
     return true;
 }
 
-bool MHMediaJsonParser::formatPushDeviceToken(const char* deviceToken, char** deviceTokenJson) {
+bool MHMediaJsonParser::formatPushDeviceToken(const char* deviceToken, StringBuffer& deviceTokenJson) {
     /*
      {
         "data" : 
@@ -2467,32 +2334,21 @@ bool MHMediaJsonParser::formatPushDeviceToken(const char* deviceToken, char** de
             }
      }
      */
-    cJSON *root = NULL, *data = NULL;
+    JsonWriter writer(deviceTokenJson, true);
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object", __FUNCTION__);
-        return false;
-    }
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'data'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    cJSON_AddStringToObject(data, "token", deviceToken);
-    cJSON_AddItemToObject(root, "data", data);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.addString("token", deviceToken);
+    writer.endObject();
+    writer.endObject();
     
-    *deviceTokenJson = cJSON_Print(root);
-    
-    return true;
+    return writer.isComplete();
 }
 
-bool MHMediaJsonParser::formatMediaSetItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, 
+bool MHMediaJsonParser::formatMediaSetItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, 
                                                       const char* itemDescription, const char* sourceName, bool prettyPrint)
 {
-    cJSON *root = NULL, *items = NULL, *data = NULL, *set = NULL; 
-    int itemsCount = 0;
-    
-    if ((itemsCount = itemsIDs.size()) == 0) {
+    if (itemsIDs.size() == 0) {
         LOG.error("%s: no item IDs", __FUNCTION__);
         return false;
     }
@@ -2513,58 +2369,21 @@ bool MHMediaJsonParser::formatMediaSetItemsListObject(const ArrayList& itemsIDs,
     //    }
     //}
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object", __FUNCTION__);
-        return false;
-    }
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'data'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    if ((items = cJSON_CreateArray()) == NULL) {
-        LOG.error("%s: error creating JSON object 'items'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    if ((set = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'set'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    
-    //
-    // format the "set" object
-    //
-    cJSON_AddStringToObject(set, "description", itemDescription);
-    cJSON_AddStringToObject(set, "type", sourceName);
-
-    for (int i = 0; i < itemsCount; i++) {
-        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
-        
-        if ((itemIdStr) && (itemIdStr->empty() == false)) {
-            int itemId = atoi(itemIdStr->c_str());
-            cJSON* jsonItemId = cJSON_CreateInt((long)itemId);
-            
-            cJSON_AddItemToArray(items, jsonItemId);
-        }
-    }
-    cJSON_AddItemToObject(set, "items", items);
-
-    
-    cJSON_AddItemToObject(data, "set", set);
-    
-    cJSON_AddItemToObject(root, "data", data);
-    
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
-    
-    cJSON_Delete(root);
-    
-    if (*itemsListJsonObject == NULL) {
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
+    
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginObject("set");
+    writer.addString("description", itemDescription);
+    writer.addString("type", sourceName);
+    writer.beginArray("items");
+    writeItemIds(writer, itemsIDs);
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
+    writer.endObject();
+    
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -2572,11 +2391,9 @@ bool MHMediaJsonParser::formatMediaSetItemsListObject(const ArrayList& itemsIDs,
     return true;
 }
 
-bool MHMediaJsonParser::formatSaveSubscriptionObject(const char * itemsID, char **itemsListJsonObject, bool prettyPrint)
+bool MHMediaJsonParser::formatSaveSubscriptionObject(const char * itemsID, StringBuffer& itemsListJsonObject, bool prettyPrint)
 {
-    cJSON *root = NULL, *data = NULL, *subscription = NULL;
-    
-    if (strlen(itemsID) == 0) {
+    if ((itemsID == NULL) || (strlen(itemsID) == 0)) {
         LOG.error("%s: no item ID", __FUNCTION__);
         return false;
     }
@@ -2591,34 +2408,17 @@ bool MHMediaJsonParser::formatSaveSubscriptionObject(const char * itemsID, char
     //    }
     //}
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object", __FUNCTION__);
-        return false;
-    }
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'data'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    if ((subscription = cJSON_CreateObject()) == NULL) {
-        LOG.error("%s: error creating JSON object 'subscription'", __FUNCTION__);
-        cJSON_Delete(root);
-        return false;
-    }
-    
-    cJSON_AddStringToObject(subscription, "plan", itemsID);
-    cJSON_AddItemToObject(data, "subscription", subscription);
-    cJSON_AddItemToObject(root, "data", data);
-    
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    cJSON_Delete(root);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginObject("subscription");
+    writer.addString("plan", itemsID);
+    writer.endObject();
+    writer.endObject();
+    writer.endObject();
     
-    if (*itemsListJsonObject == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -2626,42 +2426,21 @@ bool MHMediaJsonParser::formatSaveSubscriptionObject(const char * itemsID, char
     return true;
 }
 
-bool MHMediaJsonParser::formatProfilePropertyKeyJson(const char *propertyKey, char **propertyKeyJson)
+bool MHMediaJsonParser::formatProfilePropertyKeyJson(const char *propertyKey, StringBuffer& propertyKeyJson)
 {
-    cJSON *root = NULL, *data = NULL, *properties = NULL;
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
+    JsonWriter writer(propertyKeyJson);
     
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((properties = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating Array object");
-        
-        return false;
-    }
-    
-    if (propertyKey)
-    {
-        cJSON* pKey = cJSON_CreateString(propertyKey);
-        cJSON_AddItemToArray(properties, pKey);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginArray("properties");
+    if (propertyKey) {
+        writer.addString(NULL, propertyKey);
     }
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
     
-    cJSON_AddItemToObject(data, "properties", properties);
-    cJSON_AddItemToObject(root, "data", data);
-    
-    *propertyKeyJson = cJSON_PrintUnformatted(root);
-    
-    cJSON_Delete(root);
-    
-    if (*propertyKeyJson == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -2669,56 +2448,26 @@ bool MHMediaJsonParser::formatProfilePropertyKeyJson(const char *propertyKey, ch
     return true;
 }
 
-bool MHMediaJsonParser::formatProfilePropertyJson(const char *propertyKey, const char *propertyValue, char **propertyJson)
+bool MHMediaJsonParser::formatProfilePropertyJson(const char *propertyKey, const char *propertyValue, StringBuffer& propertyJson)
 {
-    cJSON *root = NULL, *data = NULL, *properties = NULL, *prop = NULL;
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((properties = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating Array object");
-        
-        return false;
-    }
-    
-    if ((prop = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
+    JsonWriter writer(propertyJson);
     
-    if (propertyKey)
-    {
-        cJSON* pKey = cJSON_CreateString(propertyKey);
-        cJSON_AddItemToObject(prop, "name", pKey);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginArray("properties");
+    writer.beginObject();
+    if (propertyKey) {
+        writer.addString("name", propertyKey);
     }
-    
-    if (propertyValue)
-    {
-        cJSON* pValue = cJSON_CreateString(propertyValue);
-        cJSON_AddItemToObject(prop, "value", pValue);
+    if (propertyValue) {
+        writer.addString("value", propertyValue);
     }
+    writer.endObject();
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
     
-    
-    cJSON_AddItemToArray(properties, prop);
-    cJSON_AddItemToObject(data, "properties", properties);
-    cJSON_AddItemToObject(root, "data", data);
-    
-    *propertyJson = cJSON_PrintUnformatted(root);
-    
-    cJSON_Delete(root);
-    
-    if (*propertyJson == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -2726,61 +2475,33 @@ bool MHMediaJsonParser::formatProfilePropertyJson(const char *propertyKey, const
     return true;
 }
 
-bool MHMediaJsonParser::formatUserProfileJson(SapiUserProfile &userProfile, char **userProfileJson)
+bool MHMediaJsonParser::formatUserProfileJson(SapiUserProfile &userProfile, StringBuffer& userProfileJson)
 {
-    cJSON *root = NULL, *data = NULL, *user = NULL, *generic = NULL;
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((user = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
+    JsonWriter writer(userProfileJson);
     
-    if ((generic = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginObject("user");
+    writer.beginObject("generic");
     
-    if (userProfile.getFirstname())
-    {
-        cJSON* firstname = cJSON_CreateString(userProfile.getFirstname());
-        cJSON_AddItemToObject(generic, "firstname", firstname);
+    if (userProfile.getFirstname()) {
+        writer.addString("firstname", userProfile.getFirstname());
     }
     
-    if (userProfile.getLastname())
-    {
-        cJSON* lastname = cJSON_CreateString(userProfile.getLastname());
-        cJSON_AddItemToObject(generic, "lastname", lastname);
+    if (userProfile.getLastname()) {
+        writer.addString("lastname", userProfile.getLastname());
     }
     
-    if (userProfile.getUseremail())
-    {
-        cJSON* useremail = cJSON_CreateString(userProfile.getUseremail().c_str());
-        cJSON_AddItemToObject(generic, "useremail", useremail);
+    if (userProfile.getUseremail()) {
+        writer.addString("useremail", userProfile.getUseremail().c_str());
     }
     
-    cJSON_AddItemToObject(user, "generic", generic);
-    cJSON_AddItemToObject(data, "user", user);
-    cJSON_AddItemToObject(root, "data", data);
+    writer.endObject();
+    writer.endObject();
+    writer.endObject();
+    writer.endObject();
     
-    *userProfileJson = cJSON_PrintUnformatted(root);
-    
-    cJSON_Delete(root);
-    
-    if (*userProfileJson == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -2788,59 +2509,24 @@ bool MHMediaJsonParser::formatUserProfileJson(SapiUserProfile &userProfile, char
     return true;
 }
 
-bool MHMediaJsonParser::formatDelItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, 
+bool MHMediaJsonParser::formatDelItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, 
                                                    const char* sourceName, bool prettyPrint)
 {
-    cJSON *root = NULL, *ids = NULL, *data = NULL; 
-    int itemsCount = 0;
-    
-    if ((itemsCount = itemsIDs.size()) == 0) {
-        return false;
-    }
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-    
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
+    if (itemsIDs.size() == 0) {
         return false;
     }
     
-    if ((ids = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    for (int i = 0; i < itemsCount; i++) {
-        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
-        
-        if ((itemIdStr) && (itemIdStr->empty() == false)) {
-            int itemId = atoi(itemIdStr->c_str());
-            cJSON* jsonItemId = cJSON_CreateInt((long)itemId);
-            
-            cJSON_AddItemToArray(ids, jsonItemId);
-        }
-    }
-    
-    cJSON_AddItemToObject(data, sourceName, ids);
-    
-    cJSON_AddItemToObject(root, "data", data);
-    
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
-    
-    cJSON_Delete(root);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginArray(sourceName);
+    writeItemIds(writer, itemsIDs);
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
     
-    if (*itemsListJsonObject == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
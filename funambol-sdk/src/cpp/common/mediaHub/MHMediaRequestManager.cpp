@@ -45,6 +45,7 @@
 #include "ioStream/StringOutputStream.h"
 #include "ioStream/BufferOutputStream.h"
 #include "event/FireEvent.h"
+#include "base/util/JsonWriter.h"
 
 BEGIN_FUNAMBOL_NAMESPACE
 
@@ -56,7 +57,12 @@ StringBuffer MHMediaRequestManager::sessionID;
 StringBuffer MHMediaRequestManager::validationKey;
 bool MHMediaRequestManager::validateRequest = true;     // if true, adds the validation key in all SAPI requests URL
 pthread_mutex_t MHMediaRequestManager::sessionIDAccessMutex;
+pthread_cond_t  MHMediaRequestManager::loginCompleted;
 bool MHMediaRequestManager::sessionIDAccessMutexInitialized = false;
+MHMediaRequestManager::SessionSnapshot* MHMediaRequestManager::currentSession = NULL;
+unsigned long MHMediaRequestManager::sessionVersion = 0;
+bool MHMediaRequestManager::loginInProgress = false;
+EMHMediaRequestStatus MHMediaRequestManager::lastLoginStatus = ESMRSuccess;
 
 // static data for sapi media request URLs
 static const char* getLastSyncUriFmt  = "%s/sapi/profile?action=get-last-sync";
@@ -167,6 +173,7 @@ MHMediaRequestManager::MHMediaRequestManager(const char* url,
 {
     if (!sessionIDAccessMutexInitialized) {
         pthread_mutex_init(&sessionIDAccessMutex, NULL);
+        pthread_cond_init(&loginCompleted, NULL);
         sessionIDAccessMutexInitialized = true;
     }
     
@@ -195,6 +202,7 @@ MHMediaRequestManager::MHMediaRequestManager(const char* url, AbstractSyncConfig
 {
     if (!sessionIDAccessMutexInitialized) {
         pthread_mutex_init(&sessionIDAccessMutex, NULL);
+        pthread_cond_init(&loginCompleted, NULL);
         sessionIDAccessMutexInitialized = true;
     }
     
@@ -476,7 +484,7 @@ EMHMediaRequestStatus MHMediaRequestManager::exportItemToExternalService(std::ve
     ESMPStatus parserStatus;
     const char *sourceName = sourceUri,
                *exportedItemJsonResponse = NULL;
-    char* exportedItemJson = NULL;
+    StringBuffer exportedItemJson;
     
     if (exportedItems.size() == 0) {
         LOG.error("invalid argument for export item request");
@@ -487,13 +495,13 @@ EMHMediaRequestStatus MHMediaRequestManager::exportItemToExternalService(std::ve
     exportItemRequestUrl.sprintf(exportItemFmt, serverUrl.c_str(), sourceName);
     requestUrl.setURL(exportItemRequestUrl);
 
-    if (jsonMHMediaObjectParser->formatJsonExportedItem(exportedItems, &exportedItemJson) == false) {
+    if (jsonMHMediaObjectParser->formatJsonExportedItem(exportedItems, exportedItemJson) == false) {
         LOG.error("error formatting exported item to json message");
         
         return ESMRMHMessageParseError;
     }
 
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, exportedItemJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, exportedItemJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending export item request: %d", __FUNCTION__, status);
         
         // Handle special status here if needed
@@ -634,7 +642,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsFromId(CacheItemsList& item
     int status = 0;
     StringBuffer itemsListRequestUrl;
     URL requestUrl;
-    char* itemsIdsListJsonObject;     // formatted JSON object with items ids
+    StringBuffer itemsIdsListJsonObject;     // formatted JSON object with items ids
     char* itemsIdsListEncoded = NULL; // urlencoded formatted JSON object with items ids
     const char* itemsListJsonObject = NULL;  // sapi reponse with list of items info JSON objects  
     StringOutputStream response;
@@ -655,20 +663,18 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsFromId(CacheItemsList& item
         StringBuffer* itemGuid = (StringBuffer*)itemsIDs.get(0);
         itemsListRequestUrl.sprintf(getUriWithIdsFmt, serverUrl.c_str(), mhMediaSourceName, itemGuid->c_str(), orderField);
     } else {
-        if (jsonMHMediaObjectParser->formatItemsListObject(itemsIDs, &itemsIdsListJsonObject) == false) {
+        if (jsonMHMediaObjectParser->formatItemsListObject(itemsIDs, itemsIdsListJsonObject) == false) {
             LOG.error("%s: error formatting json object for items list", __FUNCTION__);
             return ESMRInvalidParam;
         }
     
-        if ((itemsIdsListEncoded = URL::urlEncode(itemsIdsListJsonObject)) == NULL) {
+        if ((itemsIdsListEncoded = URL::urlEncode(itemsIdsListJsonObject.c_str())) == NULL) {
             LOG.error("%s: error url encoding formatted json object with items list", __FUNCTION__);
-            free(itemsIdsListJsonObject);
             return ESMRInvalidParam;
         }
         
         itemsListRequestUrl.sprintf(getUriWithIdsFmt, serverUrl.c_str(), mhMediaSourceName, itemsIdsListEncoded, orderField);
     
-        free(itemsIdsListJsonObject);
         free(itemsIdsListEncoded);
     }
 
@@ -915,7 +921,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsChanges(ArrayList& newIDs,
 
 EMHMediaRequestStatus MHMediaRequestManager::uploadItemMetaData(UploadMHSyncItem* item, bool updateMetaDataOnly)
 {
-    char* itemJsonMetaData;
+    StringBuffer itemJsonMetaData;
     const char* itemMetaDataUploadJson = NULL;
     MHSyncItemInfo* itemInfo = NULL;
     StringBuffer itemId;
@@ -941,21 +947,19 @@ EMHMediaRequestStatus MHMediaRequestManager::uploadItemMetaData(UploadMHSyncItem
         return ESMRInvalidParam;
     }
     
-    if ((jsonMHMediaObjectParser->formatMediaItemMetaData(itemInfo, &itemJsonMetaData, updateMetaDataOnly)) == false) {
+    if ((jsonMHMediaObjectParser->formatMediaItemMetaData(itemInfo, itemJsonMetaData, updateMetaDataOnly)) == false) {
         LOG.error("%s: error formatting item meta data as json object", __FUNCTION__);
     
         return ESMRMHMessageFormatError;
     }
     
-    //LOG.debug("JSON request body to send:\n%s", itemJsonMetaData);
     itemMetaDataAddRequestUrl.sprintf(saveItemMetaDataFmt, serverUrl.c_str(), mhMediaSourceName);
     requestUrl.setURL(itemMetaDataAddRequestUrl);
 
-    LOG.debug("%s: Json request body to send: \n%s", __FUNCTION__, itemJsonMetaData);
+    LOG.debug("%s: Json request body to send: \n%s", __FUNCTION__, itemJsonMetaData.c_str());
      
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemJsonMetaData, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemJsonMetaData.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
-        free(itemJsonMetaData);
         
         // Handle special status here if needed
         if (status == HTTP_SERVER_ERROR) {
@@ -966,8 +970,6 @@ EMHMediaRequestStatus MHMediaRequestManager::uploadItemMetaData(UploadMHSyncItem
         }
     }
     
-    free(itemJsonMetaData);
-    
     if ((itemMetaDataUploadJson = response.getString().c_str()) == NULL) {
         LOG.error("%s: invalid empty response for sapi item metadata upload", __FUNCTION__);
         
@@ -1046,7 +1048,7 @@ EMHMediaRequestStatus MHMediaRequestManager::uploadItemMetaData(UploadMHSyncItem
 
 EMHMediaRequestStatus MHMediaRequestManager::updateFacebookToken(const char* token, const char* accountName, long expTime)
 {
-    char* itemJsonMetaData;
+    StringBuffer itemJsonMetaData;
     const char* responseJSON = NULL;
     StringBuffer itemMetaDataAddRequestUrl;
     URL requestUrl;
@@ -1059,34 +1061,24 @@ EMHMediaRequestStatus MHMediaRequestManager::updateFacebookToken(const char* tok
         return ESMRInvalidParam;
     }
     
-    cJSON *data = NULL;
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-    }
-    
-    cJSON_AddStringToObject (data, "token", token);
-    cJSON_AddFloatToObject  (data, "expiretime", (double)expTime*1000);
-    cJSON_AddStringToObject (data, "servicename", "facebook");
-    cJSON_AddStringToObject (data, "accountname", accountName);
+    JsonWriter writer(itemJsonMetaData, true);
     
-    cJSON *message = NULL;
-    
-    if ((message = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-    }
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.addString("token", token);
+    writer.addInt("expiretime", (int64_t)expTime * 1000);
+    writer.addString("servicename", "facebook");
+    writer.addString("accountname", accountName);
+    writer.endObject();
+    writer.endObject();
     
-    cJSON_AddItemReferenceToObject(message, "data", data);
-    
-    //LOG.debug("JSON request body to send:\n%s", cJSON_Print(data));
-    itemJsonMetaData = cJSON_Print(message);
     itemMetaDataAddRequestUrl.sprintf(saveFacebookToken, serverUrl.c_str(), mhMediaSourceName);
     requestUrl.setURL(itemMetaDataAddRequestUrl);
     
-    LOG.debug("%s: Json request body to send: \n%s", __FUNCTION__, itemJsonMetaData);
+    LOG.debug("%s: Json request body to send: \n%s", __FUNCTION__, itemJsonMetaData.c_str());
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemJsonMetaData, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemJsonMetaData.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
-        free(itemJsonMetaData);
         
         // Handle special status here if needed
         if (status == HTTP_SERVER_ERROR) {
@@ -1097,7 +1089,6 @@ EMHMediaRequestStatus MHMediaRequestManager::updateFacebookToken(const char* tok
         }
     }
     
-    free(itemJsonMetaData);
     
     if ((responseJSON = response.getString().c_str()) == NULL) {
         LOG.error("%s: invalid empty response for sapi item metadata upload", __FUNCTION__);
@@ -1785,7 +1776,7 @@ EMHMediaRequestStatus MHMediaRequestManager::purchaseSubscription(const char* su
     int status = 0;
     StringBuffer purchaseSubscriptionUrl;
     URL requestUrl;
-    char* requestBody = NULL;                   // formatted JSON object with items ids
+    StringBuffer requestBody;                   // formatted JSON object with items ids
     const char* purchaseSubscriptionJson = NULL; // JSON object from server
     StringOutputStream response;
     //ESMPStatus parserStatus;
@@ -1796,21 +1787,18 @@ EMHMediaRequestStatus MHMediaRequestManager::purchaseSubscription(const char* su
     //
     // format the json body
     //
-    if (jsonMHMediaObjectParser->formatSaveSubscriptionObject(subscription, &requestBody, false) == false) {
+    if (jsonMHMediaObjectParser->formatSaveSubscriptionObject(subscription, requestBody, false) == false) {
         LOG.error("%s: error formatting json object", __FUNCTION__);
         return ESMRInvalidParam;
     }
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending sapi request", __FUNCTION__);
         
         // Handle special status here if needed
         EMHMediaRequestStatus res = handleHttpError(status);
-        
-        free(requestBody);
         return res;
     }
-    free(requestBody);
     
     if ((purchaseSubscriptionJson = response.getString().c_str()) == NULL) {
         // If there are no valid subscriptions, then we may receive an empty response (status 200)
@@ -1995,13 +1983,13 @@ EMHMediaRequestStatus MHMediaRequestManager::getProfileProperty(const char *prof
     int status = 0;
     StringBuffer getProfilePropertyRequestUrl;
     URL requestUrl;
-    char* profilePropertyKeyJson = NULL;           // JSON object to POST
+    StringBuffer profilePropertyKeyJson;           // JSON object to POST
     const char* getProfilePropertyJson = NULL;  // JSON object from server
     StringOutputStream response;
     ESMPStatus parserStatus;
     
     // Format json
-    if (jsonMHMediaObjectParser->formatProfilePropertyKeyJson(profilePropertyKey, &profilePropertyKeyJson) == false) {
+    if (jsonMHMediaObjectParser->formatProfilePropertyKeyJson(profilePropertyKey, profilePropertyKeyJson) == false) {
         LOG.error("%s: error formatting json object for profile profile key", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2010,7 +1998,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getProfileProperty(const char *prof
     getProfilePropertyRequestUrl.sprintf(getProfilePropertyUrl, serverUrl.c_str());
     requestUrl.setURL(getProfilePropertyRequestUrl);
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, profilePropertyKeyJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, profilePropertyKeyJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending sapi request", __FUNCTION__);
         
         // Handle special status here if needed
@@ -2076,12 +2064,12 @@ EMHMediaRequestStatus MHMediaRequestManager::updateProfileProperty(const char *p
     int status = 0;
     StringBuffer updateProfilePropertyRequestUrl;
     URL requestUrl;
-    char* profilePropertyJson = NULL; // JSON object to send
+    StringBuffer profilePropertyJson; // JSON object to send
     StringOutputStream response;
     //ESMPStatus parserStatus;
     
     // Format json
-    if (jsonMHMediaObjectParser->formatProfilePropertyJson(profilePropertyKey, profilePropertyValue, &profilePropertyJson) == false) {
+    if (jsonMHMediaObjectParser->formatProfilePropertyJson(profilePropertyKey, profilePropertyValue, profilePropertyJson) == false) {
         LOG.error("%s: error formatting json object for property", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2090,7 +2078,7 @@ EMHMediaRequestStatus MHMediaRequestManager::updateProfileProperty(const char *p
     updateProfilePropertyRequestUrl.sprintf(setProfilePropertyUrl, serverUrl.c_str());
     requestUrl.setURL(updateProfilePropertyRequestUrl);
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, profilePropertyJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, profilePropertyJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending sapi request", __FUNCTION__);
         
         // Handle special status here if needed
@@ -2098,8 +2086,6 @@ EMHMediaRequestStatus MHMediaRequestManager::updateProfileProperty(const char *p
         return res;
     }
     
-    free(profilePropertyJson);
-    
     return ESMRSuccess;
 }
 
@@ -2149,12 +2135,12 @@ EMHMediaRequestStatus MHMediaRequestManager::updateUserProfile(SapiUserProfile &
     int status = 0;
     StringBuffer getUserProfileRequestUrl;
     URL requestUrl;
-    char* userProfileJson = NULL; // JSON object from server
+    StringBuffer userProfileJson; // JSON object to send
     StringOutputStream response;
     //ESMPStatus parserStatus;
     
     // Format json
-    if (jsonMHMediaObjectParser->formatUserProfileJson(userProfile, &userProfileJson) == false) {
+    if (jsonMHMediaObjectParser->formatUserProfileJson(userProfile, userProfileJson) == false) {
         LOG.error("%s: error formatting json object for user profile", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2164,7 +2150,7 @@ EMHMediaRequestStatus MHMediaRequestManager::updateUserProfile(SapiUserProfile &
     requestUrl.setURL(getUserProfileRequestUrl);
     
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, userProfileJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, userProfileJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending sapi request", __FUNCTION__);
         
         // Handle special status here if needed
@@ -2172,8 +2158,6 @@ EMHMediaRequestStatus MHMediaRequestManager::updateUserProfile(SapiUserProfile &
         return res;
     }
     
-    free(userProfileJson);
-    
     return ESMRSuccess;
 }
 
@@ -2193,12 +2177,12 @@ EMHMediaRequestStatus MHMediaRequestManager::login(time_t* serverTime)
 EMHMediaRequestStatus MHMediaRequestManager::sendStatuReport(SapiStatusReport* statusReport){
     int status = 0;
     StringBuffer statusReportUrl;
-    char* statusReportJson;     // formatted JSON object with Status Report    
+    StringBuffer statusReportJson;     // formatted JSON object with Status Report    
     URL requestUrl;
     StringOutputStream response;
     
     
-    if (jsonMHMediaObjectParser->formatStatusReport(statusReport, &statusReportJson) == false) {
+    if (jsonMHMediaObjectParser->formatStatusReport(statusReport, statusReportJson) == false) {
         LOG.error("%s: error formatting json object for items list", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2209,17 +2193,14 @@ EMHMediaRequestStatus MHMediaRequestManager::sendStatuReport(SapiStatusReport* s
     requestUrl.setURL(statusReportUrl);
     httpConnection->setRequestHeader(HTTP_HEADER_CONTENT_TYPE, "application/json");
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, statusReportJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, statusReportJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
-        free(statusReportJson);
         
         // Handle special status here if needed
         EMHMediaRequestStatus res = handleHttpError(status);
         return res;
     }
     
-    free(statusReportJson);
-    
     const char* result = NULL;
     
     if ((result = response.getString().c_str()) == NULL) {
@@ -2287,11 +2268,11 @@ EMHMediaRequestStatus MHMediaRequestManager::registerPushDeviceToken(const char*
 {
     int status = 0;
     StringBuffer registerPushDeviceTokenUrl;
-    char* deviceTokenJson;     // formatted JSON object with Device Token
+    StringBuffer deviceTokenJson;     // formatted JSON object with Device Token
     URL requestUrl;
     StringOutputStream response;
     
-    if (jsonMHMediaObjectParser->formatPushDeviceToken(deviceToken, &deviceTokenJson) == false) {
+    if (jsonMHMediaObjectParser->formatPushDeviceToken(deviceToken, deviceTokenJson) == false) {
         LOG.error("%s: error formatting json object for device token", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2305,17 +2286,14 @@ EMHMediaRequestStatus MHMediaRequestManager::registerPushDeviceToken(const char*
     
     httpConnection->setRequestHeader(HTTP_HEADER_CONTENT_TYPE, "application/json");
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, deviceTokenJson, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, deviceTokenJson.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending sapi request", __FUNCTION__);
         
-        free(deviceTokenJson);
         // Handle special status here if needed
         EMHMediaRequestStatus res = handleHttpError(status);
         return res;
     }
     
-    free(deviceTokenJson);
-    
     const char* result = NULL;
     
     if ((result = response.getString().c_str()) == NULL) {
@@ -2380,8 +2358,7 @@ EMHMediaRequestStatus MHMediaRequestManager::logout()
         return ESMRMHInvalidResponse;
     }
     
-    config->setSessionId("");
-    config->setSessionIdSetTime(0);
+    saveSession("", NULL);
   
     LOG.debug("response returned = %s", MHLogoutResponse);
     
@@ -2391,18 +2368,189 @@ EMHMediaRequestStatus MHMediaRequestManager::logout()
 
 void MHMediaRequestManager::setRequestSessionId()
 {
-    if (httpConnection) {
-        if (!sessionID.empty()) {
-            // If another thread is performing the login, we shall wait for it to complete
-            pthread_mutex_lock(&sessionIDAccessMutex);
+    SessionSnapshot* session = acquireSession();
+    setRequestSessionId(session);
+    releaseSession(session);
+}
 
-            StringBuffer sessionIdCookie;
-            sessionIdCookie.sprintf("JSESSIONID=%s", sessionID.c_str());
-            httpConnection->setRequestHeader(HTTP_HEADER_COOKIE, sessionIdCookie.c_str());
+void MHMediaRequestManager::setRequestSessionId(const SessionSnapshot* session)
+{
+    if (httpConnection && isSessionUsable(session)) {
+        StringBuffer sessionIdCookie;
+        sessionIdCookie.sprintf("JSESSIONID=%s", session->sessionID.c_str());
+        httpConnection->setRequestHeader(HTTP_HEADER_COOKIE, sessionIdCookie.c_str());
+    }
+}
 
+MHMediaRequestManager::SessionSnapshot* MHMediaRequestManager::acquireSession()
+{
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    
+    if (currentSession == NULL) {
+        // first use: start from the session saved in config
+        StringBuffer configSessionId = config->getSessionId();
+        StringBuffer configValidationKey = config->getValidationKey();
+        time_t expirationTime = config->getSessionIdSetTime() + config->getSessionIdExpirationTime();
+        
+        publishSession(configSessionId.c_str(), configValidationKey.c_str(), expirationTime);
+    }
+    
+    SessionSnapshot* session = currentSession;
+    session->refCount++;
+    
+    pthread_mutex_unlock(&sessionIDAccessMutex);
+    
+    return session;
+}
+
+void MHMediaRequestManager::releaseSession(SessionSnapshot* session)
+{
+    if (session == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    bool unused = (--session->refCount == 0);
+    pthread_mutex_unlock(&sessionIDAccessMutex);
+    
+    if (unused) {
+        delete session;
+    }
+}
+
+void MHMediaRequestManager::publishSession(const char* sessionId, const char* key, time_t expirationTime)
+{
+    SessionSnapshot* session = new SessionSnapshot();
+    session->sessionID = sessionId ? sessionId : "";
+    session->validationKey = key ? key : "";
+    session->expirationTime = expirationTime;
+    session->version = ++sessionVersion;
+    session->refCount = 1;          // the reference held by currentSession
+    
+    SessionSnapshot* previous = currentSession;
+    currentSession = session;
+    
+    // the previous snapshot is deleted by its last user, if still in use
+    if (previous && (--previous->refCount == 0)) {
+        delete previous;
+    }
+}
+
+void MHMediaRequestManager::saveSession(const char* sessionId, const char* key)
+{
+    bool open = (sessionId != NULL) && (strlen(sessionId) > 0);
+    time_t setTime = open ? time(NULL) : 0;
+    
+    config->setSessionId(open ? sessionId : "");
+    config->setSessionIdSetTime(setTime);
+    if (key) {
+        config->setValidationKey(key);      // will be encrypted
+    }
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    if (open) {
+        publishSession(sessionId, key ? key : "", setTime + config->getSessionIdExpirationTime());
+    } else {
+        publishSession("", "", 0);
+    }
+    pthread_mutex_unlock(&sessionIDAccessMutex);
+}
+
+bool MHMediaRequestManager::isSessionUsable(const SessionSnapshot* session)
+{
+    if ((session == NULL) || session->sessionID.empty()) {
+        return false;
+    }
+    
+    // the request will cause a 401 and a relogin
+    if (session->expirationTime <= time(NULL)) {
+        LOG.info("Session expired: not using SessionID & validation key");
+        return false;
+    }
+    if (validateRequest && session->validationKey.empty()) {
+        LOG.info("Validation required but validation key is empty: not using SessionID");
+        return false;
+    }
+    
+    return true;
+}
+
+EMHMediaRequestStatus MHMediaRequestManager::singleFlightLogin(unsigned long failedVersion, time_t* serverTime)
+{
+    EMHMediaRequestStatus status = ESMRSuccess;
+    bool waited = false;
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    
+    while (loginInProgress) {
+        waited = true;
+        pthread_cond_wait(&loginCompleted, &sessionIDAccessMutex);
+    }
+    
+    if (failedVersion != 0) {
+        if (waited) {
+            // another thread just logged in: share its result
+            status = lastLoginStatus;
             pthread_mutex_unlock(&sessionIDAccessMutex);
+            return status;
         }
+        if (currentSession && (currentSession->version != failedVersion) && isSessionUsable(currentSession)) {
+            // someone else has already performed a login
+            pthread_mutex_unlock(&sessionIDAccessMutex);
+            return ESMRSuccess;
+        }
+    }
+    
+    loginInProgress = true;
+    if (currentSession) {
+        sessionID     = currentSession->sessionID;
+        validationKey = currentSession->validationKey;
+    }
+    pthread_mutex_unlock(&sessionIDAccessMutex);
+    
+    LOG.debug("%s: performing login", __FUNCTION__);
+    time_t loginServerTime = 0;
+    unsigned long expireTime = 0;
+    status = login(deviceID, serverTime ? serverTime : &loginServerTime, &expireTime, NULL, NULL);
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    if (status == ESMRSuccess) {
+        time_t expirationTime = config->getSessionIdSetTime() + config->getSessionIdExpirationTime();
+        publishSession(sessionID.c_str(), validationKey.c_str(), expirationTime);
+    } else {
+        sessionID.reset();
+        publishSession("", currentSession ? currentSession->validationKey.c_str() : "", 0);
     }
+    lastLoginStatus = status;
+    loginInProgress = false;
+    pthread_cond_broadcast(&loginCompleted);
+    pthread_mutex_unlock(&sessionIDAccessMutex);
+    
+    return status;
+}
+
+StringBuffer MHMediaRequestManager::getSessionID()
+{
+    SessionSnapshot* session = acquireSession();
+    StringBuffer id(session->sessionID);
+    releaseSession(session);
+    
+    return id;
+}
+
+void MHMediaRequestManager::resetSessionID()
+{
+    if (!sessionIDAccessMutexInitialized) {
+        sessionID.reset();
+        return;
+    }
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    sessionID.reset();
+    if (currentSession) {
+        publishSession("", currentSession->validationKey.c_str(), 0);
+    }
+    pthread_mutex_unlock(&sessionIDAccessMutex);
 }
 
 void MHMediaRequestManager::setRequestAuthentication()
@@ -2412,10 +2560,20 @@ void MHMediaRequestManager::setRequestAuthentication()
 }
 
 bool MHMediaRequestManager::addValidationKey(URL& url, const bool logOriginalRequest)
+{
+    SessionSnapshot* session = acquireSession();
+    bool ret = addValidationKey(url, session, logOriginalRequest);
+    releaseSession(session);
+    
+    return ret;
+}
+
+bool MHMediaRequestManager::addValidationKey(URL& url, const SessionSnapshot* session, const bool logOriginalRequest)
 {
     if (!validateRequest) {
         return false;
     }
+    const StringBuffer& validationKey = session->validationKey;
     if (validationKey.empty()) {
         LOG.debug("[%s] not using validation key: empty key", __FUNCTION__);
         return false;
@@ -2441,8 +2599,14 @@ void MHMediaRequestManager::resetValidationKey()
 {
     LOG.debug("[%s] resetting validation key", __FUNCTION__);
 
-    validationKey = "";
     config->setValidationKey("");
+    
+    pthread_mutex_lock(&sessionIDAccessMutex);
+    validationKey = "";
+    if (currentSession) {
+        publishSession(currentSession->sessionID.c_str(), "", currentSession->expirationTime);
+    }
+    pthread_mutex_unlock(&sessionIDAccessMutex);
 }
 
 void MHMediaRequestManager::setRequestTimeout(const int timeout) {
@@ -2464,7 +2628,12 @@ void MHMediaRequestManager::setDownloadChunkSize(const int size) {
 void MHMediaRequestManager::setSessionID(const char* sessionId)
 {
     if ((sessionId != NULL) && (strlen(sessionId) > 0)) {
+        pthread_mutex_lock(&sessionIDAccessMutex);
         sessionID = sessionId;
+        if (currentSession) {
+            publishSession(sessionId, currentSession->validationKey.c_str(), currentSession->expirationTime);
+        }
+        pthread_mutex_unlock(&sessionIDAccessMutex);
     }
 }
 
@@ -2558,7 +2727,7 @@ EMHMediaRequestStatus MHMediaRequestManager::deleteItem(const char* itemId)
 {
     int status = 0;
     StringBuffer itemsListRequestUrl;
-    char* itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
+    StringBuffer itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
     URL requestUrl;
     StringOutputStream response;
     
@@ -2581,7 +2750,7 @@ EMHMediaRequestStatus MHMediaRequestManager::deleteItem(const char* itemId)
     ArrayList itemsIDs; 
     itemsIDs.add(s);
     
-    if (jsonMHMediaObjectParser->formatDelItemsListObject(itemsIDs, &itemsIdsListJsonObject, itemsArrayKey, true) == false) {
+    if (jsonMHMediaObjectParser->formatDelItemsListObject(itemsIDs, itemsIdsListJsonObject, itemsArrayKey, true) == false) {
         LOG.error("%s: error formatting json object for items list", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -2592,17 +2761,14 @@ EMHMediaRequestStatus MHMediaRequestManager::deleteItem(const char* itemId)
     requestUrl.setURL(itemsListRequestUrl);
     httpConnection->setRequestHeader(HTTP_HEADER_CONTENT_TYPE, "application/json");
     
-    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemsIdsListJsonObject, response)) != HTTP_OK) {
+    if ((status = performRequest(requestUrl, HttpConnection::MethodPost, itemsIdsListJsonObject.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
-        free(itemsIdsListJsonObject);
         
         // Handle special status here if needed
         EMHMediaRequestStatus res = handleHttpError(status);
         return res;
     }
     
-    free(itemsIdsListJsonObject);
-    
     const char* result = NULL;
     
     if ((result = response.getString().c_str()) == NULL) {
@@ -2673,7 +2839,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsMediaSet(URL& mediaSetUrl,
     int status = 0;
     StringBuffer itemsListRequestUrl;
     URL requestUrl;
-    char* requestBody = NULL;                   // formatted JSON object with items ids
+    StringBuffer requestBody;                   // formatted JSON object with items ids
     const char* responseBody = NULL;            // sapi reponse with the url of the media set  
     StringOutputStream response;
     ESMPStatus parserStatus;
@@ -2692,7 +2858,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsMediaSet(URL& mediaSetUrl,
     //
     // format the json body
     //
-    if (jsonMHMediaObjectParser->formatMediaSetItemsListObject(itemsIDs, &requestBody, 
+    if (jsonMHMediaObjectParser->formatMediaSetItemsListObject(itemsIDs, requestBody, 
                                                                description, sourceName) == false) {
         LOG.error("%s: error formatting json object", __FUNCTION__);
         return ESMRInvalidParam;
@@ -2704,8 +2870,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getItemsMediaSet(URL& mediaSetUrl,
     itemsListRequestUrl.sprintf(getMediaSetFmt, serverUrl.c_str());
     requestUrl.setURL(itemsListRequestUrl);
     
-    status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody, response);
-    free(requestBody);
+    status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody.c_str(), response);
     
     if (status != HTTP_OK) {
         LOG.error("%s: error sending sapi create-media-set request", __FUNCTION__);
@@ -2788,15 +2953,13 @@ EMHMediaRequestStatus MHMediaRequestManager::getRemoteLabels(const char*type, st
     StringOutputStream response;
     ESMPStatus parserStatus;
     
-    cJSON *body= NULL;
-    if ((body= cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-    }
-
-    cJSON* emptyData = cJSON_CreateObject();
-    cJSON_AddItemToObject(body, "data", emptyData);
+    StringBuffer requestBody;
+    JsonWriter writer(requestBody, true);
     
-    char* requestBody = cJSON_Print(body);
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.endObject();
+    writer.endObject();
     
     //
     // Send the http request
@@ -2807,9 +2970,7 @@ EMHMediaRequestStatus MHMediaRequestManager::getRemoteLabels(const char*type, st
     }
     requestUrl.setURL(getLabelsRequestUrl);
     
-    status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody, response);
-    free(requestBody);
-    cJSON_Delete(body);
+    status = performRequest(requestUrl, HttpConnection::MethodPost, requestBody.c_str(), response);
     
     if (status != HTTP_OK) {
         LOG.error("%s: error sending get labels request", __FUNCTION__);
@@ -2965,48 +3126,23 @@ EMHMediaRequestStatus MHMediaRequestManager::getServerInfo(ServerInfo& serverInf
 
 
 int MHMediaRequestManager::performRequest(const URL& url, HttpConnection::RequestMethod method,
-                                          char* body, OutputStream& response, bool logRequest, bool useAuthentication) {
+                                          const char* body, OutputStream& response, bool logRequest, bool useAuthentication) {
     return performRequest(url, method, body, NULL, response, logRequest, useAuthentication);
 }
 
 int MHMediaRequestManager::performRequest(const URL& url, HttpConnection::RequestMethod method,
-                                          char* body, InputStream* bodyStream,
+                                          const char* body, InputStream* bodyStream,
                                           OutputStream& response, bool logRequest, bool useAuthentication) {
     int httpStatus;
     
     lastHttpResponseHeaders.clear();
     
-    pthread_mutex_lock(&sessionIDAccessMutex);
-    StringBuffer configSessionId = config->getSessionId();
-    validationKey = config->getValidationKey();
-    
-    // reset SessionID if expirationTime elapsed (will cause a 401 and relogin)
-    if (!configSessionId.empty()) {
-        time_t now = time(NULL);
-        time_t sessionIdSavedTime = config->getSessionIdSetTime();
-        time_t sessionIdExpirationTime = config->getSessionIdExpirationTime();
-        
-        if ((sessionIdSavedTime + sessionIdExpirationTime) > now) {
-            sessionID = configSessionId.c_str();
-        } else {
-            LOG.info("%d hours elapsed: resetting SessionID & validation key", (int)(sessionIdExpirationTime/3600));
-            sessionID.reset();
-            validationKey.reset();
-        }
-    }
-
-    // reset SessionID if validation required and validation key is missing (will cause a 401 and relogin)
-    if (validateRequest && validationKey.empty()) {
-        LOG.info("Validation required but validation key is empty: resetting SessionID");
-        sessionID.reset();
-    }
-
-    
-    // Save the sessionID being used for this request
-    StringBuffer requestSessionId(sessionID.c_str());
-    pthread_mutex_unlock(&sessionIDAccessMutex);
+    // The session used by this request: an expired session or a missing validation
+    // key are not sent (will cause a 401 and relogin)
+    SessionSnapshot* session = acquireSession();
+    unsigned long requestSessionVersion = session->version;
     
-    setRequestSessionId();
+    setRequestSessionId(session);
     if (useAuthentication) {
         // not all requests require authentication (e.g. download item which is not a SAPI)
         setRequestAuthentication();
@@ -3018,9 +3154,10 @@ int MHMediaRequestManager::performRequest(const URL& url, HttpConnection::Reques
     const char* fullUrl = url.fullURL;
     URL requestUrl(fullUrl);
 
-    if (useAuthentication && addValidationKey(requestUrl, logRequest)) {
+    if (useAuthentication && addValidationKey(requestUrl, session, logRequest)) {
         logRequest = false;     // it contains the validation key from now on: don't want to log it
     }
+    releaseSession(session);
 
     if ((httpStatus = httpConnection->open(requestUrl, method, logRequest)) != 0) {
         LOG.error("%s: error opening connection", __FUNCTION__);
@@ -3048,42 +3185,26 @@ int MHMediaRequestManager::performRequest(const URL& url, HttpConnection::Reques
         // point and perform the request again
         httpConnection->close();
    
-        // Perform the login in a mutex section
-        pthread_mutex_lock(&sessionIDAccessMutex);
-        
-        LOG.debug("sessionID=%s",sessionID.c_str());
-        LOG.debug("requestSessionID=%s",requestSessionId.c_str());
-        
-        // We must make sure someone else has not already performed a login
-        if (sessionID.empty() || requestSessionId.icmp(sessionID)) {
-            time_t serverTime;
-            unsigned long expireTime;
-            status = login(deviceID, &serverTime, &expireTime, NULL, NULL);
-            if (status == ESMRSuccess) {
-                httpConnection->close();
-                //delete httpConnection;
-                //httpConnection = new HttpConnection(config->getUserAgent());
-            } else {
-                sessionID.reset();
-            }
-        } else {
-            status = ESMRSuccess;
-        }
-        pthread_mutex_unlock(&sessionIDAccessMutex);
+        // Only one thread logs in; the others wait for the new session
+        // (no login at all if someone else has already refreshed it)
+        status = singleFlightLogin(requestSessionVersion);
+        httpConnection->close();
         
         if (status == ESMRSuccess) {
             // If login is successfull, retry the request (restore backed-up headers)
 			httpConnection->setRequestHeaders(backupRequestHeaders);
-            setRequestSessionId();
+            session = acquireSession();
+            setRequestSessionId(session);
             if (useAuthentication) {
                 // not all requests require authentication (e.g. download item which is not a SAPI)
                 setRequestAuthentication();
             }
             httpConnection->setKeepAlive(false);
             requestUrl = fullUrl;
-            if (useAuthentication && addValidationKey(requestUrl, logRequest)) {
+            if (useAuthentication && addValidationKey(requestUrl, session, logRequest)) {
                 logRequest = false;     // it contains the validation key from now on: don't want to log it
             }
+            releaseSession(session);
                 
             if ((status = httpConnection->open(requestUrl, method, logRequest)) != 0) {
                 LOG.error("%s: error opening connection", __FUNCTION__);
@@ -0,0 +1,242 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#include "MediaHub/MHPagePrefetcher.h"
+#include "base/Log.h"
+#include "base/util/utils.h"
+
+/// How often a retry wait checks if the sync has been aborted (msec).
+#define MH_PREFETCH_ABORT_CHECK     200
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+MHPagePrefetcher::MHPagePrefetcher(MHMediaRequestManager* requestManager_, AbstractSyncConfig& config_,
+                                   int limit_, int maxPagesInFlight_) :
+                                   requestManager(requestManager_), config(config_),
+                                   limit(limit_), maxPagesInFlight(maxPagesInFlight_),
+                                   completed(false) {
+    
+    if (maxPagesInFlight < 1) {
+        maxPagesInFlight = 1;
+    }
+    pthread_mutex_init(&pagesMutex, NULL);
+    pthread_cond_init(&pagesCond, NULL);
+}
+
+MHPagePrefetcher::~MHPagePrefetcher() {
+    
+    std::deque<MHFetchedPage*>::iterator it = pages.begin();
+    for (; it != pages.end(); ++it) {
+        delete *it;
+    }
+    pages.clear();
+    
+    delete requestManager;
+    
+    pthread_cond_destroy(&pagesCond);
+    pthread_mutex_destroy(&pagesMutex);
+}
+
+void MHPagePrefetcher::softTerminate() {
+    
+    pthread_mutex_lock(&pagesMutex);
+    terminate = true;
+    pthread_cond_broadcast(&pagesCond);
+    pthread_mutex_unlock(&pagesMutex);
+}
+
+void MHPagePrefetcher::stop() {
+    
+    softTerminate();
+    wait();
+}
+
+MHFetchedPage* MHPagePrefetcher::nextPage() {
+    
+    MHFetchedPage* page = NULL;
+    
+    pthread_mutex_lock(&pagesMutex);
+    while (pages.empty() && !completed) {
+        pthread_cond_wait(&pagesCond, &pagesMutex);
+    }
+    if (!pages.empty()) {
+        page = pages.front();
+        pages.pop_front();
+        // a slot is free: wake up the fetcher
+        pthread_cond_broadcast(&pagesCond);
+    }
+    pthread_mutex_unlock(&pagesMutex);
+    
+    return page;
+}
+
+void MHPagePrefetcher::run() {
+    
+    int offset = 0;
+    
+    while (1) {
+        
+        // wait until there's room for a new page
+        pthread_mutex_lock(&pagesMutex);
+        while (!terminate && (int)pages.size() >= maxPagesInFlight) {
+            pthread_cond_wait(&pagesCond, &pagesMutex);
+        }
+        pthread_mutex_unlock(&pagesMutex);
+        
+        if (terminate || config.isToAbort()) {
+            break;
+        }
+        
+        LOG.debug("%s: prefetching items info in range: [%d - %d]", __FUNCTION__, offset, offset + limit);
+        
+        MHFetchedPage* page = new MHFetchedPage(offset);
+        fetchPage(page);
+        
+        // the page can be consumed as soon as it's queued: read it before
+        bool lastPage = (page->status != ESMRSuccess) || (page->itemsReceived < limit);
+        offset += page->itemsReceived;
+        
+        pthread_mutex_lock(&pagesMutex);
+        pages.push_back(page);
+        pthread_cond_broadcast(&pagesCond);
+        pthread_mutex_unlock(&pagesMutex);
+        
+        if (lastPage) {
+            break;
+        }
+    }
+    
+    pthread_mutex_lock(&pagesMutex);
+    completed = true;
+    pthread_cond_broadcast(&pagesCond);
+    pthread_mutex_unlock(&pagesMutex);
+}
+
+void MHPagePrefetcher::fetchPage(MHFetchedPage* page) {
+    
+    page->status = requestManager->getAllItems(page->items, page->labels,
+                                                &page->responseTime, limit, page->offset);
+    
+    if (page->status == ESMRNetworkError) {
+        int maxRetries = config.getMHMaxRetriesOnError();
+        
+        for (int attempt = 0; attempt < maxRetries; attempt++) {
+            if (terminate || config.isToAbort()) {
+                break;
+            }
+            
+            LOG.info("Retry getAllItems (%d of %d)...", attempt+1, maxRetries);
+            
+            long sleepMsec = config.getMHSleepTimeOnRetry();
+            if (sleepMsec) {
+                LOG.debug("sleep %li msec", sleepMsec);
+                if (!waitBeforeRetry(sleepMsec)) {
+                    break;
+                }
+            }
+            
+            page->items.clear();
+            page->labels.clear();
+            page->status = requestManager->getAllItems(page->items, page->labels,
+                                                        &page->responseTime, limit, page->offset);
+            if (page->status != ESMRNetworkError) {
+                break;      // all other errors
+            }
+        }
+    }
+    
+    page->receivedTime  = time(NULL);
+    page->itemsReceived = page->items.getItems().size();
+}
+
+bool MHPagePrefetcher::waitBeforeRetry(long msec) {
+    
+    pthread_mutex_lock(&pagesMutex);
+    
+    // pthread_cond_timedwait uses the realtime clock
+    struct timespec end;
+#ifdef WIN32
+    end.tv_sec  = time(NULL);
+    end.tv_nsec = 0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    end.tv_sec  = tv.tv_sec;
+    end.tv_nsec = tv.tv_usec * 1000;
+#endif
+    end.tv_sec  += (time_t)(msec / 1000);
+    end.tv_nsec += (msec % 1000) * 1000000;
+    if (end.tv_nsec >= 1000000000) {
+        end.tv_nsec -= 1000000000;
+        end.tv_sec++;
+    }
+    
+    // softTerminate() wakes us up; the abort of the sync is checked
+    // every MH_PREFETCH_ABORT_CHECK msec
+    while (!terminate && !config.isToAbort()) {
+        struct timespec t;
+#ifdef WIN32
+        t.tv_sec  = time(NULL);
+        t.tv_nsec = 0;
+#else
+        gettimeofday(&tv, NULL);
+        t.tv_sec  = tv.tv_sec;
+        t.tv_nsec = tv.tv_usec * 1000;
+#endif
+        if (t.tv_sec > end.tv_sec || (t.tv_sec == end.tv_sec && t.tv_nsec >= end.tv_nsec)) {
+            break;
+        }
+        t.tv_nsec += MH_PREFETCH_ABORT_CHECK * 1000000L;
+        if (t.tv_nsec >= 1000000000) {
+            t.tv_nsec -= 1000000000;
+            t.tv_sec++;
+        }
+        if (t.tv_sec > end.tv_sec || (t.tv_sec == end.tv_sec && t.tv_nsec > end.tv_nsec)) {
+            t = end;
+        }
+        pthread_cond_timedwait(&pagesCond, &pagesMutex, &t);
+    }
+    bool elapsed = !terminate && !config.isToAbort();
+    
+    pthread_mutex_unlock(&pagesMutex);
+    
+    return elapsed;
+}
+
+END_FUNAMBOL_NAMESPACE
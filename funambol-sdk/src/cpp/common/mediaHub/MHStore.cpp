@@ -163,13 +163,23 @@ bool MHStore::addEntries(std::vector<MHStoreEntry*>& entries, std::vector<uint64
         return false;
     }
     
-    bool res = true;
-    
-    std::vector<MHStoreEntry*>::iterator it = entries.begin();
     pthread_mutex_lock(&store_access_mutex);
     cache_items_count = getCount();
     // We execute everything inside a transaction to improve performance
-    sqlite3_exec(db, "BEGIN", 0, 0, 0);
+    bool ownTransaction = beginBulkTransaction();
+    bool res = insert_entries(entries, entriesId);
+    endBulkTransaction(ownTransaction);
+    pthread_mutex_unlock(&store_access_mutex);
+    return res;
+}
+
+// private
+bool MHStore::insert_entries(std::vector<MHStoreEntry*>& entries, std::vector<uint64_t>& entriesId) {
+    
+    bool res = true;
+    
+    // no mutex
+    std::vector<MHStoreEntry*>::iterator it = entries.begin();
     for(;it != entries.end();++it) {
         MHStoreEntry* entry = *it;
         StringBuffer sql = formatInsertItemStmt(entry);
@@ -191,8 +201,6 @@ bool MHStore::addEntries(std::vector<MHStoreEntry*>& entries, std::vector<uint64
         }
         entriesId.push_back(entryId);
     }
-    sqlite3_exec(db, "COMMIT", 0, 0, 0);
-    pthread_mutex_unlock(&store_access_mutex);
     return res;
 }
 
@@ -282,13 +290,23 @@ bool MHStore::updateEntries(std::vector<MHStoreEntry*>& entries) {
         return false;
     }
     
-    bool res = true;
-    
-    std::vector<MHStoreEntry*>::iterator it = entries.begin();
     pthread_mutex_lock(&store_access_mutex);
     cache_items_count = getCount();
     // We execute everything inside a transaction to improve performance
-    sqlite3_exec(db, "BEGIN", 0, 0, 0);
+    bool ownTransaction = beginBulkTransaction();
+    bool res = update_entries(entries);
+    endBulkTransaction(ownTransaction);
+    pthread_mutex_unlock(&store_access_mutex);
+    return res;
+}
+
+// private
+bool MHStore::update_entries(std::vector<MHStoreEntry*>& entries) {
+    
+    bool res = true;
+    
+    // no mutex
+    std::vector<MHStoreEntry*>::iterator it = entries.begin();
     for(;it != entries.end();++it) {
         MHStoreEntry* entry = *it;
         StringBuffer sql = formatUpdateItemStmt(entry);
@@ -303,11 +321,67 @@ bool MHStore::updateEntries(std::vector<MHStoreEntry*>& entries) {
             res = false;
         }
     }
-    sqlite3_exec(db, "COMMIT", 0, 0, 0);
+    return res;
+}
+
+bool MHStore::storeEntries(std::vector<MHStoreEntry*>& newEntries, std::vector<uint64_t>& newEntriesId,
+                           std::vector<MHStoreEntry*>& updatedEntries) {
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: can't store entries: cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    // The mutex is held until the transaction is closed, so that no other
+    // write joins it
+    pthread_mutex_lock(&store_access_mutex);
+    
+    if (sqlite3_exec(db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+        pthread_mutex_unlock(&store_access_mutex);
+        LOG.error("%s: error beginning transaction: %s", __FUNCTION__, sqlite3_errmsg(db));
+        return false;
+    }
+    
+    cache_items_count = get_count();
+    bool res = insert_entries(newEntries, newEntriesId) && update_entries(updatedEntries);
+    
+    if (res && sqlite3_exec(db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        LOG.error("%s: error committing transaction: %s", __FUNCTION__, sqlite3_errmsg(db));
+        res = false;
+    }
+    if (!res) {
+        sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+        // nothing has been inserted
+        newEntriesId.assign(newEntries.size(), (uint64_t)-1);
+        cache_items_count = -1;
+    }
+    
     pthread_mutex_unlock(&store_access_mutex);
     return res;
 }
 
+// private
+bool MHStore::beginBulkTransaction() {
+    
+    // sqlite is in autocommit mode when no transaction is open
+    if (sqlite3_get_autocommit(db) == 0) {
+        return false;
+    }
+    
+    sqlite3_exec(db, "BEGIN", 0, 0, 0);
+    return true;
+}
+
+// private
+void MHStore::endBulkTransaction(bool ownTransaction) {
+    
+    if (ownTransaction && sqlite3_exec(db, "COMMIT", 0, 0, 0) != SQLITE_OK) {
+        LOG.error("%s: error committing transaction: %s", __FUNCTION__, sqlite3_errmsg(db));
+        // don't leave the transaction open for the next writes
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+    }
+}
+
 // private
 long MHStore::get_count()
 {
@@ -38,6 +38,7 @@
 #include "MediaHub/MHSyncManager.h"
 #include "MediaHub/MediaRequestManagerFactory.h"
 #include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHPagePrefetcher.h"
 #include "MediaHub/MHContentTypes.h"
 #include "event/FireEvent.h"
 #include "spds/spdsutils.h"
@@ -83,22 +84,9 @@ MHSyncManager::MHSyncManager(MHSyncSource& s, AbstractSyncConfig& c) :
     
     //report.clear();
     
-    URL url(config.getSyncURL());
-    StringBuffer host = url.getHostURL();
     offsetClientServer = 0;
     
-    MediaRequestManagerFactory* reqManFactory = MediaRequestManagerFactory::getInstance();
-    mhMediaRequestManager = reqManFactory->getMediaRequestManager(host,
-                                                      source.getSapiUri(),
-                                                      source.getSapiArrayKey(),
-                                                      source.getOrderField(),
-                                                      source.createItemJsonParser(),
-                                                      &config);
-    // set http params, read from config
-    mhMediaRequestManager->setRequestTimeout   (config.getMHRequestTimeout());
-    mhMediaRequestManager->setResponseTimeout  (config.getMHResponseTimeout());
-    mhMediaRequestManager->setUploadChunkSize  (config.getMHUploadChunkSize());
-    mhMediaRequestManager->setDownloadChunkSize(config.getMHDownloadChunkSize());
+    mhMediaRequestManager = createMediaRequestManager();
     
     freeQuota = 0;
     userQuota = 0;    
@@ -110,6 +98,27 @@ MHSyncManager::~MHSyncManager() {
     delete mhMediaRequestManager;
 }
 
+MHMediaRequestManager* MHSyncManager::createMediaRequestManager() {
+    
+    URL url(config.getSyncURL());
+    StringBuffer host = url.getHostURL();
+    
+    MediaRequestManagerFactory* reqManFactory = MediaRequestManagerFactory::getInstance();
+    MHMediaRequestManager* reqMan = reqManFactory->getMediaRequestManager(host,
+                                                      source.getSapiUri(),
+                                                      source.getSapiArrayKey(),
+                                                      source.getOrderField(),
+                                                      source.createItemJsonParser(),
+                                                      &config);
+    // set http params, read from config
+    reqMan->setRequestTimeout   (config.getMHRequestTimeout());
+    reqMan->setResponseTimeout  (config.getMHResponseTimeout());
+    reqMan->setUploadChunkSize  (config.getMHUploadChunkSize());
+    reqMan->setDownloadChunkSize(config.getMHDownloadChunkSize());
+    
+    return reqMan;
+}
+
 
 
 bool MHSyncManager::initialize() {
@@ -161,7 +170,7 @@ int MHSyncManager::getAllServerMetadata() {
     int limit  = MH_PAGING_LIMIT;
     int offset = 0;
     
-    LOG.debug("%s: paging requests = %d", __FUNCTION__, limit);
+    LOG.debug("%s: paging requests = %d, prefetched pages = %d", __FUNCTION__, limit, MH_PREFETCH_PAGES);
     
     CacheItemsList itemsList;
     CacheLabelsMap labelsMap;
@@ -180,11 +189,21 @@ int MHSyncManager::getAllServerMetadata() {
     }
     itemsInCache.clear();
     
+    // The next pages are downloaded by the prefetcher while the current one
+    // is filtered and stored in the cache.
+    MHPagePrefetcher* prefetcher = NULL;
+    if (MH_PREFETCH_PAGES > 0) {
+        prefetcher = new MHPagePrefetcher(createMediaRequestManager(), config, limit, MH_PREFETCH_PAGES);
+        prefetcher->start();
+    }
+    
     while (1) 
     {
         itemsList.clear();
         labelsMap.clear();
         int itemsReceived = 0;
+        EMHMediaRequestStatus err = ESMRSuccess;
+        MHFetchedPage* page = NULL;
         
         LOG.debug("get items info from Server in range: [%d - %d]", offset, offset + limit);
         
@@ -194,135 +213,62 @@ int MHSyncManager::getAllServerMetadata() {
         }
         
         // Labels are allocated by the getAllItems method and must be deallocated afterward
-        EMHMediaRequestStatus err = mhMediaRequestManager->getAllItems(itemsList, labelsMap,
-                                                                       &downloadTimestamp, limit, offset);
-        if (err == ESMRNetworkError) {
-            err = retryGetAllItems(itemsList, labelsMap, limit, offset);
+        if (prefetcher) {
+            page = prefetcher->nextPage();
+            if (page == NULL) {
+                // the prefetcher stopped before the last page: it's been aborted
+                setSyncError(ESSMCanceled);
+                goto finally;
+            }
+            err = page->status;
+            downloadTimestamp = page->responseTime;
+        } else {
+            err = mhMediaRequestManager->getAllItems(itemsList, labelsMap, &downloadTimestamp, limit, offset);
+            if (err == ESMRNetworkError) {
+                err = retryGetAllItems(itemsList, labelsMap, limit, offset);
+            }
         }
         
         if (err != ESMRSuccess) {
+            delete page;
             setSyncError(ESSMMHError, err);
             goto finally;
         }
         
         // Set the time offset between server and client 
-        time_t clientTime = time(NULL);
+        time_t clientTime = page ? page->receivedTime : time(NULL);
         offsetClientServer = clientTime - downloadTimestamp;
         source.setClientServerTimeDrift(offsetClientServer);
         
         report.setState(SOURCE_ACTIVE);
 
-        std::vector<MHStoreEntry*>& entries = itemsList.getItems();
-        itemsReceived = entries.size();
-        LOG.info("%d %s metadata received from server", itemsReceived, sourceName.c_str());
-                
-        // Filter items (size, date, extension, blacklisted)
-        // If filtered, the remote item is removed from the list
-        if (filterIncomingItems(&itemsList)) { 
-            goto finally; 
+        int storeRes = 0;
+        if (page) {
+            itemsReceived = page->itemsReceived;
+            storeRes = storeServerItemsPage(page->items, page->labels, availableGuids);
+            delete page;
+        } else {
+            itemsReceived = itemsList.getItems().size();
+            storeRes = storeServerItemsPage(itemsList, labelsMap, availableGuids);
         }
-        
-        // 
-        // Add remote items to cache and refresh UI (just metadata)
-        //
-        if (entries.size() > 0) {
-            LOG.debug("%s: adding %d remote items to cache", __FUNCTION__, entries.size());
-            
-            std::vector<MHOperationDescriptor*> addOperations;
-            std::vector<MHOperationDescriptor*> updOperations;
-            
-            for (unsigned int j=0; j<entries.size(); j++) {
-                
-                MHSyncItemInfo* itemInfo = (MHSyncItemInfo*)entries[j];
-                if (!itemInfo) continue;
-                
-                // for server items, the ID in the report is the GUID
-                WString wguid;
-                wguid = itemInfo->getGuid();
-                
-                itemInfo->setStatus(EStatusRemote);
-                source.setContentTypeByExtension(itemInfo);
-
-                std::set<std::string>::iterator existingGuidIt = availableGuids.find(itemInfo->getGuid().c_str());
-                
-                if (existingGuidIt != availableGuids.end()) {
-                    // check if item already in cache (by GUID), and in case update it
-                    // this is required to avoid dupes (i.e. if sync interrupted)
-                    MHSyncItemInfo* itemInCache = source.getItemFromCache(MHItemsStore::guid_field_name,
-                                                                          itemInfo->getGuid().c_str());
-                    
-                    // TODO: implement a proper merging mechanism
-                    LOG.debug("%s: Merging information to update the item (%d)",__FUNCTION__,itemInCache->getId());
-                    itemInfo->setId  (itemInCache->getId());
-                    itemInfo->setLuid(itemInCache->getLuid());
-                    if (itemInCache->getLocalItemETag().length() > 0) {
-                        itemInfo->setLocalItemETag(itemInCache->getLocalItemETag().c_str());
-                    }
-                    if (itemInCache->getLocalThumbETag().length() > 0) {
-                        itemInfo->setLocalThumbETag(itemInCache->getLocalThumbETag().c_str());
-                    }
-                    if (itemInCache->getLocalPreviewETag().length() > 0) {
-                        itemInfo->setLocalPreviewETag(itemInCache->getLocalPreviewETag().c_str());
-                    }
-                    //////////
-                    
-                    
-                    LOG.debug("%s: updating item %s (ID=%d, status=%d) to cache", 
-                              __FUNCTION__, itemInfo->getName().c_str(), itemInfo->getId(), itemInfo->getStatus());
-                    
-                    std::vector<MHLabelInfo*>* itemLabels = labelsMap.getLabels(itemInfo);
-                    std::vector<MHLabelInfo*>* emptyLabels = NULL;
-                    if (itemLabels == NULL) {
-                        emptyLabels = new std::vector<MHLabelInfo*>();
-                        itemLabels = emptyLabels;
-                    }
-                    // Create an update operation (does not take the ownership of items, we must release them)
-                    MHOperationDescriptor* opDesc = MHOperationDescriptor::createUpdateOperation(itemInCache, itemInfo, itemLabels);
-                    updOperations.push_back(opDesc);
-                }
-                else {
-                    LOG.debug("%s: adding item %s to cache", __FUNCTION__, itemInfo->getName().c_str());
-                    report.addItem(CLIENT, COMMAND_ADD, wguid.c_str(), 0, NULL);
-                    std::vector<MHLabelInfo*>* itemLabels = labelsMap.getLabels(itemInfo);
-                    MHOperationDescriptor* opDesc = MHOperationDescriptor::createAddOperation(itemInfo, itemLabels);
-                    addOperations.push_back(opDesc);
-                }
-            }
-            
-            // Apply batch operations and release memory
-            source.addItemsToCache(addOperations);
-            std::vector<MHOperationDescriptor*>::iterator addIt = addOperations.begin();
-            for(;addIt != addOperations.end();++addIt) {
-                MHOperationDescriptor* opDesc = *addIt;
-                if (opDesc->getSuccess()) {
-                    fireItemStatusEvent(sourceName.c_str(), (MHSyncItemInfo*)opDesc->getNewEntry(), ITEM_ADDED_BY_SERVER);
-                }
-            }
-            
-            source.updateItemsInCache(updOperations);
-            std::vector<MHOperationDescriptor*>::iterator updIt = updOperations.begin();
-            for(;updIt != updOperations.end();++updIt) {
-                MHOperationDescriptor* opDesc = *updIt;
-                if (opDesc->getSuccess()) {
-                    fireItemStatusEvent(sourceName.c_str(), (MHSyncItemInfo*)opDesc->getNewEntry(), ITEM_UPDATED_BY_SERVER);
-                }
-            }
-            
-            releaseSourceOperations(addOperations);
-            releaseSourceOperations(updOperations);
-            
-            fireItemStatusEvent(sourceName.c_str(), NULL, CACHE_UPDATED);
+        if (storeRes) {
+            goto finally;
         }
         
         if (itemsReceived < limit) {
             break;      // means we reached the end on the server, no need to continue
         }
-        offset += entries.size();
+        offset += itemsReceived;
     }
     getAllStatus = 0;   // success
     
 finally:
     
+    if (prefetcher) {
+        prefetcher->stop();
+        delete prefetcher;
+    }
+    
     LOG.info("Get all remote items metadata completed, for source %s", sourceName.c_str());
     
     if (getAllStatus != 0) {
@@ -346,6 +292,127 @@ finally:
     return getAllStatus;
 }
 
+
+int MHSyncManager::storeServerItemsPage(CacheItemsList& itemsList, CacheLabelsMap& labelsMap,
+                                        std::set<std::string>& availableGuids) {
+    
+    std::vector<MHStoreEntry*>& entries = itemsList.getItems();
+    LOG.info("%d %s metadata received from server", entries.size(), sourceName.c_str());
+            
+    // Filter items (size, date, extension, blacklisted)
+    // If filtered, the remote item is removed from the list
+    int ret = filterIncomingItems(&itemsList);
+    if (ret) { 
+        return ret; 
+    }
+    
+    if (entries.size() == 0) {
+        return 0;
+    }
+    
+    // 
+    // Add remote items to cache and refresh UI (just metadata)
+    //
+    LOG.debug("%s: adding %d remote items to cache", __FUNCTION__, entries.size());
+    
+    std::vector<MHOperationDescriptor*> addOperations;
+    std::vector<MHOperationDescriptor*> updOperations;
+    
+    for (unsigned int j=0; j<entries.size(); j++) {
+        
+        MHSyncItemInfo* itemInfo = (MHSyncItemInfo*)entries[j];
+        if (!itemInfo) continue;
+        
+        // for server items, the ID in the report is the GUID
+        WString wguid;
+        wguid = itemInfo->getGuid();
+        
+        itemInfo->setStatus(EStatusRemote);
+        source.setContentTypeByExtension(itemInfo);
+
+        std::set<std::string>::iterator existingGuidIt = availableGuids.find(itemInfo->getGuid().c_str());
+        
+        if (existingGuidIt != availableGuids.end()) {
+            // check if item already in cache (by GUID), and in case update it
+            // this is required to avoid dupes (i.e. if sync interrupted)
+            MHSyncItemInfo* itemInCache = source.getItemFromCache(MHItemsStore::guid_field_name,
+                                                                  itemInfo->getGuid().c_str());
+            
+            // TODO: implement a proper merging mechanism
+            LOG.debug("%s: Merging information to update the item (%d)",__FUNCTION__,itemInCache->getId());
+            itemInfo->setId  (itemInCache->getId());
+            itemInfo->setLuid(itemInCache->getLuid());
+            if (itemInCache->getLocalItemETag().length() > 0) {
+                itemInfo->setLocalItemETag(itemInCache->getLocalItemETag().c_str());
+            }
+            if (itemInCache->getLocalThumbETag().length() > 0) {
+                itemInfo->setLocalThumbETag(itemInCache->getLocalThumbETag().c_str());
+            }
+            if (itemInCache->getLocalPreviewETag().length() > 0) {
+                itemInfo->setLocalPreviewETag(itemInCache->getLocalPreviewETag().c_str());
+            }
+            //////////
+            
+            
+            LOG.debug("%s: updating item %s (ID=%d, status=%d) to cache", 
+                      __FUNCTION__, itemInfo->getName().c_str(), itemInfo->getId(), itemInfo->getStatus());
+            
+            std::vector<MHLabelInfo*>* itemLabels = labelsMap.getLabels(itemInfo);
+            std::vector<MHLabelInfo*>* emptyLabels = NULL;
+            if (itemLabels == NULL) {
+                emptyLabels = new std::vector<MHLabelInfo*>();
+                itemLabels = emptyLabels;
+            }
+            // Create an update operation (does not take the ownership of items, we must release them)
+            MHOperationDescriptor* opDesc = MHOperationDescriptor::createUpdateOperation(itemInCache, itemInfo, itemLabels);
+            updOperations.push_back(opDesc);
+        }
+        else {
+            LOG.debug("%s: adding item %s to cache", __FUNCTION__, itemInfo->getName().c_str());
+            report.addItem(CLIENT, COMMAND_ADD, wguid.c_str(), 0, NULL);
+            std::vector<MHLabelInfo*>* itemLabels = labelsMap.getLabels(itemInfo);
+            MHOperationDescriptor* opDesc = MHOperationDescriptor::createAddOperation(itemInfo, itemLabels);
+            addOperations.push_back(opDesc);
+            // the same item may come again in a later page
+            availableGuids.insert(itemInfo->getGuid().c_str());
+        }
+    }
+    
+    // Apply batch operations (the whole page in a single transaction) and release memory
+    if (!source.storeItemsInCache(addOperations, updOperations)) {
+        // nothing of the page is stored: the GUIDs collected above are not in cache
+        LOG.error("%s: error storing %d items in cache", __FUNCTION__,
+                  (int)(addOperations.size() + updOperations.size()));
+        releaseSourceOperations(addOperations);
+        releaseSourceOperations(updOperations);
+        setSyncError(ESSMSetItemError);
+        return -1;
+    }
+    
+    std::vector<MHOperationDescriptor*>::iterator addIt = addOperations.begin();
+    for(;addIt != addOperations.end();++addIt) {
+        MHOperationDescriptor* opDesc = *addIt;
+        if (opDesc->getSuccess()) {
+            fireItemStatusEvent(sourceName.c_str(), (MHSyncItemInfo*)opDesc->getNewEntry(), ITEM_ADDED_BY_SERVER);
+        }
+    }
+    
+    std::vector<MHOperationDescriptor*>::iterator updIt = updOperations.begin();
+    for(;updIt != updOperations.end();++updIt) {
+        MHOperationDescriptor* opDesc = *updIt;
+        if (opDesc->getSuccess()) {
+            fireItemStatusEvent(sourceName.c_str(), (MHSyncItemInfo*)opDesc->getNewEntry(), ITEM_UPDATED_BY_SERVER);
+        }
+    }
+    
+    releaseSourceOperations(addOperations);
+    releaseSourceOperations(updOperations);
+    
+    fireItemStatusEvent(sourceName.c_str(), NULL, CACHE_UPDATED);
+    
+    return 0;
+}
+
 void MHSyncManager::releaseSourceOperations(std::vector<MHOperationDescriptor*>& operations) {
     std::vector<MHOperationDescriptor*>::iterator it  = operations.begin();
     std::vector<MHOperationDescriptor*>::iterator end = operations.end();
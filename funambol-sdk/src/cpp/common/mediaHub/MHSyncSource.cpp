@@ -525,6 +525,63 @@ bool MHSyncSource::updateItemsInCache(std::vector<MHOperationDescriptor*>& opera
     return res;
 }
 
+bool MHSyncSource::storeItemsInCache(std::vector<MHOperationDescriptor*>& addOperations,
+                                     std::vector<MHOperationDescriptor*>& updOperations) {
+    
+    if (mhItemsStore == NULL) {
+        LOG.error("%s: no item cache defined", __FUNCTION__);
+        return false;
+    }
+    
+    if (backwardCompatibilityMode) {
+        bool added   = addItemsToCache(addOperations);
+        bool updated = updateItemsInCache(updOperations);
+        return added && updated;
+    }
+    
+    std::vector<MHStoreEntry*> newEntries, updatedEntries;
+    std::vector<MHOperationDescriptor*>::iterator it;
+    for (it = addOperations.begin(); it != addOperations.end(); ++it) {
+        newEntries.push_back((*it)->getNewEntry());
+    }
+    for (it = updOperations.begin(); it != updOperations.end(); ++it) {
+        updatedEntries.push_back((*it)->getNewEntry());
+    }
+    
+    bool res = mhItemsStore->storeEntries(newEntries, updatedEntries);
+    
+    // Now handle labels, once the items have their IDs
+    for (it = addOperations.begin(); it != addOperations.end(); ++it) {
+        MHOperationDescriptor* opDesc = *it;
+        opDesc->setSuccess(res);
+        std::vector<MHLabelInfo*>* labels = opDesc->getLabels();
+        if (res && labels != NULL) {
+            if (mhLabelsStore == NULL) {
+                LOG.info("%s: Ignoring labels because source is not configured to support them",__FUNCTION__);
+            } else {
+                addMissingLabels(labels);
+                addLabelsToItem((MHSyncItemInfo*)opDesc->getNewEntry(), labels);
+            }
+        }
+    }
+    for (it = updOperations.begin(); it != updOperations.end(); ++it) {
+        MHOperationDescriptor* opDesc = *it;
+        opDesc->setSuccess(res);
+        std::vector<MHLabelInfo*>* labels = opDesc->getLabels();
+        if (res && labels != NULL) {
+            if (mhLabelsStore == NULL) {
+                LOG.info("%s: Ignoring labels because source is not configured to support them",__FUNCTION__);
+            } else {
+                clearLabelsForItem((MHSyncItemInfo*)opDesc->getNewEntry());
+                addMissingLabels(labels);
+                addLabelsToItem((MHSyncItemInfo*)opDesc->getNewEntry(), labels);
+            }
+        }
+    }
+    
+    return res;
+}
+
 
 bool MHSyncSource::updateItemInCache(MHSyncItemInfo* itemInfo, std::vector<MHLabelInfo*>* labels)
 {
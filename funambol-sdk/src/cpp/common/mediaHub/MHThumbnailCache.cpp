@@ -0,0 +1,679 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "MediaHub/MHThumbnailCache.h"
+#include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHSyncItemInfo.h"
+#include "base/util/utils.h"
+#include "base/Log.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+const char* MHThumbnailCache::item_id_field_name          = "item_id";
+const char* MHThumbnailCache::kind_field_name             = "kind";
+const char* MHThumbnailCache::path_field_name             = "path";
+const char* MHThumbnailCache::size_field_name             = "size";
+const char* MHThumbnailCache::etag_field_name             = "etag";
+const char* MHThumbnailCache::last_access_field_name      = "last_access";
+
+const char* MHThumbnailCache::create_table_stmt_fmt       = "CREATE TABLE IF NOT EXISTS %s (id INTEGER PRIMARY KEY AUTOINCREMENT, " \
+                                                            "%s INTEGER, %s INTEGER, %s TEXT, %s INTEGER, %s TEXT, %s INTEGER, " \
+                                                            "UNIQUE (%s, %s))";
+const char* MHThumbnailCache::create_index_stmt_fmt       = "CREATE INDEX IF NOT EXISTS %s_lru ON %s (%s)";
+const char* MHThumbnailCache::insert_row_stmt_fmt         = "INSERT OR REPLACE INTO %s (%s, %s, %s, %s, %s, %s) VALUES (%lu, %d, %Q, %lld, %Q, %ld)";
+const char* MHThumbnailCache::select_entry_stmt_fmt       = "SELECT * FROM %s WHERE %s = %lu AND %s = %d";
+const char* MHThumbnailCache::select_lru_stmt_fmt         = "SELECT * FROM %s ORDER BY %s ASC LIMIT %d";
+const char* MHThumbnailCache::select_total_size_stmt_fmt  = "SELECT SUM(%s) FROM %s";
+const char* MHThumbnailCache::delete_entry_stmt_fmt       = "DELETE FROM %s WHERE %s = %lu AND %s = %d";
+const char* MHThumbnailCache::update_access_stmt_fmt      = "UPDATE %s SET %s = %ld WHERE %s = %lu AND %s = %d";
+
+
+MHThumbnailCache::MHThumbnailCache(const char* storeName, const char* storePath, const char* cacheDir_,
+                                   int64_t maxSize_, MHItemsStore* itemsStore_) :
+                                   MHStore(storeName, storePath), cacheDir(cacheDir_),
+                                   maxSize(maxSize_), currentSize(0), itemsStore(itemsStore_)
+{
+    pthread_mutex_init(&cache_mutex, NULL);
+    
+    if (cacheDir.empty()) {
+        LOG.error("%s: empty cache directory", __FUNCTION__);
+        store_status = store_status_error;
+        return;
+    }
+    
+    if (createFolder(cacheDir.c_str()) != 0) {
+        LOG.error("%s: can't create cache directory %s", __FUNCTION__, cacheDir.c_str());
+        store_status = store_status_error;
+        return;
+    }
+    
+    if (store_status == store_status_not_initialized) {
+        LOG.debug("%s: initializing table for store %s", __FUNCTION__, store_name.c_str());
+        if (!initializeTable()) {
+            LOG.error("%s: error initializing store %s: %s", __FUNCTION__, store_name.c_str(), sqlite3_errmsg(db));
+            store_status = store_status_error;
+            return;
+        }
+        store_status = store_status_initialized;
+        initializeStaticQueries();
+        
+        currentSize = readTotalSize();
+        LOG.debug("%s: thumbnail cache size: %lld bytes (max %lld)", __FUNCTION__, currentSize, maxSize);
+        
+        if (currentSize > maxSize) {
+            pthread_mutex_lock(&cache_mutex);
+            evict(maxSize);
+            pthread_mutex_unlock(&cache_mutex);
+        }
+    }
+}
+
+MHThumbnailCache::~MHThumbnailCache()
+{
+    if (store_status == store_status_initialized) {
+        flush();
+    }
+    pthread_mutex_destroy(&cache_mutex);
+}
+
+bool MHThumbnailCache::initializeTable()
+{
+    StringBuffer sql;
+    
+    sql.sprintf(create_table_stmt_fmt, store_name.c_str(),
+                item_id_field_name, kind_field_name, path_field_name,
+                size_field_name, etag_field_name, last_access_field_name,
+                item_id_field_name, kind_field_name);
+    
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+        return false;
+    }
+    
+    // eviction scans the entries by access time
+    sql.sprintf(create_index_stmt_fmt, store_name.c_str(), store_name.c_str(), last_access_field_name);
+    
+    return (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) == SQLITE_OK);
+}
+
+void MHThumbnailCache::initializeStaticQueries()
+{
+    select_count_stmt.sprintf(select_count_stmt_fmt, "id", store_name.c_str());
+}
+
+int64_t MHThumbnailCache::readTotalSize()
+{
+    int64_t size = 0;
+    sqlite3_stmt* stmt = NULL;
+    StringBuffer sql;
+    
+    sql.sprintf(select_total_size_stmt_fmt, size_field_name, store_name.c_str());
+    
+    pthread_mutex_lock(&store_access_mutex);
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        pthread_mutex_unlock(&store_access_mutex);
+        LOG.error("%s: error preparing SQL query: %s", __FUNCTION__, sqlite3_errmsg(db));
+        return 0;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        size = (int64_t)sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    return size;
+}
+
+
+bool MHThumbnailCache::getFile(MHSyncItemInfo* item, EMHThumbnailKind kind, StringBuffer& localPath)
+{
+    if (item == NULL) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return false;
+    }
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: thumbnail cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    unsigned long itemId = item->getId();
+    const std::string& remoteETag = (kind == MHThumbnailKindThumb) ? item->getRemoteThumbETag()
+                                                                  : item->getRemotePreviewETag();
+    
+    pthread_mutex_lock(&cache_mutex);
+    
+    MHThumbnailCacheEntry* entry = findEntry(itemId, kind);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&cache_mutex);
+        return false;
+    }
+    
+    // revalidate: the remote etag changes when the server regenerates the file
+    bool stale = !remoteETag.empty() && (remoteETag != entry->getETag());
+    if (!stale && !fileExists(entry->getPath().c_str())) {
+        LOG.debug("%s: cached file %s is missing", __FUNCTION__, entry->getPath().c_str());
+        stale = true;
+    }
+    
+    if (stale) {
+        LOG.debug("%s: dropping stale %s of item %lu", __FUNCTION__,
+                  (kind == MHThumbnailKindThumb) ? "thumbnail" : "preview", itemId);
+        dropEntry(entry);
+        delete entry;
+        pthread_mutex_unlock(&cache_mutex);
+        
+        if (kind == MHThumbnailKindThumb) {
+            item->setLocalThumbPath("");
+            item->setLocalThumbETag("");
+        } else {
+            item->setLocalPreviewPath("");
+            item->setLocalPreviewETag("");
+        }
+        return false;
+    }
+    
+    localPath = entry->getPath();
+    delete entry;
+    
+    pendingAccess[entryKey(itemId, kind)] = time(NULL);
+    if (pendingAccess.size() >= MH_THUMBNAIL_CACHE_UPDATES_BATCH) {
+        flushAccessTimes();
+    }
+    
+    pthread_mutex_unlock(&cache_mutex);
+    
+    return true;
+}
+
+StringBuffer MHThumbnailCache::getFilePath(MHSyncItemInfo* item, EMHThumbnailKind kind) const
+{
+    StringBuffer fileName("");
+    
+    if (item == NULL) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return fileName;
+    }
+    
+    fileName.sprintf("%lu_%s", item->getId(), (kind == MHThumbnailKindThumb) ? "thumb" : "preview");
+    
+    return getCompleteName(cacheDir.c_str(), fileName);
+}
+
+bool MHThumbnailCache::addFile(MHSyncItemInfo* item, EMHThumbnailKind kind, const char* filePath)
+{
+    if ((item == NULL) || (filePath == NULL) || (*filePath == 0)) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return false;
+    }
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: thumbnail cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    int64_t size = fgetsize(filePath);
+    if (size < 0) {
+        LOG.error("%s: can't read size of file %s", __FUNCTION__, filePath);
+        return false;
+    }
+    
+    unsigned long itemId = item->getId();
+    const std::string& etag = (kind == MHThumbnailKindThumb) ? item->getRemoteThumbETag()
+                                                            : item->getRemotePreviewETag();
+    
+    pthread_mutex_lock(&cache_mutex);
+    
+    // replacing a previous version: account for (and drop) the old file
+    MHThumbnailCacheEntry* old = findEntry(itemId, kind);
+    if (old) {
+        currentSize -= old->getSize();
+        if (old->getPath() != filePath) {
+            remove(old->getPath().c_str());
+        }
+        delete old;
+    }
+    pendingAccess.erase(entryKey(itemId, kind));
+    
+    MHThumbnailCacheEntry entry(itemId, kind, filePath, size, etag.c_str(), time(NULL));
+    StringBuffer sql = formatInsertItemStmt(&entry);
+    
+    pthread_mutex_lock(&store_access_mutex);
+    int ret = sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    if (ret != SQLITE_OK) {
+        LOG.error("%s: error executing SQL statement: %s", __FUNCTION__, sqlite3_errmsg(db));
+        pthread_mutex_unlock(&cache_mutex);
+        return false;
+    }
+    cache_items_count = -1;     // re-read on next getCount()
+    currentSize += size;
+    
+    queueItemUpdate(itemId, kind, filePath, etag.c_str());
+    
+    if (currentSize > maxSize) {
+        evict(maxSize);
+    }
+    
+    pthread_mutex_unlock(&cache_mutex);
+    
+    if (kind == MHThumbnailKindThumb) {
+        item->setLocalThumbPath(filePath);
+        item->setLocalThumbETag(etag.c_str());
+    } else {
+        item->setLocalPreviewPath(filePath);
+        item->setLocalPreviewETag(etag.c_str());
+    }
+    
+    return true;
+}
+
+bool MHThumbnailCache::removeFile(MHSyncItemInfo* item, EMHThumbnailKind kind)
+{
+    if (item == NULL) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return false;
+    }
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: thumbnail cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    pthread_mutex_lock(&cache_mutex);
+    
+    MHThumbnailCacheEntry* entry = findEntry(item->getId(), kind);
+    bool ret = false;
+    if (entry) {
+        ret = dropEntry(entry);
+        delete entry;
+    }
+    
+    pthread_mutex_unlock(&cache_mutex);
+    
+    if (kind == MHThumbnailKindThumb) {
+        item->setLocalThumbPath("");
+        item->setLocalThumbETag("");
+    } else {
+        item->setLocalPreviewPath("");
+        item->setLocalPreviewETag("");
+    }
+    
+    return ret;
+}
+
+bool MHThumbnailCache::clear()
+{
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: thumbnail cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    pthread_mutex_lock(&cache_mutex);
+    
+    // evicting everything deletes the files and clears the items fields
+    bool ret = evict(0);
+    pendingAccess.clear();
+    
+    pthread_mutex_unlock(&cache_mutex);
+    
+    return ret;
+}
+
+bool MHThumbnailCache::flush()
+{
+    pthread_mutex_lock(&cache_mutex);
+    bool ret = flushAccessTimes();
+    ret = flushItemUpdates() && ret;
+    pthread_mutex_unlock(&cache_mutex);
+    
+    return ret;
+}
+
+void MHThumbnailCache::setMaxSize(int64_t maxSize_)
+{
+    pthread_mutex_lock(&cache_mutex);
+    maxSize = maxSize_;
+    if ((store_status == store_status_initialized) && (currentSize > maxSize)) {
+        evict(maxSize);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+int64_t MHThumbnailCache::getCurrentSize()
+{
+    pthread_mutex_lock(&cache_mutex);
+    int64_t size = currentSize;
+    pthread_mutex_unlock(&cache_mutex);
+    
+    return size;
+}
+
+
+MHThumbnailCacheEntry* MHThumbnailCache::findEntry(unsigned long itemId, EMHThumbnailKind kind)
+{
+    sqlite3_stmt* stmt = NULL;
+    MHStoreEntry* entry = NULL;
+    StringBuffer sql;
+    
+    sql.sprintf(select_entry_stmt_fmt, store_name.c_str(), item_id_field_name, itemId,
+                kind_field_name, (int)kind);
+    
+    pthread_mutex_lock(&store_access_mutex);
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        pthread_mutex_unlock(&store_access_mutex);
+        LOG.error("%s: error preparing SQL query: %s", __FUNCTION__, sqlite3_errmsg(db));
+        return NULL;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        entry = readEntry(stmt);
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    return (MHThumbnailCacheEntry*)entry;
+}
+
+bool MHThumbnailCache::dropEntry(MHThumbnailCacheEntry* entry)
+{
+    if (!RemoveEntry(entry)) {
+        return false;
+    }
+    
+    if (remove(entry->getPath().c_str()) != 0 && fileExists(entry->getPath().c_str())) {
+        LOG.info("%s: can't remove file %s", __FUNCTION__, entry->getPath().c_str());
+    }
+    
+    currentSize -= entry->getSize();
+    pendingAccess.erase(entryKey(entry->getItemId(), entry->getKind()));
+    queueItemUpdate(entry->getItemId(), entry->getKind(), "", "");
+    
+    return true;
+}
+
+bool MHThumbnailCache::evict(int64_t targetSize)
+{
+    // the LRU order must reflect the latest accesses
+    flushAccessTimes();
+    
+    bool ret = true;
+    StringBuffer sql;
+    sql.sprintf(select_lru_stmt_fmt, store_name.c_str(), last_access_field_name,
+                MH_THUMBNAIL_CACHE_EVICTION_BATCH);
+    
+    while (currentSize > targetSize) {
+        CacheItemsList lru;
+        sqlite3_stmt* stmt = NULL;
+        
+        pthread_mutex_lock(&store_access_mutex);
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+            pthread_mutex_unlock(&store_access_mutex);
+            LOG.error("%s: error preparing SQL query: %s", __FUNCTION__, sqlite3_errmsg(db));
+            ret = false;
+            break;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            MHStoreEntry* entry = readEntry(stmt);
+            if (entry) {
+                lru.addItem(entry);
+            }
+        }
+        sqlite3_finalize(stmt);
+        pthread_mutex_unlock(&store_access_mutex);
+        
+        std::vector<MHStoreEntry*>& entries = lru.getItems();
+        if (entries.empty()) {
+            // nothing left to evict: realign the accounting
+            currentSize = 0;
+            break;
+        }
+        
+        // a single transaction for the whole batch
+        pthread_mutex_lock(&store_access_mutex);
+        bool ownTransaction = beginBulkTransaction();
+        pthread_mutex_unlock(&store_access_mutex);
+        
+        std::vector<MHStoreEntry*>::iterator it;
+        for (it = entries.begin(); it != entries.end() && currentSize > targetSize; ++it) {
+            MHThumbnailCacheEntry* entry = (MHThumbnailCacheEntry*)*it;
+            LOG.debug("%s: evicting %s (%lld bytes)", __FUNCTION__, entry->getPath().c_str(), entry->getSize());
+            if (!dropEntry(entry)) {
+                ret = false;
+            }
+        }
+        
+        pthread_mutex_lock(&store_access_mutex);
+        endBulkTransaction(ownTransaction);
+        pthread_mutex_unlock(&store_access_mutex);
+        
+        if (!ret) {
+            break;
+        }
+    }
+    
+    flushItemUpdates();
+    
+    return ret;
+}
+
+bool MHThumbnailCache::flushAccessTimes()
+{
+    if (pendingAccess.empty() || (store_status != store_status_initialized)) {
+        return true;
+    }
+    
+    bool ret = true;
+    
+    pthread_mutex_lock(&store_access_mutex);
+    bool ownTransaction = beginBulkTransaction();
+    
+    std::map<uint64_t, time_t>::iterator it;
+    for (it = pendingAccess.begin(); it != pendingAccess.end(); ++it) {
+        StringBuffer sql;
+        sql.sprintf(update_access_stmt_fmt, store_name.c_str(), last_access_field_name, (long)it->second,
+                    item_id_field_name, (unsigned long)(it->first >> 1),
+                    kind_field_name, (int)(it->first & 1));
+        
+        if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+            LOG.error("%s: error executing SQL statement: %s", __FUNCTION__, sqlite3_errmsg(db));
+            ret = false;
+        }
+    }
+    
+    endBulkTransaction(ownTransaction);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    pendingAccess.clear();
+    
+    return ret;
+}
+
+void MHThumbnailCache::queueItemUpdate(unsigned long itemId, EMHThumbnailKind kind,
+                                       const char* path, const char* etag)
+{
+    if (itemsStore == NULL) {
+        return;
+    }
+    
+    pendingItemUpdates[kind][itemId] = std::make_pair(std::string(path), std::string(etag));
+    
+    if (pendingItemUpdates[MHThumbnailKindThumb].size() +
+        pendingItemUpdates[MHThumbnailKindPreview].size() >= MH_THUMBNAIL_CACHE_UPDATES_BATCH) {
+        flushItemUpdates();
+    }
+}
+
+bool MHThumbnailCache::flushItemUpdates()
+{
+    if (itemsStore == NULL) {
+        return true;
+    }
+    
+    bool ret = itemsStore->updateLocalFileFields(pendingItemUpdates[MHThumbnailKindThumb],
+                                                 MHItemsStore::local_thumb_path_field_name,
+                                                 MHItemsStore::local_thumb_etag);
+    
+    ret = itemsStore->updateLocalFileFields(pendingItemUpdates[MHThumbnailKindPreview],
+                                            MHItemsStore::local_preview_path_field_name,
+                                            MHItemsStore::local_preview_etag) && ret;
+    
+    pendingItemUpdates[MHThumbnailKindThumb].clear();
+    pendingItemUpdates[MHThumbnailKindPreview].clear();
+    
+    return ret;
+}
+
+
+bool MHThumbnailCache::RemoveEntry(MHStoreEntry* entry)
+{
+    MHThumbnailCacheEntry* cacheEntry = dynamic_cast<MHThumbnailCacheEntry*>(entry);
+    if (cacheEntry == NULL) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return false;
+    }
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: can't remove entry: cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    StringBuffer sql;
+    sql.sprintf(delete_entry_stmt_fmt, store_name.c_str(), item_id_field_name, cacheEntry->getItemId(),
+                kind_field_name, (int)cacheEntry->getKind());
+    
+    pthread_mutex_lock(&store_access_mutex);
+    int ret = sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+    int changes = sqlite3_changes(db);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    if (ret != SQLITE_OK) {
+        LOG.error("%s: error executing SQL statement: %s", __FUNCTION__, sqlite3_errmsg(db));
+        return false;
+    } else if (changes == 0) {
+        LOG.info("%s: cannot remove entry for item %lu", __FUNCTION__, cacheEntry->getItemId());
+        return false;
+    }
+    
+    cache_items_count = -1;     // re-read on next getCount()
+    
+    return true;
+}
+
+bool MHThumbnailCache::getAllEntries(CacheItemsList& entryList)
+{
+    int ret = SQLITE_OK;
+    sqlite3_stmt *stmt = NULL;
+    
+    if (store_status != store_status_initialized) {
+        LOG.error("%s: can't get entries: cache is not initialized", __FUNCTION__);
+        return false;
+    }
+    
+    select_all_stmt.sprintf(select_all_stmt_fmt, store_name.c_str());
+    
+    pthread_mutex_lock(&store_access_mutex);
+    
+    ret = sqlite3_prepare_v2(db, select_all_stmt.c_str(), -1, &stmt, NULL);
+    if (ret != SQLITE_OK) {
+        pthread_mutex_unlock(&store_access_mutex);
+        LOG.error("%s: error preparing SQL query: %s", __FUNCTION__, sqlite3_errmsg(db));
+        return false;
+    }
+    
+    while ((sqlite3_step(stmt) == SQLITE_ROW)) {
+        MHStoreEntry* entry = readEntry(stmt);
+        if (entry) {
+            entryList.addItem(entry);
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&store_access_mutex);
+    
+    return true;
+}
+
+MHStoreEntry* MHThumbnailCache::readEntry(sqlite3_stmt *stmt) const
+{
+    if (!stmt) {
+        LOG.error("%s: null sql statement", __FUNCTION__);
+        return NULL;
+    }
+    
+    // column 0 is the row id
+    unsigned long itemId = static_cast<unsigned long>(sqlite3_column_int64(stmt, 1));
+    EMHThumbnailKind kind = (sqlite3_column_int(stmt, 2) == MHThumbnailKindPreview) ?
+                            MHThumbnailKindPreview : MHThumbnailKindThumb;
+    const char* path = (const char*)sqlite3_column_text(stmt, 3);
+    int64_t size = (int64_t)sqlite3_column_int64(stmt, 4);
+    const char* etag = (const char*)sqlite3_column_text(stmt, 5);
+    time_t lastAccess = (time_t)sqlite3_column_int64(stmt, 6);
+    
+    return new MHThumbnailCacheEntry(itemId, kind, path ? path : "", size, etag, lastAccess);
+}
+
+StringBuffer MHThumbnailCache::formatInsertItemStmt(MHStoreEntry* entry)
+{
+    StringBuffer stmt("");
+    
+    MHThumbnailCacheEntry* cacheEntry = dynamic_cast<MHThumbnailCacheEntry*>(entry);
+    if (cacheEntry == NULL) {
+        LOG.error("%s: invalid parameter", __FUNCTION__);
+        return stmt;
+    }
+    
+    char* queryBuilt = sqlite3_mprintf(insert_row_stmt_fmt, store_name.c_str(),
+                                       item_id_field_name, kind_field_name, path_field_name,
+                                       size_field_name, etag_field_name, last_access_field_name,
+                                       cacheEntry->getItemId(), (int)cacheEntry->getKind(),
+                                       cacheEntry->getPath().c_str(), (long long)cacheEntry->getSize(),
+                                       cacheEntry->getETag().c_str(), (long)cacheEntry->getLastAccess());
+    if (queryBuilt) {
+        stmt = queryBuilt;
+        sqlite3_free(queryBuilt);
+    }
+    
+    return stmt;
+}
+
+StringBuffer MHThumbnailCache::formatUpdateItemStmt(MHStoreEntry* entry)
+{
+    // entries are unique by (item, kind): an update is a replace
+    return formatInsertItemStmt(entry);
+}
+
+END_FUNAMBOL_NAMESPACE
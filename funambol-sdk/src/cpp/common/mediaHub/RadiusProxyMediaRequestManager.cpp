@@ -215,9 +215,7 @@ EMHMediaRequestStatus RadiusProxyMediaRequestManager::login(const char* device_i
         return ESMRMHMessageParseError;
     }
     
-    config->setSessionId(sessionID.c_str());
-    config->setSessionIdSetTime(time(NULL));
-    config->setValidationKey(validationKey);    // will be encrypted
+    saveSession(sessionID.c_str(), validationKey.c_str());
     
     LOG.debug("%s: sapi session id: \"%s\"", __FUNCTION__, sessionID.c_str());
     
@@ -228,9 +226,7 @@ EMHMediaRequestStatus RadiusProxyMediaRequestManager::login(time_t* serverTime)
 {
     EMHMediaRequestStatus requestStatus = ESMRSuccess;
     
-    pthread_mutex_lock(&sessionIDAccessMutex);
-    requestStatus = login(deviceID, serverTime);
-    pthread_mutex_unlock(&sessionIDAccessMutex);
+    requestStatus = singleFlightLogin(0, serverTime);
     
     return requestStatus;
 }
@@ -275,8 +271,7 @@ EMHMediaRequestStatus RadiusProxyMediaRequestManager::logout()
         return ESMRMHInvalidResponse;
     }
     
-    config->setSessionId("");
-    config->setSessionIdSetTime(0);
+    saveSession("", NULL);
   
     LOG.debug("response returned = %s", MHLogoutResponse);
     
@@ -218,9 +218,7 @@ EMHMediaRequestStatus SapiMediaRequestManager::login(const char* device_id, time
         return ESMRMHMessageParseError;
     }
     
-    config->setSessionId(sessionID.c_str());
-    config->setSessionIdSetTime(time(NULL));
-    config->setValidationKey(validationKey);    // will be encrypted
+    saveSession(sessionID.c_str(), validationKey.c_str());
     
     LOG.debug("%s: sapi session id: \"%s\"", __FUNCTION__, sessionID.c_str());
     
@@ -231,9 +229,7 @@ EMHMediaRequestStatus SapiMediaRequestManager::login(time_t* serverTime)
 {
     EMHMediaRequestStatus requestStatus = ESMRSuccess;
     
-    pthread_mutex_lock(&sessionIDAccessMutex);
-    requestStatus = login(deviceID, serverTime);
-    pthread_mutex_unlock(&sessionIDAccessMutex);
+    requestStatus = singleFlightLogin(0, serverTime);
     
     return requestStatus;
 }
@@ -278,8 +274,7 @@ EMHMediaRequestStatus SapiMediaRequestManager::logout()
         return ESMRMHInvalidResponse;
     }
     
-    config->setSessionId("");
-    config->setSessionIdSetTime(0);
+    saveSession("", NULL);
   
     LOG.debug("response returned = %s", MHLogoutResponse);
     
@@ -244,9 +244,7 @@ EMHMediaRequestStatus WassupMediaRequestManager::login(const char* device_id, ti
         }
     }
     
-    config->setSessionId(sessionID.c_str());
-    config->setSessionIdSetTime(time(NULL));
-    config->setValidationKey(validationKey);    // will be encrypted
+    saveSession(sessionID.c_str(), validationKey.c_str());
     
     // LOG.debug("%s: sapi session id: \"%s\"", __FUNCTION__, sessionID.c_str());
     LOG.debug("%s: sapi session id: *****", __FUNCTION__);
@@ -258,9 +256,7 @@ EMHMediaRequestStatus WassupMediaRequestManager::login(time_t* serverTime)
 {
     EMHMediaRequestStatus requestStatus = ESMRSuccess;
     
-    pthread_mutex_lock(&sessionIDAccessMutex);
-    requestStatus = login(deviceID, serverTime);
-    pthread_mutex_unlock(&sessionIDAccessMutex);
+    requestStatus = singleFlightLogin(0, serverTime);
     
     return requestStatus;
 }
@@ -309,8 +305,7 @@ EMHMediaRequestStatus WassupMediaRequestManager::logout()
         return ESMRMHInvalidResponse;
     }
     
-    config->setSessionId("");
-    config->setSessionIdSetTime(0);
+    saveSession("", NULL);
   
     LOG.debug("response returned = %s", MHLogoutResponse);
     
@@ -0,0 +1,206 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+
+#include "push/CTPDispatchQueue.h"
+
+namespace Funambol {
+
+CTPDispatchQueue::CTPDispatchQueue(int32_t capacity_) : FThread(),
+    capacity(capacity_ > 0 ? capacity_ : CTP_DISPATCH_QUEUE_SIZE),
+    head(0), count(0), delivering(NULL), started(false)
+{
+    events = new Event*[capacity];
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&available, NULL);
+    pthread_cond_init(&delivered, NULL);
+}
+
+CTPDispatchQueue::~CTPDispatchQueue() {
+
+    softTerminate();
+    if (started) {
+        wait();
+    }
+
+    for (int32_t i = 0; i < count; i++) {
+        delete events[(head + i) % capacity];
+    }
+    delete [] events;
+
+    pthread_cond_destroy(&delivered);
+    pthread_cond_destroy(&available);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool CTPDispatchQueue::postNotification(PushListener* listener, const ArrayList& serverURIList) {
+
+    if (!listener) {
+        LOG.debug("No pushListener registered, push message lost.");
+        return false;
+    }
+    Event* event = new Event();
+    event->listener       = listener;
+    event->isError        = false;
+    event->serverURIList  = serverURIList;
+    event->errorCode      = 0;
+    event->additionalInfo = 0;
+    return post(event);
+}
+
+bool CTPDispatchQueue::postError(PushListener* listener, const int errorCode, const int additionalInfo) {
+
+    if (!listener) {
+        return false;
+    }
+    Event* event = new Event();
+    event->listener       = listener;
+    event->isError        = true;
+    event->errorCode      = errorCode;
+    event->additionalInfo = additionalInfo;
+    return post(event);
+}
+
+bool CTPDispatchQueue::post(Event* event) {
+
+    pthread_mutex_lock(&mutex);
+    if (terminate || count == capacity) {
+        pthread_mutex_unlock(&mutex);
+        LOG.error("%s: dispatch queue %s, event dropped (%s)", __FUNCTION__,
+                  terminate ? "stopped" : "full", event->isError ? "error" : "notification");
+        delete event;
+        return false;
+    }
+    events[(head + count) % capacity] = event;
+    count++;
+    pthread_cond_signal(&available);
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+void CTPDispatchQueue::cancel(PushListener* listener) {
+
+    if (!listener) {
+        // Never queued (and 'delivering' is NULL when idle)
+        return;
+    }
+    pthread_mutex_lock(&mutex);
+
+    // Compact the queue, dropping the events of the listener
+    int32_t kept = 0;
+    for (int32_t i = 0; i < count; i++) {
+        Event* event = events[(head + i) % capacity];
+        if (event->listener == listener) {
+            delete event;
+        } else {
+            events[(head + kept) % capacity] = event;
+            kept++;
+        }
+    }
+    count = kept;
+
+    while (delivering == listener && !pthread_equal(pthread_self(), dispatchThread)) {
+        pthread_cond_wait(&delivered, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+int32_t CTPDispatchQueue::size() {
+
+    pthread_mutex_lock(&mutex);
+    int32_t ret = count;
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+void CTPDispatchQueue::start(Priority priority) {
+
+    pthread_mutex_lock(&mutex);
+    if (started) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    started   = true;
+    terminate = false;
+    pthread_mutex_unlock(&mutex);
+
+    FThread::start(priority);
+}
+
+void CTPDispatchQueue::softTerminate() {
+
+    pthread_mutex_lock(&mutex);
+    terminate = true;
+    pthread_cond_broadcast(&available);
+    pthread_mutex_unlock(&mutex);
+}
+
+void CTPDispatchQueue::run() {
+
+    LOG.debug("Starting CTP dispatch thread");
+
+    pthread_mutex_lock(&mutex);
+    dispatchThread = pthread_self();
+    while (!terminate) {
+        if (count == 0) {
+            pthread_cond_wait(&available, &mutex);
+            continue;
+        }
+        Event* event = events[head];
+        head = (head + 1) % capacity;
+        count--;
+        delivering = event->listener;
+        pthread_mutex_unlock(&mutex);
+
+        if (event->isError) {
+            event->listener->onCTPError(event->errorCode, event->additionalInfo);
+        } else {
+            event->listener->onNotificationReceived(event->serverURIList);
+        }
+        delete event;
+
+        pthread_mutex_lock(&mutex);
+        delivering = NULL;
+        pthread_cond_broadcast(&delivered);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    LOG.debug("Exiting CTP dispatch thread");
+}
+
+} // end namespace Funambol
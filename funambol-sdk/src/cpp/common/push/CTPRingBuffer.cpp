@@ -0,0 +1,158 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+#include "push/CTPRingBuffer.h"
+
+namespace Funambol {
+
+
+CTPRingBuffer::CTPRingBuffer(int32_t maxSize) : head(0), tail(0),
+                                                maxPackageSize(maxSize)
+{
+    // A power of 2, so the positions wrap with a mask
+    capacity = 1;
+    while (capacity < maxPackageSize * 4) {
+        capacity <<= 1;
+    }
+    mask    = (uint32_t)capacity - 1;
+    ring    = new char[capacity];
+    scratch = new char[maxPackageSize];
+}
+
+CTPRingBuffer::~CTPRingBuffer() {
+    delete [] ring;
+    delete [] scratch;
+}
+
+void CTPRingBuffer::reset() {
+    head = 0;
+    tail = 0;
+}
+
+char* CTPRingBuffer::getWriteSpace(int32_t* len) {
+
+    int32_t free  = space();
+    int32_t index = (int32_t)(tail & mask);
+    int32_t toEnd = capacity - index;
+
+    *len = (free < toEnd) ? free : toEnd;
+    return &ring[index];
+}
+
+void CTPRingBuffer::commit(int32_t len) {
+    if (len > space()) {
+        len = space();
+    }
+    tail += (uint32_t)len;
+}
+
+int32_t CTPRingBuffer::write(const char* data, int32_t len) {
+
+    int32_t written = 0;
+    while (written < len) {
+        int32_t n = 0;
+        char* dest = getWriteSpace(&n);
+        if (n == 0) {
+            break;
+        }
+        if (n > len - written) {
+            n = len - written;
+        }
+        memcpy(dest, &data[written], n);
+        commit(n);
+        written += n;
+    }
+    return written;
+}
+
+void CTPRingBuffer::peek(char* dest, int32_t offset, int32_t len) const {
+
+    int32_t index = (int32_t)((head + (uint32_t)offset) & mask);
+    int32_t first = capacity - index;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dest, &ring[index], first);
+    if (first < len) {
+        memcpy(&dest[first], ring, len - first);
+    }
+}
+
+int32_t CTPRingBuffer::nextMessage(const char** package) {
+
+    *package = NULL;
+    if (size() < 2) {
+        return 0;
+    }
+
+    unsigned char header[2];
+    peek((char*)header, 0, 2);
+    int32_t messageLen = ((int32_t)header[0] << 8) | (int32_t)header[1];
+    int32_t packageLen = messageLen + 2;    // the first 2 bytes are the msg length
+
+    if (messageLen == 0 || packageLen > maxPackageSize) {
+        return -1;
+    }
+    if (size() < packageLen) {
+        return 0;
+    }
+
+    int32_t index = (int32_t)(head & mask);
+    if (index + packageLen <= capacity) {
+        *package = &ring[index];
+    } else {
+        peek(scratch, 0, packageLen);
+        *package = scratch;
+    }
+    return packageLen;
+}
+
+void CTPRingBuffer::consume(int32_t len) {
+    if (len > size()) {
+        len = size();
+    }
+    head += (uint32_t)len;
+    if (head == tail) {
+        // Empty: restart from the beginning, so the next package is
+        // received in a single contiguous space
+        head = 0;
+        tail = 0;
+    }
+}
+
+} // end namespace Funambol
@@ -44,8 +44,12 @@
 #include "push/FThread.h"
 #include "push/FSocket.h"
 #include "push/CTPThreadPool.h"
+#include "push/TimerThread.h"
 
 #include "push/CTPService.h"
+#ifdef CTP_SERVICE_USE_ENGINE
+#include "push/CTPEngine.h"
+#endif
 
 namespace Funambol {
 
@@ -78,7 +82,8 @@ void CTPService::dispose() {
  * Constructor: reads the CTPConfig from registry and init members.
  */
 CTPService::CTPService(DMTClientConfig* clientConfig_) : 
-    config(APPLICATION_URI), clientConfig(clientConfig_) {
+    config(APPLICATION_URI), rxRing(MAX_MESSAGE_SIZE), heartbeatTimer(this), cmdTimeoutTimer(this),
+    clientConfig(clientConfig_) {
 
     // Read config from registry
     config.readCTPConfig();
@@ -88,8 +93,6 @@ CTPService::CTPService(DMTClientConfig* clientConfig_) :
     ctpSocket        = NULL;
     ctpThread        = NULL;
     receiverThread   = NULL;
-    heartbeatThread  = NULL;
-    cmdTimeoutThread = NULL;
     receivedMsg      = NULL;
     ctpState         = CTP_STATE_DISCONNECTED;
     leaving          = false;
@@ -97,6 +100,9 @@ CTPService::CTPService(DMTClientConfig* clientConfig_) :
 
     totalBytesSent     = 0;
     totalBytesReceived = 0;
+
+    engine  = NULL;
+    session = NULL;
     
     pthread_mutex_init(&ctpSocketMtx, NULL);
 }
@@ -107,6 +113,14 @@ CTPService::CTPService(DMTClientConfig* clientConfig_) :
  * connection if still active.
  */
 CTPService::~CTPService() {
+
+#ifdef CTP_SERVICE_USE_ENGINE
+    if (engine) {
+        engine->stop();
+        delete engine;  engine = NULL;
+    }
+    delete session;     session = NULL;
+#endif
     
     stopCtpThread();
 
@@ -131,11 +145,34 @@ CTPService::~CTPService() {
 /**
  * Starts the CTP process.
  * Creates the main CTP thread, passing handle stpThread (NULL if not created)
+ * With CTP_SERVICE_USE_ENGINE the CTP process is a CTPSession served by
+ * a CTPEngine event loop, which is returned instead: it ends on stopCTP().
  * @param stpThread  handle of STPThread: the CTPThread started here must
  *                   wait until the STPThread has finished
  * @return           handle of the ctpThread started
  */
 FThread* CTPService::startCTP() {
+#ifdef CTP_SERVICE_USE_ENGINE
+    if (session) {
+        // Keep the latest CTP session only
+        stopCTP();
+    }
+    setCtpState(CTP_STATE_DISCONNECTED);
+    leaving = false;
+
+    // Refresh configuration
+    config.read();
+
+    engine = new CTPEngine(1);
+    if (!engine->start()) {
+        LOG.error("%s: cannot start the CTP engine", __FUNCTION__);
+        delete engine; engine = NULL;
+        return NULL;
+    }
+    session = new CTPSession(config, clientConfig, pushListener);
+    engine->addSession(session);
+    return engine->getLoop(0);
+#else
     setCtpState(CTP_STATE_DISCONNECTED);
     leaving = false;
     totalBytesSent     = 0;
@@ -145,6 +182,7 @@ FThread* CTPService::startCTP() {
     ctpThread = new CTPThread(this);
     ctpThread->start();
     return ctpThread;
+#endif
 }
 
 
@@ -165,6 +203,8 @@ FThread* CTPService::startCTP() {
  *          3 if OK msg from the Server is not received (connection closed after a timeout)
  *         -1 if errors occurred creating the receive thread
  *         -2 if errors occurred waiting on receiverThread
+ * With CTP_SERVICE_USE_ENGINE the session is removed from the engine and
+ * the engine is stopped: 0 if closed, 1 if CTP was not started.
  *          
  */
 int32_t CTPService::stopCTP() {
@@ -173,6 +213,20 @@ int32_t CTPService::stopCTP() {
     leaving = true;
     setCtpState(CTP_STATE_CLOSING);
 
+#ifdef CTP_SERVICE_USE_ENGINE
+    if (!session) {
+        LOG.debug("No CTP session available -> exiting.");
+        return 1;
+    }
+    LOG.info("Closing CTP connection...");
+    engine->removeSession(session);
+    engine->stop();
+    delete engine;  engine  = NULL;
+    delete session; session = NULL;
+    ctpState = CTP_STATE_DISCONNECTED;
+    return 0;
+#else
+
     if (!ctpThread) {
         LOG.debug("No CTP thread available -> exiting.");
         return 1;
@@ -234,6 +288,7 @@ int32_t CTPService::stopCTP() {
     closeConnection();
 
     return ret;
+#endif
 }
 
 
@@ -261,6 +316,7 @@ int32_t CTPService::openConnection() {
     leaving  = false;
     totalBytesSent     = 0;
     totalBytesReceived = 0;
+    rxRing.reset();
 
     //
     // Find the server
@@ -439,8 +495,10 @@ int32_t CTPService::sendMsg(CTPMessage* message) {
     stopCmdTimeoutThread();
 
     // Debug the message to send.
-    LOG.debug("Sending %d bytes:", msgLength);
-    hexDump(msg, msgLength);
+    if (LOG.isLoggable(LOG_LEVEL_DEBUG)) {
+        LOG.debug("Sending %d bytes:", msgLength);
+        hexDump(msg, msgLength);
+    }
 
     if (!ctpSocket) {
         LOG.error("sendMsg error: socket not initialized.");
@@ -458,11 +516,12 @@ int32_t CTPService::sendMsg(CTPMessage* message) {
         totalBytesSent += ret;
         LOG.debug("Total bytes sent since beginning: %d", totalBytesSent);
 
-        // Will restore connection if no response in 60sec
-        threadPool.cleanup();
-        // Create a new timeout thread
-        cmdTimeoutThread = threadPool.createCmdTimeoutThread(this);
-        cmdTimeoutThread->start();
+        // Will restore connection if no response in ctpCmdTimeout seconds
+        int32_t timeout = config.getCtpCmdTimeout();
+        if (!timeout) {
+            timeout = 180;      // 3 minutes max
+        }
+        TimerThread::getInstance()->schedule(&cmdTimeoutTimer, (int64_t)timeout * 1000);
     }
     return 0;
 }
@@ -474,8 +533,10 @@ int32_t CTPService::sendMsg(CTPMessage* message) {
  * Receive a CTP message through the socket connection.
  * The message is parsed, a CTPMessage is filled and returned (the
  * CTPMessage is internally owned by CTPService).
- * The message could be split into more packages, so we read the first 2 bytes
- * and keep receiving until the message is complete.
+ * Bytes are received directly into the rxRing buffer: the message could be
+ * split into more packages, so we keep receiving until the message is
+ * complete. A package could also hold more than one message: the next ones
+ * stay in rxRing and are returned by the next calls, without any recv.
  * The ctpState is set to CTP_STATE_READY after the msg is received successfully.
  * 
  * @return  the received CTPMessage (pointer to internally owned object)
@@ -483,9 +544,8 @@ int32_t CTPService::sendMsg(CTPMessage* message) {
  */
 CTPMessage* CTPService::receiveStatusMsg() {
 
-    char buffer[MAX_MESSAGE_SIZE], msg[MAX_MESSAGE_SIZE];
-    int totalBytes     = 0;
-    int expectedLength = 0;
+    const char* msg = NULL;
+    int32_t msgLength = 0;
 
     delete receivedMsg;
     receivedMsg = NULL;
@@ -493,63 +553,50 @@ CTPMessage* CTPService::receiveStatusMsg() {
     //
     // Receive socket message: could be split into more pkg
     //
-    while (1) {
+    while ((msgLength = rxRing.nextMessage(&msg)) == 0) {
         LOG.debug("Waiting for Server message...");
         if (!ctpSocket) {
             LOG.error("receiveStatusMsg error: socket not initialized.");
             goto finally;
         }
-        int pkgLen = ctpSocket->readBuffer((int8_t*)buffer, sizeof(buffer));
+        int32_t space = 0;
+        char* dest = rxRing.getWriteSpace(&space);
+        int pkgLen = ctpSocket->readBuffer((int8_t*)dest, space);
 
         if (pkgLen <= 0) {
             // Socket error -> exit
             LOG.error("SOCKET recv() error");
             goto finally;
-        } else {
-            if (totalBytes == 0) {      // first time
-                expectedLength = extractMsgLength(buffer, pkgLen);
-                if (!expectedLength) {
-                    goto finally;
-                }
-                expectedLength += 2;    // the first 2 bytes are the msg length
-            }
-            LOG.debug("Package received: %d bytes read (total = %d, expected = %d)",
-                      pkgLen, totalBytes+pkgLen, expectedLength);
-            // Check if msg too big
-            if (totalBytes+pkgLen >= MAX_MESSAGE_SIZE) {
-                LOG.error("Message larger than %d bytes!", MAX_MESSAGE_SIZE);
-                goto finally;
-            }
+        }
+        rxRing.commit(pkgLen);
+        totalBytesReceived += pkgLen;
+        LOG.debug("Package received: %d bytes read (buffered = %d)", pkgLen, rxRing.size());
+    }
 
-            // Append bytes to the 'msg' array
-            memcpy(&msg[totalBytes], buffer, pkgLen);
-            totalBytes += pkgLen;
+    if (msgLength < 0) {
+        // Empty or too big: the stream cannot be framed anymore
+        LOG.error("Invalid message received (max %d bytes)", MAX_MESSAGE_SIZE);
+        rxRing.reset();
+        goto finally;
+    }
 
-            // Check if msg is complete
-            if (totalBytes < expectedLength) {
-                LOG.debug("Message incomplete -> back to receive");
-                continue;
-            }
-            else {
-                LOG.debug("Message complete");
-                ctpState = CTP_STATE_READY;             // ctpState back to 'ready'
-                totalBytesReceived += totalBytes;
-                
-                // Debug the message received.
-                LOG.debug("Received %d bytes:", totalBytes);
-                hexDump(msg, totalBytes);
-                LOG.debug("Total bytes received since beginning: %d", totalBytesReceived);
-                break;
-            }
-        }
+    LOG.debug("Message complete");
+    ctpState = CTP_STATE_READY;             // ctpState back to 'ready'
+
+    // Debug the message received.
+    if (LOG.isLoggable(LOG_LEVEL_DEBUG)) {
+        LOG.debug("Received %d bytes:", msgLength);
+        hexDump((char*)msg, msgLength);
+        LOG.debug("Total bytes received since beginning: %d", totalBytesReceived);
     }
 
-    // Parse the message, receivedMsg is internally owned
-    receivedMsg = new CTPMessage(msg, totalBytes);
+    // Parse the message in place, receivedMsg is internally owned
+    receivedMsg = new CTPMessage(msg, msgLength);
+    rxRing.consume(msgLength);
     LOG.debug("status = 0x%02x", receivedMsg->getGenericCommand());
 
 finally:
-    // Msg received or error, anyway kill the cmdTimeoutThread.
+    // Msg received or error, anyway cancel the command timeout.
     stopCmdTimeoutThread();
 
     return receivedMsg;
@@ -588,10 +635,9 @@ int32_t CTPService::receive() {
     }
     
     //
-    // Start thread to send 'ready' messages
+    // Start sending 'ready' messages: the first one right now
     //
-    heartbeatThread = threadPool.createHeartbeatThread(this);
-    heartbeatThread->start();
+    TimerThread::getInstance()->schedule(&heartbeatTimer, 0);
     
     //
     // Start thread to receive messages from Server
@@ -633,12 +679,10 @@ int32_t CTPService::receive() {
 
 
 void CTPService::stopHeartbeatThread() {
-    stopThread(heartbeatThread); 
-    heartbeatThread = NULL;
+    TimerThread::getInstance()->cancel(&heartbeatTimer);
 }
 void CTPService::stopCmdTimeoutThread() {
-    stopThread(cmdTimeoutThread); 
-    cmdTimeoutThread = NULL;
+    TimerThread::getInstance()->cancel(&cmdTimeoutTimer);
 }
 void CTPService::stopReceiverThread() {
     stopThread(receiverThread); 
@@ -669,25 +713,7 @@ bool CTPService::stopThread(FThread *thread) {
  * @return the credential string in b64 format.
  */
 StringBuffer CTPService::createMD5Credentials() {
-
-    char* credential = NULL;
-
-    const char*  username    = clientConfig->getUsername(); 
-    const char*  password    = clientConfig->getPassword();
-    StringBuffer clientNonce = config.getCtpNonce();
-
-    //LOG.debug("Creating cred from: username = '%s', pwd = '%s', clientNonce = '%s'", 
-    //        username, password, clientNonce.c_str());
-    
-    credential = MD5CredentialData(username, password, clientNonce.c_str());
-    if (credential) {
-        StringBuffer ret(credential);
-        delete [] credential;
-        return ret;
-    }
-
-    StringBuffer emptyRes;
-    return emptyRes;
+    return CTPSession::createMD5Credentials(config, clientConfig);
 }
 
 
@@ -708,11 +734,11 @@ void CTPService::hexDump(char *buf, int len) {
         return;
     }
 
-    char* tmp = new char[len*8 + 3];
+    char* tmp = new char[len*3 + 3];
     tmp[0] = '[';
     int pos = 1;
     for (int i=0; i<len; i++) {
-        sprintf(&tmp[pos], "%02x ", buf[i]);
+        sprintf(&tmp[pos], "%02x ", (unsigned char)buf[i]);
         pos += 3;
     }
     tmp[pos-1] = ']';
@@ -764,63 +790,51 @@ void CTPService::notifyError(const int errorCode, const int additionalInfo) {
     }
 }
 
+void CTPService::registerPushListener(PushListener& listener) {
 
+    pushListener = &listener;
+    if (session) {
+        session->setPushListener(pushListener);
+    }
+}
 
-//////////////////////////////////////////////////////////////////////////////
-// CmdTimeoutThread
-//////////////////////////////////////////////////////////////////////////////
-CmdTimeoutThread::CmdTimeoutThread(CTPService* ctpService_) : ctpService(ctpService_) {
+CTPService::CtpState CTPService::getCtpState() {
+
+    if (session) {
+        return (CtpState)session->getState();
+    }
+    return ctpState;
 }
 
-CmdTimeoutThread::~CmdTimeoutThread() {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CmdTimeoutTimer
+//////////////////////////////////////////////////////////////////////////////
+CmdTimeoutTimer::CmdTimeoutTimer(CTPService* ctpService_) : TimerTask(), ctpService(ctpService_) {
 }
 
 /**
- * Thread used to check if a response arrived in ctpCmdTimeout seconds.
+ * Timer used to check if a response arrived in ctpCmdTimeout seconds.
  * If not, the CTP connection will be pulled down so that ctpThread
  * will restore the whole CTP connection.
- * This thread is started every time a message is sent.
- * @param lpv  unused
+ * This timer is scheduled every time a message is sent.
  */
-void CmdTimeoutThread::run() {
-    LOG.debug("Starting cmdTimeoutWorker thread");
-
-    // TODO PowerPolicyNotify(PPN_UNATTENDEDMODE, TRUE);
-
-    // Load the timeout (ctpCmdTimeout)
-    int32_t timeout = ctpService->getConfig()->getCtpCmdTimeout();
-    if (!timeout) {
-        timeout = 180;      // 3 minutes max
-    }
-
-    FThread::sleep(timeout * 1000);
-
-    // Check if we were killed, then there is nothing to do
-    if (terminate) {
-        goto finally;
-    }
+void CmdTimeoutTimer::onTimeout() {
 
     if ( (ctpService->isLeaving() == false) &&
          (ctpService->getCtpState() == CTPService::CTP_STATE_WAITING_RESPONSE) ) {
         // Response not received -> close ctp connection so that
         // the receiveThread will exit with error, so ctpThread will restore ctp.
-        LOG.info("No response received from Server after %d seconds: closing CTP", timeout);
+        LOG.info("No response received from Server after %d seconds: closing CTP",
+                 ctpService->getConfig()->getCtpCmdTimeout());
         ctpService->notifyError(CTPService::CTP_ERROR_RECEIVE_TIMOUT);
         
         ctpService->closeConnection();
         
-        // Heartbeat thread can be in sleep mode, we must terminate it.
+        // No more heartbeats on this connection.
         ctpService->stopHeartbeatThread();
     }
-
-finally:
-
-    // TODO PowerPolicyNotify(PPN_UNATTENDEDMODE, FALSE);
-    LOG.debug("Exiting cmdTimeoutWorker thread");
-}
-
-void CmdTimeoutThread::softTerminate() {
-    terminate = true;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1150,44 +1164,7 @@ finally:
  *                       false if nonce not found
  */
 bool CTPThread::saveNonceParam(CTPMessage* authStatusMsg) {
-
-    if (authStatusMsg->params.size() == 0) {
-        return false;
-    }
-
-    // Get nonce param
-    int nonceLen = 0;
-    void* nonce  = NULL;
-    CTPParam* param = (CTPParam*)authStatusMsg->params.front();
-    if (param && param->getParamCode() == P_NONCE) {
-        nonceLen = (*param).getValueLength();
-        nonce    = (*param).getValue();
-    }
-    else {
-        return false;
-    }
-    if (!nonce || nonceLen==0) {
-        return false;
-    }
-
-
-    // Nonce is encoded in b64.
-    char* b64Nonce = new char[((nonceLen/3+1)<<2) + 32];
-    int len = b64_encode(b64Nonce, nonce, nonceLen);
-    b64Nonce[len] = 0;
-
-    //LOG.debug("New nonce received:");
-    //hexDump((char*)nonce, nonceLen);
-    LOG.debug("New nonce received: '%s'", b64Nonce);
-
-    // Save new nonce to config, and save config!
-    ctpService->getConfig()->setCtpNonce(b64Nonce);
-    ctpService->getConfig()->saveCTPConfig();
-
-    LOG.debug("Done");
-
-    delete [] b64Nonce;
-    return true;
+    return CTPSession::saveNonceParam(*ctpService->getConfig(), authStatusMsg);
 }
 
 
@@ -1263,54 +1240,34 @@ finally:
 }
 
 //////////////////////////////////////////////////////////////////////////////
-// HeartbeatThread
+// HeartbeatTimer
 //////////////////////////////////////////////////////////////////////////////
-/**
- * Thread used to send 'READY' messages as a heartbeat, every 'ctpReady' seconds.
- * It ends only if CTP is in 'leaving state' (Client stops CTP).
- * @param lpv  unused
- * @return 0 if no errors
- */
-HeartbeatThread::HeartbeatThread(CTPService* ctpService_) : FThread(), ctpService(ctpService_)
+HeartbeatTimer::HeartbeatTimer(CTPService* ctpService_) : TimerTask(), errorCode(0),
+                                                          ctpService(ctpService_)
 {
 }
 
-HeartbeatThread::~HeartbeatThread() {
-}
-
-void HeartbeatThread::softTerminate() {
-    terminate = true;
-}
-
-
-void HeartbeatThread::run() {
-    LOG.debug("Starting Heartbeat thread");
-
+/**
+ * Timer used to send 'READY' messages as a heartbeat, every 'ctpReady' seconds.
+ * It's scheduled by CTPService::receive() and cancelled when the
+ * connection is closed.
+ */
+void HeartbeatTimer::onTimeout() {
+
+    LOG.debug("Sending [READY] message...");
+    if (ctpService->sendReadyMsg()) {
+        LOG.debug("Error sending READY msg");
+        errorCode = 1;
+        ctpService->notifyError(CTPService::CTP_ERROR_SENDING_READY);
+        // By closing the connection we force the CTP to restart
+        ctpService->closeConnection();
+        return;
+    }
     errorCode = 0;
 
-    //TODO PowerPolicyNotify(PPN_UNATTENDEDMODE, TRUE);
-
-    // Load the sleep interval (ctpReady)
+    // Next ready msg in ctpReady seconds
     int32_t sleepInterval = ctpService->getConfig()->getCtpReady();
-
-    // Send 'ready' message to Server and sleep ctpReady seconds
-    while (terminate == false) {
-
-        LOG.debug("Sending [READY] message...");
-        if (ctpService->sendReadyMsg()) {
-            LOG.debug("Error sending READY msg");
-            errorCode = 1;
-            ctpService->notifyError(CTPService::CTP_ERROR_SENDING_READY);
-            // By closing the connection we force the CTP to restart
-            ctpService->closeConnection();
-            break;
-        }
-        //LOG.debug("Next ready msg will be sent in %d seconds...", sleepInterval);
-        FThread::sleep(sleepInterval * 1000);
-    }
-
-    //TODO PowerPolicyNotify(PPN_UNATTENDEDMODE, FALSE);
-    LOG.debug("Exiting heartbeatWorker thread");
+    TimerThread::getInstance()->schedule(this, (int64_t)sleepInterval * 1000);
 }
 
 
@@ -1318,45 +1275,7 @@ void HeartbeatThread::run() {
 // TODO: will be moved in PushManager
 ArrayList CTPService::getUriListFromSAN(SyncNotification* sn) 
 {
-    ArrayList list;
-    int n = 0;
-    
-    if (!sn) {
-        LOG.error("CTP notification error: SyncNotification is NULL");
-        return list;
-    }
-
-    // Get number of sources to sync
-    n = sn->getNumSyncs();
-    if (!n) {
-        LOG.error("CTP notification error: no sources to sync from server");
-        return list;
-    }
-    
-    // Compose the array of ServerURI names
-    for (int i=0; i<n; i++) {
-        SyncAlert* sync = sn->getSyncAlert(i);
-        if(!sync) {
-            LOG.error("CTP notification error: no SyncAlert in SyncNotification");
-            continue;
-        }
-        if (sync->getServerURI()) {
-            StringBuffer uri(sync->getServerURI());
-            list.add(uri);
-            LOG.debug("uri pushed: '%s'", uri.c_str());
-        } 
-        else {
-            LOG.error("CTP notification error: no source found from server "
-                      "notification request: %s", sync->getServerURI());
-            continue;
-        }
-    }
-
-    if (list.size() == 0) {
-        // 0 sources to sync -> out
-        LOG.info("No sources to sync");
-    }
-    return list;
+    return CTPSession::getUriListFromSAN(sn);
 }
 
 } // end namespace Funambol
@@ -0,0 +1,669 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+#include "base/base64.h"
+#include "base/util/utils.h"
+#include "base/util/StringBuffer.h"
+#include "base/util/ArrayList.h"
+
+#include "push/CTPParam.h"
+#include "push/CTPService.h"
+#include "push/CTPSession.h"
+
+namespace Funambol {
+
+/// Used when ctpCmdTimeout is not set: 3 minutes max
+#define CTP_DEFAULT_CMD_TIMEOUT     180
+
+
+CTPSession::CTPSession(CTPConfig& config_, DMTClientConfig* clientConfig_, PushListener* listener) :
+    config(config_), clientConfig(clientConfig_), pushListener(listener), observer(NULL),
+    state(CTPService::CTP_STATE_DISCONNECTED), leaving(false), finished(false), closing(false),
+    errorCode(0), authRound(0), authenticated(false), jump(false),
+    retryDeadline(0), cmdDeadline(-1), heartbeatDeadline(-1), connDeadline(-1),
+    rxRing(MAX_MESSAGE_SIZE), txBuffer(NULL), txLen(0), txSize(0),
+    totalBytesSent(0), totalBytesReceived(0)
+{
+    defaultCtpRetry = config.getCtpRetry();
+}
+
+CTPSession::~CTPSession() {
+    delete [] txBuffer;
+}
+
+
+void CTPSession::stop() {
+    leaving = true;
+    state   = CTPService::CTP_STATE_CLOSING;
+    retryDeadline     = -1;
+    cmdDeadline       = -1;
+    heartbeatDeadline = -1;
+    connDeadline      = -1;
+}
+
+bool CTPSession::shouldConnect(int64_t now) const {
+
+    if (leaving || finished) {
+        return false;
+    }
+    if (state != CTPService::CTP_STATE_DISCONNECTED &&
+        state != CTPService::CTP_STATE_SLEEPING) {
+        return false;
+    }
+    return (retryDeadline <= now);
+}
+
+void CTPSession::onConnecting(int64_t now) {
+
+    LOG.info("--- Starting a new SOCKET connection ---");
+    LOG.info("HOSTNAME = '%s'  PORT = '%d'", config.getUrlTo().c_str(), config.getCtpPort());
+
+    state         = CTPService::CTP_STATE_CONNECTING;
+    rxRing.reset();
+    closing       = false;
+    authRound     = 0;
+    authenticated = false;
+    txLen         = 0;
+    totalBytesSent     = 0;
+    totalBytesReceived = 0;
+
+    // The connect is bounded by the same timeout of the commands
+    int32_t timeout = config.getCtpCmdTimeout();
+    if (!timeout) {
+        timeout = CTP_DEFAULT_CMD_TIMEOUT;
+    }
+    retryDeadline     = -1;
+    cmdDeadline       = now + (int64_t)timeout * 1000;
+    heartbeatDeadline = -1;
+    connDeadline      = -1;
+}
+
+bool CTPSession::onConnected(int64_t now) {
+
+    LOG.info("Succesfully connected to %s!", config.getUrlTo().c_str());
+    state       = CTPService::CTP_STATE_CONNECTED;
+    cmdDeadline = -1;
+
+    LOG.debug("Sending [AUTH] message...");
+    return queueAuthMsg(now);
+}
+
+bool CTPSession::onData(const char* data, int32_t len, int64_t now) {
+
+    while (len > 0) {
+        int32_t n = rxRing.write(data, len);
+        data  += n;
+        len   -= n;
+        totalBytesReceived += n;
+
+        if (!handleMessages(now)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+char* CTPSession::getReceiveSpace(int32_t* len) {
+    return rxRing.getWriteSpace(len);
+}
+
+bool CTPSession::onReceived(int32_t len, int64_t now) {
+
+    rxRing.commit(len);
+    totalBytesReceived += len;
+    return handleMessages(now);
+}
+
+bool CTPSession::handleMessages(int64_t now) {
+
+    // Handle every complete message: a package may hold more than one
+    const char* package = NULL;
+    int32_t msgLen;
+    while ((msgLen = rxRing.nextMessage(&package)) > 0) {
+        // Parsed in place: the package is a view on the receive buffer
+        CTPMessage message(package, msgLen);
+        rxRing.consume(msgLen);
+        if (!handleMessage(message, now)) {
+            return false;
+        }
+    }
+    if (msgLen < 0) {
+        LOG.error("%s: invalid CTP message received (max %d bytes)", __FUNCTION__, MAX_MESSAGE_SIZE);
+        return false;
+    }
+    LOG.debug("Message incomplete -> back to receive");
+    return true;
+}
+
+void CTPSession::onDisconnected(int64_t now) {
+
+    LOG.debug("Socket connection closed");
+    LOG.debug("Total number of bytes sent = %d",     totalBytesSent);
+    LOG.debug("Total number of bytes received = %d", totalBytesReceived);
+
+    bool wasListening = authenticated && !closing;
+
+    authRound         = 0;
+    authenticated     = false;
+    closing           = false;
+    txLen             = 0;
+    cmdDeadline       = -1;
+    heartbeatDeadline = -1;
+    connDeadline      = -1;
+
+    if (leaving || finished) {
+        state = CTPService::CTP_STATE_DISCONNECTED;
+        return;
+    }
+    if (wasListening) {
+        // The connection dropped while waiting for notifications
+        notifyError(CTPService::CTP_ERROR_RECEIVING_STATUS);
+    }
+    if (jump) {
+        // Restoring from a JUMP status: reconnect immediately.
+        LOG.debug("Restoring CTP connection from a JUMP...");
+        jump          = false;
+        state         = CTPService::CTP_STATE_DISCONNECTED;
+        retryDeadline = now;
+        return;
+    }
+    scheduleRestore(now);
+}
+
+bool CTPSession::onTimer(int64_t now) {
+
+    if (leaving || finished) {
+        return false;
+    }
+
+    if (cmdDeadline >= 0 && now >= cmdDeadline) {
+        if (state == CTPService::CTP_STATE_CONNECTING) {
+            LOG.error("%s: cannot connect to %s", __FUNCTION__, config.getUrlTo().c_str());
+            return false;
+        }
+        // Response not received -> close ctp connection and restore it.
+        int32_t timeout = config.getCtpCmdTimeout();
+        LOG.info("No response received from Server after %d seconds: closing CTP",
+                 timeout ? timeout : CTP_DEFAULT_CMD_TIMEOUT);
+        notifyError(CTPService::CTP_ERROR_RECEIVE_TIMOUT);
+        closing = true;
+        return false;
+    }
+    if (connDeadline >= 0 && now >= connDeadline) {
+        LOG.debug("ctpConnTimeout expired: restoring the CTP connection");
+        closing = true;
+        return false;
+    }
+    if (heartbeatDeadline >= 0 && now >= heartbeatDeadline) {
+        LOG.debug("Sending [READY] message...");
+        return queueReadyMsg(now);
+    }
+    return true;
+}
+
+int64_t CTPSession::getNextDeadline() const {
+
+    int64_t next = -1;
+    const int64_t deadlines[] = { cmdDeadline, heartbeatDeadline, connDeadline };
+    for (int i = 0; i < 3; i++) {
+        if (deadlines[i] >= 0 && (next < 0 || deadlines[i] < next)) {
+            next = deadlines[i];
+        }
+    }
+    if (!leaving && !finished && retryDeadline >= 0 &&
+        (state == CTPService::CTP_STATE_DISCONNECTED || state == CTPService::CTP_STATE_SLEEPING) &&
+        (next < 0 || retryDeadline < next)) {
+        next = retryDeadline;
+    }
+    return next;
+}
+
+const char* CTPSession::getPendingOutput(int32_t* len) const {
+    *len = txLen;
+    return txLen ? txBuffer : NULL;
+}
+
+void CTPSession::consumeOutput(int32_t len) {
+
+    if (len <= 0) {
+        return;
+    }
+    if (len > txLen) {
+        len = txLen;
+    }
+    memmove(txBuffer, &txBuffer[len], txLen - len);
+    txLen -= len;
+    totalBytesSent += len;
+}
+
+
+bool CTPSession::queueMsg(CTPMessage& message, int64_t now) {
+
+    // The buffer is owned by the CTPMessage
+    char* msg = message.toByte();
+    int32_t msgLength = message.getPackageLength();
+
+    if (txLen + msgLength > txSize) {
+        int32_t newSize = txSize ? txSize * 2 : MAX_MESSAGE_SIZE;
+        while (newSize < txLen + msgLength) {
+            newSize *= 2;
+        }
+        char* newBuffer = new char[newSize];
+        if (txLen) {
+            memcpy(newBuffer, txBuffer, txLen);
+        }
+        delete [] txBuffer;
+        txBuffer = newBuffer;
+        txSize   = newSize;
+    }
+    memcpy(&txBuffer[txLen], msg, msgLength);
+    txLen += msgLength;
+    LOG.debug("Queued %d bytes to send", msgLength);
+
+    // We wait for a Server response every msg sent!
+    int32_t timeout = config.getCtpCmdTimeout();
+    if (!timeout) {
+        timeout = CTP_DEFAULT_CMD_TIMEOUT;
+    }
+    state       = CTPService::CTP_STATE_WAITING_RESPONSE;
+    cmdDeadline = now + (int64_t)timeout * 1000;
+    return true;
+}
+
+bool CTPSession::queueAuthMsg(int64_t now) {
+
+    state = CTPService::CTP_STATE_AUTHENTICATING;
+    authRound++;
+
+    CTPMessage authMsg;
+    authMsg.setGenericCommand(CM_AUTH);
+    authMsg.setProtocolVersion(CTP_PROTOCOL_VERSION);
+
+    CTPParam devId;
+    devId.setParamCode(P_DEVID);
+    devId.setValue(config.getDevID(), strlen(config.getDevID()));
+    authMsg.addParam(&devId);
+
+    CTPParam username;
+    StringBuffer configUserName = clientConfig->getUsername();
+    username.setParamCode(P_USERNAME);
+    username.setValue(configUserName.c_str(), configUserName.length());
+    authMsg.addParam(&username);
+
+    CTPParam cred;
+    cred.setParamCode(P_CRED);
+    StringBuffer credentials = createMD5Credentials(config, clientConfig);
+    cred.setValue(credentials.c_str(), credentials.length());
+    authMsg.addParam(&cred);
+
+    StringBuffer& fromValue = config.getUrlFrom();
+    if (fromValue.length() > 0) {
+        // FROM is used only after a JUMP status
+        CTPParam from;
+        from.setParamCode(P_FROM);
+        from.setValue(fromValue.c_str(), fromValue.length());
+        authMsg.addParam(&from);
+    }
+
+    LOG.info ("AUTH: devId='%s', user='%s', cred='%s'", config.getDevID(),
+                                                        configUserName.c_str(),
+                                                        credentials.c_str() );
+    return queueMsg(authMsg, now);
+}
+
+bool CTPSession::queueReadyMsg(int64_t now) {
+
+    CTPMessage readyMsg;
+    readyMsg.setGenericCommand(CM_READY);
+    readyMsg.setProtocolVersion(CTP_PROTOCOL_VERSION);
+
+    heartbeatDeadline = now + (int64_t)config.getCtpReady() * 1000;
+    return queueMsg(readyMsg, now);
+}
+
+
+bool CTPSession::handleMessage(CTPMessage& message, int64_t now) {
+
+    // Any message is the response to the pending command
+    state       = CTPService::CTP_STATE_READY;
+    cmdDeadline = -1;
+
+    char status = message.getGenericCommand();
+    LOG.debug("status = 0x%02x", status);
+
+    if (!authenticated) {
+        return handleAuthStatus(message, now);
+    }
+
+    switch (status) {
+
+        case ST_OK:
+            // 'OK' to our 'READY' command -> back to recv
+            LOG.debug("[OK] received -> back to receive state");
+            return true;
+
+        case ST_SYNC:
+            LOG.info("[SYNC] notification received! Starting the sync");
+            notifySync(message.getSyncNotification());
+            return true;
+
+        case ST_ERROR:
+            LOG.debug("[ERROR] message received");
+            notifyError(CTPService::CTP_ERROR_RECEIVED_STATUS_ERROR);
+            // no 'break': the connection is restored
+        default:
+            LOG.debug("Bad status received (code 0x%02x), closing connection", status);
+            notifyError(CTPService::CTP_ERROR_RECEIVED_UNKNOWN_COMMAND);
+            closing = true;
+            return false;
+    }
+}
+
+bool CTPSession::handleAuthStatus(CTPMessage& message, int64_t now) {
+
+    char authStatus = message.getGenericCommand();
+
+    if (authRound >= 2 && authStatus != ST_OK) {
+        // Only OK is allowed after the retry with the new nonce
+        if (authStatus == ST_NOT_AUTHENTICATED) {
+            LOG.info("CTP error: Client not authenticated. Please check your credentials.");
+            notifyError(CTPService::CTP_ERROR_NOT_AUTHENTICATED);
+        }
+        else if (authStatus == ST_UNAUTHORIZED) {
+            LOG.info("CTP error: Client unauthorized by the Server. Please check your credentials.");
+            notifyError(CTPService::CTP_ERROR_UNAUTHORIZED);
+        }
+        else {
+            LOG.info("CTP error: received status '0x%02x'.", authStatus);
+            notifyError(CTPService::CTP_ERROR_RECEIVED_UNKNOWN_COMMAND);
+        }
+        fail(2);
+        return false;
+    }
+
+    switch (authStatus) {
+
+        case ST_NOT_AUTHENTICATED:
+            LOG.info("Client not authenticated: retry with new nonce");
+            if (saveNonceParam(config, &message) == false) {
+                LOG.error("Error receiving NON_AUTHENTICATED Status message: NONCE param is missing");
+                return false;
+            }
+            LOG.info("Sending CTP authentication message...");
+            return queueAuthMsg(now);
+
+        case ST_OK:
+        {
+            LOG.info("Client authenticated successfully!");
+            authenticated = true;
+            config.setCtpRetry(defaultCtpRetry);     // Restore the original ctpRetry time
+            if (saveNonceParam(config, &message) == false) {
+                LOG.info("No new nonce received.");
+            }
+            int32_t connTimeout = config.getCtpConnTimeout();
+            if (connTimeout) {
+                connDeadline = now + (int64_t)connTimeout * 1000;
+            }
+            // The first [READY] is sent immediately, then every ctpReady seconds
+            LOG.debug("Sending [READY] message...");
+            return queueReadyMsg(now);
+        }
+
+        case ST_JUMP:
+            LOG.info("Server requested a JUMP");
+            return handleJump(message);
+
+        case ST_UNAUTHORIZED:
+            LOG.info("Unauthorized by the Server, please check your credentials.");
+            if (saveNonceParam(config, &message) == false) {
+                LOG.debug("No new nonce received.");
+            }
+            notifyError(CTPService::CTP_ERROR_UNAUTHORIZED);
+            fail(3);
+            return false;
+
+        case ST_FORBIDDEN:
+            LOG.info("Authentication forbidden by the Server, please check your credentials.");
+            notifyError(CTPService::CTP_ERROR_AUTH_FORBIDDEN);
+            fail(4);
+            return false;
+
+        case ST_ERROR:
+            LOG.info("Received ERROR status from Server: restore ctp connection");
+            notifyError(CTPService::CTP_ERROR_RECEIVED_STATUS_ERROR);
+            return false;
+
+        default:
+            LOG.error("Unexpected status received '0x%02x' -> restore ctp connection", authStatus);
+            notifyError(CTPService::CTP_ERROR_RECEIVED_WRONG_COMMAND);
+            return false;
+    }
+}
+
+bool CTPSession::handleJump(CTPMessage& message) {
+
+    if (message.params.size() < 1) {
+        // Expected FROM and TO params -> restore connection
+        LOG.error("Error receiving JUMP Status message: some parameter is missing");
+        return false;
+    }
+
+    // Read FROM and TO parameters and update CTPConfig
+    CTPParam* param = (CTPParam*)message.params.front();
+    while (param) {
+        int valueLen = param->getValueLength();
+        void* value  = param->getValue();
+        if (param->getParamCode() == P_FROM) {
+            char* from = stringdup((char*)value, valueLen);
+            config.setUrlFrom(from);
+            delete [] from;
+        }
+        else if (param->getParamCode() == P_TO) {
+            char* url = stringdup((char*)value, valueLen);
+            StringBuffer to = config.getHostName(url);
+            int port = config.getHostPort(url);
+            config.setUrlTo(to);
+            config.setCtpPort(port);
+            delete [] url;
+        }
+        else {
+            LOG.error("Error receiving JUMP Status message: unexpected param '0x%02x'",
+                      param->getParamCode());
+            return false;
+        }
+        param = (CTPParam*)message.params.next();
+    }
+
+    LOG.debug("JUMP status received: FROM %s TO %s:%d", config.getUrlFrom().c_str(),
+              config.getUrlTo().c_str(), config.getCtpPort());
+
+    // Close the connection and reconnect to the new Server address
+    jump = true;
+    return false;
+}
+
+
+void CTPSession::scheduleRestore(int64_t now) {
+
+    state = CTPService::CTP_STATE_SLEEPING;
+
+    int32_t ctpRetry    = config.getCtpRetry();
+    int32_t maxCtpRetry = config.getMaxCtpRetry();
+    int32_t sleepTime   = ctpRetry < maxCtpRetry ? ctpRetry : maxCtpRetry;
+
+    LOG.info("CTP will be restored in %d seconds...", sleepTime);
+    if (sleepTime == maxCtpRetry) {
+        // In case the max retry time is reached
+        notifyError(CTPService::CTP_ERROR_CONNECTION_FAILED, sleepTime * 1000);
+    }
+    retryDeadline = now + (int64_t)sleepTime * 1000;
+
+    // Double the retry time for the next restore
+    config.setCtpRetry(sleepTime * CTP_RETRY_INCREASE_FACTOR);
+}
+
+void CTPSession::fail(int32_t code) {
+
+    LOG.debug("CTP session stopped (code %d)", code);
+    errorCode = code;
+    finished  = true;
+    // Restore the original ctpRetry time
+    config.setCtpRetry(defaultCtpRetry);
+}
+
+
+void CTPSession::notifySync(SyncNotification* sn) {
+
+    ArrayList uriList = getUriListFromSAN(sn);
+    if (observer) {
+        observer->onSyncNotification(*this, uriList);
+    }
+    else if (pushListener) {
+        pushListener->onNotificationReceived(uriList);
+    }
+    else {
+        LOG.debug("No pushListener registered, push message lost.");
+    }
+}
+
+void CTPSession::notifyError(const int code, const int additionalInfo) {
+
+    if (observer) {
+        observer->onCTPError(*this, code, additionalInfo);
+    }
+    else if (pushListener) {
+        pushListener->onCTPError(code, additionalInfo);
+    }
+}
+
+
+StringBuffer CTPSession::createMD5Credentials(CTPConfig& config, DMTClientConfig* clientConfig) {
+
+    const char*  username    = clientConfig->getUsername();
+    const char*  password    = clientConfig->getPassword();
+    StringBuffer clientNonce = config.getCtpNonce();
+
+    char* credential = MD5CredentialData(username, password, clientNonce.c_str());
+    if (credential) {
+        StringBuffer ret(credential);
+        delete [] credential;
+        return ret;
+    }
+
+    StringBuffer emptyRes;
+    return emptyRes;
+}
+
+bool CTPSession::saveNonceParam(CTPConfig& config, CTPMessage* authStatusMsg) {
+
+    if (authStatusMsg->params.size() == 0) {
+        return false;
+    }
+
+    // Get nonce param
+    int nonceLen = 0;
+    void* nonce  = NULL;
+    CTPParam* param = (CTPParam*)authStatusMsg->params.front();
+    if (param && param->getParamCode() == P_NONCE) {
+        nonceLen = param->getValueLength();
+        nonce    = param->getValue();
+    }
+    else {
+        return false;
+    }
+    if (!nonce || nonceLen == 0) {
+        return false;
+    }
+
+    // Nonce is encoded in b64.
+    char* b64Nonce = new char[((nonceLen/3+1)<<2) + 32];
+    int len = b64_encode(b64Nonce, nonce, nonceLen);
+    b64Nonce[len] = 0;
+
+    LOG.debug("New nonce received: '%s'", b64Nonce);
+
+    // Save new nonce to config, and save config!
+    config.setCtpNonce(b64Nonce);
+    config.saveCTPConfig();
+
+    delete [] b64Nonce;
+    return true;
+}
+
+ArrayList CTPSession::getUriListFromSAN(SyncNotification* sn) {
+
+    ArrayList list;
+    int n = 0;
+
+    if (!sn) {
+        LOG.error("CTP notification error: SyncNotification is NULL");
+        return list;
+    }
+
+    // Get number of sources to sync
+    n = sn->getNumSyncs();
+    if (!n) {
+        LOG.error("CTP notification error: no sources to sync from server");
+        return list;
+    }
+
+    // Compose the array of ServerURI names
+    for (int i=0; i<n; i++) {
+        SyncAlert* sync = sn->getSyncAlert(i);
+        if (!sync) {
+            LOG.error("CTP notification error: no SyncAlert in SyncNotification");
+            continue;
+        }
+        if (sync->getServerURI()) {
+            StringBuffer uri(sync->getServerURI());
+            list.add(uri);
+            LOG.debug("uri pushed: '%s'", uri.c_str());
+        }
+        else {
+            LOG.error("CTP notification error: no source found from server notification request");
+        }
+    }
+
+    if (list.size() == 0) {
+        // 0 sources to sync -> out
+        LOG.info("No sources to sync");
+    }
+    return list;
+}
+
+} // end namespace Funambol
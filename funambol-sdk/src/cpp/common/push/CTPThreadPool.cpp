@@ -64,21 +64,6 @@ private:
 };
 
 
-CmdTimeoutThread* CTPThreadPool::createCmdTimeoutThread(CTPService* ctpService_) {
-    CmdTimeoutThread* res = new CmdTimeoutThread(ctpService_);
-    ThreadElement te(res);
-    threadList.add(te);
-    return res;
-}
-
-
-HeartbeatThread* CTPThreadPool::createHeartbeatThread(CTPService* ctpService_) {
-    HeartbeatThread* res = new HeartbeatThread(ctpService_);
-    ThreadElement te(res);
-    threadList.add(te);
-    return res;
-}
-
 ReceiverThread* CTPThreadPool::createReceiverThread(CTPService* ctpService_) {
     ReceiverThread* res = new ReceiverThread(ctpService_);
     ThreadElement te(res);
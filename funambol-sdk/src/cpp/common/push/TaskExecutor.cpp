@@ -0,0 +1,504 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+#include "spds/AbstractSyncConfig.h"
+
+#include "push/FThread.h"
+#include "push/TaskExecutor.h"
+
+namespace Funambol {
+
+/// Number of CPUs available, at least 1.
+static int cpuCount() {
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = (int)info.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? n : 1;
+}
+
+/// Absolute realtime deadline after 'millis', for pthread_cond_timedwait.
+static void deadline(struct timespec& t, int64_t millis) {
+#ifdef WIN32
+    t.tv_sec  = time(NULL);
+    t.tv_nsec = 0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    t.tv_sec  = tv.tv_sec;
+    t.tv_nsec = tv.tv_usec * 1000;
+#endif
+    t.tv_sec  += (time_t)(millis / 1000);
+    t.tv_nsec += (long)(millis % 1000) * 1000000;
+    if (t.tv_nsec >= 1000000000) {
+        t.tv_nsec -= 1000000000;
+        t.tv_sec++;
+    }
+}
+
+
+//------------------------------------------------------------------ Task
+
+Task::Task(Priority p) : priority(p), status(Pending), cancelled(false),
+                         config(NULL), refs(0) {
+
+    if (priority < HighPriority || priority > LowPriority) {
+        priority = NormalPriority;
+    }
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&finished, NULL);
+}
+
+Task::~Task() {
+    pthread_cond_destroy(&finished);
+    pthread_mutex_destroy(&mutex);
+}
+
+Task::Status Task::getStatus() {
+
+    pthread_mutex_lock(&mutex);
+    Status s = status;
+    pthread_mutex_unlock(&mutex);
+    return s;
+}
+
+bool Task::isCancelled() {
+
+    pthread_mutex_lock(&mutex);
+    bool ret = cancelled;
+    pthread_mutex_unlock(&mutex);
+    return ret || (config && config->isToAbort());
+}
+
+bool Task::cancel() {
+
+    pthread_mutex_lock(&mutex);
+    cancelled = true;
+    bool ret = (status == Pending);
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+void Task::retain() {
+
+    pthread_mutex_lock(&mutex);
+    refs++;
+    pthread_mutex_unlock(&mutex);
+}
+
+void Task::release() {
+
+    pthread_mutex_lock(&mutex);
+    bool last = (--refs == 0);
+    pthread_mutex_unlock(&mutex);
+    if (last) {
+        delete this;
+    }
+}
+
+void Task::finish(Status s) {
+
+    pthread_mutex_lock(&mutex);
+    status = s;
+    pthread_cond_broadcast(&finished);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+//------------------------------------------------------------------ TaskFuture
+
+TaskFuture::TaskFuture() : task(NULL) {}
+
+TaskFuture::TaskFuture(Task* t) : task(t) {
+    if (task) {
+        task->retain();
+    }
+}
+
+TaskFuture::TaskFuture(const TaskFuture& other) : task(other.task) {
+    if (task) {
+        task->retain();
+    }
+}
+
+TaskFuture& TaskFuture::operator=(const TaskFuture& other) {
+
+    if (other.task) {
+        other.task->retain();
+    }
+    if (task) {
+        task->release();
+    }
+    task = other.task;
+    return *this;
+}
+
+TaskFuture::~TaskFuture() {
+    if (task) {
+        task->release();
+    }
+}
+
+bool TaskFuture::isDone() {
+
+    if (!task) {
+        return false;
+    }
+    Task::Status s = task->getStatus();
+    return (s == Task::Done || s == Task::Cancelled);
+}
+
+bool TaskFuture::isCancelled() {
+    return task && task->getStatus() == Task::Cancelled;
+}
+
+bool TaskFuture::cancel() {
+    return task && task->cancel();
+}
+
+bool TaskFuture::wait(int64_t timeoutMillis) {
+
+    if (!task) {
+        return false;
+    }
+
+    struct timespec t;
+    if (timeoutMillis >= 0) {
+        deadline(t, timeoutMillis);
+    }
+
+    pthread_mutex_lock(&task->mutex);
+    while (task->status == Task::Pending || task->status == Task::Running) {
+        if (timeoutMillis < 0) {
+            pthread_cond_wait(&task->finished, &task->mutex);
+        } else if (pthread_cond_timedwait(&task->finished, &task->mutex, &t) != 0) {
+            break;
+        }
+    }
+    bool ret = (task->status == Task::Done || task->status == Task::Cancelled);
+    pthread_mutex_unlock(&task->mutex);
+    return ret;
+}
+
+
+//------------------------------------------------------------------ Worker
+
+class TaskExecutor::Worker : public FThread {
+
+public:
+
+    Worker(TaskExecutor& e, int i) : FThread(), executor(e), index(i) {
+        pthread_mutex_init(&mutex, NULL);
+    }
+
+    ~Worker() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    TaskExecutor& executor;
+    int           index;
+
+    /// One deque per priority: the owner works at the back, thieves at the front
+    std::deque<Task*> tasks[TASK_PRIORITY_COUNT];
+    pthread_mutex_t   mutex;
+
+protected:
+
+    void run() {
+        executor.workerLoop(this);
+    }
+};
+
+
+//------------------------------------------------------------------ TaskExecutor
+
+TaskExecutor* TaskExecutor::pinstance = NULL;
+
+static pthread_mutex_t instanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+TaskExecutor* TaskExecutor::getInstance() {
+
+    pthread_mutex_lock(&instanceMutex);
+    if (pinstance == NULL) {
+        pinstance = new TaskExecutor();
+    }
+    pthread_mutex_unlock(&instanceMutex);
+    return pinstance;
+}
+
+void TaskExecutor::dispose() {
+
+    pthread_mutex_lock(&instanceMutex);
+    if (pinstance) {
+        delete pinstance; pinstance = NULL;
+    }
+    pthread_mutex_unlock(&instanceMutex);
+}
+
+
+TaskExecutor::TaskExecutor(int workerCount) : queued(0), stopping(false) {
+
+    if (workerCount <= 0) {
+        workerCount = cpuCount();
+    }
+    if (workerCount > TASK_EXECUTOR_MAX_WORKERS) {
+        workerCount = TASK_EXECUTOR_MAX_WORKERS;
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&available, NULL);
+    pthread_key_create(&currentWorker, NULL);
+
+    for (int i = 0; i < workerCount; i++) {
+        workers.push_back(new Worker(*this, i));
+    }
+    for (int i = 0; i < workerCount; i++) {
+        workers[i]->start();
+    }
+    LOG.debug("%s: started %d workers", __FUNCTION__, workerCount);
+}
+
+TaskExecutor::~TaskExecutor() {
+
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_mutex_unlock(&mutex);
+
+    cancelAll();
+
+    pthread_mutex_lock(&mutex);
+    pthread_cond_broadcast(&available);
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->wait();
+        delete workers[i];
+    }
+    workers.clear();
+
+    pthread_key_delete(currentWorker);
+    pthread_cond_destroy(&available);
+    pthread_mutex_destroy(&mutex);
+}
+
+TaskFuture TaskExecutor::submit(Task* task, AbstractSyncConfig* config) {
+
+    if (task == NULL) {
+        return TaskFuture();
+    }
+
+    task->config = config;
+    TaskFuture future(task);
+    task->retain();                 // released by runTask() or cancelAll()
+
+    pthread_mutex_lock(&mutex);
+    if (stopping) {
+        pthread_mutex_unlock(&mutex);
+        LOG.error("%s: executor stopping, task cancelled", __FUNCTION__);
+        task->finish(Task::Cancelled);
+        task->release();
+        return future;
+    }
+
+    // a worker keeps its subtasks, the others go on the shared queue
+    Worker* worker = static_cast<Worker*>(pthread_getspecific(currentWorker));
+    if (worker == NULL || &worker->executor != this) {
+        shared[task->getPriority()].push_back(task);
+        queued++;
+        pthread_cond_signal(&available);
+        pthread_mutex_unlock(&mutex);
+        return future;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->tasks[task->getPriority()].push_back(task);
+    pthread_mutex_unlock(&worker->mutex);
+
+    pthread_mutex_lock(&mutex);
+    queued++;
+    pthread_cond_signal(&available);
+    pthread_mutex_unlock(&mutex);
+
+    return future;
+}
+
+void TaskExecutor::cancelAll() {
+
+    std::vector<Task*> dropped;
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker* worker = workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        for (int p = 0; p < TASK_PRIORITY_COUNT; p++) {
+            dropped.insert(dropped.end(), worker->tasks[p].begin(), worker->tasks[p].end());
+            worker->tasks[p].clear();
+        }
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    pthread_mutex_lock(&mutex);
+    for (int p = 0; p < TASK_PRIORITY_COUNT; p++) {
+        dropped.insert(dropped.end(), shared[p].begin(), shared[p].end());
+        shared[p].clear();
+    }
+    queued -= (int)dropped.size();
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < dropped.size(); i++) {
+        dropped[i]->cancel();
+        dropped[i]->finish(Task::Cancelled);
+        dropped[i]->release();
+    }
+}
+
+int TaskExecutor::getQueuedCount() {
+
+    pthread_mutex_lock(&mutex);
+    int ret = queued;
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+Task* TaskExecutor::take(int index) {
+
+    int count = (int)workers.size();
+    Task* task = NULL;
+
+    for (int p = 0; p < TASK_PRIORITY_COUNT && task == NULL; p++) {
+        // newest of our own
+        Worker* own = workers[index];
+        pthread_mutex_lock(&own->mutex);
+        if (!own->tasks[p].empty()) {
+            task = own->tasks[p].back();
+            own->tasks[p].pop_back();
+        }
+        pthread_mutex_unlock(&own->mutex);
+        if (task) {
+            break;
+        }
+
+        // oldest submitted from outside
+        pthread_mutex_lock(&mutex);
+        if (!shared[p].empty()) {
+            task = shared[p].front();
+            shared[p].pop_front();
+            queued--;
+            pthread_mutex_unlock(&mutex);
+            return task;
+        }
+        pthread_mutex_unlock(&mutex);
+
+        // oldest of the others
+        for (int i = 1; i < count && task == NULL; i++) {
+            Worker* victim = workers[(index + i) % count];
+            pthread_mutex_lock(&victim->mutex);
+            if (!victim->tasks[p].empty()) {
+                task = victim->tasks[p].front();
+                victim->tasks[p].pop_front();
+            }
+            pthread_mutex_unlock(&victim->mutex);
+        }
+    }
+
+    if (task) {
+        pthread_mutex_lock(&mutex);
+        queued--;
+        pthread_mutex_unlock(&mutex);
+    }
+    return task;
+}
+
+void TaskExecutor::runTask(Task* task) {
+
+    pthread_mutex_lock(&task->mutex);
+    bool skip = task->cancelled;
+    if (!skip) {
+        task->status = Task::Running;
+    }
+    pthread_mutex_unlock(&task->mutex);
+
+    if (!skip && task->config && task->config->isToAbort()) {
+        skip = true;
+    }
+
+    if (skip) {
+        task->finish(Task::Cancelled);
+    } else {
+        task->run();
+        task->finish(Task::Done);
+    }
+    task->release();
+}
+
+void TaskExecutor::workerLoop(Worker* worker) {
+
+    pthread_setspecific(currentWorker, worker);
+
+    while (1) {
+        Task* task = take(worker->index);
+        if (task) {
+            runTask(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&mutex);
+        while (queued == 0 && !stopping) {
+            pthread_cond_wait(&available, &mutex);
+        }
+        bool exit = stopping && queued == 0;
+        pthread_mutex_unlock(&mutex);
+        if (exit) {
+            break;
+        }
+    }
+}
+
+} // end namespace Funambol
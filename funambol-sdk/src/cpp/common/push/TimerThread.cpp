@@ -0,0 +1,163 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <time.h>
+#include <errno.h>
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+
+#include "push/TimerThread.h"
+
+namespace Funambol {
+
+TimerThread* TimerThread::pinstance = NULL;
+
+static pthread_mutex_t instanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+TimerThread* TimerThread::getInstance() {
+
+    pthread_mutex_lock(&instanceMutex);
+    if (pinstance == NULL) {
+        pinstance = new TimerThread();
+        pinstance->start();
+    }
+    pthread_mutex_unlock(&instanceMutex);
+    return pinstance;
+}
+
+void TimerThread::dispose() {
+
+    pthread_mutex_lock(&instanceMutex);
+    if (pinstance) {
+        pinstance->softTerminate();
+        pinstance->wait();
+        delete pinstance; pinstance = NULL;
+    }
+    pthread_mutex_unlock(&instanceMutex);
+}
+
+
+TimerThread::TimerThread() : FThread(), changed(false) {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+TimerThread::~TimerThread() {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool TimerThread::schedule(TimerTask* task, int64_t delayMillis) {
+
+    if (!wheel.schedule(task, delayMillis, TimerWheel::now())) {
+        return false;
+    }
+    pthread_mutex_lock(&mutex);
+    changed = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+bool TimerThread::cancel(TimerTask* task) {
+    return wheel.cancel(task);
+}
+
+void TimerThread::softTerminate() {
+
+    pthread_mutex_lock(&mutex);
+    terminate = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+void TimerThread::run() {
+
+    LOG.debug("Starting timer thread");
+
+    pthread_mutex_lock(&mutex);
+    while (!terminate) {
+        changed = false;
+        pthread_mutex_unlock(&mutex);
+
+        int64_t now = TimerWheel::now();
+        wheel.expire(now);
+        int64_t next = wheel.getNextExpiry(TimerWheel::now());
+
+        pthread_mutex_lock(&mutex);
+        if (terminate || changed) {
+            continue;
+        }
+        if (next < 0) {
+            pthread_cond_wait(&cond, &mutex);
+            continue;
+        }
+
+        int64_t delta = next - TimerWheel::now();
+        if (delta <= 0) {
+            continue;
+        }
+
+        // pthread_cond_timedwait uses the realtime clock
+        struct timespec t;
+#ifdef WIN32
+        t.tv_sec  = time(NULL);
+        t.tv_nsec = 0;
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        t.tv_sec  = tv.tv_sec;
+        t.tv_nsec = tv.tv_usec * 1000;
+#endif
+        t.tv_sec  += (time_t)(delta / 1000);
+        t.tv_nsec += (long)(delta % 1000) * 1000000;
+        if (t.tv_nsec >= 1000000000) {
+            t.tv_nsec -= 1000000000;
+            t.tv_sec++;
+        }
+        pthread_cond_timedwait(&cond, &mutex, &t);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    LOG.debug("Exiting timer thread");
+}
+
+} // end namespace Funambol
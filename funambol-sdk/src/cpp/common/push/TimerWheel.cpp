@@ -0,0 +1,341 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+
+#include "push/TimerWheel.h"
+
+namespace Funambol {
+
+/// Max number of ticks a task can be scheduled ahead
+#define TIMER_WHEEL_MAX_TICKS   (((int64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+
+TimerTask::TimerTask() : prev(NULL), next(NULL), wheel(NULL),
+                         expires(0), level(0), slot(0)
+{
+}
+
+TimerTask::~TimerTask() {
+    if (wheel) {
+        wheel->cancel(this);
+    }
+}
+
+
+TimerWheel::TimerWheel(int32_t tickMillis) :
+    tick(tickMillis > 0 ? tickMillis : TIMER_WHEEL_TICK),
+    currentTick(0), initialized(false), count(0), expiredCount(0),
+    expired(NULL), runningTask(NULL)
+{
+    memset(slots, 0, sizeof(slots));
+    memset(&runningThread, 0, sizeof(runningThread));
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&taskDone, NULL);
+}
+
+TimerWheel::~TimerWheel() {
+
+    pthread_mutex_lock(&mutex);
+    for (int l = 0; l < TIMER_WHEEL_LEVELS; l++) {
+        for (int s = 0; s < TIMER_WHEEL_SLOTS; s++) {
+            while (slots[l][s]) {
+                unlink(slots[l][s]);
+            }
+        }
+    }
+    while (expired) {
+        unlink(expired);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    pthread_cond_destroy(&taskDone);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool TimerWheel::schedule(TimerTask* task, int64_t delayMillis, int64_t now) {
+
+    if (!task) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (task->wheel && task->wheel != this) {
+        pthread_mutex_unlock(&mutex);
+        LOG.error("%s: task already scheduled on another wheel", __FUNCTION__);
+        return false;
+    }
+    if (task->wheel) {
+        unlink(task);
+    }
+    if (!initialized) {
+        currentTick = now / tick;
+        initialized = true;
+    }
+    if (delayMillis < 0) {
+        delayMillis = 0;
+    }
+
+    // Round up: a task never expires before its delay
+    int64_t expires = (now + delayMillis + tick - 1) / tick;
+    task->expires = expires < currentTick ? currentTick : expires;
+    link(task);
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+bool TimerWheel::cancel(TimerTask* task) {
+
+    if (!task) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mutex);
+    bool ret = false;
+    if (task->wheel == this) {
+        unlink(task);
+        ret = true;
+    }
+    while (runningTask == task && !pthread_equal(runningThread, pthread_self())) {
+        pthread_cond_wait(&taskDone, &mutex);
+        // The task may have scheduled itself again while running
+        if (task->wheel == this) {
+            unlink(task);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+int32_t TimerWheel::expire(int64_t now) {
+
+    pthread_mutex_lock(&mutex);
+
+    int64_t nowTick = now / tick;
+    if (!initialized) {
+        currentTick = nowTick;
+        initialized = true;
+    }
+
+    while (currentTick <= nowTick) {
+        if (count == expiredCount) {
+            // Nothing left in the slots: jump ahead
+            currentTick = nowTick + 1;
+            break;
+        }
+        int index = (int)(currentTick & TIMER_WHEEL_MASK);
+        if (index == 0) {
+            cascade(1);
+        }
+
+        // Move the tasks of this tick to the expired list
+        while (slots[0][index]) {
+            TimerTask* task = slots[0][index];
+            unlink(task);
+            task->wheel = this;
+            task->level = -1;
+            task->prev  = NULL;
+            task->next  = expired;
+            if (expired) {
+                expired->prev = task;
+            }
+            expired = task;
+            count++;
+            expiredCount++;
+        }
+        currentTick++;
+    }
+
+    // Run the expired tasks one by one, so they can be cancelled meanwhile
+    int32_t run = 0;
+    while (expired) {
+        TimerTask* task = expired;
+        unlink(task);
+        runningTask   = task;
+        runningThread = pthread_self();
+        pthread_mutex_unlock(&mutex);
+
+        task->onTimeout();
+        run++;
+
+        pthread_mutex_lock(&mutex);
+        runningTask = NULL;
+        pthread_cond_broadcast(&taskDone);
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return run;
+}
+
+int64_t TimerWheel::getNextExpiry(int64_t now) {
+
+    pthread_mutex_lock(&mutex);
+
+    int64_t ret = -1;
+    if (count == 0) {
+        goto finally;
+    }
+    if (expired) {
+        ret = now;
+        goto finally;
+    }
+
+    // First non empty slot of the lowest level, up to the next cascade
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        int64_t t = currentTick + i;
+        if ((t & TIMER_WHEEL_MASK) == 0 || slots[0][t & TIMER_WHEEL_MASK]) {
+            ret = t * tick;
+            break;
+        }
+    }
+
+finally:
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+int32_t TimerWheel::size() {
+
+    pthread_mutex_lock(&mutex);
+    int32_t ret = count;
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+int64_t TimerWheel::now() {
+
+#ifdef WIN32
+    return (int64_t)GetTickCount64();
+#else
+#  ifdef CLOCK_MONOTONIC
+    struct timespec t;
+    if (clock_gettime(CLOCK_MONOTONIC, &t) == 0) {
+        return (int64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+    }
+#  endif
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+
+/// Puts the task in the slot for its expiry. Called with the mutex held.
+void TimerWheel::link(TimerTask* task) {
+
+    int64_t delta = task->expires - currentTick;
+    if (delta < 0) {
+        delta = 0;
+        task->expires = currentTick;
+    }
+    else if (delta > TIMER_WHEEL_MAX_TICKS) {
+        delta = TIMER_WHEEL_MAX_TICKS;
+        task->expires = currentTick + delta;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((int64_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((task->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+
+    task->wheel = this;
+    task->level = level;
+    task->slot  = slot;
+    task->prev  = NULL;
+    task->next  = slots[level][slot];
+    if (task->next) {
+        task->next->prev = task;
+    }
+    slots[level][slot] = task;
+    count++;
+}
+
+/// Removes the task from its slot (or the expired list). Called with the mutex held.
+void TimerWheel::unlink(TimerTask* task) {
+
+    TimerTask** head = (task->level < 0) ? &expired : &slots[task->level][task->slot];
+    if (task->prev) {
+        task->prev->next = task->next;
+    } else {
+        *head = task->next;
+    }
+    if (task->next) {
+        task->next->prev = task->prev;
+    }
+    if (task->level < 0) {
+        expiredCount--;
+    }
+    task->prev  = NULL;
+    task->next  = NULL;
+    task->wheel = NULL;
+    count--;
+}
+
+/**
+ * Moves the tasks of the current slot of 'level' to the lower levels, and
+ * cascades the upper level too when this one wraps. Called with the mutex held.
+ */
+void TimerWheel::cascade(int level) {
+
+    if (level >= TIMER_WHEEL_LEVELS) {
+        return;
+    }
+    int index = (int)((currentTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    if (index == 0) {
+        cascade(level + 1);
+    }
+
+    TimerTask* task = slots[level][index];
+    slots[level][index] = NULL;
+    while (task) {
+        TimerTask* next = task->next;
+        count--;
+        link(task);
+        task = next;
+    }
+}
+
+} // end namespace Funambol
@@ -36,9 +36,27 @@
 #include "sapi/SapiMediaJsonParser.h"
 #include "base/Log.h"
 #include "base/util/utils.h"
+#include "base/util/JsonWriter.h"
 
 BEGIN_FUNAMBOL_NAMESPACE
 
+/**
+ * Writes the numeric item IDs (stored as StringBuffers) as elements
+ * of the currently open JSON array; empty IDs are skipped.
+ */
+static void writeItemIds(JsonWriter& writer, const ArrayList& itemsIDs)
+{
+    int itemsCount = itemsIDs.size();
+    
+    for (int i = 0; i < itemsCount; i++) {
+        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
+        
+        if ((itemIdStr) && (itemIdStr->empty() == false)) {
+            writer.addInt(NULL, atoi(itemIdStr->c_str()));
+        }
+    }
+}
+
 SapiMediaJsonParser::SapiMediaJsonParser()
 {
     errorCode.reset();
@@ -491,50 +509,21 @@ bool SapiMediaJsonParser::parseMediaAddItem(const char* itemMetaDataUploadJson,
     return true;
 }
 
-bool SapiMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, bool prettyPrint)
+bool SapiMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, bool prettyPrint)
 {
-    cJSON *root = NULL, *ids = NULL; 
-    int itemsCount = 0;
-    
-    if ((itemsCount = itemsIDs.size()) == 0) {
+    if (itemsIDs.size() == 0) {
         return false;
     }
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-   
-    if ((ids = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-     
-    for (int i = 0; i < itemsCount; i++) {
-        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
-        
-        if ((itemIdStr) && (itemIdStr->empty() == false)) {
-            int itemId = atoi(itemIdStr->c_str());
-            cJSON* jsonItemId = cJSON_CreateInt((long)itemId);
-            
-            cJSON_AddItemToArray(ids, jsonItemId);
-        }
-    }
-    
-    cJSON_AddItemToObject(root, "ids", ids);
-    
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    cJSON_Delete(root);
+    writer.beginObject();
+    writer.beginArray("ids");
+    writeItemIds(writer, itemsIDs);
+    writer.endArray();
+    writer.endObject();
    
-    if (*itemsListJsonObject == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -542,102 +531,77 @@ bool SapiMediaJsonParser::formatItemsListObject(const ArrayList& itemsIDs, char
     return true;
 }
 
-bool SapiMediaJsonParser::formatMediaItemMetaData(SapiSyncItemInfo* itemInfo, char** itemJsonMetaData, bool prettyPrint)
+bool SapiMediaJsonParser::formatMediaItemMetaData(SapiSyncItemInfo* itemInfo, StringBuffer& itemJsonMetaData, bool prettyPrint)
 {
-    cJSON *root = NULL, *data = NULL;
     const char* itemGuid = NULL;
     const char* itemName = NULL;
     const char* itemContentType = NULL;
     size_t itemSize = 0;
     time_t itemCreationDate = 0, itemModificationDate = 0;
-    StringBuffer utcDate;
+    StringBuffer creationDate, modificationDate;
     
     if (itemInfo == NULL) {
         return false;
     }
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
- 
-     if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-
-    itemGuid = itemInfo->getGuid();
-    
-    if ((itemGuid != NULL) && (strlen(itemGuid) > 0)) {
-        LOG.debug("%s: formatting item GUID '%s' into json message",
-            __FUNCTION__, itemGuid);
-            
-        cJSON_AddStringToObject(data, "id", itemGuid);
-    }
-    
+    // validate all fields before emitting anything
     itemName = itemInfo->getName();
     if ((itemName == NULL) || (strlen(itemName) == 0)) {
         LOG.error("%s: missing name in item info", __FUNCTION__);
-        cJSON_Delete(root);
         
         return false;
     }
-        
-    cJSON_AddStringToObject(data, "name", itemName);
-    
-    itemContentType = itemInfo->getContentType();
-    if (itemContentType) {
-        cJSON_AddStringToObject(data, "contenttype", itemContentType);
-    }
     
     if ((itemSize = itemInfo->getSize()) == 0) {
         LOG.error("%s: invalid size parameter in item info", __FUNCTION__);
-        cJSON_Delete(root);
         
         return false;
     }
-        
-    cJSON_AddIntToObject(data, "size", itemSize);
     
     itemCreationDate = itemInfo->getCreationDate();
-    
-    utcDate = unixTimeToString((unsigned long)itemCreationDate, true);
-    if (utcDate.empty()) {
+    creationDate = unixTimeToString((unsigned long)itemCreationDate, true);
+    if (creationDate.empty()) {
         LOG.error("%s: error convering item creation date in UTC string", __FUNCTION__);
         
-        cJSON_Delete(root);
-        
         return false;
     }
     
-    cJSON_AddStringToObject(data, "creationdate", utcDate.c_str());
-    
     itemModificationDate = itemInfo->getModificationDate();
-    utcDate = unixTimeToString((unsigned long)itemModificationDate, true);
-    if (utcDate.empty()) {
+    modificationDate = unixTimeToString((unsigned long)itemModificationDate, true);
+    if (modificationDate.empty()) {
         LOG.error("%s: error convering item modification date in UTC string", __FUNCTION__);
         
-        cJSON_Delete(root);
-        
         return false;
     }
     
-    cJSON_AddStringToObject(data, "modificationdate", utcDate.c_str());
+    JsonWriter writer(itemJsonMetaData, prettyPrint);
     
-    cJSON_AddItemToObject(root, "data", data);
+    writer.beginObject();
+    writer.beginObject("data");
     
-    if (prettyPrint) {
-        *itemJsonMetaData = cJSON_Print(root);
-    } else {
-        *itemJsonMetaData = cJSON_PrintUnformatted(root);
+    itemGuid = itemInfo->getGuid();
+    if ((itemGuid != NULL) && (strlen(itemGuid) > 0)) {
+        LOG.debug("%s: formatting item GUID '%s' into json message",
+            __FUNCTION__, itemGuid);
+            
+        writer.addString("id", itemGuid);
     }
+    
+    writer.addString("name", itemName);
+    
+    itemContentType = itemInfo->getContentType();
+    if (itemContentType) {
+        writer.addString("contenttype", itemContentType);
+    }
+    
+    writer.addInt("size", (int64_t)itemSize);
+    writer.addString("creationdate", creationDate.c_str());
+    writer.addString("modificationdate", modificationDate.c_str());
+    
+    writer.endObject();
+    writer.endObject();
    
-    cJSON_Delete(root);
-   
-    if ((*itemJsonMetaData == NULL) || (strlen(*itemJsonMetaData) == 0)) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
     
         return false;
@@ -1113,59 +1077,24 @@ ESMPStatus SapiMediaJsonParser::checkErrorMessage(cJSON* root, bool* error_flag)
     return ESMPNoError;
 }
 
-bool SapiMediaJsonParser::formatDelItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, 
+bool SapiMediaJsonParser::formatDelItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, 
                                                    const char* sourceName, bool prettyPrint)
 {
-    cJSON *root = NULL, *ids = NULL, *data = NULL; 
-    int itemsCount = 0;
-    
-    if ((itemsCount = itemsIDs.size()) == 0) {
-        return false;
-    }
-    
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
+    if (itemsIDs.size() == 0) {
         return false;
     }
-
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-   
-    if ((ids = cJSON_CreateArray()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-     
-    for (int i = 0; i < itemsCount; i++) {
-        StringBuffer* itemIdStr = static_cast<StringBuffer* >(itemsIDs.get(i));
-        
-        if ((itemIdStr) && (itemIdStr->empty() == false)) {
-            int itemId = atoi(itemIdStr->c_str());
-            cJSON* jsonItemId = cJSON_CreateInt((long)itemId);
-            
-            cJSON_AddItemToArray(ids, jsonItemId);
-        }
-    }
     
-    cJSON_AddItemToObject(data, sourceName, ids);
-
-    cJSON_AddItemToObject(root, "data", data);
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.beginArray(sourceName);
+    writeItemIds(writer, itemsIDs);
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
     
-    cJSON_Delete(root);
-   
-    if (*itemsListJsonObject == NULL) {
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -1173,9 +1102,8 @@ bool SapiMediaJsonParser::formatDelItemsListObject(const ArrayList& itemsIDs, ch
     return true;
 }
 
-bool SapiMediaJsonParser::formatRenameItemsListObject(SapiSyncItemInfo* itemInfo, char **itemsListJsonObject, bool prettyPrint)
+bool SapiMediaJsonParser::formatRenameItemsListObject(SapiSyncItemInfo* itemInfo, StringBuffer& itemsListJsonObject, bool prettyPrint)
 {
-    cJSON *root = NULL, *data = NULL;
     const char* itemGuid = NULL;
     const char* itemName = NULL;
     
@@ -1183,54 +1111,31 @@ bool SapiMediaJsonParser::formatRenameItemsListObject(SapiSyncItemInfo* itemInfo
         return false;
     }
     
-    if ((root = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        
-        return false;
-    }
-   
-   
-    if ((data = cJSON_CreateObject()) == NULL) {
-        LOG.error("error creating JSON object");
-        cJSON_Delete(root);
-        
-        return false;
-    }
-     
     itemGuid = itemInfo->getGuid();
     
-    if ((itemGuid != NULL) && (strlen(itemGuid) == 0)) {
-        LOG.debug("%s: formatting item GUID '%s' into json message",
-                        __FUNCTION__, itemGuid);
-        cJSON_Delete(root);
+    if ((itemGuid == NULL) || (strlen(itemGuid) == 0)) {
+        LOG.error("%s: missing GUID in item info", __FUNCTION__);
         
         return false;        
     }
     
-    int itemId = atoi(itemGuid);
-    cJSON_AddIntToObject(data, "id", (size_t)itemId);
-
     itemName = itemInfo->getName();
     if ((itemName == NULL) || (strlen(itemName) == 0)) {
         LOG.error("%s: missing name in item info", __FUNCTION__);
-        cJSON_Delete(root);
         
         return false;
     }
-        
-    cJSON_AddStringToObject(data, "name", itemName);
-            
-    cJSON_AddItemToObject(root, "data", data);
     
-    if (prettyPrint) {
-        *itemsListJsonObject = cJSON_Print(root);
-    } else {
-        *itemsListJsonObject = cJSON_PrintUnformatted(root);
-    }
+    JsonWriter writer(itemsListJsonObject, prettyPrint);
     
-    cJSON_Delete(root);
-   
-    if (*itemsListJsonObject == NULL) {
+    writer.beginObject();
+    writer.beginObject("data");
+    writer.addInt("id", atoi(itemGuid));
+    writer.addString("name", itemName);
+    writer.endObject();
+    writer.endObject();
+    
+    if (!writer.isComplete()) {
         LOG.error("%s: error formatting JSON object", __FUNCTION__);
         return false;
     }
@@ -408,7 +408,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::getItemsFromId(ArrayList& items
     StringBuffer itemsListRequestUrl;
     URL requestUrl;
     const char* itemsArrayKey = NULL;  
-    char* itemsIdsListJsonObject;     // formatted JSON object with items ids
+    StringBuffer itemsIdsListJsonObject;     // formatted JSON object with items ids
     char* itemsIdsListEncoded = NULL; // urlencoded formatted JSON object with items ids
     const char* itemsListJsonObject = NULL;  // sapi reponse with list of items info JSON objects  
     StringOutputStream response;
@@ -425,22 +425,20 @@ ESapiMediaRequestStatus SapiMediaRequestManager::getItemsFromId(ArrayList& items
         return ESMRInvalidParam;
     }
     
-    if (jsonSapiMediaObjectParser->formatItemsListObject(itemsIDs, &itemsIdsListJsonObject) == false) {
+    if (jsonSapiMediaObjectParser->formatItemsListObject(itemsIDs, itemsIdsListJsonObject) == false) {
         LOG.error("%s: error formatting json object for items list", __FUNCTION__);
         
         return ESMRInvalidParam;
     }
     
-    if ((itemsIdsListEncoded = URL::urlEncode(itemsIdsListJsonObject)) == NULL) {
+    if ((itemsIdsListEncoded = URL::urlEncode(itemsIdsListJsonObject.c_str())) == NULL) {
         LOG.error("%s: error url encoding formatted json object with items list", __FUNCTION__);
-        free(itemsIdsListJsonObject);
         
         return ESMRInvalidParam;
     }
     
     itemsListRequestUrl.sprintf(getUriWithIdsFmt, serverUrl.c_str(), sapiMediaSourceName, itemsIdsListEncoded);
     
-    free(itemsIdsListJsonObject);
     free(itemsIdsListEncoded);
     
     requestUrl.setURL(itemsListRequestUrl);
@@ -686,7 +684,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::getItemsChanges(ArrayList& newI
 
 ESapiMediaRequestStatus SapiMediaRequestManager::uploadItemMetaData(UploadSapiSyncItem* item)
 {
-    char* itemJsonMetaData;
+    StringBuffer itemJsonMetaData;
     const char* itemMetaDataUploadJson = NULL;
     SapiSyncItemInfo* itemInfo = NULL;
     StringBuffer itemId;
@@ -712,13 +710,13 @@ ESapiMediaRequestStatus SapiMediaRequestManager::uploadItemMetaData(UploadSapiSy
         return ESMRInvalidParam;
     }
     
-    if ((jsonSapiMediaObjectParser->formatMediaItemMetaData(itemInfo, &itemJsonMetaData)) == false) {
+    if ((jsonSapiMediaObjectParser->formatMediaItemMetaData(itemInfo, itemJsonMetaData)) == false) {
         LOG.error("%s: error formatting item meta data as json object", __FUNCTION__);
     
         return ESMRSapiMessageFormatError;
     }
     
-    LOG.debug("JSON request body to send:\n%s", itemJsonMetaData);
+    LOG.debug("JSON request body to send:\n%s", itemJsonMetaData.c_str());
    
     itemMetaDataAddRequestUrl.sprintf(saveItemMetaDataFmt, serverUrl.c_str(), sapiMediaSourceName);
     
@@ -731,15 +729,12 @@ ESapiMediaRequestStatus SapiMediaRequestManager::uploadItemMetaData(UploadSapiSy
     if ((status = httpConnection->open(requestUrl, HttpConnection::MethodPost)) != 0) {
         LOG.error("%s: error opening connection", __FUNCTION__);
         
-        free(itemJsonMetaData);
-        
         return ESMRConnectionSetupError;
     }
     
-    if ((status = httpConnection->request(itemJsonMetaData, response)) != HTTP_OK) {
+    if ((status = httpConnection->request(itemJsonMetaData.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
         httpConnection->close();
-        free(itemJsonMetaData);
         
         switch (status) {
             case HTTP_UNAUTHORIZED:
@@ -764,7 +759,6 @@ ESapiMediaRequestStatus SapiMediaRequestManager::uploadItemMetaData(UploadSapiSy
         }
     }
     
-    free(itemJsonMetaData);
     httpConnection->close();
     
     if ((itemMetaDataUploadJson = response.getString().c_str()) == NULL) {
@@ -1701,7 +1695,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::deleteItem(SapiSyncItemInfo* it
     const char* itemId = NULL;
     StringBuffer itemsListRequestUrl;
     const char* itemsArrayKey = NULL;
-    char* itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
+    StringBuffer itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
     URL requestUrl;
     StringOutputStream response;
     
@@ -1744,7 +1738,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::deleteItem(SapiSyncItemInfo* it
     ArrayList itemsIDs; 
     itemsIDs.add(s);
     
-    if (jsonSapiMediaObjectParser->formatDelItemsListObject(itemsIDs, &itemsIdsListJsonObject, itemsArrayKey, true) == false) {
+    if (jsonSapiMediaObjectParser->formatDelItemsListObject(itemsIDs, itemsIdsListJsonObject, itemsArrayKey, true) == false) {
         LOG.error("%s: error formatting json object for items list", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -1761,15 +1755,12 @@ ESapiMediaRequestStatus SapiMediaRequestManager::deleteItem(SapiSyncItemInfo* it
     if ((status = httpConnection->open(requestUrl, HttpConnection::MethodPost)) != 0) {
         LOG.error("%s: error opening connection", __FUNCTION__);
         
-        free(itemsIdsListJsonObject);
-        
         return ESMRConnectionSetupError;
     }
 
-    if ((status = httpConnection->request(itemsIdsListJsonObject, response)) != HTTP_OK) {
+    if ((status = httpConnection->request(itemsIdsListJsonObject.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
         httpConnection->close();
-        free(itemsIdsListJsonObject);
         
         switch (status) {
             case HTTP_UNAUTHORIZED:
@@ -1794,7 +1785,6 @@ ESapiMediaRequestStatus SapiMediaRequestManager::deleteItem(SapiSyncItemInfo* it
         }
     }
     
-    free(itemsIdsListJsonObject);
     httpConnection->close();
     
     const char* result = NULL;
@@ -1853,7 +1843,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::renameItem(SapiSyncItemInfo* it
     int status = 0;
     const char* itemId = NULL;
     StringBuffer itemsListRequestUrl;
-    char* itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
+    StringBuffer itemsIdsListJsonObject;     // formatted JSON object with items ids for delete    
     URL requestUrl;
     StringOutputStream response;
     
@@ -1874,7 +1864,7 @@ ESapiMediaRequestStatus SapiMediaRequestManager::renameItem(SapiSyncItemInfo* it
         return ESMRInvalidParam;
     }
         
-    if (jsonSapiMediaObjectParser->formatRenameItemsListObject(itemInfo, &itemsIdsListJsonObject, true) == false) {
+    if (jsonSapiMediaObjectParser->formatRenameItemsListObject(itemInfo, itemsIdsListJsonObject, true) == false) {
         LOG.error("%s: error formatting json object for items list", __FUNCTION__);
         
         return ESMRInvalidParam;
@@ -1891,15 +1881,12 @@ ESapiMediaRequestStatus SapiMediaRequestManager::renameItem(SapiSyncItemInfo* it
     if ((status = httpConnection->open(requestUrl, HttpConnection::MethodPost)) != 0) {
         LOG.error("%s: error opening connection", __FUNCTION__);
         
-        free(itemsIdsListJsonObject);
-        
         return ESMRConnectionSetupError;
     }
 
-    if ((status = httpConnection->request(itemsIdsListJsonObject, response)) != HTTP_OK) {
+    if ((status = httpConnection->request(itemsIdsListJsonObject.c_str(), response)) != HTTP_OK) {
         LOG.error("%s: error sending upload request", __FUNCTION__);
         httpConnection->close();
-        free(itemsIdsListJsonObject);
         
         switch (status) {
             case HTTP_UNAUTHORIZED:
@@ -1924,7 +1911,6 @@ ESapiMediaRequestStatus SapiMediaRequestManager::renameItem(SapiSyncItemInfo* it
         }
     }
     
-    free(itemsIdsListJsonObject);
     httpConnection->close();
     
     const char* result = NULL;
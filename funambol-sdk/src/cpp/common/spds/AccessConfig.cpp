@@ -76,6 +76,8 @@ AccessConfig::AccessConfig() {
     checkConn             = false;
     responseTimeout       = 0;
     compression           = false;
+    wbxml                 = false;
+    checkpoints           = false;
     encryptionMode        = NOT_ENCRYPTED;
     oauth2AccessToken     = "";
     oauth2AccessTokenSetTime = 0;
@@ -432,6 +434,8 @@ void AccessConfig::assign(const AccessConfig& s) {
     setCheckConn(s.getCheckConn());
     setResponseTimeout(s.getResponseTimeout());
     setCompression(s.getCompression());
+    setWBXML(s.getWBXML());
+    setCheckpoints(s.getCheckpoints());
     setEncryptionMode(s.getEncryptionMode());
 
     setOAuth2AccessToken(s.getOAuth2AccessToken());
@@ -465,3 +469,19 @@ bool AccessConfig::getCompression() const{
     return compression;
 }
 
+void AccessConfig::setWBXML(bool v) {
+    wbxml = v;
+}
+
+bool AccessConfig::getWBXML() const {
+    return wbxml;
+}
+
+void AccessConfig::setCheckpoints(bool v) {
+    checkpoints = v;
+}
+
+bool AccessConfig::getCheckpoints() const {
+    return checkpoints;
+}
+
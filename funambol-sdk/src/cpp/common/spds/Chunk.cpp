@@ -40,14 +40,16 @@
 
 USE_NAMESPACE
 
-Chunk::Chunk() : data(""), first(true), last(true), totalDataSize(0) {   
+Chunk::Chunk() : data(NULL), dataSize(0), first(true), last(true), totalDataSize(0) {   
 }
 
-Chunk::Chunk(const char* value) : first(true), last(true) {   
-    data.append(value);
+Chunk::Chunk(const char* value) : data(NULL), dataSize(0), first(true), last(true), totalDataSize(0) {   
+    setData(value);
 }
 
-Chunk::~Chunk() {}
+Chunk::~Chunk() {
+    delete [] data;
+}
 
 bool Chunk::isFirst() { 
     return first; 
@@ -67,16 +69,31 @@ void Chunk::setLast(bool v) {
 
 
 unsigned long Chunk::getDataSize() { 
-    return data.length(); 
+    return dataSize; 
 }
 
 
 void Chunk::setData(const char* value) { 
-   data = value;
+    delete [] data;
+    data     = stringdup(value ? value : "");
+    dataSize = strlen(data);
 }
 
 const char* Chunk::getData() { 
-   return data.c_str();
+   return data ? data : "";
+}
+
+void Chunk::adoptData(char* value, unsigned long len) {
+    delete [] data;
+    data     = value;
+    dataSize = value ? len : 0;
+}
+
+char* Chunk::releaseData() {
+    char* ret = data;
+    data     = NULL;
+    dataSize = 0;
+    return ret;
 }
 
 void Chunk::setTotalDataSize(unsigned long size) { 
@@ -85,7 +102,7 @@ void Chunk::setTotalDataSize(unsigned long size) {
 
 unsigned long Chunk::getTotalDataSize() { 
     if (totalDataSize == 0) {
-        return data.length();
+        return dataSize;
     } else {
         return totalDataSize;
     }
@@ -59,7 +59,7 @@ void ItemReader::resetBuffer(unsigned long size) {
         buffer = new char[size + 1];
         maxChunkSize = size;
     }
-    memset(buffer, 0, maxChunkSize + 1);
+    buffer[0] = 0;
 }
 
 
@@ -67,16 +67,13 @@ void ItemReader::resetBuffer(unsigned long size) {
 // what to with the des encoding? b64 ok but des not
 Chunk* ItemReader::getNextChunk(unsigned long size) {
         
-    resetBuffer(size);
     unsigned long bytesRead = 0;
     unsigned long toRead    = size;
     Chunk* chunk            = NULL;
     char* value             = NULL;
+    long valueLen           = 0;
     bool first              = true;
     bool last               = true;
-    bool useSyncItemEncoding  = (syncItem->getDataEncoding() == NULL) ?
-                                false :
-                                true;
 
     if (syncItem == NULL) {
         LOG.error("ItemReader: the syncItem is null");
@@ -86,6 +83,12 @@ Chunk* ItemReader::getNextChunk(unsigned long size) {
         LOG.info("Stop sending current item: Server's quota exceeded for this source");
         return NULL;
     }
+
+    bool useSyncItemEncoding  = (syncItem->getDataEncoding() == NULL) ?
+                                false :
+                                true;
+
+    resetBuffer(size);
     
     InputStream* istream = syncItem->getInputStream();
     
@@ -101,6 +104,7 @@ Chunk* ItemReader::getNextChunk(unsigned long size) {
     } 
     
     bytesRead = istream->read((void*)buffer, toRead);
+    buffer[bytesRead] = 0;
         
     if (bytesRead == 0) {
         if (istream->eof()) {
@@ -114,24 +118,34 @@ Chunk* ItemReader::getNextChunk(unsigned long size) {
             last = true;
             return NULL;
         }
+    } else if (useSyncItemEncoding) {
+        // consider that the buffer should be a char since the chunk is a buffer
+        value = stringdup(buffer);
+        valueLen = strlen(value);
     } else {
-        if (useSyncItemEncoding) {
-            // consider that the buffer should be a char since the chunk is a buffer
-            value = stringdup(buffer);
-        } else {
-            value = helper.encode(EncodingHelper::encodings::plain, buffer, &bytesRead);     
+        // The data is encoded straight into the buffer handed to the chunk,
+        // which is then moved as is into the outgoing Item: this is the
+        // only copy of it before the formatter.
+        value = new char[helper.getDataSizeAfterEncoding(bytesRead) + 1];
+        valueLen = helper.encodeTo(value, buffer, bytesRead);
+        if (valueLen < 0) {
+            // encryption needed: go through the transformers
+            delete [] value;
+            unsigned long len = bytesRead;
+            value = helper.encode(EncodingHelper::encodings::plain, buffer, &len);
             if (value == NULL) {
                 LOG.info("ItemReader: getNextChunk NULL after transformation");
                 return NULL;
             }
+            valueLen = len;
         }
-        
     }
     if (istream->eof() == 0) {
         last = false; 
     }
    
-    chunk = new Chunk(value);
+    chunk = new Chunk();
+    chunk->adoptData(value, valueLen);
     
     chunk->setFirst(first);
     chunk->setLast(last);    
@@ -143,8 +157,6 @@ Chunk* ItemReader::getNextChunk(unsigned long size) {
         chunk->setTotalDataSize(helper.getDataSizeAfterEncoding(syncItem->getDataSize()));
         chunk->setDataEncoding(helper.getDataEncoding());
     }
-    delete [] value;
     
     return chunk;
 }
-
@@ -0,0 +1,234 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <stdlib.h>
+
+#include "base/util/utils.h"
+#include "base/util/PropertyFile.h"
+#include "base/adapter/PlatformAdapter.h"
+#include "base/Log.h"
+#include "spds/SyncCheckpoint.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+#define CHECKPOINT_SYNC_MODE            "syncMode"
+#define CHECKPOINT_PREFERRED_SYNC_MODE  "preferredSyncMode"
+#define CHECKPOINT_NEXT_SYNC            "nextSync"
+#define CHECKPOINT_RESUME_REFUSED       "resumeRefused"
+
+// prefix of the keys of the acknowledged items, so they can't clash
+// with the session properties
+#define CHECKPOINT_ITEM_PREFIX          "item."
+#define CHECKPOINT_ITEM_PREFIX_LEN      5
+
+
+SyncCheckpoint::SyncCheckpoint(const char* sourceName) {
+
+    StringBuffer fullName = PlatformAdapter::getConfigFolder();
+    if (createFolder(fullName.c_str())) {
+        LOG.error("%s: error creating config folder", __FUNCTION__);
+    }
+    fullName += "/";
+    fullName += sourceName;
+    fullName += ".chk";
+    store = new PropertyFile(fullName);
+    read();
+}
+
+SyncCheckpoint::SyncCheckpoint(KeyValueStore* s) : store(s) {
+    read();
+}
+
+SyncCheckpoint::~SyncCheckpoint() {
+    if (inBatch) {
+        store->endBatch();
+    }
+    delete store;
+}
+
+void SyncCheckpoint::read() {
+
+    syncMode          = SYNC_NONE;
+    preferredSyncMode = SYNC_NONE;
+    nextSync          = 0;
+    resumeRefused     = false;
+    resumed           = false;
+    inBatch           = false;
+
+    Enumeration& en = store->getProperties();
+    while (en.hasMoreElement()) {
+        KeyValuePair* kvp = (KeyValuePair*)en.getNextElement();
+        const char* key   = kvp->getKey().c_str();
+        const char* value = kvp->getValue().c_str();
+        if (key == NULL || value == NULL) {
+            continue;
+        }
+        if (strncmp(key, CHECKPOINT_ITEM_PREFIX, CHECKPOINT_ITEM_PREFIX_LEN) == 0) {
+            acknowledged.insert(key + CHECKPOINT_ITEM_PREFIX_LEN);
+        } else if (strcmp(key, CHECKPOINT_SYNC_MODE) == 0) {
+            syncMode = (SyncMode)atoi(value);
+        } else if (strcmp(key, CHECKPOINT_PREFERRED_SYNC_MODE) == 0) {
+            preferredSyncMode = (SyncMode)atoi(value);
+        } else if (strcmp(key, CHECKPOINT_NEXT_SYNC) == 0) {
+            nextSync = strtoul(value, NULL, 10);
+        } else if (strcmp(key, CHECKPOINT_RESUME_REFUSED) == 0) {
+            resumeRefused = (strcmp(value, "1") == 0);
+        }
+    }
+    if (syncMode == SYNC_NONE) {
+        // no session: the keys alone are meaningless
+        acknowledged.clear();
+    }
+}
+
+bool SyncCheckpoint::canResume(SyncMode preferred) const {
+    return syncMode != SYNC_NONE && preferredSyncMode == preferred && !resumeRefused;
+}
+
+bool SyncCheckpoint::canContinue(SyncMode preferred, SyncMode mode) const {
+    return syncMode != SYNC_NONE && preferredSyncMode == preferred && mode == syncMode &&
+           (mode == SYNC_TWO_WAY || mode == SYNC_ONE_WAY_FROM_CLIENT);
+}
+
+void SyncCheckpoint::setResumeRefused() {
+    resumeRefused = true;
+    store->setPropertyValue(CHECKPOINT_RESUME_REFUSED, "1");
+}
+
+int SyncCheckpoint::writeSession() {
+
+    StringBuffer value;
+    value.sprintf("%d", syncMode);
+    store->setPropertyValue(CHECKPOINT_SYNC_MODE, value.c_str());
+    value.sprintf("%d", preferredSyncMode);
+    store->setPropertyValue(CHECKPOINT_PREFERRED_SYNC_MODE, value.c_str());
+    value.sprintf("%lu", nextSync);
+    store->setPropertyValue(CHECKPOINT_NEXT_SYNC, value.c_str());
+    if (resumeRefused) {
+        store->setPropertyValue(CHECKPOINT_RESUME_REFUSED, "1");
+    }
+    return store->close();
+}
+
+int SyncCheckpoint::start(SyncMode mode, SyncMode preferred, unsigned long next) {
+
+    if (inBatch) {
+        store->endBatch();
+        inBatch = false;
+    }
+    acknowledged.clear();
+    resumed           = false;
+    syncMode          = mode;
+    preferredSyncMode = preferred;
+    nextSync          = next;
+
+    store->removeAllProperties();
+    int ret = writeSession();
+    if (ret) {
+        LOG.error("%s: error saving the checkpoint (%d)", __FUNCTION__, ret);
+    }
+    return ret;
+}
+
+int SyncCheckpoint::restart(unsigned long next) {
+
+    if (inBatch) {
+        store->endBatch();
+        inBatch = false;
+    }
+    nextSync = next;
+
+    int ret = writeSession();
+    if (ret) {
+        LOG.error("%s: error saving the checkpoint (%d)", __FUNCTION__, ret);
+    }
+    return ret;
+}
+
+void SyncCheckpoint::addAcknowledged(const char* key) {
+
+    if (key == NULL || syncMode == SYNC_NONE) {
+        return;
+    }
+    if (!acknowledged.insert(key).second) {
+        return;     // already there
+    }
+    if (!inBatch) {
+        store->beginBatch();
+        inBatch = true;
+    }
+    StringBuffer prop(CHECKPOINT_ITEM_PREFIX);
+    prop += key;
+    store->setPropertyValue(prop.c_str(), "1");
+}
+
+bool SyncCheckpoint::isAcknowledged(const char* key) const {
+    return key && acknowledged.find(key) != acknowledged.end();
+}
+
+int SyncCheckpoint::commit() {
+
+    if (!inBatch) {
+        return 0;
+    }
+    inBatch = false;
+    int ret = store->endBatch();
+    if (ret) {
+        LOG.error("%s: error saving the checkpoint (%d)", __FUNCTION__, ret);
+    }
+    return ret;
+}
+
+int SyncCheckpoint::clear() {
+
+    if (inBatch) {
+        store->endBatch();
+        inBatch = false;
+    }
+    acknowledged.clear();
+    resumed           = false;
+    syncMode          = SYNC_NONE;
+    preferredSyncMode = SYNC_NONE;
+    nextSync          = 0;
+
+    int ret = store->removeAllProperties();
+    if (resumeRefused) {
+        // what the server supports is kept for the next syncs
+        store->setPropertyValue(CHECKPOINT_RESUME_REFUSED, "1");
+        ret = store->close();
+    }
+    return ret;
+}
@@ -182,6 +182,31 @@ void SyncItem::setKey(const WCHAR* itemKey) {
     key[DIM_KEY-1] = 0;
 }
 
+#ifndef WCHAR_IS_CHAR
+SyncItem::SyncItem(const char* itemKey) {
+    initialize();
+    if (itemKey) {
+        setKey(CharAsWChar(itemKey).c_str());
+    }
+}
+
+void SyncItem::setKey(const char* itemKey) {
+    setKey(CharAsWChar(itemKey).c_str());
+}
+
+void SyncItem::setDataType(const char* mimeType) {
+    setDataType(CharAsWChar(mimeType).c_str());
+}
+
+void SyncItem::setTargetParent(const char* parent) {
+    setTargetParent(CharAsWChar(parent).c_str());
+}
+
+void SyncItem::setSourceParent(const char* parent) {
+    setSourceParent(CharAsWChar(parent).c_str());
+}
+#endif
+
 /*
  * Sets the SyncItem modification timestamp. timestamp is a milliseconds
  * timestamp since a reference time (which is platform specific).
@@ -51,25 +51,25 @@ USE_NAMESPACE
  * Default constructor
  */
 SyncItemKeys::SyncItemKeys() {
-    addKeys.clear();
-    modKeys.clear();
-    delKeys.clear();
 }
 
 
 void SyncItemKeys::insertAddKey(const char* key) {
-    StringBuffer sb(key);
-    addKeys.add(sb);
+    if (key) {
+        addKeys.insert(key);
+    }
 }
 
 void SyncItemKeys::insertModKey(const char* key) {
-    StringBuffer sb(key);
-    modKeys.add(sb);
+    if (key) {
+        modKeys.insert(key);
+    }
 }
 
 void SyncItemKeys::insertDelKey(const char* key) {
-    StringBuffer sb(key);
-    delKeys.add(sb);
+    if (key) {
+        delKeys.insert(key);
+    }
 }
 
 void SyncItemKeys::clearKeys(const char* command) {
@@ -77,41 +77,28 @@ void SyncItemKeys::clearKeys(const char* command) {
         LOG.info("SyncItemKeys: command is null");
         return;
     }
-    if (strcmp(command, ADD) == 0) {
-        addKeys.clear();
-    } else if (strcmp(command, REPLACE) == 0) {
-        modKeys.clear();
-    } else {
-        delKeys.clear();
-    }
-
+    getKeys(command).clear();
 }
 
-ArrayList& SyncItemKeys::getAddKeys() {
-    return addKeys;
-}
-
-ArrayList& SyncItemKeys::getModKeys() {
-    return modKeys;
-}
-
-ArrayList& SyncItemKeys::getDelKeys() {
-    return delKeys;
-}
-
-ArrayList& SyncItemKeys::getListKeys(const char* command) {
+SyncItemKeys::KeySet& SyncItemKeys::getKeys(const char* command) {
     
     if (!command) {
         LOG.info("SyncItemKeys: command is null. Return Delete list by default");
-        return getDelKeys();
+        return delKeys;
     }
     if (strcmp(command, ADD) == 0) {
-        return getAddKeys();
+        return addKeys;
     } else if (strcmp(command, REPLACE) == 0) {
-        return getModKeys();
+        return modKeys;
     } else {
-        return getDelKeys();
+        return delKeys;
     }
+}
 
-
+bool SyncItemKeys::contains(const char* command, const char* key) {
+    if (!key) {
+        return false;
+    }
+    KeySet& keys = getKeys(command);
+    return keys.find(key) != keys.end();
 }
@@ -85,6 +85,7 @@ SyncMLBuilder::SyncMLBuilder(SyncMLProtocolFlavour p) : protocol(p) {
 SyncMLBuilder::~SyncMLBuilder() {
     safeDelete(&target  );
     safeDelete(&device  );
+    safeDelete(&username);
 }
 
 
@@ -97,16 +98,22 @@ protocol(p)
 
 void SyncMLBuilder::set(const char*t, const char*d) {
     
+    safeDelete(&target);
+    safeDelete(&device);
     target   = stringdup(t);
     device   = stringdup(d);
 }
 
 void SyncMLBuilder::setTarget(const char*t) {
     
+    safeDelete(&target);
     target   = stringdup(t);
 }
 
 void SyncMLBuilder::initialize() {
+    target    = NULL;
+    device    = NULL;
+    username  = NULL;
     sessionID = (unsigned long)time(NULL);
     msgRef    = 0         ;
     msgID     = 0         ;
@@ -127,33 +134,31 @@ void SyncMLBuilder::resetMsgRef() {
 
 void SyncMLBuilder::addItemStatus(ArrayList* previousStatus, Status* status) {
     
-    if (previousStatus->size() == 0) {
-        previousStatus->add(*status);
+    if (status == NULL)
         return;
-    }
     
-    bool found    = false;
-    Status* s     = NULL;
+    adoptItemStatus(previousStatus, (Status*)status->clone());
+}
+
+void SyncMLBuilder::adoptItemStatus(ArrayList* previousStatus, Status* status) {
     
     if (status == NULL)
         return;
-    ArrayList* list = new ArrayList();
-    for (int i = 0; i < previousStatus->size(); i++) {
-        
-        s = (Status*)previousStatus->get(i);
-        if ((strcmp(s->getCmd(), status->getCmd()) == 0) &&
-            (strcmp(s->getData()->getData(), status->getData()->getData()) == 0) &&
-            (strcmp(s->getCmdRef(), status->getCmdRef()) == 0) ) {
-            list = s->getItems();
-            for (int j = 0; j < status->getItems()->size(); j++) {
-                list->add(*((Item*)(status->getItems())->get(j)));
-                found = true;
+    
+    ArrayList* items = status->getItems();
+    if (items && items->size() > 0) {
+        for (Status* s = (Status*)previousStatus->front(); s; s = (Status*)previousStatus->next()) {
+            if ((strcmp(s->getCmd(), status->getCmd()) == 0) &&
+                (strcmp(s->getData()->getData(), status->getData()->getData()) == 0) &&
+                (strcmp(s->getCmdRef(), status->getCmdRef()) == 0) ) {
+                // collapse: move the items into the existing status
+                s->getItems()->adopt(items);
+                delete status;
+                return;
             }
         }
-        
     }
-    if (!found)
-        previousStatus->add(*status);
+    previousStatus->adopt(status);
     
 }
 
@@ -192,22 +197,18 @@ Status* SyncMLBuilder::prepareItemStatus(const char* COMMAND,
     CmdID* commandID  = new CmdID(cmdid);
     ArrayList* empty  = new ArrayList();
     Data*      data   = new Data(code);
-    ArrayList* list   = new ArrayList();
     Source* sou       = new Source(key);
-    Item* item        = new Item(NULL, sou, NULL, NULL, false);
-    list->add(*item);
     
     char *mRef = itow(msgRef);
-    Status* s = new Status(commandID, mRef, cmdRef, COMMAND, empty, empty, NULL, NULL, data, list);
+    Status* s = new Status(commandID, mRef, cmdRef, COMMAND, empty, empty, NULL, NULL, data, NULL);
     delete [] mRef;
+    s->getItems()->adopt(new Item(NULL, sou, NULL, NULL, false));
     
     safeDelete(&cmdid);
     deleteCmdID(&commandID);
     deleteData(&data);
     deleteSource(&sou);
-    deleteItem(&item);
     delete empty;
-    delete list;
     
     return s;
     
@@ -238,7 +239,7 @@ Status* SyncMLBuilder::prepareSyncHdrStatus(Chal*chal, int d) {
         wmsgRef = NULL;
     }
     // Fire Sync Status Event: syncHdr status from client
-    fireSyncStatusEvent(SYNC_HDR, s->getStatusCode(), NULL, NULL, NULL , CLIENT_STATUS);
+    fireSyncStatusEvent(SYNC_HDR, s->getStatusCode(), NULL, NULL, (const WCHAR*)NULL, CLIENT_STATUS);
     
     safeDelete(&cmdid);
     deleteCmdID(&commandID);
@@ -280,7 +281,7 @@ Status* SyncMLBuilder::prepareSyncStatus(SyncSource& source, Sync* sync) {
     
     // Fire Sync Status Event: sync status from client
     fireSyncStatusEvent(SYNC, s->getStatusCode(), source.getConfig().getName(),
-                        source.getConfig().getURI(), NULL, CLIENT_STATUS);
+                        source.getConfig().getURI(), (const WCHAR*)NULL, CLIENT_STATUS);
     
     deleteCmdID(&commandID);
     deleteTargetRef(&tar);
@@ -409,7 +410,7 @@ Status* SyncMLBuilder::prepareAlertStatus(SyncSource& source, ArrayList* alerts,
     
     // Fire Sync Status Event: alert status from client
     fireSyncStatusEvent(ALERT, s->getStatusCode(), source.getConfig().getName(),
-                        source.getConfig().getURI(), NULL , CLIENT_STATUS);
+                        source.getConfig().getURI(), (const WCHAR*)NULL, CLIENT_STATUS);
     
     deleteCmdID(&commandID);
     deleteTargetRef(&tar);
@@ -452,7 +453,7 @@ Status* SyncMLBuilder::prepareCmdStatus(AbstractCommand &cmd, int status) {
                            cmd.getName(), &empty, &empty, NULL, NULL, &d, NULL);
     
     // Fire Sync Status Event: status from client
-    fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), NULL, NULL, NULL , CLIENT_STATUS);
+    fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), NULL, NULL, (const WCHAR*)NULL, CLIENT_STATUS);
     
     delete [] msgRefStr;
     return s;
@@ -601,14 +602,14 @@ Alert* SyncMLBuilder::prepareAlert(SyncSource& s, int code) {
     return alert;
 }
 
-Alert* SyncMLBuilder::prepareInitAlert(SyncSource& s, unsigned long maxObjSize) {
+Alert* SyncMLBuilder::prepareInitAlert(SyncSource& s, unsigned long maxObjSize, bool resume) {
     
     ++cmdID;
     
     char* cmdid = itow(cmdID);
     CmdID* commandID     = new CmdID(cmdid);
     delete [] cmdid; cmdid = NULL;
-    int data             = s.getPreferredSyncMode();
+    int data             = resume ? SYNC_ALERT_RESUME : s.getPreferredSyncMode();
     Target* tar          = new Target(s.getConfig().getURI());
     const char*  val     =  toMultibyte(s.getName());
     Source* sou          = new Source(val);
@@ -734,10 +735,9 @@ SyncHdr* SyncMLBuilder::prepareSyncHdr(Cred* cred, unsigned long maxMsgSize, uns
     if (cred /*&& strcmp(cred->getType(), AUTH_TYPE_MD5) == 0*/)
     {
         //        sou = new Source(device, cred->getUsername());
+        safeDelete(&username);
         username = stringdup(cred->getUsername());
     }
-    else
-        sou = new Source(device);
     
     sou = new Source(device, username);
     
@@ -770,44 +770,159 @@ SyncML* SyncMLBuilder::prepareInitObject(Cred* cred, ArrayList* alerts,
                                          ArrayList* commands, unsigned long maxMsgSize,
                                          unsigned long maxObjSize) {
     
+    // Clone commands, even if empty. The result is a list anyway.
+    ArrayList* list = commands->clone();
+    SyncML* syncml = prepareInitObjectAdopt(cred, alerts, list, maxMsgSize, maxObjSize);
+    delete list;
+    
+    return syncml;
+}
+
+SyncML* SyncMLBuilder::prepareInitObjectAdopt(Cred* cred, ArrayList* alerts,
+                                              ArrayList* commands, unsigned long maxMsgSize,
+                                              unsigned long maxObjSize) {
+    
     SyncHdr* syncHdr     = prepareSyncHdr(cred, maxMsgSize, maxObjSize);
     SyncML*  syncml      = NULL;
-    ArrayList* list      = NULL;
     SyncBody* syncBody   = NULL;
     
-    // Clone commands, even if empty. The result is a list anyway.
-    list = commands->clone();
+    // Move the commands, even if empty. The result is a list anyway.
+    syncBody   = new SyncBody();
+    syncBody->adoptCommands(commands);
+    syncBody->setFinalMsg(true);
     
     if (alerts && alerts->size() > 0) {
-        for (int k = 0; k < alerts->size(); k++)
-            list->add(*(Alert*)alerts->get(k));
+        syncBody->getCommands()->add(alerts);
     }
     
-    syncBody   = new SyncBody(list, true);
-    syncml       = new SyncML(syncHdr, syncBody);
-    
-    deleteSyncHdr(&syncHdr);
-    deleteSyncBody(&syncBody);
-    delete list;
+    syncml       = new SyncML();
+    syncml->adoptSyncHdr(syncHdr);
+    syncml->adoptSyncBody(syncBody);
     
     return syncml;
 }
 
 char* SyncMLBuilder::prepareMsg(SyncML* syncml) {
-    StringBuffer *s = Formatter::getSyncML(syncml);
-    char* str = stringdup(s->c_str());
-    delete s;
+    
+    if (syncml == NULL) {
+        return NULL;
+    }
+    
+    // Same as Formatter::getSyncML(), assembled in the returned buffer
+    static const char head[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<SyncML>\n";
+    static const char tail[] = "</SyncML>";
+    
+    StringBuffer* hdr  = formatSyncHdr(syncml->getSyncHdr());
+    StringBuffer* body = Formatter::getSyncBody(syncml->getSyncBody());
+    size_t hdrLen  = hdr  ? hdr->length()  : 0;
+    size_t bodyLen = body ? body->length() : 0;
+    
+    char* str = new char[sizeof(head) - 1 + hdrLen + bodyLen + sizeof(tail)];
+    char* p = str;
+    memcpy(p, head, sizeof(head) - 1);  p += sizeof(head) - 1;
+    if (hdrLen)  { memcpy(p, hdr->c_str(), hdrLen);   p += hdrLen; }
+    if (bodyLen) { memcpy(p, body->c_str(), bodyLen); p += bodyLen; }
+    memcpy(p, tail, sizeof(tail));
+    
+    delete hdr;
+    delete body;
     return str;
 }
 
+// Adds a value to the ones a cached fragment was formatted from.
+static void addFragmentValue(StringBuffer& values, const char* value) {
+    if (value) {
+        values.append(value);
+    }
+    values.append("\n");
+}
+
+StringBuffer* SyncMLBuilder::formatSyncHdr(SyncHdr* syncHdr) {
+    
+    if (syncHdr == NULL) {
+        return NULL;
+    }
+    Target* tar = syncHdr->getTarget();
+    Source* sou = syncHdr->getSource();
+    if (!syncHdr->getVerDTD() || !syncHdr->getVerProto() || !syncHdr->getSessionID() ||
+        !tar || !sou || tar->getFilter()) {
+        return Formatter::getSyncHdr(syncHdr);
+    }
+    
+    // VerDTD, VerProto and SessionID: the same for the whole session
+    StringBuffer values;
+    addFragmentValue(values, syncHdr->getVerDTD()->getValue());
+    addFragmentValue(values, syncHdr->getVerProto()->getVersion());
+    addFragmentValue(values, syncHdr->getSessionID()->getSessionID());
+    if (hdrSession.empty() || values != hdrSessionValues) {
+        StringBuffer* verDTD    = Formatter::getVerDTD   (syncHdr->getVerDTD());
+        StringBuffer* verProto  = Formatter::getVerProto (syncHdr->getVerProto());
+        StringBuffer* sessionID = Formatter::getSessionID(syncHdr->getSessionID());
+        hdrSession.reset();
+        hdrSession.append(verDTD);
+        hdrSession.append(verProto);
+        hdrSession.append(sessionID);
+        hdrSessionValues = values;
+        deleteAllStringBuffer(3, &verDTD, &verProto, &sessionID);
+    }
+    
+    // Target and Source: they change only if the server redirects or
+    // the user changes
+    values.reset();
+    addFragmentValue(values, tar->getLocURI());
+    addFragmentValue(values, tar->getLocName());
+    addFragmentValue(values, sou->getLocURI());
+    addFragmentValue(values, sou->getLocName());
+    if (hdrAddress.empty() || values != hdrAddressValues) {
+        StringBuffer* target = Formatter::getTarget(tar);
+        StringBuffer* source = Formatter::getSource(sou);
+        hdrAddress.reset();
+        hdrAddress.append(target);
+        hdrAddress.append(source);
+        hdrAddressValues = values;
+        deleteAllStringBuffer(2, &target, &source);
+    }
+    
+    StringBuffer* msgID   = Formatter::getValue(MSG_ID,   syncHdr->getMsgID());
+    StringBuffer* respURI = Formatter::getValue(RESP_URI, syncHdr->getRespURI());
+    StringBuffer* cred    = Formatter::getCred(syncHdr->getCred());
+    StringBuffer* meta    = Formatter::getMeta(syncHdr->getMeta());
+    
+    StringBuffer s;
+    s.reserve(hdrSession.length() + hdrAddress.length() +
+              (msgID ? msgID->length() : 0) + (respURI ? respURI->length() : 0) +
+              (cred ? cred->length() : 0) + (meta ? meta->length() : 0));
+    s.append(hdrSession);
+    s.append(msgID);
+    s.append(hdrAddress);
+    s.append(respURI);
+    s.append(cred);
+    s.append(meta);
+    StringBuffer* ret = Formatter::getValue(SYNC_HDR, &s);
+    
+    deleteAllStringBuffer(4, &msgID, &respURI, &cred, &meta);
+    return ret;
+}
+
 
 SyncML* SyncMLBuilder::prepareSyncML(ArrayList* commands, bool final) {
     
+    ArrayList* list = commands->clone();
+    SyncML* syncml = prepareSyncMLAdopt(list, final);
+    delete list;
+    
+    return syncml;
+}
+
+SyncML* SyncMLBuilder::prepareSyncMLAdopt(ArrayList* commands, bool final) {
+    
     SyncHdr* syncHdr = prepareSyncHdr(NULL);
-    SyncBody* syncBody   = new SyncBody(commands, final);
-    SyncML* syncml = new SyncML(syncHdr, syncBody);
-    deleteSyncHdr(&syncHdr);
-    deleteSyncBody(&syncBody);
+    SyncBody* syncBody   = new SyncBody();
+    syncBody->adoptCommands(commands);
+    syncBody->setFinalMsg(final);
+    SyncML* syncml = new SyncML();
+    syncml->adoptSyncHdr(syncHdr);
+    syncml->adoptSyncBody(syncBody);
     
     return syncml;
 }
@@ -872,15 +987,13 @@ ArrayList* SyncMLBuilder::prepareItem(SyncItem* syncItem,
     char *tparent = toMultibyte(syncItem->getTargetParent());
     char *sparent = toMultibyte(syncItem->getSourceParent());
     
-    Item* item = new Item(NULL, sou, tparent, sparent, &m, data, hasMoreData);
-    list->add(*item);
+    list->adopt(new Item(NULL, sou, tparent, sparent, &m, data, hasMoreData));
     
     delete [] tparent;
     delete [] sparent;
     
     deleteSource(&sou);
     deleteComplexData(&data);
-    deleteItem(&item);
     
     return list;
 }
@@ -891,7 +1004,9 @@ ComplexData* SyncMLBuilder::getComplexData(Chunk* chunk) {
     if (!chunk) {
         return  NULL;
     }
-    ComplexData* data = new ComplexData(chunk->getData());
+    char* value = chunk->releaseData();
+    ComplexData* data = new ComplexData();
+    data->adoptData(value ? value : stringdup(""));
     return data;
 }
 
@@ -927,13 +1042,13 @@ Item* SyncMLBuilder::prepareItemChunk(SyncItem* syncItem,
     char *tparent = toMultibyte(syncItem->getTargetParent());
     char *sparent = toMultibyte(syncItem->getSourceParent());
     
-    Item* item = new Item(NULL, sou, tparent, sparent, &m, data, hasMoreData);
+    Item* item = new Item(NULL, sou, tparent, sparent, &m, NULL, hasMoreData);
+    item->adoptData(data);
     
     delete [] tparent;
     delete [] sparent;
     
     deleteSource(&sou);
-    deleteComplexData(&data);
     
     return item;
 }
@@ -982,15 +1097,14 @@ long SyncMLBuilder::addChunk(ModificationCommand* &modificationCommand,
         }
     }
     
+    // the chunk is emptied when its data is moved into the item
+    long size = chunk->getDataSize();
     ArrayList* list = modificationCommand->getItems();
-    Item* item = prepareItemChunk(syncItem, chunk, COMMAND);
-    
-    list->add(*item);
-    deleteItem(&item);
+    list->adopt(prepareItemChunk(syncItem, chunk, COMMAND));
     
     delete [] type;
     
-    return chunk->getDataSize();
+    return size;
 }
 
 
@@ -1038,7 +1152,7 @@ long SyncMLBuilder::addItem(ModificationCommand* &modificationCommand,
     ArrayList* tmpList = prepareItem(syncItem, syncItemOffset, maxBytes, sentBytes, type, COMMAND);
     assert(!strcmp(DELETE_COMMAND_NAME, COMMAND) || syncItemOffset >= 0);
     assert(!strcmp(DELETE_COMMAND_NAME, COMMAND) || syncItemOffset <= syncItem->getDataSize());
-    list->add(tmpList);
+    list->adopt(tmpList);
     delete tmpList;
     
     return sentBytes;
@@ -1051,13 +1165,30 @@ Sync* SyncMLBuilder::prepareSyncCommand(SyncSource& source) {
     char* cmdid = itow(cmdID);
     CmdID* commandID     = new CmdID(cmdid);
     delete [] cmdid; cmdid = NULL;
+    WCharAsChar name(source.getName());
     Target* tar          = new Target(source.getConfig().getURI());
-    Source* sou          = new Source(_wcc(source.getName()));
+    Source* sou          = new Source(name);
     ArrayList* list      = new ArrayList();
     Sync* sync           = NULL;
     
     sync = new Sync(commandID, false, NULL, tar, sou, NULL, -1,  list);
     
+    // the Target and Source are the same in all the Sync commands of the source
+    std::string key(tar->getLocURI() ? tar->getLocURI() : "");
+    key += '\n';
+    key += name.c_str() ? name.c_str() : "";
+    std::map<std::string, StringBuffer>::iterator it = syncTargetSources.find(key);
+    if (it == syncTargetSources.end()) {
+        StringBuffer* target = Formatter::getTarget(tar);
+        StringBuffer* s      = Formatter::getSource(sou);
+        StringBuffer xml;
+        xml.append(target);
+        xml.append(s);
+        deleteAllStringBuffer(2, &target, &s);
+        it = syncTargetSources.insert(std::make_pair(key, xml)).first;
+    }
+    sync->setFormattedTargetSource(it->second.c_str());
+    
     deleteCmdID(&commandID);
     deleteTarget(&tar);
     deleteSource(&sou);
@@ -1113,6 +1244,14 @@ void SyncMLBuilder::addMapItem(Map* map, MapItem* mapItem){
     
 }
 
+void SyncMLBuilder::adoptMapItem(Map* map, MapItem* mapItem){
+    if (mapItem == NULL || map == NULL)
+        return;
+    ArrayList* list = map->getMapItems();
+    list->adopt(mapItem);
+    
+}
+
 void SyncMLBuilder::resetMessageID() {
     msgID = 0;
 }
@@ -68,7 +68,7 @@ int SyncMLProcessor::processSyncHdrStatus(SyncML* syncml) {
     int ret = getStatusCode(syncml->getSyncBody(), NULL, SYNC_HDR);
 
     // Fire Sync Status Event: syncHdr status from server
-    fireSyncStatusEvent(SYNC_HDR, ret, NULL, NULL, NULL , SERVER_STATUS);
+    fireSyncStatusEvent(SYNC_HDR, ret, NULL, NULL, (const WCHAR*)NULL, SERVER_STATUS);
 
     return ret;
 }
@@ -111,7 +111,7 @@ int SyncMLProcessor::processAlertStatus(SyncSource& source, SyncML* syncml, Arra
     }
 
     // Fire a syncStatus event: Alert status from server
-    fireSyncStatusEvent(ALERT, ret, source.getConfig().getName(), source.getConfig().getURI(), NULL, SERVER_STATUS);
+    fireSyncStatusEvent(ALERT, ret, source.getConfig().getName(), source.getConfig().getURI(), (const WCHAR*)NULL, SERVER_STATUS);
 
     return ret;
 
@@ -215,8 +215,7 @@ ArrayList* SyncMLProcessor::processGetCommand(AbstractCommand* cmd, DevInf* devI
     if (sendDevInf && devInf) {
         AbstractCommand *result = syncMLBuilder.prepareDevInf(cmd, *devInf);
         if (result) {
-            ret->add(*result);
-            delete result;
+            ret->adopt(result);
         }
     }
 
@@ -225,9 +224,9 @@ ArrayList* SyncMLProcessor::processGetCommand(AbstractCommand* cmd, DevInf* devI
     Status* status = syncMLBuilder.prepareCmdStatus(*cmd, statusCode);
     if (status) {
         // Fire Sync Status Event: status from client
-        fireSyncStatusEvent(status->getCmd(), status->getStatusCode(), NULL, NULL, NULL , CLIENT_STATUS);
-        ret->add(*status);
-        deleteStatus(&status);
+        fireSyncStatusEvent(status->getCmd(), status->getStatusCode(), NULL, NULL, (const WCHAR*)NULL, CLIENT_STATUS);
+        ret->adopt(status);
+        status = NULL;
     }
 
     return ret;
@@ -256,9 +255,9 @@ ArrayList* SyncMLProcessor::processPutCommand(AbstractCommand* cmd, AbstractSync
     Status* status = syncMLBuilder.prepareCmdStatus(*cmd, statusCode);
     if (status) {
         // Fire Sync Status Event: status from client
-        fireSyncStatusEvent(status->getCmd(), status->getStatusCode(), NULL, NULL, NULL , CLIENT_STATUS);
-        ret->add(*status);
-        deleteStatus(&status);
+        fireSyncStatusEvent(status->getCmd(), status->getStatusCode(), NULL, NULL, (const WCHAR*)NULL, CLIENT_STATUS);
+        ret->adopt(status);
+        status = NULL;
     }
 
     return ret;
@@ -430,7 +429,21 @@ finally:
 
 
 
-int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, SyncItemKeys& syncItemKeys) {
+/**
+ * Appends the status of an item to the list given to SyncSource::setItemStatuses().
+ * The list takes the ownership of the key.
+ */
+static void addItemStatus(std::vector<SyncSource::ItemStatus>& statuses,
+                          const char* key, long status, const char* command) {
+    SyncSource::ItemStatus itemStatus;
+    itemStatus.key     = stringdup(key);
+    itemStatus.status  = (int)status;
+    itemStatus.command = command;
+    statuses.push_back(itemStatus);
+}
+
+int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, SyncItemKeys& syncItemKeys,
+                                       SyncCheckpoint* checkpoint) {
 
     ArrayList* items = NULL;
     Item* item       = NULL;
@@ -440,10 +453,13 @@ int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, S
     Data* data = NULL;
     int ret = 0;
 
+    // The item statuses are collected and handed to the source at once,
+    // after the whole message has been processed. The keys are freed then.
+    std::vector<SyncSource::ItemStatus> statuses;
+
     ArrayList* list = getCommands(syncBody, STATUS);
 
-    for (int i = 0; i < list->size(); i++) {
-        s = (Status*)list->get(i);
+    for (s = (Status*)list->front(); s; s = (Status*)list->next()) {
         name = s->getCmd();
         data = s->getData();
         if (strcmp(name, SYNC) == 0){
@@ -457,17 +473,14 @@ int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, S
             */
             char *statusMessage = NULL;
             items = s->getItems();
-			for (int k = 0; k < items->size(); k++) {
-                item = (Item*)items->get(k);
-                if (item) {
-                    ComplexData* cd = item->getData();
-                    if (cd) {
-                        statusMessage = stringdup(cd->getData());
-                    }
+            for (item = (Item*)items->front(); item; item = (Item*)items->next()) {
+                ComplexData* cd = item->getData();
+                if (cd) {
+                    statusMessage = stringdup(cd->getData());
                 }
             }
             // Fire Sync Status Event: sync status from server
-            fireSyncStatusEvent(SYNC, s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), NULL, SERVER_STATUS);
+            fireSyncStatusEvent(SYNC, s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), (const WCHAR*)NULL, SERVER_STATUS);
 
             if(alertStatus < 0 || alertStatus >=300){
                 if (statusMessage) {
@@ -492,68 +505,58 @@ int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, S
             strcmp(name, REPLACE) == 0 ||
             strcmp(name, DEL) == 0) {
 
-            int k;
-
             items = s->getItems();
             long val = strtol(data->getData() , NULL, 10);
-            for (k = 0; k < items->size(); k++) {
-                item = (Item*)items->get(k);
-                if (item) {
-                    syncItemKeys.clearKeys(name);
-                    Source* itemSource = item->getSource();
-                    if (itemSource) {
-                        WCHAR *uri = toWideChar(itemSource->getLocURI());
-
-                        ComplexData* cd = item->getData();
-                        WCHAR *statusMessage = NULL;
-                        if (cd) {
-                            statusMessage = toWideChar(cd->getData());
-                        }
-
-                        // Fire Sync Status Event: item status from server
-                        fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), uri, SERVER_STATUS);
-                        // Update SyncReport
-                        source.getReport()->addItem(SERVER, s->getCmd(), uri, s->getStatusCode(), statusMessage);
+            for (item = (Item*)items->front(); item; item = (Item*)items->next()) {
+                syncItemKeys.clearKeys(name);
+                Source* itemSource = item->getSource();
+                if (itemSource) {
+                    const char* uri = itemSource->getLocURI();
 
-                        source.setItemStatus(uri, val, name);
-                        delete [] uri;
-                        if (statusMessage)
-                            delete [] statusMessage;
-                    } else {
-                        // the item might consist of additional information, as in:
-                        // <SourceRef>pas-id-44B544A600000092</SourceRef>
-                        // <Data>200</Data>
-                        // <Item><Data>Conflict resolved by server</Data></Item>
+                    ComplexData* cd = item->getData();
+                    const char* statusMessage = NULL;
+                    if (cd) {
+                        statusMessage = cd->getData();
                     }
+
+                    // Fire Sync Status Event: item status from server
+                    fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), uri, SERVER_STATUS);
+                    // Update SyncReport
+                    source.getReport()->addItem(SERVER, s->getCmd(), uri, s->getStatusCode(), statusMessage);
+
+                    addItemStatus(statuses, uri, val, name);
+                } else {
+                    // the item might consist of additional information, as in:
+                    // <SourceRef>pas-id-44B544A600000092</SourceRef>
+                    // <Data>200</Data>
+                    // <Item><Data>Conflict resolved by server</Data></Item>
                 }
             }
             items = s->getSourceRef();
-            for (k = 0; k < items->size(); k++) {
-                sourceRef = (SourceRef*)items->get(k);
-                if (sourceRef) {
-                    syncItemKeys.clearKeys(name);
-                    WCHAR *srcref = toWideChar(sourceRef->getValue());
+            for (sourceRef = (SourceRef*)items->front(); sourceRef; sourceRef = (SourceRef*)items->next()) {
+                syncItemKeys.clearKeys(name);
+                const char* srcref = sourceRef->getValue();
 			        // Fire Sync Status Event: item status from server
-                    fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), srcref, SERVER_STATUS);
-                    // Update SyncReport
-                    source.getReport()->addItem(SERVER, s->getCmd(), srcref, s->getStatusCode(), NULL);
+                fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), srcref, SERVER_STATUS);
+                // Update SyncReport
+                source.getReport()->addItem(SERVER, s->getCmd(), srcref, s->getStatusCode(), NULL);
 
-                    source.setItemStatus(srcref, val, name);
-                    delete [] srcref;
-                }
+                addItemStatus(statuses, srcref, val, name);
             }
             
-            if (syncItemKeys.getListKeys(name).size() > 0) {
-                ArrayList& keylist = syncItemKeys.getListKeys(name);
-                for (k = 0; k < keylist.size(); k++) {               
-                    WCHAR *srcref = toWideChar(((StringBuffer*)keylist.get(k))->c_str());
+            // no status for the single items: it's the same for all the
+            // items sent with this command
+            SyncItemKeys::KeySet& keys = syncItemKeys.getKeys(name);
+            if (keys.size() > 0) {
+                SyncItemKeys::KeySet::const_iterator key;
+                for (key = keys.begin(); key != keys.end(); key++) {
+                    const char* srcref = key->c_str();
 		            // Fire Sync Status Event: item status from server
                     fireSyncStatusEvent(s->getCmd(), s->getStatusCode(), source.getConfig().getName(), source.getConfig().getURI(), srcref, SERVER_STATUS);
                     // Update SyncReport
                     source.getReport()->addItem(SERVER, s->getCmd(), srcref, s->getStatusCode(), NULL);
 
-                    source.setItemStatus(srcref, val, name);
-                    delete [] srcref;
+                    addItemStatus(statuses, srcref, val, name);
                 }
                 syncItemKeys.clearKeys(name);
             }
@@ -561,6 +564,20 @@ int SyncMLProcessor::processItemStatus(SyncSource& source, SyncBody* syncBody, S
         }
     }
 
+    if (!statuses.empty()) {
+        // the command names belong to the list, so this is done before freeing it
+        source.setItemStatuses(statuses);
+        for (size_t i = 0; i < statuses.size(); i++) {
+            int code = statuses[i].status;
+            if (checkpoint && ((code >= 200 && code < 300 && code != STC_CHUNKED_ITEM_ACCEPTED) ||
+                               code == STC_ALREADY_EXISTS)) {
+                // not to be sent again if the sync is resumed
+                checkpoint->addAcknowledged(statuses[i].key);
+            }
+            delete [] statuses[i].key;
+        }
+    }
+
     //deleteArrayList(&list);
     if (list){
         delete list;
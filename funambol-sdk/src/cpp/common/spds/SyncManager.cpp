@@ -48,6 +48,8 @@
 #include "spds/spdsutils.h"
 #include "syncml/core/TagNames.h"
 #include "syncml/core/ObjectDel.h"
+#include "syncml/formatter/WBXMLEncoder.h"
+#include "syncml/parser/WBXMLDecoder.h"
 
 #include "event/FireEvent.h"
 
@@ -175,19 +177,18 @@ bool SyncManager::isToExit() {
 
 void SyncManager::decodeItemKey(SyncItem *syncItem)
 {
-    char *key;
+    if (!syncItem) {
+        return;
+    }
+    WCharAsChar key(syncItem->getKey());
     
-    if (syncItem &&
-        (key = toMultibyte(syncItem->getKey())) != NULL &&
+    if (key.c_str() &&
         !strncmp(key, encodedKeyPrefix, strlen(encodedKeyPrefix))) {
         int len;
         char *decoded = (char *)b64_decode(len, key + strlen(encodedKeyPrefix));
-        LOG.debug("replacing encoded key '%s' with unsafe key '%s'", key, decoded);
-        WCHAR* t = toWideChar(decoded);
-        syncItem->setKey(t);
+        LOG.debug("replacing encoded key '%s' with unsafe key '%s'", key.c_str(), decoded);
+        syncItem->setKey(decoded);
         delete [] decoded;
-        delete [] key;
-        delete [] t;
     }
 }
 
@@ -211,10 +212,8 @@ void SyncManager::encodeItemKey(SyncItem *syncItem)
         StringBuffer newkey(encodedKeyPrefix);
         newkey += encoded;
         LOG.debug("replacing unsafe key '%s' with encoded key '%s'", key, newkey.c_str());
-        WCHAR* t = toWideChar(newkey.c_str());
-        syncItem->setKey(t);
+        syncItem->setKey(newkey.c_str());
         
-        delete [] t;
         delete [] key;
     }
     
@@ -314,6 +313,7 @@ void SyncManager::initialize() {
     isFiredSyncEventBEGIN = false;
     
     mmanager = NULL;
+    checkpoints = NULL;
     
 }
 
@@ -351,6 +351,12 @@ SyncManager::~SyncManager() {
         delete [] mmanager;
     }
     
+    if (checkpoints) {
+        for (int i = 0; checkpoints[i]; i++) {
+            delete checkpoints[i];
+        }
+        delete [] checkpoints;
+    }
 }
 
 /*
@@ -368,6 +374,8 @@ int SyncManager::prepareSync(SyncSource** s) {
     const char* requestedAuthType  = NULL;
     ArrayList* list             = NULL; //new ArrayList();
     ArrayList alerts;
+    bool* resendAlerts          = NULL; // the sources whose resume alert was not answered
+    bool resending              = false;
     
     // for authentication improvments
     bool isServerAuthRequired   = credentialHandler.getServerAuthRequired();
@@ -388,6 +396,10 @@ int SyncManager::prepareSync(SyncSource** s) {
     unsigned long timestamp = (unsigned long)time(NULL);
     StringBuffer oldOAuth2AccessToken("");
     
+    // the performance counters are of the current sync only
+    syncReport.getStats().reset();
+    SyncStats::Timer prepareTimer(syncReport.getStats(), PHASE_PREPARE_SYNC);
+    
     resetError();
     
     // Fire Sync Begin Event
@@ -420,6 +432,19 @@ int SyncManager::prepareSync(SyncSource** s) {
     }
     mmanager[count] = 0;
     
+    resendAlerts = new bool[sourcesNumber];
+    for (count = 0; count < sourcesNumber; count++) {
+        resendAlerts[count] = false;
+    }
+    
+    if (config.getCheckpoints()) {
+        checkpoints = new SyncCheckpoint*[sourcesNumber + 1];
+        for (count = 0; count < sourcesNumber; count++) {
+            checkpoints[count] = new SyncCheckpoint(sources[count]->getConfig().getName());
+        }
+        checkpoints[count] = 0;
+    }
+    
     syncMLBuilder.resetCommandID();
     syncMLBuilder.resetMessageID();
     //config.setBeginSync(timestamp); not used actually
@@ -474,14 +499,19 @@ int SyncManager::prepareSync(SyncSource** s) {
         
         bool addressChange = false;
         
-        // credential of the client
-        if (isClientAuthenticated == false) {
+        // credential of the client, or the sync alerts sent again
+        if (isClientAuthenticated == false || resending) {
             char anc[DIM_ANCHOR];
             timestamp = (unsigned long)time(NULL);
             for (count = 0; count < sourcesNumber; count ++) {
                 if (!sources[count]->getReport()->checkState())
                     continue;
-                sources[count]->setNextSync(timestamp);
+                if (resending && !resendAlerts[count])
+                    continue;
+                // a checkpointed session is resumed with its own anchors
+                bool resume = checkpoints &&
+                    checkpoints[count]->canResume(sources[count]->getPreferredSyncMode());
+                sources[count]->setNextSync(resume ? checkpoints[count]->getNextSync() : timestamp);
                 timestampToAnchor(sources[count]->getNextSync(), anc);
                 sources[count]->setNextAnchor(anc);
                 // Test if this source is for AddressChangeNotification
@@ -496,11 +526,13 @@ int SyncManager::prepareSync(SyncSource** s) {
                     // address change notification
                 }
                 else {
-                    alert = syncMLBuilder.prepareInitAlert(*sources[count], maxObjSize);
+                    alert = syncMLBuilder.prepareInitAlert(*sources[count], maxObjSize, resume);
                 }
-                alerts.add(*alert);
-                deleteAlert(&alert);
+                alerts.adopt(alert);
+                alert = NULL;
             }
+        }
+        if (isClientAuthenticated == false) {
             cred = credentialHandler.getClientCredential();
             if (cred && cred->getAuthentication() && cred->getAuthentication()->getPassword()) {
                 strcpy(credentialInfo, cred->getAuthentication()->getPassword());
@@ -514,8 +546,7 @@ int SyncManager::prepareSync(SyncSource** s) {
         if (askServerDevInf()) {
             AbstractCommand* get = syncMLBuilder.prepareServerDevInf();
             if (get) {
-                commands.add(*get);
-                delete get;
+                commands.adopt(get);
             }
         }
         
@@ -523,21 +554,20 @@ int SyncManager::prepareSync(SyncSource** s) {
         if (putDevInf) {
             AbstractCommand* put = syncMLBuilder.prepareDevInf(NULL, *devInf);
             if (put) {
-                commands.add(*put);
-                delete put;
+                commands.adopt(put);
             }
             putDevInf = false;
         }
         
         // "cred" only contains an encoded strings as username, also
         // need the original username for LocName
-        syncml = syncMLBuilder.prepareInitObject(cred, &alerts, &commands, maxMsgSize, maxObjSize);
+        syncml = syncMLBuilder.prepareInitObjectAdopt(cred, &alerts, &commands, maxMsgSize, maxObjSize);
         if (syncml == NULL) {
             ret = getLastErrorCode();
             goto finally;
         }
         
-        initMsg = syncMLBuilder.prepareMsg(syncml);
+        initMsg = formatMessage(syncml);
         if (initMsg == NULL) {
             ret = getLastErrorCode();
             goto finally;
@@ -569,7 +599,7 @@ int SyncManager::prepareSync(SyncSource** s) {
             goto finally;
         }
         
-        responseMsg = transportAgent->sendMessage(initMsg);
+        responseMsg = exchangeMessage(initMsg);
         
         if (config.isToAbort()) {
             ret = SYNC_ABORTED_BY_CLIENT;
@@ -607,7 +637,7 @@ int SyncManager::prepareSync(SyncSource** s) {
         syncMLBuilder.increaseMsgRef();
         syncMLBuilder.resetCommandID();
         
-        syncml = syncMLProcessor.processMsg(responseMsg);
+        syncml = parseMessage(responseMsg);
         safeDelete(&responseMsg);
         safeDelete(&initMsg);
         
@@ -632,6 +662,8 @@ int SyncManager::prepareSync(SyncSource** s) {
         for (count = 0; count < sourcesNumber; count ++) {
             if (!sources[count]->getReport()->checkState())
                 continue;
+            if (resending && !resendAlerts[count])
+                continue;
             
             int sourceRet = syncMLProcessor.processAlertStatus(*sources[count], syncml, &alerts);
             if (isAuthFailed(ret) && sourceRet == -1) {
@@ -705,8 +737,8 @@ int SyncManager::prepareSync(SyncSource** s) {
             authStatusCode = 200;
         }
         status = syncMLBuilder.prepareSyncHdrStatus(serverChal, authStatusCode);
-        commands.add(*status);
-        deleteStatus(&status);
+        commands.adopt(status);
+        status = NULL;
         list = syncMLProcessor.getCommands(syncml->getSyncBody(), ALERT);
         for (count = 0; count < sourcesNumber; count ++) {
             if (!sources[count]->getReport()->checkState())
@@ -714,8 +746,8 @@ int SyncManager::prepareSync(SyncSource** s) {
             
             status = syncMLBuilder.prepareAlertStatus(*sources[count], list, authStatusCode);
             if (status) {
-                commands.add(*status);
-                deleteStatus(&status);
+                commands.adopt(status);
+                status = NULL;
             }
         }
         if (list) {
@@ -731,7 +763,7 @@ int SyncManager::prepareSync(SyncSource** s) {
             AbstractCommand* cmd = (AbstractCommand*)list->get(i);
             ArrayList* responseCmd = NULL;
             if ( (responseCmd = syncMLProcessor.processGetCommand(cmd, devInf, syncMLBuilder)) ) {
-                commands.add(responseCmd);
+                commands.adopt(responseCmd);
                 delete responseCmd;
             }
         }
@@ -746,7 +778,7 @@ int SyncManager::prepareSync(SyncSource** s) {
             AbstractCommand* cmd = (AbstractCommand*)list->get(i);
             ArrayList* responseCmd = NULL;
             if ( (responseCmd = syncMLProcessor.processPutCommand(cmd, config, syncMLBuilder)) ) {
-                commands.add(responseCmd);
+                commands.adopt(responseCmd);
                 delete responseCmd;
             }
         }
@@ -828,16 +860,54 @@ int SyncManager::prepareSync(SyncSource** s) {
             isClientAuthenticated = true;
             
             // Get sorted source list from Alert commands sent by server.
-            if (sortedSourcesFromServer) {
-                delete [] sortedSourcesFromServer;
-                sortedSourcesFromServer = NULL;
+            char** serverSources = syncMLProcessor.getSortedSourcesFromServer(syncml, sourcesNumber);
+            if (resending && sortedSourcesFromServer) {
+                // the sources alerted again come after the others
+                int n = 0;
+                while (sortedSourcesFromServer[n]) {
+                    n++;
+                }
+                for (int i = 0; serverSources[i]; i++) {
+                    if (n < sourcesNumber) {
+                        sortedSourcesFromServer[n++] = serverSources[i];
+                    } else {
+                        delete [] serverSources[i];
+                    }
+                }
+                sortedSourcesFromServer[n] = NULL;
+                delete [] serverSources;
+            } else {
+                if (sortedSourcesFromServer) {
+                    delete [] sortedSourcesFromServer;
+                    sortedSourcesFromServer = NULL;
+                }
+                sortedSourcesFromServer = serverSources;
             }
-            sortedSourcesFromServer = syncMLProcessor.getSortedSourcesFromServer(syncml, sourcesNumber);
+            serverSources = NULL;
             
+            bool resendNeeded = false;
             for (count = 0; count < sourcesNumber; count ++) {
                 if (!sources[count]->getReport()->checkState())
                     continue;
+                if (resending && !resendAlerts[count])
+                    continue;
+                resendAlerts[count] = false;
+                SyncMode preferred = sources[count]->getPreferredSyncMode();
+                bool resume = checkpoints && checkpoints[count]->canResume(preferred);
+                if (resume) {
+                    // to find out if the server answers the resume alert at all
+                    sources[count]->setSyncMode(SYNC_NONE);
+                }
                 ret = syncMLProcessor.processServerAlert(*sources[count], syncml);
+                if (checkpoints && !isErrorStatus(ret) &&
+                    initCheckpoint(count, preferred, resume)) {
+                    // the sync alert is sent in the next message, with
+                    // the mode cleared above to detect the missing answer
+                    sources[count]->setPreferredSyncMode(preferred);
+                    resendAlerts[count] = true;
+                    resendNeeded = true;
+                    continue;
+                }
                 if (isErrorStatus(ret)) {
                     setErrorF(ret, "AlertStatus from server %d", ret);
                     LOG.error("%s", getLastErrorMsg());
@@ -848,9 +918,10 @@ int SyncManager::prepareSync(SyncSource** s) {
                                     sources[count]->getSyncMode(),
                                     0, SYNC_SOURCE_SYNCMODE_REQUESTED);
             }
+            resending = resendNeeded;
         }
         
-    } while(isClientAuthenticated == false || isServerAuthenticated == false);
+    } while(isClientAuthenticated == false || isServerAuthenticated == false || resending);
     
     config.setClientNonce(credentialHandler.getClientNonce());
     config.setServerNonce(credentialHandler.getServerNonce());
@@ -899,6 +970,7 @@ finally:
     if (devInfStr) {
         delete devInfStr;
     }
+    delete [] resendAlerts;
     
     deleteSyncML(&syncml);
     deleteCred(&cred);
@@ -1013,8 +1085,8 @@ bool SyncManager::checkForServerChanges(SyncML* syncml, ArrayList &statusList)
             
             ArrayList* items = sync->getCommands();
             Status* status = syncMLBuilder.prepareSyncStatus(*sources[count], sync);
-            statusList.add(*status);
-            deleteStatus(&status);
+            statusList.adopt(status);
+            status = NULL;
             
             ArrayList previousStatus;
             for (int i = 0; i < items->size(); i++) {
@@ -1064,16 +1136,19 @@ bool SyncManager::checkForServerChanges(SyncML* syncml, ArrayList &statusList)
                     //
                     // set the syncItem element
                     //
-                    status = processSyncItem(item, cmdInfo, syncMLBuilder);
+                    {
+                        SyncStats::Timer timer(syncReport.getStats(), PHASE_APPLY_CHANGES,
+                                               sources[count]->getConfig().getName());
+                        status = processSyncItem(item, cmdInfo, syncMLBuilder);
+                    }
                     
                     if (status) {
-                        syncMLBuilder.addItemStatus(&previousStatus, status);
-                        deleteStatus(&status);
+                        syncMLBuilder.adoptItemStatus(&previousStatus, status);
+                        status = NULL;
                     }
                 }
                 
-                statusList.add(&previousStatus);
-                previousStatus.clear();
+                statusList.adopt(&previousStatus);
             }
             applySourceChanges(statusList);
             // Fire SyncSourceEvent: END sync of a syncsource (server modifications)
@@ -1093,11 +1168,13 @@ finally:
 }
 
 void SyncManager::applySourceChanges(ArrayList &statusList) {
+    SyncStats::Timer timer(syncReport.getStats(), PHASE_APPLY_CHANGES,
+                           sources[count]->getConfig().getName());
     sources[count]->applyItems(items);
     ArrayList previousStatus;
     for (int i = 0; i < items.size(); i++) {
         IncomingSyncItem* item = (IncomingSyncItem*)items[i];
-        StringBuffer command;
+        const char* command = NULL;
         Status* status = NULL;
         int code = item->getSyncStatus();
         if (item->getState() == SYNC_STATE_NEW) {
@@ -1110,9 +1187,7 @@ void SyncManager::applySourceChanges(ArrayList &statusList) {
             
             // If the add was successful, set the id mapping
             if ((code >= 200 && code <= 299) || code == STC_ALREADY_EXISTS) {     // send mapping for code 418 too
-                char *key = toMultibyte(item->getKey());
-                mmanager[item->sourceIndex]->addMapping(key, item->guid); // LUID, GUID
-                delete [] key;
+                mmanager[item->sourceIndex]->addMapping(WCharAsChar(item->getKey()), item->guid); // LUID, GUID
             }
         }
         else if (item->getState() == SYNC_STATE_UPDATED) {
@@ -1123,18 +1198,17 @@ void SyncManager::applySourceChanges(ArrayList &statusList) {
             status = syncMLBuilder.prepareItemStatus(DEL, item->name, item->cmdRef, code);
             command = COMMAND_DELETE;
         }
-        if (!command.empty()) {
+        if (command) {
             // Fire Sync Status Event: item status from client
             fireSyncStatusEvent(status->getCmd(), status->getStatusCode(), sources[item->sourceIndex]->getConfig().getName(), sources[item->sourceIndex]->getConfig().getURI(), item->getKey(), CLIENT_STATUS);
             // Update SyncReport
-            sources[item->sourceIndex]->getReport()->addItem(CLIENT, command.c_str(), item->getKey(), status->getStatusCode(), NULL);
+            sources[item->sourceIndex]->getReport()->addItem(CLIENT, command, item->getKey(), status->getStatusCode(), NULL);
         }
         if (status) {
-            syncMLBuilder.addItemStatus(&previousStatus, status);
-            deleteStatus(&status);
+            syncMLBuilder.adoptItemStatus(&previousStatus, status);
+            status = NULL;
         }
-        statusList.add(&previousStatus);
-        previousStatus.clear();
+        statusList.adopt(&previousStatus);
     }
     items.clear();
 }
@@ -1197,7 +1271,13 @@ int SyncManager::sync() {
         // Fire SyncSource event: BEGIN sync of a syncsource (client modifications)
         fireSyncSourceEvent(sources[count]->getConfig().getURI(), sources[count]->getConfig().getName(), sources[count]->getSyncMode(), 0, SYNC_SOURCE_BEGIN);
         
-        if ( sources[count]->beginSync() ) {
+        int beginRet;
+        {
+            SyncStats::Timer timer(syncReport.getStats(), PHASE_CHANGE_DETECTION,
+                                   sources[count]->getConfig().getName());
+            beginRet = sources[count]->beginSync();
+        }
+        if (beginRet) {
             // Error from SyncSource
             if (getLastErrorCode() == 0) {
                 setError(ERR_UNSPECIFIED, "Error in begin sync");
@@ -1230,17 +1310,22 @@ int SyncManager::sync() {
             if (commands.isEmpty()) {
                 
                 status = syncMLBuilder.prepareSyncHdrStatus(NULL, 200);
-                commands.add(*status);
-                deleteStatus(&status);
+                commands.adopt(status);
+                status = NULL;
                 
             }
             
             /*
              * Check if there is some mappings from the previous
              * sync of the source. This is valid only for two-way sync
-             * and one-way. Otherwise the old mappings are removed
+             * and one-way, or if the sync is resumed. Otherwise the old
+             * mappings are removed
              */
-            switch (sources[count]->getSyncMode()) {
+            SyncMode mappingsMode = sources[count]->getSyncMode();
+            if (checkpoints && checkpoints[count]->isResumed()) {
+                mappingsMode = SYNC_TWO_WAY;
+            }
+            switch (mappingsMode) {
                 case SYNC_TWO_WAY:
                 case SYNC_ONE_WAY_FROM_SERVER:
                 case SYNC_SMART_ONE_WAY_FROM_SERVER:
@@ -1251,14 +1336,12 @@ int SyncManager::sync() {
                         KeyValuePair* kvp = (KeyValuePair*)en.getNextElement();
                         SyncMap sMap(kvp->getValue(), kvp->getKey());
                         MapItem* mapItem = syncMLBuilder.prepareMapItem(&sMap);
-                        tmpMapItems.add(*mapItem);
-                        delete mapItem;
+                        tmpMapItems.adopt(mapItem);
                     }
                     if (tmpMapItems.size() > 0) {
                         Map* tmpMap = syncMLBuilder.prepareMapCommand(*sources[count]);
-                        tmpMap->getMapItems()->add(&tmpMapItems);
-                        commands.add(*tmpMap);
-                        delete tmpMap;
+                        tmpMap->adoptMapItems(&tmpMapItems);
+                        commands.adopt(tmpMap);
                     }
                 }
                     break;
@@ -1353,7 +1436,7 @@ int SyncManager::sync() {
                             delete chunk; chunk = NULL;
                             
                             // add the key item in the list of mod items.
-                            syncItemKeys.insertModKey(StringBuffer().convert(syncItem->getKey()));
+                            syncItemKeys.insertModKey(WCharAsChar(syncItem->getKey()));
                             
                             if (isLast) {
                                 delete syncItem; syncItem = NULL;
@@ -1375,6 +1458,10 @@ int SyncManager::sync() {
                 case SYNC_REFRESH_FROM_SERVER:
                 {
                     last = true;
+                    if (checkpoints && checkpoints[count]->isResumed()) {
+                        // the items received before the interruption are kept
+                        break;
+                    }
                     char *name = toMultibyte(sources[count]->getName());
                     if (sources[count]->removeAllItems() == 0) {
                         LOG.debug("Removed all items for source %s", name);
@@ -1470,7 +1557,7 @@ int SyncManager::sync() {
                             delete chunk; chunk = NULL;
                             
                             // add the key item in the list of add items.
-                            syncItemKeys.insertAddKey(StringBuffer().convert(syncItem->getKey()));
+                            syncItemKeys.insertAddKey(WCharAsChar(syncItem->getKey()));
                             
                             if (isLast) {
                                 delete syncItem; syncItem = NULL;
@@ -1489,8 +1576,7 @@ int SyncManager::sync() {
                     if (step == 2) {
                         
                         if (modificationCommand) {
-                            list->add(*modificationCommand);
-                            delete modificationCommand;
+                            list->adopt(modificationCommand);
                             modificationCommand = NULL;
                         }
                         
@@ -1566,7 +1652,7 @@ int SyncManager::sync() {
                             delete chunk; chunk = NULL;
                             
                             // add the key item in the list of mod items.
-                            syncItemKeys.insertModKey(StringBuffer().convert(syncItem->getKey()));
+                            syncItemKeys.insertModKey(WCharAsChar(syncItem->getKey()));
                             
                             if (isLast) {
                                 delete syncItem; syncItem = NULL;
@@ -1586,8 +1672,7 @@ int SyncManager::sync() {
                     if (step == 4) {
                         
                         if (modificationCommand) {
-                            list->add(*modificationCommand);
-                            delete modificationCommand;
+                            list->adopt(modificationCommand);
                             modificationCommand = NULL;
                         }
                         
@@ -1633,7 +1718,7 @@ int SyncManager::sync() {
                                                    sources[count]->getConfig().getType());
                             
                             // add the key item in the list of mod items.
-                            syncItemKeys.insertDelKey(StringBuffer().convert(syncItem->getKey()));
+                            syncItemKeys.insertDelKey(WCharAsChar(syncItem->getKey()));
                             
                             delete syncItem; syncItem = NULL;
                             delete chunk; chunk = NULL;
@@ -1651,22 +1736,20 @@ int SyncManager::sync() {
             } //  close switch
             
             if (modificationCommand) {
-                list->add(*modificationCommand);
-                delete modificationCommand;
+                list->adopt(modificationCommand);
                 modificationCommand = NULL;
             }
-            sync->setCommands(list);
+            sync->adoptCommands(list);
             delete list;
-            commands.add(*sync);
-            delete sync;
+            commands.adopt(sync);
             
             //
             // Check if all the sources were synced.
             // If not the prepareSync doesn't use the <final/> tag
             //
             syncMLBuilder.setTarget(transportAgent->getURL().fullURL); //add by zhaojunjie
-            syncml = syncMLBuilder.prepareSyncML(&commands, (iterator != toSync ? false : last));
-            msg    = syncMLBuilder.prepareMsg(syncml);
+            syncml = syncMLBuilder.prepareSyncMLAdopt(&commands, (iterator != toSync ? false : last));
+            msg    = formatMessage(syncml);
             
             deleteSyncML(&syncml);
             commands.clear();
@@ -1693,7 +1776,7 @@ int SyncManager::sync() {
                 goto finally;
             }
             
-            responseMsg = transportAgent->sendMessage(msg);
+            responseMsg = exchangeMessage(msg);
             
             if (config.isToAbort()) {
                 ret = SYNC_ABORTED_BY_CLIENT;
@@ -1718,7 +1801,7 @@ int SyncManager::sync() {
             syncMLBuilder.increaseMsgRef();
             syncMLBuilder.resetCommandID();
             
-            syncml = syncMLProcessor.processMsg(responseMsg);
+            syncml = parseMessage(responseMsg);
             safeDelete(&responseMsg);
             safeDelete(&msg);
             
@@ -1742,7 +1825,8 @@ int SyncManager::sync() {
             // Process the status of the item sent by client. It invokes the
             // source method
             //
-            int itemret = syncMLProcessor.processItemStatus(*sources[count], syncml->getSyncBody(), syncItemKeys);
+            int itemret = syncMLProcessor.processItemStatus(*sources[count], syncml->getSyncBody(), syncItemKeys,
+                                                            checkpoints ? checkpoints[count] : NULL);
             if(itemret){
                 char *name = toMultibyte(sources[count]->getName());
                 LOG.error("Error #%d in source %s", itemret, name);
@@ -1753,6 +1837,10 @@ int SyncManager::sync() {
                 setError(itemret, "");
                 break;
             }
+            if (checkpoints) {
+                // the items acknowledged so far won't be sent again
+                checkpoints[count]->commit();
+            }
             
             if (config.isToAbort()) {
                 ret = SYNC_ABORTED_BY_CLIENT;
@@ -1774,9 +1862,9 @@ int SyncManager::sync() {
             }
             if (statusList.size()) {
                 Status* status = syncMLBuilder.prepareSyncHdrStatus(NULL, 200);
-                commands.add(*status);
-                deleteStatus(&status);
-                commands.add(&statusList);
+                commands.adopt(status);
+                status = NULL;
+                commands.adopt(&statusList);
             }
             
             // Add any map command pending for the active sources
@@ -1818,8 +1906,8 @@ int SyncManager::sync() {
     //
     if ( !isFinalfromServer && isAtLeastOneSourceCorrect ) {
         status = syncMLBuilder.prepareSyncHdrStatus(NULL, 200);
-        commands.add(*status);
-        deleteStatus(&status);
+        commands.adopt(status);
+        status = NULL;
         for (count = 0; count < sourcesNumber; count ++) {
             if(!sources[count]->getReport()->checkState()) {
                 continue;
@@ -1830,13 +1918,13 @@ int SyncManager::sync() {
                 (sources[count]->getSyncMode() != SYNC_INCREMENTAL_SMART_ONE_WAY_FROM_CLIENT))
             {
                 alert = syncMLBuilder.prepareAlert(*sources[count]);
-                commands.add(*alert);
-                deleteAlert(&alert);
+                commands.adopt(alert);
+                alert = NULL;
             }
         }
         
-        syncml = syncMLBuilder.prepareSyncML(&commands, sendFinalAfterClientMods);
-        msg    = syncMLBuilder.prepareMsg(syncml);
+        syncml = syncMLBuilder.prepareSyncMLAdopt(&commands, sendFinalAfterClientMods);
+        msg    = formatMessage(syncml);
         
         LOG.debug("Alert to request server changes");
         
@@ -1847,7 +1935,7 @@ int SyncManager::sync() {
             goto finally;
         }
         
-        responseMsg = transportAgent->sendMessage(msg);
+        responseMsg = exchangeMessage(msg);
         
         if (config.isToAbort()) {
             ret = SYNC_ABORTED_BY_CLIENT;
@@ -1873,7 +1961,7 @@ int SyncManager::sync() {
         deleteSyncML(&syncml);
         safeDelete(&msg);
         
-        syncml = syncMLProcessor.processMsg(responseMsg);
+        syncml = parseMessage(responseMsg);
         safeDelete(&responseMsg);
         commands.clear();
         
@@ -1901,14 +1989,14 @@ int SyncManager::sync() {
             ArrayList statusList;
             
             status = syncMLBuilder.prepareSyncHdrStatus(NULL, 200);
-            commands.add(*status);
-            deleteStatus(&status);
+            commands.adopt(status);
+            status = NULL;
             
             if (checkForServerChanges(syncml, statusList)) {
                 goto finally;
             }
             
-            commands.add(&statusList);
+            commands.adopt(&statusList);
             
             // Add any map command pending for the active sources
             for(int i=0; i<sourcesNumber; i++) {
@@ -1919,8 +2007,8 @@ int SyncManager::sync() {
             
             if (!last) {
                 deleteSyncML(&syncml);
-                syncml = syncMLBuilder.prepareSyncML(&commands, last);
-                msg    = syncMLBuilder.prepareMsg(syncml);
+                syncml = syncMLBuilder.prepareSyncMLAdopt(&commands, last);
+                msg    = formatMessage(syncml);
                 
                 LOG.debug("Status to the server");
                 
@@ -1931,7 +2019,7 @@ int SyncManager::sync() {
                     goto finally;
                 }
                 
-                responseMsg = transportAgent->sendMessage(msg);
+                responseMsg = exchangeMessage(msg);
                 
                 if (config.isToAbort()) {
                     ret = SYNC_ABORTED_BY_CLIENT;
@@ -1961,7 +2049,7 @@ int SyncManager::sync() {
                 deleteSyncML(&syncml);
                 safeDelete(&msg);
                 
-                syncml = syncMLProcessor.processMsg(responseMsg);
+                syncml = parseMessage(responseMsg);
                 safeDelete(&responseMsg);
                 commands.clear();
                 if (syncml == NULL) {
@@ -2020,13 +2108,11 @@ void SyncManager::addMapCommand(int sourceIndex) {
         KeyValuePair* kvp = (KeyValuePair*)en.getNextElement();
         SyncMap sMap(kvp->getValue(), kvp->getKey());
         MapItem* mapItem = syncMLBuilder.prepareMapItem(&sMap);
-        syncMLBuilder.addMapItem(map, mapItem);
-        delete mapItem;
+        syncMLBuilder.adoptMapItem(map, mapItem);
     }
     if (map) {
         // Add it to the list
-        commands.add(*map);
-        delete map;
+        commands.adopt(map);
     }
     
 }
@@ -2066,8 +2152,8 @@ int SyncManager::endSync() {
             
             if (commands.isEmpty()) {
                 status = syncMLBuilder.prepareSyncHdrStatus(NULL, 200);
-                commands.add(*status);
-                deleteStatus(&status);
+                commands.adopt(status);
+                status = NULL;
             }
             // @@ No more used when inserting the new mapping...
             // Add any map command pending for this source
@@ -2083,8 +2169,8 @@ int SyncManager::endSync() {
     // Send the final message with mappings.
     //
     if (msgToSend) {
-        syncml = syncMLBuilder.prepareSyncML(&commands, true);
-        mapMsg = syncMLBuilder.prepareMsg(syncml);
+        syncml = syncMLBuilder.prepareSyncMLAdopt(&commands, true);
+        mapMsg = formatMessage(syncml);
         
         LOG.debug("Mapping");
         
@@ -2099,7 +2185,7 @@ int SyncManager::endSync() {
         //Fire Finalization Event
         fireSyncEvent(NULL, SEND_FINALIZATION);
         
-        responseMsg = transportAgent->sendMessage(mapMsg);
+        responseMsg = exchangeMessage(mapMsg);
         if (responseMsg == NULL || !responseMsg[0]) {
             ret=getLastErrorCode();
             if (ret == 0) {
@@ -2127,7 +2213,7 @@ int SyncManager::endSync() {
         deleteSyncML(&syncml);
         safeDelete(&mapMsg);
         
-        syncml = syncMLProcessor.processMsg(responseMsg);
+        syncml = parseMessage(responseMsg);
         delete [] responseMsg; responseMsg = NULL;
         commands.clear();
         
@@ -2155,7 +2241,12 @@ int SyncManager::endSync() {
             continue;
         }
         
-        int sret = sources[count]->endSync();
+        int sret;
+        {
+            SyncStats::Timer timer(syncReport.getStats(), PHASE_CACHE_SAVE,
+                                   sources[count]->getConfig().getName());
+            sret = sources[count]->endSync();
+        }
         if (sret) {
             setErrorF(sret, "Error in endSync of source '%s'", sources[count]->getConfig().getName());
         }
@@ -2176,6 +2267,9 @@ finally:
         LOG.debug("Committing changes for source '%s'", sources[count]->getConfig().getName());
         
         commitChanges(*sources[count]);
+        if (checkpoints) {
+            checkpoints[count]->clear();
+        }
     }
     
     //config.setEndSync((unsigned long)time(NULL)); not used actually
@@ -2244,6 +2338,54 @@ bool SyncManager::commitChanges(SyncSource& source) {
     }
 }
 
+/**
+ * Sets how the sync of the source goes on with its checkpoint, given the
+ * sync mode alerted by the server: the checkpointed session is resumed,
+ * or a new checkpoint is started. Returns true if the resume alert got no
+ * answer, so that the sync alert is sent instead.
+ */
+bool SyncManager::initCheckpoint(int sourceIndex, SyncMode preferred, bool resumeRequested) {
+    SyncSource& source = *sources[sourceIndex];
+    SyncCheckpoint& checkpoint = *checkpoints[sourceIndex];
+    const char* name = source.getConfig().getName();
+    SyncMode mode = source.getSyncMode();
+    
+    if (resumeRequested) {
+        if (mode == SYNC_ALERT_RESUME) {
+            source.setSyncMode(checkpoint.getSyncMode());
+            checkpoint.setResumed(true);
+            LOG.info("%s: resuming the sync of %s, %d items already sent",
+                     __FUNCTION__, name, checkpoint.getAcknowledgedCount());
+            return false;
+        }
+        if (mode == SYNC_NONE) {
+            // no answer to the resume alert: it won't be sent again, the
+            // sync alert is sent instead keeping the checkpoint
+            checkpoint.setResumeRefused();
+            LOG.info("%s: resume not supported by the server for source %s, sending the sync alert",
+                     __FUNCTION__, name);
+            return true;
+        }
+    }
+    if (checkpoint.canContinue(preferred, mode)) {
+        // the server goes on with the same incremental sync: the items
+        // it has acknowledged don't need to be sent again
+        if (checkpoint.restart(source.getNextSync())) {
+            LOG.error("%s: cannot save the checkpoint of %s", __FUNCTION__, name);
+        }
+        checkpoint.setResumed(true);
+        LOG.info("%s: going on with the sync of %s, %d items already sent",
+                 __FUNCTION__, name, checkpoint.getAcknowledgedCount());
+        return false;
+    }
+    // a new session: if the resume alert was sent with the last anchor
+    // of the checkpoint, the server starts a new session anyway
+    if (checkpoint.start(mode, preferred, source.getNextSync())) {
+        LOG.error("%s: cannot save the checkpoint of %s", __FUNCTION__, name);
+    }
+    return false;
+}
+
 /**
  * This method copies the valid sources into the member <code>sources</code>.
  * The check done before the source is put in the list are:
@@ -2301,13 +2443,46 @@ int SyncManager::assignSources(SyncSource** srclist) {
     return activeSources;
 }
 
+/**
+ * The function that goes on with the enumeration started by the given one.
+ */
+static SyncItem* (SyncSource::* nextItemFunction(SyncItem* (SyncSource::* f)()))() {
+    if (f == &SyncSource::getFirstItem)        return &SyncSource::getNextItem;
+    if (f == &SyncSource::getFirstNewItem)     return &SyncSource::getNextNewItem;
+    if (f == &SyncSource::getFirstUpdatedItem) return &SyncSource::getNextUpdatedItem;
+    if (f == &SyncSource::getFirstDeletedItem) return &SyncSource::getNextDeletedItem;
+    return f;
+}
+
 SyncItem* SyncManager::getItem(SyncSource& source, SyncItem* (SyncSource::* getItemFunction)()) {
+    SyncStats::Timer timer(syncReport.getStats(), PHASE_ITEM_READ, source.getConfig().getName());
     SyncItem *syncItem = (source.*getItemFunction)();
     
     if (!syncItem) {
         return NULL;
     }
     
+    // The items already acknowledged by the server in the interrupted
+    // session are not sent again
+    SyncCheckpoint* checkpoint = checkpoints ? checkpoints[count] : NULL;
+    if (checkpoint && checkpoint->isResumed()) {
+        getItemFunction = nextItemFunction(getItemFunction);
+        for (;;) {
+            // the keys are acknowledged as they were sent
+            encodeItemKey(syncItem);
+            if (!checkpoint->isAcknowledged(WCharAsChar(syncItem->getKey()))) {
+                break;
+            }
+            LOG.debug("%s: item %" WCHAR_PRINTF " already sent", __FUNCTION__, syncItem->getKey());
+            delete syncItem;
+            syncItem = (source.*getItemFunction)();
+            if (!syncItem) {
+                return NULL;
+            }
+        }
+    }
+    timer.setBytes(syncItem->getDataSize());
+    
     // change encryption automatically only for supported ones (currently only DES)
     const char* encoding   = source.getConfig().getEncoding();
     const char* encryption = source.getConfig().getEncryption();
@@ -2327,6 +2502,81 @@ SyncItem* SyncManager::getItem(SyncSource& source, SyncItem* (SyncSource::* getI
     return syncItem;
 }
 
+char* SyncManager::formatMessage(SyncML* syncml) {
+    SyncStats& stats = syncReport.getStats();
+    stats.beginMessage();
+    
+    SyncStats::Timer timer(stats, PHASE_FORMAT);
+    char* msg = syncMLBuilder.prepareMsg(syncml);
+    if (msg) {
+        timer.setBytes(strlen(msg));
+    }
+    return msg;
+}
+
+char* SyncManager::exchangeMessage(const char* msg) {
+    SyncStats& stats = syncReport.getStats();
+    
+    // The messages are always built as XML: with WBXML enabled,
+    // they are encoded just before going on the wire.
+    char* wbxml = NULL;
+    unsigned int wbxmlSize = 0;
+    if (msg && config.getWBXML()) {
+        SyncStats::Timer timer(stats, PHASE_FORMAT);
+        wbxml = WBXMLEncoder::encode(msg, &wbxmlSize);
+        if (!wbxml) {
+            setError(ERR_REPRESENTATION, "Cannot encode the message as WBXML");
+            return NULL;
+        }
+        timer.setBytes(wbxmlSize);
+    }
+    
+    int64_t start = SyncStats::now();
+    char* response = wbxml ? transportAgent->sendMessage(wbxml, wbxmlSize)
+                           : transportAgent->sendMessage(msg);
+    int64_t elapsed = SyncStats::now() - start;
+    
+    int64_t sent = wbxml ? wbxmlSize : (msg ? strlen(msg) : 0);
+    int64_t received = response ? transportAgent->getResponseSize() : 0;
+    if (response && received == 0) {
+        // The agent can't tell the size: it only receives text
+        received = strlen(response);
+    }
+    delete [] wbxml;
+    int64_t sendTime, waitTime, receiveTime;
+    if (transportAgent->getLastTimings(&sendTime, &waitTime, &receiveTime)) {
+        stats.add(PHASE_TRANSPORT_SEND,    sendTime,    sent);
+        stats.add(PHASE_TRANSPORT_WAIT,    waitTime);
+        stats.add(PHASE_TRANSPORT_RECEIVE, receiveTime, received);
+    } else {
+        // the agent can't tell the steps apart: it's all waiting
+        stats.add(PHASE_TRANSPORT_SEND,    0,       sent);
+        stats.add(PHASE_TRANSPORT_WAIT,    elapsed);
+        stats.add(PHASE_TRANSPORT_RECEIVE, 0,       received);
+    }
+    
+    // The server may answer in WBXML whatever the request was
+    if (response && WBXMLDecoder::isWBXML(response, (unsigned int)received)) {
+        SyncStats::Timer timer(stats, PHASE_PARSE);
+        timer.setBytes(received);
+        char* xml = WBXMLDecoder::decode(response, (unsigned int)received);
+        delete [] response;
+        response = xml;
+        if (!response) {
+            setError(ERR_REPRESENTATION, "Cannot decode the WBXML response");
+        }
+    }
+    return response;
+}
+
+SyncML* SyncManager::parseMessage(char* msg) {
+    SyncStats::Timer timer(syncReport.getStats(), PHASE_PARSE);
+    if (msg) {
+        timer.setBytes(strlen(msg));
+    }
+    return syncMLProcessor.processMsg(msg);
+}
+
 Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, SyncMLBuilder &syncMLBuilder)
 {
     const char* itemName;
@@ -2350,19 +2600,19 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
     }
     
     // Fill item -------------------------------------------------
-    WCHAR *iname = toWideChar(itemName);
+    CharAsWChar iname(itemName);
     bool append = true;
     if (incomingItem) {
         bool newItem = false;
         
         if (iname) {
             if (incomingItem->getKey()) {
-                if(wcscmp(incomingItem->getKey(), iname)) {
+                if(wcscmp(incomingItem->getKey(), iname.c_str())) {
                     // another item before old one is complete
                     newItem = true;
                 }
             } else {
-                incomingItem->setKey(iname);
+                incomingItem->setKey(iname.c_str());
             }
         }
         
@@ -2381,14 +2631,13 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
             //
             // The target information is the one from the item's source.
             Alert *alert = syncMLBuilder.prepareAlert(*sources[incomingItem->sourceIndex], 223);
-            commands.add(*alert);
-            delete alert;
+            commands.adopt(alert);
             
             delete incomingItem;
             incomingItem = NULL;
         }
     } else {
-        incomingItem = new IncomingSyncItem(iname, cmdInfo, count, itemName, NULL == item->getSource() ? NULL : item->getSource()->getLocURI());
+        incomingItem = new IncomingSyncItem(iname.c_str(), cmdInfo, count, itemName, NULL == item->getSource() ? NULL : item->getSource()->getLocURI());
         
         // incomplete item?
         if (item->getMoreData()) {
@@ -2407,7 +2656,6 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
             append = false;
         }
     }
-    delete [] iname;
     
     if (incomingItem) {
         ComplexData *cdata = item->getData();
@@ -2479,16 +2727,10 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
     
     if (incomingItem) {
         if (cmdInfo.dataType) {
-            WCHAR *dtype = toWideChar(cmdInfo.dataType);
-            incomingItem->setDataType(dtype);
-            delete [] dtype;
+            incomingItem->setDataType(cmdInfo.dataType);
         }
-        WCHAR *sparent = toWideChar(item->getSourceParent());
-        incomingItem->setSourceParent(sparent);
-        delete [] sparent;
-        WCHAR *tparent = toWideChar(item->getTargetParent());
-        incomingItem->setTargetParent(tparent);
-        delete [] tparent;
+        incomingItem->setSourceParent(item->getSourceParent());
+        incomingItem->setTargetParent(item->getTargetParent());
         
         incomingItem->setModificationTime(sources[count]->getNextSync());
         
@@ -2523,12 +2765,9 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
                 if (targetParent.empty()) {
                     StringBuffer parentGUID(item->getSourceParent());
                     if (!parentGUID.empty()) {
-                        Enumeration& mappings = mmanager[count]->getMappings();
-                        const StringBuffer& parentLUID = lookupMappings(mappings, parentGUID);
+                        const StringBuffer& parentLUID = mmanager[count]->lookupMapping(parentGUID.c_str());
                         
-                        WCHAR* tparent = toWideChar(parentLUID.c_str());
-                        incomingItem->setTargetParent(tparent);
-                        delete [] tparent;
+                        incomingItem->setTargetParent(parentLUID.c_str());
                     }
                 }
                 
@@ -2567,8 +2806,7 @@ Status *SyncManager::processSyncItem(Item* item, const CommandInfo &cmdInfo, Syn
         // may be omitted, but because that's hard to determine here we always
         // send it, just to be on the safe side.
         Alert *alert = syncMLBuilder.prepareAlert(*sources[count], 222);
-        commands.add(*alert);
-        delete alert;
+        commands.adopt(alert);
     }
     
     return status;
@@ -2876,7 +3114,8 @@ void SyncManager::initTransportAgent(const URL& url) {
     transportAgent->setCompression(config.getCompression());
     
     // Set a default content type
-    transportAgent->setProperty(TA_PropertyContentType, SYNCML_CONTENT_TYPE);
+    transportAgent->setProperty(TA_PropertyContentType,
+                                config.getWBXML() ? SYNCML_WBXML_CONTENT_TYPE : SYNCML_CONTENT_TYPE);
     
     // Set the deviceId for each http request
     transportAgent->setProperty(TA_PropertyDeviceId, deviceId);
@@ -167,6 +167,7 @@ void SyncReport::initialize() {
     lastErrorMsg   = "";
     lastErrorType  = "";
     ssReport.clear();
+    stats.reset();
 }
 
 void SyncReport::toString(StringBuffer &str, bool verbose) {
@@ -266,6 +267,12 @@ void SyncReport::toString(StringBuffer &str, bool verbose) {
 #endif
     }
     str += "\n";
+
+    if (verbose && stats.getMessageCount() > 0) {
+        str += "Performance counters:\n";
+        stats.toJSON(str, true);
+        str += "\n\n";
+    }
 }
 
 void SyncReport::assign(const SyncReport& sr) {
@@ -278,4 +285,5 @@ void SyncReport::assign(const SyncReport& sr) {
         SyncSourceReport* ssr = sr.getSyncSourceReport(i);
         if (ssr) ssReport.add(*ssr);
     }
+    stats = sr.getStats();
 }
@@ -39,8 +39,12 @@
 #include "client/SyncClient.h"
 #include "spds/spdsutils.h"
 #include "spds/SyncSourceConfig.h"
+#include "push/TaskExecutor.h"
 #include "base/globalsdef.h"
 
+#include <map>
+#include <string>
+
 USE_NAMESPACE
 
 static SyncSourceConfig defaultConfig;
@@ -283,19 +287,119 @@ void SyncSource::serverStatusPackageEnded() {
 void SyncSource::clientStatusPackageEnded() {
 }
 
-void SyncSource::applyItems(ArrayList &items) {
-    int syncStatus = 0;
+/**
+ * Adds, updates or deletes the item, according to its state.
+ * @return the status code of the source
+ */
+static int applyItem(SyncSource& source, SyncItem& item) {
+    switch (item.getState()) {
+        case SYNC_STATE_NEW:
+            return source.addItem(item);
+        case SYNC_STATE_UPDATED:
+            return source.updateItem(item);
+        case SYNC_STATE_DELETED:
+            return source.deleteItem(item);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Applies a group of items of a package which depend on each other,
+ * in order, on a worker of the TaskExecutor.
+ */
+class ApplyItemsTask : public Task {
+
+public:
+
+    ApplyItemsTask(SyncSource& s, ArrayList& i) : source(s), items(i) {}
+
+    /// Indexes in 'items' of the group, in the order of the commands
+    std::vector<int> group;
+
+    void run() {
+        for (size_t i = 0; i < group.size(); i++) {
+            applyItem(source, *(SyncItem*)items[group[i]]);
+        }
+    }
+
+private:
+
+    SyncSource& source;
+    ArrayList&  items;
+};
+
+/**
+ * Group of the item: the group of a previous item with the same key or
+ * whose key is the parent of this one, -1 if the item is independent.
+ */
+static int findItemGroup(std::map<std::string, int>& groups, SyncItem& item) {
+    const WCHAR* keys[] = { item.getKey(), item.getTargetParent(), item.getSourceParent() };
+    for (int k = 0; k < 3; k++) {
+        if (keys[k] == NULL || keys[k][0] == 0) {
+            continue;
+        }
+        std::map<std::string, int>::iterator it = groups.find(WCharAsChar(keys[k]).c_str());
+        if (it != groups.end()) {
+            return it->second;
+        }
+    }
+    return -1;
+}
+
+void SyncSource::applyItemsInParallel(ArrayList &items) {
+    TaskExecutor* executor = TaskExecutor::getInstance();
+
+    // group the items: a group is applied in order, the groups in parallel
+    std::vector<ApplyItemsTask*> tasks;
+    std::map<std::string, int> groups;
     for (int i = 0; i < items.size(); i++) {
         SyncItem* item = (SyncItem*)items[i];
-        
-        if (item->getState() == SYNC_STATE_NEW) {
-            syncStatus = addItem(*item);
-        } else if (item->getState() == SYNC_STATE_UPDATED) {
-            syncStatus = updateItem(*item);
-        } else if (item->getState() == SYNC_STATE_DELETED) {
-            syncStatus = deleteItem(*item);
+        int g = findItemGroup(groups, *item);
+        if (g < 0) {
+            g = (int)tasks.size();
+            tasks.push_back(new ApplyItemsTask(*this, items));
+        }
+        tasks[g]->group.push_back(i);
+        if (item->getKey() && item->getKey()[0]) {
+            groups[WCharAsChar(item->getKey()).c_str()] = g;
+        }
+    }
+
+    if (tasks.size() < 2) {
+        for (size_t t = 0; t < tasks.size(); t++) {
+            tasks[t]->run();
+            delete tasks[t];
+        }
+        return;
+    }
+
+    LOG.debug("%s: applying %d items in %d groups", __FUNCTION__, items.size(), (int)tasks.size());
+
+    std::vector<TaskFuture> futures;
+    for (size_t t = 0; t < tasks.size(); t++) {
+        futures.push_back(executor->submit(tasks[t]));
+    }
+
+    // the groups not started yet are applied here, so that this thread
+    // works too and never waits for a worker it is keeping busy
+    for (size_t t = 0; t < futures.size(); t++) {
+        if (futures[t].cancel() || futures[t].isCancelled()) {
+            futures[t].getTask()->run();
+        } else {
+            futures[t].wait();
+        }
+    }
+}
+
+void SyncSource::applyItems(ArrayList &items) {
+    int syncStatus = 0;
+    if (isThreadSafe() && items.size() > 1) {
+        applyItemsInParallel(items);
+    } else {
+        for (int i = 0; i < items.size(); i++) {
+            applyItem(*this, *(SyncItem*)items[i]);
         }
-//        item->setSyncStatus(syncStatus);    
     }
     
     saveAddressBook();
@@ -184,15 +184,24 @@ bool SyncSourceReport::checkState() {
     return false;
 }
 
+#ifndef WCHAR_IS_CHAR
 ItemReport* SyncSourceReport::find(const char* target, const char* command, const WCHAR* ID) {
+    return find(target, command, WCharAsChar(ID).c_str());
+}
+
+void SyncSourceReport::addItem(const char* target, const char* command, const WCHAR* ID,
+                               const int status, const WCHAR* statusMessage) {
+    addItem(target, command, WCharAsChar(ID).c_str(), status, WCharAsChar(statusMessage).c_str());
+}
+#endif
+
+ItemReport* SyncSourceReport::find(const char* target, const char* command, const char* ID) {
     
     if (ID == NULL) {
         return NULL;
     }
-    const char* id = toMultibyte(ID);
     std::map<std::string,ItemReport*>* itemsMap = getMap(target, command);
-    std::map<std::string,ItemReport*>::iterator itemIt = itemsMap->find(id);
-    delete [] id;
+    std::map<std::string,ItemReport*>::iterator itemIt = itemsMap->find(ID);
     if (itemIt != itemsMap->end()) {
         const std::pair<std::string,ItemReport*>& itemPair = *itemIt;
         return itemPair.second;
@@ -202,8 +211,8 @@ ItemReport* SyncSourceReport::find(const char* target, const char* command, cons
 }
 
 
-void SyncSourceReport::addItem(const char* target, const char* command, const WCHAR* ID,
-                               const int status, const WCHAR* statusMessage) {
+void SyncSourceReport::addItem(const char* target, const char* command, const char* ID,
+                               const int status, const char* statusMessage) {
 
     // Skip status 213: it's received many times in case of large objects.
     if (status == STC_CHUNKED_ITEM_ACCEPTED) {
@@ -215,11 +224,9 @@ void SyncSourceReport::addItem(const char* target, const char* command, const WC
         return;
     }
     
-    const char* id = toMultibyte(ID);
-
     // Create the ItemReport element
     std::map<std::string,ItemReport*>* itemsMap = getMap(target, command);
-    std::map<std::string,ItemReport*>::iterator itemIt = itemsMap->find(id);
+    std::map<std::string,ItemReport*>::iterator itemIt = itemsMap->find(ID);
     if (itemIt != itemsMap->end()) {
         // The item already exists
         const std::pair<std::string,ItemReport*>& itemPair = *itemIt;
@@ -227,14 +234,13 @@ void SyncSourceReport::addItem(const char* target, const char* command, const WC
         existingItem->setStatus(status);
     } else {
         // This is a new item
-        ItemReport* element = new ItemReport(ID, status, statusMessage);
+        ItemReport* element = new ItemReport(CharAsWChar(ID).c_str(), status,
+                                             CharAsWChar(statusMessage).c_str());
         std::pair<std::string,ItemReport*> mapValue;
-        mapValue.first = id;
+        mapValue.first = ID;
         mapValue.second = element;
         itemsMap->insert(mapValue);
     }
-
-    delete [] id;
 }
 
 int SyncSourceReport::getItemReportCount(const char* target, const char* command) {
@@ -0,0 +1,199 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "spds/SyncStats.h"
+#include "base/util/JsonWriter.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+static const char* phaseNames[SYNC_PHASE_COUNT] = {
+    "prepareSync",
+    "changeDetection",
+    "itemRead",
+    "format",
+    "transportSend",
+    "transportWait",
+    "transportReceive",
+    "parse",
+    "applyChanges",
+    "cacheSave"
+};
+
+/// Writes the phases which ran, as members of the current object.
+static void writeCounters(JsonWriter& writer, const PhaseCounter* counters) {
+    for (int i = 0; i < SYNC_PHASE_COUNT; i++) {
+        const PhaseCounter& c = counters[i];
+        if (c.calls == 0) {
+            continue;
+        }
+        writer.beginObject(phaseNames[i]);
+        writer.addInt("usec",  c.time);
+        writer.addInt("bytes", c.bytes);
+        writer.addInt("calls", c.calls);
+        writer.endObject();
+    }
+}
+
+//--------------------------------------------------- Constructor & Destructor
+
+SyncStats::Counters::Counters() {
+    memset(phase, 0, sizeof(phase));
+}
+
+SyncStats::SyncStats() : messageCount(0) {}
+
+void SyncStats::reset() {
+    totals = Counters();
+    sources.clear();
+    messages.clear();
+    messageCount = 0;
+}
+
+//------------------------------------------------------------- Public Methods
+
+void SyncStats::add(SyncPhase phase, int64_t micros, int64_t bytes, const char* source) {
+
+    if (phase < 0 || phase >= SYNC_PHASE_COUNT) {
+        return;
+    }
+    if (micros < 0) {
+        micros = 0;
+    }
+
+    PhaseCounter* c = &totals.phase[phase];
+    c->time += micros; c->bytes += bytes; c->calls++;
+
+    if (source && source[0]) {
+        c = &sources[source].phase[phase];
+        c->time += micros; c->bytes += bytes; c->calls++;
+    }
+
+    // the current message, unless past the ones kept
+    if (messageCount > 0 && messageCount <= SYNC_STATS_MAX_MESSAGES) {
+        c = &messages.back().phase[phase];
+        c->time += micros; c->bytes += bytes; c->calls++;
+    }
+}
+
+void SyncStats::beginMessage() {
+    messageCount++;
+    if (messageCount <= SYNC_STATS_MAX_MESSAGES) {
+        messages.push_back(Counters());
+    }
+}
+
+PhaseCounter SyncStats::getCounter(SyncPhase phase, const char* source) const {
+
+    PhaseCounter empty = { 0, 0, 0 };
+    if (phase < 0 || phase >= SYNC_PHASE_COUNT) {
+        return empty;
+    }
+    if (source == NULL) {
+        return totals.phase[phase];
+    }
+    std::map<std::string, Counters>::const_iterator it = sources.find(source);
+    if (it == sources.end()) {
+        return empty;
+    }
+    return it->second.phase[phase];
+}
+
+void SyncStats::toJSON(StringBuffer& out, bool prettyPrint) const {
+
+    JsonWriter writer(out, prettyPrint);
+
+    writer.beginObject();
+    writer.addInt("messages", messageCount);
+
+    writer.beginObject("totals");
+    writeCounters(writer, totals.phase);
+    writer.endObject();
+
+    writer.beginObject("sources");
+    std::map<std::string, Counters>::const_iterator it;
+    for (it = sources.begin(); it != sources.end(); it++) {
+        writer.beginObject(it->first.c_str());
+        writeCounters(writer, it->second.phase);
+        writer.endObject();
+    }
+    writer.endObject();
+
+    writer.beginArray("perMessage");
+    for (size_t i = 0; i < messages.size(); i++) {
+        writer.beginObject();
+        writeCounters(writer, messages[i].phase);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.endObject();
+}
+
+const char* SyncStats::getPhaseName(SyncPhase phase) {
+    if (phase < 0 || phase >= SYNC_PHASE_COUNT) {
+        return "";
+    }
+    return phaseNames[phase];
+}
+
+int64_t SyncStats::now() {
+
+#ifdef WIN32
+    LARGE_INTEGER count, frequency;
+    if (QueryPerformanceFrequency(&frequency) && QueryPerformanceCounter(&count)) {
+        return (int64_t)(count.QuadPart / frequency.QuadPart) * 1000000 +
+               (int64_t)(count.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+    }
+    return (int64_t)GetTickCount64() * 1000;
+#else
+#  ifdef CLOCK_MONOTONIC
+    struct timespec t;
+    if (clock_gettime(CLOCK_MONOTONIC, &t) == 0) {
+        return (int64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+    }
+#  endif
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
@@ -93,6 +93,13 @@ void Data::setData(const char* data) {
     this->data = stringdup(data);
 }
 
+void Data::adoptData(char* data) {
+    if (this->data && this->data != data) {
+        delete [] this->data;
+    }
+    this->data = data;
+}
+
 /**
 * Gets the data properties
 *
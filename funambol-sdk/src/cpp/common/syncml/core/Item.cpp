@@ -221,6 +221,13 @@ void Item::setData(ComplexData* data) {
     }
 }
 
+void Item::adoptData(ComplexData* data) {
+    if (this->data != data) {
+        delete this->data;
+    }
+    this->data = data;
+}
+
 /**
 * Gets the Boolean value of moreData
 *
@@ -161,6 +161,22 @@ void ItemizedCommand::setItems(ArrayList* items) {
 
 }
 
+/**
+* Replaces the items moving the ones of the given list
+*
+* @param items the list of Item to move, left empty
+*/
+void ItemizedCommand::adoptItems(ArrayList* items) {
+    if (this->items) {
+        this->items->clear();
+    } else {
+        this->items = new ArrayList();
+    }
+    if (items) {
+        this->items->adopt(items);
+    }
+}
+
 /**
 * Gets the Meta object
 *
@@ -173,6 +173,24 @@ void Map::setMapItems(ArrayList* mapItems) {
     }
 }
 
+/**
+* Replaces the mapItems moving the ones of the given list
+*
+* @param mapItems the map items to move, left empty - NOT NULL
+*
+*/
+void Map::adoptMapItems(ArrayList* mapItems) {
+    if (mapItems == NULL) {
+        return;
+    }
+    if (this->mapItems) {
+        this->mapItems->clear();
+    } else {
+        this->mapItems = new ArrayList();
+    }
+    this->mapItems->adopt(mapItems);
+}
+
 /**
 * Returns the command name
 *
@@ -119,6 +119,7 @@ Target* Sync::getTarget() {
 *
 */
 void Sync::setTarget(Target* target) {
+    formattedTargetSource.reset();
     if (this->target) {
         delete this->target; this->target = NULL;
     }
@@ -143,6 +144,7 @@ Source* Sync::getSource() {
 * @param source the Source object property
 */
 void Sync::setSource(Source* source) {
+    formattedTargetSource.reset();
     if (this->source) {
         delete this->source; this->source = NULL;
     }
@@ -190,6 +192,24 @@ void Sync::setCommands(ArrayList* commands) {
     }
 }
 
+/**
+* Replaces the commands moving the ones of the given list
+*
+* @param commands the commands to move, left empty - NOT NULL
+*
+*/
+void Sync::adoptCommands(ArrayList* commands) {
+    if (commands == NULL) {
+        return;
+    }
+    if (this->commands) {
+        this->commands->clear();
+    } else {
+        this->commands = new ArrayList();
+    }
+    this->commands->adopt(commands);
+}
+
 /**
 * Gets the total number of changes
 *
@@ -213,8 +233,17 @@ const char* Sync::getName() {
     return COMMAND_NAME;
 }
 
+void Sync::setFormattedTargetSource(const char* xml) {
+    formattedTargetSource = xml;
+}
+
+const char* Sync::getFormattedTargetSource() {
+    return formattedTargetSource.empty() ? NULL : formattedTargetSource.c_str();
+}
+
 ArrayElement* Sync::clone() {
     Sync* ret = new Sync(getCmdID(), getNoResp(), getCred(), target, source, getMeta(), numberOfChanges, commands);
+    ret->setFormattedTargetSource(getFormattedTargetSource());
     return ret;
 }
 
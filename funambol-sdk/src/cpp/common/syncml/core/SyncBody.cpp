@@ -116,6 +116,25 @@ void SyncBody::setCommands(ArrayList* commands) {
     }
 }
 
+/**
+* Replaces the commands moving the ones of the given list
+*
+* @param commands the commands to move, left empty - NOT NULL
+*
+*/
+void SyncBody::adoptCommands(ArrayList* commands) {
+    if (commands == NULL) {
+        LOG.error("SyncBody::adoptCommands: null command list");
+        return;
+    }
+    if (this->commands) {
+        this->commands->clear();
+    } else {
+        this->commands = new ArrayList();
+    }
+    this->commands->adopt(commands);
+}
+
 /**
 * Sets the message as final
 *
@@ -98,6 +98,19 @@ void SyncML::setSyncHdr(SyncHdr* header) {
     }
 }
 
+/**
+* Sets the SyncML header, taking its ownership
+*
+* @param header the SyncML header - NOT NULL
+*
+*/
+void SyncML::adoptSyncHdr(SyncHdr* header) {
+    if (this->header && this->header != header) {
+        delete this->header;
+    }
+    this->header = header;
+}
+
 /**
 * Returns the SyncML body
 *
@@ -126,6 +139,19 @@ void SyncML::setSyncBody(SyncBody* body) {
     }
 }
 
+/**
+* Sets the SyncML body, taking its ownership
+*
+* @param body the SyncML body - NOT NULL
+*
+*/
+void SyncML::adoptSyncBody(SyncBody* body) {
+    if (this->body && this->body != body) {
+        delete this->body;
+    }
+    this->body = body;
+}
+
 /**
 * Is this message the last one of the package?
 *
@@ -0,0 +1,171 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#include "syncml/core/WBXMLTags.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+// The tag tokens of every code page start at 0x05, after the global tokens.
+#define FIRST_TAG_TOKEN 0x05
+#define TABLE_SIZE(t)   ((int)(sizeof(t) / sizeof(t[0])))
+
+// SyncML 1.2, code page 0 (SyncML 1.1 is the subset up to MoreData)
+static const char* const syncmlTags[] = {
+    "Add", "Alert", "Archive", "Atomic", "Chal", "Cmd", "CmdID", "CmdRef",
+    "Copy", "Cred", "Data", "Delete", "Exec", "Final", "Get", "Item",
+    "Lang", "LocName", "LocURI", "Map", "MapItem", "Meta", "MsgID", "MsgRef",
+    "NoResp", "NoResults", "Put", "Replace", "RespURI", "Results", "Search", "Sequence",
+    "SessionID", "SftDel", "Source", "SourceRef", "Status", "Sync", "SyncBody", "SyncHdr",
+    "SyncML", "Target", "TargetRef", NULL /* 0x30: reserved */, "VerDTD", "VerProto", "NumberOfChanges", "MoreData",
+    "Field", "Filter", "Record", "FilterType", "SourceParent", "TargetParent", "Move", "Correlator"
+};
+
+// SyncML 1.2, code page 1 (MetInf)
+static const char* const metinfTags[] = {
+    "Anchor", "EMI", "Format", "FreeID", "FreeMem", "Last", "Mark", "MaxMsgSize",
+    "Mem", "MetInf", "Next", "NextNonce", "SharedMem", "Size", "Type", "Version",
+    "MaxObjSize", "FieldLevel"
+};
+
+// DevInf 1.2, code page 0 (0x1C was "Size" in DevInf 1.1)
+static const char* const devinfTags[] = {
+    "CTCap", "CTType", "DataStore", "DataType", "DevID", "DevInf", "DevTyp", "DisplayName",
+    "DSMem", "Ext", "FwV", "HwV", "Man", "MaxGUIDSize", "MaxID", "MaxMem",
+    "Mod", "OEM", "ParamName", "PropName", "Rx", "Rx-Pref", "SharedMem", "MaxSize",
+    "SourceRef", "SwV", "SyncCap", "SyncType", "Tx", "Tx-Pref", "ValEnum", "VerCT",
+    "VerDTD", "XNam", "XVal", "UTC", "SupportNumberOfChanges", "SupportLargeObjs", "Property", "PropParam",
+    "MaxOccur", "NoTruncate", NULL /* 0x2F: reserved */, "Filter-Rx", "FilterCap", "FilterKeyword", "FieldLevel", "SupportHierarchicalSync"
+};
+
+// Well-known numeric public identifiers
+#define PUBLIC_ID_SYNCML_1_0    0x0FD1
+#define PUBLIC_ID_DEVINF_1_0    0x0FD2
+#define PUBLIC_ID_SYNCML_1_1    0x0FD3
+#define PUBLIC_ID_DEVINF_1_1    0x0FD4
+#define PUBLIC_ID_SYNCML_1_2    0x1201
+#define PUBLIC_ID_DEVINF_1_2    0x1203
+
+/**
+ * Returns the table of the code page, and its size in count.
+ */
+static const char* const* getTable(WBXMLDocType doc, int page, int* count) {
+
+    if (doc == WBXML_DOC_SYNCML && page == WBXML_PAGE_SYNCML) {
+        *count = TABLE_SIZE(syncmlTags);
+        return syncmlTags;
+    }
+    if (doc == WBXML_DOC_SYNCML && page == WBXML_PAGE_METINF) {
+        *count = TABLE_SIZE(metinfTags);
+        return metinfTags;
+    }
+    if (doc == WBXML_DOC_DEVINF && page == 0) {
+        *count = TABLE_SIZE(devinfTags);
+        return devinfTags;
+    }
+    *count = 0;
+    return NULL;
+}
+
+const char* WBXMLTags::getTagName(WBXMLDocType doc, int page, int token) {
+
+    int count = 0;
+    const char* const* table = getTable(doc, page, &count);
+    int index = token - FIRST_TAG_TOKEN;
+    if (!table || index < 0 || index >= count) {
+        return NULL;
+    }
+    return table[index];
+}
+
+int WBXMLTags::getToken(WBXMLDocType doc, int page, const char* name, size_t len) {
+
+    int count = 0;
+    const char* const* table = getTable(doc, page, &count);
+    for (int i = 0; i < count; i++) {
+        const char* tag = table[i];
+        if (tag && tag[0] == name[0] && strncmp(tag, name, len) == 0 && tag[len] == 0) {
+            return i + FIRST_TAG_TOKEN;
+        }
+    }
+    return -1;
+}
+
+const char* WBXMLTags::getPublicId(WBXMLDocType doc, const char* verDTD) {
+
+    bool devinf = (doc == WBXML_DOC_DEVINF);
+    if (verDTD && strcmp(verDTD, "1.2") == 0) {
+        return devinf ? "-//SYNCML//DTD DevInf 1.2//EN" : "-//SYNCML//DTD SyncML 1.2//EN";
+    }
+    if (verDTD && strcmp(verDTD, "1.0") == 0) {
+        return devinf ? "-//SYNCML//DTD DevInf 1.0//EN" : "-//SYNCML//DTD SyncML 1.0//EN";
+    }
+    return devinf ? "-//SYNCML//DTD DevInf 1.1//EN" : "-//SYNCML//DTD SyncML 1.1//EN";
+}
+
+bool WBXMLTags::getDocType(unsigned int publicId, WBXMLDocType* doc) {
+
+    switch (publicId) {
+        case PUBLIC_ID_SYNCML_1_0:
+        case PUBLIC_ID_SYNCML_1_1:
+        case PUBLIC_ID_SYNCML_1_2:
+            *doc = WBXML_DOC_SYNCML;
+            return true;
+        case PUBLIC_ID_DEVINF_1_0:
+        case PUBLIC_ID_DEVINF_1_1:
+        case PUBLIC_ID_DEVINF_1_2:
+            *doc = WBXML_DOC_DEVINF;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool WBXMLTags::getDocType(const char* publicId, WBXMLDocType* doc) {
+
+    if (!publicId || strncmp(publicId, "-//SYNCML//DTD ", 15) != 0) {
+        return false;
+    }
+    if (strncmp(publicId + 15, "SyncML ", 7) == 0) {
+        *doc = WBXML_DOC_SYNCML;
+        return true;
+    }
+    if (strncmp(publicId + 15, "DevInf ", 7) == 0) {
+        *doc = WBXML_DOC_DEVINF;
+        return true;
+    }
+    return false;
+}
@@ -128,7 +128,9 @@ StringBuffer* Formatter::getValue(const char* tagName, StringBuffer* value, cons
     sprintf(t1, "<%s%s%s>", tagName, params ? " " : "", params ? params : "");
     sprintf(t2, "</%s>\n", tagName);
 
+    // one allocation: the value can be a whole command with its items data
     StringBuffer* s = new StringBuffer();
+    s->reserve(strlen(t1) + value->length() + strlen(t2));
     s->append(t1);
     s->append(value);
     s->append(t2);
@@ -1080,8 +1082,13 @@ StringBuffer* Formatter::getSync(Sync* sync) {
     cred      = getCred    (sync->getCred());
     meta      = getMeta    (sync->getMeta());
     noResp    = getValue   (NO_RESP, sync->getNoResp());
-    source    = getSource  (sync->getSource());
-    target    = getTarget  (sync->getTarget());
+    if (sync->getFormattedTargetSource()) {
+        // formatted once for all the Sync commands of the source
+        target = new StringBuffer(sync->getFormattedTargetSource());
+    } else {
+        source    = getSource  (sync->getSource());
+        target    = getTarget  (sync->getTarget());
+    }
 
     if (sync->getNumberOfChanges() >= 0) {
         numberOfChanges = new StringBuffer();
@@ -1760,6 +1767,24 @@ StringBuffer* Formatter::getData(ComplexData* data) {
     if (!data)
         return NULL;
 
+    const char* value = data->getData();
+    ArrayList* properties = data->getProperties();
+    if (value && value[0] && !data->getAnchor() && !data->getDevInf() &&
+        (properties == NULL || properties->size() == 0)) {
+        // Only the item data, that can be a large chunk: write the element
+        // directly in a buffer of the right size.
+        StringBuffer* ret = new StringBuffer();
+        ret->reserve(strlen(value) + 2*strlen(DATA) + 20); // tags and CDATA
+        ret->append("<");
+        ret->append(DATA);
+        ret->append(">");
+        formatValue(*ret, value);
+        ret->append("</");
+        ret->append(DATA);
+        ret->append(">\n");
+        return ret;
+    }
+
     StringBuffer s;
 
     StringBuffer* anchor = getAnchor(data->getAnchor());
@@ -1784,7 +1809,6 @@ StringBuffer* Formatter::getData(ComplexData* data) {
     // Now let's process the list of Property (if any)
     //
     int nProps = 0;
-    ArrayList* properties = data->getProperties();
     if (properties) {
         nProps = properties->size();
     }
@@ -0,0 +1,386 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#include "syncml/formatter/WBXMLEncoder.h"
+#include "syncml/core/Constants.h"
+#include "base/Log.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+// Texts at least this long are written in the string table
+#define MIN_TABLE_STRING    6
+
+#define IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+
+/**
+ * True if the len chars of s are the given value.
+ */
+static bool equals(const char* s, size_t len, const char* value) {
+    return strncmp(s, value, len) == 0 && value[len] == 0;
+}
+
+/**
+ * Appends the multi-byte unsigned integer: 7 bits per byte, most
+ * significant first, the continuation bit set on all but the last.
+ */
+static void appendMbUInt(std::string& out, unsigned int value) {
+    char bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = (char)(value & 0x7F);
+        value >>= 7;
+    } while (value);
+    while (--count > 0) {
+        out += (char)(bytes[count] | 0x80);
+    }
+    out += bytes[0];
+}
+
+static void appendUTF8(std::string& out, unsigned long c) {
+    if (c < 0x80) {
+        out += (char)c;
+    } else if (c < 0x800) {
+        out += (char)(0xC0 | (c >> 6));
+        out += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += (char)(0xE0 | (c >> 12));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    } else {
+        out += (char)(0xF0 | (c >> 18));
+        out += (char)(0x80 | ((c >> 12) & 0x3F));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+
+char* WBXMLEncoder::encode(const char* xml, unsigned int* size) {
+
+    if (!xml || !size) {
+        LOG.error("%s: invalid arguments", __FUNCTION__);
+        return NULL;
+    }
+
+    std::string out;
+    WBXMLEncoder encoder(xml, WBXML_DOC_SYNCML);
+    if (!encoder.encodeDocument(out)) {
+        return NULL;
+    }
+
+    char* ret = new char[out.size()];
+    memcpy(ret, out.data(), out.size());
+    *size = (unsigned int)out.size();
+    return ret;
+}
+
+WBXMLEncoder::WBXMLEncoder(const char* xml, WBXMLDocType doc)
+    : pos(xml), document(doc), codePage(0) {
+}
+
+bool WBXMLEncoder::encodeDocument(std::string& out) {
+
+    if (!skipMarkup()) {
+        return false;
+    }
+    if (*pos != '<') {
+        LOG.error("%s: no root element", __FUNCTION__);
+        return false;
+    }
+
+    // The version of the DTD is the first VerDTD of the document: the
+    // SyncHdr one for a message, the DevInf one for a DevInf.
+    char verDTD[4] = "";
+    const char* ver = strstr(pos, "<VerDTD>");
+    if (ver) {
+        strncpy(verDTD, ver + 8, 3);
+        verDTD[3] = 0;
+    }
+    unsigned int publicId = addString(WBXMLTags::getPublicId(document, verDTD), (size_t)-1);
+
+    body.reserve(strlen(pos) / 2);
+    if (!encodeElement(0)) {
+        return false;
+    }
+
+    out += (char)WBXML_VERSION_1_2;
+    appendMbUInt(out, 0);               // literal public identifier...
+    appendMbUInt(out, publicId);        // ...in the string table
+    appendMbUInt(out, WBXML_CHARSET_UTF8);
+    appendMbUInt(out, (unsigned int)strtbl.size());
+    out += strtbl;
+    out += body;
+    return true;
+}
+
+bool WBXMLEncoder::encodeElement(int page) {
+
+    const char* start = pos;
+    const char* name = ++pos;
+    while (*pos && !IS_SPACE(*pos) && *pos != '>' && *pos != '/') {
+        pos++;
+    }
+    size_t nameLen = pos - name;
+    if (nameLen == 0) {
+        LOG.error("%s: invalid tag '%.20s'", __FUNCTION__, start);
+        return false;
+    }
+
+    // Attributes: only the namespace is meaningful in SyncML
+    bool empty = false;
+    for (;;) {
+        while (IS_SPACE(*pos)) {
+            pos++;
+        }
+        if (pos[0] == '/' && pos[1] == '>') {
+            empty = true;
+            pos += 2;
+            break;
+        }
+        if (*pos == '>') {
+            pos++;
+            break;
+        }
+        const char* attr = pos;
+        while (*pos && *pos != '=' && !IS_SPACE(*pos) && *pos != '>') {
+            pos++;
+        }
+        size_t attrLen = pos - attr;
+        while (IS_SPACE(*pos)) {
+            pos++;
+        }
+        char quote = (*pos == '=') ? *++pos : 0;
+        if (attrLen == 0 || (quote != '"' && quote != '\'')) {
+            LOG.error("%s: invalid attribute in <%.*s>", __FUNCTION__, (int)nameLen, name);
+            return false;
+        }
+        const char* value = ++pos;
+        while (*pos && *pos != quote) {
+            pos++;
+        }
+        if (!*pos) {
+            LOG.error("%s: unterminated attribute in <%.*s>", __FUNCTION__, (int)nameLen, name);
+            return false;
+        }
+        size_t valueLen = pos++ - value;
+
+        if (equals(attr, attrLen, "xmlns") && document == WBXML_DOC_SYNCML) {
+            if (equals(value, valueLen, NAMESPACE_METINF)) {
+                page = WBXML_PAGE_METINF;
+            } else if (equals(value, valueLen, NAMESPACE_DEVINF)) {
+                return encodeEmbeddedDevInf(start);
+            } else {
+                page = WBXML_PAGE_SYNCML;
+            }
+        }
+    }
+
+    switchPage(page);
+    unsigned char content = empty ? 0 : WBXML_TAG_CONTENT;
+    int token = WBXMLTags::getToken(document, page, name, nameLen);
+    if (token < 0) {
+        body += (char)(WBXML_LITERAL | content);
+        appendMbUInt(body, addString(name, nameLen));
+    } else {
+        body += (char)(token | content);
+    }
+
+    return empty ? true : encodeContent(page, name, nameLen);
+}
+
+bool WBXMLEncoder::encodeContent(int page, const char* name, size_t nameLen) {
+
+    for (;;) {
+        const char* text = pos;
+        bool blank = true;
+        while (*pos && *pos != '<') {
+            blank = blank && IS_SPACE(*pos);
+            pos++;
+        }
+        if (!*pos) {
+            LOG.error("%s: missing </%.*s>", __FUNCTION__, (int)nameLen, name);
+            return false;
+        }
+        if (!blank) {
+            appendText(text, pos - text);
+        }
+
+        if (pos[1] == '/') {
+            pos += 2;
+            if (strncmp(pos, name, nameLen) != 0 ||
+                (pos[nameLen] != '>' && !IS_SPACE(pos[nameLen]))) {
+                LOG.error("%s: mismatched end tag for <%.*s>", __FUNCTION__, (int)nameLen, name);
+                return false;
+            }
+            pos = strchr(pos + nameLen, '>');
+            if (!pos) {
+                LOG.error("%s: unterminated end tag", __FUNCTION__);
+                return false;
+            }
+            pos++;
+            body += (char)WBXML_END;
+            return true;
+        }
+        if (strncmp(pos, "<![CDATA[", 9) == 0) {
+            const char* data = pos + 9;
+            const char* end = strstr(data, "]]>");
+            if (!end) {
+                LOG.error("%s: unterminated CDATA section", __FUNCTION__);
+                return false;
+            }
+            appendOpaque(data, end - data);
+            pos = end + 3;
+        } else if (pos[1] == '!' || pos[1] == '?') {
+            if (!skipMarkup()) {
+                return false;
+            }
+        } else if (!encodeElement(page)) {
+            return false;
+        }
+    }
+}
+
+bool WBXMLEncoder::encodeEmbeddedDevInf(const char* start) {
+
+    std::string devinf;
+    WBXMLEncoder encoder(start, WBXML_DOC_DEVINF);
+    if (!encoder.encodeDocument(devinf)) {
+        return false;
+    }
+    pos = encoder.pos;
+    appendOpaque(devinf.data(), devinf.size());
+    return true;
+}
+
+bool WBXMLEncoder::skipMarkup() {
+
+    for (;;) {
+        while (IS_SPACE(*pos)) {
+            pos++;
+        }
+        const char* end = NULL;
+        if (strncmp(pos, "<?", 2) == 0) {
+            end = strstr(pos, "?>");
+        } else if (strncmp(pos, "<!--", 4) == 0) {
+            end = strstr(pos, "-->");
+        } else if (strncmp(pos, "<!", 2) == 0) {
+            end = strchr(pos, '>');
+        } else {
+            return true;
+        }
+        if (!end) {
+            LOG.error("%s: unterminated markup", __FUNCTION__);
+            return false;
+        }
+        pos = strchr(end, '>') + 1;
+    }
+}
+
+void WBXMLEncoder::switchPage(int page) {
+    if (page != codePage) {
+        body += (char)WBXML_SWITCH_PAGE;
+        body += (char)page;
+        codePage = page;
+    }
+}
+
+void WBXMLEncoder::appendText(const char* text, size_t len) {
+
+    // the strings carry the characters: resolve the references
+    std::string value;
+    const char* end = text + len;
+    while (text < end) {
+        const char* amp = (const char*)memchr(text, '&', end - text);
+        const char* semi = amp ? (const char*)memchr(amp, ';', end - amp) : NULL;
+        if (!semi) {
+            value.append(text, end - text);
+            break;
+        }
+        value.append(text, amp - text);
+
+        const char* ref = amp + 1;
+        size_t refLen = semi - ref;
+        if      (equals(ref, refLen, "amp"))  { value += '&';  }
+        else if (equals(ref, refLen, "lt"))   { value += '<';  }
+        else if (equals(ref, refLen, "gt"))   { value += '>';  }
+        else if (equals(ref, refLen, "quot")) { value += '"';  }
+        else if (equals(ref, refLen, "apos")) { value += '\''; }
+        else if (refLen > 1 && ref[0] == '#') {
+            unsigned long c = (ref[1] == 'x' || ref[1] == 'X') ? strtoul(ref + 2, NULL, 16)
+                                                               : strtoul(ref + 1, NULL, 10);
+            if (c) {
+                appendUTF8(value, c);
+            }
+        } else {
+            // unknown entity: kept as it is
+            value.append(amp, semi + 1 - amp);
+        }
+        text = semi + 1;
+    }
+
+    // The URIs and the other longer strings are repeated all over a
+    // message: they go to the string table and are referenced from there.
+    if (value.size() >= MIN_TABLE_STRING) {
+        body += (char)WBXML_STR_T;
+        appendMbUInt(body, addString(value.c_str(), value.size()));
+    } else {
+        body += (char)WBXML_STR_I;
+        body += value;
+        body += '\0';
+    }
+}
+
+void WBXMLEncoder::appendOpaque(const char* data, size_t len) {
+    body += (char)WBXML_OPAQUE;
+    appendMbUInt(body, (unsigned int)len);
+    body.append(data, len);
+}
+
+unsigned int WBXMLEncoder::addString(const char* s, size_t len) {
+
+    std::string value = (len == (size_t)-1) ? std::string(s) : std::string(s, len);
+    std::map<std::string, unsigned int>::const_iterator it = strings.find(value);
+    if (it != strings.end()) {
+        return it->second;
+    }
+
+    unsigned int offset = (unsigned int)strtbl.size();
+    strtbl += value;
+    strtbl += '\0';
+    strings[value] = offset;
+    return offset;
+}
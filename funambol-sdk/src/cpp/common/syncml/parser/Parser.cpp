@@ -50,10 +50,9 @@ SyncML* Parser::getSyncML(const char*xml) {
     XMLProcessor::copyElementContent(t, xml, SYNC_BODY, &pos);
     syncBody = getSyncBody(t.c_str());
 
-    syncML = new SyncML(syncHdr, syncBody);
-
-    deleteSyncHdr (&syncHdr);
-    deleteSyncBody(&syncBody);
+    syncML = new SyncML();
+    syncML->adoptSyncHdr(syncHdr);
+    syncML->adoptSyncBody(syncBody);
 
     return syncML;
 
@@ -401,7 +400,9 @@ SyncBody* Parser::getSyncBody(const char*xml) {
     ArrayList commands;
     getCommands(commands, xml);
     finalMsg = getFinalMsg(xml);
-    syncBody = new SyncBody(&commands, finalMsg);
+    syncBody = new SyncBody();
+    syncBody->adoptCommands(&commands);
+    syncBody->setFinalMsg(finalMsg);
     return syncBody;
 }
 
@@ -445,8 +446,8 @@ Sequence* Parser::getSequence(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
     while ((alert = getAlert(t.c_str())) != NULL) {
-        commands.add(*alert); // in the ArrayList NULL element cannot be inserted
-        deleteAlert(&alert);
+        commands.adopt(alert); // in the ArrayList NULL element cannot be inserted
+        alert = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
@@ -456,8 +457,8 @@ Sequence* Parser::getSequence(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
     while ((map = getMap(t.c_str())) != NULL) {
-        commands.add(*map); // in the ArrayList NULL element cannot be inserted
-        deleteMap(&map);
+        commands.adopt(map); // in the ArrayList NULL element cannot be inserted
+        map = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
@@ -467,8 +468,8 @@ Sequence* Parser::getSequence(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], GET, &pos);
     while ((get = getGet(t.c_str())) != NULL) {
-        commands.add(*get); // in the ArrayList NULL element cannot be inserted
-        deleteGet(&get);
+        commands.adopt(get); // in the ArrayList NULL element cannot be inserted
+        get = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], GET, &pos);
@@ -478,8 +479,8 @@ Sequence* Parser::getSequence(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
     while ((exec = getExec(t.c_str())) != NULL) {
-        commands.add(*exec); // in the ArrayList NULL element cannot be inserted
-        deleteExec(&exec);
+        commands.adopt(exec); // in the ArrayList NULL element cannot be inserted
+        exec = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
@@ -491,8 +492,8 @@ Sequence* Parser::getSequence(const char*xml) {
     if (!element.empty()) {
         sync = getSync(element.c_str());
         if (sync) {
-            commands.add(*sync);
-            deleteSync(&sync);
+            commands.adopt(sync);
+            sync = NULL;
         }
     }
 
@@ -501,8 +502,8 @@ Sequence* Parser::getSequence(const char*xml) {
     if (!element.empty()) {
         atomic = getAtomic(element.c_str());
         if (atomic) {
-            commands.add(*atomic);
-            deleteAtomic(&atomic);
+            commands.adopt(atomic);
+            atomic = NULL;
         }
     }
 
@@ -559,8 +560,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
     while ((alert = getAlert(t.c_str())) != NULL) {
-        commands.add(*alert); // in the ArrayList NULL element cannot be inserted
-        deleteAlert(&alert);
+        commands.adopt(alert); // in the ArrayList NULL element cannot be inserted
+        alert = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
@@ -570,8 +571,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
     while ((map = getMap(t.c_str())) != NULL) {
-        commands.add(*map); // in the ArrayList NULL element cannot be inserted
-        deleteMap(&map);
+        commands.adopt(map); // in the ArrayList NULL element cannot be inserted
+        map = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
@@ -581,8 +582,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], GET, &pos);
     while ((get = getGet(t.c_str())) != NULL) {
-        commands.add(*get); // in the ArrayList NULL element cannot be inserted
-        deleteGet(&get);
+        commands.adopt(get); // in the ArrayList NULL element cannot be inserted
+        get = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], GET, &pos);
@@ -592,8 +593,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
     while ((exec = getExec(t.c_str())) != NULL) {
-        commands.add(*exec); // in the ArrayList NULL element cannot be inserted
-        deleteExec(&exec);
+        commands.adopt(exec); // in the ArrayList NULL element cannot be inserted
+        exec = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
@@ -605,8 +606,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     if (!element.empty()) {
         sync = getSync(element.c_str());
         if (sync) {
-            commands.add(*sync);
-            deleteSync(&sync);
+            commands.adopt(sync);
+            sync = NULL;
         }
     }
 
@@ -615,8 +616,8 @@ Atomic* Parser::getAtomic(const char*xml) {
     if (!element.empty()) {
         sequence = getSequence(element.c_str());
         if (sequence) {
-            commands.add(*sequence);
-            deleteSequence(&sequence);
+            commands.adopt(sequence);
+            sequence = NULL;
         }
     }
 
@@ -684,8 +685,8 @@ Sync* Parser::getSync(const char*xml) {
     if (element) {
         sequence = getSequence(element);
         if (sequence) {
-            commands.add(*sequence);
-            deleteSequence(&sequence);
+            commands.adopt(sequence);
+            sequence = NULL;
         }
         safeDel(&element);
     }
@@ -695,8 +696,8 @@ Sync* Parser::getSync(const char*xml) {
     if (element) {
         atomic = getAtomic(element);
         if (atomic) {
-            commands.add(*atomic);
-            deleteAtomic(&atomic);
+            commands.adopt(atomic);
+            atomic = NULL;
         }
         safeDel(&element);
     }
@@ -935,8 +936,8 @@ void Parser::getMapItems(ArrayList& list, const char*xml) {
     StringBuffer t;
     XMLProcessor::copyElementContent(t, &xml[pos], MAP_ITEM, &pos);
     while ((mapItem = getMapItem(t.c_str())) != NULL) {
-        list.add(*mapItem); // in the ArrayList NULL element cannot be inserted
-        deleteMapItem(&mapItem);
+        list.adopt(mapItem); // in the ArrayList NULL element cannot be inserted
+        mapItem = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], MAP_ITEM, &pos);
@@ -996,8 +997,8 @@ void Parser::getAndAppendCopies(ArrayList& list, const char*xml, const char*exce
     */
     char* t = XMLProcessor::copyElementContentExcept(&xml[pos], COPY, except, &pos);
     while ((copy = getCopy(t)) != NULL) {
-        list.add(*copy); // in the ArrayList NULL element cannot be inserted
-        deleteCopy(&copy);
+        list.adopt(copy); // in the ArrayList NULL element cannot be inserted
+        copy = NULL;
         pos += previous;
         previous = pos;
         delete [] t;
@@ -1018,8 +1019,8 @@ void Parser::getAndAppendAdds(ArrayList& list, const char*xml, const char*except
     */
     char* t = XMLProcessor::copyElementContentExcept(&xml[pos], ADD, except, &pos);
     while ((add = getAdd(t)) != NULL) {
-        list.add(*add); // in the ArrayList NULL element cannot be inserted
-        deleteAdd(&add);
+        list.adopt(add); // in the ArrayList NULL element cannot be inserted
+        add = NULL;
         pos += previous;
         previous = pos;
         delete [] t;
@@ -1038,8 +1039,8 @@ void Parser::getAndAppendReplaces(ArrayList& list, const char*xml, const char*ex
 
     char* t = XMLProcessor::copyElementContentExcept(&xml[pos], REPLACE, except, &pos);
     while ((replace = getReplace(t)) != NULL) {
-        list.add(*replace); // in the ArrayList NULL element cannot be inserted
-        deleteReplace(&replace);
+        list.adopt(replace); // in the ArrayList NULL element cannot be inserted
+        replace = NULL;
         pos += previous;
         previous = pos;
         delete [] t;
@@ -1058,8 +1059,8 @@ void Parser::getAndAppendDels(ArrayList& list, const char*xml, const char*except
 
     char* t = XMLProcessor::copyElementContentExcept(&xml[pos], DEL, except, &pos);
     while ((del = getDelete(t)) != NULL) {
-        list.add(*del); // in the ArrayList NULL element cannot be inserted
-        deleteDelete(&del);
+        list.adopt(del); // in the ArrayList NULL element cannot be inserted
+        del = NULL;
         pos += previous;
         previous = pos;
         delete [] t;
@@ -1106,8 +1107,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     StringBuffer t;
     XMLProcessor::copyElementContent(t, &xml[pos], STATUS, &pos);
     while ((status = getStatus(t.c_str())) != NULL) {
-        ret.add(*status); // in the ArrayList NULL element cannot be inserted
-        deleteStatus(&status);
+        ret.adopt(status); // in the ArrayList NULL element cannot be inserted
+        status = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], STATUS, &pos);
@@ -1117,8 +1118,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
     while ((alert = getAlert(t.c_str())) != NULL) {
-        ret.add(*alert); // in the ArrayList NULL element cannot be inserted
-        deleteAlert(&alert);
+        ret.adopt(alert); // in the ArrayList NULL element cannot be inserted
+        alert = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], ALERT, &pos);
@@ -1128,8 +1129,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
     while ((map = getMap(t.c_str())) != NULL) {
-        ret.add(*map); // in the ArrayList NULL element cannot be inserted
-        deleteMap(&map);
+        ret.adopt(map); // in the ArrayList NULL element cannot be inserted
+        map = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], MAP, &pos);
@@ -1143,8 +1144,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     char *t0 = NULL;
     t0 = XMLProcessor::copyElementContentExcept(xml, GET, "Atomic&Sequence", &pos);
     while (t0 && (get = getGet(t0)) != NULL) {
-        ret.add(*get); // in the ArrayList NULL element cannot be inserted
-        deleteGet(&get);
+        ret.adopt(get); // in the ArrayList NULL element cannot be inserted
+        get = NULL;
         pos += previous;
         previous = pos;
         delete [] t0;
@@ -1157,8 +1158,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContent(t, &xml[pos], PUT, &pos);
     while ((put = getPut(t.c_str())) != NULL) {
-        ret.add(*put); // in the ArrayList NULL element cannot be inserted
-        deletePut(&put);
+        ret.adopt(put); // in the ArrayList NULL element cannot be inserted
+        put = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], PUT, &pos);
@@ -1168,8 +1169,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContent(t, &xml[pos], RESULTS, &pos);
     while ((result = getResult(t.c_str())) != NULL) {
-        ret.add(*result); // in the ArrayList NULL element cannot be inserted
-        deleteResults(&result);
+        ret.adopt(result); // in the ArrayList NULL element cannot be inserted
+        result = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], RESULTS, &pos);
@@ -1179,8 +1180,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
     while ((exec = getExec(t.c_str())) != NULL) {
-        ret.add(*exec); // in the ArrayList NULL element cannot be inserted
-        deleteExec(&exec);
+        ret.adopt(exec); // in the ArrayList NULL element cannot be inserted
+        exec = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContentLevel(t, &xml[pos], EXEC, &pos);
@@ -1190,8 +1191,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     XMLProcessor::copyElementContent(t, &xml[pos], SEARCH, &pos);
     while ((search = getSearch(t.c_str())) != NULL) {
-        ret.add(*search); // in the ArrayList NULL element cannot be inserted
-        deleteSearch(&search);
+        ret.adopt(search); // in the ArrayList NULL element cannot be inserted
+        search = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], SEARCH, &pos);
@@ -1209,8 +1210,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     pos = 0, previous = 0;
     char* t1 = XMLProcessor::copyElementContentExcept(&xml[pos], SYNC, "Atomic&Sequence", &pos);
     while ((sync = getSync(t1)) != NULL) {
-        ret.add(*sync); // in the ArrayList NULL element cannot be inserted
-        deleteSync(&sync);
+        ret.adopt(sync); // in the ArrayList NULL element cannot be inserted
+        sync = NULL;
         pos += previous;
         previous = pos;
         delete [] t1;
@@ -1224,8 +1225,8 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     delete [] t1;
 
     if (sequence) {
-        ret.add(*sequence);
-        deleteSequence(&sequence);
+        ret.adopt(sequence);
+        sequence = NULL;
     }
 
     // get the Sequence commands. Not belonging to Sequence and Sync and Atomic
@@ -1234,17 +1235,15 @@ void Parser::getCommands(ArrayList& ret, const char*xml) {
     delete [] t1;
 
     if (atomic) {
-        ret.add(*atomic);
-        deleteAtomic(&atomic);
+        ret.adopt(atomic);
+        atomic = NULL;
     }
 
 
     ArrayList commonCommandList;
     getCommonCommandList(commonCommandList, xml, "Atomic&Sync&Sequence");
 
-    for (int i = 0; i < commonCommandList.size(); i++) {
-        ret.add(*commonCommandList.get(i));
-    }
+    ret.adopt(&commonCommandList);
 }
 
 Status* Parser::getStatus(const char*xml) {
@@ -1320,8 +1319,8 @@ void Parser::getTargetRefs(ArrayList& list, const char*xml) {
     StringBuffer t;
     XMLProcessor::copyElementContent(t, &xml[pos], TARGET_REF, &pos);
     while ((targetRef = getTargetRef(t.c_str())) != NULL) {
-        list.add(*targetRef); // in the ArrayList NULL element cannot be inserted
-        deleteTargetRef(&targetRef);
+        list.adopt(targetRef); // in the ArrayList NULL element cannot be inserted
+        targetRef = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], TARGET_REF, &pos);
@@ -1335,8 +1334,8 @@ void Parser::getSourceRefs(ArrayList& list, const char*xml) {
     StringBuffer t;
     XMLProcessor::copyElementContent(t, &xml[pos], SOURCE_REF, &pos);
     while ((sourceRef = getSourceRef(t.c_str())) != NULL) {
-        list.add(*sourceRef); // in the ArrayList NULL element cannot be inserted
-        deleteSourceRef(&sourceRef);
+        list.adopt(sourceRef); // in the ArrayList NULL element cannot be inserted
+        sourceRef = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], SOURCE_REF, &pos);
@@ -1580,8 +1579,8 @@ void Parser::getItems(ArrayList& items, const char*xml, const char* command) {
     StringBuffer t;
     XMLProcessor::copyElementContent(t, &xml[pos], ITEM, &pos);
     while ((item = getItem(t.c_str(), command)) != NULL) {
-        items.add(*item);    // in the ArrayList NULL element cannot be inserted
-        deleteItem(&item);
+        items.adopt(item);    // in the ArrayList NULL element cannot be inserted
+        item = NULL;
         pos += previous;
         previous = pos;
         XMLProcessor::copyElementContent(t, &xml[pos], ITEM, &pos);
@@ -1747,8 +1746,8 @@ DevInf* Parser::getDevInf(const char*xml) {
     XMLProcessor::copyElementContent(t, &xml[pos], DATA_STORE, &pos);
     while ((dataStore = getDataStore(t.c_str())) != NULL) {
         if (dataStore) {
-            dataStores.add(*dataStore); // in the ArrayList NULL element cannot be inserted
-            deleteDataStore(&dataStore);
+            dataStores.adopt(dataStore); // in the ArrayList NULL element cannot be inserted
+            dataStore = NULL;
         }
         pos += previous;
         previous = pos;
@@ -1760,8 +1759,8 @@ DevInf* Parser::getDevInf(const char*xml) {
     XMLProcessor::copyElementContent(t, &xml[pos], CT_CAP, &pos);
     while ((ctCap = getCTCap(t.c_str())) != NULL) {
         if (ctCap) {
-            ctCaps.add(*ctCap); // in the ArrayList NULL element cannot be inserted
-            deleteCTCap(&ctCap);
+            ctCaps.adopt(ctCap); // in the ArrayList NULL element cannot be inserted
+            ctCap = NULL;
         }
         pos += previous;
         previous = pos;
@@ -1773,8 +1772,8 @@ DevInf* Parser::getDevInf(const char*xml) {
     XMLProcessor::copyElementContent(t, &xml[pos], EXT, &pos);
     while ((ext = getExt(t.c_str())) != NULL) {
         if (ext) {
-            exts.add(*ext); // in the ArrayList NULL element cannot be inserted
-            deleteExt(&ext);
+            exts.adopt(ext); // in the ArrayList NULL element cannot be inserted
+            ext = NULL;
         }
         pos += previous;
         previous = pos;
@@ -1849,8 +1848,8 @@ Ext* Parser::getExt(const char*xml) {
     while ((value = XMLProcessor::copyElementContent(&xml[pos], XVAL, &pos)) != NULL) {
         if (value) {
             s = new StringElement(value);
-            list.add(*s);
-            deleteStringElement(&s);
+            list.adopt(s);
+            s = NULL;
             safeDel(&value);
         }
         pos += previous;
@@ -1898,8 +1897,8 @@ DataStore* Parser::getDataStore(const char*xml) {
     XMLProcessor::copyElementContent(t, &xml[pos], RX, &pos);
     while ((x = getContentTypeInfo(t.c_str())) != NULL) {
         if (x) {
-            rx.add(*x); // in the ArrayList NULL element cannot be inserted
-            deleteContentTypeInfo(&x);
+            rx.adopt(x); // in the ArrayList NULL element cannot be inserted
+            x = NULL;
         }
         pos += previous;
         previous = pos;
@@ -1911,8 +1910,8 @@ DataStore* Parser::getDataStore(const char*xml) {
     XMLProcessor::copyElementContent(t, &xml[pos], TX, &pos);
     while ((x = getContentTypeInfo(t.c_str())) != NULL) {
         if (x) {
-            tx.add(*x); // in the ArrayList NULL element cannot be inserted
-            deleteContentTypeInfo(&x);
+            tx.adopt(x); // in the ArrayList NULL element cannot be inserted
+            x = NULL;
         }
         pos += previous;
         previous = pos;
@@ -1957,8 +1956,8 @@ SyncCap* Parser::getSyncCap(const char* allxml) {
     XMLProcessor::copyElementContent(t, &xml[pos], SYNC_TYPE, &pos);
     while ((syncType = getSyncType(t.c_str())) != NULL) {
         if (syncType) {
-            list.add(*syncType); // in the ArrayList NULL element cannot be inserted
-            deleteSyncType(&syncType);
+            list.adopt(syncType); // in the ArrayList NULL element cannot be inserted
+            syncType = NULL;
         }
         pos += previous;
         previous = pos;
@@ -0,0 +1,338 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#include "syncml/parser/WBXMLDecoder.h"
+#include "syncml/core/Constants.h"
+#include "base/Log.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/**
+ * Appends the characters, escaping the ones reserved in XML.
+ */
+static void appendEscaped(std::string& out, const char* s, unsigned int len) {
+
+    const char* end = s + len;
+    const char* run = s;
+    for (; s < end; s++) {
+        const char* entity = NULL;
+        switch (*s) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;";  break;
+            case '>': entity = "&gt;";  break;
+            default:  continue;
+        }
+        out.append(run, s - run);
+        out.append(entity);
+        run = s + 1;
+    }
+    out.append(run, end - run);
+}
+
+static bool containsCDataEnd(const char* data, unsigned int len) {
+    for (unsigned int i = 0; i + 2 < len; i++) {
+        if (data[i] == ']' && data[i + 1] == ']' && data[i + 2] == '>') {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool WBXMLDecoder::isWBXML(const char* data, unsigned int size) {
+    // the WBXML version is 1.0 - 1.3, XML can't start with these bytes
+    return data && size >= 4 && (unsigned char)data[0] <= 0x03;
+}
+
+char* WBXMLDecoder::decode(const char* data, unsigned int size) {
+
+    if (!isWBXML(data, size)) {
+        LOG.error("%s: not a WBXML document", __FUNCTION__);
+        return NULL;
+    }
+
+    WBXMLDecoder decoder(data, size);
+    if (!decoder.readHeader()) {
+        LOG.error("%s: invalid WBXML header", __FUNCTION__);
+        return NULL;
+    }
+
+    std::string out;
+    out.reserve(size * 3);
+    out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    if (!decoder.decodeBody(out)) {
+        return NULL;
+    }
+
+    char* ret = new char[out.size() + 1];
+    memcpy(ret, out.c_str(), out.size() + 1);
+    return ret;
+}
+
+WBXMLDecoder::WBXMLDecoder(const char* d, unsigned int s)
+    : data((const unsigned char*)d), size(s), pos(0), document(WBXML_DOC_SYNCML),
+      codePage(0), strtbl(NULL), strtblSize(0) {
+}
+
+bool WBXMLDecoder::readHeader() {
+
+    unsigned char version = 0;
+    unsigned int publicId = 0, publicIndex = 0, charset = 0, len = 0;
+
+    if (!readByte(&version) || version > 0x03 || !readMbUInt(&publicId)) {
+        return false;
+    }
+    if (publicId == 0 && !readMbUInt(&publicIndex)) {
+        return false;
+    }
+    // WBXML 1.0 has no charset
+    if (version > 0x00 && !readMbUInt(&charset)) {
+        return false;
+    }
+    if (charset != 0 && charset != WBXML_CHARSET_UTF8) {
+        LOG.error("%s: unsupported charset %u", __FUNCTION__, charset);
+        return false;
+    }
+    if (!readMbUInt(&len) || len > size - pos) {
+        return false;
+    }
+    strtbl = (const char*)data + pos;
+    strtblSize = len;
+    pos += len;
+
+    if (publicId == 0) {
+        return WBXMLTags::getDocType(getString(publicIndex), &document);
+    }
+    return WBXMLTags::getDocType(publicId, &document);
+}
+
+bool WBXMLDecoder::decodeBody(std::string& out) {
+
+    unsigned char b;
+    while (readByte(&b)) {
+        if (b == WBXML_SWITCH_PAGE) {
+            if (!readByte(&b)) {
+                break;
+            }
+            codePage = b;
+        } else if ((b & WBXML_TAG_MASK) < WBXML_LITERAL) {
+            LOG.error("%s: unsupported token 0x%02x", __FUNCTION__, b);
+            return false;
+        } else {
+            return decodeElement(out, b, -1);
+        }
+    }
+    LOG.error("%s: no root element", __FUNCTION__);
+    return false;
+}
+
+bool WBXMLDecoder::decodeElement(std::string& out, unsigned char tag, int parentPage) {
+
+    int page = codePage;
+    const char* name = NULL;
+    if ((tag & WBXML_TAG_MASK) == WBXML_LITERAL) {
+        unsigned int index = 0;
+        if (readMbUInt(&index)) {
+            name = getString(index);
+        }
+    } else {
+        name = WBXMLTags::getTagName(document, page, tag & WBXML_TAG_MASK);
+    }
+    if (!name) {
+        LOG.error("%s: unknown tag 0x%02x in code page %d", __FUNCTION__, tag, page);
+        return false;
+    }
+    if (tag & WBXML_TAG_ATTRIBUTES) {
+        LOG.error("%s: attributes are not supported (<%s>)", __FUNCTION__, name);
+        return false;
+    }
+
+    out += '<';
+    out.append(name);
+    if (page != parentPage) {
+        if (document == WBXML_DOC_SYNCML && page == WBXML_PAGE_METINF) {
+            out.append(" xmlns=\"" NAMESPACE_METINF "\"");
+        } else if (document == WBXML_DOC_DEVINF && parentPage < 0) {
+            out.append(" xmlns=\"" NAMESPACE_DEVINF "\"");
+        }
+    }
+    if (!(tag & WBXML_TAG_CONTENT)) {
+        out.append("/>");
+        return true;
+    }
+    out += '>';
+
+    for (;;) {
+        unsigned char b = 0;
+        unsigned int value = 0;
+        const char* s = NULL;
+        if (!readByte(&b)) {
+            LOG.error("%s: missing end of <%s>", __FUNCTION__, name);
+            return false;
+        }
+        switch (b) {
+            case WBXML_END:
+                out.append("</");
+                out.append(name);
+                out += '>';
+                return true;
+
+            case WBXML_SWITCH_PAGE:
+                if (!readByte(&b)) {
+                    LOG.error("%s: truncated page switch", __FUNCTION__);
+                    return false;
+                }
+                codePage = b;
+                break;
+
+            case WBXML_STR_I:
+                if (!readInlineString(&s, &value)) {
+                    LOG.error("%s: unterminated string in <%s>", __FUNCTION__, name);
+                    return false;
+                }
+                appendEscaped(out, s, value);
+                break;
+
+            case WBXML_STR_T:
+                if (!readMbUInt(&value) || !(s = getString(value))) {
+                    LOG.error("%s: invalid string reference in <%s>", __FUNCTION__, name);
+                    return false;
+                }
+                appendEscaped(out, s, (unsigned int)strlen(s));
+                break;
+
+            case WBXML_ENTITY: {
+                char ref[16];
+                if (!readMbUInt(&value)) {
+                    LOG.error("%s: truncated entity in <%s>", __FUNCTION__, name);
+                    return false;
+                }
+                sprintf(ref, "&#%u;", value);
+                out.append(ref);
+                break;
+            }
+
+            case WBXML_OPAQUE:
+                if (!readMbUInt(&value) || value > size - pos) {
+                    LOG.error("%s: truncated opaque data in <%s>", __FUNCTION__, name);
+                    return false;
+                }
+                s = (const char*)data + pos;
+                pos += value;
+                if (!decodeOpaque(out, s, value)) {
+                    return false;
+                }
+                break;
+
+            default:
+                if ((b & WBXML_TAG_MASK) < WBXML_LITERAL) {
+                    LOG.error("%s: unsupported token 0x%02x in <%s>", __FUNCTION__, b, name);
+                    return false;
+                }
+                if (!decodeElement(out, b, page)) {
+                    return false;
+                }
+                break;
+        }
+    }
+}
+
+bool WBXMLDecoder::decodeOpaque(std::string& out, const char* opaque, unsigned int len) {
+
+    // an embedded DevInf document is decoded in place
+    if (document == WBXML_DOC_SYNCML && isWBXML(opaque, len)) {
+        WBXMLDecoder devinf(opaque, len);
+        if (devinf.readHeader() && devinf.document == WBXML_DOC_DEVINF) {
+            return devinf.decodeBody(out);
+        }
+    }
+
+    // a CDATA section, as the Formatter does, unless the data would end it
+    if (containsCDataEnd(opaque, len)) {
+        appendEscaped(out, opaque, len);
+    } else {
+        out.append("<![CDATA[");
+        out.append(opaque, len);
+        out.append("]]>");
+    }
+    return true;
+}
+
+bool WBXMLDecoder::readByte(unsigned char* b) {
+    if (pos >= size) {
+        return false;
+    }
+    *b = data[pos++];
+    return true;
+}
+
+bool WBXMLDecoder::readMbUInt(unsigned int* value) {
+
+    unsigned int result = 0;
+    for (int i = 0; i < 5; i++) {
+        unsigned char b;
+        if (!readByte(&b)) {
+            return false;
+        }
+        result = (result << 7) | (b & 0x7F);
+        if (!(b & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WBXMLDecoder::readInlineString(const char** s, unsigned int* len) {
+
+    const char* start = (const char*)data + pos;
+    const char* end = (const char*)memchr(start, 0, size - pos);
+    if (!end) {
+        return false;
+    }
+    *s = start;
+    *len = (unsigned int)(end - start);
+    pos += *len + 1;
+    return true;
+}
+
+const char* WBXMLDecoder::getString(unsigned int index) {
+    if (index >= strtblSize || !memchr(strtbl + index, 0, strtblSize - index)) {
+        return NULL;
+    }
+    return strtbl + index;
+}
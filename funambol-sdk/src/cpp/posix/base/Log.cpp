@@ -33,13 +33,15 @@
  * the words "Powered by Funambol".
  */
 
-
 #include "base/globalsdef.h"
 #include "base/posixlog.h"
 #include "base/fscapi.h"
 #include "base/util/utils.h"
 
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
 
 //Change made for US11215 on Mac
 #ifdef FUN_MAC
@@ -48,6 +50,78 @@
 
 USE_NAMESPACE
 
+/**
+ * A message queued by a thread: the prefix and the text (NULL terminated)
+ * follow the header, or are in heapText for long messages.
+ * A record with size 0 marks the end of the ring: the next record is at
+ * the beginning of the buffer.
+ */
+struct LogRecord {
+    uint32_t    size;
+    uint32_t    prefixLength;
+    uint64_t    seq;
+    time_t      time;
+    LogLevel    level;
+    const char* levelPrefix;
+    char*       heapText;
+};
+
+#define LOG_RECORD_ALIGN(x)  (((x) + 7) & ~7)
+
+/**
+ * The messages queued by a single thread. Single producer (the thread)
+ * and single consumer (the writer), no locks: 'tail' is only written by
+ * the producer, 'head' only by the consumer.
+ */
+struct POSIXLog::LogRing {
+    char*             data;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool     orphaned;
+    LogRing*          next;
+
+    LogRing() : head(0), tail(0), orphaned(false), next(NULL) {
+        data = new char[LOG_RING_SIZE];
+    }
+    ~LogRing() {
+        // Release the long messages never written
+        while (LogRecord* r = peek()) {
+            delete [] r->heapText;
+            head += r->size;
+        }
+        delete [] data;
+    }
+
+    /// The first record not yet written, NULL if none (consumer side)
+    LogRecord* peek() {
+        uint32_t last = tail;
+        __sync_synchronize();
+        while (head != last) {
+            uint32_t index = head & (LOG_RING_SIZE - 1);
+            LogRecord* r = (LogRecord*)&data[index];
+            if (r->size == 0) {
+                head += LOG_RING_SIZE - index;
+                continue;
+            }
+            return r;
+        }
+        return NULL;
+    }
+};
+
+/** the log owning the running writer, flushed on exit and crash */
+static POSIXLog* activeLog = NULL;
+
+static bool flushOnExit = true;
+static bool exitHandlerRegistered = false;
+static bool flushOnCrash = true;
+
+#define CRASH_SIGNALS_COUNT 5
+static const int crashSignals[CRASH_SIGNALS_COUNT] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+static struct sigaction previousActions[CRASH_SIGNALS_COUNT];
+static bool crashHandlerInstalled[CRASH_SIGNALS_COUNT];
+
+
 POSIXLog::POSIXLog() :
     logFile(NULL),
     logFileStdout(false),
@@ -55,10 +129,38 @@ POSIXLog::POSIXLog() :
     logPath(NULL),
     logRedirectStderr(false),
     fderr(-1),
-    prefix("")
+    prefix(""),
+    linePrefix(""),
+    cachedTime(-1),
+    crashFd(-1),
+    rotateMaxSize(0),
+    rotateMaxCount(0),
+    rotateCompress(false),
+    compressing(false),
+    compressDone(false),
+    async(true),
+    writerStarted(false),
+    writerStop(false),
+    flushRequests(0),
+    writerRound(0),
+    draining(false),
+    sequence(0),
+    rings(NULL)
 {
-    // Init the log mutex
-//    pthread_mutex_init(&logMutex, NULL);
+    // Init the log mutex: the file is reopened while logging
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&logMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_mutex_init(&writerMutex, NULL);
+    pthread_cond_init(&writerCond, NULL);
+    pthread_cond_init(&flushedCond, NULL);
+    pthread_cond_init(&compressCond, NULL);
+    pthread_key_create(&ringKey, threadExited);
+
+    fullTime[0] = shortTime[0] = utcTime[0] = 0;
 }
 
 void POSIXLog::setLogPath(const char*  configLogPath) {
@@ -77,7 +179,18 @@ void POSIXLog::setLogName(const char*  configLogName) {
 
 void POSIXLog::setLogFile(const char *path, const char* name, bool redirectStderr) {
     
-//    pthread_mutex_lock(&logMutex);
+    // Messages already logged go to the old file
+    flush();
+
+    pthread_mutex_lock(&logMutex);
+    openLogFile(path, name, redirectStderr);
+    pthread_mutex_unlock(&logMutex);
+}
+
+/**
+ * Opens the log file, called with logMutex locked.
+ */
+void POSIXLog::openLogFile(const char *path, const char* name, bool redirectStderr) {
     
     if (logPath != path) {
         setLogPath(path);
@@ -88,6 +201,7 @@ void POSIXLog::setLogFile(const char *path, const char* name, bool redirectStder
     logRedirectStderr = redirectStderr;
 
     if (logFile != NULL) {
+        crashFd = -1;
         fclose(logFile);
         logFile = NULL;
     }
@@ -96,16 +210,15 @@ void POSIXLog::setLogFile(const char *path, const char* name, bool redirectStder
     if (!strcmp(name, "-")) {
         // write to stdout
         logFileStdout = true;
+        logFileName = "";
     } else if (path) {
-        char *filename = new char[strlen(path) + strlen(name) + 3];
-
-        sprintf(filename, "%s/%s", path, name);
-        logFile = fopen(filename, "a+" );
-        delete [] filename;
+        logFileName.sprintf("%s/%s", path, name);
+        logFile = fopen(logFileName.c_str(), "a+" );
     } else {
+        logFileName = name;
         logFile = fopen(name, "a+" );
     }
-//    pthread_mutex_unlock(&logMutex);
+    updateCrashFd();
 
     if (logFile) {
         char buffer[256];
@@ -149,9 +262,27 @@ void POSIXLog::setLogFile(const char *path, const char* name, bool redirectStder
 }
 
 POSIXLog::~POSIXLog() {
+    stopWriter();
+    waitCompression();
+    if (activeLog == this) {
+        activeLog = NULL;
+    }
+
+    pthread_key_delete(ringKey);
+    while (rings) {
+        LogRing* ring = rings;
+        rings = ring->next;
+        delete ring;
+    }
     if (logFile != NULL) {
+        crashFd = -1;
         fclose(logFile);
     }
+    pthread_cond_destroy(&compressCond);
+    pthread_cond_destroy(&flushedCond);
+    pthread_cond_destroy(&writerCond);
+    pthread_mutex_destroy(&writerMutex);
+    pthread_mutex_destroy(&logMutex);
 }
 
 void POSIXLog::error(const char*  msg, ...) {
@@ -229,10 +360,9 @@ void POSIXLog::printLine(bool firstLine,
                          const char *levelPrefix,
                          const char *line)
 {
-    // Altough stdio does not need explicit synchronization, we need it because the file gets rotated/reset
-    // and we must make sure this does not happen when another thread is writing
-//    pthread_mutex_lock(&logMutex);
-    
+    // Called with logMutex locked: the file gets rotated/reset and we must
+    // make sure this does not happen when another thread is writing.
+    // The file is flushed once per message (or per batch of messages).
     FILE *out = getLogFile();
     if (!out) {
         out = stdout;
@@ -241,25 +371,24 @@ void POSIXLog::printLine(bool firstLine,
         fprintf(out, "%s [%s] %s%s\n",
                 logFile ? utcTime : shortTime,
                 levelPrefix,
-                getPrefix().c_str(),
+                linePrefix,
                 line);
     } else {
         fprintf(out, "[%s] %s%s\n",
                 levelPrefix,
-                getPrefix().c_str(),
+                linePrefix,
                 line);
     }
-    fflush(out);
-    
-//    pthread_mutex_unlock(&logMutex);
 }
 
-void POSIXLog::printMessage(LogLevel level, const char* levelPrefix, const char* msg, va_list argList) {
-    time_t t = time(NULL);
+void POSIXLog::updateTimestamps(time_t t) {
+
+    // Formatted once per second
+    if (t == cachedTime) {
+        return;
+    }
     struct tm sys_time;
     struct tm utc_time;
-    char fullTime[64], shortTime[32];
-    char utcTime[32];
 
     localtime_r(&t, &sys_time);
     gmtime_r(&t, &utc_time);
@@ -273,18 +402,21 @@ void POSIXLog::printMessage(LogLevel level, const char* levelPrefix, const char*
             utc_time.tm_hour,
             utc_time.tm_min,
             utc_time.tm_sec);
+    cachedTime = t;
+}
 
-    if (!logFileStdout && !logFile) {
-         setLogFile(logPath, logName, logRedirectStderr);
-    }
+/**
+ * Prints a message line by line. Called with logMutex locked, the text
+ * is modified temporarily.
+ */
+void POSIXLog::printText(time_t t, LogLevel level, const char* levelPrefix, const char* text) {
 
-    StringBuffer buffer;
-    buffer.vsprintf(msg, argList);
-    const char *start = buffer.c_str();
+    updateTimestamps(t);
+
+    const char *start = text;
     const char *eol = strchr(start, '\n');
     bool firstLine = true;
     while (eol) {
-        /* hack: StringBuffer does not really allow write access, but do it anyway */
         *(char *)eol = 0;
         printLine(firstLine,
                   t,
@@ -309,14 +441,619 @@ void POSIXLog::printMessage(LogLevel level, const char* levelPrefix, const char*
               start);
 }
 
+void POSIXLog::printMessage(LogLevel level, const char* levelPrefix, const char* msg, va_list argList) {
+
+    // The writer thread itself (and the fallbacks) write synchronously
+    if (async && !(writerStarted && pthread_equal(pthread_self(), writerThread))) {
+        if (queueMessage(level, levelPrefix, msg, argList)) {
+            return;
+        }
+    }
+
+    /* hack: StringBuffer does not really allow write access, but do it anyway */
+    StringBuffer buffer;
+    buffer.vsprintf(msg, argList);
+
+    pthread_mutex_lock(&logMutex);
+    // The messages still queued go first
+    if (rings) {
+        writePending();
+    }
+    if (!logFileStdout && !logFile) {
+         openLogFile(logPath, logName, logRedirectStderr);
+    }
+    linePrefix = prefix.c_str();
+    printText(time(NULL), level, levelPrefix, buffer.c_str());
+    fflush(logFile ? logFile : stdout);
+    checkRotation();
+    pthread_mutex_unlock(&logMutex);
+}
+
+
+POSIXLog::LogRing* POSIXLog::getThreadRing() {
+
+    LogRing* ring = (LogRing*)pthread_getspecific(ringKey);
+    if (!ring) {
+        ring = new LogRing();
+        pthread_setspecific(ringKey, ring);
+
+        pthread_mutex_lock(&writerMutex);
+        ring->next = rings;
+        __sync_synchronize();
+        rings = ring;
+        pthread_mutex_unlock(&writerMutex);
+    }
+    return ring;
+}
+
+/**
+ * Formats the message into the ring of the calling thread.
+ * @return false if the message must be written synchronously
+ */
+bool POSIXLog::queueMessage(LogLevel level, const char* levelPrefix, const char* msg, va_list argList) {
+
+    if (!writerStarted && !startWriter()) {
+        return false;
+    }
+    LogRing* ring = getThreadRing();
+
+    char text[LOG_INLINE_SIZE];
+    va_list argCopy;
+    va_copy(argCopy, argList);
+    int len = vsnprintf(text, sizeof(text), msg, argCopy);
+    va_end(argCopy);
+    if (len < 0) {
+        return false;
+    }
+
+    const char* pfx = prefix.c_str();
+    uint32_t prefixLength = strlen(pfx);
+    uint32_t textSize = prefixLength + 1 + len + 1;
+
+    // Long messages are kept out of the ring
+    char* heapText = NULL;
+    if (len >= LOG_INLINE_SIZE || textSize > LOG_RING_SIZE / 4) {
+        heapText = new char[textSize];
+        memcpy(heapText, pfx, prefixLength + 1);
+        va_copy(argCopy, argList);
+        vsnprintf(&heapText[prefixLength + 1], len + 1, msg, argCopy);
+        va_end(argCopy);
+    }
+    uint32_t need = LOG_RECORD_ALIGN(sizeof(LogRecord) + (heapText ? 0 : textSize));
+
+    uint32_t tail, index, total;
+    for (int retry = 0; ; retry++) {
+        tail = ring->tail;
+        uint32_t head = ring->head;
+        __sync_synchronize();
+
+        index = tail & (LOG_RING_SIZE - 1);
+        uint32_t toEnd = LOG_RING_SIZE - index;
+        total = (need <= toEnd) ? need : toEnd + need;
+        if (LOG_RING_SIZE - (tail - head) >= total) {
+            break;
+        }
+        // Full: wait for the writer, or write synchronously if it is stuck
+        // (e.g. this thread holds the log file while reopening it)
+        if (writerStop || retry == LOG_WRITER_PERIOD * 10) {
+            delete [] heapText;
+            return false;
+        }
+        pthread_mutex_lock(&writerMutex);
+        pthread_cond_signal(&writerCond);
+        pthread_mutex_unlock(&writerMutex);
+        usleep(1000);
+    }
+
+    if (total != need) {
+        // Not enough space up to the end of the ring: mark it and wrap
+        ((LogRecord*)&ring->data[index])->size = 0;
+        index = 0;
+    }
+    LogRecord* r = (LogRecord*)&ring->data[index];
+    r->size         = need;
+    r->prefixLength = prefixLength;
+    r->seq          = __sync_fetch_and_add(&sequence, 1);
+    r->time         = time(NULL);
+    r->level        = level;
+    r->levelPrefix  = levelPrefix;
+    r->heapText     = heapText;
+    if (!heapText) {
+        char* dest = (char*)(r + 1);
+        memcpy(dest, pfx, prefixLength + 1);
+        memcpy(&dest[prefixLength + 1], text, len + 1);
+    }
+    __sync_synchronize();
+    ring->tail = tail + total;
+
+    // Errors and rings filling up are written right now
+    if (level == LOG_LEVEL_NONE || (tail + total - ring->head) > LOG_RING_SIZE / 2) {
+        pthread_mutex_lock(&writerMutex);
+        pthread_cond_signal(&writerCond);
+        pthread_mutex_unlock(&writerMutex);
+    }
+    return true;
+}
+
+/**
+ * Writes all the queued messages, in the order they were logged.
+ * @return true if something was written
+ */
+bool POSIXLog::writePending() {
+
+    bool written = false;
+
+    pthread_mutex_lock(&logMutex);
+    if (draining) {
+        // Called back by a message logged while writing (e.g. opening the file)
+        pthread_mutex_unlock(&logMutex);
+        return false;
+    }
+    draining = true;
+    for (;;) {
+        // The oldest message among all the rings
+        LogRing* first = NULL;
+        LogRecord* record = NULL;
+        for (LogRing* ring = rings; ring; ring = ring->next) {
+            LogRecord* r = ring->peek();
+            if (r && (!record || r->seq < record->seq)) {
+                first  = ring;
+                record = r;
+            }
+        }
+        if (!record) {
+            break;
+        }
+
+        if (!logFileStdout && !logFile) {
+            openLogFile(logPath, logName, logRedirectStderr);
+        }
+        char* text = record->heapText ? record->heapText : (char*)(record + 1);
+        linePrefix = text;
+        printText(record->time, record->level, record->levelPrefix,
+                  &text[record->prefixLength + 1]);
+        delete [] record->heapText;
+
+        __sync_synchronize();
+        first->head += record->size;
+        written = true;
+    }
+    linePrefix = "";
+    draining = false;
+    if (written) {
+        fflush(logFile ? logFile : stdout);
+        checkRotation();
+    }
+    pthread_mutex_unlock(&logMutex);
+
+    return written;
+}
+
+void* POSIXLog::writerMain(void* arg) {
+
+    POSIXLog* log = (POSIXLog*)arg;
+    log->writerThread = pthread_self();
+
+    for (;;) {
+        pthread_mutex_lock(&log->writerMutex);
+        if (!log->writerStop && !log->flushRequests) {
+            struct timeval now;
+            struct timespec deadline;
+            gettimeofday(&now, NULL);
+            int64_t usec = (int64_t)now.tv_usec + LOG_WRITER_PERIOD * 1000;
+            deadline.tv_sec  = now.tv_sec + usec / 1000000;
+            deadline.tv_nsec = (usec % 1000000) * 1000;
+            pthread_cond_timedwait(&log->writerCond, &log->writerMutex, &deadline);
+        }
+        bool stop = log->writerStop;
+        pthread_mutex_unlock(&log->writerMutex);
+        if (stop) {
+            break;
+        }
+
+        log->writePending();
+
+        pthread_mutex_lock(&log->logMutex);
+        pthread_mutex_lock(&log->writerMutex);
+        log->releaseOrphanedRings();
+        log->writerRound++;
+        pthread_cond_broadcast(&log->flushedCond);
+        pthread_mutex_unlock(&log->writerMutex);
+        pthread_mutex_unlock(&log->logMutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Releases the rings of the threads that exited, once written.
+ * Called with both logMutex and writerMutex locked: writePending() can
+ * also run on other threads (flush).
+ */
+void POSIXLog::releaseOrphanedRings() {
+
+    LogRing** link = (LogRing**)&rings;
+    while (*link) {
+        LogRing* ring = *link;
+        if (ring->orphaned && ring->head == ring->tail) {
+            *link = ring->next;
+            delete ring;
+        } else {
+            link = &ring->next;
+        }
+    }
+}
+
+bool POSIXLog::startWriter() {
+
+    pthread_mutex_lock(&writerMutex);
+    if (!writerStarted && !writerStop) {
+        if (pthread_create(&writerThread, NULL, writerMain, this) == 0) {
+            writerStarted = true;
+            activeLog = this;
+            if (flushOnExit && !exitHandlerRegistered) {
+                exitHandlerRegistered = (atexit(flushAtExit) == 0);
+            }
+            if (flushOnCrash) {
+                setCrashHandlers(true);
+            }
+        } else {
+            // Log synchronously
+            async = false;
+        }
+    }
+    bool started = writerStarted;
+    pthread_mutex_unlock(&writerMutex);
+
+    return started;
+}
+
+void POSIXLog::stopWriter() {
+
+    pthread_mutex_lock(&writerMutex);
+    bool started = writerStarted;
+    writerStop = true;
+    pthread_cond_signal(&writerCond);
+    pthread_mutex_unlock(&writerMutex);
+
+    if (started && !pthread_equal(pthread_self(), writerThread)) {
+        pthread_join(writerThread, NULL);
+    }
+
+    // What the writer left, then the rings of the threads that exited
+    writePending();
+
+    pthread_mutex_lock(&logMutex);
+    pthread_mutex_lock(&writerMutex);
+    releaseOrphanedRings();
+    writerStarted = false;
+    pthread_cond_broadcast(&flushedCond);
+    pthread_mutex_unlock(&writerMutex);
+    pthread_mutex_unlock(&logMutex);
+}
+
+void POSIXLog::setAsync(bool enabled) {
+
+    if (!enabled && async) {
+        async = false;
+        stopWriter();
+    }
+    else if (enabled && !async) {
+        pthread_mutex_lock(&writerMutex);
+        writerStop = false;
+        async = true;
+        pthread_mutex_unlock(&writerMutex);
+    }
+}
+
+void POSIXLog::flush() {
+
+    if (writerStarted && pthread_equal(pthread_self(), writerThread)) {
+        // Already writing
+        return;
+    }
+
+    pthread_mutex_lock(&writerMutex);
+    if (writerStarted) {
+        // The round in progress may have missed the last messages
+        unsigned int target = writerRound + 2;
+        flushRequests++;
+        pthread_cond_signal(&writerCond);
+        while (writerStarted && (int)(writerRound - target) < 0) {
+            pthread_cond_wait(&flushedCond, &writerMutex);
+        }
+        flushRequests--;
+    }
+    pthread_mutex_unlock(&writerMutex);
+
+    // Messages queued when the writer was not running
+    writePending();
+}
+
+void POSIXLog::threadExited(void* ring) {
+    ((LogRing*)ring)->orphaned = true;
+}
+
+void POSIXLog::setFlushOnExit(bool enabled) {
+
+    pthread_mutex_lock(&writerMutex);
+    flushOnExit = enabled;
+    if (enabled && !exitHandlerRegistered) {
+        exitHandlerRegistered = (atexit(flushAtExit) == 0);
+    }
+    pthread_mutex_unlock(&writerMutex);
+}
+
+void POSIXLog::flushAtExit() {
+    if (flushOnExit && activeLog) {
+        activeLog->stopWriter();
+    }
+}
+
+void POSIXLog::setFlushOnCrash(bool enabled) {
+
+    pthread_mutex_lock(&writerMutex);
+    flushOnCrash = enabled;
+    if (writerStarted || !enabled) {
+        setCrashHandlers(enabled);
+    }
+    pthread_mutex_unlock(&writerMutex);
+}
+
+/**
+ * Installs or restores the crash handlers, called with writerMutex locked.
+ */
+void POSIXLog::setCrashHandlers(bool enabled) {
+
+    for (int i = 0; i < CRASH_SIGNALS_COUNT; i++) {
+        if (enabled && !crashHandlerInstalled[i]) {
+            // Don't replace the handlers set by the application
+            struct sigaction current;
+            if (sigaction(crashSignals[i], NULL, &current) != 0 ||
+                (current.sa_flags & SA_SIGINFO) || current.sa_handler != SIG_DFL) {
+                continue;
+            }
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = crashHandler;
+            sa.sa_flags   = SA_RESETHAND | SA_NODEFER;
+            sigemptyset(&sa.sa_mask);
+            if (sigaction(crashSignals[i], &sa, &previousActions[i]) == 0) {
+                crashHandlerInstalled[i] = true;
+            }
+        } else if (!enabled && crashHandlerInstalled[i]) {
+            sigaction(crashSignals[i], &previousActions[i], NULL);
+            crashHandlerInstalled[i] = false;
+        }
+    }
+}
+
+/**
+ * Updates the descriptor used by the crash handler after the log file
+ * changed. Called with logMutex locked.
+ */
+void POSIXLog::updateCrashFd() {
+    if (logFile) {
+        crashFd = fileno(logFile);
+    } else {
+        crashFd = logFileStdout ? 1 : -1;
+    }
+}
+
+/** write(2) of a whole buffer, async-signal-safe */
+static void writeRaw(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        len  -= written;
+    }
+}
+
+static void writeRaw(int fd, const char* str) {
+    size_t len = 0;
+    while (str[len]) {
+        len++;
+    }
+    writeRaw(fd, str, len);
+}
+
+/**
+ * Writes the queued messages from a signal handler: no locks, no memory
+ * allocation, no stdio. The records are left in the rings (including the
+ * long messages): the process is going to die.
+ */
+void POSIXLog::writeOnCrash() {
+
+    int fd = crashFd;
+    if (fd < 0) {
+        return;
+    }
+    writeRaw(fd, "---- pending log messages at crash ----\n");
+    for (;;) {
+        LogRing* first = NULL;
+        LogRecord* record = NULL;
+        for (LogRing* ring = rings; ring; ring = ring->next) {
+            LogRecord* r = ring->peek();
+            if (r && (!record || r->seq < record->seq)) {
+                first  = ring;
+                record = r;
+            }
+        }
+        if (!record) {
+            break;
+        }
+        const char* text = record->heapText ? record->heapText : (const char*)(record + 1);
+        writeRaw(fd, "[");
+        writeRaw(fd, record->levelPrefix);
+        writeRaw(fd, "] ");
+        writeRaw(fd, text, record->prefixLength);
+        writeRaw(fd, &text[record->prefixLength + 1]);
+        writeRaw(fd, "\n");
+        first->head += record->size;
+    }
+}
+
+void POSIXLog::crashHandler(int sig) {
+
+    POSIXLog* log = activeLog;
+    if (log) {
+        log->writerStop = true;
+        log->writeOnCrash();
+    }
+    // SA_RESETHAND restored the default action
+    raise(sig);
+}
+
+
+void POSIXLog::setLogRotation(size_t maxSize, unsigned int maxCount, bool compress) {
+
+    pthread_mutex_lock(&logMutex);
+    rotateMaxSize  = maxSize;
+    rotateMaxCount = maxCount;
+#ifdef USE_ZLIB
+    rotateCompress = compress;
+#else
+    if (compress) {
+        LOG.debug("Log compression not available: rotated logs are not compressed");
+    }
+    rotateCompress = false;
+#endif
+    pthread_mutex_unlock(&logMutex);
+}
+
+bool POSIXLog::rotate() {
+
+    flush();
+    pthread_mutex_lock(&logMutex);
+    // The wait releases the log: the other threads keep logging
+    while (compressing && !compressDone) {
+        pthread_cond_wait(&compressCond, &logMutex);
+    }
+    bool ret = rotateLogSegments();
+    pthread_mutex_unlock(&logMutex);
+    return ret;
+}
+
+/**
+ * Rotates the log file if it exceeds the max size.
+ * Called with logMutex locked, after the file has been flushed.
+ */
+void POSIXLog::checkRotation() {
+
+    if (rotateMaxSize && logFile && (size_t)ftell(logFile) >= rotateMaxSize) {
+        rotateLogSegments();
+    }
+}
+
+/**
+ * Shifts the rotated segments, moves the log file to <name>.1 and opens
+ * a new log file. Called with logMutex locked.
+ * @return true if the file has been rotated
+ */
+bool POSIXLog::rotateLogSegments() {
+
+    if (!logFile) {
+        return false;
+    }
+
+    // The last segment may still be compressing: rotate later, the join
+    // below doesn't block once compressDone is set
+    if (compressing) {
+        if (!compressDone) {
+            return false;
+        }
+        pthread_join(compressThread, NULL);
+        compressing = false;
+    }
+
+    crashFd = -1;
+    fclose(logFile);
+    logFile = NULL;
+
+    StringBuffer base(logFileName);
+    StringBuffer oldName, newName;
+    const char* suffixes[] = { "", ".gz" };
+    for (unsigned int i = rotateMaxCount; i >= 1; i--) {
+        for (int j = 0; j < 2; j++) {
+            oldName.sprintf("%s.%u%s", base.c_str(), i, suffixes[j]);
+            if (i == rotateMaxCount) {
+                remove(oldName.c_str());
+            } else {
+                newName.sprintf("%s.%u%s", base.c_str(), i + 1, suffixes[j]);
+                renameFile(oldName.c_str(), newName.c_str());
+            }
+        }
+    }
+
+    bool rotated = false;
+    if (rotateMaxCount == 0) {
+        rotated = (remove(base.c_str()) == 0);
+    } else {
+        newName.sprintf("%s.1", base.c_str());
+        rotated = (renameFile(base.c_str(), newName.c_str()) == 0);
+    }
+
+    openLogFile(logPath, logName, logRedirectStderr);
+    if (!rotated) {
+        LOG.error("%s: unable to rotate the log file %s", __FUNCTION__, base.c_str());
+        return false;
+    }
+
+    if (rotateCompress && rotateMaxCount > 0) {
+        compressSource = newName;
+        compressDone = false;
+        compressing = (pthread_create(&compressThread, NULL, compressMain, this) == 0);
+    }
+    return true;
+}
+
+/**
+ * Waits for the compression thread, called without logMutex.
+ */
+void POSIXLog::waitCompression() {
+    if (compressing) {
+        pthread_join(compressThread, NULL);
+        compressing = false;
+    }
+}
+
+void* POSIXLog::compressMain(void* arg) {
+
+    POSIXLog* log = (POSIXLog*)arg;
+
+    // Compressed to a temporary name: a reader never sees half a segment
+    StringBuffer tmpName, gzName;
+    tmpName.sprintf("%s.gz.tmp", log->compressSource.c_str());
+    gzName.sprintf("%s.gz", log->compressSource.c_str());
+
+    if (gzipFile(log->compressSource.c_str(), tmpName.c_str()) &&
+        renameFile(tmpName.c_str(), gzName.c_str()) == 0) {
+        remove(log->compressSource.c_str());
+    } else {
+        remove(tmpName.c_str());
+    }
+
+    pthread_mutex_lock(&log->logMutex);
+    log->compressDone = true;
+    pthread_cond_broadcast(&log->compressCond);
+    pthread_mutex_unlock(&log->logMutex);
+    return NULL;
+}
+
 
 void POSIXLog::reset(const char*  title) {
     setLogFile(logPath, logName, logRedirectStderr);
 
     if (logFile) {
-//        pthread_mutex_lock(&logMutex);
+        pthread_mutex_lock(&logMutex);
         ftruncate(fileno(logFile), 0);
-//        pthread_mutex_unlock(&logMutex);
+        pthread_mutex_unlock(&logMutex);
     }
 }
 
@@ -324,11 +1061,15 @@ void POSIXLog::reset(const char*  title) {
 size_t POSIXLog::getLogSize() {
     size_t ret = 0;
 
+    flush();
+    pthread_mutex_lock(&logMutex);
     if (logFile) {
         ret = fgetsize(logFile);
+        crashFd = -1;
         fclose(logFile);
         logFile = NULL;
     }
+    pthread_mutex_unlock(&logMutex);
     return ret;
 }
 
@@ -0,0 +1,426 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <string.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+
+#include "event/EventBus.h"
+#include "event/FireEvent.h"
+#include "event/ManageListener.h"
+
+namespace Funambol {
+
+/// Index in EventBus::progress of a progress event type, -1 if not progress
+static int progressIndex(int type) {
+    switch (type) {
+        case DATA_SENT:     return 0;
+        case DATA_RECEIVED: return 1;
+        default:            return -1;
+    }
+}
+
+/// Current time in msec
+static unsigned long currentTime() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+EventBus::EventBus(int batchSize_, int progressInterval_) : FThread(),
+    head(&stub), tail(&stub),
+    batchSize(batchSize_ > 0 ? batchSize_ : EVENT_BUS_BATCH_SIZE),
+    progressInterval(progressInterval_ >= 0 ? progressInterval_ : EVENT_BUS_PROGRESS_INTERVAL),
+    posted(0), delivered(0), accepting(false), sleeping(false),
+    started(false), flushRequests(0)
+{
+    stub.next  = NULL;
+    stub.event = NULL;
+    progress[0] = progress[1] = NULL;
+    lastProgress[0] = lastProgress[1] = 0;
+    memset(&dispatchThread, 0, sizeof(dispatchThread));
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&available, NULL);
+    pthread_cond_init(&flushed, NULL);
+}
+
+EventBus::~EventBus() {
+
+    stop();
+    deliverQueued();
+
+    pthread_cond_destroy(&flushed);
+    pthread_cond_destroy(&available);
+    pthread_mutex_destroy(&mutex);
+}
+
+void EventBus::start(Priority priority) {
+
+    pthread_mutex_lock(&mutex);
+    if (started) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    started   = true;
+    terminate = false;
+    accepting = true;
+    pthread_mutex_unlock(&mutex);
+
+    FThread::start(priority);
+    ManageListener::getInstance().setEventDispatcher(this);
+}
+
+void EventBus::stop() {
+
+    pthread_mutex_lock(&mutex);
+    if (!started) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // back to synchronous mode: this waits for the queued events
+    ManageListener& m = ManageListener::getInstance();
+    if (m.getEventDispatcher() == this) {
+        m.setEventDispatcher(NULL);
+    }
+    accepting = false;
+
+    softTerminate();
+    wait();
+
+    pthread_mutex_lock(&mutex);
+    started = false;
+    pthread_mutex_unlock(&mutex);
+
+    // events queued by a fire function racing with the stop
+    deliverQueued();
+}
+
+void EventBus::softTerminate() {
+
+    pthread_mutex_lock(&mutex);
+    terminate = true;
+    pthread_cond_broadcast(&available);
+    pthread_mutex_unlock(&mutex);
+}
+
+bool EventBus::dispatch(EventFamily family, BaseEvent* event) {
+
+    if (!accepting || event == NULL) {
+        return false;
+    }
+
+    Node* node   = new Node;
+    node->family = family;
+    node->event  = event;
+
+    __sync_add_and_fetch(&posted, 1);
+    push(node);
+
+    // the push is a full barrier: a thread going to sleep after it
+    // finds the node, one that was already sleeping is seen here
+    if (sleeping) {
+        pthread_mutex_lock(&mutex);
+        pthread_cond_signal(&available);
+        pthread_mutex_unlock(&mutex);
+    }
+    return true;
+}
+
+void EventBus::flush() {
+
+    pthread_mutex_lock(&mutex);
+    if (!started || pthread_equal(pthread_self(), dispatchThread)) {
+        // a listener flushing would wait for itself
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    long target = posted;
+    flushRequests++;
+    pthread_cond_signal(&available);
+    while (delivered < target && !terminate) {
+        pthread_cond_wait(&flushed, &mutex);
+    }
+    flushRequests--;
+    pthread_mutex_unlock(&mutex);
+}
+
+//
+// Intrusive MPSC queue: the producers only swap the head pointer and then
+// link the previous node to the new one. Between the two steps the queue
+// looks empty from that node on: pop() returns NULL and isEmpty() false.
+//
+void EventBus::push(Node* node) {
+
+    node->next = NULL;
+    __sync_synchronize();
+    Node* prev = __sync_lock_test_and_set(&head, node);
+    prev->next = node;
+    __sync_synchronize();
+}
+
+EventBus::Node* EventBus::pop() {
+
+    Node* t    = tail;
+    Node* next = t->next;
+
+    if (t == &stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        tail = next;
+        t    = next;
+        next = next->next;
+    }
+    if (next) {
+        tail = next;
+        return t;
+    }
+    if (t != head) {
+        return NULL;            // a producer is linking a new node
+    }
+
+    // t is the last node: put the stub behind it, to detach it
+    push(&stub);
+    next = t->next;
+    if (next) {
+        tail = next;
+        return t;
+    }
+    return NULL;
+}
+
+bool EventBus::isEmpty() {
+    return (tail == &stub) && (head == &stub);
+}
+
+void EventBus::run() {
+
+    LOG.debug("Starting event dispatch thread");
+
+    pthread_mutex_lock(&mutex);
+    dispatchThread = pthread_self();
+    pthread_mutex_unlock(&mutex);
+
+    std::vector<Node*> batch;
+    batch.reserve(batchSize);
+
+    while (1) {
+
+        Node* node = NULL;
+        while ((int)batch.size() < batchSize && (node = pop()) != NULL) {
+            batch.push_back(node);
+        }
+        if (!batch.empty()) {
+            markDelivered(deliverBatch(batch));
+            batch.clear();
+            continue;
+        }
+
+        pthread_mutex_lock(&mutex);
+        bool force = terminate || flushRequests > 0;
+        pthread_mutex_unlock(&mutex);
+        markDelivered(deliverProgress(force));
+
+        pthread_mutex_lock(&mutex);
+        if (terminate && isEmpty()) {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        sleeping = true;
+        __sync_synchronize();
+        if (isEmpty() && !terminate && flushRequests == 0) {
+            if (progress[0] || progress[1]) {
+                // wake up when the first merged progress is due
+                unsigned long due = 0;
+                for (int i = 0; i < 2; i++) {
+                    if (progress[i] && (due == 0 || lastProgress[i] + progressInterval < due)) {
+                        due = lastProgress[i] + progressInterval;
+                    }
+                }
+                struct timespec ts;
+                ts.tv_sec  = due / 1000;
+                ts.tv_nsec = (due % 1000) * 1000000;
+                pthread_cond_timedwait(&available, &mutex, &ts);
+            } else {
+                pthread_cond_wait(&available, &mutex);
+            }
+        }
+        sleeping = false;
+        pthread_mutex_unlock(&mutex);
+
+        if (!isEmpty()) {
+            // a producer between the swap and the link: let it finish
+            sched_yield();
+        }
+    }
+
+    LOG.debug("Exiting event dispatch thread");
+}
+
+/*
+ * Delivers the events left in the queue, on the calling thread.
+ * Called once the dispatching thread is stopped.
+ */
+void EventBus::deliverQueued() {
+
+    std::vector<Node*> batch;
+    while (!isEmpty()) {
+        Node* node = pop();
+        if (node) {
+            batch.push_back(node);
+        } else {
+            sched_yield();
+        }
+    }
+    long count = deliverBatch(batch);
+    count += deliverProgress(true);
+    markDelivered(count);
+}
+
+/*
+ * Delivers the batch, reading the listeners once per run of events of the
+ * same family, and releases its nodes.
+ * @return the number of events delivered or merged
+ */
+long EventBus::deliverBatch(std::vector<Node*>& batch) {
+
+    long count = 0;
+    std::vector<SyncItemEvent*> items;
+
+    size_t i = 0;
+    while (i < batch.size()) {
+        Node* node = batch[i];
+
+        if (node->family == SYNC_ITEM_EVENT_FAMILY) {
+            size_t end = i;
+            items.clear();
+            while (end < batch.size() && batch[end]->family == SYNC_ITEM_EVENT_FAMILY) {
+                items.push_back(static_cast<SyncItemEvent*>(batch[end]->event));
+                end++;
+            }
+            deliverSyncItemEvents(&items[0], (int)items.size());
+            for (; i < end; i++) {
+                delete batch[i]->event;
+                delete batch[i];
+                count++;
+            }
+            continue;
+        }
+
+        if (node->family == TRANSPORT_EVENT_FAMILY) {
+            if (progressIndex(node->event->getType()) >= 0) {
+                count += queueProgress(static_cast<TransportEvent*>(node->event));
+                delete node;
+                i++;
+                continue;
+            }
+            // the data transferred goes before the end of the transfer
+            count += deliverProgress(true);
+        }
+
+        deliverEvent(node->family, *node->event);
+        delete node->event;
+        delete node;
+        count++;
+        i++;
+    }
+
+    count += deliverProgress(false);
+    return count;
+}
+
+/*
+ * Merges the progress event with the pending one of the same type.
+ * @return the number of events merged (the pending one is not counted)
+ */
+long EventBus::queueProgress(TransportEvent* event) {
+
+    int index = progressIndex(event->getType());
+    TransportEvent* pending = progress[index];
+    if (pending == NULL) {
+        progress[index] = event;
+        return 0;
+    }
+
+    progress[index] = new TransportEvent(pending->getDataSize() + event->getDataSize(),
+                                         event->getType(), event->getDate());
+    delete pending;
+    delete event;
+    return 1;
+}
+
+/*
+ * Delivers the merged progress events whose interval is expired,
+ * or all of them if 'force'.
+ * @return the number of events delivered
+ */
+long EventBus::deliverProgress(bool force) {
+
+    long count = 0;
+    unsigned long now = currentTime();
+
+    for (int i = 0; i < 2; i++) {
+        TransportEvent* event = progress[i];
+        if (event == NULL) {
+            continue;
+        }
+        if (!force && now - lastProgress[i] < (unsigned long)progressInterval) {
+            continue;
+        }
+        progress[i] = NULL;
+        deliverEvent(TRANSPORT_EVENT_FAMILY, *event);
+        delete event;
+        lastProgress[i] = now;
+        count++;
+    }
+    return count;
+}
+
+void EventBus::markDelivered(long count) {
+
+    pthread_mutex_lock(&mutex);
+    delivered += count;
+    pthread_cond_broadcast(&flushed);
+    pthread_mutex_unlock(&mutex);
+}
+
+} // end namespace Funambol
@@ -274,6 +274,7 @@ char * CurlTransportAgent::sendBuffer(const void * data, unsigned int size) {
     responsebuffer = new char[responsebuffersize];
     received = 0;
     responsebuffer[0] = 0;
+    sendTime = waitTime = receiveTime = -1;
     // todo? url.resource
     const char *certificates = getSSLServerCertificates();
     if ((code = curl_easy_setopt(easyhandle, CURLOPT_POST, true)) ||
@@ -300,6 +301,17 @@ char * CurlTransportAgent::sendBuffer(const void * data, unsigned int size) {
             res_code = -1;
         }
 
+        // split the exchange: connection, upload + server, download
+        double pretransfer = 0, starttransfer = 0, total = 0;
+        if (curl_easy_getinfo(easyhandle, CURLINFO_PRETRANSFER_TIME,   &pretransfer)   == CURLE_OK &&
+            curl_easy_getinfo(easyhandle, CURLINFO_STARTTRANSFER_TIME, &starttransfer) == CURLE_OK &&
+            curl_easy_getinfo(easyhandle, CURLINFO_TOTAL_TIME,         &total)         == CURLE_OK &&
+            pretransfer <= starttransfer && starttransfer <= total) {
+            sendTime    = (int64_t)(pretransfer * 1000000);
+            waitTime    = (int64_t)((starttransfer - pretransfer) * 1000000);
+            receiveTime = (int64_t)((total - starttransfer) * 1000000);
+        }
+
         POSIX_LOG.setPrefix("data in: ");
         LOG.debug("=== %d bytes ===\n%s",
                   (int)strlen(response),
@@ -344,6 +356,7 @@ char* CurlTransportAgent::query(ArrayList& httpHeaders, long* protocolResponseCo
     responsebuffer = new char[responsebuffersize];
     received = 0;
     responsebuffer[0] = 0;
+    sendTime = waitTime = receiveTime = -1;
     // todo? url.resource
     const char *certificates = getSSLServerCertificates();
     if ((code = curl_easy_setopt(easyhandle, CURLOPT_HTTPGET, true)) ||
@@ -294,6 +294,8 @@ char * MacTransportAgent::sendBuffer(const void * data, const unsigned int size)
         fireTransportEvent(result.length(), RECEIVE_DATA_END);
 
         setResponseCode(statusCode);
+        // The reply is read as a string: binary content is cut at the first NUL
+        responseSize = result.length();
         LOG.debug("Status Code: %d", statusCode);
         LOG.debug("Result: %s", result.c_str());
 
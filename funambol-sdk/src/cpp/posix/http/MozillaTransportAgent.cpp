@@ -96,6 +96,8 @@ char* MozillaTransportAgent::sendMessage(const char* msg)
     nsCOMPtr<nsIComponentManager> compManager;
     NS_GetComponentManager(getter_AddRefs(compManager));
 
+    responseSize = 0;
+
     // Sanity checks
     if(!msg) {
         LOG.error("MozillaTransportAgent::sendMessage error: NULL message.");
@@ -209,6 +211,7 @@ char* MozillaTransportAgent::sendMessage(const char* msg)
             retResponse = stringdup(NS_ConvertUTF16toUTF8(responseText).get());
 
             contentLength = strlen(retResponse);
+            responseSize = contentLength;
             fireTransportEvent(contentLength, RECEIVE_DATA_END);
 
             break;
@@ -0,0 +1,940 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#if defined(__linux__)
+#  define CTP_ENGINE_USE_EPOLL 1
+#  include <sys/epoll.h>
+#  define CTP_EVENT_IN      EPOLLIN
+#  define CTP_EVENT_OUT     EPOLLOUT
+#  define CTP_EVENT_ERROR   (EPOLLERR | EPOLLHUP)
+#else
+#  include <poll.h>
+#  define CTP_EVENT_IN      POLLIN
+#  define CTP_EVENT_OUT     POLLOUT
+#  define CTP_EVENT_ERROR   (POLLERR | POLLHUP | POLLNVAL)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/Log.h"
+
+#include "push/CTPService.h"
+#include "push/CTPEngine.h"
+
+namespace Funambol {
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags != -1) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CTPResolver
+//////////////////////////////////////////////////////////////////////////////
+CTPResolver::CTPResolver(CTPEventLoop& loop_) : FThread(), loop(loop_), started(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&available, NULL);
+}
+
+CTPResolver::~CTPResolver() {
+
+    stop();
+    pthread_cond_destroy(&available);
+    pthread_mutex_destroy(&mutex);
+}
+
+void CTPResolver::resolve(uint32_t id, const char* host, const char* port) {
+
+    Request req;
+    req.id   = id;
+    req.host = host;
+    req.port = port;
+
+    pthread_mutex_lock(&mutex);
+    requests.push_back(req);
+    pthread_cond_signal(&available);
+    pthread_mutex_unlock(&mutex);
+}
+
+void CTPResolver::start(Priority priority) {
+
+    pthread_mutex_lock(&mutex);
+    if (started) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    started   = true;
+    terminate = false;
+    pthread_mutex_unlock(&mutex);
+
+    FThread::start(priority);
+}
+
+void CTPResolver::softTerminate() {
+
+    pthread_mutex_lock(&mutex);
+    terminate = true;
+    pthread_cond_broadcast(&available);
+    pthread_mutex_unlock(&mutex);
+}
+
+void CTPResolver::stop() {
+
+    softTerminate();
+    if (started) {
+        wait();
+        started = false;
+    }
+}
+
+void CTPResolver::run() {
+
+    pthread_mutex_lock(&mutex);
+    while (!terminate) {
+        if (requests.empty()) {
+            pthread_cond_wait(&available, &mutex);
+            continue;
+        }
+        Request req = requests.front();
+        requests.pop_front();
+        pthread_mutex_unlock(&mutex);
+
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        int ret = getaddrinfo(req.host.c_str(), req.port.c_str(), &hints, &res);
+        if (ret != 0 || res == NULL) {
+            LOG.error("%s: cannot resolve '%s' (%s)", __FUNCTION__, req.host.c_str(),
+                      ret ? gai_strerror(ret) : "no address");
+            res = NULL;
+        }
+        loop.onResolved(req.id, res);
+
+        pthread_mutex_lock(&mutex);
+    }
+    requests.clear();
+    pthread_mutex_unlock(&mutex);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CTPEventLoop
+//////////////////////////////////////////////////////////////////////////////
+CTPEventLoop::CTPEventLoop(CTPEngine& engine_) : FThread(), engine(engine_), resolver(*this),
+                                                 lastResolveId(0), loopNow(0), pollFd(-1),
+                                                 loopRunning(false)
+{
+    wakeFds[0] = wakeFds[1] = -1;
+    memset(&loopThread, 0, sizeof(loopThread));
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&removed, NULL);
+}
+
+CTPEventLoop::~CTPEventLoop() {
+
+    // No more results after this
+    resolver.stop();
+    for (size_t i = 0; i < resolved.size(); i++) {
+        if (resolved[i].addrs) {
+            freeaddrinfo(resolved[i].addrs);
+        }
+    }
+    resolved.clear();
+
+    int64_t now = CTPEngine::now();
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (connections[i]->fd >= 0) {
+            closeConnection(connections[i], now);
+        }
+        releaseAddresses(connections[i]);
+        connections[i]->session->setObserver(NULL);
+        delete connections[i];
+    }
+    connections.clear();
+
+    if (pollFd >= 0)     { ::close(pollFd); }
+    if (wakeFds[0] >= 0) { ::close(wakeFds[0]); }
+    if (wakeFds[1] >= 0) { ::close(wakeFds[1]); }
+
+    pthread_cond_destroy(&removed);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool CTPEventLoop::startLoop() {
+
+    if (pipe(wakeFds) != 0) {
+        LOG.error("%s: cannot create the wakeup pipe (%d)", __FUNCTION__, errno);
+        return false;
+    }
+    setNonBlocking(wakeFds[0]);
+    setNonBlocking(wakeFds[1]);
+
+#ifdef CTP_ENGINE_USE_EPOLL
+    pollFd = epoll_create(CTP_ENGINE_MAX_EVENTS);
+    if (pollFd < 0) {
+        LOG.error("%s: epoll_create error (%d)", __FUNCTION__, errno);
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.ptr = NULL;         // NULL is the wakeup pipe
+    if (epoll_ctl(pollFd, EPOLL_CTL_ADD, wakeFds[0], &ev) != 0) {
+        LOG.error("%s: cannot watch the wakeup pipe (%d)", __FUNCTION__, errno);
+        return false;
+    }
+#endif
+
+    pthread_mutex_lock(&mutex);
+    loopRunning = true;
+    pthread_mutex_unlock(&mutex);
+
+    resolver.start();
+    start();
+    return true;
+}
+
+void CTPEventLoop::addSession(CTPSession* session) {
+
+    pthread_mutex_lock(&mutex);
+    sessions.insert(session);
+    pendingAdd.push_back(session);
+    pthread_mutex_unlock(&mutex);
+    wakeup();
+}
+
+bool CTPEventLoop::removeSession(CTPSession* session) {
+
+    pthread_mutex_lock(&mutex);
+    if (sessions.find(session) == sessions.end()) {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+
+    if (loopRunning && !pthread_equal(pthread_self(), loopThread)) {
+        pendingRemove.push_back(session);
+        wakeup();
+        while (loopRunning && sessions.find(session) != sessions.end()) {
+            pthread_cond_wait(&removed, &mutex);
+        }
+    }
+    if (sessions.find(session) != sessions.end()) {
+        // The loop is not running: nobody else touches the connections
+        detach(session, CTPEngine::now());
+    }
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+int32_t CTPEventLoop::getSessionCount() {
+
+    pthread_mutex_lock(&mutex);
+    int32_t ret = (int32_t)sessions.size();
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+void CTPEventLoop::softTerminate() {
+    terminate = true;
+    wakeup();
+}
+
+void CTPEventLoop::wakeup() {
+
+    if (wakeFds[1] >= 0) {
+        char c = 0;
+        if (::write(wakeFds[1], &c, 1) < 0 && errno != EAGAIN) {
+            LOG.error("%s: write error (%d)", __FUNCTION__, errno);
+        }
+    }
+}
+
+
+void CTPEventLoop::run() {
+
+    LOG.debug("Starting CTP event loop");
+
+    pthread_mutex_lock(&mutex);
+    loopThread = pthread_self();
+    pthread_mutex_unlock(&mutex);
+
+    while (!terminate) {
+        int64_t now = CTPEngine::now();
+        pthread_mutex_lock(&mutex);
+        processPending(now);
+        pthread_mutex_unlock(&mutex);
+        processResolved(now);
+
+        // Service the sessions whose deadline expired
+        loopNow = now;
+        timers.expire(now);
+
+        int timeout = CTP_ENGINE_MAX_WAIT;
+        int64_t next = timers.getNextExpiry(now);
+        if (next >= 0) {
+            int64_t delta = next - CTPEngine::now();
+            timeout = delta < 0 ? 0 : (delta > CTP_ENGINE_MAX_WAIT ? CTP_ENGINE_MAX_WAIT : (int)delta);
+        }
+        waitEvents(timeout);
+    }
+
+    // Close all the connections: the sessions are still registered
+    resolver.stop();
+    int64_t now = CTPEngine::now();
+    pthread_mutex_lock(&mutex);
+    processPending(now);
+    for (size_t i = 0; i < resolved.size(); i++) {
+        if (resolved[i].addrs) {
+            freeaddrinfo(resolved[i].addrs);
+        }
+    }
+    resolved.clear();
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (connections[i]->fd >= 0) {
+            closeConnection(connections[i], now);
+        }
+        else if (connections[i]->resolveId) {
+            connections[i]->resolveId = 0;
+            connections[i]->session->onDisconnected(now);
+        }
+    }
+    loopRunning = false;
+    pthread_cond_broadcast(&removed);
+    pthread_mutex_unlock(&mutex);
+
+    LOG.debug("Exiting CTP event loop");
+}
+
+/// Applies the sessions added/removed by other threads. Called with the mutex held.
+void CTPEventLoop::processPending(int64_t now) {
+
+    for (size_t i = 0; i < pendingAdd.size(); i++) {
+        Connection* conn = new Connection();
+        conn->session    = pendingAdd[i];
+        conn->fd         = -1;
+        conn->connecting = false;
+        conn->events     = 0;
+        conn->resolveId  = 0;
+        conn->addrs      = NULL;
+        conn->nextAddr   = NULL;
+        conn->loop       = this;
+        conn->session->setObserver(&engine);
+        connections.push_back(conn);
+
+        // Connect on the next tick
+        timers.schedule(conn, 0, now);
+    }
+    pendingAdd.clear();
+
+    for (size_t i = 0; i < pendingRemove.size(); i++) {
+        detach(pendingRemove[i], now);
+    }
+    if (!pendingRemove.empty()) {
+        pendingRemove.clear();
+        pthread_cond_broadcast(&removed);
+    }
+}
+
+/// Stops the session and drops its connection. Called with the mutex held.
+void CTPEventLoop::detach(CTPSession* session, int64_t now) {
+
+    session->stop();
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (connections[i]->session == session) {
+            if (connections[i]->fd >= 0) {
+                closeConnection(connections[i], now);
+            }
+            timers.cancel(connections[i]);
+            releaseAddresses(connections[i]);
+            delete connections[i];
+            connections.erase(connections.begin() + i);
+            break;
+        }
+    }
+    for (size_t i = 0; i < pendingAdd.size(); i++) {
+        if (pendingAdd[i] == session) {
+            pendingAdd.erase(pendingAdd.begin() + i);
+            break;
+        }
+    }
+    session->setObserver(NULL);
+    sessions.erase(session);
+}
+
+
+/// Called by the resolver thread.
+void CTPEventLoop::onResolved(uint32_t id, struct addrinfo* addrs) {
+
+    Resolved res;
+    res.id    = id;
+    res.addrs = addrs;
+
+    pthread_mutex_lock(&mutex);
+    resolved.push_back(res);
+    pthread_mutex_unlock(&mutex);
+    wakeup();
+}
+
+/// Connects the sessions whose name has been resolved.
+void CTPEventLoop::processResolved(int64_t now) {
+
+    std::vector<Resolved> done;
+    pthread_mutex_lock(&mutex);
+    done.swap(resolved);
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < done.size(); i++) {
+        Connection* conn = NULL;
+        for (size_t j = 0; j < connections.size(); j++) {
+            if (connections[j]->resolveId == done[i].id) {
+                conn = connections[j];
+                break;
+            }
+        }
+        if (conn == NULL) {
+            // The session has been removed or its connect timed out
+            if (done[i].addrs) {
+                freeaddrinfo(done[i].addrs);
+            }
+            continue;
+        }
+
+        conn->resolveId = 0;
+        if (done[i].addrs == NULL) {
+            conn->session->onDisconnected(now);
+        } else {
+            conn->addrs    = done[i].addrs;
+            conn->nextAddr = done[i].addrs;
+            connectNext(conn, now);
+        }
+        updateTimer(conn, now);
+    }
+}
+
+
+void CTPEventLoop::Connection::onTimeout() {
+    loop->serviceConnection(this, loop->loopNow);
+}
+
+void CTPEventLoop::serviceConnection(Connection* conn, int64_t now) {
+
+    CTPSession* session = conn->session;
+
+    if (conn->fd >= 0 && !session->onTimer(now)) {
+        closeConnection(conn, now);
+    }
+    if (conn->resolveId && !session->onTimer(now)) {
+        // The connect timeout expired while resolving: the result is dropped
+        conn->resolveId = 0;
+        session->onDisconnected(now);
+    }
+    if (conn->fd < 0 && session->shouldConnect(now)) {
+        openConnection(conn, now);
+    }
+    if (conn->fd >= 0 && !conn->connecting) {
+        flushOutput(conn, now);
+    }
+    updateTimer(conn, now);
+}
+
+/// Schedules the connection at the next deadline of its session.
+void CTPEventLoop::updateTimer(Connection* conn, int64_t now) {
+
+    int64_t deadline = conn->session->getNextDeadline();
+    if (deadline < 0) {
+        timers.cancel(conn);
+    } else {
+        timers.schedule(conn, deadline - now, now);
+    }
+}
+
+void CTPEventLoop::openConnection(Connection* conn, int64_t now) {
+
+    CTPSession* session = conn->session;
+    session->onConnecting(now);
+
+    StringBuffer port;
+    port.sprintf("%d", session->getConfig().getCtpPort());
+
+    // The name is resolved by the resolver thread, then processResolved() connects
+    if (++lastResolveId == 0) {
+        ++lastResolveId;
+    }
+    conn->resolveId = lastResolveId;
+    resolver.resolve(conn->resolveId, session->getConfig().getUrlTo().c_str(), port.c_str());
+}
+
+/**
+ * Connects to the next resolved address of the connection: an address that
+ * fails (i.e. an unreachable IPv6 address) falls back to the following one.
+ * When no address is left the session is disconnected.
+ */
+void CTPEventLoop::connectNext(Connection* conn, int64_t now) {
+
+    CTPSession* session = conn->session;
+
+    while (conn->nextAddr) {
+        struct addrinfo* addr = conn->nextAddr;
+        conn->nextAddr = addr->ai_next;
+
+        int fd = ::socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0 || !setNonBlocking(fd)) {
+            LOG.error("%s: cannot create socket (%d)", __FUNCTION__, errno);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+        int ret = ::connect(fd, addr->ai_addr, addr->ai_addrlen);
+        if (ret != 0 && errno != EINPROGRESS) {
+            LOG.info("%s: cannot connect to %s (%d)", __FUNCTION__,
+                     session->getConfig().getUrlTo().c_str(), errno);
+            ::close(fd);
+            continue;
+        }
+
+        conn->fd         = fd;
+        conn->connecting = (ret != 0);
+        conn->events     = 0;
+#ifdef CTP_ENGINE_USE_EPOLL
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = 0;
+        ev.data.ptr = conn;
+        if (epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            LOG.error("%s: epoll_ctl error (%d)", __FUNCTION__, errno);
+            ::close(fd);
+            conn->fd = -1;
+            break;
+        }
+#endif
+
+        if (conn->connecting) {
+            updateEvents(conn);
+        } else {
+            connected(conn, now);
+        }
+        return;
+    }
+
+    LOG.error("%s: cannot connect to %s", __FUNCTION__, session->getConfig().getUrlTo().c_str());
+    releaseAddresses(conn);
+    session->onDisconnected(now);
+}
+
+void CTPEventLoop::releaseAddresses(Connection* conn) {
+
+    if (conn->addrs) {
+        freeaddrinfo(conn->addrs);
+    }
+    conn->addrs    = NULL;
+    conn->nextAddr = NULL;
+}
+
+void CTPEventLoop::connected(Connection* conn, int64_t now) {
+
+    conn->connecting = false;
+    releaseAddresses(conn);
+    if (!conn->session->onConnected(now)) {
+        closeConnection(conn, now);
+        return;
+    }
+    flushOutput(conn, now);
+}
+
+void CTPEventLoop::closeSocket(Connection* conn) {
+
+#ifdef CTP_ENGINE_USE_EPOLL
+    epoll_ctl(pollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+#endif
+    ::close(conn->fd);
+    conn->fd         = -1;
+    conn->connecting = false;
+    conn->events     = 0;
+}
+
+void CTPEventLoop::closeConnection(Connection* conn, int64_t now) {
+
+    closeSocket(conn);
+    releaseAddresses(conn);
+    conn->session->onDisconnected(now);
+}
+
+void CTPEventLoop::readConnection(Connection* conn, int64_t now) {
+
+    while (conn->fd >= 0) {
+        // Receive directly into the session buffer
+        int32_t space = 0;
+        char* buffer = conn->session->getReceiveSpace(&space);
+        ssize_t n = ::recv(conn->fd, buffer, space, 0);
+        if (n > 0) {
+            if (!conn->session->onReceived((int32_t)n, now)) {
+                closeConnection(conn, now);
+                return;
+            }
+            if (n < space) {
+                break;
+            }
+        }
+        else if (n == 0) {
+            LOG.debug("Connection closed by the Server");
+            closeConnection(conn, now);
+            return;
+        }
+        else if (errno == EINTR) {
+            continue;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        else {
+            LOG.error("%s: recv() error (%d)", __FUNCTION__, errno);
+            closeConnection(conn, now);
+            return;
+        }
+    }
+
+    // Responses (AUTH retry) may have been queued
+    flushOutput(conn, now);
+}
+
+void CTPEventLoop::flushOutput(Connection* conn, int64_t now) {
+
+    if (conn->fd < 0) {
+        return;
+    }
+
+    int32_t len = 0;
+    const char* out = conn->session->getPendingOutput(&len);
+    while (out && len > 0) {
+        ssize_t n = ::send(conn->fd, out, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            LOG.error("%s: send() error (%d)", __FUNCTION__, errno);
+            closeConnection(conn, now);
+            return;
+        }
+        LOG.debug("sendMsg - %d bytes sent", (int)n);
+        conn->session->consumeOutput((int32_t)n);
+        out = conn->session->getPendingOutput(&len);
+    }
+    updateEvents(conn);
+}
+
+void CTPEventLoop::handleEvent(Connection* conn, uint32_t events, int64_t now) {
+
+    if (conn->fd < 0) {
+        return;
+    }
+
+    if (conn->connecting) {
+        int err = 0;
+        socklen_t errLen = sizeof(err);
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &errLen) != 0) {
+            err = errno;
+        }
+        if (err == EINPROGRESS) {
+            return;
+        }
+        if (err != 0) {
+            LOG.info("%s: cannot connect to %s (%d)", __FUNCTION__,
+                     conn->session->getConfig().getUrlTo().c_str(), err);
+            // Try the next address, if any
+            closeSocket(conn);
+            connectNext(conn, now);
+            return;
+        }
+        connected(conn, now);
+        return;
+    }
+
+    if (events & CTP_EVENT_IN) {
+        readConnection(conn, now);
+    }
+    else if (events & CTP_EVENT_ERROR) {
+        LOG.debug("Socket error or hangup");
+        closeConnection(conn, now);
+        return;
+    }
+    if ((events & CTP_EVENT_OUT) && conn->fd >= 0) {
+        flushOutput(conn, now);
+    }
+}
+
+void CTPEventLoop::updateEvents(Connection* conn) {
+
+    if (conn->fd < 0) {
+        return;
+    }
+
+    int32_t pending = 0;
+    conn->session->getPendingOutput(&pending);
+    uint32_t events = conn->connecting ? (uint32_t)CTP_EVENT_OUT
+                                       : ((uint32_t)CTP_EVENT_IN | (pending ? (uint32_t)CTP_EVENT_OUT : 0U));
+    if (events == conn->events) {
+        return;
+    }
+    conn->events = events;
+
+#ifdef CTP_ENGINE_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.ptr = conn;
+    if (epoll_ctl(pollFd, EPOLL_CTL_MOD, conn->fd, &ev) != 0) {
+        LOG.error("%s: epoll_ctl error (%d)", __FUNCTION__, errno);
+    }
+#endif
+}
+
+void CTPEventLoop::waitEvents(int timeout) {
+
+#ifdef CTP_ENGINE_USE_EPOLL
+    struct epoll_event events[CTP_ENGINE_MAX_EVENTS];
+    int n = epoll_wait(pollFd, events, CTP_ENGINE_MAX_EVENTS, timeout);
+    if (n < 0) {
+        if (errno != EINTR) {
+            LOG.error("%s: epoll_wait error (%d)", __FUNCTION__, errno);
+        }
+        return;
+    }
+
+    int64_t now = CTPEngine::now();
+    for (int i = 0; i < n; i++) {
+        Connection* conn = (Connection*)events[i].data.ptr;
+        if (conn == NULL) {
+            char buf[64];
+            while (::read(wakeFds[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+        handleEvent(conn, events[i].events, now);
+        updateTimer(conn, now);
+    }
+#else
+    std::vector<struct pollfd> fds;
+    std::vector<Connection*>   conns;
+
+    struct pollfd wake;
+    wake.fd      = wakeFds[0];
+    wake.events  = POLLIN;
+    wake.revents = 0;
+    fds.push_back(wake);
+    conns.push_back(NULL);
+
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (connections[i]->fd >= 0) {
+            struct pollfd pfd;
+            pfd.fd      = connections[i]->fd;
+            pfd.events  = (short)connections[i]->events;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+            conns.push_back(connections[i]);
+        }
+    }
+
+    int n = poll(&fds[0], fds.size(), timeout);
+    if (n < 0) {
+        if (errno != EINTR) {
+            LOG.error("%s: poll error (%d)", __FUNCTION__, errno);
+        }
+        return;
+    }
+
+    int64_t now = CTPEngine::now();
+    for (size_t i = 0; i < fds.size() && n > 0; i++) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+        n--;
+        if (conns[i] == NULL) {
+            char buf[64];
+            while (::read(wakeFds[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+        handleEvent(conns[i], fds[i].revents, now);
+        updateTimer(conns[i], now);
+    }
+#endif
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CTPEngine
+//////////////////////////////////////////////////////////////////////////////
+CTPEngine::CTPEngine(int32_t loopCount_, int32_t dispatchQueueSize) :
+    loopCount(loopCount_ > 0 ? loopCount_ : 1), running(false),
+    dispatchQueue(dispatchQueueSize)
+{
+    loops = new CTPEventLoop*[loopCount];
+    for (int32_t i = 0; i < loopCount; i++) {
+        loops[i] = new CTPEventLoop(*this);
+    }
+}
+
+CTPEngine::~CTPEngine() {
+
+    stop();
+    for (int32_t i = 0; i < loopCount; i++) {
+        delete loops[i];
+    }
+    delete [] loops;
+}
+
+bool CTPEngine::start() {
+
+    if (running) {
+        return true;
+    }
+
+    LOG.debug("Starting CTP engine (%d event loops)", loopCount);
+    dispatchQueue.start();
+    for (int32_t i = 0; i < loopCount; i++) {
+        if (!loops[i]->startLoop()) {
+            LOG.error("%s: cannot start event loop %d", __FUNCTION__, i);
+            running = true;
+            stop();
+            return false;
+        }
+    }
+    running = true;
+    return true;
+}
+
+void CTPEngine::stop() {
+
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    LOG.debug("Stopping CTP engine");
+    for (int32_t i = 0; i < loopCount; i++) {
+        if (loops[i]->running()) {
+            loops[i]->softTerminate();
+            loops[i]->wait();
+        }
+    }
+    dispatchQueue.softTerminate();
+    dispatchQueue.wait();
+}
+
+bool CTPEngine::addSession(CTPSession* session) {
+
+    if (!session) {
+        return false;
+    }
+
+    // Pick the least loaded loop
+    CTPEventLoop* loop = loops[0];
+    int32_t minCount = loop->getSessionCount();
+    for (int32_t i = 1; i < loopCount; i++) {
+        int32_t count = loops[i]->getSessionCount();
+        if (count < minCount) {
+            loop     = loops[i];
+            minCount = count;
+        }
+    }
+    loop->addSession(session);
+    return true;
+}
+
+bool CTPEngine::removeSession(CTPSession* session) {
+
+    for (int32_t i = 0; i < loopCount; i++) {
+        if (loops[i]->removeSession(session)) {
+            dispatchQueue.cancel(session->getPushListener());
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t CTPEngine::getSessionCount() {
+
+    int32_t count = 0;
+    for (int32_t i = 0; i < loopCount; i++) {
+        count += loops[i]->getSessionCount();
+    }
+    return count;
+}
+
+FThread* CTPEngine::getLoop(int32_t index) {
+
+    if (index < 0 || index >= loopCount) {
+        return NULL;
+    }
+    return loops[index];
+}
+
+int64_t CTPEngine::now() {
+    return TimerWheel::now();
+}
+
+void CTPEngine::onSyncNotification(CTPSession& session, const ArrayList& serverURIList) {
+    dispatchQueue.postNotification(session.getPushListener(), serverURIList);
+}
+
+void CTPEngine::onCTPError(CTPSession& session, const int errorCode, const int additionalInfo) {
+    dispatchQueue.postError(session.getPushListener(), errorCode, additionalInfo);
+}
+
+} // end namespace Funambol
@@ -323,6 +323,7 @@ void CSymbianTransportAgent::ConnectL()
 char* CSymbianTransportAgent::sendMessage(const char* msg)
 {
     //LOG.debug("entering CSymbianTransportAgent::sendMessage"); 
+    responseSize = 0;
     
     // Check if user aborted current sync.
     if (getLastErrorCode() == KErrCancel) {
@@ -458,6 +459,7 @@ char* CSymbianTransportAgent::sendMessage(const char* msg)
             response = new char[length+1];
             Mem::Copy(response, iResponseBody->Ptr(), length);
             response[length] = '\0';
+            responseSize = length;
         
             LOG.debug("Message received:");
             LOG.debug("%s", response);
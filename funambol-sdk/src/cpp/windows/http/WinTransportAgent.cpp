@@ -821,6 +821,7 @@ char* WinTransportAgent::sendMessage(const char* msg, const unsigned int content
             delete [] response;
             response = (char*)uncompr;
             response[uncompressedContentLenght] = 0;
+            responseSize = uncomprLen;
         }
         else if (err < 0) {
             // Save the msg to file, for debugging...
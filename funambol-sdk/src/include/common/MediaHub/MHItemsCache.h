@@ -0,0 +1,153 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef __MH_ITEMS_CACHE_H__
+#define __MH_ITEMS_CACHE_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "pthread.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+class MHItemsStore;
+class MHSyncItemInfo;
+
+/// Number of independently locked partitions of the MHItemsCache
+#define MH_ITEMS_CACHE_SHARDS       16
+
+
+/**
+ * In-memory cache of the MHItemsStore entries, used by the store to serve
+ * the lookups by id, guid and local item path without querying the db.
+ *
+ * The entries are partitioned in MH_ITEMS_CACHE_SHARDS shards (by id for
+ * the entries, by key hash for the guid/path indexes), each one with its
+ * own mutex and LRU list, so that concurrent readers rarely contend.
+ * The cache holds its own copies: get methods return new allocated copies
+ * (made by the store, so the concrete entry type is kept) that the caller
+ * must delete, as for the entries read from the db.
+ *
+ * The store must invalidate an entry whenever its row changes. To avoid
+ * caching a row read before a concurrent invalidation, the readers get the
+ * generation before querying the db and pass it to put(): the entry is
+ * discarded if any invalidation happened in between.
+ */
+class MHItemsCache
+{
+private:
+    
+    struct Node {
+        MHSyncItemInfo* item;
+        std::list<unsigned long>::iterator lruPos;
+    };
+    
+    struct Shard {
+        pthread_mutex_t mutex;
+        std::map<unsigned long, Node> items;
+        std::list<unsigned long> lru;                    // most recently used first
+        std::map<std::string, unsigned long> guidIndex;  // guid -> id
+        std::map<std::string, unsigned long> pathIndex;  // local item path -> id
+    };
+    
+    const MHItemsStore& store;
+    size_t maxEntriesPerShard;
+    
+    Shard shards[MH_ITEMS_CACHE_SHARDS];
+    
+    pthread_mutex_t generation_mutex;
+    unsigned long generation;
+    
+    Shard& idShard(unsigned long id) { return shards[id % MH_ITEMS_CACHE_SHARDS]; }
+    Shard& keyShard(const std::string& key);
+    
+    /// Returns a copy of the entry, if cached and if its key field (if any) matches the value.
+    MHSyncItemInfo* getCopy(unsigned long id, const char* guid, const char* path);
+    
+    unsigned long lookupIndex(bool guidIndex, const char* key);
+    void addIndex(bool guidIndex, const std::string& key, unsigned long id);
+    void removeIndex(bool guidIndex, const std::string& key, unsigned long id);
+    
+    /// Removes the node from the shard: the item is returned (not deleted).
+    MHSyncItemInfo* unlink(Shard& shard, std::map<unsigned long, Node>::iterator it);
+    
+    /// Deletes the items and drops their guid/path index entries (shard locks not held).
+    void release(std::vector<MHSyncItemInfo*>& items);
+    
+    void bumpGeneration();
+    
+public:
+    
+    /**
+     * @param store       the store owning this cache, used to copy the entries
+     * @param maxEntries  max number of cached entries
+     */
+    MHItemsCache(const MHItemsStore& store, size_t maxEntries);
+    ~MHItemsCache();
+    
+    /// Returns a new allocated copy of the entry with the given id, NULL if not cached.
+    MHSyncItemInfo* getById(unsigned long id);
+    
+    /// Returns a new allocated copy of the entry with the given guid, NULL if not cached.
+    MHSyncItemInfo* getByGuid(const char* guid);
+    
+    /// Returns a new allocated copy of the entry with the given local item path, NULL if not cached.
+    MHSyncItemInfo* getByLocalPath(const char* localPath);
+    
+    /// Returns the generation to be passed to put() for entries read from now on.
+    unsigned long getGeneration();
+    
+    /**
+     * Caches a copy of the given entry, read from the db when the cache was
+     * at the given generation. The least recently used entries are dropped
+     * if the shard is full.
+     */
+    void put(MHSyncItemInfo* item, unsigned long readGeneration);
+    
+    /// Drops the entry with the given id (the row has changed or has been removed).
+    void invalidate(unsigned long id);
+    
+    /// Drops all the entries.
+    void invalidateAll();
+};
+
+END_FUNAMBOL_NAMESPACE
+
+#endif
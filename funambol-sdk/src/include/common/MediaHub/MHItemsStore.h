@@ -47,6 +47,7 @@
 BEGIN_FUNAMBOL_NAMESPACE
 
 class MHSyncItemInfo;
+class MHItemsCache;
 
 typedef enum ColumnType {
     TEXT,
@@ -101,6 +102,7 @@ protected:
     static const char* select_entry_id_stmt_fmt;
     static const char* delete_row_id_stmt_fmt;
     static const char* select_count_with_status;
+    static const char* update_local_file_stmt_fmt;
     
     static ColumnDescriptor basicColumns1[];
     static ColumnDescriptor basicColumns2[];
@@ -118,6 +120,9 @@ protected:
     
     MHItemsStoreListener* listener;
     
+    /// In-memory cache of the entries (NULL if disabled)
+    MHItemsCache* itemsCache;
+    
     virtual void initializeColumns();
     virtual bool initializeTable();
     virtual void initializeStaticQueries(); 
@@ -223,11 +228,46 @@ public:
         this->listener = listener;
     }
     
+    /**
+     * Enables the in-memory cache of the entries: the lookups by id, guid
+     * and local item path are served from memory when possible, and the
+     * entries read from the db are cached. The entries are invalidated when
+     * updated or removed through this store.
+     * Must be called before the store is shared among threads.
+     *
+     * @param maxEntries  max number of cached entries, 0 to disable the cache
+     */
+    void setEntriesCacheSize(size_t maxEntries);
+    
+    /// Returns a new allocated copy of the given entry, of the same type created by readEntry().
+    MHSyncItemInfo* copyEntry(MHSyncItemInfo* item) const;
+    
     virtual bool AddEntry(MHStoreEntry* entry);
     virtual bool addEntries(std::vector<MHStoreEntry*>& entries);
     virtual bool UpdateEntry(MHStoreEntry* entry);
     virtual bool updateEntries(std::vector<MHStoreEntry*>& entries);
+    
+    /**
+     * Adds and updates the items in a single transaction (see MHStore::storeEntries()).
+     * The IDs of the added items are set; the listener is notified only if
+     * the items have been written.
+     */
+    virtual bool storeEntries(std::vector<MHStoreEntry*>& newEntries, std::vector<MHStoreEntry*>& updatedEntries);
+    
     bool RemoveEntry(MHStoreEntry* entry);
+    virtual bool removeAllEntries();
+    
+    /**
+     * Sets a local path and etag pair (i.e. local_thumb_path/local_thumb_etag)
+     * on many items in a single transaction, without rewriting the whole rows.
+     * The listener is not notified.
+     *
+     * @param updates        item id -> (path, etag); empty values clear the fields
+     * @param pathFieldName  the path column (i.e. local_thumb_path_field_name)
+     * @param etagFieldName  the etag column (i.e. local_thumb_etag)
+     */
+    bool updateLocalFileFields(const std::map<unsigned long, std::pair<std::string, std::string> >& updates,
+                               const char* pathFieldName, const char* etagFieldName);
     
     /**
      * Returns all cache entries in the given list, ordered by a given parameter.
@@ -258,9 +298,7 @@ public:
     MHStoreEntry* getEntry(const unsigned long itemID) const;
     
     /// Returns a new allocated MHStoreEntry* (a MHSyncItemInfo*) given a custom field, NULL if not found.
-    virtual MHStoreEntry* getEntry(const char* fieldName, const char* fieldValue) const {
-        return MHStore::getEntry(fieldName, fieldValue);
-    }
+    virtual MHStoreEntry* getEntry(const char* fieldName, const char* fieldValue) const;
     
     int getCountOfItemsWithStatus(int status);
     
@@ -87,21 +87,22 @@ class MHMediaJsonParser
         bool parseExternalServicesListObject(const char* externalServicesJson, CacheItemsList&  externalServicesList, ESMPStatus* errCode); 
         bool parseExternalServicesAlbumListObject(const char* externalServicesAlbumJson, CacheItemsList&  albumList, const char* serviceName, ESMPStatus* errCode); 
     
-        bool formatProfilePropertyKeyJson(const char *propertyKey, char **propertyKeyJson);
-        bool formatProfilePropertyJson(const char *propertyKey, const char *propertyValue, char **propertyJson);
+        // formatters append the JSON document to the given output buffer
+        bool formatProfilePropertyKeyJson(const char *propertyKey, StringBuffer& propertyKeyJson);
+        bool formatProfilePropertyJson(const char *propertyKey, const char *propertyValue, StringBuffer& propertyJson);
     
-        bool formatUserProfileJson(SapiUserProfile& userProfile, char **userProfileJson);
-        bool formatItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, bool prettyPrint=false);
-        bool formatMediaItemMetaData(MHSyncItemInfo* itemInfo, char** itemJsonMetaData, bool metaDataOnlyUpdate, bool prettyPrint=false);
-        bool formatJsonExportedItem(std::vector<ExportedItem*>& exportedItem, char** exportedItemJson, bool prettyPrint=false);
-        bool formatMediaSetItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, 
+        bool formatUserProfileJson(SapiUserProfile& userProfile, StringBuffer& userProfileJson);
+        bool formatItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, bool prettyPrint=false);
+        bool formatMediaItemMetaData(MHSyncItemInfo* itemInfo, StringBuffer& itemJsonMetaData, bool metaDataOnlyUpdate, bool prettyPrint=false);
+        bool formatJsonExportedItem(std::vector<ExportedItem*>& exportedItem, StringBuffer& exportedItemJson, bool prettyPrint=false);
+        bool formatMediaSetItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, 
                                            const char* itemDescription, const char* sourceName, bool prettyPrint=false);
     
-        bool formatSaveSubscriptionObject(const char * itemsID, char **itemsListJsonObject, bool prettyPrint);
+        bool formatSaveSubscriptionObject(const char * itemsID, StringBuffer& itemsListJsonObject, bool prettyPrint);
     
-        bool formatStatusReport(SapiStatusReport* statusReport, char** statusReportJson);
+        bool formatStatusReport(SapiStatusReport* statusReport, StringBuffer& statusReportJson);
     
-        bool formatPushDeviceToken(const char* deviceToken, char** deviceTokenJson);
+        bool formatPushDeviceToken(const char* deviceToken, StringBuffer& deviceTokenJson);
         
         bool parseMediaSetResponse(const char* responseBody, StringBuffer& mediaSetSuccess, 
                                    long* mediaSetId,         StringBuffer& mediaSetUrl,
@@ -117,7 +118,7 @@ class MHMediaJsonParser
         bool parseJsonUserProfileObject(const char* jsonResponse, SapiUserProfile& userProfile, ESMPStatus* errCode);
         bool parseServerInfoJson(const char* jsonResponse, ServerInfo& serverLoginInfo, ESMPStatus* errCode);
 
-        bool formatDelItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, 
+        bool formatDelItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, 
                                       const char* sourceName, bool prettyPrint);
     
         bool checkErrorMessages(const char* response, time_t* lastUpdate = NULL);
@@ -173,11 +173,38 @@ class MHMediaRequestManager
         const char* credInfo;
     
         
+        /**
+         * Immutable view of the SAPI session, shared by all the request threads.
+         * Any change (login, validation key reset) publishes a new snapshot with
+         * a higher version: requests keep using the snapshot they acquired.
+         */
+        struct SessionSnapshot {
+            StringBuffer sessionID;
+            StringBuffer validationKey;
+            time_t expirationTime;          // when the session ID expires
+            unsigned long version;
+            int refCount;                   // guarded by sessionIDAccessMutex
+        };
+        
         /* The session ID is unique for all instances, because there is a single session kept open
-           with the server
+           with the server.
+           The mutex guards the current snapshot pointer and the login state: it is held only to
+           swap/reference the snapshot, never during a request or a login. Reads take it too:
+           taking a reference to a shared, reference counted snapshot is not a single atomic
+           operation (the snapshot could be freed between loading the pointer and counting
+           the reference), and the lock is held just for the count update.
          */
         static pthread_mutex_t sessionIDAccessMutex;
+        static pthread_cond_t  loginCompleted;
         static bool sessionIDAccessMutexInitialized;
+        static SessionSnapshot* currentSession;
+        static unsigned long sessionVersion;
+        static bool loginInProgress;
+        static EMHMediaRequestStatus lastLoginStatus;
+        
+        /* Session ID and validation key as set by the login() implementations: they are
+           written only by the thread performing the login (see singleFlightLogin)
+         */
         static StringBuffer sessionID;
         static StringBuffer validationKey;
 
@@ -312,10 +339,10 @@ class MHMediaRequestManager
         /**
          * Returns the session ID stored during the first login call.
          */
-        StringBuffer getSessionID() { return sessionID; }
+        StringBuffer getSessionID();
     
         // Resets the session ID (HTTP cookie)
-        static void resetSessionID() { sessionID.reset(); }
+        static void resetSessionID();
         
     protected:
 
@@ -323,6 +350,47 @@ class MHMediaRequestManager
          * Sets the JSESSIONID header to the http request.
          */
         void setRequestSessionId();
+        
+        /// Sets the JSESSIONID header of the given session, if usable.
+        void setRequestSessionId(const SessionSnapshot* session);
+        
+        /**
+         * Returns the current session snapshot, loading it from the config at
+         * the first call. Must be released with releaseSession().
+         */
+        SessionSnapshot* acquireSession();
+        static void releaseSession(SessionSnapshot* session);
+        
+        /**
+         * Publishes a new session snapshot replacing the current one.
+         * Must be called with the sessionIDAccessMutex held.
+         */
+        static void publishSession(const char* sessionId, const char* key, time_t expirationTime);
+        
+        /**
+         * Saves the session in the config and publishes it as the current snapshot,
+         * so that the next requests use it. Called by the login() and logout()
+         * implementations.
+         *
+         * @param sessionId  the new session ID, empty to close the session (logout)
+         * @param key        the new validation key, NULL to keep the one in config
+         */
+        void saveSession(const char* sessionId, const char* key);
+        
+        /// False if the session is empty, expired or lacks a required validation key.
+        static bool isSessionUsable(const SessionSnapshot* session);
+        
+        /**
+         * Performs the login, making sure only one thread at a time logs in.
+         * Threads asking for a login while another one is in progress wait
+         * for it and share its result, instead of logging in again.
+         *
+         * @param failedVersion  the version of the session rejected by the server:
+         *                       no login is done if a newer usable session has been
+         *                       published meanwhile. 0 to always login.
+         * @param serverTime     [OUT] optional, the server time returned by login
+         */
+        EMHMediaRequestStatus singleFlightLogin(unsigned long failedVersion, time_t* serverTime = NULL);
 
         /**
          * Sets the request authentication header depends on the type of authentication
@@ -346,18 +414,21 @@ class MHMediaRequestManager
          * @return                    true if the URL returned contains the validation key, false if not
          */
         bool addValidationKey(URL& url, const bool logOriginalRequest = false);
+        
+        /// As above, using the validation key of the given session.
+        bool addValidationKey(URL& url, const SessionSnapshot* session, const bool logOriginalRequest);
 
         /// Resets the validation key, usually in case of SAPI error SEC-1003 (invalid validation key).
         void resetValidationKey();
 
         int performRequest(const URL& url, HttpConnection::RequestMethod method,
-                           char* body, OutputStream& response, bool logRequest=true, bool useAuthentication = true);
+                           const char* body, OutputStream& response, bool logRequest=true, bool useAuthentication = true);
                            
         int performRequest(const URL& url, HttpConnection::RequestMethod method,
                            InputStream& body, OutputStream& response, bool logRequest=true, bool useAuthentication = true);
     
         int performRequest(const URL& url, HttpConnection::RequestMethod method,
-                           char* body, InputStream* bodyStream,
+                           const char* body, InputStream* bodyStream,
                            OutputStream& response, bool logRequest, bool useAuthentication);
     
         EMHMediaRequestStatus handleHttpError(int httpCode);
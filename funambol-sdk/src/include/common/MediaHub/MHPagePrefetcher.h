@@ -0,0 +1,160 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef __MH_PAGE_PREFETCHER_H__
+#define __MH_PAGE_PREFETCHER_H__
+
+/** @cond DEV */
+
+#include <deque>
+#include <pthread.h>
+
+#include "base/globalsdef.h"
+#include "push/FThread.h"
+#include "spds/AbstractSyncConfig.h"
+#include "MediaHub/MHStore.h"
+#include "MediaHub/MHMediaRequestManager.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+/**
+ * A page of items metadata downloaded by the MHPagePrefetcher, as
+ * returned by MHMediaRequestManager::getAllItems().
+ * The items and labels are owned by the page.
+ */
+class MHFetchedPage {
+
+public:
+
+    MHFetchedPage(int offset_) : offset(offset_), status(ESMRSuccess), itemsReceived(0),
+                                 responseTime(0), receivedTime(0) {}
+
+    /// The offset of the first item of this page on the server.
+    int offset;
+
+    /// The result of the getAllItems call (after retries).
+    EMHMediaRequestStatus status;
+
+    /// Number of items returned by the server (before any filtering).
+    int itemsReceived;
+
+    /// The server time, returned in the getAllItems response.
+    time_t responseTime;
+
+    /// The client time when the response has been received.
+    time_t receivedTime;
+
+    CacheItemsList items;
+    CacheLabelsMap labels;
+};
+
+
+/**
+ * Downloads the pages of a MH "getAll" request in a separate thread, so
+ * that the next pages are already in flight while the MHSyncManager is
+ * filtering and storing the previous one.
+ * At most 'maxPagesInFlight' pages are fetched ahead of the consumer.
+ * Network errors are retried like MHSyncManager::retryGetAllItems().
+ *
+ * The prefetcher uses its own MHMediaRequestManager (and so its own
+ * HttpConnection), which is owned and deleted by this object.
+ */
+class MHPagePrefetcher : public FThread {
+
+public:
+
+    /**
+     * @param requestManager    the request manager used to get the pages (ownership transferred)
+     * @param config            the configuration, used for retries and abort
+     * @param limit             the number of items of each page
+     * @param maxPagesInFlight  max number of pages downloaded and not yet consumed
+     */
+    MHPagePrefetcher(MHMediaRequestManager* requestManager, AbstractSyncConfig& config,
+                     int limit, int maxPagesInFlight);
+
+    ~MHPagePrefetcher();
+
+    /**
+     * Returns the next page, waiting for it to be downloaded if needed.
+     * The returned page must be deleted by the caller.
+     * Returns NULL if there are no more pages (the last page has been consumed,
+     * or the prefetcher has been stopped).
+     */
+    MHFetchedPage* nextPage();
+
+    /**
+     * Asks the thread to stop and waits for its termination.
+     * Pages not yet consumed are released.
+     */
+    void stop();
+
+    void softTerminate();
+
+protected:
+
+    void run();
+
+private:
+
+    /// Gets the given page from the server, retrying in case of network error.
+    void fetchPage(MHFetchedPage* page);
+
+    /**
+     * Waits 'msec' before a retry. The wait is interrupted by stop() and
+     * by the abort of the sync.
+     * @return false if the wait has been interrupted
+     */
+    bool waitBeforeRetry(long msec);
+
+    MHMediaRequestManager* requestManager;
+    AbstractSyncConfig& config;
+
+    int limit;
+    int maxPagesInFlight;
+
+    /// Downloaded pages, not yet consumed.
+    std::deque<MHFetchedPage*> pages;
+
+    /// True when the thread will not produce any other page.
+    bool completed;
+
+    pthread_mutex_t pagesMutex;
+    pthread_cond_t  pagesCond;
+};
+
+END_FUNAMBOL_NAMESPACE
+
+/** @endcond */
+#endif
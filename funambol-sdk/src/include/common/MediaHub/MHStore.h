@@ -144,6 +144,26 @@ protected:
     /// Queries effectively the db to get the number of entries.
     long get_count();
     
+    /// Inserts the entries and appends their IDs (-1 on error). No mutex, no transaction.
+    bool insert_entries(std::vector<MHStoreEntry*>& entries, std::vector<uint64_t>& entriesId);
+    
+    /// Updates the entries. No mutex, no transaction.
+    bool update_entries(std::vector<MHStoreEntry*>& entries);
+    
+    /**
+     * Begins a transaction for a bulk operation, if no transaction is
+     * already open on the db. Must be called with the store_access_mutex held.
+     * @return true if the transaction has been opened here, and must be
+     *         committed by endBulkTransaction()
+     */
+    bool beginBulkTransaction();
+    
+    /**
+     * Commits the transaction opened by beginBulkTransaction(), if ownTransaction.
+     * If the commit fails the transaction is rolled back.
+     */
+    void endBulkTransaction(bool ownTransaction);
+    
 
     /**
      * Returns new allocated MHStoreEntry from a a sqlite statement object
@@ -179,6 +199,18 @@ public:
     
     virtual MHStoreEntry* getEntry(const char* fieldName, const char* fieldValue) const;
     
+    /**
+     * Adds and updates the given entries in a single transaction: either
+     * all of them are written, or none (the transaction is rolled back).
+     * The store is locked until the transaction is closed.
+     * @param newEntries      the entries to add
+     * @param newEntriesId    [out] the IDs of the added entries, -1 if not added
+     * @param updatedEntries  the entries to update
+     * @return true if all the entries have been written
+     */
+    virtual bool storeEntries(std::vector<MHStoreEntry*>& newEntries, std::vector<uint64_t>& newEntriesId,
+                              std::vector<MHStoreEntry*>& updatedEntries);
+    
     /**
      * Returns the number >0 of entries in the database, -1 in case of error.
      * Uses a buffered value (cache_items_count)
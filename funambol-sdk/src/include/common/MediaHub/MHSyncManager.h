@@ -41,6 +41,8 @@
 /** @{ */
 
 #include <vector>
+#include <set>
+#include <string>
 
 #include "base/globalsdef.h"
 #include "base/util/ArrayList.h"
@@ -60,6 +62,13 @@ BEGIN_FUNAMBOL_NAMESPACE
 /// Max number of items metadata to retrieve for each MH "get IDs" call.
 #define MH_PAGING_LIMIT_IDS   50
 
+/**
+ * Max number of "getAll" pages downloaded in advance, while the current one
+ * is stored in the cache. Set to 0 to request each page only after the
+ * previous one has been stored.
+ */
+#define MH_PREFETCH_PAGES     2
+
 
 /**
  * Enumeration of possible error codes for MHSyncManager.
@@ -156,6 +165,25 @@ protected:
     
     int filterIncomingItems(CacheItemsList* serverItems);
     
+    /**
+     * Filters a page of items metadata received by the Server, and adds/updates
+     * them in the cache, in a single transaction.
+     * Called by getAllServerMetadata() for each page.
+     *
+     * @param itemsList       the items received from the Server
+     * @param labelsMap       the labels of the received items
+     * @param availableGuids  [IN-OUT] the GUIDs of the items already in cache
+     * @return                0 if no error
+     */
+    int storeServerItemsPage(CacheItemsList& itemsList, CacheLabelsMap& labelsMap,
+                             std::set<std::string>& availableGuids);
+    
+    /**
+     * Creates a new MHMediaRequestManager for the source under sync,
+     * with the http params read from the config.
+     */
+    MHMediaRequestManager* createMediaRequestManager();
+    
     int performTwinDetection(int syncRes);
 
     
@@ -400,6 +400,14 @@ public:
     
     virtual bool updateItemsInCache(std::vector<MHOperationDescriptor*>& operations);
     
+    /**
+     * Adds and updates the items of a page into MH local store, all in one
+     * transaction: if a write fails, none of the items is stored.
+     * The labels are handled after the items are stored.
+     */
+    virtual bool storeItemsInCache(std::vector<MHOperationDescriptor*>& addOperations,
+                                   std::vector<MHOperationDescriptor*>& updOperations);
+    
     /**
      * Removes an item from MH local store. Returns true if item found and succesfully removed
      */
@@ -0,0 +1,242 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef __MH_THUMBNAIL_CACHE_H__
+#define __MH_THUMBNAIL_CACHE_H__
+
+#include <map>
+#include <string>
+
+#include "base/globalsdef.h"
+#include "base/util/StringBuffer.h"
+#include "MediaHub/MHStore.h"
+#include "MediaHub/MHStoreEntry.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+class MHItemsStore;
+class MHSyncItemInfo;
+
+/// Default disk budget for thumbnails and previews (bytes)
+#define MH_THUMBNAIL_CACHE_DEFAULT_MAX_SIZE     (50 * 1024 * 1024)
+
+/// Number of pending access timestamps / item updates written in a single transaction
+#define MH_THUMBNAIL_CACHE_UPDATES_BATCH        64
+
+/// Number of LRU entries fetched at once when evicting
+#define MH_THUMBNAIL_CACHE_EVICTION_BATCH       32
+
+typedef enum EMHThumbnailKind {
+    MHThumbnailKindThumb = 0,       // small thumbnail (remote thumb url)
+    MHThumbnailKindPreview = 1      // large preview (remote preview url)
+} EMHThumbnailKind;
+
+
+/**
+ * A file held by the MHThumbnailCache: the thumbnail or the preview
+ * of one MHItemsStore item.
+ */
+class MHThumbnailCacheEntry : public MHStoreEntry
+{
+private:
+    unsigned long itemId;
+    EMHThumbnailKind kind;
+    StringBuffer path;
+    int64_t size;
+    std::string etag;
+    time_t lastAccess;
+    
+public:
+    MHThumbnailCacheEntry(unsigned long itemId_, EMHThumbnailKind kind_, const char* path_,
+                          int64_t size_, const char* etag_, time_t lastAccess_) :
+                          itemId(itemId_), kind(kind_), path(path_), size(size_),
+                          etag(etag_ ? etag_ : ""), lastAccess(lastAccess_) {}
+    
+    unsigned long getItemId() const     { return itemId;     }
+    EMHThumbnailKind getKind() const    { return kind;       }
+    const StringBuffer& getPath() const { return path;       }
+    int64_t getSize() const             { return size;       }
+    const std::string& getETag() const  { return etag;       }
+    time_t getLastAccess() const        { return lastAccess; }
+};
+
+
+/**
+ * Disk cache for the MediaHub thumbnails and previews, bounded by a byte
+ * budget. The files are indexed in a sqlite table (item id, kind, path,
+ * size, etag, last access time):
+ *  - getFile() returns the local copy only if its etag still matches the
+ *    remote one of the item, otherwise the stale file is dropped and the
+ *    caller must download it again (to the path returned by getFilePath())
+ *  - addFile() registers a downloaded file and evicts the least recently
+ *    used files until the cache fits the budget
+ *  - access times and the local path/etag of the items in the MHItemsStore
+ *    are buffered in memory and written in batches (see flush())
+ */
+class MHThumbnailCache : public MHStore
+{
+private:
+    
+    static const char* create_table_stmt_fmt;
+    static const char* create_index_stmt_fmt;
+    static const char* insert_row_stmt_fmt;
+    static const char* select_entry_stmt_fmt;
+    static const char* select_lru_stmt_fmt;
+    static const char* select_total_size_stmt_fmt;
+    static const char* delete_entry_stmt_fmt;
+    static const char* update_access_stmt_fmt;
+    
+    StringBuffer cacheDir;
+    int64_t maxSize;
+    int64_t currentSize;
+    
+    /// Not owned: the items whose local thumb/preview fields are kept in sync (can be NULL)
+    MHItemsStore* itemsStore;
+    
+    /// Access times not yet written to the db, keyed by entryKey()
+    std::map<uint64_t, time_t> pendingAccess;
+    
+    /// Local path and etag to be set on the items, by kind and item id
+    std::map<unsigned long, std::pair<std::string, std::string> > pendingItemUpdates[2];
+    
+    pthread_mutex_t cache_mutex;
+    
+    bool initializeTable();
+    void initializeStaticQueries();
+    
+    static uint64_t entryKey(unsigned long itemId, EMHThumbnailKind kind) {
+        return ((uint64_t)itemId << 1) | (uint64_t)kind;
+    }
+    
+    /// Returns a new allocated entry, NULL if not cached.
+    MHThumbnailCacheEntry* findEntry(unsigned long itemId, EMHThumbnailKind kind);
+    
+    /// Deletes the file and the row of the given entry, and queues the item update.
+    bool dropEntry(MHThumbnailCacheEntry* entry);
+    
+    /// Evicts the least recently used files until the cache size is <= targetSize.
+    bool evict(int64_t targetSize);
+    
+    bool flushAccessTimes();
+    bool flushItemUpdates();
+    void queueItemUpdate(unsigned long itemId, EMHThumbnailKind kind, const char* path, const char* etag);
+    
+    int64_t readTotalSize();
+    
+protected:
+    
+    virtual StringBuffer formatInsertItemStmt(MHStoreEntry* entry);
+    virtual StringBuffer formatUpdateItemStmt(MHStoreEntry* entry);
+    
+    /// Returns new allocated MHStoreEntry (a MHThumbnailCacheEntry*) from a sqlite statement object
+    virtual MHStoreEntry* readEntry(sqlite3_stmt *stmt) const;
+    
+public:
+    
+    static const char* item_id_field_name;
+    static const char* kind_field_name;
+    static const char* path_field_name;
+    static const char* size_field_name;
+    static const char* etag_field_name;
+    static const char* last_access_field_name;
+    
+    /**
+     * @param storeName    the name of the index table
+     * @param storePath    the path of the sqlite db file
+     * @param cacheDir     the directory holding the cached files (created if missing)
+     * @param maxSize      the disk budget, in bytes
+     * @param itemsStore   if not NULL, the local thumb/preview path and etag of
+     *                     its items are updated when files are added or evicted
+     */
+    MHThumbnailCache(const char* storeName, const char* storePath, const char* cacheDir,
+                     int64_t maxSize = MH_THUMBNAIL_CACHE_DEFAULT_MAX_SIZE,
+                     MHItemsStore* itemsStore = NULL);
+    
+    /// Flushes the pending updates.
+    virtual ~MHThumbnailCache();
+    
+    /**
+     * Looks up the local copy of the item thumbnail/preview.
+     * The copy is valid if the file exists and its etag matches the remote
+     * etag of the item (if known); a stale copy is removed from the cache.
+     * On a hit the access time of the file is refreshed.
+     *
+     * @param item       the item
+     * @param kind       thumbnail or preview
+     * @param localPath  [OUT] the full path of the cached file
+     * @return           true on a cache hit
+     */
+    bool getFile(MHSyncItemInfo* item, EMHThumbnailKind kind, StringBuffer& localPath);
+    
+    /// Returns the path where the thumbnail/preview of the item should be downloaded.
+    StringBuffer getFilePath(MHSyncItemInfo* item, EMHThumbnailKind kind) const;
+    
+    /**
+     * Registers a downloaded thumbnail/preview of the item, tagged with the
+     * current remote etag of the item. The local path and etag of the item
+     * are set accordingly. Least recently used files are evicted if the
+     * cache exceeds its budget.
+     *
+     * @param item      the item
+     * @param kind      thumbnail or preview
+     * @param filePath  the full path of the downloaded file (usually getFilePath())
+     * @return          true if the file has been added to the cache
+     */
+    bool addFile(MHSyncItemInfo* item, EMHThumbnailKind kind, const char* filePath);
+    
+    /// Removes the cached thumbnail/preview of the item, deleting the file.
+    bool removeFile(MHSyncItemInfo* item, EMHThumbnailKind kind);
+    
+    /// Removes all the cached files and entries.
+    bool clear();
+    
+    /// Writes the pending access times and item updates.
+    bool flush();
+    
+    /// Sets a new disk budget, evicting files if needed.
+    void setMaxSize(int64_t maxSize);
+    int64_t getMaxSize() const { return maxSize; }
+    
+    /// Returns the bytes currently used by the cached files.
+    int64_t getCurrentSize();
+    
+    // MHStore interface
+    bool RemoveEntry(MHStoreEntry* entry);
+    bool getAllEntries(CacheItemsList& entryList);
+};
+
+END_FUNAMBOL_NAMESPACE
+
+#endif
@@ -82,6 +82,9 @@ class ArrayList {
 
         ArrayList& set (const ArrayList & other);
 
+        // Links the given element at the index-th position
+        int insert(int index, ArrayElement* element);
+
         Element ghost;
 
     protected:
@@ -133,6 +136,25 @@ class ArrayList {
          */
         int add(ArrayList* list);
 
+        /**
+         * Appends the given element without duplicating it: the list takes
+         * the ownership of the element, that must have been allocated with
+         * the C++ new operator and must not be deleted by the caller.
+         *
+         * @param element the element to insert - NOT NULL
+         * @return the position of the element, -1 in case of errors
+         */
+        int adopt(ArrayElement* element);
+
+        /**
+         * Moves all the elements of the given list at the end of this one,
+         * without duplicating them. The given list is left empty.
+         *
+         * @param list the list to empty
+         * @return the number of elements moved, -1 in case of errors
+         */
+        int adopt(ArrayList* list);
+
         /**
          * Frees the list. All elements are freed as well.
          */
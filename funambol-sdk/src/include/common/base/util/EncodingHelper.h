@@ -117,6 +117,21 @@ public:
     * @return a new allocated buffer given the 
     */
     char* encode(const char* from, char* buffer, unsigned long *len);
+
+    /**
+    * Encodes plain data straight into a buffer of the caller, without the
+    * intermediate allocations of encode(). Only the plain and b64 encodings
+    * can be done this way: when an encryption is set, it returns -1 and
+    * the caller must use encode().
+    *
+    * @param dest - where to write the encoded data, terminated by a \0. It
+    *               must hold at least getDataSizeAfterEncoding(len) + 1 bytes
+    * @param src  - the plain data to encode
+    * @param len  - the len of the data inside src
+    *
+    * @return the len of the encoded data in dest, -1 if not possible
+    */
+    long encodeTo(char* dest, const char* src, unsigned long len);
     
     /**
     * Decode the buffer using the encoding and the encryption
@@ -0,0 +1,158 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_JSON_WRITER
+#define INCL_JSON_WRITER
+
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/globalsdef.h"
+#include "base/util/StringBuffer.h"
+
+BEGIN_FUNAMBOL_NAMESPACE
+
+class OutputStream;
+
+/// Size of the internal buffer used to batch small writes to the sink.
+#define JSON_WRITER_BUFFER_SIZE     1024
+
+/// Maximum nesting level of objects/arrays handled by the writer.
+#define JSON_WRITER_MAX_DEPTH       32
+
+/**
+ * Streaming JSON emitter: writes a JSON document straight into a StringBuffer
+ * or an OutputStream, without building an intermediate cJSON tree.
+ * Values are escaped as per RFC 4627; UTF-8 sequences are passed through.
+ *
+ * The key parameter of the add/begin methods names the member when the
+ * current container is an object, and must be NULL for array elements and
+ * for the root value. Output is buffered internally and flushed to the sink
+ * when the root value is closed (or on flush() / destruction).
+ *
+ * Example:
+ * <pre>
+ *   StringBuffer json;
+ *   JsonWriter writer(json);
+ *   writer.beginObject();
+ *   writer.beginArray("ids");
+ *   writer.addInt(NULL, 12);
+ *   writer.endArray();
+ *   writer.endObject();      // json is now {"ids":[12]}
+ * </pre>
+ */
+class JsonWriter {
+
+public:
+
+    /**
+     * Creates a writer appending to the given StringBuffer.
+     * @param out          the destination buffer (not cleared)
+     * @param prettyPrint  if true, emits newlines and tab indentation
+     */
+    JsonWriter(StringBuffer& out, bool prettyPrint = false);
+
+    /**
+     * Creates a writer emitting to the given OutputStream.
+     * @param out          the destination stream
+     * @param prettyPrint  if true, emits newlines and tab indentation
+     */
+    JsonWriter(OutputStream& out, bool prettyPrint = false);
+
+    /// Flushes any pending output.
+    ~JsonWriter();
+
+    JsonWriter& beginObject(const char* key = NULL);
+    JsonWriter& endObject();
+    JsonWriter& beginArray(const char* key = NULL);
+    JsonWriter& endArray();
+
+    /// Adds a string value; a NULL value is written as JSON null.
+    JsonWriter& addString(const char* key, const char* value);
+    JsonWriter& addInt(const char* key, int64_t value);
+    /**
+     * Adds a number with a fixed count of decimals (at most 9), written
+     * with '.' whatever the locale; NaN and infinite values are written
+     * as JSON null.
+     */
+    JsonWriter& addDouble(const char* key, double value, int decimals = 3);
+    JsonWriter& addBool(const char* key, bool value);
+    JsonWriter& addNull(const char* key);
+
+    /**
+     * Writes the buffered data to the sink.
+     * @return false if the sink reported a write error
+     */
+    bool flush();
+
+    /// True if a complete root value has been written and no error occurred.
+    bool isComplete() const { return (written && depth == 0 && !error); }
+
+    /// True on nesting overflow/underflow or sink write errors.
+    bool hasError() const { return error; }
+
+private:
+
+    StringBuffer* outBuffer;
+    OutputStream* outStream;
+    bool pretty;
+
+    char buffer[JSON_WRITER_BUFFER_SIZE];
+    size_t bufferLen;
+
+    /// first[i] is true until the container at level i gets its first element
+    bool first[JSON_WRITER_MAX_DEPTH];
+    int depth;
+    bool written;
+    bool error;
+
+    void init(bool prettyPrint);
+
+    void writeRaw(const char* data, size_t len);
+    void writeChar(char c);
+    void writeEscaped(const char* value);
+    void writeIndent();
+
+    /// Emits separator, indentation and key before a value.
+    void beginValue(const char* key);
+
+    JsonWriter& open(const char* key, char bracket);
+    JsonWriter& close(char bracket);
+};
+
+END_FUNAMBOL_NAMESPACE
+
+/** @endcond */
+#endif
@@ -107,6 +107,22 @@ public:
      */
     virtual Enumeration& getProperties() = 0;
 
+    /**
+     * Starts a group of changes that belong together, e.g. the item
+     * statuses of a whole message. Implementations backed by a storage can
+     * apply them in one go (a transaction, a single journal write...) when
+     * endBatch() is called. Batches can't be nested.
+     * By default every change is applied as soon as it is done.
+     */
+    virtual void beginBatch() {}
+
+    /**
+     * Ends the group of changes started with beginBatch().
+     *
+     * @return 0 on success, an error code otherwise
+     */
+    virtual int endBatch() { return 0; }
+
     /**
      * Ensure that all properties are stored persistently.
      * If setting a property led to an error earlier, this
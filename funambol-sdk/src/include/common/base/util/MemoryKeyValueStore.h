@@ -39,6 +39,9 @@
 /** @addtogroup Client */
 /** @{ */
 
+#include <map>
+#include <string>
+
 #include "base/fscapi.h"
 #include "base/util/KeyValuePair.h"
 #include "base/util/KeyValueStore.h"
@@ -62,9 +65,20 @@ protected:
     */
     ArrayListEnumeration data; 
 
+private:
+
+    /**
+    * Index of the pairs in data by key. It's built only for a batch of
+    * changes (see beginBatch()), so that each change doesn't have to scan
+    * the whole list.
+    */
+    std::map<std::string, KeyValuePair*>* batchIndex;
+
 public:
+    MemoryKeyValueStore() : batchIndex(NULL) {}
+
     // Destructor
-    virtual ~MemoryKeyValueStore() {}      
+    virtual ~MemoryKeyValueStore() { delete batchIndex; }
           
     /**
     *  Read a property value from the data ArrayList
@@ -89,6 +103,16 @@ public:
     
     virtual int removeAllProperties();
 
+    /**
+     * Indexes the data by key until endBatch() is called.
+     */
+    virtual void beginBatch();
+
+    /**
+     * Drops the index built by beginBatch().
+     */
+    virtual int endBatch();
+
     /**
      * Read all the properties that are in the store. This is
      * an enumeration of KeyValuePairs. 
@@ -77,6 +77,19 @@ private:
     * Note that the ArrayList in memory is filled in the same order the properties are read from the journal file.
     */
     StringBuffer nodeJour;
+
+    /**
+    * The journal file kept open during a batch of changes (see beginBatch()),
+    * NULL otherwise: every change is appended with a fopen/fclose of its own.
+    */
+    FILE* journal;
+
+    /**
+    * Appends a property/value to the journal.
+    *
+    * @return 0 on success, -1 if the journal can't be written
+    */
+    int writeJournal(const char* prop, const char* value);
     
      /**
      * Extract all currently properties in the node looking also at the journal file if exists.
@@ -89,13 +102,13 @@ public:
     /**      
      * The name of the general node 
      */
-    PropertyFile(const char* n) : node(n) {
+    PropertyFile(const char* n) : node(n), journal(NULL) {
         nodeJour = node + ".jour";
         read();
     }
 
     // Destructor
-    ~PropertyFile() {}               
+    ~PropertyFile() { endBatch(); }               
 
     /**
      * Store the current properties that are
@@ -120,9 +133,23 @@ public:
     int removeProperty(const char* prop);
 
     /**
-    * It remove all the properties in memory and in the storage
+    * It remove all the properties in memory and in the storage,
+    * the journal included
     */
     int removeAllProperties();
+
+    /**
+    * Opens the journal once for all the next changes, until endBatch().
+    */
+    void beginBatch();
+
+    /**
+    * Closes the journal opened by beginBatch(), so all the changes of the
+    * batch are written at once.
+    *
+    * @return 0 on success, -1 if the journal could not be written
+    */
+    int endBatch();
    
     /**
     * It sepatares from the line read from the property file the key and value.
@@ -166,6 +166,17 @@ char *mkTempFileName(const char *name);
 bool saveFile(const char *filename, const char *buffer, size_t len,
               bool binary = false );
 
+/**
+ * Compresses the file 'source' into the gzip file 'dest'.
+ * Available only if the library is built with USE_ZLIB. Nothing is
+ * logged, so it can be used by the logging code itself.
+ *
+ * @param source  the file to compress
+ * @param dest    the gzip file to create (overwritten if exists)
+ * @return        true if the file has been compressed
+ */
+bool gzipFile(const char* source, const char* dest);
+
 /**
  * Just mapped to stdio rename().
  * On Windows platform, using the _wrename() in order to correctly
@@ -346,6 +357,58 @@ inline const char *_wcc(const WCHAR *wc, const char *enc=0) {
     return encodeBuf;
 }
 
+/**
+ * A WCHAR string seen as a char string, for the time the object lives.
+ * Where WCHAR is char (WCHAR_IS_CHAR) it's the string itself, otherwise
+ * it's converted with toMultibyte().
+ */
+class WCharAsChar {
+public:
+    explicit WCharAsChar(const WCHAR* wc)
+#ifdef WCHAR_IS_CHAR
+        : converted(NULL), str(wc) {}
+#else
+        : converted(wc ? toMultibyte(wc) : NULL), str(converted) {}
+#endif
+    ~WCharAsChar() { delete [] converted; }
+
+    const char* c_str() const { return str; }
+    operator const char*() const { return str; }
+
+private:
+    char* converted;
+    const char* str;
+
+    WCharAsChar(const WCharAsChar&);
+    WCharAsChar& operator=(const WCharAsChar&);
+};
+
+/**
+ * A char string seen as a WCHAR string, for the time the object lives.
+ * Where WCHAR is char (WCHAR_IS_CHAR) it's the string itself, otherwise
+ * it's converted with toWideChar().
+ */
+class CharAsWChar {
+public:
+    explicit CharAsWChar(const char* mb)
+#ifdef WCHAR_IS_CHAR
+        : converted(NULL), str(mb) {}
+#else
+        : converted(mb ? toWideChar(mb) : NULL), str(converted) {}
+#endif
+    ~CharAsWChar() { delete [] converted; }
+
+    const WCHAR* c_str() const { return str; }
+    operator const WCHAR*() const { return str; }
+
+private:
+    WCHAR* converted;
+    const WCHAR* str;
+
+    CharAsWChar(const CharAsWChar&);
+    CharAsWChar& operator=(const CharAsWChar&);
+};
+
 /**
 * Calculates the CRC of an array given its length.
 * If len is <= 0 it returns 0.
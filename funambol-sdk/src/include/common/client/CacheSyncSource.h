@@ -282,6 +282,15 @@ public:
      * 
      */
     virtual void setItemStatus(const WCHAR* wkey, int status, const char* command);       
+
+    /**
+     * Called by the sync engine with all the statuses of a message.
+     * Every status goes through setItemStatus(), but the cache is updated
+     * in a single batch of the KeyValueStore.
+     *
+     * @param statuses - the statuses of the items
+     */
+    virtual void setItemStatuses(const std::vector<ItemStatus>& statuses);
     
     /**
      * Return the first SyncItem of all.
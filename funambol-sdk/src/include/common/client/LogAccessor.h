@@ -52,6 +52,45 @@ public:
      * @returns The log data as string
      */
     virtual StringBuffer getLog() = 0;
+
+    /**
+     * The log can also be read as a list of segments (e.g. the rotated
+     * log files), a part at a time, so that it is never loaded all at once.
+     * This call takes a snapshot of the segments: they are read as they
+     * are now, even if the log is rotated meanwhile, until the next call
+     * or releaseSegments().
+     * The default implementation has no segments: getLog() is used.
+     *
+     * @returns the number of segments
+     */
+    virtual int getSegmentCount() { return 0; }
+
+    /**
+     * Get the size of a segment of the snapshot.
+     *
+     * @param index      the segment, from 0 to getSegmentCount()-1, oldest first
+     * @param size       [out] the size of the segment
+     * @param compressed [out] true if the segment is gzip compressed
+     * @returns false if there is no such segment
+     */
+    virtual bool getSegmentInfo(int index, size_t* size, bool* compressed) { return false; }
+
+    /**
+     * Read a part of a segment of the snapshot.
+     *
+     * @param index   the segment, from 0 to getSegmentCount()-1, oldest first
+     * @param offset  the position of the first byte to read
+     * @param buffer  [out] the data read
+     * @param size    the max number of bytes to read
+     * @returns the number of bytes read, 0 at the end of the segment,
+     *          -1 if the segment cannot be read
+     */
+    virtual long readSegment(int index, size_t offset, char* buffer, size_t size) { return -1; }
+
+    /**
+     * Release the snapshot of the segments.
+     */
+    virtual void releaseSegments() {}
     
     /**
      * Destructor.
@@ -36,6 +36,8 @@
 #ifndef INCL_LOGSENDER
 #define INCL_LOGSENDER
 #include "base/util/StringBuffer.h"
+#include "base/Log.h"
+#include "client/LogAccessor.h"
 
 BEGIN_NAMESPACE
 
@@ -53,6 +55,45 @@ public:
      * @return the reply, if any.
      */
     virtual StringBuffer send(const StringBuffer& msg) = 0;
+
+    /**
+     * Send a segment of the snapshot taken by LogAccessor::getSegmentCount().
+     * The default implementation reads the uncompressed segments and
+     * sends them with send(), the compressed ones are not supported:
+     * the senders used with compressed logs must override it.
+     *
+     * @param accessor   the log accessor, to read the segment from
+     * @param index      the segment number, from 0
+     * @param count      the number of segments
+     * @return the reply, if any; a null StringBuffer if the segment
+     *         has not been sent
+     */
+    virtual StringBuffer sendSegment(LogAccessor& accessor, int index, int count) {
+        size_t size = 0;
+        bool compressed = false;
+        if (!accessor.getSegmentInfo(index, &size, &compressed)) {
+            return StringBuffer(NULL);
+        }
+        if (compressed) {
+            LOG.error("%s: compressed log segments are not supported by this sender",
+                      __FUNCTION__);
+            return StringBuffer(NULL);
+        }
+
+        StringBuffer msg;
+        msg.reserve((unsigned long)size);
+        char chunk[4096];
+        size_t offset = 0;
+        long read;
+        while ((read = accessor.readSegment(index, offset, chunk, sizeof(chunk))) > 0) {
+            msg.append(chunk, (unsigned long)read);
+            offset += read;
+        }
+        if (read < 0) {
+            return StringBuffer(NULL);
+        }
+        return send(msg);
+    }
     
     /**
      * Destructor.
@@ -42,6 +42,9 @@
 
 BEGIN_NAMESPACE
 
+/// The max size of the data of a request sent by PostDataLogSender::sendSegment()
+#define LOG_SEGMENT_PART_SIZE   (256 * 1024)
+
 /**
  * This class is responsible for sending the logs to the
  * emailsrvr log server.
@@ -51,8 +54,11 @@ class PostDataLogSender : public LogSender {
 private:
     StringBuffer header;
 	TransportAgent* agent;
+    size_t partSize;
 
 public:
+    PostDataLogSender();
+
     /**
      * Send the message.
      *
@@ -60,6 +66,24 @@ public:
      * @return The reply, if any.
      */
     StringBuffer send(const StringBuffer& msg);
+
+    /**
+     * Send a segment of the log in its own requests: the headers are
+     * followed by "Log-Segment:<n>/<count>" and, for the compressed
+     * segments, by "Content-Encoding:gzip". A segment bigger than the
+     * part size is sent in more requests, with "Log-Segment-Part:<k>/<parts>":
+     * the server appends the parts in order.
+     *
+     * @return The reply to the last request, if any; a null StringBuffer
+     *         if a request failed.
+     */
+    StringBuffer sendSegment(LogAccessor& accessor, int index, int count);
+
+    /**
+     * Set the max size of the data sent in a request by sendSegment()
+     * (LOG_SEGMENT_PART_SIZE by default).
+     */
+    void setPartSize(size_t size) { partSize = size ? size : LOG_SEGMENT_PART_SIZE; }
     
     /**
      * Set the transport agent that should be used to send
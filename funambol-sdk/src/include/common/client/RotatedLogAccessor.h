@@ -0,0 +1,113 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_ROTATEDLOGACCESSOR
+#define INCL_ROTATEDLOGACCESSOR
+#include "base/globalsdef.h"
+#include "client/LogAccessor.h"
+#include "base/util/StringBuffer.h"
+
+#include <stdio.h>
+#include <vector>
+
+BEGIN_NAMESPACE
+
+/**
+ * This class accesses a rotated log: the log file plus its rotated
+ * segments <file>.1 ... <file>.<maxCount>, gzip compressed (<file>.<n>.gz)
+ * or not. Each file is a segment, so that the log is sent one file at a
+ * time and the compressed files are sent as they are.
+ * The snapshot of the segments keeps each file open: a rotation renames
+ * the files, but the snapshot still reads the same content.
+ * See POSIXLog::setLogRotation().
+ */
+class RotatedLogAccessor : public LogAccessor {
+private:
+	struct Segment {
+		StringBuffer name;
+		FILE*        file;
+		size_t       size;     // when the snapshot was taken
+		bool         compressed;
+	};
+
+	StringBuffer filePath;
+	unsigned int maxCount;
+
+	/// the snapshot of the segments, oldest first
+	std::vector<Segment> segments;
+
+	bool openSegment(const StringBuffer& name);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param filePath  The full path of the log file.
+     * @param maxCount  The max number of rotated segments.
+     */
+	RotatedLogAccessor(const StringBuffer& filePath, unsigned int maxCount);
+
+    /**
+     * Return the content of the current log file only.
+     *
+     * @returns the log data as string
+     */
+	StringBuffer getLog();
+
+    /**
+     * Open the existing segments, releasing the previous snapshot.
+     *
+     * @returns the number of segments, the current log file included
+     */
+	int getSegmentCount();
+
+	bool getSegmentInfo(int index, size_t* size, bool* compressed);
+
+    /**
+     * Read a part of a segment: the last one is the current log file,
+     * up to its size when the snapshot was taken.
+     */
+	long readSegment(int index, size_t offset, char* buffer, size_t size);
+
+	void releaseSegments();
+
+    /**
+     * Destructor.
+     */
+	~RotatedLogAccessor() { releaseSegments(); }
+};
+
+END_NAMESPACE
+#endif
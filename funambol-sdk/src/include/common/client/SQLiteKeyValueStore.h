@@ -63,6 +63,9 @@ private:
     KeyValuePair enumeration_kvp;
     
     bool isTransactional;
+
+    /// true between beginBatch() and endBatch(), if a transaction was opened
+    bool inBatch;
     
 protected:
 
@@ -210,6 +213,19 @@ public:
      * @return 0 - success, failure otherwise
      */
      virtual int close();
+
+    /**
+     * Opens a transaction for the next changes, unless the store is
+     * already transactional.
+     */
+    virtual void beginBatch();
+
+    /**
+     * Commits the transaction opened by beginBatch().
+     *
+     * @return 0 success
+     */
+    virtual int endBatch();
     
     /**
      * Initializes the database
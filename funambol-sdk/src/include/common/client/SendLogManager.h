@@ -59,7 +59,9 @@ public:
      *
      * @param accessor The LogAccessor to use.
      * @param sender The LogSender to use.
-     * @return the reply, if any.
+     * @return the reply, if any. When the log is sent in segments, the
+     *         reply to the last one; a null StringBuffer if a segment
+     *         could not be read or sent (the following ones are not sent).
      */
     StringBuffer sendLog(LogAccessor* accessor, LogSender* sender);
 };
@@ -58,7 +58,7 @@ public:
 
     // Constructor
     BaseEvent(int type, unsigned long date);
-    ~BaseEvent();
+    virtual ~BaseEvent();
 
     // set time stamp / date
     void setDate(unsigned long date);
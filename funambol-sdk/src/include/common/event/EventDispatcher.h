@@ -0,0 +1,89 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_EVENT_DISPATCHER
+#define INCL_EVENT_DISPATCHER
+/** @cond DEV */
+
+#include "event/BaseEvent.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/*
+ * The listener family an event is delivered to.
+ */
+typedef enum {
+    SYNC_EVENT_FAMILY = 0,
+    TRANSPORT_EVENT_FAMILY,
+    SYNC_SOURCE_EVENT_FAMILY,
+    SYNC_ITEM_EVENT_FAMILY,
+    SYNC_STATUS_EVENT_FAMILY
+} EventFamily;
+
+/*
+ * Delivers the events fired by the API out of the firing thread.
+ * When a dispatcher is set on the ManageListener, the fire functions
+ * allocate the event and hand it over to dispatch(); when no dispatcher
+ * is set the listeners are called synchronously, as usual.
+ * The dispatcher delivers the events with deliverEvent() (see FireEvent.h).
+ */
+class EventDispatcher {
+
+public:
+
+    virtual ~EventDispatcher() {}
+
+    /*
+     * Queues the event for the listeners of the given family.
+     *
+     * @param family : the listener family of the event
+     * @param event  : the event, owned by the dispatcher if accepted
+     * @return       : false if the event is not accepted: the caller
+     *                 keeps the ownership and delivers it synchronously
+     */
+    virtual bool dispatch(EventFamily family, BaseEvent* event) = 0;
+
+    /*
+     * Waits until the events dispatched so far are delivered.
+     * Called by the ManageListener before a listener is replaced or unset.
+     */
+    virtual void flush() = 0;
+};
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -44,16 +44,24 @@
 #include "event/SyncStatusEvent.h"
 #include "event/TransportEvent.h"
 #include "event/constants.h"
+#include "event/EventDispatcher.h"
 #include "MediaHub/MHSyncItemInfo.h"
 
 BEGIN_FUNAMBOL_NAMESPACE
 
 //class MHSyncItemInfo;
+class SyncItemListener;
 
 /*
  * A set of global functions to fire an event from inside the API.
  */
 
+/*
+ * When an EventDispatcher is set on the ManageListener, the fire functions
+ * below queue the event and return true without waiting for the listeners
+ * (fireItemStatusEvent excepted, as the event refers to the caller's item).
+ */
+
 /*
  * Fire a SyncEvent.
  *
@@ -114,6 +122,15 @@ bool fireSyncItemEvent(const char* sourceURI, const char* name, const WCHAR* ite
  */
 bool fireSyncStatusEvent(const char* command, int statusCode, const char* name, const char* uri, const WCHAR* itemKey, int type);
 
+#ifndef WCHAR_IS_CHAR
+/*
+ * Same as the functions above, with the item key in UTF-8: it's converted
+ * only if there are listeners. Where WCHAR is char they are the same functions.
+ */
+bool fireSyncItemEvent(const char* sourceURI, const char* name, const char* itemKey, int type, int data = 0);
+bool fireSyncStatusEvent(const char* command, int statusCode, const char* name, const char* uri, const char* itemKey, int type);
+#endif
+
 /*
  * Fire a MediaHub ItemStatusEvent.
  * @param MHItemInfo : the item info class
@@ -121,6 +138,34 @@ bool fireSyncStatusEvent(const char* command, int statusCode, const char* name,
  */
 bool fireItemStatusEvent(const char* sourceName, const MHSyncItemInfo* MHItemInfo, int type);
 
+/*
+ * Deliver an event to the registered listeners of its family, on the
+ * calling thread. Used by the EventDispatcher implementations.
+ *
+ * @param family : the listener family (see event/EventDispatcher.h)
+ * @param event  : the event, of the class matching the family
+ * @return       : true if no errors,
+ *                 false if no listener is registered, or the event type is wrong
+ */
+bool deliverEvent(EventFamily family, BaseEvent& event);
+
+/*
+ * Deliver a batch of SyncItemEvents to each registered SyncItemListener,
+ * on the calling thread (see SyncItemListener::itemEvents()).
+ *
+ * @param events : the events, in the order they were fired
+ * @param count  : the number of events
+ * @return       : false if no syncitemListener is registered
+ */
+bool deliverSyncItemEvents(SyncItemEvent** events, int count);
+
+/*
+ * Call the method of the listener matching the type of the event.
+ *
+ * @return : false if the event type is wrong
+ */
+bool notifySyncItemListener(SyncItemListener* listener, SyncItemEvent& event);
+
 
 END_FUNAMBOL_NAMESPACE
 
@@ -44,8 +44,12 @@
 #include "event/SyncSourceListener.h"
 #include "event/TransportListener.h"
 #include "event/ItemStatusListener.h"
+#include "event/EventDispatcher.h"
 #include "base/globalsdef.h"
 
+#include <vector>
+#include <pthread.h>
+
 BEGIN_FUNAMBOL_NAMESPACE
 
 /* This is the ManageListener class - which keeps track of the various registered
@@ -54,6 +58,10 @@ BEGIN_FUNAMBOL_NAMESPACE
  * The implementation does not provide a dispose() method, because releasing the
  * instance means to unset all the listeners previously set. A method with the
  * same behavior is available, but with a more meaningful name (releaseAllListeners).
+ * The listeners are kept in arrays, so the fire functions reach the listener
+ * on a given position in constant time. The arrays are guarded by a lock,
+ * held while an event is delivered (see lock()) and while a listener is set
+ * or unset: a listener is never replaced or deleted during a delivery.
  */
 class ManageListener {
 
@@ -131,37 +139,66 @@ public:
     void unsetSyncStatusListener(const char *name = "");
     void unsetItemStatusListener(const char *name = "");
     
-    int countSyncListeners() const { return synclisteners.size(); };
-    int countTransportListeners() const { return transportlisteners.size(); };
-    int countSyncStatusListeners() const { return syncstatuslisteners.size(); };
-    int countSyncItemListeners() const { return syncitemlisteners.size(); };
-    int countSyncSourceListeners() const { return syncsourcelisteners.size(); };
-    int countItemStatusListeners() const { return itemstatuslisteners.size(); }
+    int countSyncListeners() const { return (int)synclisteners.size(); };
+    int countTransportListeners() const { return (int)transportlisteners.size(); };
+    int countSyncStatusListeners() const { return (int)syncstatuslisteners.size(); };
+    int countSyncItemListeners() const { return (int)syncitemlisteners.size(); };
+    int countSyncSourceListeners() const { return (int)syncsourcelisteners.size(); };
+    int countItemStatusListeners() const { return (int)itemstatuslisteners.size(); }
+
+    /**
+     * Set the dispatcher delivering the events out of the firing thread
+     * (see EventDispatcher). NULL, the default, calls the listeners
+     * synchronously. The dispatcher is not owned by the ManageListener.
+     * Listeners replaced or unset while a dispatcher is set are deleted
+     * only after the events already fired are delivered.
+     */
+    void setEventDispatcher(EventDispatcher* dispatcher);
+    /** The current EventDispatcher, NULL in synchronous mode */
+    EventDispatcher* getEventDispatcher() const { return dispatcher; }
+
+    /**
+     * Locks the listener lists: the count and get by position methods
+     * must be called with the lock held. The lock is recursive: a
+     * listener can fire events and set listeners while it is called.
+     */
+    void lock()   { pthread_mutex_lock(&mutex); }
+    void unlock() { pthread_mutex_unlock(&mutex); }
 
 private:
+    typedef std::vector<Listener*> ListenerList;
+
     static ManageListener *instance;
 
     //Registered Listeners : At present only one Listener per event family
-    ArrayList synclisteners;
-    ArrayList transportlisteners;
-    ArrayList syncstatuslisteners;
-    ArrayList syncitemlisteners;
-    ArrayList syncsourcelisteners;
-    ArrayList itemstatuslisteners;
+    ListenerList synclisteners;
+    ListenerList transportlisteners;
+    ListenerList syncstatuslisteners;
+    ListenerList syncitemlisteners;
+    ListenerList syncsourcelisteners;
+    ListenerList itemstatuslisteners;
+
+    EventDispatcher* dispatcher;
+
+    /** guards the listener lists, recursive */
+    pthread_mutex_t mutex;
     
     //private constructor & destructor
-    ManageListener() {}
+    ManageListener();
     ~ManageListener();
 
     /* Search for the given listener in list. */
-    Listener *lookupListener(const char* name, ArrayList &list);
+    Listener *lookupListener(const char* name, ListenerList &list);
 
     /* Set a new listener, replacing an existen one or adding it to the list. */
-    bool setListener(Listener* listener, ArrayList &list);
+    bool setListener(Listener* listener, ListenerList &list);
 
     /* Unset a listener, referenced by name. If the listener with that name is
      * not found, it does nothing. */
-    void unsetListener(const char* name, ArrayList &list);
+    void unsetListener(const char* name, ListenerList &list);
+
+    /* Wait for the queued events, before a listener is deleted. */
+    void flushEvents();
     
 };
 
@@ -96,6 +96,12 @@ public:
     /// listen for the Media Item downloaded Event
     /// This event is fired by SapiSyncManager, when download is complete
     virtual void itemDownloaded(SyncItemEvent& /* event */);
+
+    /// listen for a batch of item events, in the order they were fired.
+    /// Called instead of the methods above when the events are delivered
+    /// by an EventDispatcher: the default implementation calls, for each
+    /// event, the method matching its type.
+    virtual void itemEvents(SyncItemEvent** events, int count);
 };
 
 
@@ -109,6 +109,12 @@ class TransportAgent {
         StringMap responseProperties;
         int responseCode;
 
+        // Steps of the last message exchange, in microseconds
+        // (-1 if not measured by the transport agent)
+        int64_t sendTime;
+        int64_t waitTime;
+        int64_t receiveTime;
+
     public:
         TransportAgent();
         TransportAgent(const URL& url,
@@ -219,6 +225,15 @@ class TransportAgent {
          */
         virtual unsigned int getReadBufferSize();
 
+        /**
+         * Returns the duration of the steps of the last sendMessage(), in
+         * microseconds: until the request is sent (connection setup), the
+         * request upload and server processing, the response download.
+         *
+         * @return false if the transport agent does not measure them
+         */
+        bool getLastTimings(int64_t* send, int64_t* wait, int64_t* receive);
+
         /**
          * A platform specific string specifying the location of the
          * certificates used to authenticate the server. When empty, the
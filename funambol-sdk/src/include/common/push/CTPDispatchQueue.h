@@ -0,0 +1,128 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_CTP_DISPATCH_QUEUE
+#define INCL_CTP_DISPATCH_QUEUE
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/ArrayList.h"
+
+#include "push/FThread.h"
+#include "push/PushListener.h"
+
+#include <pthread.h>
+
+/// Default number of PushListener events a CTPDispatchQueue can hold
+#define CTP_DISPATCH_QUEUE_SIZE     256
+
+namespace Funambol {
+
+/**
+ * A bounded queue of PushListener callbacks, delivered in order by its own
+ * thread. The CTP event loops post here instead of calling the listeners,
+ * so a slow listener never stalls the sockets of the other accounts.
+ * When the queue is full the new event is dropped and an error is logged.
+ */
+class CTPDispatchQueue : public FThread {
+
+public:
+
+    CTPDispatchQueue(int32_t capacity = CTP_DISPATCH_QUEUE_SIZE);
+    ~CTPDispatchQueue();
+
+    /**
+     * Queues a push notification for the listener.
+     * @return false if the queue is full or stopped (event dropped)
+     */
+    bool postNotification(PushListener* listener, const ArrayList& serverURIList);
+
+    /**
+     * Queues a CTP error for the listener.
+     * @return false if the queue is full or stopped (event dropped)
+     */
+    bool postError(PushListener* listener, const int errorCode, const int additionalInfo);
+
+    /**
+     * Drops the queued events of the listener and waits for a callback in
+     * progress on it to return: after this call the listener can be deleted.
+     */
+    void cancel(PushListener* listener);
+
+    /// Number of events waiting to be delivered.
+    int32_t size();
+
+    /// Starts the dispatching thread.
+    void start(Priority priority = InheritPriority);
+
+    /// Stops the dispatching thread: queued events are discarded.
+    void softTerminate();
+
+protected:
+    void run();
+
+private:
+
+    struct Event {
+        PushListener* listener;
+        bool          isError;
+        ArrayList     serverURIList;
+        int           errorCode;
+        int           additionalInfo;
+    };
+
+    Event**  events;
+    int32_t  capacity;
+    int32_t  head;
+    int32_t  count;
+
+    /// The listener being called by the dispatching thread, if any
+    PushListener* delivering;
+    pthread_t     dispatchThread;
+    bool          started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  available;
+    pthread_cond_t  delivered;
+
+    bool post(Event* event);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
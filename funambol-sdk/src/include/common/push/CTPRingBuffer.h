@@ -0,0 +1,133 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_CTP_RING_BUFFER
+#define INCL_CTP_RING_BUFFER
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+namespace Funambol {
+
+/**
+ * Receive buffer of a CTP connection.
+ * Bytes are read from the socket directly into the free space of the ring
+ * (see getWriteSpace() and commit()), then the length-prefixed CTP packages
+ * are framed in place by nextMessage(): a package which is contiguous in the
+ * ring is returned without copies, only a package wrapping around the end
+ * of the ring is linearized into a small scratch buffer.
+ * A single read can hold several packages, and the bytes of an incomplete
+ * package are kept for the next read.
+ *
+ * Not thread safe: a ring belongs to one connection.
+ */
+class CTPRingBuffer {
+
+public:
+
+    /**
+     * @param maxPackageSize  the max size of a CTP package (2 bytes of
+     *                        length included): the ring holds at least 4
+     *                        packages of this size
+     */
+    CTPRingBuffer(int32_t maxPackageSize);
+    ~CTPRingBuffer();
+
+    /// Discards all the buffered bytes (new connection)
+    void reset();
+
+    /// Number of bytes buffered and not yet consumed
+    int32_t size() const { return (int32_t)(tail - head); }
+
+    /// Number of free bytes
+    int32_t space() const { return capacity - size(); }
+
+    /**
+     * Returns the contiguous free space where the next bytes can be
+     * received. The caller writes at most *len bytes, then calls commit().
+     * @param len  [out] the size of the free space, 0 if the ring is full
+     */
+    char* getWriteSpace(int32_t* len);
+
+    /// Declares 'len' bytes written in the space given by getWriteSpace()
+    void commit(int32_t len);
+
+    /**
+     * Copies the given bytes into the ring.
+     * @return the number of bytes copied, less than len if the ring is full
+     */
+    int32_t write(const char* data, int32_t len);
+
+    /**
+     * Frames the next CTP package.
+     * @param package  [out] the complete package, 2 bytes of length
+     *                 included. Valid until the next call on the ring.
+     * @return the package length, 0 if the package is not complete yet,
+     *         -1 if the package length is invalid (empty or larger than
+     *         the max package size)
+     */
+    int32_t nextMessage(const char** package);
+
+    /// Drops 'len' bytes, usually the package returned by nextMessage()
+    void consume(int32_t len);
+
+private:
+
+    char*    ring;
+    int32_t  capacity;
+    uint32_t mask;
+
+    /// Free running read/write positions: the index in 'ring' is pos & mask
+    uint32_t head;
+    uint32_t tail;
+
+    /// Used for the packages wrapping around the end of the ring
+    char*    scratch;
+    int32_t  maxPackageSize;
+
+    /// Copies 'len' bytes from the read position + offset
+    void peek(char* dest, int32_t offset, int32_t len) const;
+
+    // not copyable
+    CTPRingBuffer(const CTPRingBuffer&);
+    CTPRingBuffer& operator=(const CTPRingBuffer&);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -47,6 +47,9 @@
 #include "push/CTPMessage.h"
 #include "push/CTPConfig.h"
 #include "push/CTPThreadPool.h"
+#include "push/CTPSession.h"
+#include "push/CTPRingBuffer.h"
+#include "push/TimerWheel.h"
 
 #include <pthread.h>
 
@@ -57,9 +60,19 @@
 
 #define CTP_SEND_BYE_MSG                0   /** Set to 1 to send the [BYE] msg before closing connection */
 
+/**
+ * Where the multiplexed CTPEngine is available, startCTP()/stopCTP() run the
+ * CTP process as a CTPSession on it instead of the CTP threads.
+ */
+#if !defined(WIN32) && !defined(_WIN32_WCE)
+#define CTP_SERVICE_USE_ENGINE          1
+#endif
+
 
 namespace Funambol {
 
+class CTPEngine;
+
 // Private Threads
 class CTPThread : public FThread {
 
@@ -88,31 +101,25 @@ private:
     CTPService* ctpService;
 };
 
-class HeartbeatThread : public FThread {
+// Private timers, scheduled on the shared TimerThread
+class HeartbeatTimer : public TimerTask {
 public:
-    HeartbeatThread(CTPService* ctpService_);
-    ~HeartbeatThread();
-    void run();
+    HeartbeatTimer(CTPService* ctpService_);
+    void onTimeout();
     int32_t getErrorCode() { return errorCode; }
-    void softTerminate();
 
 private:
     int32_t errorCode;
     CTPService* ctpService;
-
 };
 
-class CmdTimeoutThread : public FThread {
-
+class CmdTimeoutTimer : public TimerTask {
 public:
-    CmdTimeoutThread(CTPService* ctpService_);
-    ~CmdTimeoutThread();
-    void run();
-    void softTerminate();
+    CmdTimeoutTimer(CTPService* ctpService_);
+    void onTimeout();
 
 private:
     CTPService* ctpService;
-
 };
 
 
@@ -173,6 +180,9 @@ private:
 
     /// The socket used
     FSocket* ctpSocket;
+
+    /// Bytes received from ctpSocket, framed by receiveStatusMsg()
+    CTPRingBuffer rxRing;
     
     /**
      * The listener for push notifications.
@@ -187,10 +197,10 @@ private:
     CTPThread* ctpThread;                   
     /**< Handle of thread used to receive msg from Server */
     ReceiverThread* receiverThread;
-    /**< Handle of thread used to send ready msg to Server */
-    HeartbeatThread* heartbeatThread;
-    /**< Handle of thread used to check if a response arrived in ctpCmdTimeout seconds */
-    CmdTimeoutThread* cmdTimeoutThread;
+    /**< Timer used to send ready msg to Server */
+    HeartbeatTimer heartbeatTimer;
+    /**< Timer used to check if a response arrived in ctpCmdTimeout seconds */
+    CmdTimeoutTimer cmdTimeoutTimer;
 
     /// Store the received message from Server
     CTPMessage* receivedMsg;
@@ -205,6 +215,11 @@ private:
     DMTClientConfig* clientConfig;
     
     pthread_mutex_t ctpSocketMtx;
+
+    /// The event loop serving the CTP session (CTP_SERVICE_USE_ENGINE only)
+    CTPEngine* engine;
+    /// The CTP process started by startCTP() (CTP_SERVICE_USE_ENGINE only)
+    CTPSession* session;
     
 private:
 
@@ -248,8 +263,8 @@ public:
      */
     CTPConfig* getConfig() { return &config; }
 
-    /// Get the ctpState member.
-    CtpState getCtpState()    { return ctpState; }
+    /// Get the state of the CTP connection.
+    CtpState getCtpState();
 
     /// Set the ctpState member.
     void setCtpState(CtpState v) { ctpState = v; }
@@ -273,7 +288,7 @@ public:
      *        This would discard a listener previously registered.
      * @param listener  the notification listener object
      */
-    void registerPushListener(PushListener& listener) { pushListener = &listener; }
+    void registerPushListener(PushListener& listener);
     
     /**
      * Method called when a sync notification has been received.
@@ -295,10 +310,10 @@ public:
     void notifyError(const int errorCode, const int additionalInfo = 0);
     
     
-    /// Stops the heartbeatThread and sets the pointer to NULL.
+    /// Cancels the heartbeat timer.
     void stopHeartbeatThread();
     
-    /// Stops the cmdTimeoutThread and sets the pointer to NULL.
+    /// Cancels the command timeout timer.
     void stopCmdTimeoutThread();
     
     /// Stops the receiverThread and sets the pointer to NULL.
@@ -0,0 +1,253 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_CTP_SESSION
+#define INCL_CTP_SESSION
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/ArrayList.h"
+#include "base/util/StringBuffer.h"
+
+#include "push/PushListener.h"
+#include "push/CTPMessage.h"
+#include "push/CTPConfig.h"
+#include "push/CTPRingBuffer.h"
+
+namespace Funambol {
+
+class CTPSession;
+
+/**
+ * Receives the events raised by a CTPSession. The CTPEngine implements
+ * it to move listener callbacks off its event loops: the session itself
+ * never blocks on a PushListener.
+ * If no observer is set, the session calls its PushListener directly.
+ */
+class CTPSessionObserver {
+
+public:
+    virtual ~CTPSessionObserver() {}
+
+    /// A [SYNC] notification was received for the given session.
+    virtual void onSyncNotification(CTPSession& session, const ArrayList& serverURIList) = 0;
+
+    /// A CTP error (one of CTPService::CtpError) occurred on the given session.
+    virtual void onCTPError(CTPSession& session, const int errorCode, const int additionalInfo) = 0;
+};
+
+
+/**
+ * The CTP protocol for one account, as a state machine which does not own
+ * any socket or thread.
+ * The transport feeds it with connection events and received bytes, asks
+ * it for the bytes to be sent and wakes it up at getNextDeadline(); the
+ * session implements the same AUTH / JUMP / READY / SYNC handling, the
+ * command timeout and the restore backoff of the thread based CTPService.
+ *
+ * All times are milliseconds of a monotonic clock chosen by the caller.
+ * Methods are not thread safe: a session must be driven by a single thread
+ * at a time (the CTPEngine loop it is registered to).
+ */
+class CTPSession {
+
+public:
+
+    /**
+     * @param config        the CTP configuration of this account (not owned)
+     * @param clientConfig  the configuration holding the account credentials (not owned)
+     * @param listener      [optional] the listener for push notifications (not owned)
+     */
+    CTPSession(CTPConfig& config, DMTClientConfig* clientConfig, PushListener* listener = NULL);
+    ~CTPSession();
+
+    CTPConfig& getConfig() { return config; }
+
+    PushListener* getPushListener()             { return pushListener; }
+    void setPushListener(PushListener* listener) { pushListener = listener; }
+
+    void setObserver(CTPSessionObserver* o) { observer = o; }
+
+    /// The connection state, one of CTPService::CtpState.
+    int getState() const { return state; }
+
+    /// True once stop() has been called.
+    bool isLeaving() const { return leaving; }
+
+    /**
+     * True if the session gave up (authentication refused by the Server):
+     * it will not try to connect anymore.
+     */
+    bool isFinished() const { return finished; }
+
+    /// The exit code of a finished session, same values as CTPThread.
+    int32_t getErrorCode() const { return errorCode; }
+
+    /// Stops the session: no more connections are attempted.
+    void stop();
+
+    /// True if the transport should open a new connection now.
+    bool shouldConnect(int64_t now) const;
+
+    /// The transport started connecting to config.getUrlTo():getCtpPort().
+    void onConnecting(int64_t now);
+
+    /**
+     * The connection is established: the [AUTH] message is queued.
+     * @return false if the connection must be closed
+     */
+    bool onConnected(int64_t now);
+
+    /**
+     * Bytes received from the Server. They may contain partial or several
+     * CTP messages, each complete message is handled immediately.
+     * @return false if the connection must be closed
+     */
+    bool onData(const char* data, int32_t len, int64_t now);
+
+    /**
+     * Returns the free space of the receive buffer, where the transport can
+     * receive the next bytes without copies. Then call onReceived().
+     * @param len  [out] the size of the free space
+     */
+    char* getReceiveSpace(int32_t* len);
+
+    /**
+     * 'len' bytes were received in the space given by getReceiveSpace().
+     * Same as onData().
+     * @return false if the connection must be closed
+     */
+    bool onReceived(int32_t len, int64_t now);
+
+    /**
+     * The connection was closed (by the peer, on errors or because a
+     * previous call returned false). Schedules the restore if needed.
+     */
+    void onDisconnected(int64_t now);
+
+    /**
+     * Checks the command timeout, the heartbeat and ctpConnTimeout.
+     * @return false if the connection must be closed
+     */
+    bool onTimer(int64_t now);
+
+    /// The next time onTimer() or shouldConnect() must be checked, -1 if none.
+    int64_t getNextDeadline() const;
+
+    /// The bytes waiting to be sent (NULL if none), see consumeOutput().
+    const char* getPendingOutput(int32_t* len) const;
+
+    /// Removes the first 'len' bytes of the pending output, once written.
+    void consumeOutput(int32_t len);
+
+
+    /**
+     * Formats the 'cred' CTP param: B64(MD5( B64(MD5("username":"password")):"clientNonce" ))
+     * @return the credential string in b64 format (empty on errors)
+     */
+    static StringBuffer createMD5Credentials(CTPConfig& config, DMTClientConfig* clientConfig);
+
+    /**
+     * Saves the nonce param (if it is the first param of the message) to
+     * CTPConfig, b64 encoded, and saves the CTPConfig.
+     * @return true if the nonce has been saved, false if nonce not found
+     */
+    static bool saveNonceParam(CTPConfig& config, CTPMessage* authStatusMsg);
+
+    /**
+     * Extracts the list of ServerURI names (StringBuffers) inside the SyncNotification.
+     */
+    static ArrayList getUriListFromSAN(SyncNotification* sn);
+
+private:
+
+    CTPConfig& config;
+    DMTClientConfig* clientConfig;
+    PushListener* pushListener;
+    CTPSessionObserver* observer;
+
+    int state;
+    bool leaving;
+    bool finished;
+    /// True if the session itself asked to close the current connection
+    bool closing;
+    int32_t errorCode;
+
+    /// 0 = not authenticating, 1 or 2 = number of [AUTH] sent on this connection
+    int authRound;
+    /// True after a successful AUTH: received messages are notifications
+    bool authenticated;
+    /// True after a JUMP status: reconnect immediately
+    bool jump;
+
+    /// The original ctpRetry, restored after a successful AUTH
+    int32_t defaultCtpRetry;
+
+    int64_t retryDeadline;
+    int64_t cmdDeadline;
+    int64_t heartbeatDeadline;
+    int64_t connDeadline;
+
+    CTPRingBuffer rxRing;
+
+    char*   txBuffer;
+    int32_t txLen;
+    int32_t txSize;
+
+    int32_t totalBytesSent;
+    int32_t totalBytesReceived;
+
+    bool queueMsg(CTPMessage& message, int64_t now);
+    bool queueAuthMsg(int64_t now);
+    bool queueReadyMsg(int64_t now);
+
+    bool handleMessages(int64_t now);
+    bool handleMessage(CTPMessage& message, int64_t now);
+    bool handleAuthStatus(CTPMessage& message, int64_t now);
+    bool handleJump(CTPMessage& message);
+
+    void scheduleRestore(int64_t now);
+    void fail(int32_t code);
+
+    void notifySync(SyncNotification* sn);
+    void notifyError(const int errorCode, const int additionalInfo = 0);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -43,8 +43,6 @@
 BEGIN_NAMESPACE
 
 // Forward declarations
-class CmdTimeoutThread;
-class HeartbeatThread;
 class ReceiverThread;
 class CTPService;
 
@@ -55,6 +53,8 @@ class CTPService;
  * This class is a very simple form of garbage collection for CTP threads. The
  * cleanup is not performed automatically but must be explicitelly invoked.
  * Since CTP has periodic activity this is not a problem in this context.
+ * Heartbeats and command timeouts are not threads anymore: they are timers
+ * on the shared TimerThread.
  */
 
 class CTPThreadPool {
@@ -64,12 +64,6 @@ public:
     /** Constructor */
     CTPThreadPool() {}
 
-    /** Creates a new timeout thread */
-    CmdTimeoutThread* createCmdTimeoutThread(CTPService* ctpService_);
-
-    /** Creates a new heartbeat thread */
-    HeartbeatThread*  createHeartbeatThread(CTPService* ctpService_);
-
     /** Creates a new receiver thread */
     ReceiverThread*   createReceiverThread(CTPService* ctpService_);
 
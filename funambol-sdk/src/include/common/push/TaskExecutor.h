@@ -0,0 +1,242 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_TASK_EXECUTOR
+#define INCL_TASK_EXECUTOR
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+#include <pthread.h>
+#include <vector>
+#include <deque>
+
+/// Max number of workers of a TaskExecutor
+#define TASK_EXECUTOR_MAX_WORKERS   16
+/// Number of Task priorities
+#define TASK_PRIORITY_COUNT         3
+
+namespace Funambol {
+
+class AbstractSyncConfig;
+class TaskExecutor;
+
+/**
+ * A unit of work run by the TaskExecutor. Subclasses implement run() and
+ * keep their results as members, read back through the TaskFuture.
+ * Once submitted, the task is reference counted: it is deleted by the
+ * executor when it has finished and no TaskFuture refers to it anymore.
+ */
+class Task {
+
+public:
+
+    enum Priority { HighPriority = 0, NormalPriority, LowPriority };
+    enum Status   { Pending, Running, Done, Cancelled };
+
+    Task(Priority priority = NormalPriority);
+    virtual ~Task();
+
+    /// The work, called on a worker thread.
+    virtual void run() = 0;
+
+    Priority getPriority() const { return priority; }
+
+    Status getStatus();
+
+    /**
+     * True once the task is cancelled, or the sync of the config given
+     * to TaskExecutor::submit() is aborted: long tasks should check it
+     * and return early.
+     */
+    bool isCancelled();
+
+    /**
+     * Cancels the task: if not started it will not run, otherwise
+     * isCancelled() becomes true.
+     * @return true if the task had not started yet
+     */
+    bool cancel();
+
+private:
+
+    friend class TaskExecutor;
+    friend class TaskFuture;
+
+    Priority            priority;
+    Status              status;
+    bool                cancelled;
+    AbstractSyncConfig* config;
+    int                 refs;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  finished;
+
+    void retain();
+    void release();
+
+    /// Sets the final status and wakes up the waiting futures.
+    void finish(Status s);
+};
+
+/**
+ * The handle of a submitted Task, used to wait for it, cancel it and
+ * read its results. Copies refer to the same task.
+ */
+class TaskFuture {
+
+public:
+
+    TaskFuture();
+    explicit TaskFuture(Task* task);
+    TaskFuture(const TaskFuture& other);
+    TaskFuture& operator=(const TaskFuture& other);
+    ~TaskFuture();
+
+    /// False for a future not bound to a task.
+    bool isValid() const { return task != NULL; }
+
+    /// True if the task has run or has been cancelled.
+    bool isDone();
+
+    /// True if the task has been cancelled before running.
+    bool isCancelled();
+
+    /// Cancels the task (see Task::cancel()).
+    bool cancel();
+
+    /**
+     * Waits for the task to finish.
+     * @param timeoutMillis  max time to wait, -1 to wait forever
+     * @return true if the task has finished (run or cancelled)
+     */
+    bool wait(int64_t timeoutMillis = -1);
+
+    /**
+     * The submitted task, to read its results once done.
+     * Valid as long as this future exists.
+     */
+    Task* getTask() const { return task; }
+
+private:
+
+    Task* task;
+};
+
+/**
+ * A pool of worker threads shared by the SDK, for work which can run in
+ * parallel (signatures, uploads and downloads, directory scans) instead of
+ * a new FThread per job.
+ * Each worker has its own deques of tasks, one per priority: a task
+ * submitted by a worker goes on its own deque, the others on the shared
+ * queue of the executor, in order. A worker runs its newest task first;
+ * when it has no task of a priority it takes the oldest one of the shared
+ * queue, then steals the oldest one of the other workers.
+ * Higher priority tasks are always taken first.
+ */
+class TaskExecutor {
+
+public:
+
+    /// The shared instance, started on first use with one worker per CPU.
+    static TaskExecutor* getInstance();
+
+    /// Stops and deletes the shared instance. Queued tasks are cancelled.
+    static void dispose();
+
+    /**
+     * Starts the workers.
+     * @param workerCount  number of workers, 0 for one per CPU
+     */
+    TaskExecutor(int workerCount = 0);
+
+    /// Cancels the queued tasks and waits for the running ones.
+    ~TaskExecutor();
+
+    /**
+     * Queues the task. If 'config' is given, the task is cancelled when
+     * config->isToAbort() is true before it starts, and isCancelled()
+     * reports the abort while it runs.
+     * The task is owned by the executor from now on.
+     * @return the future of the task (cancelled if the executor is stopping)
+     */
+    TaskFuture submit(Task* task, AbstractSyncConfig* config = NULL);
+
+    /// Cancels all the queued tasks.
+    void cancelAll();
+
+    /// Number of worker threads.
+    int getWorkerCount() const { return (int)workers.size(); }
+
+    /// Number of tasks waiting for a worker.
+    int getQueuedCount();
+
+private:
+
+    class Worker;
+    friend class Worker;
+
+    static TaskExecutor* pinstance;
+
+    std::vector<Worker*> workers;
+
+    /// The Worker running on the current thread, if any
+    pthread_key_t currentWorker;
+
+    /// Tasks submitted by other threads, one deque per priority
+    std::deque<Task*> shared[TASK_PRIORITY_COUNT];
+
+    int  queued;
+    bool stopping;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  available;
+
+    /// Takes the next task for the worker: own deques first, then shared, then steals.
+    Task* take(int index);
+
+    /// Runs the task, unless cancelled, and drops the executor reference.
+    void runTask(Task* task);
+
+    /// The loop of each worker thread.
+    void workerLoop(Worker* worker);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_TIMER_THREAD
+#define INCL_TIMER_THREAD
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+#include "push/FThread.h"
+#include "push/TimerWheel.h"
+
+#include <pthread.h>
+
+namespace Funambol {
+
+/**
+ * A thread driving a TimerWheel, shared by all the components which need
+ * delayed or periodic work (CTP heartbeats and command timeouts) instead
+ * of parking a sleeping thread each.
+ * Tasks run on this thread: onTimeout() must be short and never block.
+ */
+class TimerThread : public FThread {
+
+public:
+
+    /// The shared instance, started on first use.
+    static TimerThread* getInstance();
+
+    /// Stops and deletes the shared instance. Scheduled tasks are dropped.
+    static void dispose();
+
+    ~TimerThread();
+
+    /**
+     * Schedules the task to run after 'delayMillis' (re-scheduling it if
+     * already scheduled).
+     */
+    bool schedule(TimerTask* task, int64_t delayMillis);
+
+    /**
+     * Removes the task. If it's running on the timer thread, waits for it
+     * to finish (unless called by the task itself): a task scheduling
+     * itself again from onTimeout() is not left scheduled.
+     * @return true if the task was scheduled
+     */
+    bool cancel(TimerTask* task);
+
+    /// Stops the thread.
+    void softTerminate();
+
+protected:
+
+    TimerThread();
+    void run();
+
+private:
+
+    static TimerThread* pinstance;
+
+    TimerWheel wheel;
+
+    /// Set when a task is scheduled, so the thread recomputes its wait
+    bool changed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
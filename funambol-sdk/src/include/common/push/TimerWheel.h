@@ -0,0 +1,172 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_TIMER_WHEEL
+#define INCL_TIMER_WHEEL
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+#include <pthread.h>
+
+/// Default resolution of a TimerWheel, in milliseconds
+#define TIMER_WHEEL_TICK        100
+
+/// Each level of the wheel has 2^TIMER_WHEEL_BITS slots
+#define TIMER_WHEEL_BITS        6
+#define TIMER_WHEEL_SLOTS       (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK        (TIMER_WHEEL_SLOTS - 1)
+/// 4 levels: with the default tick, delays up to ~19 days
+#define TIMER_WHEEL_LEVELS      4
+
+namespace Funambol {
+
+class TimerWheel;
+
+/**
+ * A task which can be scheduled on a TimerWheel. Subclasses implement
+ * onTimeout(), which is called once when the delay expires; the task can
+ * schedule itself again from there.
+ * A task is scheduled on at most one wheel at a time, and is cancelled
+ * when it is destroyed.
+ */
+class TimerTask {
+
+public:
+    TimerTask();
+    virtual ~TimerTask();
+
+    /// Called by TimerWheel::expire() when the delay has expired.
+    virtual void onTimeout() = 0;
+
+    /// True if the task is waiting for its delay to expire.
+    bool isScheduled() const { return wheel != NULL; }
+
+private:
+    friend class TimerWheel;
+
+    TimerTask*  prev;
+    TimerTask*  next;
+    TimerWheel* wheel;
+    int64_t     expires;    // in ticks
+    int         level;      // -1 = in the expired list
+    int         slot;
+};
+
+
+/**
+ * A hierarchical hashed timer wheel: TIMER_WHEEL_LEVELS levels of
+ * TIMER_WHEEL_SLOTS slots each, every level TIMER_WHEEL_SLOTS times
+ * coarser than the one below. Scheduling and cancelling a task are O(1),
+ * expiring costs O(1) per tick plus the (amortized) cascading of the
+ * tasks from the upper levels.
+ *
+ * The wheel has no thread: the owner calls expire() at (or after) the
+ * time returned by getNextExpiry(), see TimerThread for a shared driver.
+ * All times are milliseconds of a monotonic clock (see now()).
+ * Methods are thread safe; cancel() waits for a running onTimeout() of
+ * the task, unless called by the task itself.
+ */
+class TimerWheel {
+
+public:
+
+    TimerWheel(int32_t tickMillis = TIMER_WHEEL_TICK);
+    ~TimerWheel();
+
+    /**
+     * Schedules the task to run 'delayMillis' after 'now'. A task already
+     * scheduled on this wheel is moved.
+     * @return false if the task is scheduled on another wheel
+     */
+    bool schedule(TimerTask* task, int64_t delayMillis, int64_t now);
+
+    /**
+     * Removes the task from the wheel. If its onTimeout() is running on
+     * another thread, waits for it and removes the task again if it
+     * scheduled itself meanwhile.
+     * @return true if the task was scheduled
+     */
+    bool cancel(TimerTask* task);
+
+    /**
+     * Runs the onTimeout() of all the tasks expired at 'now'.
+     * @return the number of tasks run
+     */
+    int32_t expire(int64_t now);
+
+    /**
+     * The time when expire() should be called next, -1 if no task is
+     * scheduled. It can be earlier than the first expiry (when tasks of the
+     * upper levels must be cascaded), never later.
+     */
+    int64_t getNextExpiry(int64_t now);
+
+    /// Number of scheduled tasks.
+    int32_t size();
+
+    int32_t getTick() const { return tick; }
+
+    /// Milliseconds of a monotonic clock.
+    static int64_t now();
+
+private:
+
+    int32_t tick;
+    int64_t currentTick;    // the next tick to be expired
+    bool    initialized;
+    int32_t count;          // scheduled tasks, including the expired ones
+    int32_t expiredCount;
+
+    TimerTask* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    TimerTask* expired;     // expired tasks, waiting to be run
+
+    TimerTask* runningTask;
+    pthread_t  runningThread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  taskDone;
+
+    void link(TimerTask* task);
+    void unlink(TimerTask* task);
+    void cascade(int level);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -93,10 +93,10 @@ class SapiMediaJsonParser
 
         bool parseMediaAddItem(const char* itemMetaDataUploadJson, StringBuffer& itemId, time_t* lastUpdate, ESMPStatus* errCode);
     
-        bool formatItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, bool prettyPrint=false);
-        bool formatMediaItemMetaData(SapiSyncItemInfo* itemInfo, char** itemJsonMetaData, bool prettyPrint=false);
-        bool formatDelItemsListObject(const ArrayList& itemsIDs, char **itemsListJsonObject, const char* source, bool prettyPrint=false);
-        bool formatRenameItemsListObject(SapiSyncItemInfo* itemInfo, char **itemsListJsonObject, bool prettyPrint=false);
+        bool formatItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, bool prettyPrint=false);
+        bool formatMediaItemMetaData(SapiSyncItemInfo* itemInfo, StringBuffer& itemJsonMetaData, bool prettyPrint=false);
+        bool formatDelItemsListObject(const ArrayList& itemsIDs, StringBuffer& itemsListJsonObject, const char* source, bool prettyPrint=false);
+        bool formatRenameItemsListObject(SapiSyncItemInfo* itemInfo, StringBuffer& itemsListJsonObject, bool prettyPrint=false);
 
         bool checkErrorMessages(const char* response, time_t* lastUpdate = NULL);
         StringBuffer& getErrorCode()     { return errorCode;    }
@@ -87,6 +87,8 @@
 #define PROPERTY_SOURCE_SCHEDULE       "schedule"
 #define PROPERTY_SOURCE_ENCRYPTION     "encryption"
 #define PROPERTY_ENABLE_COMPRESSION    "enableCompression"
+#define PROPERTY_ENABLE_WBXML          "enableWbxml"
+#define PROPERTY_ENABLE_CHECKPOINTS    "enableCheckpoints"
 #define PROPERTY_LAST_GLOBAL_ERROR     "lastGlobalError"
 #define PROPERTY_SOURCE_SYNC_MODE      "sourceSyncMode"
 #define PROPERTY_SYNC_MODE_DISABLED    "disabled"
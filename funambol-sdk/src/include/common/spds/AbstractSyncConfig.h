@@ -218,6 +218,12 @@ class AbstractSyncConfig {
     /** True if transport-level compression is enabled */
     virtual bool  getCompression() const = 0;
 
+    /** True if the SyncML messages are exchanged WBXML encoded; XML by default */
+    virtual bool  getWBXML() const { return false; }
+
+    /** True if the progress of the sources is checkpointed to resume interrupted syncs; false by default */
+    virtual bool  getCheckpoints() const { return false; }
+
     /** The number of seconds of waiting response timeout */
     virtual unsigned int getResponseTimeout() const = 0;
 
@@ -90,6 +90,8 @@ class AccessConfig {
         bool            checkConn           ;
         unsigned int    responseTimeout     ;
         bool            compression         ;
+        bool            wbxml               ;
+        bool            checkpoints         ;
     
     char*           phoneidentify           ;
     char*           tokenauth           ;
@@ -339,6 +341,23 @@ class AccessConfig {
 
         bool  getCompression() const;
 
+        /**
+         * Enables the WBXML encoding of the SyncML messages
+         * (application/vnd.syncml+wbxml) instead of the XML one.
+         */
+        void setWBXML(bool v);
+
+        bool getWBXML() const;
+
+        /**
+         * Enables the checkpoints of the syncs: the progress of each source
+         * is saved after every message acknowledged by the server, so that
+         * an interrupted sync is resumed instead of started over.
+         */
+        void setCheckpoints(bool v);
+
+        bool getCheckpoints() const;
+
         //void setCompression(bool v);
 
         void setCheckConn(bool v);
@@ -53,9 +53,14 @@ class Chunk {
 private:
 
     /**
-    * The data of the chunk
+    * The data of the chunk, owned by the chunk (allocated with new[])
     */
-    StringBuffer data;
+    char* data;
+
+    /**
+    * The length of the data, not counting the terminating \0
+    */
+    unsigned long dataSize;
     
     /**
     * Means it is the first chunk. By default it is true
@@ -73,6 +78,10 @@ private:
     StringBuffer encoding;
 
     unsigned long totalDataSize;
+
+    // not copyable: the chunk owns its data
+    Chunk(const Chunk&);
+    Chunk& operator=(const Chunk&);
        
 public:
 
@@ -109,6 +118,23 @@ public:
     */
     const char* getData();
 
+    /**
+    * Take ownership of an already filled buffer, without copying it.
+    * The buffer must be allocated with new[] and terminated by a \0.
+    *
+    * @param value - the buffer; it's freed by the chunk
+    * @param len   - the length of the data in value
+    */
+    void adoptData(char* value, unsigned long len);
+
+    /**
+    * Hand the internal buffer over to the caller, who becomes responsible
+    * to free it with delete []. The chunk is left empty.
+    *
+    * @return the data of the chunk, NULL if it has none
+    */
+    char* releaseData();
+
     void setDataEncoding(const char* enc) { encoding = enc; }
     StringBuffer getDataEncoding() { return encoding; }
 
@@ -89,8 +89,8 @@ private:
     char* buffer;
     
     /**
-    * Reset the current internal buffer put it to 0. Moreover it checks that if the size
-    * is greater than the maxMsgSize set at the beginning, it frees the existing
+    * Reset the current internal buffer to an empty string. Moreover it checks that if
+    * the size is greater than the maxMsgSize set at the beginning, it frees the existing
     * buffer and create a new one.
     */
     void resetBuffer(unsigned long size);       
@@ -117,7 +117,9 @@ public:
     * included. The caller needs <size> data and the itemReader is 
     * responsible to give back this amount. If no data are available or some errors
     * occurr it returns NULL. 
-    * Since the Chunk returned is a new object, the caller is responsible to free it
+    * Since the Chunk returned is a new object, the caller is responsible to free it.
+    * The data is encoded directly into the buffer owned by the Chunk, that can
+    * be moved without copies with Chunk::releaseData().
     *
     * @param size - the max amount of data requested by the caller
     * @return - a new Chunk object if possible. NULL if error occurred
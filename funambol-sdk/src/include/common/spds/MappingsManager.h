@@ -37,6 +37,9 @@
 #define INCL_MAPPINGS_MANAGER
 /** @cond DEV */
 
+#include <map>
+#include <string>
+
 #include "spds/MappingStoreBuilder.h"
 #include "base/util/PropertyFile.h"
 #include "base/util/utils.h"
@@ -58,6 +61,23 @@ class MappingsManager {
         */
         static MappingStoreBuilder* builder; 
 
+        /**
+        * True while the mappings added are batched in the store (see
+        * KeyValueStore::beginBatch()), until closeMappings()
+        */
+        bool inBatch;
+
+        /**
+        * True if mappings were added since the last closeMappings()
+        */
+        bool changed;
+
+        /**
+        * The LUIDs by GUID, built from the store on the first lookup and
+        * kept up to date after that. NULL until then.
+        */
+        std::map<std::string, std::string>* guidIndex;
+
     public:
         
         /**
@@ -67,7 +87,7 @@ class MappingsManager {
         *
         * @param sourceName - the name of the source the MappingsManager is created for
         */
-        MappingsManager(const char* sourceName) {
+        MappingsManager(const char* sourceName) : inBatch(false), changed(false), guidIndex(NULL) {
             store = MappingsManager::getMappingStore(sourceName);
         }
         
@@ -76,13 +96,18 @@ class MappingsManager {
         * MappingsManager is responsible to delete it.
         */
         ~MappingsManager() {
+            if (inBatch) {
+                store->endBatch();
+            }
+            delete guidIndex;
             delete store;
         }
 
         /**
-        * Stores the pair LUID/GUID in the storage immediately. These are the
+        * Stores the pair LUID/GUID in the storage. These are the
         * values that will be used at the next sync if something
-        * goes wrong. 
+        * goes wrong. The mappings of a message are written together,
+        * they are committed by closeMappings().
         *
         * @param LUID - the Local UID of the item (client side)
         * @param GUID - the Global UID of the item (server side)
@@ -90,8 +115,49 @@ class MappingsManager {
         * @return true if all is OK, false otherwise
         */
         bool addMapping(const char* LUID, const char* GUID) {
-            return store->setPropertyValue(LUID, GUID) == 0 ? true : false;
-            
+            if (!inBatch) {
+                store->beginBatch();
+                inBatch = true;
+            }
+            if (guidIndex) {
+                // the LUID could be mapped to another GUID
+                StringBuffer previous = store->readPropertyValue(LUID);
+                if (!previous.null()) {
+                    guidIndex->erase(previous.c_str());
+                }
+            }
+            if (store->setPropertyValue(LUID, GUID) != 0) {
+                return false;
+            }
+            changed = true;
+            if (guidIndex) {
+                guidIndex->insert(std::make_pair(std::string(GUID), std::string(LUID)));
+            }
+            return true;
+        }
+
+        /**
+        * Returns the LUID mapped to the GUID, without scanning the mappings.
+        *
+        * @param GUID - the Global UID of the item (server side)
+        * @return the Local UID of the item, empty if there is no mapping for the GUID
+        */
+        StringBuffer lookupMapping(const char* GUID) {
+            if (guidIndex == NULL) {
+                guidIndex = new std::map<std::string, std::string>();
+                Enumeration& en = store->getProperties();
+                while (en.hasMoreElement()) {
+                    KeyValuePair* kvp = (KeyValuePair*)en.getNextElement();
+                    if (kvp->getKey().null() || kvp->getValue().null()) {
+                        continue;
+                    }
+                    // like a scan, the first mapping of a GUID wins
+                    guidIndex->insert(std::make_pair(std::string(kvp->getValue().c_str()),
+                                                     std::string(kvp->getKey().c_str())));
+                }
+            }
+            std::map<std::string, std::string>::const_iterator it = guidIndex->find(GUID);
+            return it != guidIndex->end() ? StringBuffer(it->second.c_str()) : StringBuffer("");
         }
 
         /**
@@ -109,18 +175,39 @@ class MappingsManager {
         * @returns true if ok, false otherwise
         */
         bool resetMappings() {  
+            if (inBatch) {
+                store->endBatch();
+                inBatch = false;
+            }
+            changed = false;
+            if (guidIndex) {
+                guidIndex->clear();
+            }
             return store->removeAllProperties() == 0 ? true : false;                        
         }
 
         /**
         * It persists properly the mappings element. They could be stored in such a 
         * temporary location and the method could be implemented to persistently in
-        * a definitive storage. Some store implementation could have this empty
+        * a definitive storage. Some store implementation could have this empty.
+        * It commits the mappings added since the last call, the store is not
+        * touched if there are none.
         *
         * @returns true if ok, false otherwise
         */
         bool closeMappings() {            
-            return store->close() == 0 ? true : false;
+            int ret = 0;
+            if (inBatch) {
+                ret = store->endBatch();
+                inBatch = false;
+            }
+            if (changed) {
+                if (store->close() != 0) {
+                    ret = -1;
+                }
+                changed = false;
+            }
+            return ret == 0 ? true : false;
         }
         
         /**
@@ -0,0 +1,209 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_SYNC_CHECKPOINT
+#define INCL_SYNC_CHECKPOINT
+/** @cond DEV */
+
+#include <set>
+#include <string>
+
+#include "base/fscapi.h"
+#include "base/util/KeyValueStore.h"
+#include "spds/constants.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/**
+ * The progress of the sync of a source, saved after each message the
+ * server has acknowledged, so that an interrupted sync can go on from
+ * there (see AccessConfig::setCheckpoints()).
+ *
+ * It holds the sync mode and the next anchor of the session, and the keys
+ * of the client items acknowledged by the server. The pending mappings
+ * are kept by the MappingsManager. The next sync of the source sends the
+ * resume alert (225): if the server resumes the session, or goes on with
+ * the same incremental sync, the acknowledged items are not sent again.
+ * Servers that don't answer the resume alert get the sync alert instead,
+ * and the same applies if they go on with the same incremental sync.
+ *
+ * The keys acknowledged are appended to the store and committed once per
+ * message. By default the store is a PropertyFile "<source>.chk" in the
+ * config folder.
+ */
+class SyncCheckpoint {
+
+private:
+
+    /// Where the checkpoint is saved, owned
+    KeyValueStore* store;
+
+    /// The sync mode of the session, SYNC_NONE if there is no checkpoint
+    SyncMode syncMode;
+
+    /// The sync mode requested by the client for the session
+    SyncMode preferredSyncMode;
+
+    /// The next anchor of the session, as timestamp
+    unsigned long nextSync;
+
+    /// True if the server did not answer a resume alert
+    bool resumeRefused;
+
+    /// True if the current sync goes on from the checkpoint
+    bool resumed;
+
+    /// True while the keys acknowledged are batched in the store
+    bool inBatch;
+
+    /// The keys of the items acknowledged by the server
+    std::set<std::string> acknowledged;
+
+    void read();
+
+    /// Writes the session properties.
+    int writeSession();
+
+public:
+
+    /**
+     * Opens the checkpoint of the source, in the config folder.
+     *
+     * @param sourceName - the name of the source
+     */
+    SyncCheckpoint(const char* sourceName);
+
+    /**
+     * Opens the checkpoint kept in the given store.
+     *
+     * @param s - the store, deleted by the checkpoint
+     */
+    SyncCheckpoint(KeyValueStore* s);
+
+    ~SyncCheckpoint();
+
+    /**
+     * True if there is a checkpoint of an interrupted sync, which was
+     * requested with the given sync mode and can be resumed.
+     */
+    bool canResume(SyncMode preferred) const;
+
+    /**
+     * True if the server goes on with the incremental sync of the
+     * checkpoint (two-way or one-way from client) in a new session, so
+     * that the items acknowledged need not be sent again.
+     *
+     * @param preferred  the sync mode requested by the client
+     * @param mode       the sync mode alerted by the server
+     */
+    bool canContinue(SyncMode preferred, SyncMode mode) const;
+
+    SyncMode getSyncMode() const { return syncMode; }
+
+    SyncMode getPreferredSyncMode() const { return preferredSyncMode; }
+
+    unsigned long getNextSync() const { return nextSync; }
+
+    /**
+     * Called when the server doesn't answer the resume alert: the next
+     * syncs won't send it again. The checkpoint is kept, for the sync
+     * alert sent instead.
+     */
+    void setResumeRefused();
+
+    bool isResumeRefused() const { return resumeRefused; }
+
+    /**
+     * Sets that the current sync goes on from the checkpoint: the items
+     * acknowledged are not sent again.
+     */
+    void setResumed(bool v) { resumed = v; }
+
+    bool isResumed() const { return resumed; }
+
+    /**
+     * Starts the checkpoint of a new session, dropping the previous one.
+     *
+     * @param mode          the sync mode of the session
+     * @param preferred     the sync mode requested by the client
+     * @param next          the next anchor of the session, as timestamp
+     * @return 0 on success, an error code otherwise
+     */
+    int start(SyncMode mode, SyncMode preferred, unsigned long next);
+
+    /**
+     * Goes on with the session of the checkpoint in a new session of the
+     * server: the keys acknowledged are kept, the next anchor is replaced.
+     *
+     * @param next          the next anchor of the new session, as timestamp
+     * @return 0 on success, an error code otherwise
+     */
+    int restart(unsigned long next);
+
+    /**
+     * Adds the key of an item acknowledged by the server. It is saved
+     * by commit().
+     */
+    void addAcknowledged(const char* key);
+
+    /**
+     * True if the item was acknowledged in the session of the checkpoint.
+     */
+    bool isAcknowledged(const char* key) const;
+
+    /// Number of items acknowledged
+    int getAcknowledgedCount() const { return (int)acknowledged.size(); }
+
+    /**
+     * Saves the keys added since the previous commit. Called once the
+     * statuses of a message have been processed.
+     *
+     * @return 0 on success, an error code otherwise
+     */
+    int commit();
+
+    /**
+     * Removes the checkpoint, when the sync has completed.
+     *
+     * @return 0 on success, an error code otherwise
+     */
+    int clear();
+};
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -107,6 +107,14 @@ BEGIN_NAMESPACE
          */
         SyncItem(const WCHAR* key);
 
+#ifndef WCHAR_IS_CHAR
+        /*
+         * Same as SyncItem(const WCHAR*), with the key in UTF-8.
+         * Where WCHAR is char it's the same constructor.
+         */
+        SyncItem(const char* key);
+#endif
+
         /*
          * Returns the SyncItem's key. If key is NULL, the internal buffer is
          * returned; if key is not NULL, the value is copied in the caller
@@ -124,6 +132,14 @@ BEGIN_NAMESPACE
          */
         void setKey(const WCHAR* key);
 
+#ifndef WCHAR_IS_CHAR
+        /*
+         * Changes the SyncItem key, given in UTF-8.
+         * Where WCHAR is char it's the same as setKey(const WCHAR*).
+         */
+        void setKey(const char* key);
+#endif
+
         /*
          * Sets the SyncItem modification timestamp. timestamp is a milliseconds
          * timestamp since a reference time (which is platform specific).
@@ -247,6 +263,13 @@ BEGIN_NAMESPACE
          */
         void setDataType(const WCHAR* type);
 
+#ifndef WCHAR_IS_CHAR
+        /*
+         * Sets the SyncItem data mime type, given in UTF-8
+         */
+        void setDataType(const char* type);
+#endif
+
         /*
          * Returns the SyncItem data mime type.
          */
@@ -279,6 +302,13 @@ BEGIN_NAMESPACE
          */
         void setTargetParent(const WCHAR* parent);
 
+#ifndef WCHAR_IS_CHAR
+        /**
+         * Sets the SyncItem targetParent, given in UTF-8
+         */
+        void setTargetParent(const char* parent);
+#endif
+
         /**
          * Returns the SyncItem sourceParent
          *
@@ -294,6 +324,13 @@ BEGIN_NAMESPACE
          */
         void setSourceParent(const WCHAR* parent);
 
+#ifndef WCHAR_IS_CHAR
+        /**
+         * Sets the SyncItem sourceParent, given in UTF-8
+         */
+        void setSourceParent(const char* parent);
+#endif
+
         /**
          * Creates a new instance of SyncItem from the content of this
          * object. The new instance is created the the C++ new operator and
@@ -43,24 +43,29 @@
 #include "spds/constants.h"
 #include "spds/SyncStatus.h"
 #include <string.h>
+#include <set>
+#include <string>
 #include "base/globalsdef.h"
 
 BEGIN_FUNAMBOL_NAMESPACE
 
    
-
+/**
+ * The keys of the items sent to the server, for each command, waiting for
+ * their status. The keys are kept in sets, so an item sent in more chunks
+ * (or more times) is counted once and the lookups don't scan a list.
+ */
 class SyncItemKeys {
 
-private:
+public:
+
+    typedef std::set<std::string> KeySet;
 
-    ArrayList addKeys;
-    ArrayList modKeys;
-    ArrayList delKeys;
+private:
 
-    ArrayList& getAddKeys();
-    ArrayList& getModKeys();
-    ArrayList& getDelKeys();
-    
+    KeySet addKeys;
+    KeySet modKeys;
+    KeySet delKeys;
 
 public:
     /*
@@ -83,7 +88,16 @@ public:
     */
     void clearKeys(const char* command);
 
-    ArrayList& getListKeys(const char* command);
+    /**
+    * Return the keys related to the command argument (the delete ones
+    * if the command is NULL or unknown)
+    */
+    KeySet& getKeys(const char* command);
+
+    /**
+    * Return true if the key was sent with the given command
+    */
+    bool contains(const char* command, const char* key);
    
 };
 
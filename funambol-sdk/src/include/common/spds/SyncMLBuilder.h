@@ -37,6 +37,9 @@
 #define INCL_SYNCML_BUILDER
 /** @cond DEV */
 
+#include <map>
+#include <string>
+
 #include "spds/DataTransformer.h"
 #include "spds/SyncSource.h"
 #include "spds/SyncMap.h"
@@ -64,15 +67,22 @@ public:
     SyncMLBuilder(char*  t, char*  d, SyncMLProtocolFlavour protocol = SYNCML_1_2);
     
     /*
-     * Convert the SyncML object into an xml message
+     * Convert the SyncML object into an xml message. The parts of the
+     * SyncHdr that don't change along the session are formatted once.
      */
     char*  prepareMsg(SyncML* syncml);
     
     /*
-     * Convert the SyncML object into an xml message
+     * Prepare a SyncML message with a copy of the given commands.
      */
     SyncML*  prepareSyncML(ArrayList* commands, bool final);
     
+    /*
+     * Same as prepareSyncML(), but the commands are moved into the
+     * message, not copied: the list is left empty.
+     */
+    SyncML*  prepareSyncMLAdopt(ArrayList* commands, bool final);
+    
     /*
      * Set init parameters.
      *
@@ -90,6 +100,13 @@ public:
     SyncML*  prepareInitObject(Cred* cred, ArrayList* alerts, ArrayList* commands,
                                unsigned long maxMsgSize = 0, unsigned long maxObjSize = 0);
     
+    /*
+     * Same as prepareInitObject(), but the commands are moved into the
+     * message (the list is left empty). The alerts are copied.
+     */
+    SyncML*  prepareInitObjectAdopt(Cred* cred, ArrayList* alerts, ArrayList* commands,
+                                    unsigned long maxMsgSize = 0, unsigned long maxObjSize = 0);
+    
     /*
      * Prepare the SyncHdr message with credential if not null
      *
@@ -99,9 +116,10 @@ public:
     SyncHdr* prepareSyncHdr(Cred* cred, unsigned long maxMsgSize = 0, unsigned long maxObjSize = 0);
     
     /*
-     * Prepare the init alert
+     * Prepare the init alert, with the preferred sync mode of the source
+     * or the resume alert code (225) if resume is true
      */
-    Alert*   prepareInitAlert(SyncSource& source, unsigned long maxObjSize = 0);
+    Alert*   prepareInitAlert(SyncSource& source, unsigned long maxObjSize = 0, bool resume = false);
     
     /*
      * Prepare the special init alert for Address Change Notification
@@ -134,6 +152,12 @@ public:
      */
     void     addItemStatus(ArrayList* previousStatus, Status* status);
     
+    /*
+     * Same as addItemStatus(), but the status is owned by the list from
+     * now on: the caller must not delete it.
+     */
+    void     adoptItemStatus(ArrayList* previousStatus, Status* status);
+    
     /*
      * Prepare the status for Sync command
      */
@@ -156,7 +180,8 @@ public:
     AbstractCommand* prepareServerDevInf();
     
     /*
-     * Prepare the Sync object. It doesn't contain any items. It is to prepare the insert of items
+     * Prepare the Sync object. It doesn't contain any items. It is to prepare the insert of items.
+     * Its Target and Source are formatted once per source.
      */
     Sync*    prepareSyncCommand(SyncSource& source);
     
@@ -180,7 +205,7 @@ public:
                            const char*  type, const char*  COMMAND);
     /*
      * @param syncItem
-     * @param chunk                             the chunk item to be added
+     * @param chunk                             the chunk item to be added, its data is moved into the item
      * @param COMMAND                           REPLACE_COMMAND_NAME, ADD_COMMAND_NAME, DELETE_COMMAND_NAME
      * @return item                             the Item object to be added in the list of command
      */
@@ -194,6 +219,11 @@ public:
      */
     void     addMapItem(Map* map, MapItem* mapItem);
     
+    /*
+     * Add the MapItem to the Map command, that takes its ownership.
+     */
+    void     adoptMapItem(Map* map, MapItem* mapItem);
+    
     /*
      * Add a SyncItem into the modificationCommand. It is responsible to collapse if needed.
      * If the modificationCommand is NULL, then this is the first item and modificationCommand
@@ -215,7 +245,8 @@ public:
     /*
      * Add a Chunk into the modificationCommand.
      * If the modificationCommand is NULL, then this is the first item and modificationCommand
-     * is initialized.
+     * is initialized. The data of the chunk is moved into the new Item without copying
+     * it, so the chunk is left empty.
      *
      * @param[in, out] modificationCommand      new items are added here, created if necessary
      * @param COMMAND                           REPLACE_COMMAND_NAME, ADD_COMMAND_NAME, DELETE_COMMAND_NAME
@@ -261,7 +292,7 @@ private:
     SyncMLProtocolFlavour protocol;
     
     /**
-     * get the ComplexData given the chunk
+     * get the ComplexData given the chunk, moving the chunk's data into it
      *
      * @param chunk   the chunk item
      * @return the complex data
@@ -275,6 +306,27 @@ private:
     
     ComplexData* getComplexData(SyncItem* syncItem, long &syncItemOffset, long maxBytes, long &sentBytes);
     
+    /*
+     * Format the SyncHdr as Formatter::getSyncHdr() does, reusing the parts
+     * formatted for the previous messages if their values are the same.
+     */
+    StringBuffer* formatSyncHdr(SyncHdr* syncHdr);
+    
+    /*
+     * The XML of the VerDTD, VerProto and SessionID of the SyncHdr, and of
+     * its Target and Source, with the values they were formatted from.
+     */
+    StringBuffer hdrSession;
+    StringBuffer hdrSessionValues;
+    StringBuffer hdrAddress;
+    StringBuffer hdrAddressValues;
+    
+    /*
+     * The XML of the Target and Source of the Sync command of each source,
+     * by source URI and name.
+     */
+    std::map<std::string, StringBuffer> syncTargetSources;
+    
 };
 
 
@@ -48,6 +48,7 @@
     #include "syncml/parser/Parser.h"
     #include "spds/SyncReport.h"
     #include "spds/SyncItemKeys.h"
+    #include "spds/SyncCheckpoint.h"
     #include "spds/SyncMLBuilder.h"
 
 BEGIN_NAMESPACE
@@ -163,8 +164,10 @@ BEGIN_NAMESPACE
         /*
          * Process the SyncBody and looks for the item status of the sent items.
          * It calls the setItemStatus method of the sync source.
+         * The items accepted by the server are added to the checkpoint, if given.
          */
-        int processItemStatus(SyncSource& source, SyncBody* syncBody, SyncItemKeys& syncItemKeys);
+        int processItemStatus(SyncSource& source, SyncBody* syncBody, SyncItemKeys& syncItemKeys,
+                              SyncCheckpoint* checkpoint = NULL);
 
         /*
          * Processes the response and get the Sync command of the given source
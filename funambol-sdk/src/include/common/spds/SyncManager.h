@@ -51,6 +51,7 @@
 #include "spds/CredentialHandler.h"
 #include "spds/SyncReport.h"
 #include "spds/MappingsManager.h"
+#include "spds/SyncCheckpoint.h"
 
 // Tolerance to data size for incoming items (106%) -> will be allocated some more space.
 #define DATA_SIZE_TOLERANCE      1.06
@@ -151,6 +152,7 @@ class SyncManager {
          * correspondent LUID (key) associated to the passed GUID (value).
          * It's used in case the SourceParent sent by the Server on a ADD command is a 
          * GUID value, it can happen if the Client didn't reply yet with the corresponding mapping.
+         * The sync uses MappingsManager::lookupMapping() instead, which doesn't scan.
          * @note If GUID not found, the passed GUID is returned.
          * 
          * @param mappings the mappings Enumeration of KeyValuePair (LUID,GUID) to search into
@@ -204,6 +206,10 @@ class SyncManager {
         ArrayList items;
         
         MappingsManager** mmanager;
+
+        /// The checkpoints of the sources, NULL if checkpoints are disabled
+        /// (see AbstractSyncConfig::getCheckpoints())
+        SyncCheckpoint** checkpoints;
         // Now using sources[i].checkState() method
         //int* check;
 
@@ -304,12 +310,46 @@ class SyncManager {
          */
         SyncItem* getItem(SyncSource& source, SyncItem* (SyncSource::* getItem)());
 
+        /**
+         * Formats the SyncML message with the syncMLBuilder, starting its
+         * counters in the SyncStats of the report.
+         * @return the new message, to be freed by the caller
+         */
+        char* formatMessage(SyncML* syncml);
+
+        /**
+         * Sends the message with the transportAgent, accounting the
+         * transport phases in the SyncStats of the report.
+         * @return the server response, NULL in case of error
+         */
+        char* exchangeMessage(const char* msg);
+
+        /**
+         * Parses the server response with the syncMLProcessor, accounting
+         * PHASE_PARSE in the SyncStats of the report.
+         */
+        SyncML* parseMessage(char* msg);
+
         /**
          * Add the map command according to the current value of the 
          * member 'mappings', and clean up the member afterwards.
          */
         void addMapCommand(int sourceIndex);    
 
+        /**
+         * Sets up the checkpoint of the source once the server has answered
+         * its alert: the sync goes on from the checkpoint if the server
+         * resumes the session, or keeps the same incremental sync mode;
+         * otherwise a new checkpoint is started.
+         *
+         * @param sourceIndex      the index of the source
+         * @param preferred        the sync mode requested by the client
+         * @param resumeRequested  true if the resume alert was sent
+         * @return true if the server did not answer the resume alert: the
+         *         sync alert must be sent instead, the checkpoint is kept
+         */
+        bool initCheckpoint(int sourceIndex, SyncMode preferred, bool resumeRequested);
+
 };
 
 
@@ -214,6 +214,8 @@ class SyncManagerConfig : public AbstractSyncConfig {
         virtual unsigned long getReadBufferSize() const { return getAccessConfig().getReadBufferSize(); }
         virtual const char*  getUserAgent() const { return getAccessConfig().getUserAgent(); }
         virtual bool  getCompression() const { return getAccessConfig().getCompression(); }
+        virtual bool  getWBXML() const { return getAccessConfig().getWBXML(); }
+        virtual bool  getCheckpoints() const { return getAccessConfig().getCheckpoints(); }
         virtual unsigned int getResponseTimeout() const { return getAccessConfig().getResponseTimeout(); }
         virtual bool  getSSLVerifyServer() const { return sslServerVerifier; }
         virtual void  setSSLVerifyServer(bool val) { sslServerVerifier = val; }
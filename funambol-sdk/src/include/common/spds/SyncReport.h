@@ -45,6 +45,7 @@
 #include "spds/SyncSource.h"
 #include "spds/constants.h"
 #include "spds/SyncSourceReport.h"
+#include "spds/SyncStats.h"
 #include "spds/AbstractSyncConfig.h"
 
 
@@ -91,6 +92,9 @@ private:
     // Array of SyncSourceReport for each SyncSource.
     ArrayList ssReport;
 
+    // Performance counters of the sync.
+    SyncStats stats;
+
 
     /*
      * Function to initialize members.
@@ -174,6 +178,14 @@ public:
      */
     void toString(StringBuffer &str, bool verbose = false);
 
+    /**
+     * The performance counters of the last sync (time and bytes of each
+     * phase, per source and per message), filled by the SyncManager.
+     * Use SyncStats::toJSON() to export them.
+     */
+    SyncStats& getStats() { return stats; }
+    const SyncStats& getStats() const { return stats; }
+
     /**
      * Assign operator
      */
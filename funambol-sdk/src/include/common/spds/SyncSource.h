@@ -39,8 +39,11 @@
 /** @addtogroup Client */
 /** @{ */
 
+#include <vector>
+
 #include "base/fscapi.h"
 #include "base/util/ArrayElement.h"
+#include "base/util/utils.h"
 #include "filter/SourceFilter.h"
 #include "spds/constants.h"
 #include "spds/SyncItem.h"
@@ -78,8 +81,26 @@ protected:
      */
     void assign(SyncSource& s);
 
+    /**
+     * Applies the items with addItem(), updateItem() and deleteItem(),
+     * the independent ones in parallel on the TaskExecutor, and returns
+     * once they are all applied. Used by applyItems() for thread safe
+     * sources.
+     */
+    void applyItemsInParallel(ArrayList& items);
+
 public:
 
+    /**
+     * The status returned by the server for one of the items sent by
+     * the client, see setItemStatuses(). The strings belong to the caller.
+     */
+    struct ItemStatus {
+        const char*  key;       /**< the local key of the item, in UTF-8 */
+        int          status;    /**< the SyncML status returned by the server */
+        const char*  command;   /**< the SyncML command associated to the item */
+    };
+
     /**
      * Constructor: create a SyncSource with the specified name
      *
@@ -277,6 +298,32 @@ public:
                                const char* /* command */) {
         setItemStatus(key, status);
     }
+
+#ifndef WCHAR_IS_CHAR
+    /**
+     * Same as setItemStatus(const WCHAR*, int, const char*), with the key
+     * in UTF-8: the default implementation converts it and calls that one.
+     * Where WCHAR is char it's the same method.
+     */
+    virtual void setItemStatus(const char* key, int status, const char* command) {
+        setItemStatus(CharAsWChar(key).c_str(), status, command);
+    }
+#endif
+
+    /**
+     * called by the sync engine with all the item statuses returned by
+     * the server in a message, in the order they were received. Sources
+     * that can apply them at once (e.g. in a single transaction) should
+     * override it: the default implementation calls setItemStatus() for
+     * each one.
+     *
+     * @param statuses  the statuses of the items
+     */
+    virtual void setItemStatuses(const std::vector<ItemStatus>& statuses) {
+        for (size_t i = 0; i < statuses.size(); i++) {
+            setItemStatus(statuses[i].key, statuses[i].status, statuses[i].command);
+        }
+    }
     
     /**
     * Indicates that all the server status of the current package 
@@ -388,7 +435,24 @@ public:
      */
     virtual int deleteItem(SyncItem& item) = 0;
  
+    /**
+     * Applies the items of a server package: adds, updates and deletes
+     * them, saves the address book and updates the info and status of the
+     * new items. The items must be SyncItem*, in the order of the commands.
+     * If the source is thread safe (see isThreadSafe()) the items which do
+     * not depend on each other are applied in parallel by the TaskExecutor.
+     */
     virtual void applyItems(ArrayList& items);           
+
+    /**
+     * Returns true if addItem(), updateItem() and deleteItem() can be
+     * called at the same time from different threads, for different items.
+     * A source returning true lets applyItems() apply the independent
+     * items of a package in parallel: the items with the same key, or
+     * whose parent is another item of the package, are still applied in
+     * order. By default false.
+     */
+    virtual bool isThreadSafe() { return false; }
     
     /**
      * Return the number of elements in this source (-1) if unknown
@@ -222,6 +222,18 @@ public:
     
     ItemReport* find(const char* target, const char* command, const WCHAR* ID);
 
+#ifndef WCHAR_IS_CHAR
+    /**
+     * Same as addItem(const char*, const char*, const WCHAR*, const int, const WCHAR*),
+     * with the ID and the message in UTF-8. The items are indexed by the
+     * UTF-8 ID, so this is the one to use in the sync.
+     * Where WCHAR is char it's the same method.
+     */
+    void addItem(const char* target, const char* command, const char* ID, const int status, const char* statusMessage);
+
+    ItemReport* find(const char* target, const char* command, const char* ID);
+#endif
+
     /**
      * Utility to switch on the right list, based on target and command.
      *
@@ -0,0 +1,165 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_SYNCSTATS
+#define INCL_SYNCSTATS
+/** @cond API */
+/** @addtogroup Client */
+/** @{ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/// Max number of SyncML messages whose counters are kept one by one
+#define SYNC_STATS_MAX_MESSAGES     256
+
+/** The phases of a sync measured by SyncStats */
+typedef enum SyncPhase {
+    PHASE_PREPARE_SYNC = 0,     /**< SyncManager::prepareSync(), transport included */
+    PHASE_CHANGE_DETECTION,     /**< SyncSource::beginSync(): local change detection */
+    PHASE_ITEM_READ,            /**< reading and encoding the outgoing items */
+    PHASE_FORMAT,               /**< serializing the SyncML messages (Formatter, WBXMLEncoder) */
+    PHASE_TRANSPORT_SEND,       /**< transport: until the request is sent (connection) */
+    PHASE_TRANSPORT_WAIT,       /**< transport: request upload and server processing */
+    PHASE_TRANSPORT_RECEIVE,    /**< transport: response download */
+    PHASE_PARSE,                /**< parsing the server messages (WBXMLDecoder, Parser) */
+    PHASE_APPLY_CHANGES,        /**< applying the server changes to the sources */
+    PHASE_CACHE_SAVE,           /**< SyncSource::endSync(): saving cache and anchors */
+    SYNC_PHASE_COUNT
+} SyncPhase;
+
+/** The counters of a phase */
+struct PhaseCounter {
+    int64_t time;               /**< elapsed time, in microseconds */
+    int64_t bytes;              /**< bytes handled by the phase */
+    int32_t calls;              /**< number of times the phase ran */
+};
+
+/**
+ * Performance counters of a sync, kept by the SyncManager in the SyncReport:
+ * time and bytes of each phase, in total, per source and per SyncML message.
+ * The times come from a monotonic clock. When the transport agent does not
+ * measure its steps, the whole exchange is accounted as PHASE_TRANSPORT_WAIT.
+ * toJSON() exports the counters, so they can be collected without debug logs.
+ */
+class SyncStats {
+
+public:
+
+    SyncStats();
+
+    /// Clears all the counters.
+    void reset();
+
+    /**
+     * Adds a run of the phase.
+     * @param phase   the phase
+     * @param micros  elapsed time, in microseconds
+     * @param bytes   bytes handled, if any
+     * @param source  the source name, NULL if the phase is not per source
+     */
+    void add(SyncPhase phase, int64_t micros, int64_t bytes = 0, const char* source = NULL);
+
+    /**
+     * Starts the counters of a new SyncML message: the phases added from
+     * now on are also accounted to it.
+     */
+    void beginMessage();
+
+    /// The counters of the phase, in total or for the given source.
+    PhaseCounter getCounter(SyncPhase phase, const char* source = NULL) const;
+
+    /// Number of SyncML messages exchanged.
+    int getMessageCount() const { return messageCount; }
+
+    /**
+     * Appends the counters to 'out' as a JSON object:
+     * {"messages":N, "totals":{phase:{"usec":..,"bytes":..,"calls":..}},
+     *  "sources":{name:{...}}, "perMessage":[{...}]}
+     * Phases which never ran are omitted.
+     */
+    void toJSON(StringBuffer& out, bool prettyPrint = false) const;
+
+    /// The name of the phase, as used in the JSON output.
+    static const char* getPhaseName(SyncPhase phase);
+
+    /// Current time from a monotonic clock, in microseconds.
+    static int64_t now();
+
+    /**
+     * Measures the enclosing scope as a run of the phase.
+     */
+    class Timer {
+    public:
+        Timer(SyncStats& s, SyncPhase p, const char* src = NULL)
+            : stats(s), phase(p), source(src), bytes(0), start(SyncStats::now()) {}
+        ~Timer() { stats.add(phase, SyncStats::now() - start, bytes, source); }
+
+        /// Sets the bytes handled by the phase.
+        void setBytes(int64_t b) { bytes = b; }
+
+    private:
+        SyncStats&  stats;
+        SyncPhase   phase;
+        const char* source;
+        int64_t     bytes;
+        int64_t     start;
+    };
+
+private:
+
+    struct Counters {
+        PhaseCounter phase[SYNC_PHASE_COUNT];
+        Counters();
+    };
+
+    Counters totals;
+    std::map<std::string, Counters> sources;
+    std::vector<Counters> messages;
+    int messageCount;
+};
+
+END_NAMESPACE
+
+/** @} */
+/** @endcond */
+#endif
@@ -92,6 +92,10 @@ typedef enum SyncMode{
         SYNC_ADDR_CHANGE_NOTIFICATION               = 745
 } SyncMode;
 
+/// Alert code sent to resume a suspended session: it is not a sync mode,
+/// so it is kept out of the SyncMode enum
+#define SYNC_ALERT_RESUME                       225
+
 /// Used by devInfo sync capabilities
 static const struct {
     SyncMode mode;
@@ -83,6 +83,14 @@ class Data {
      */
     void setData(const char*  data);
 
+    /**
+     * Sets the data property without duplicating it: this object takes
+     * the ownership of the buffer, which must be allocated with new[].
+     *
+     * @param data the data property
+     */
+    void adoptData(char*  data);
+
     /**
      * Gets the data properties
      *
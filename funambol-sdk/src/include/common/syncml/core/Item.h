@@ -194,6 +194,14 @@ class Item : public ArrayElement {
          */
         void setData(ComplexData* data);
 
+        /**
+         * Sets the item data without duplicating it: this object takes
+         * its ownership.
+         *
+         * @param data the item data - can be NULL
+         */
+        void adoptData(ComplexData* data);
+
         /**
          * Gets the Boolean value of moreData
          *
@@ -113,6 +113,14 @@ class ItemizedCommand : public AbstractCommand {
          */
         void setItems(ArrayList* items);
 
+        /**
+         * Replaces the items with the ones of the given list, moving them
+         * without duplicating: the given list is left empty.
+         *
+         * @param items the list of Item objects to move - NULL ALLOWED
+         */
+        void adoptItems(ArrayList* items);
+
         /**
          * Gets the Meta object
          *
@@ -129,6 +129,14 @@ class Map : public AbstractCommand {
          */
         void setMapItems(ArrayList* mapItems);
 
+        /**
+         * Replaces the map items with the ones of the given list, moving
+         * them without duplicating: the given list is left empty.
+         *
+         * @param mapItems the map items to move - NOT NULL
+         */
+        void adoptMapItems(ArrayList* mapItems);
+
         /**
          * Returns the command name
          *
@@ -40,6 +40,7 @@
 
 #include "base/fscapi.h"
 #include "base/util/ArrayList.h"
+#include "base/util/StringBuffer.h"
 #include "syncml/core/AbstractCommand.h"
 #include "syncml/core/Source.h"
 #include "syncml/core/Target.h"
@@ -59,6 +60,7 @@ class Sync : public AbstractCommand {
         Source* source;
         ArrayList* commands;
         long numberOfChanges;
+        StringBuffer formattedTargetSource;
 
     public:
 
@@ -138,6 +140,14 @@ class Sync : public AbstractCommand {
          */
         void setCommands(ArrayList* commands);
 
+        /**
+         * Replaces the sequenced commands with the ones of the given list,
+         * moving them without duplicating: the given list is left empty.
+         *
+         * @param commands the commands to move - NOT NULL
+         */
+        void adoptCommands(ArrayList* commands);
+
         /**
          * Gets the total number of changes
          *
@@ -153,6 +163,21 @@ class Sync : public AbstractCommand {
          */
         void setNumberOfChanges(long numberOfChanges) ;
 
+        /**
+         * Sets the XML of the target and of the source, already formatted
+         * once for all the Sync commands of the same source: the Formatter
+         * uses it instead of formatting them again. It's dropped if the
+         * target or the source change.
+         *
+         * @param xml the formatted Target and Source, NULL to drop it
+         */
+        void setFormattedTargetSource(const char* xml);
+
+        /**
+         * Gets the XML set by setFormattedTargetSource(), NULL if none
+         */
+        const char* getFormattedTargetSource();
+
         const char* getName();
 
         ArrayElement* clone();
@@ -91,6 +91,14 @@ class SyncBody {
          */
         void setCommands(ArrayList* commands);
 
+        /**
+         * Replaces the commands with the ones of the given list, moving
+         * them without duplicating: the given list is left empty.
+         *
+         * @param commands the commands to move - NOT NULL
+         */
+        void adoptCommands(ArrayList* commands);
+
         /**
          * Sets the message as final
          *
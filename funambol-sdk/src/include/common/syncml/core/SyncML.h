@@ -86,6 +86,14 @@ class SyncML {
          */
         void setSyncHdr(SyncHdr* header);
 
+        /**
+         * Sets the SyncML header without duplicating it: this object
+         * takes its ownership.
+         *
+         * @param header the SyncML header - NOT NULL
+         */
+        void adoptSyncHdr(SyncHdr* header);
+
         /**
          * Returns the SyncML body
          *
@@ -102,6 +110,14 @@ class SyncML {
          */
         void setSyncBody(SyncBody* body);
 
+        /**
+         * Sets the SyncML body without duplicating it: this object takes
+         * its ownership.
+         *
+         * @param body the SyncML body - NOT NULL
+         */
+        void adoptSyncBody(SyncBody* body);
+
         /**
          * Is this message the last one of the package?
          *
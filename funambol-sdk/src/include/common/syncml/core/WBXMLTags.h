@@ -0,0 +1,120 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#ifndef INCL_WBXML_TAGS
+#define INCL_WBXML_TAGS
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+// WBXML global tokens (WAP-192-WBXML)
+#define WBXML_SWITCH_PAGE       0x00
+#define WBXML_END               0x01
+#define WBXML_ENTITY            0x02
+#define WBXML_STR_I             0x03
+#define WBXML_LITERAL           0x04
+#define WBXML_PI                0x43
+#define WBXML_STR_T             0x83
+#define WBXML_OPAQUE            0xC3
+
+// Tag token flags
+#define WBXML_TAG_MASK          0x3F
+#define WBXML_TAG_CONTENT       0x40
+#define WBXML_TAG_ATTRIBUTES    0x80
+
+#define WBXML_VERSION_1_2       0x02
+#define WBXML_CHARSET_UTF8      106
+
+// Code pages of the SyncML document; DevInf uses page 0 of its own document
+#define WBXML_PAGE_SYNCML       0
+#define WBXML_PAGE_METINF       1
+
+/**
+ * The WBXML document types used by SyncML DS: the SyncML messages
+ * (with the MetInf code page) and the DevInf embedded in them.
+ */
+typedef enum {
+    WBXML_DOC_SYNCML = 0,
+    WBXML_DOC_DEVINF
+} WBXMLDocType;
+
+/**
+ * The SyncML 1.1/1.2 WBXML code pages: maps the tag names of the
+ * SyncML, MetInf and DevInf DTDs to their tokens and back.
+ */
+class WBXMLTags {
+
+public:
+
+    /**
+     * Returns the tag name of the given token, or NULL if the token
+     * is not defined in the code page.
+     */
+    static const char* getTagName(WBXMLDocType doc, int page, int token);
+
+    /**
+     * Returns the token of the tag name (len chars of name) in the
+     * code page, or -1 if the tag is not defined there.
+     */
+    static int getToken(WBXMLDocType doc, int page, const char* name, size_t len);
+
+    /**
+     * Returns the formal public identifier of the document type for the
+     * given DTD version ("1.0", "1.1" or "1.2"; 1.1 if not recognized).
+     */
+    static const char* getPublicId(WBXMLDocType doc, const char* verDTD);
+
+    /**
+     * Resolves a well-known numeric public identifier.
+     * @return false if the identifier is not a SyncML or DevInf one
+     */
+    static bool getDocType(unsigned int publicId, WBXMLDocType* doc);
+
+    /**
+     * Resolves a formal public identifier, like "-//SYNCML//DTD SyncML 1.2//EN".
+     * @return false if the identifier is not a SyncML or DevInf one
+     */
+    static bool getDocType(const char* publicId, WBXMLDocType* doc);
+};
+
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#ifndef INCL_WBXML_ENCODER
+#define INCL_WBXML_ENCODER
+/** @cond DEV */
+
+#include <string>
+#include <map>
+
+#include "base/fscapi.h"
+#include "syncml/core/WBXMLTags.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/**
+ * Encodes the SyncML messages produced by the Formatter as WBXML
+ * (application/vnd.syncml+wbxml), using the SyncML 1.1/1.2 code pages.
+ *
+ * Tags of the "syncml:metinf" namespace go to the MetInf code page; a DevInf
+ * ("syncml:devinf" namespace) is encoded as a WBXML document of its own and
+ * carried as opaque data, CDATA sections as opaque data and the other text
+ * as strings, the longer ones shared through the string table. Tags not defined in the code pages are encoded as
+ * literals; attributes other than the namespace are dropped.
+ */
+class WBXMLEncoder {
+
+public:
+
+    /**
+     * Encodes the XML message.
+     *
+     * @param xml   the SyncML message
+     * @param size  [out] the size of the encoded message
+     * @return      the new allocated message (to be freed with delete []),
+     *              NULL if the XML is not well formed
+     */
+    static char* encode(const char* xml, unsigned int* size);
+
+private:
+
+    WBXMLEncoder(const char* xml, WBXMLDocType doc);
+
+    bool encodeDocument(std::string& out);
+    bool encodeElement(int page);
+    bool encodeContent(int page, const char* name, size_t nameLen);
+    bool encodeEmbeddedDevInf(const char* start);
+
+    bool skipMarkup();
+    void switchPage(int page);
+    void appendText(const char* text, size_t len);
+    void appendOpaque(const char* data, size_t len);
+    unsigned int addString(const char* s, size_t len);
+
+    const char*  pos;
+    WBXMLDocType document;
+    int          codePage;
+    std::string  body;
+    std::string  strtbl;
+    std::map<std::string, unsigned int> strings;
+};
+
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#ifndef INCL_WBXML_DECODER
+#define INCL_WBXML_DECODER
+/** @cond DEV */
+
+#include <string>
+
+#include "base/fscapi.h"
+#include "syncml/core/WBXMLTags.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/**
+ * Decodes the WBXML SyncML messages (application/vnd.syncml+wbxml) to the
+ * XML form accepted by the Parser. It is the reverse of the WBXMLEncoder:
+ * opaque data becomes a CDATA section, unless it is an embedded DevInf
+ * document, which is decoded in place.
+ */
+class WBXMLDecoder {
+
+public:
+
+    /**
+     * True if the data looks like a WBXML document and not like XML.
+     */
+    static bool isWBXML(const char* data, unsigned int size);
+
+    /**
+     * Decodes the WBXML message.
+     *
+     * @param data  the WBXML message
+     * @param size  the size of the message
+     * @return      the new allocated XML message (to be freed with
+     *              delete []), NULL if the message is not valid WBXML
+     */
+    static char* decode(const char* data, unsigned int size);
+
+private:
+
+    WBXMLDecoder(const char* data, unsigned int size);
+
+    bool readHeader();
+    bool decodeBody(std::string& out);
+    bool decodeElement(std::string& out, unsigned char tag, int parentPage);
+    bool decodeOpaque(std::string& out, const char* data, unsigned int len);
+
+    bool readByte(unsigned char* b);
+    bool readMbUInt(unsigned int* value);
+    bool readInlineString(const char** s, unsigned int* len);
+    const char* getString(unsigned int index);
+
+    const unsigned char* data;
+    unsigned int size;
+    unsigned int pos;
+    WBXMLDocType document;
+    int          codePage;
+    const char*  strtbl;
+    unsigned int strtblSize;
+};
+
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -83,6 +83,8 @@
 /* map WCHAR and its functions back to standard functions */
 #       undef WCHAR
 #       define WCHAR char
+/* the UTF-8 overloads of the WCHAR methods are the methods themselves */
+#       define WCHAR_IS_CHAR
 #       define WCHAR_PRINTF "s"
 #       define TEXT(_x) _x
 
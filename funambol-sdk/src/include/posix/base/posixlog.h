@@ -43,13 +43,27 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <pthread.h>
 #include "base/globalsdef.h"
 
 BEGIN_NAMESPACE
 
+/** size of the buffer where each thread queues its messages */
+#define LOG_RING_SIZE       (64 * 1024)
+/** messages longer than this are queued in a separate heap buffer */
+#define LOG_INLINE_SIZE     1024
+/** max time (msec) a queued message waits before being written */
+#define LOG_WRITER_PERIOD   100
+
 /**
  * extended API, can only be used if it is certain that
  * Log::instance() returns a POSIXLog
+ *
+ * By default messages are written asynchronously: each thread formats its
+ * messages into its own lock-free ring buffer, and a background writer
+ * thread prints them in order into the log file. Pending messages are
+ * written before the log file is changed, by flush(), when the process
+ * exits (setFlushOnExit()) and when it crashes (setFlushOnCrash()).
  */
 class POSIXLog : public Log {
  public:
@@ -101,6 +115,61 @@ class POSIXLog : public Log {
     virtual void reset(const char* title = NULL);
     virtual size_t getLogSize();
 
+    /**
+     * Enables (default) or disables the asynchronous writer. When
+     * disabled, messages are written by the calling thread.
+     */
+    void setAsync(bool enabled);
+    bool isAsync() const { return async; }
+
+    /**
+     * Waits until all the queued messages have been written.
+     */
+    void flush();
+
+    /**
+     * Writes the pending messages when the process exits normally
+     * (an atexit() handler is registered when the writer starts or when
+     * enabled). Enabled by default.
+     */
+    void setFlushOnExit(bool enabled);
+
+    /**
+     * Installs handlers for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT
+     * that write the pending messages before the process dies, then
+     * re-raise the signal. Signals already handled by the application are
+     * left alone; disabling restores the previous handlers.
+     * Only async-signal-safe calls are made: the queued messages are
+     * written as they are (no time stamp) with write(2), so a message
+     * being written by the writer thread at the time may be duplicated.
+     * Enabled by default: the handlers are installed when the writer
+     * starts. Disable it before logging to leave the signals alone.
+     */
+    void setFlushOnCrash(bool enabled);
+
+    /**
+     * Enables the size based rotation of the log file: when the file
+     * grows over maxSize bytes it is renamed to <name>.1 and a new one is
+     * started. Older segments are shifted up to <name>.<maxCount>, beyond
+     * that they are removed.
+     * If compress is set (and the library is built with USE_ZLIB) each
+     * rotated segment is gzipped in background into <name>.1.gz. While a
+     * segment is being compressed the log is not rotated: the file may
+     * grow a bit over maxSize.
+     *
+     * @param maxSize   max size of the log file in bytes, 0 disables rotation
+     * @param maxCount  number of rotated segments kept
+     * @param compress  true to gzip the rotated segments
+     */
+    void setLogRotation(size_t maxSize, unsigned int maxCount, bool compress = true);
+
+    /**
+     * Rotates the log file now, whatever its size, once the compression
+     * of the last rotated segment (if any) is done.
+     * @return true if the file has been rotated
+     */
+    bool rotate();
+
  protected:
     /**
      * Prints a single line to the current log file.
@@ -141,9 +210,93 @@ class POSIXLog : public Log {
      */
     StringBuffer prefix;
 
+    /**
+     * the prefix of the message being printed: it is the one set
+     * when the message was logged, not the current one
+     */
+    const char* linePrefix;
+
+    /**
+     * time stamps of the last printed second: they are formatted
+     * only once per second
+     */
+    time_t cachedTime;
+    char fullTime[64];
+    char shortTime[32];
+    char utcTime[32];
+
+    /** full name of the log file, "" if logging to stdout */
+    StringBuffer logFileName;
+
+    /** descriptor of the log file for the crash handler, -1 while it is being changed */
+    volatile int crashFd;
+
+    size_t rotateMaxSize;
+    unsigned int rotateMaxCount;
+    bool rotateCompress;
+
+    /** the thread compressing the last rotated segment */
+    pthread_t compressThread;
+    bool compressing;
+    /** set (under logMutex) when compressThread is about to exit */
+    bool compressDone;
+    pthread_cond_t compressCond;
+    StringBuffer compressSource;
+
+    void openLogFile(const char *path, const char* name, bool redirectStderr);
+    void checkRotation();
+    bool rotateLogSegments();
+    void waitCompression();
+    static void* compressMain(void* arg);
     void printMessage(LogLevel level, const char* levelPrefix, const char* msg, va_list argList);
-    
+    void printText(time_t t, LogLevel level, const char* levelPrefix, const char* text);
+    void updateTimestamps(time_t t);
+
+    /** guards the log file and the printing: recursive */
     pthread_mutex_t logMutex;
+
+    //
+    // Asynchronous writer
+    //
+    struct LogRing;
+
+    bool async;
+    volatile bool writerStarted;
+    volatile bool writerStop;
+    pthread_t writerThread;
+    pthread_mutex_t writerMutex;
+    pthread_cond_t writerCond;
+    pthread_cond_t flushedCond;
+
+    /** number of flush() waiting for the writer */
+    int flushRequests;
+    /** number of writing rounds completed by the writer */
+    unsigned int writerRound;
+    /** writePending() in progress, guarded by logMutex */
+    bool draining;
+
+    /** global order of the queued messages */
+    volatile uint64_t sequence;
+
+    /** the ring of each thread, the key owns nothing */
+    pthread_key_t ringKey;
+    /** all the rings: added with writerMutex, removed by the writer */
+    LogRing* volatile rings;
+
+    LogRing* getThreadRing();
+    bool queueMessage(LogLevel level, const char* levelPrefix, const char* msg, va_list argList);
+    bool startWriter();
+    void stopWriter();
+    bool writePending();
+    void releaseOrphanedRings();
+    void updateCrashFd();
+    void writeOnCrash();
+
+    static void* writerMain(void* arg);
+    static void threadExited(void* ring);
+    static void flushAtExit();
+    static void setCrashHandlers(bool enabled);
+    static void crashHandler(int sig);
 };
 
 #define POSIX_LOG ((POSIXLog &)Log::instance())
@@ -0,0 +1,163 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_EVENT_BUS
+#define INCL_EVENT_BUS
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+
+#include "event/EventDispatcher.h"
+#include "event/TransportEvent.h"
+#include "push/FThread.h"
+
+#include <pthread.h>
+#include <vector>
+
+/// Default max number of events delivered by the EventBus in one batch
+#define EVENT_BUS_BATCH_SIZE            64
+/// Default min time (msec) between two progress events of the same type
+#define EVENT_BUS_PROGRESS_INTERVAL     200
+
+namespace Funambol {
+
+/**
+ * An EventDispatcher delivering the events on its own thread, so a slow
+ * listener does not slow down the sync.
+ * The fire functions push the events on a lock-free queue (many producers,
+ * one consumer); the dispatching thread drains it in batches of up to
+ * batchSize events, delivered with the listener lists read once per batch:
+ *  - consecutive SyncItemEvents go to SyncItemListener::itemEvents() at once;
+ *  - the transport progress events (DATA_SENT, DATA_RECEIVED) are merged,
+ *    summing their sizes, and delivered at most once per progressInterval
+ *    msec; the merged data is delivered before any other TransportEvent.
+ * The order of the other events is preserved.
+ *
+ * Usage:
+ *     EventBus bus;
+ *     bus.start();         // the fire functions now queue on the bus
+ *     ...
+ *     bus.stop();          // delivers the queued events, back to sync mode
+ */
+class EventBus : public EventDispatcher, public FThread {
+
+public:
+
+    EventBus(int batchSize = EVENT_BUS_BATCH_SIZE,
+             int progressInterval = EVENT_BUS_PROGRESS_INTERVAL);
+
+    /// Stops the bus, if started.
+    ~EventBus();
+
+    /// Starts the dispatching thread and sets the bus on the ManageListener.
+    void start(Priority priority = InheritPriority);
+
+    /**
+     * Unsets the bus from the ManageListener, delivers the queued events
+     * and stops the dispatching thread.
+     */
+    void stop();
+
+    /**
+     * Queues the event (lock-free).
+     * @return false if the bus is not started (event not taken)
+     */
+    bool dispatch(EventFamily family, BaseEvent* event);
+
+    /**
+     * Waits until the events queued so far, merged progress included,
+     * are delivered. Returns at once if called by a listener.
+     */
+    void flush();
+
+    /// Number of events queued and not yet delivered.
+    long pending() const { return posted - delivered; }
+
+    /// Asks the thread to stop, once the queued events are delivered.
+    void softTerminate();
+
+protected:
+    void run();
+
+private:
+
+    struct Node {
+        Node* volatile next;
+        EventFamily    family;
+        BaseEvent*     event;
+    };
+
+    // The queue: producers swap 'head', the dispatching thread owns 'tail'.
+    Node           stub;
+    Node* volatile head;
+    Node*          tail;
+
+    int  batchSize;
+    int  progressInterval;
+
+    volatile long  posted;
+    volatile long  delivered;
+    volatile bool  accepting;
+    volatile bool  sleeping;
+    bool           started;
+    int            flushRequests;
+
+    /// Merged DATA_SENT / DATA_RECEIVED waiting for their interval
+    TransportEvent* progress[2];
+    /// Time (msec) the last DATA_SENT / DATA_RECEIVED was delivered
+    unsigned long   lastProgress[2];
+
+    pthread_t       dispatchThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  available;
+    pthread_cond_t  flushed;
+
+    void  push(Node* node);
+    Node* pop();
+    bool  isEmpty();
+
+    void deliverQueued();
+    long deliverBatch(std::vector<Node*>& batch);
+    long deliverProgress(bool force);
+    long queueProgress(TransportEvent* event);
+    void markDelivered(long count);
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -64,6 +64,7 @@ public:
     /// TODO: not yet implemented on Mozilla
     char* sendMessage(const char* msg, const unsigned int length) {
         LOG.error("sendMessage(char*, int) not implemented yet.");
+        return NULL;
     }
     void setProperty(const char *propName, const char * const propValue) {
         LOG.error("setproperty(char*, char*) not implemented yet.");
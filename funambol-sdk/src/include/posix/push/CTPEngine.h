@@ -0,0 +1,291 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_CTP_ENGINE
+#define INCL_CTP_ENGINE
+
+/** @cond DEV */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/ArrayList.h"
+
+#include "push/FThread.h"
+#include "push/CTPSession.h"
+#include "push/CTPDispatchQueue.h"
+#include "push/TimerWheel.h"
+
+#include <pthread.h>
+#include <vector>
+#include <deque>
+#include <set>
+
+struct addrinfo;
+
+/// Max time (msec) an event loop sleeps when no session has a deadline
+#define CTP_ENGINE_MAX_WAIT         60000
+/// Max number of socket events handled by a single wait
+#define CTP_ENGINE_MAX_EVENTS       64
+
+namespace Funambol {
+
+class CTPEngine;
+class CTPEventLoop;
+
+/**
+ * Resolves the host names for a CTPEventLoop on its own thread: getaddrinfo()
+ * blocks, and a slow DNS must not stall the other sessions of the loop.
+ * The results are handed back to the loop, which is woken up.
+ */
+class CTPResolver : public FThread {
+
+public:
+
+    CTPResolver(CTPEventLoop& loop);
+    ~CTPResolver();
+
+    /// Queues the resolution of host:port; the loop gets the result with the same id.
+    void resolve(uint32_t id, const char* host, const char* port);
+
+    /// Starts the resolver thread.
+    void start(Priority priority = InheritPriority);
+
+    /// Stops the thread: queued requests are discarded.
+    void softTerminate();
+
+    /// Stops the thread and waits for the resolution in progress, if any.
+    void stop();
+
+protected:
+    void run();
+
+private:
+
+    struct Request {
+        uint32_t     id;
+        StringBuffer host;
+        StringBuffer port;
+    };
+
+    CTPEventLoop& loop;
+    std::deque<Request> requests;
+    bool started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  available;
+};
+
+/**
+ * An event loop serving many CTPSessions on one thread, with non-blocking
+ * sockets multiplexed by epoll (poll() where epoll is not available).
+ * The deadlines of the sessions (heartbeat, command timeout, reconnect
+ * backoff) are kept on a TimerWheel, so a wakeup only touches the sessions
+ * with I/O or an expired timer.
+ * It is created and owned by the CTPEngine.
+ */
+class CTPEventLoop : public FThread {
+
+public:
+
+    CTPEventLoop(CTPEngine& engine);
+    ~CTPEventLoop();
+
+    /// Creates the poller and the wakeup pipe, then starts the thread.
+    bool startLoop();
+
+    /// Registers the session: the loop will connect it.
+    void addSession(CTPSession* session);
+
+    /**
+     * Stops and unregisters the session, closing its connection.
+     * Blocks until the loop does not reference the session anymore.
+     * @return false if the session is not served by this loop
+     */
+    bool removeSession(CTPSession* session);
+
+    /// Number of sessions served by this loop.
+    int32_t getSessionCount();
+
+    /// Stops the loop: connections are closed, sessions stay registered.
+    void softTerminate();
+
+protected:
+    void run();
+
+private:
+
+    struct Connection : public TimerTask {
+        CTPEventLoop* loop;
+        CTPSession*   session;
+        int           fd;
+        bool          connecting;
+        uint32_t      events;
+        /// The pending name resolution, 0 if none
+        uint32_t      resolveId;
+        /// The resolved addresses, and the next one to try
+        struct addrinfo* addrs;
+        struct addrinfo* nextAddr;
+
+        void onTimeout();
+    };
+    friend struct Connection;
+    friend class CTPResolver;
+
+    struct Resolved {
+        uint32_t         id;
+        struct addrinfo* addrs;     // NULL if the name cannot be resolved
+    };
+
+    CTPEngine& engine;
+    CTPResolver resolver;
+    uint32_t lastResolveId;
+
+    /// Wakes up the connections at their session deadline
+    TimerWheel timers;
+    /// The time of the current loop iteration
+    int64_t loopNow;
+
+    int pollFd;
+    int wakeFds[2];
+
+    /// Accessed only by the loop thread (or when the loop is not running)
+    std::vector<Connection*> connections;
+
+    /// The members below are protected by the mutex
+    std::set<CTPSession*>    sessions;
+    std::vector<CTPSession*> pendingAdd;
+    std::vector<CTPSession*> pendingRemove;
+    std::vector<Resolved>    resolved;
+    bool loopRunning;
+    pthread_t loopThread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  removed;
+
+    void wakeup();
+    void processPending(int64_t now);
+    void processResolved(int64_t now);
+    void detach(CTPSession* session, int64_t now);
+
+    /// Called by the resolver thread.
+    void onResolved(uint32_t id, struct addrinfo* addrs);
+
+    void serviceConnection(Connection* conn, int64_t now);
+    void openConnection(Connection* conn, int64_t now);
+    void connectNext(Connection* conn, int64_t now);
+    void releaseAddresses(Connection* conn);
+    void connected(Connection* conn, int64_t now);
+    void closeSocket(Connection* conn);
+    void closeConnection(Connection* conn, int64_t now);
+    void readConnection(Connection* conn, int64_t now);
+    void flushOutput(Connection* conn, int64_t now);
+    void handleEvent(Connection* conn, uint32_t events, int64_t now);
+
+    void updateEvents(Connection* conn);
+    void updateTimer(Connection* conn, int64_t now);
+    void waitEvents(int timeout);
+};
+
+
+/**
+ * Serves the CTP push connections of many accounts in one process.
+ * Each account is a CTPSession, registered with addSession(): sessions are
+ * spread over a few CTPEventLoops (no thread per connection) and the
+ * PushListener callbacks are delivered by a bounded CTPDispatchQueue, so
+ * they can take their time without delaying other accounts.
+ *
+ * An engine can be started only once: create a new one after stop().
+ */
+class CTPEngine : public CTPSessionObserver {
+
+public:
+
+    /**
+     * @param loopCount          number of event loop threads
+     * @param dispatchQueueSize  max number of pending listener callbacks
+     */
+    CTPEngine(int32_t loopCount = 1, int32_t dispatchQueueSize = CTP_DISPATCH_QUEUE_SIZE);
+    ~CTPEngine();
+
+    /// Starts the event loops and the dispatch thread.
+    bool start();
+
+    /// Stops the event loops (closing all connections) and the dispatch thread.
+    void stop();
+
+    bool isRunning() { return running; }
+
+    /**
+     * Registers the session (not owned) on the least loaded event loop.
+     * Its observer is set to this engine.
+     */
+    bool addSession(CTPSession* session);
+
+    /**
+     * Stops the session and unregisters it, closing its connection. When
+     * this method returns the engine does not reference the session, and no
+     * callback on its PushListener is queued or running.
+     * @return false if the session is not registered
+     */
+    bool removeSession(CTPSession* session);
+
+    /// Total number of registered sessions.
+    int32_t getSessionCount();
+
+    int32_t getLoopCount() { return loopCount; }
+
+    /// The thread of the given event loop (NULL if out of range).
+    FThread* getLoop(int32_t index);
+
+    /// Milliseconds of a monotonic clock, used as time base for the sessions.
+    static int64_t now();
+
+    // CTPSessionObserver: called by the event loops
+    void onSyncNotification(CTPSession& session, const ArrayList& serverURIList);
+    void onCTPError(CTPSession& session, const int errorCode, const int additionalInfo);
+
+private:
+
+    CTPEventLoop** loops;
+    int32_t loopCount;
+    bool running;
+
+    CTPDispatchQueue dispatchQueue;
+};
+
+} // end namespace Funambol
+
+/** @endcond */
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/**
+ * Counting allocator of the benchmark programs: every heap allocation is
+ * counted by Benchmark::countAllocation(), see Benchmark::getAllocations().
+ */
+
+#include <new>
+#include <stdlib.h>
+
+#include "base/globalsdef.h"
+#include "Benchmark.h"
+
+USE_NAMESPACE
+
+#ifdef __GLIBC__
+
+// Counting allocator: operator new and the C code of the library (e.g.
+// StringBuffer, which uses realloc) all end up here
+extern "C" {
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size) {
+    Benchmark::countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    Benchmark::countAllocation();
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size) {
+    Benchmark::countAllocation();
+    return __libc_realloc(p, size);
+}
+}
+
+#else
+
+// Counting operator new: malloc can't be replaced portably, so only the
+// C++ allocations are counted
+void* operator new(size_t size) {
+    Benchmark::countAllocation();
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) {
+    free(p);
+}
+
+void operator delete[](void* p) {
+    free(p);
+}
+
+#endif
@@ -0,0 +1,300 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/base64.h"
+#include "base/util/utils.h"
+#include "base/util/StringBuffer.h"
+#include "base/util/ArrayList.h"
+#include "base/util/XMLProcessor.h"
+#include "Benchmark.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Size of the binary buffer of the base64, CRC and MD5 benchmarks
+#define BINARY_DATA_SIZE    4096
+/// Number of elements of the ArrayList benchmarks
+#define LIST_SIZE           1024
+
+static void fillBinary(char* data, int len) {
+    for (int i = 0; i < len; i++) {
+        data[i] = (char)(i * 31 + 7);
+    }
+}
+
+
+class StringBufferAppendBenchmark : public Benchmark {
+public:
+    StringBufferAppendBenchmark() : Benchmark("StringBuffer.append") {}
+
+    void run(int iterations) {
+        StringBuffer s;
+        for (int i = 0; i < iterations; i++) {
+            // restart now and then, so that the buffer doesn't grow forever
+            if ((i & 4095) == 0) {
+                s.reset();
+            }
+            s.append("<LocURI>contact</LocURI>");
+        }
+        sink = (long)s.length();
+    }
+};
+BENCHMARK_REGISTRATION(StringBufferAppendBenchmark);
+
+class StringBufferSprintfBenchmark : public Benchmark {
+public:
+    StringBufferSprintfBenchmark() : Benchmark("StringBuffer.sprintf") {}
+
+    void run(int iterations) {
+        StringBuffer s;
+        for (int i = 0; i < iterations; i++) {
+            s.sprintf("<CmdID>%d</CmdID><LocURI>%s</LocURI>", i, "contact");
+        }
+        sink = (long)s.length();
+    }
+};
+BENCHMARK_REGISTRATION(StringBufferSprintfBenchmark);
+
+
+class ArrayListAddBenchmark : public Benchmark {
+public:
+    ArrayListAddBenchmark() : Benchmark("ArrayList.add") {}
+
+    void run(int iterations) {
+        ArrayList list;
+        StringBuffer element("-2147483646");
+        for (int i = 0; i < iterations; i++) {
+            if (i % LIST_SIZE == 0) {
+                list.clear();
+            }
+            list.add(element);
+        }
+        sink = list.size();
+    }
+};
+BENCHMARK_REGISTRATION(ArrayListAddBenchmark);
+
+/// Base of the benchmarks reading a list of LIST_SIZE elements
+class ArrayListReadBenchmark : public Benchmark {
+public:
+    ArrayListReadBenchmark(const char* name) : Benchmark(name) {}
+
+    bool setUp() {
+        StringBuffer element;
+        for (int i = 0; i < LIST_SIZE; i++) {
+            element.sprintf("%d", i);
+            list.add(element);
+        }
+        return true;
+    }
+
+    void tearDown() {
+        list.clear();
+    }
+
+protected:
+    ArrayList list;
+};
+
+class ArrayListGetBenchmark : public ArrayListReadBenchmark {
+public:
+    ArrayListGetBenchmark() : ArrayListReadBenchmark("ArrayList.get") {}
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            total += ((StringBuffer*)list.get((i * 7) % LIST_SIZE))->length();
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(ArrayListGetBenchmark);
+
+/// One op is a full front()/next() scan of the list
+class ArrayListIterateBenchmark : public ArrayListReadBenchmark {
+public:
+    ArrayListIterateBenchmark() : ArrayListReadBenchmark("ArrayList.iterate") {}
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            for (StringBuffer* s = (StringBuffer*)list.front(); s; s = (StringBuffer*)list.next()) {
+                total += s->length();
+            }
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(ArrayListIterateBenchmark);
+
+
+/// Base of the benchmarks working on syncML3.xml
+class XMLProcessorBenchmark : public Benchmark {
+public:
+    XMLProcessorBenchmark(const char* name) : Benchmark(name) {}
+
+    bool setUp() {
+        return loadTestFile("syncML3.xml", xml);
+    }
+
+protected:
+    StringBuffer xml;
+};
+
+/// One op finds all the LocURI of the message
+class XMLProcessorGetElementBenchmark : public XMLProcessorBenchmark {
+public:
+    XMLProcessorGetElementBenchmark() : XMLProcessorBenchmark("XMLProcessor.getElementContent") {}
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            unsigned int pos = 0, start = 0, end = 0;
+            const char* p = xml.c_str();
+            while (XMLProcessor::getElementContent(p + pos, "LocURI", NULL, &start, &end)) {
+                total += end - start;
+                pos += end;
+            }
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(XMLProcessorGetElementBenchmark);
+
+class XMLProcessorCopyElementBenchmark : public XMLProcessorBenchmark {
+public:
+    XMLProcessorCopyElementBenchmark() : XMLProcessorBenchmark("XMLProcessor.copyElementContent") {}
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            StringBuffer body;
+            XMLProcessor::copyElementContent(body, xml.c_str(), "SyncBody");
+            total += body.length();
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(XMLProcessorCopyElementBenchmark);
+
+
+/// Base of the benchmarks on a BINARY_DATA_SIZE buffer
+class BinaryBenchmark : public Benchmark {
+public:
+    BinaryBenchmark(const char* name) : Benchmark(name) {}
+
+    bool setUp() {
+        fillBinary(data, BINARY_DATA_SIZE);
+        return true;
+    }
+
+protected:
+    char data[BINARY_DATA_SIZE];
+};
+
+class Base64EncodeBenchmark : public BinaryBenchmark {
+public:
+    Base64EncodeBenchmark() : BinaryBenchmark("base64.encode.4k") {}
+
+    void run(int iterations) {
+        char* encoded = new char[BINARY_DATA_SIZE * 2];
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            total += b64_encode(encoded, data, BINARY_DATA_SIZE);
+        }
+        delete [] encoded;
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(Base64EncodeBenchmark);
+
+class Base64DecodeBenchmark : public BinaryBenchmark {
+public:
+    Base64DecodeBenchmark() : BinaryBenchmark("base64.decode.4k") {}
+
+    bool setUp() {
+        BinaryBenchmark::setUp();
+        b64_encode(encoded, data, BINARY_DATA_SIZE);
+        return true;
+    }
+
+    void run(int iterations) {
+        char decoded[BINARY_DATA_SIZE];
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            total += b64_decode(decoded, encoded.c_str());
+        }
+        sink = total;
+    }
+
+private:
+    StringBuffer encoded;
+};
+BENCHMARK_REGISTRATION(Base64DecodeBenchmark);
+
+class CRCBenchmark : public BinaryBenchmark {
+public:
+    CRCBenchmark() : BinaryBenchmark("calculateCRC.4k") {}
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            total += calculateCRC(data, BINARY_DATA_SIZE);
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(CRCBenchmark);
+
+class MD5Benchmark : public BinaryBenchmark {
+public:
+    MD5Benchmark() : BinaryBenchmark("calculateMD5.4k") {}
+
+    void run(int iterations) {
+        char digest[16];
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            calculateMD5(data, BINARY_DATA_SIZE, digest);
+            total += digest[0];
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(MD5Benchmark);
+
+/** @endcond */
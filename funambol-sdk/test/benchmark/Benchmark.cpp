@@ -0,0 +1,171 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include "base/util/utils.h"
+#include "base/util/JsonWriter.h"
+#include "spds/SyncStats.h"
+#include "Benchmark.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+volatile long Benchmark::sink = 0;
+unsigned long Benchmark::allocations = 0;
+
+/// The registered benchmarks: a function static, as they register during static init
+static std::vector<Benchmark*>& getRegistry() {
+    static std::vector<Benchmark*> registry;
+    return registry;
+}
+
+static bool compareNames(const Benchmark* a, const Benchmark* b) {
+    return strcmp(a->getName(), b->getName()) < 0;
+}
+
+Benchmark::Benchmark(const char* n) : name(n) {
+    getRegistry().push_back(this);
+}
+
+unsigned long Benchmark::getAllocations() {
+    return allocations;
+}
+
+bool Benchmark::loadTestFile(const char* fileName, StringBuffer& content) {
+    StringBuffer path;
+    path.sprintf("%s/%s", BENCHMARK_TESTDIR, fileName);
+
+    char* message = NULL;
+    size_t len = 0;
+    if (!readFile(path.c_str(), &message, &len, false)) {
+        fprintf(stderr, "cannot read test file %s\n", path.c_str());
+        return false;
+    }
+    content = message;
+    delete [] message;
+    return true;
+}
+
+static bool matches(const char* name, const char** filters, int filtersCount) {
+    if (filtersCount == 0) {
+        return true;
+    }
+    for (int i = 0; i < filtersCount; i++) {
+        if (strstr(name, filters[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Measures 'iterations' runs of the benchmark.
+ * @param micros  [out] the elapsed time
+ * @param allocs  [out] the heap allocations done
+ */
+static void measure(Benchmark& b, int iterations, int64_t& micros, unsigned long& allocs) {
+    unsigned long startAllocs = Benchmark::getAllocations();
+    int64_t start = SyncStats::now();
+    b.run(iterations);
+    micros = SyncStats::now() - start;
+    allocs = Benchmark::getAllocations() - startAllocs;
+}
+
+int Benchmark::runAll(StringBuffer& out, const char** filters, int filtersCount) {
+    std::vector<Benchmark*> benchmarks(getRegistry());
+    std::sort(benchmarks.begin(), benchmarks.end(), compareNames);
+
+    JsonWriter writer(out, true);
+    writer.beginObject();
+    writer.beginArray("benchmarks");
+
+    int count = 0;
+    for (size_t i = 0; i < benchmarks.size(); i++) {
+        Benchmark& b = *benchmarks[i];
+        if (!matches(b.getName(), filters, filtersCount)) {
+            continue;
+        }
+        if (!b.setUp()) {
+            fprintf(stderr, "%s: setup failed, skipped\n", b.getName());
+            b.tearDown();
+            continue;
+        }
+
+        // grow the iterations until a run lasts BENCHMARK_MIN_TIME
+        int iterations = 1;
+        int64_t micros = 0;
+        unsigned long allocs = 0;
+        for (;;) {
+            measure(b, iterations, micros, allocs);
+            if (micros >= BENCHMARK_MIN_TIME || iterations >= BENCHMARK_MAX_ITERATIONS) {
+                break;
+            }
+            double factor = micros > 0 ? (BENCHMARK_MIN_TIME * 1.2) / micros : 100;
+            if (factor < 2) {
+                factor = 2;
+            } else if (factor > 100) {
+                factor = 100;
+            }
+            double next = iterations * factor;
+            iterations = next > BENCHMARK_MAX_ITERATIONS ? BENCHMARK_MAX_ITERATIONS : (int)next;
+        }
+
+        // the fastest of the repetitions is the least disturbed one
+        int64_t best = micros;
+        for (int r = 1; r < BENCHMARK_REPETITIONS; r++) {
+            int64_t t;
+            measure(b, iterations, t, allocs);
+            if (t < best) {
+                best = t;
+            }
+        }
+        b.tearDown();
+
+        writer.beginObject();
+        writer.addString("name", b.getName());
+        writer.addInt("iterations", iterations);
+        writer.addDouble("nsPerOp", (double)best * 1000 / iterations, 1);
+        writer.addDouble("allocsPerOp", (double)allocs / iterations, 3);
+        writer.endObject();
+        count++;
+    }
+
+    writer.endArray();
+    writer.endObject();
+    writer.flush();
+    return count;
+}
@@ -0,0 +1,123 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_BENCHMARK
+#define INCL_BENCHMARK
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/// Minimum duration of a measured run, in microseconds
+#define BENCHMARK_MIN_TIME          200000
+/// Number of measured runs: the fastest one is reported
+#define BENCHMARK_REPETITIONS       3
+/// Iterations are never more than this, whatever the speed of the op
+#define BENCHMARK_MAX_ITERATIONS    100000000
+
+/// Directory of the test files, relative to the working directory
+#define BENCHMARK_TESTDIR           "testcases"
+
+/**
+ * A micro-benchmark: run() repeats one operation 'iterations' times.
+ * Whatever the op needs (input files, objects to format...) is built in
+ * setUp(), which is not measured.
+ *
+ * Benchmarks register themselves with BENCHMARK_REGISTRATION(), and are
+ * run in name order by runAll(), which reports the time and the heap
+ * allocations per op as JSON.
+ */
+class Benchmark {
+
+public:
+
+    Benchmark(const char* name);
+    virtual ~Benchmark() {}
+
+    const char* getName() const { return name; }
+
+    /// Prepares the input of the op. @return false to skip the benchmark
+    virtual bool setUp() { return true; }
+
+    /// Runs the op 'iterations' times
+    virtual void run(int iterations) = 0;
+
+    /// Releases what setUp() allocated
+    virtual void tearDown() {}
+
+    /**
+     * Runs the registered benchmarks whose name contains one of the
+     * filters (all of them if there are no filters) and appends the
+     * results to 'out', as:
+     * {"benchmarks":[{"name":..,"iterations":..,"nsPerOp":..,"allocsPerOp":..}]}
+     * @return the number of benchmarks which ran
+     */
+    static int runAll(StringBuffer& out, const char** filters, int filtersCount);
+
+    /**
+     * Loads a test file from BENCHMARK_TESTDIR.
+     * @return false if the file can't be read
+     */
+    static bool loadTestFile(const char* fileName, StringBuffer& content);
+
+    /**
+     * Number of heap allocations done so far, as counted by the
+     * allocator hooks of the benchmark program: malloc, calloc and
+     * realloc with glibc, operator new elsewhere.
+     */
+    static unsigned long getAllocations();
+
+    /// Called by the allocator hooks of the benchmark program
+    static void countAllocation() { allocations++; }
+
+    /// Written by the ops with their result, so that it's not optimized out
+    static volatile long sink;
+
+private:
+
+    const char* name;
+    static unsigned long allocations;
+};
+
+/// Registers a static instance of the benchmark class
+#define BENCHMARK_REGISTRATION(klass) static klass klass##Instance
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
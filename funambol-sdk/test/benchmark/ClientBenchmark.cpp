@@ -0,0 +1,254 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include <vector>
+
+#include "base/fscapi.h"
+#include "base/util/utils.h"
+#include "base/util/StringBuffer.h"
+#include "base/util/PropertyFile.h"
+#include "base/util/MemoryKeyValueStore.h"
+#include "vocl/VConverter.h"
+#include "vocl/VObject.h"
+#include "Benchmark.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Number of properties of the KeyValueStore benchmarks
+#define STORE_SIZE      1000
+/// File of the PropertyFile benchmarks, in the working directory
+#define STORE_FILE      "benchmark-store.properties"
+
+
+/// One op parses one vCard of vcard21.vcf, in turn
+class VConverterBenchmark : public Benchmark {
+public:
+    VConverterBenchmark() : Benchmark("VConverter.parse.vcard21") {}
+
+    bool setUp() {
+        StringBuffer vcf;
+        if (!loadTestFile("vcard21.vcf", vcf)) {
+            return false;
+        }
+        size_t pos = 0;
+        while ((pos = vcf.find("BEGIN:VCARD", pos)) != StringBuffer::npos) {
+            size_t end = vcf.find("END:VCARD", pos);
+            if (end == StringBuffer::npos) {
+                break;
+            }
+            end += strlen("END:VCARD");
+            StringBuffer card = vcf.substr(pos, end - pos);
+            cards.push_back(toWideChar(card.c_str()));
+            pos = end;
+        }
+        return !cards.empty();
+    }
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            VObject* vo = VConverter::parse(cards[i % cards.size()]);
+            total += vo ? vo->propertiesCount() : 0;
+            delete vo;
+        }
+        sink = total;
+    }
+
+    void tearDown() {
+        for (size_t i = 0; i < cards.size(); i++) {
+            delete [] cards[i];
+        }
+        cards.clear();
+    }
+
+private:
+    std::vector<WCHAR*> cards;
+};
+BENCHMARK_REGISTRATION(VConverterBenchmark);
+
+
+/**
+ * Base of the PropertyFile benchmarks. The PropertyFile is the backend
+ * of the cache and mappings in the posix build; the SQL backends are
+ * not part of it.
+ */
+class PropertyFileBenchmark : public Benchmark {
+public:
+    PropertyFileBenchmark(const char* name) : Benchmark(name), store(NULL) {}
+
+    bool setUp() {
+        removeStoreFiles();
+        store = new PropertyFile(STORE_FILE);
+        StringBuffer key, value;
+        for (int i = 0; i < STORE_SIZE; i++) {
+            key.sprintf("item-%d", i);
+            value.sprintf("%lu", (unsigned long)calculateCRC(key.c_str()));
+            store->setPropertyValue(key.c_str(), value.c_str());
+        }
+        store->close();
+        return true;
+    }
+
+    void tearDown() {
+        delete store;
+        store = NULL;
+        removeStoreFiles();
+    }
+
+protected:
+    PropertyFile* store;
+
+private:
+    void removeStoreFiles() {
+        removeFileInDir(".", STORE_FILE);
+        removeFileInDir(".", STORE_FILE ".jour");
+    }
+};
+
+class PropertyFileReadBenchmark : public PropertyFileBenchmark {
+public:
+    PropertyFileReadBenchmark() : PropertyFileBenchmark("KeyValueStore.PropertyFile.read") {}
+
+    void run(int iterations) {
+        StringBuffer key;
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            key.sprintf("item-%d", (i * 7) % STORE_SIZE);
+            total += store->readPropertyValue(key.c_str()).length();
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(PropertyFileReadBenchmark);
+
+/// Each set is appended to the journal file
+class PropertyFileSetBenchmark : public PropertyFileBenchmark {
+public:
+    PropertyFileSetBenchmark() : PropertyFileBenchmark("KeyValueStore.PropertyFile.set") {}
+
+    void run(int iterations) {
+        StringBuffer key, value;
+        for (int i = 0; i < iterations; i++) {
+            key.sprintf("item-%d", (i * 7) % STORE_SIZE);
+            value.sprintf("%d", i);
+            store->setPropertyValue(key.c_str(), value.c_str());
+        }
+        // don't let the journal grow from a run to the other
+        store->close();
+    }
+};
+BENCHMARK_REGISTRATION(PropertyFileSetBenchmark);
+
+/// One op rewrites the whole file
+class PropertyFileCloseBenchmark : public PropertyFileBenchmark {
+public:
+    PropertyFileCloseBenchmark() : PropertyFileBenchmark("KeyValueStore.PropertyFile.close") {}
+
+    void run(int iterations) {
+        for (int i = 0; i < iterations; i++) {
+            store->close();
+        }
+    }
+};
+BENCHMARK_REGISTRATION(PropertyFileCloseBenchmark);
+
+
+/// A MemoryKeyValueStore that is never saved
+class MemoryStore : public MemoryKeyValueStore {
+public:
+    int close() { return 0; }
+};
+
+/// Base of the MemoryKeyValueStore benchmarks, the lookups without the file
+class MemoryStoreBenchmark : public Benchmark {
+public:
+    MemoryStoreBenchmark(const char* name) : Benchmark(name), store(NULL) {}
+
+    bool setUp() {
+        store = new MemoryStore();
+        StringBuffer key, value;
+        for (int i = 0; i < STORE_SIZE; i++) {
+            key.sprintf("item-%d", i);
+            value.sprintf("%lu", (unsigned long)calculateCRC(key.c_str()));
+            store->setPropertyValue(key.c_str(), value.c_str());
+        }
+        return true;
+    }
+
+    void tearDown() {
+        delete store;
+        store = NULL;
+    }
+
+protected:
+    MemoryStore* store;
+};
+
+class MemoryStoreReadBenchmark : public MemoryStoreBenchmark {
+public:
+    MemoryStoreReadBenchmark() : MemoryStoreBenchmark("KeyValueStore.Memory.read") {}
+
+    void run(int iterations) {
+        StringBuffer key;
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            key.sprintf("item-%d", (i * 7) % STORE_SIZE);
+            total += store->readPropertyValue(key.c_str()).length();
+        }
+        sink = total;
+    }
+};
+BENCHMARK_REGISTRATION(MemoryStoreReadBenchmark);
+
+/// Replaces existing keys only, so the store keeps its size
+class MemoryStoreSetBenchmark : public MemoryStoreBenchmark {
+public:
+    MemoryStoreSetBenchmark() : MemoryStoreBenchmark("KeyValueStore.Memory.set") {}
+
+    void run(int iterations) {
+        StringBuffer key, value;
+        for (int i = 0; i < iterations; i++) {
+            key.sprintf("item-%d", (i * 7) % STORE_SIZE);
+            value.sprintf("%d", i);
+            store->setPropertyValue(key.c_str(), value.c_str());
+        }
+    }
+};
+BENCHMARK_REGISTRATION(MemoryStoreSetBenchmark);
+
+/** @endcond */
@@ -0,0 +1,320 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include "base/Log.h"
+#include "base/base64.h"
+#include "base/util/utils.h"
+#include "spds/SyncStats.h"
+#include "spds/SyncStatus.h"
+#include "syncml/core/Alert.h"
+#include "syncml/core/Item.h"
+#include "syncml/core/ModificationCommand.h"
+#include "syncml/core/ObjectDel.h"
+#include "syncml/core/Sync.h"
+#include "syncml/formatter/WBXMLEncoder.h"
+#include "syncml/parser/Parser.h"
+#include "syncml/parser/WBXMLDecoder.h"
+#include "Benchmark.h"
+#include "ScriptedServer.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Ids of the server items, apart from the ones of the client items
+#define SERVER_ITEM_ID_BASE     1000000000
+
+/// Room left in a server message for the header and the closing tags
+#define MESSAGE_OVERHEAD        512
+
+
+ScriptedServer::ScriptedServer(const char* name, SyncMode m, SyntheticItemType t,
+                               const char* type, int count, int maxSize)
+              : sourceName(name), mode(m), type(t), dataType(type),
+                itemCount(count), maxMsgSize(maxSize) {
+    step          = STEP_INIT;
+    msgID         = 0;
+    cmdID         = 0;
+    sentItems     = 0;
+    messages      = 0;
+    bytesReceived = 0;
+    bytesSent     = 0;
+    time          = 0;
+    allocations   = 0;
+    clientItems   = 0;
+}
+
+char* ScriptedServer::process(const char* msg, unsigned int size, unsigned int* responseSize) {
+
+    unsigned long startAllocs = Benchmark::getAllocations();
+    int64_t start = SyncStats::now();
+
+    bool wbxml = WBXMLDecoder::isWBXML(msg, size);
+    char* xml = wbxml ? WBXMLDecoder::decode(msg, size) : NULL;
+
+    const char* text = wbxml ? xml : msg;
+
+    char* response = NULL;
+    *responseSize = 0;
+    SyncML* request = text ? Parser::getSyncML(text) : NULL;
+    if (request && request->getSyncHdr() && request->getSyncBody()) {
+        StringBuffer out;
+        respond(*request, out);
+        if (wbxml) {
+            response = WBXMLEncoder::encode(out.c_str(), responseSize);
+        } else {
+            response = stringdup(out.c_str());
+            *responseSize = out.length();
+        }
+
+        messages++;
+        bytesReceived += size;
+        bytesSent     += *responseSize;
+    } else {
+        LOG.error("%s: invalid client message", __FUNCTION__);
+    }
+    deleteSyncML(&request);
+    delete [] xml;
+
+    time        += SyncStats::now() - start;
+    allocations += Benchmark::getAllocations() - startAllocs;
+    return response;
+}
+
+void ScriptedServer::respond(SyncML& request, StringBuffer& response) {
+
+    SyncHdr* hdr = request.getSyncHdr();
+    const char* msgRef    = hdr->getMsgID();
+    const char* sessionID = hdr->getSessionID() ? hdr->getSessionID()->getSessionID() : "";
+    const char* deviceID  = hdr->getSource() ? hdr->getSource()->getLocURI() : "";
+
+    cmdID = 0;
+    StringBuffer body;
+    addStatus(body, msgRef, "0", SYNC_HDR, deviceID, step == STEP_INIT ? 212 : STC_OK);
+
+    ArrayList* commands = request.getSyncBody()->getCommands();
+    for (int i = 0; i < commands->size(); i++) {
+        AbstractCommand* command = (AbstractCommand*)commands->get(i);
+        // the statuses of the server commands need no answer
+        if (strcmp(command->getName(), STATUS) != 0) {
+            addCommandStatuses(body, msgRef, command);
+        }
+    }
+
+    bool final = false;
+    switch (step) {
+        case STEP_INIT:
+            addServerAlert(body);
+            final = true;
+            step = STEP_CLIENT_MODS;
+            break;
+        case STEP_CLIENT_MODS:
+            // no Final after the last client changes: the client asks for
+            // the server changes with a 222 Alert
+            if (request.getSyncBody()->getFinalMsg()) {
+                step = STEP_SERVER_MODS;
+            }
+            break;
+        case STEP_SERVER_MODS: {
+            size_t used = body.length() + MESSAGE_OVERHEAD;
+            size_t budget = (size_t)maxMsgSize > used ? maxMsgSize - used : 0;
+            if (addServerSync(body, budget)) {
+                final = true;
+                step = STEP_MAPPING;
+            }
+            break;
+        }
+        case STEP_MAPPING:
+            final = true;
+            break;
+    }
+    if (final) {
+        body.append("<Final/>\n");
+    }
+
+    response.sprintf("<SyncML>\n<SyncHdr>\n"
+                     "<VerDTD>1.2</VerDTD>\n<VerProto>SyncML/1.2</VerProto>\n"
+                     "<SessionID>%s</SessionID>\n<MsgID>%d</MsgID>\n"
+                     "<Target><LocURI>%s</LocURI></Target>\n"
+                     "<Source><LocURI>%s</LocURI></Source>\n"
+                     "</SyncHdr>\n<SyncBody>\n",
+                     sessionID, ++msgID, deviceID, sourceName.c_str());
+    response.append(body);
+    response.append("</SyncBody>\n</SyncML>\n");
+}
+
+void ScriptedServer::addStatus(StringBuffer& body, const char* msgRef, const char* cmdRef,
+                               const char* cmd, const char* sourceRef, int code) {
+    StringBuffer status;
+    status.sprintf("<Status>\n<CmdID>%d</CmdID>\n<MsgRef>%s</MsgRef>\n"
+                   "<CmdRef>%s</CmdRef>\n<Cmd>%s</Cmd>\n",
+                   ++cmdID, msgRef, cmdRef, cmd);
+    if (sourceRef) {
+        status.append("<SourceRef>");
+        status.append(sourceRef);
+        status.append("</SourceRef>\n");
+    }
+    StringBuffer data;
+    data.sprintf("<Data>%d</Data>\n</Status>\n", code);
+    status.append(data);
+    body.append(status);
+}
+
+void ScriptedServer::addCommandStatuses(StringBuffer& body, const char* msgRef,
+                                        AbstractCommand* command) {
+
+    const char* name   = command->getName();
+    const char* cmdRef = command->getCmdID() ? command->getCmdID()->getCmdID() : "";
+
+    if (strcmp(name, ALERT) == 0) {
+        // the client looks for the source name in the SourceRef
+        ArrayList* items = ((Alert*)command)->getItems();
+        Item* item = (items && items->size()) ? (Item*)items->get(0) : NULL;
+        Source* source = item ? item->getSource() : NULL;
+        addStatus(body, msgRef, cmdRef, ALERT, source ? source->getLocURI() : NULL, STC_OK);
+
+    } else if (strcmp(name, SYNC) == 0) {
+        Sync* sync = (Sync*)command;
+        Source* source = sync->getSource();
+        addStatus(body, msgRef, cmdRef, SYNC, source ? source->getLocURI() : NULL, STC_OK);
+
+        // one status per item, referring to the client key
+        ArrayList* changes = sync->getCommands();
+        for (int i = 0; changes && i < changes->size(); i++) {
+            ModificationCommand* change = (ModificationCommand*)changes->get(i);
+            const char* changeRef = change->getCmdID() ? change->getCmdID()->getCmdID() : "";
+            ArrayList* items = change->getItems();
+            for (int j = 0; items && j < items->size(); j++) {
+                Item* item = (Item*)items->get(j);
+                const char* key = NULL;
+                if (item->getSource()) {
+                    key = item->getSource()->getLocURI();
+                } else if (item->getTarget()) {
+                    key = item->getTarget()->getLocURI();
+                }
+                int code = STC_OK;
+                if (item->getMoreData()) {
+                    code = STC_CHUNKED_ITEM_ACCEPTED;
+                } else {
+                    if (strcmp(change->getName(), ADD) == 0) {
+                        code = STC_ITEM_ADDED;
+                    }
+                    clientItems++;
+                }
+                addStatus(body, msgRef, changeRef, change->getName(), key, code);
+            }
+        }
+
+    } else {
+        // Put, Map...: accepted as they are
+        addStatus(body, msgRef, cmdRef, name, NULL, STC_OK);
+    }
+}
+
+void ScriptedServer::addServerAlert(StringBuffer& body) {
+    StringBuffer alert;
+    alert.sprintf("<Alert>\n<CmdID>%d</CmdID>\n<Data>%d</Data>\n<Item>\n"
+                  "<Target><LocURI>%s</LocURI></Target>\n"
+                  "<Source><LocURI>%s</LocURI></Source>\n"
+                  "</Item>\n</Alert>\n",
+                  ++cmdID, (int)mode, sourceName.c_str(), sourceName.c_str());
+    body.append(alert);
+}
+
+bool ScriptedServer::addServerSync(StringBuffer& body, size_t budget) {
+
+    StringBuffer sync;
+    sync.sprintf("<Sync>\n<CmdID>%d</CmdID>\n"
+                 "<Target><LocURI>%s</LocURI></Target>\n"
+                 "<Source><LocURI>%s</LocURI></Source>\n"
+                 "<NumberOfChanges>%d</NumberOfChanges>\n",
+                 ++cmdID, sourceName.c_str(), sourceName.c_str(), itemCount);
+
+    bool binary = (type != SYNTHETIC_VCARD);
+    StringBuffer add, data;
+    int added = 0;
+    while (sentItems < itemCount) {
+        size_t size = 0;
+        char* content = SyntheticSyncSource::createContent(type, SERVER_ITEM_ID_BASE + sentItems, 0, &size);
+        if (binary) {
+            b64_encode(data, content, (int)size);
+        } else {
+            data = content;
+        }
+        delete [] content;
+
+        add.sprintf("<Add>\n<CmdID>%d</CmdID>\n<Meta>\n"
+                    "<Type xmlns='syncml:metinf'>%s</Type>\n%s"
+                    "</Meta>\n<Item>\n<Source><LocURI>srv-%d</LocURI></Source>\n<Data><![CDATA[",
+                    cmdID + 1, dataType.c_str(),
+                    binary ? "<Format xmlns='syncml:metinf'>b64</Format>\n" : "",
+                    sentItems);
+        add.append(data);
+        add.append("]]></Data>\n</Item>\n</Add>\n");
+
+        // at least an item per message, to make progress
+        if (added > 0 && sync.length() + add.length() > budget) {
+            break;
+        }
+        sync.append(add);
+        cmdID++;
+        sentItems++;
+        added++;
+    }
+    sync.append("</Sync>\n");
+    body.append(sync);
+
+    return sentItems >= itemCount;
+}
+
+//------------------------------------------------------ ScriptedTransportAgent
+
+char* ScriptedTransportAgent::sendMessage(const char* msg) {
+    return sendMessage(msg, msg ? (unsigned int)strlen(msg) : 0);
+}
+
+char* ScriptedTransportAgent::sendMessage(const char* data, const unsigned int size) {
+    int64_t serverTime = server.getTime();
+    char* response = server.process(data, size, &responseSize);
+
+    // no network: the exchange is all server time
+    sendTime    = 0;
+    waitTime    = server.getTime() - serverTime;
+    receiveTime = 0;
+    return response;
+}
+
+/** @endcond */
@@ -0,0 +1,172 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_SCRIPTED_SERVER
+#define INCL_SCRIPTED_SERVER
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "http/TransportAgent.h"
+#include "spds/constants.h"
+#include "syncml/core/SyncML.h"
+#include "SyntheticSyncSource.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/**
+ * An in-process stand-in for a SyncML server, for the end-to-end sync
+ * benchmark. It answers the messages of one sync session of one source
+ * with a fixed script:
+ *
+ *  - the init message gets the SyncHdr/Alert statuses and an Alert with
+ *    the sync mode chosen by the benchmark (the one requested by the client
+ *    is ignored);
+ *  - every client modification gets its status (201 for the Adds, 213 for
+ *    the chunks of large objects, 200 otherwise), with no Final until the
+ *    client has sent its own;
+ *  - after the 222 Alert, the server changes (Adds of generated items, in
+ *    the format of the source) are sent in messages of at most
+ *    maxMsgSize bytes, the last one with the Final;
+ *  - the Map message gets its status and closes the session.
+ *
+ * WBXML requests get WBXML responses.
+ *
+ * Answers depend only on the client messages, so two runs of the same sync
+ * exchange the same bytes. The server counts the traffic and the time and
+ * allocations it spends, so that they can be left out of the client figures.
+ */
+class ScriptedServer {
+
+public:
+
+    /**
+     * @param sourceName  the name of the client source (the Alert target)
+     * @param mode        the sync mode imposed to the client
+     * @param type        the kind of the server items (binary ones are
+     *                    sent base64 encoded)
+     * @param dataType    the mime type of the server items
+     * @param itemCount   number of server items to send
+     * @param maxMsgSize  max size of the server messages
+     */
+    ScriptedServer(const char* sourceName, SyncMode mode, SyntheticItemType type,
+                   const char* dataType, int itemCount, int maxMsgSize);
+
+    /**
+     * Processes a client message, XML or WBXML.
+     * @param msg           the message
+     * @param size          the size of the message
+     * @param responseSize  [out] the size of the response
+     * @return the response, allocated with new[], NULL if the message
+     *         can't be parsed
+     */
+    char* process(const char* msg, unsigned int size, unsigned int* responseSize);
+
+    int     getMessages() const           { return messages; }
+    int64_t getBytesReceived() const      { return bytesReceived; }
+    int64_t getBytesSent() const          { return bytesSent; }
+    /// Time spent processing the messages, in microseconds
+    int64_t getTime() const               { return time; }
+    /// Heap allocations done processing the messages
+    unsigned long getAllocations() const  { return allocations; }
+    /// Items received in client modifications (Add, Replace, Delete)
+    int     getClientItems() const        { return clientItems; }
+    /// Server items sent so far
+    int     getServerItems() const        { return sentItems; }
+
+private:
+
+    typedef enum {
+        STEP_INIT,              // waiting for the init message
+        STEP_CLIENT_MODS,       // receiving the client modifications
+        STEP_SERVER_MODS,       // sending the server modifications
+        STEP_MAPPING            // waiting for the map message
+    } Step;
+
+    StringBuffer      sourceName;
+    SyncMode          mode;
+    SyntheticItemType type;
+    StringBuffer      dataType;
+    int               itemCount;
+    int               maxMsgSize;
+
+    Step step;
+    int  msgID;
+    int  cmdID;
+    int  sentItems;
+
+    int           messages;
+    int64_t       bytesReceived;
+    int64_t       bytesSent;
+    int64_t       time;
+    unsigned long allocations;
+    int           clientItems;
+
+    void respond(SyncML& request, StringBuffer& response);
+
+    void addStatus(StringBuffer& body, const char* msgRef, const char* cmdRef,
+                   const char* cmd, const char* sourceRef, int code);
+    void addCommandStatuses(StringBuffer& body, const char* msgRef, AbstractCommand* command);
+
+    void addServerAlert(StringBuffer& body);
+
+    /// Adds the next server items: @return true if they were the last ones
+    bool addServerSync(StringBuffer& body, size_t budget);
+};
+
+/**
+ * The transport agent of the benchmark: it hands the messages to a
+ * ScriptedServer instead of sending them. A sync deletes its transport
+ * agent, so a new agent is needed for every sync.
+ */
+class ScriptedTransportAgent : public TransportAgent {
+
+public:
+
+    ScriptedTransportAgent(ScriptedServer& s) : server(s) {}
+
+    char* sendMessage(const char* msg);
+    char* sendMessage(const char* data, const unsigned int size);
+
+private:
+
+    ScriptedServer& server;
+};
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
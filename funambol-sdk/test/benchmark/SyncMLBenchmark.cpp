@@ -0,0 +1,218 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "syncml/core/SyncML.h"
+#include "syncml/parser/Parser.h"
+#include "syncml/formatter/Formatter.h"
+#include "Benchmark.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Number of messages of the test corpus: syncML1.xml ... syncML8.xml
+#define CORPUS_SIZE     8
+/// The scaled message repeats the commands of syncML3.xml this many times
+#define SCALE_FACTOR    50
+
+/**
+ * Builds a large message out of syncML3.xml, repeating the commands of
+ * its SyncBody SCALE_FACTOR times.
+ */
+static bool loadScaledMessage(StringBuffer& msg) {
+    StringBuffer xml;
+    if (!Benchmark::loadTestFile("syncML3.xml", xml)) {
+        return false;
+    }
+    size_t bodyStart = xml.find("<SyncBody>");
+    size_t bodyEnd   = xml.find("<Final/>");
+    if (bodyEnd == StringBuffer::npos) {
+        bodyEnd = xml.find("</SyncBody>");
+    }
+    if (bodyStart == StringBuffer::npos || bodyEnd == StringBuffer::npos) {
+        return false;
+    }
+    bodyStart += strlen("<SyncBody>");
+
+    StringBuffer commands(xml.c_str() + bodyStart, bodyEnd - bodyStart);
+    msg = xml.substr(0, bodyStart);
+    for (int i = 0; i < SCALE_FACTOR; i++) {
+        msg.append(commands);
+    }
+    msg.append(xml.c_str() + bodyEnd);
+    return true;
+}
+
+
+/// One op parses all the messages of the corpus
+class ParserCorpusBenchmark : public Benchmark {
+public:
+    ParserCorpusBenchmark() : Benchmark("Parser.getSyncML.corpus") {}
+
+    bool setUp() {
+        StringBuffer name;
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            name.sprintf("syncML%d.xml", i + 1);
+            if (!loadTestFile(name.c_str(), messages[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            for (int j = 0; j < CORPUS_SIZE; j++) {
+                SyncML* syncml = Parser::getSyncML(messages[j].c_str());
+                total += syncml ? 1 : 0;
+                delete syncml;
+            }
+        }
+        sink = total;
+    }
+
+private:
+    StringBuffer messages[CORPUS_SIZE];
+};
+BENCHMARK_REGISTRATION(ParserCorpusBenchmark);
+
+class ParserScaledBenchmark : public Benchmark {
+public:
+    ParserScaledBenchmark() : Benchmark("Parser.getSyncML.scaled") {}
+
+    bool setUp() {
+        return loadScaledMessage(message);
+    }
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            SyncML* syncml = Parser::getSyncML(message.c_str());
+            total += syncml ? 1 : 0;
+            delete syncml;
+        }
+        sink = total;
+    }
+
+private:
+    StringBuffer message;
+};
+BENCHMARK_REGISTRATION(ParserScaledBenchmark);
+
+
+/// One op formats all the messages of the corpus, parsed in setUp()
+class FormatterCorpusBenchmark : public Benchmark {
+public:
+    FormatterCorpusBenchmark() : Benchmark("Formatter.getSyncML.corpus") {
+        memset(syncml, 0, sizeof(syncml));
+    }
+
+    bool setUp() {
+        StringBuffer name, xml;
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            name.sprintf("syncML%d.xml", i + 1);
+            if (!loadTestFile(name.c_str(), xml)) {
+                return false;
+            }
+            syncml[i] = Parser::getSyncML(xml.c_str());
+            if (!syncml[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            for (int j = 0; j < CORPUS_SIZE; j++) {
+                StringBuffer* s = Formatter::getSyncML(syncml[j]);
+                total += s ? (long)s->length() : 0;
+                delete s;
+            }
+        }
+        sink = total;
+    }
+
+    void tearDown() {
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            delete syncml[i];
+            syncml[i] = NULL;
+        }
+    }
+
+private:
+    SyncML* syncml[CORPUS_SIZE];
+};
+BENCHMARK_REGISTRATION(FormatterCorpusBenchmark);
+
+class FormatterScaledBenchmark : public Benchmark {
+public:
+    FormatterScaledBenchmark() : Benchmark("Formatter.getSyncML.scaled"), syncml(NULL) {}
+
+    bool setUp() {
+        StringBuffer xml;
+        if (!loadScaledMessage(xml)) {
+            return false;
+        }
+        syncml = Parser::getSyncML(xml.c_str());
+        return syncml != NULL;
+    }
+
+    void run(int iterations) {
+        long total = 0;
+        for (int i = 0; i < iterations; i++) {
+            StringBuffer* s = Formatter::getSyncML(syncml);
+            total += s ? (long)s->length() : 0;
+            delete s;
+        }
+        sink = total;
+    }
+
+    void tearDown() {
+        delete syncml;
+        syncml = NULL;
+    }
+
+private:
+    SyncML* syncml;
+};
+BENCHMARK_REGISTRATION(FormatterScaledBenchmark);
+
+/** @endcond */
@@ -0,0 +1,204 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/** @cond DEV */
+
+#include "base/Log.h"
+#include "base/util/utils.h"
+#include "base/util/ArrayListEnumeration.h"
+#include "SyntheticSyncSource.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Size of the binary items
+#define FILE_ITEM_SIZE      4096
+#define MEDIA_ITEM_SIZE     65536
+
+
+SyntheticSyncSource::SyntheticSyncSource(const WCHAR* name, AbstractSyncSourceConfig* sc,
+                                         SyntheticItemType t, int count, KeyValueStore* cache)
+                   : CacheSyncSource(name, sc, cache), type(t), nextId(0) {
+    for (int i = 0; i < count; i++) {
+        addEntry();
+    }
+}
+
+std::string SyntheticSyncSource::addEntry() {
+    StringBuffer key;
+    key.sprintf("item-%d", nextId);
+
+    Entry& e = items[key.c_str()];
+    e.id = nextId++;
+    e.revision = 0;
+    return key.c_str();
+}
+
+SyntheticSyncSource::Entry* SyntheticSyncSource::findEntry(SyncItem& item, std::string& key) {
+    StringBuffer k;
+    k.convert(item.getKey());
+    key = k.c_str();
+
+    std::map<std::string, Entry>::iterator it = items.find(key);
+    return it == items.end() ? NULL : &it->second;
+}
+
+int SyntheticSyncSource::fillCache() {
+    KeyValueStore* store = getCache();
+    if (!store) {
+        return -1;
+    }
+    store->removeAllProperties();
+
+    std::map<std::string, Entry>::iterator it;
+    for (it = items.begin(); it != items.end(); it++) {
+        StringBuffer key(it->first.c_str());
+        store->setPropertyValue(key.c_str(), getItemSignature(key).c_str());
+    }
+    return store->close();
+}
+
+void SyntheticSyncSource::changeItems(int updated, int added, int deleted) {
+    // the ids are the creation order: walk them, not the (string) keys
+    StringBuffer key;
+    int id = 0;
+    for (int removed = 0; removed < deleted && id < nextId; id++) {
+        key.sprintf("item-%d", id);
+        removed += (int)items.erase(key.c_str());
+    }
+    for (int changed = 0; changed < updated && id < nextId; id++) {
+        key.sprintf("item-%d", id);
+        std::map<std::string, Entry>::iterator it = items.find(key.c_str());
+        if (it != items.end()) {
+            it->second.revision++;
+            changed++;
+        }
+    }
+    for (int i = 0; i < added; i++) {
+        addEntry();
+    }
+}
+
+char* SyntheticSyncSource::createContent(SyntheticItemType type, int id, int revision, size_t* size) {
+
+    if (type == SYNTHETIC_VCARD) {
+        StringBuffer card;
+        card.sprintf("BEGIN:VCARD\r\n"
+                     "VERSION:2.1\r\n"
+                     "N:Surname%d;Name%d;;;\r\n"
+                     "FN:Name%d Surname%d\r\n"
+                     "TEL;CELL:+39 333 %07d\r\n"
+                     "TEL;WORK;VOICE:+39 02 %07d\r\n"
+                     "EMAIL;INTERNET:name%d.surname%d@example.com\r\n"
+                     "ADR;HOME:;;Via Roma %d;Milano;;20100;Italia\r\n"
+                     "ORG:Funambol;Research and Development\r\n"
+                     "NOTE:revision %d\r\n"
+                     "END:VCARD\r\n",
+                     id, id, id, id, id, id, id, id, id % 1000, revision);
+        *size = card.length();
+        return stringdup(card.c_str());
+    }
+
+    // binary content: a linear congruential sequence seeded by id and revision
+    size_t len = (type == SYNTHETIC_FILE) ? FILE_ITEM_SIZE : MEDIA_ITEM_SIZE;
+    char* content = new char[len + 1];
+    unsigned long seed = (unsigned long)id * 31 + revision;
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        content[i] = (char)(seed >> 16);
+    }
+    content[len] = 0;
+    *size = len;
+    return content;
+}
+
+//------------------------------------------------- CacheSyncSource interface
+
+void* SyntheticSyncSource::getItemContent(StringBuffer& key, size_t* size) {
+    std::map<std::string, Entry>::iterator it = items.find(key.c_str());
+    if (it == items.end()) {
+        *size = 0;
+        return NULL;
+    }
+    return createContent(type, it->second.id, it->second.revision, size);
+}
+
+Enumeration* SyntheticSyncSource::getAllItemList() {
+    ArrayList keys;
+    std::map<std::string, Entry>::iterator it;
+    for (it = items.begin(); it != items.end(); it++) {
+        StringBuffer key(it->first.c_str());
+        keys.add(key);
+    }
+    return new ArrayListEnumeration(keys);
+}
+
+int SyntheticSyncSource::insertItem(SyncItem& item) {
+    if (!item.getData() || item.getDataSize() <= 0) {
+        LOG.error("%s: item without data", __FUNCTION__);
+        return STC_COMMAND_FAILED;
+    }
+    std::string key = addEntry();
+    WCHAR* wkey = toWideChar(key.c_str());
+    item.setKey(wkey);
+    delete [] wkey;
+    return STC_ITEM_ADDED;
+}
+
+int SyntheticSyncSource::modifyItem(SyncItem& item) {
+    std::string key;
+    Entry* e = findEntry(item, key);
+    if (!e) {
+        return STC_NOT_FOUND;
+    }
+    e->revision++;
+    return STC_OK;
+}
+
+int SyntheticSyncSource::removeItem(SyncItem& item) {
+    std::string key;
+    if (!findEntry(item, key)) {
+        return STC_NOT_FOUND;
+    }
+    items.erase(key);
+    return STC_OK;
+}
+
+int SyntheticSyncSource::removeAllItems() {
+    items.clear();
+    return clearCache();
+}
+
+/** @endcond */
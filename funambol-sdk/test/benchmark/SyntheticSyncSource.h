@@ -0,0 +1,147 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#ifndef INCL_SYNTHETIC_SYNC_SOURCE
+#define INCL_SYNTHETIC_SYNC_SOURCE
+/** @cond DEV */
+
+#include <map>
+#include <string>
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "spds/SyncItem.h"
+#include "spds/SyncStatus.h"
+#include "client/CacheSyncSource.h"
+#include "base/globalsdef.h"
+
+BEGIN_NAMESPACE
+
+/** The kinds of items generated by the SyntheticSyncSource */
+typedef enum SyntheticItemType {
+    SYNTHETIC_VCARD = 0,        /**< vCard 2.1, about 300 bytes */
+    SYNTHETIC_FILE,             /**< binary, 4 KB */
+    SYNTHETIC_MEDIA             /**< binary, 64 KB */
+} SyntheticItemType;
+
+/**
+ * A CacheSyncSource whose items are generated, for the end-to-end sync
+ * benchmark. An item is only an id and a revision: its content is built
+ * from them when the engine reads it, so that a dataset of any size costs
+ * no disk and a run is always the same. The items added by the server are
+ * given a new id and read back as generated items, their data is only
+ * checked to be there.
+ *
+ * The cache is the one of the CacheSyncSource (a PropertyFile in the
+ * config folder if no store is passed), so that its cost is measured.
+ */
+class SyntheticSyncSource : public CacheSyncSource {
+
+public:
+
+    /**
+     * @param name   the source name
+     * @param sc     the source config
+     * @param type   the kind of items
+     * @param count  number of items initially in the source
+     * @param cache  the cache store (deleted by the source), NULL for the default
+     */
+    SyntheticSyncSource(const WCHAR* name, AbstractSyncSourceConfig* sc,
+                        SyntheticItemType type, int count, KeyValueStore* cache = NULL);
+
+    /// Number of items in the source
+    int getItemCount() const { return (int)items.size(); }
+
+    /**
+     * Sets the cache as after a successful sync of the current items,
+     * to start a two-way sync without running a slow sync first.
+     * @return 0 on success, the error of the cache store otherwise
+     */
+    int fillCache();
+
+    /**
+     * Changes the items as the user would between two syncs: the
+     * 'deleted' first items are removed, the next 'updated' ones get a new
+     * revision, and 'added' new items are created.
+     */
+    void changeItems(int updated, int added, int deleted);
+
+    /**
+     * Builds the content of an item.
+     * @param type      the kind of item
+     * @param id        the item id
+     * @param revision  the item revision
+     * @param size      [out] the content size
+     * @return the content, allocated with new[] and zero terminated
+     */
+    static char* createContent(SyntheticItemType type, int id, int revision, size_t* size);
+
+    /* CacheSyncSource interface implementations follow */
+
+    void* getItemContent(StringBuffer& key, size_t* size);
+    Enumeration* getAllItemList();
+    int insertItem(SyncItem& item);
+    int modifyItem(SyncItem& item);
+    int removeItem(SyncItem& item);
+    int removeAllItems();
+    void updateItemInfo(SyncItem& item, int index) {}
+    void saveAddressBook() {}
+
+private:
+
+    struct Entry {
+        int id;
+        int revision;
+    };
+
+    SyntheticItemType type;
+
+    /// The items, by key
+    std::map<std::string, Entry> items;
+
+    /// Id of the next new item
+    int nextId;
+
+    /// Adds a new item: @return its key
+    std::string addEntry();
+
+    /// The entry of the item with the key of the SyncItem, NULL if not found
+    Entry* findEntry(SyncItem& item, std::string& key);
+};
+
+END_NAMESPACE
+
+/** @endcond */
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+/**
+ * End-to-end sync benchmark: syncs a SyntheticSyncSource through
+ * SyncClient and SyncManager with a ScriptedServer, and prints the measures
+ * of the client as JSON: wall time, peak RSS, heap allocations, bytes on
+ * the wire and the SyncStats of the sync.
+ *
+ *   funambol-syncbench [--items N] [--type vcard|file|media]
+ *                      [--mode slow|two-way|refresh-from-server]
+ *                      [--server-items N] [--msg-size BYTES] [--wbxml]
+ *
+ * The two-way sync starts from the cache of a previous sync, with 10% of
+ * the items changed, 5% added and 5% deleted. The config folder (cache and
+ * mappings) is SYNCBENCH_FOLDER, in the working directory: it's emptied at
+ * every run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "base/fscapi.h"
+#include "base/Log.h"
+#include "base/adapter/PlatformAdapter.h"
+#include "base/util/utils.h"
+#include "base/util/StringMap.h"
+#include "base/util/JsonWriter.h"
+#include "client/DMTClientConfig.h"
+#include "client/OptionParser.h"
+#include "client/SyncClient.h"
+#include "spds/SyncStats.h"
+#include "spds/spdsutils.h"
+#include "Benchmark.h"
+#include "ScriptedServer.h"
+#include "SyntheticSyncSource.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+/// Config folder of the benchmark, relative to the working directory
+#define SYNCBENCH_FOLDER        "syncbench-config"
+#define SYNCBENCH_DEFAULT_ITEMS     1000
+#define SYNCBENCH_DEFAULT_MSG_SIZE  65536
+
+/// Source names of the item types: their defaults are in DefaultConfigFactory
+static const char* sourceNames[] = { "contact", "files", "picture" };
+static const char* typeNames[]   = { "vcard",   "file",  "media"   };
+
+
+/// Peak resident set size of the process, in KB
+static long getPeakRSS() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;      // bytes
+#else
+    return usage.ru_maxrss;             // KB
+#endif
+}
+
+static int getIntOption(StringMap& opts, const char* name, int defaultValue) {
+    const StringBuffer& value = opts[name];
+    return value.empty() ? defaultValue : atoi(value.c_str());
+}
+
+int main(int argc, char** argv) {
+
+    OptionParser parser("funambol-syncbench");
+    parser.addOption('n', "items",        "number of items of the client (default 1000)", true);
+    parser.addOption('t', "type",         "item type: vcard, file or media (default vcard)", true);
+    parser.addOption('m', "mode",         "sync mode: slow, two-way or refresh-from-server (default slow)", true);
+    parser.addOption('s', "server-items", "number of items sent by the server", true);
+    parser.addOption('z', "msg-size",     "max message size, in bytes (default 65536)", true);
+    parser.addOption('w', "wbxml",        "exchange WBXML messages instead of XML");
+    parser.addOption('h', "help",         "print this help");
+
+    StringMap opts;
+    ArrayList args;
+    if (!parser.parse(argc, (const char**)argv, opts, args)) {
+        fprintf(stderr, "%s\n", parser.getErrMsg().c_str());
+        parser.usage();
+        return 2;
+    }
+    if (!opts["help"].empty()) {
+        return 0;
+    }
+
+    int items   = getIntOption(opts, "items", SYNCBENCH_DEFAULT_ITEMS);
+    int msgSize = getIntOption(opts, "msg-size", SYNCBENCH_DEFAULT_MSG_SIZE);
+
+    SyntheticItemType type = SYNTHETIC_VCARD;
+    const StringBuffer& typeName = opts["type"];
+    if (!typeName.empty()) {
+        int i = 0;
+        while (i <= SYNTHETIC_MEDIA && typeName != typeNames[i]) {
+            i++;
+        }
+        if (i > SYNTHETIC_MEDIA) {
+            fprintf(stderr, "unknown item type: %s\n", typeName.c_str());
+            return 2;
+        }
+        type = (SyntheticItemType)i;
+    }
+
+    SyncMode mode = SYNC_SLOW;
+    if (!opts["mode"].empty()) {
+        mode = syncModeCode(opts["mode"].c_str());
+        if (mode != SYNC_SLOW && mode != SYNC_TWO_WAY && mode != SYNC_REFRESH_FROM_SERVER) {
+            fprintf(stderr, "unsupported sync mode: %s\n", opts["mode"].c_str());
+            return 2;
+        }
+    }
+
+    // by default the server sends back what a real one would
+    int serverItems = 0;
+    if (mode == SYNC_TWO_WAY) {
+        serverItems = items / 20;
+    } else if (mode == SYNC_REFRESH_FROM_SERVER) {
+        serverItems = items;
+    }
+    serverItems = getIntOption(opts, "server-items", serverItems);
+
+    // keep the logging out of the measures
+    LOG.setLevel(LOG_LEVEL_NONE);
+
+    // a private config folder, for the cache and the mappings
+    StringMap env;
+    env.put("HOME_FOLDER",   SYNCBENCH_FOLDER);
+    env.put("CONFIG_FOLDER", SYNCBENCH_FOLDER);
+    PlatformAdapter::init("Funambol/syncbench", env, true);
+    createFolder(SYNCBENCH_FOLDER);
+    removeFileInDir(SYNCBENCH_FOLDER "/item_cache");
+    removeFileInDir(SYNCBENCH_FOLDER);
+
+    const char* sourceName = sourceNames[type];
+    // never saved: the defaults are all the benchmark needs
+    DMTClientConfig config;
+    config.setClientDefaults();
+    config.setSourceDefaults(sourceName);
+    config.getAccessConfig().setMaxMsgSize(msgSize);
+    config.getAccessConfig().setWBXML(!opts["wbxml"].empty());
+    config.getDeviceConfig().setDevID("syncbench");
+    // the scripted server has no device info to exchange
+    config.setSendDevInfo(false);
+    config.setForceServerDevInfo(false);
+    config.setServerSwv("syncbench");
+    config.setServerLastSyncURL(config.getSyncURL());
+
+    SyncSourceConfig* sc = config.getSyncSourceConfig(sourceName);
+    sc->setSync(syncModeKeyword(mode));
+    sc->setSyncModes("slow,two-way,refresh-from-server");
+    if (type != SYNTHETIC_VCARD) {
+        sc->setEncoding("b64");
+    }
+
+    WCHAR* wname = toWideChar(sourceName);
+    SyntheticSyncSource source(wname, sc, type, items);
+    delete [] wname;
+
+    if (mode == SYNC_TWO_WAY) {
+        // as after a slow sync, then the user changes some items
+        if (source.fillCache()) {
+            fprintf(stderr, "cannot write the cache in %s\n", SYNCBENCH_FOLDER);
+            return 1;
+        }
+        sc->setLast(1);
+        source.changeItems(items / 10, items / 20, items / 20);
+    }
+
+    ScriptedServer server(sourceName, mode, type, sc->getType(), serverItems, msgSize);
+    SyncClient client;
+    client.setTransportAgent(new ScriptedTransportAgent(server));
+    SyncSource* sources[] = { &source, NULL };
+
+    unsigned long startAllocs = Benchmark::getAllocations();
+    int64_t start = SyncStats::now();
+
+    int ret = client.sync(config, sources);
+
+    int64_t wallTime = SyncStats::now() - start;
+    unsigned long allocs = Benchmark::getAllocations() - startAllocs;
+    int64_t clientTime = wallTime - server.getTime();
+
+    StringBuffer json;
+    JsonWriter writer(json, true);
+    writer.beginObject();
+    writer.addString("type", typeNames[type]);
+    writer.addString("mode", syncModeKeyword(mode));
+    writer.addString("encoding", opts["wbxml"].empty() ? "xml" : "wbxml");
+    writer.addInt("items", items);
+    writer.addInt("serverItems", serverItems);
+    writer.addInt("result", ret);
+    writer.addInt("wallUsec", wallTime);
+    writer.addInt("clientUsec", clientTime);
+    writer.addInt("serverUsec", server.getTime());
+    writer.addInt("peakRssKB", getPeakRSS());
+    writer.addInt("allocations", (int64_t)(allocs - server.getAllocations()));
+    writer.addInt("messages", server.getMessages());
+    writer.addInt("bytesSent", server.getBytesReceived());
+    writer.addInt("bytesReceived", server.getBytesSent());
+    writer.addInt("itemsSent", server.getClientItems());
+    writer.addInt("itemsReceived", server.getServerItems());
+    int exchanged = server.getClientItems() + server.getServerItems();
+    writer.addDouble("itemsPerSec", clientTime > 0 ? exchanged * 1000000.0 / clientTime : 0, 1);
+
+    const SyncStats& stats = client.getSyncReport()->getStats();
+    writer.beginObject("phases");
+    for (int i = 0; i < SYNC_PHASE_COUNT; i++) {
+        PhaseCounter c = stats.getCounter((SyncPhase)i);
+        if (c.calls == 0) {
+            continue;
+        }
+        writer.beginObject(SyncStats::getPhaseName((SyncPhase)i));
+        writer.addInt("usec",  c.time);
+        writer.addInt("bytes", c.bytes);
+        writer.addInt("calls", c.calls);
+        writer.endObject();
+    }
+    writer.endObject();
+    writer.endObject();
+    writer.flush();
+
+    printf("%s\n", json.c_str());
+    return ret == 0 ? 0 : 1;
+}
@@ -54,6 +54,9 @@ class ArrayListTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(iterateAndDelete2);
     CPPUNIT_TEST(iterateAndAddDelete);
     CPPUNIT_TEST(testManyItems);
+    CPPUNIT_TEST(adoptElement);
+    CPPUNIT_TEST(adoptList);
+    CPPUNIT_TEST(adoptAfterRemoveLast);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -137,6 +140,51 @@ private:
         CPPUNIT_ASSERT_EQUAL(true, l.last());       
     }
 
+    void adoptElement() {
+        ArrayList l = ab;
+        StringBuffer* c = new StringBuffer("c");
+
+        CPPUNIT_ASSERT_EQUAL(2, l.adopt(c));
+        CPPUNIT_ASSERT(l.get(2) == c);      // not a copy
+        CPPUNIT_ASSERT(equal(l, abc));
+        CPPUNIT_ASSERT_EQUAL(-1, l.adopt((ArrayElement*)NULL));
+    }
+
+    void adoptList() {
+        ArrayList l;
+        ArrayList other = abc;
+        ArrayElement* first = other.get(0);
+
+        CPPUNIT_ASSERT_EQUAL(3, l.adopt(&other));
+        CPPUNIT_ASSERT(l.get(0) == first);
+        CPPUNIT_ASSERT(equal(l, abc));
+        CPPUNIT_ASSERT(equal(other, empty));
+
+        // appending to a non empty list
+        ArrayList c;
+        c.add(*abc.get(2));
+        l = ab;
+        CPPUNIT_ASSERT_EQUAL(1, l.adopt(&c));
+        CPPUNIT_ASSERT(equal(l, abc));
+        CPPUNIT_ASSERT_EQUAL(0, c.size());
+
+        // the moved list can be used again
+        c.add(*abc.get(0));
+        CPPUNIT_ASSERT_EQUAL(1, c.size());
+    }
+
+    void adoptAfterRemoveLast() {
+        ArrayList l = ab;
+        ArrayList c;
+        c.add(*abc.get(2));
+
+        l.front();
+        l.next();
+        l.removeElementAt(1);     // the iterator is past the end
+        l.adopt(&c);
+        CPPUNIT_ASSERT(*(StringBuffer*)l.next() == *(StringBuffer*)abc.get(2));
+    }
+
     bool equal(ArrayList &first, ArrayList &second) {
         ArrayElement *first_e = first.front();
         int index = 0;
@@ -0,0 +1,203 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "base/fscapi.h"
+#include "base/util/JsonWriter.h"
+#include "ioStream/StringOutputStream.h"
+
+USE_NAMESPACE
+
+/**
+ * This is the test class for JsonWriter.
+ */
+class JsonWriterTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(JsonWriterTest);
+    CPPUNIT_TEST(testNestedObjects);
+    CPPUNIT_TEST(testEmptyContainers);
+    CPPUNIT_TEST(testEscaping);
+    CPPUNIT_TEST(testIntegers);
+    CPPUNIT_TEST(testDoubles);
+    CPPUNIT_TEST(testLongArray);
+    CPPUNIT_TEST(testOutputStream);
+    CPPUNIT_TEST(testUnbalanced);
+    CPPUNIT_TEST_SUITE_END();
+
+    public:
+
+    void setUp() {}
+    void tearDown() {}
+
+    /** Objects, arrays and scalar members, as used by the MH formatters */
+    void testNestedObjects() {
+        StringBuffer json;
+        JsonWriter writer(json);
+
+        writer.beginObject();
+        writer.beginObject("data");
+        writer.addString("name", "pic.jpg");
+        writer.addInt("size", 1024);
+        writer.addBool("shared", true);
+        writer.addNull("title");
+        writer.beginArray("ids");
+        writer.addInt(NULL, 1);
+        writer.addInt(NULL, 2);
+        writer.endArray();
+        writer.endObject();
+        writer.endObject();
+
+        CPPUNIT_ASSERT(writer.isComplete());
+        CPPUNIT_ASSERT_EQUAL(std::string("{\"data\":{\"name\":\"pic.jpg\",\"size\":1024,"
+                                         "\"shared\":true,\"title\":null,\"ids\":[1,2]}}"),
+                             std::string(json.c_str()));
+    }
+
+    void testEmptyContainers() {
+        StringBuffer json;
+        JsonWriter writer(json, true);
+
+        writer.beginObject();
+        writer.beginObject("data");
+        writer.endObject();
+        writer.beginArray("items");
+        writer.endArray();
+        writer.endObject();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("{\n\t\"data\":\t{},\n\t\"items\":\t[]\n}"),
+                             std::string(json.c_str()));
+    }
+
+    /** Control chars, quotes and backslashes are escaped, UTF-8 is passed through */
+    void testEscaping() {
+        StringBuffer json;
+        JsonWriter writer(json);
+
+        writer.beginArray();
+        writer.addString(NULL, "a\"b\\c/d");
+        writer.addString(NULL, "\b\f\n\r\t\x01\x1f");
+        writer.addString(NULL, "caf\xc3\xa9");
+        writer.endArray();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("[\"a\\\"b\\\\c/d\",\"\\b\\f\\n\\r\\t\\u0001\\u001f\",\"caf\xc3\xa9\"]"),
+                             std::string(json.c_str()));
+    }
+
+    void testIntegers() {
+        StringBuffer json;
+        JsonWriter writer(json);
+
+        writer.beginArray();
+        writer.addInt(NULL, 0);
+        writer.addInt(NULL, -42);
+        writer.addInt(NULL, 1334567890123LL);
+        writer.addInt(NULL, -9223372036854775807LL - 1);
+        writer.endArray();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("[0,-42,1334567890123,-9223372036854775808]"),
+                             std::string(json.c_str()));
+    }
+
+    void testDoubles() {
+        StringBuffer json;
+        JsonWriter writer(json);
+        double zero = 0;
+
+        writer.beginArray();
+        writer.addDouble(NULL, 0);
+        writer.addDouble(NULL, 12.3456);
+        writer.addDouble(NULL, -0.0004);
+        writer.addDouble(NULL, 2.5, 0);
+        writer.addDouble(NULL, 1.0 / 3, 9);
+        writer.addDouble(NULL, zero / zero);
+        writer.endArray();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("[0.000,12.346,0.000,3,0.333333333,null]"),
+                             std::string(json.c_str()));
+    }
+
+    /** Output larger than the internal buffer is flushed in chunks */
+    void testLongArray() {
+        StringBuffer json, expected("[");
+        JsonWriter writer(json);
+        const int count = 5000;
+
+        writer.beginArray();
+        for (int i = 0; i < count; i++) {
+            writer.addInt(NULL, i);
+            if (i > 0) {
+                expected.append(",");
+            }
+            expected.append((unsigned long)i, false);
+        }
+        writer.endArray();
+        expected.append("]");
+
+        CPPUNIT_ASSERT(writer.isComplete());
+        CPPUNIT_ASSERT_EQUAL(std::string(expected.c_str()), std::string(json.c_str()));
+    }
+
+    void testOutputStream() {
+        StringOutputStream out;
+        {
+            JsonWriter writer(out);
+            writer.beginObject();
+            writer.addString("token", "af8d44");
+            writer.endObject();
+            CPPUNIT_ASSERT(writer.isComplete());
+        }
+
+        CPPUNIT_ASSERT_EQUAL(std::string("{\"token\":\"af8d44\"}"),
+                             std::string(out.getString().c_str()));
+    }
+
+    void testUnbalanced() {
+        StringBuffer json;
+        JsonWriter writer(json);
+
+        writer.beginObject();
+        writer.beginArray("ids");
+        writer.endArray();
+        CPPUNIT_ASSERT(writer.isComplete() == false);
+
+        writer.endObject();
+        writer.endObject();
+        CPPUNIT_ASSERT(writer.hasError());
+        CPPUNIT_ASSERT(writer.isComplete() == false);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( JsonWriterTest );
@@ -50,6 +50,8 @@ class PropertyFileTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(testSetPropertyFailsStorage);
     CPPUNIT_TEST(testGetPropertiesFromStorage); 
     CPPUNIT_TEST(testEscapeLinesFunciton); 
+    CPPUNIT_TEST(testBatch);
+    CPPUNIT_TEST(testRemoveAllJournal);
     
     CPPUNIT_TEST_SUITE_END();
 
@@ -278,6 +280,45 @@ protected:
 
     }
 
+    void testBatch() {
+        propFile->beginBatch();
+        propFile->setPropertyValue("batch1", "value1");
+        propFile->setPropertyValue("batch2", "value2");
+        propFile->setPropertyValue("batch1", "valueNew");
+        propFile->removeProperty("batch2");
+        CPPUNIT_ASSERT(propFile->readPropertyValue("batch1") == "valueNew");
+        CPPUNIT_ASSERT(propFile->readPropertyValue("batch2").null());
+        CPPUNIT_ASSERT_EQUAL(0, propFile->endBatch());
+
+        // not closed: the changes of the batch are read back from the journal
+        PropertyFile reread("test.properties");
+        CPPUNIT_ASSERT(reread.readPropertyValue("batch1") == "valueNew");
+        CPPUNIT_ASSERT(reread.readPropertyValue("batch2").null());
+
+        propFile->removeProperty("batch1");
+        propFile->close();
+    }
+
+    /**
+    * The changes only in the journal are removed too
+    */
+    void testRemoveAllJournal() {
+        propFile->setPropertyValue("journal1", "value1");
+        propFile->beginBatch();
+        propFile->setPropertyValue("journal2", "value2");
+        CPPUNIT_ASSERT_EQUAL(0, propFile->removeAllProperties());
+        propFile->setPropertyValue("journal3", "value3");
+        CPPUNIT_ASSERT_EQUAL(0, propFile->endBatch());
+
+        PropertyFile reread("test.properties");
+        CPPUNIT_ASSERT(reread.readPropertyValue("journal1").null());
+        CPPUNIT_ASSERT(reread.readPropertyValue("journal2").null());
+        CPPUNIT_ASSERT(reread.readPropertyValue("journal3") == "value3");
+
+        propFile->removeAllProperties();
+        propFile->close();
+    }
+
 private:
     PropertyFile *propFile;
 };
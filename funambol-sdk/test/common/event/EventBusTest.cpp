@@ -0,0 +1,438 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <vector>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/utils.h"
+#include "base/util/StringBuffer.h"
+#include "event/EventBus.h"
+#include "event/SyncListener.h"
+#include "event/SyncItemListener.h"
+#include "event/TransportListener.h"
+#include "event/ManageListener.h"
+#include "event/FireEvent.h"
+
+USE_NAMESPACE
+
+#define PRODUCERS               4
+#define EVENTS_PER_PRODUCER     500
+#define PROGRESS_INTERVAL       300
+
+/**
+ * Blocks the dispatching thread, so that the events fired meanwhile are
+ * queued and delivered together once it is opened.
+ */
+class Gate {
+public:
+    Gate() : closed(true), waiting(false) {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~Gate() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    /// Called by the dispatching thread
+    void pass() {
+        pthread_mutex_lock(&mutex);
+        waiting = true;
+        pthread_cond_broadcast(&cond);
+        while (closed) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    /// Waits until the dispatching thread is blocked
+    void waitBlocked() {
+        pthread_mutex_lock(&mutex);
+        while (!waiting) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    void open() {
+        pthread_mutex_lock(&mutex);
+        closed = false;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    bool closed;
+    bool waiting;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+};
+
+/**
+ * Records the sync events, in the order they are delivered.
+ * syncBegin() blocks on the gate, if any; syncEnd() is slow if 'delay' is set.
+ */
+class TBusSyncListener : public SyncListener {
+public:
+    TBusSyncListener(const char* name, Gate* g = NULL, int d = 0, int* deletedCount = NULL)
+        : SyncListener(name), gate(g), delay(d), onDelete(deletedCount) {}
+    ~TBusSyncListener() {
+        if (onDelete) {
+            *onDelete = (int)messages.size();
+        }
+    }
+
+    void syncBegin(SyncEvent& /* event */) {
+        if (gate) {
+            gate->pass();
+        }
+    }
+    void syncEnd(SyncEvent& event) {
+        if (delay) {
+            sleepMilliSeconds(delay);
+        }
+        messages.push_back(event.getMessage());
+        threads.push_back(pthread_self());
+    }
+
+    std::vector<StringBuffer> messages;
+    std::vector<pthread_t>    threads;
+
+private:
+    Gate* gate;
+    int   delay;
+    int*  onDelete;
+};
+
+/** Records the batches of item events. */
+class TBusSyncItemListener : public SyncItemListener {
+public:
+    TBusSyncItemListener(const char* name) : SyncItemListener(name) {}
+
+    void itemEvents(SyncItemEvent** events, int count) {
+        batches.push_back(count);
+        for (int i = 0; i < count; i++) {
+            data.push_back(events[i]->getData());
+        }
+    }
+
+    std::vector<int> batches;
+    std::vector<int> data;
+};
+
+/** Records the transport events: the type and the size of each one. */
+class TBusTransportListener : public TransportListener {
+public:
+    TBusTransportListener(const char* name) : TransportListener(name), recorded(0) {}
+
+    void sendingData(TransportEvent& event)    { record(event); }
+    void sendDataEnd(TransportEvent& event)    { record(event); }
+    void receivingData(TransportEvent& event)  { record(event); }
+
+    /// Number of events recorded, safe while the bus is running
+    int count() {
+        return __sync_add_and_fetch(&recorded, 0);
+    }
+
+    std::vector<int>           types;
+    std::vector<unsigned long> sizes;
+
+private:
+    volatile int recorded;
+
+    void record(TransportEvent& event) {
+        types.push_back(event.getType());
+        sizes.push_back(event.getDataSize());
+        __sync_synchronize();
+        __sync_add_and_fetch(&recorded, 1);
+    }
+};
+
+
+/**
+ * Tests the EventBus: the events fired with a bus started are delivered
+ * on the bus thread, in order, batched and merged.
+ */
+class EventBusTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(EventBusTest);
+    CPPUNIT_TEST(testOrderAcrossProducers);
+    CPPUNIT_TEST(testItemEventsBatching);
+    CPPUNIT_TEST(testProgressMerging);
+    CPPUNIT_TEST(testProgressRateLimit);
+    CPPUNIT_TEST(testFlushWaitsDelivery);
+    CPPUNIT_TEST(testReplaceListenerWhileQueued);
+    CPPUNIT_TEST(testSetListenersWhileDelivering);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {
+        ManageListener::releaseAllListeners();
+    }
+
+    void tearDown() {
+        ManageListener::releaseAllListeners();
+    }
+
+private:
+
+    static void* producerMain(void* arg) {
+        int producer = (int)(long)arg;
+        StringBuffer msg;
+        for (int i = 0; i < EVENTS_PER_PRODUCER; i++) {
+            msg.sprintf("%d:%d", producer, i);
+            fireSyncEvent(msg.c_str(), SYNC_END);
+        }
+        return NULL;
+    }
+
+    void testOrderAcrossProducers() {
+        TBusSyncListener* listener = new TBusSyncListener("bus");
+        ManageListener::getInstance().setSyncListener(listener);
+
+        EventBus bus(16);
+        bus.start();
+
+        pthread_t producers[PRODUCERS];
+        for (long i = 0; i < PRODUCERS; i++) {
+            CPPUNIT_ASSERT(pthread_create(&producers[i], NULL, producerMain, (void*)i) == 0);
+        }
+        for (int i = 0; i < PRODUCERS; i++) {
+            pthread_join(producers[i], NULL);
+        }
+        bus.flush();
+
+        CPPUNIT_ASSERT_EQUAL((size_t)(PRODUCERS * EVENTS_PER_PRODUCER), listener->messages.size());
+        CPPUNIT_ASSERT_EQUAL(0L, bus.pending());
+
+        // The events of each producer are delivered in the order they were fired
+        int next[PRODUCERS];
+        memset(next, 0, sizeof(next));
+        for (size_t i = 0; i < listener->messages.size(); i++) {
+            int producer = -1, index = -1;
+            CPPUNIT_ASSERT(sscanf(listener->messages[i].c_str(), "%d:%d", &producer, &index) == 2);
+            CPPUNIT_ASSERT(producer >= 0 && producer < PRODUCERS);
+            CPPUNIT_ASSERT_EQUAL(next[producer], index);
+            next[producer]++;
+            CPPUNIT_ASSERT(!pthread_equal(listener->threads[i], pthread_self()));
+        }
+        bus.stop();
+    }
+
+    void testItemEventsBatching() {
+        Gate gate;
+        ManageListener& m = ManageListener::getInstance();
+        m.setSyncListener(new TBusSyncListener("gate", &gate));
+        TBusSyncItemListener* listener = new TBusSyncItemListener("items");
+        m.setSyncItemListener(listener);
+
+        EventBus bus(4);
+        bus.start();
+
+        fireSyncEvent(NULL, SYNC_BEGIN);
+        gate.waitBlocked();
+        for (int i = 0; i < 10; i++) {
+            fireSyncItemEvent("uri", "source", TEXT("key"), ITEM_ADDED_BY_SERVER, i);
+        }
+        // A sync event in the middle splits the run of item events
+        fireSyncEvent("middle", SYNC_END);
+        fireSyncItemEvent("uri", "source", TEXT("key"), ITEM_ADDED_BY_SERVER, 10);
+        gate.open();
+        bus.flush();
+
+        // At most batchSize events per call, in order
+        CPPUNIT_ASSERT_EQUAL((size_t)11, listener->data.size());
+        for (int i = 0; i < 11; i++) {
+            CPPUNIT_ASSERT_EQUAL(i, listener->data[i]);
+        }
+        int expected[] = { 4, 4, 2, 1 };
+        CPPUNIT_ASSERT_EQUAL((size_t)4, listener->batches.size());
+        for (int i = 0; i < 4; i++) {
+            CPPUNIT_ASSERT_EQUAL(expected[i], listener->batches[i]);
+        }
+        bus.stop();
+    }
+
+    void testProgressMerging() {
+        Gate gate;
+        ManageListener& m = ManageListener::getInstance();
+        m.setSyncListener(new TBusSyncListener("gate", &gate));
+        TBusTransportListener* listener = new TBusTransportListener("transport");
+        m.setTransportListener(listener);
+
+        EventBus bus(64, PROGRESS_INTERVAL);
+        bus.start();
+
+        fireSyncEvent(NULL, SYNC_BEGIN);
+        gate.waitBlocked();
+        for (int i = 0; i < 10; i++) {
+            fireTransportEvent(100, DATA_SENT);
+        }
+        for (int i = 0; i < 5; i++) {
+            fireTransportEvent(50, DATA_RECEIVED);
+        }
+        fireTransportEvent(1000, SEND_DATA_END);
+        gate.open();
+        bus.flush();
+
+        // The merged data goes before the end of the transfer
+        CPPUNIT_ASSERT_EQUAL(3, listener->count());
+        CPPUNIT_ASSERT_EQUAL(DATA_SENT, listener->types[0]);
+        CPPUNIT_ASSERT_EQUAL(1000UL, listener->sizes[0]);
+        CPPUNIT_ASSERT_EQUAL(DATA_RECEIVED, listener->types[1]);
+        CPPUNIT_ASSERT_EQUAL(250UL, listener->sizes[1]);
+        CPPUNIT_ASSERT_EQUAL(SEND_DATA_END, listener->types[2]);
+        CPPUNIT_ASSERT_EQUAL(0L, bus.pending());
+        bus.stop();
+    }
+
+    void testProgressRateLimit() {
+        TBusTransportListener* listener = new TBusTransportListener("transport");
+        ManageListener::getInstance().setTransportListener(listener);
+
+        EventBus bus(64, PROGRESS_INTERVAL);
+        bus.start();
+
+        // The first progress is delivered at once
+        fireTransportEvent(10, DATA_SENT);
+        for (int i = 0; i < 100 && listener->count() < 1; i++) {
+            sleepMilliSeconds(10);
+        }
+        CPPUNIT_ASSERT_EQUAL(1, listener->count());
+
+        // The next ones are merged until the interval expires
+        fireTransportEvent(20, DATA_SENT);
+        fireTransportEvent(30, DATA_SENT);
+        sleepMilliSeconds(PROGRESS_INTERVAL / 3);
+        CPPUNIT_ASSERT_EQUAL(1, listener->count());
+        CPPUNIT_ASSERT(bus.pending() > 0);
+
+        // ...and then delivered without another event
+        for (int i = 0; i < 100 && listener->count() < 2; i++) {
+            sleepMilliSeconds(10);
+        }
+        CPPUNIT_ASSERT_EQUAL(2, listener->count());
+        CPPUNIT_ASSERT_EQUAL(50UL, listener->sizes[1]);
+        CPPUNIT_ASSERT_EQUAL(0L, bus.pending());
+
+        // flush() doesn't wait for the interval
+        fireTransportEvent(5, DATA_SENT);
+        bus.flush();
+        CPPUNIT_ASSERT_EQUAL(3, listener->count());
+        CPPUNIT_ASSERT_EQUAL(5UL, listener->sizes[2]);
+        bus.stop();
+    }
+
+    void testFlushWaitsDelivery() {
+        TBusSyncListener* listener = new TBusSyncListener("slow", NULL, 5);
+        ManageListener::getInstance().setSyncListener(listener);
+
+        EventBus bus;
+        bus.start();
+        for (int i = 0; i < 20; i++) {
+            fireSyncEvent("slow", SYNC_END);
+        }
+        bus.flush();
+        CPPUNIT_ASSERT_EQUAL((size_t)20, listener->messages.size());
+        CPPUNIT_ASSERT_EQUAL(0L, bus.pending());
+        bus.stop();
+    }
+
+    void testReplaceListenerWhileQueued() {
+        int deliveredToOld = -1;
+        ManageListener& m = ManageListener::getInstance();
+        m.setSyncListener(new TBusSyncListener("replaced", NULL, 5, &deliveredToOld));
+
+        EventBus bus;
+        bus.start();
+        for (int i = 0; i < 20; i++) {
+            fireSyncEvent("old", SYNC_END);
+        }
+
+        // The old listener gets the events queued before it is replaced,
+        // and is deleted only after that
+        TBusSyncListener* listener = new TBusSyncListener("replaced");
+        m.setSyncListener(listener);
+        CPPUNIT_ASSERT_EQUAL(20, deliveredToOld);
+
+        for (int i = 0; i < 5; i++) {
+            fireSyncEvent("new", SYNC_END);
+        }
+        bus.flush();
+        CPPUNIT_ASSERT_EQUAL((size_t)5, listener->messages.size());
+        for (size_t i = 0; i < listener->messages.size(); i++) {
+            CPPUNIT_ASSERT(listener->messages[i] == "new");
+        }
+        bus.stop();
+    }
+
+    void testSetListenersWhileDelivering() {
+        ManageListener& m = ManageListener::getInstance();
+        TBusSyncListener* listener = new TBusSyncListener("kept");
+        m.setSyncListener(listener);
+
+        EventBus bus(16);
+        bus.start();
+
+        pthread_t producer;
+        CPPUNIT_ASSERT(pthread_create(&producer, NULL, producerMain, (void*)0L) == 0);
+
+        // The list grows, shrinks and changes while the bus reads it
+        StringBuffer name;
+        for (int i = 0; i < 50; i++) {
+            name.sprintf("extra-%d", i % 5);
+            m.setSyncListener(new TBusSyncListener(name.c_str()));
+            if (i % 2) {
+                m.unsetSyncListener(name.c_str());
+            }
+        }
+        pthread_join(producer, NULL);
+        bus.flush();
+
+        CPPUNIT_ASSERT(m.getSyncListener("kept") == listener);
+        CPPUNIT_ASSERT_EQUAL((size_t)EVENTS_PER_PRODUCER, listener->messages.size());
+        bus.stop();
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( EventBusTest );
@@ -0,0 +1,280 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <stdio.h>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "MediaHub/MHItemsCache.h"
+#include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHSyncItemInfo.h"
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+#define TEST_ITEMS_DB       "mhitemscachetest.db"
+
+/**
+ * Test suite for the class MHItemsCache, and for its use by the MHItemsStore.
+ */
+class MHItemsCacheTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(MHItemsCacheTest);
+    CPPUNIT_TEST(testPutGet);
+    CPPUNIT_TEST(testEvictLeastRecentlyUsed);
+    CPPUNIT_TEST(testInvalidate);
+    CPPUNIT_TEST(testStaleRead);
+    CPPUNIT_TEST(testUpdateEntry);
+    CPPUNIT_TEST(testRemoveEntry);
+    CPPUNIT_TEST(testUpdateLocalFileFields);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {
+        remove(TEST_ITEMS_DB);
+        store = new MHItemsStore("items", TEST_ITEMS_DB, 0, 0);
+    }
+
+    void tearDown() {
+        delete store;
+        store = NULL;
+        remove(TEST_ITEMS_DB);
+    }
+
+private:
+    MHItemsStore* store;
+
+    static MHSyncItemInfo* newItem(unsigned long id, const char* guid, const char* localPath = "") {
+        MHSyncItemInfo* item = new MHSyncItemInfo(id, guid, "", "pic.jpg", 0, "", "image/jpeg", 0, 0);
+        item->setLocalItemPath(localPath);
+        return item;
+    }
+
+    void testPutGet() {
+        MHItemsCache cache(*store, 100);
+        MHSyncItemInfo* item = newItem(1, "guid1", "/photos/pic1.jpg");
+
+        CPPUNIT_ASSERT(cache.getById(1) == NULL);
+        cache.put(item, cache.getGeneration());
+
+        // the cache holds its own copy
+        item->setName("changed");
+        MHSyncItemInfo* copy = cache.getById(1);
+        CPPUNIT_ASSERT(copy != NULL);
+        CPPUNIT_ASSERT(copy != item);
+        CPPUNIT_ASSERT(copy->getName() == "pic.jpg");
+        delete copy;
+
+        copy = cache.getByGuid("guid1");
+        CPPUNIT_ASSERT(copy != NULL);
+        CPPUNIT_ASSERT_EQUAL(1UL, copy->getId());
+        delete copy;
+
+        copy = cache.getByLocalPath("/photos/pic1.jpg");
+        CPPUNIT_ASSERT(copy != NULL);
+        CPPUNIT_ASSERT_EQUAL(1UL, copy->getId());
+        delete copy;
+
+        CPPUNIT_ASSERT(cache.getByGuid("guid2") == NULL);
+        CPPUNIT_ASSERT(cache.getByLocalPath("") == NULL);
+        delete item;
+    }
+
+    void testEvictLeastRecentlyUsed() {
+        // 2 entries per shard: ids 16, 32 and 48 share a shard
+        MHItemsCache cache(*store, 2 * MH_ITEMS_CACHE_SHARDS);
+        MHSyncItemInfo* a = newItem(MH_ITEMS_CACHE_SHARDS, "guidA");
+        MHSyncItemInfo* b = newItem(2 * MH_ITEMS_CACHE_SHARDS, "guidB");
+        MHSyncItemInfo* c = newItem(3 * MH_ITEMS_CACHE_SHARDS, "guidC");
+
+        cache.put(a, cache.getGeneration());
+        cache.put(b, cache.getGeneration());
+
+        // a is used after b was added: b becomes the least recently used
+        delete cache.getById(a->getId());
+        cache.put(c, cache.getGeneration());
+
+        MHSyncItemInfo* copy = cache.getById(a->getId());
+        CPPUNIT_ASSERT(copy != NULL);
+        delete copy;
+        CPPUNIT_ASSERT(cache.getById(b->getId()) == NULL);
+        CPPUNIT_ASSERT(cache.getByGuid("guidB") == NULL);
+        copy = cache.getByGuid("guidC");
+        CPPUNIT_ASSERT(copy != NULL);
+        delete copy;
+
+        // other shards are not affected
+        MHSyncItemInfo* d = newItem(1, "guidD");
+        cache.put(d, cache.getGeneration());
+        copy = cache.getById(c->getId());
+        CPPUNIT_ASSERT(copy != NULL);
+        delete copy;
+
+        delete a;
+        delete b;
+        delete c;
+        delete d;
+    }
+
+    void testInvalidate() {
+        MHItemsCache cache(*store, 100);
+        MHSyncItemInfo* a = newItem(1, "guid1", "/photos/pic1.jpg");
+        MHSyncItemInfo* b = newItem(2, "guid2", "/photos/pic2.jpg");
+        cache.put(a, cache.getGeneration());
+        cache.put(b, cache.getGeneration());
+
+        cache.invalidate(1);
+        CPPUNIT_ASSERT(cache.getById(1) == NULL);
+        CPPUNIT_ASSERT(cache.getByGuid("guid1") == NULL);
+        CPPUNIT_ASSERT(cache.getByLocalPath("/photos/pic1.jpg") == NULL);
+        MHSyncItemInfo* copy = cache.getById(2);
+        CPPUNIT_ASSERT(copy != NULL);
+        delete copy;
+
+        // a key moved to another entry is found on the new one
+        b->setGuid("guid1");
+        cache.put(b, cache.getGeneration());
+        copy = cache.getByGuid("guid1");
+        CPPUNIT_ASSERT(copy != NULL);
+        CPPUNIT_ASSERT_EQUAL(2UL, copy->getId());
+        delete copy;
+        CPPUNIT_ASSERT(cache.getByGuid("guid2") == NULL);
+
+        cache.invalidateAll();
+        CPPUNIT_ASSERT(cache.getById(2) == NULL);
+        CPPUNIT_ASSERT(cache.getByGuid("guid1") == NULL);
+
+        delete a;
+        delete b;
+    }
+
+    void testStaleRead() {
+        MHItemsCache cache(*store, 100);
+        MHSyncItemInfo* item = newItem(1, "guid1");
+
+        // a reader gets the generation and reads the row from the db...
+        unsigned long generation = cache.getGeneration();
+
+        // ...while a writer updates the row and invalidates the entry
+        cache.invalidate(1);
+
+        // the row read before the update must not be cached
+        cache.put(item, generation);
+        CPPUNIT_ASSERT(cache.getById(1) == NULL);
+        CPPUNIT_ASSERT(cache.getByGuid("guid1") == NULL);
+
+        // the invalidation of any entry discards the reads in progress
+        generation = cache.getGeneration();
+        cache.invalidate(2);
+        cache.put(item, generation);
+        CPPUNIT_ASSERT(cache.getById(1) == NULL);
+
+        // a read that does not straddle an invalidation is cached
+        cache.put(item, cache.getGeneration());
+        MHSyncItemInfo* copy = cache.getById(1);
+        CPPUNIT_ASSERT(copy != NULL);
+        delete copy;
+
+        delete item;
+    }
+
+    /// Adds an item to the store and loads it into the entries cache.
+    unsigned long addCachedItem(const char* guid) {
+        MHSyncItemInfo item(0, guid, "", "pic.jpg", 0, "", "image/jpeg", 0, 0);
+        item.setLocalItemPath("/photos/pic.jpg");
+        CPPUNIT_ASSERT(store->AddEntry(&item));
+        CPPUNIT_ASSERT(item.getId() != 0);
+
+        MHSyncItemInfo* entry = (MHSyncItemInfo*)store->getEntry(item.getId());
+        CPPUNIT_ASSERT(entry != NULL);
+        delete entry;
+
+        return item.getId();
+    }
+
+    void testUpdateEntry() {
+        store->setEntriesCacheSize(100);
+        unsigned long id = addCachedItem("guid1");
+
+        MHSyncItemInfo* entry = (MHSyncItemInfo*)store->getEntry(id);
+        CPPUNIT_ASSERT(entry != NULL);
+        entry->setName("renamed.jpg");
+        CPPUNIT_ASSERT(store->UpdateEntry(entry));
+        delete entry;
+
+        entry = (MHSyncItemInfo*)store->getEntry(id);
+        CPPUNIT_ASSERT(entry != NULL);
+        CPPUNIT_ASSERT(entry->getName() == "renamed.jpg");
+        delete entry;
+
+        entry = (MHSyncItemInfo*)store->getEntry(MHItemsStore::guid_field_name, "guid1");
+        CPPUNIT_ASSERT(entry != NULL);
+        CPPUNIT_ASSERT(entry->getName() == "renamed.jpg");
+        delete entry;
+    }
+
+    void testRemoveEntry() {
+        store->setEntriesCacheSize(100);
+        unsigned long id = addCachedItem("guid1");
+
+        MHSyncItemInfo* entry = (MHSyncItemInfo*)store->getEntry(id);
+        CPPUNIT_ASSERT(entry != NULL);
+        CPPUNIT_ASSERT(store->RemoveEntry(entry));
+        delete entry;
+
+        CPPUNIT_ASSERT(store->getEntry(id) == NULL);
+        CPPUNIT_ASSERT(store->getEntry(MHItemsStore::guid_field_name, "guid1") == NULL);
+        CPPUNIT_ASSERT(store->getEntry(MHItemsStore::local_item_path_field_name, "/photos/pic.jpg") == NULL);
+    }
+
+    void testUpdateLocalFileFields() {
+        store->setEntriesCacheSize(100);
+        unsigned long id = addCachedItem("guid1");
+
+        std::map<unsigned long, std::pair<std::string, std::string> > updates;
+        updates[id] = std::make_pair(std::string("/thumbs/1_thumb"), std::string("etag1"));
+        CPPUNIT_ASSERT(store->updateLocalFileFields(updates, MHItemsStore::local_thumb_path_field_name,
+                                                    MHItemsStore::local_thumb_etag));
+
+        MHSyncItemInfo* entry = (MHSyncItemInfo*)store->getEntry(id);
+        CPPUNIT_ASSERT(entry != NULL);
+        CPPUNIT_ASSERT(entry->getLocalThumbPath() == "/thumbs/1_thumb");
+        CPPUNIT_ASSERT(entry->getLocalThumbETag() == "etag1");
+        delete entry;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MHItemsCacheTest );
@@ -0,0 +1,251 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/utils.h"
+#include "MediaHub/MHThumbnailCache.h"
+#include "MediaHub/MHItemsStore.h"
+#include "MediaHub/MHSyncItemInfo.h"
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+#define TEST_CACHE_DIR      "mhthumbtest"
+#define TEST_CACHE_DB       "mhthumbtest.db"
+#define TEST_ITEMS_DB       "mhthumbtest_items.db"
+#define TEST_FILE_SIZE      100
+
+/**
+ * Test suite for the class MHThumbnailCache.
+ */
+class MHThumbnailCacheTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(MHThumbnailCacheTest);
+    CPPUNIT_TEST(testAddGetFile);
+    CPPUNIT_TEST(testEvictLeastRecentlyUsed);
+    CPPUNIT_TEST(testSetMaxSize);
+    CPPUNIT_TEST(testETagRevalidation);
+    CPPUNIT_TEST(testMissingFile);
+    CPPUNIT_TEST(testItemsStoreUpdates);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {
+        cleanup();
+    }
+
+    void tearDown() {
+        cleanup();
+    }
+
+private:
+    void cleanup() {
+        removeFileInDir(TEST_CACHE_DIR);
+        remove(TEST_CACHE_DB);
+        remove(TEST_ITEMS_DB);
+    }
+
+    /// Creates the file to be added to the cache, as a download would.
+    void writeFile(const StringBuffer& path, int size) {
+        FILE* f = fopen(path.c_str(), "wb");
+        CPPUNIT_ASSERT(f != NULL);
+        for (int i = 0; i < size; i++) {
+            fputc('x', f);
+        }
+        fclose(f);
+    }
+
+    void addThumb(MHThumbnailCache& cache, MHSyncItemInfo& item, int size = TEST_FILE_SIZE) {
+        StringBuffer path = cache.getFilePath(&item, MHThumbnailKindThumb);
+        writeFile(path, size);
+        CPPUNIT_ASSERT(cache.addFile(&item, MHThumbnailKindThumb, path.c_str()));
+    }
+
+    bool hasThumb(MHThumbnailCache& cache, MHSyncItemInfo& item) {
+        StringBuffer path;
+        return cache.getFile(&item, MHThumbnailKindThumb, path);
+    }
+
+    /// The access times have a 1 second resolution.
+    void waitNextSecond() {
+        time_t start = time(NULL);
+        while (time(NULL) == start) {
+            sleepMilliSeconds(50);
+        }
+    }
+
+    void testAddGetFile() {
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 1000);
+        MHSyncItemInfo item(1, "guid1", "luid1", "pic1.jpg", 1000, "", "image/jpeg", 0, 0);
+        item.setRemoteThumbETag("etag1");
+
+        StringBuffer path;
+        CPPUNIT_ASSERT(!cache.getFile(&item, MHThumbnailKindThumb, path));
+
+        addThumb(cache, item);
+        CPPUNIT_ASSERT_EQUAL((int64_t)TEST_FILE_SIZE, cache.getCurrentSize());
+        CPPUNIT_ASSERT(cache.getFile(&item, MHThumbnailKindThumb, path));
+        CPPUNIT_ASSERT(path == cache.getFilePath(&item, MHThumbnailKindThumb));
+        CPPUNIT_ASSERT(item.getLocalThumbPath() == path);
+        CPPUNIT_ASSERT(item.getLocalThumbETag() == "etag1");
+
+        // the preview is cached separately
+        CPPUNIT_ASSERT(!cache.getFile(&item, MHThumbnailKindPreview, path));
+
+        CPPUNIT_ASSERT(cache.removeFile(&item, MHThumbnailKindThumb));
+        CPPUNIT_ASSERT(!hasThumb(cache, item));
+        CPPUNIT_ASSERT(!fileExists(cache.getFilePath(&item, MHThumbnailKindThumb).c_str()));
+        CPPUNIT_ASSERT_EQUAL((int64_t)0, cache.getCurrentSize());
+        CPPUNIT_ASSERT(item.getLocalThumbPath().empty());
+    }
+
+    void testEvictLeastRecentlyUsed() {
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 2 * TEST_FILE_SIZE + TEST_FILE_SIZE / 2);
+        MHSyncItemInfo a(1, "guid1", "luid1", "a.jpg", 0, "", "image/jpeg", 0, 0);
+        MHSyncItemInfo b(2, "guid2", "luid2", "b.jpg", 0, "", "image/jpeg", 0, 0);
+        MHSyncItemInfo c(3, "guid3", "luid3", "c.jpg", 0, "", "image/jpeg", 0, 0);
+
+        addThumb(cache, a);
+        addThumb(cache, b);
+
+        // a is used after b was added: b becomes the least recently used
+        waitNextSecond();
+        CPPUNIT_ASSERT(hasThumb(cache, a));
+
+        addThumb(cache, c);
+        CPPUNIT_ASSERT_EQUAL((int64_t)2 * TEST_FILE_SIZE, cache.getCurrentSize());
+        CPPUNIT_ASSERT(hasThumb(cache, a));
+        CPPUNIT_ASSERT(!hasThumb(cache, b));
+        CPPUNIT_ASSERT(hasThumb(cache, c));
+        CPPUNIT_ASSERT(!fileExists(cache.getFilePath(&b, MHThumbnailKindThumb).c_str()));
+        CPPUNIT_ASSERT_EQUAL(2L, cache.getCount());
+    }
+
+    void testSetMaxSize() {
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 10 * TEST_FILE_SIZE);
+        MHSyncItemInfo a(1, "guid1", "luid1", "a.jpg", 0, "", "image/jpeg", 0, 0);
+        MHSyncItemInfo b(2, "guid2", "luid2", "b.jpg", 0, "", "image/jpeg", 0, 0);
+        MHSyncItemInfo c(3, "guid3", "luid3", "c.jpg", 0, "", "image/jpeg", 0, 0);
+
+        addThumb(cache, a);
+        addThumb(cache, b);
+        addThumb(cache, c);
+        CPPUNIT_ASSERT_EQUAL((int64_t)3 * TEST_FILE_SIZE, cache.getCurrentSize());
+
+        // shrinking the budget evicts the oldest files
+        cache.setMaxSize(TEST_FILE_SIZE);
+        CPPUNIT_ASSERT_EQUAL((int64_t)TEST_FILE_SIZE, cache.getCurrentSize());
+        CPPUNIT_ASSERT_EQUAL(1L, cache.getCount());
+        CPPUNIT_ASSERT(hasThumb(cache, c));
+
+        CPPUNIT_ASSERT(cache.clear());
+        CPPUNIT_ASSERT_EQUAL((int64_t)0, cache.getCurrentSize());
+        CPPUNIT_ASSERT(!hasThumb(cache, c));
+        CPPUNIT_ASSERT(!fileExists(cache.getFilePath(&c, MHThumbnailKindThumb).c_str()));
+    }
+
+    void testETagRevalidation() {
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 1000);
+        MHSyncItemInfo item(1, "guid1", "luid1", "pic1.jpg", 0, "", "image/jpeg", 0, 0);
+        item.setRemoteThumbETag("etag1");
+        addThumb(cache, item);
+
+        // an unknown remote etag does not invalidate the copy
+        item.setRemoteThumbETag("");
+        CPPUNIT_ASSERT(hasThumb(cache, item));
+
+        // the server regenerated the thumbnail: the copy is dropped
+        item.setRemoteThumbETag("etag2");
+        CPPUNIT_ASSERT(!hasThumb(cache, item));
+        CPPUNIT_ASSERT(!fileExists(cache.getFilePath(&item, MHThumbnailKindThumb).c_str()));
+        CPPUNIT_ASSERT(item.getLocalThumbPath().empty());
+        CPPUNIT_ASSERT(item.getLocalThumbETag().empty());
+        CPPUNIT_ASSERT_EQUAL((int64_t)0, cache.getCurrentSize());
+
+        // downloaded again: tagged with the new etag
+        addThumb(cache, item);
+        CPPUNIT_ASSERT(hasThumb(cache, item));
+        CPPUNIT_ASSERT(item.getLocalThumbETag() == "etag2");
+        CPPUNIT_ASSERT_EQUAL((int64_t)TEST_FILE_SIZE, cache.getCurrentSize());
+    }
+
+    void testMissingFile() {
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 1000);
+        MHSyncItemInfo item(1, "guid1", "luid1", "pic1.jpg", 0, "", "image/jpeg", 0, 0);
+        addThumb(cache, item);
+
+        remove(cache.getFilePath(&item, MHThumbnailKindThumb).c_str());
+        CPPUNIT_ASSERT(!hasThumb(cache, item));
+        CPPUNIT_ASSERT_EQUAL((int64_t)0, cache.getCurrentSize());
+        CPPUNIT_ASSERT_EQUAL(0L, cache.getCount());
+    }
+
+    void testItemsStoreUpdates() {
+        MHItemsStore items("items", TEST_ITEMS_DB, 0, 0);
+        MHSyncItemInfo item(0, "guid1", "luid1", "pic1.jpg", 0, "", "image/jpeg", 0, 0);
+        item.setRemoteThumbETag("etag1");
+        CPPUNIT_ASSERT(items.AddEntry(&item));
+        unsigned long id = item.getId();
+        CPPUNIT_ASSERT(id != 0);
+
+        MHThumbnailCache cache("thumbs", TEST_CACHE_DB, TEST_CACHE_DIR, 1000, &items);
+        addThumb(cache, item);
+        StringBuffer path = cache.getFilePath(&item, MHThumbnailKindThumb);
+
+        // the item fields are written in batches
+        CPPUNIT_ASSERT(cache.flush());
+        MHSyncItemInfo* stored = (MHSyncItemInfo*)items.getEntry(id);
+        CPPUNIT_ASSERT(stored != NULL);
+        CPPUNIT_ASSERT(stored->getLocalThumbPath() == path);
+        CPPUNIT_ASSERT(stored->getLocalThumbETag() == "etag1");
+        delete stored;
+
+        // evicted files are cleared from the items
+        cache.setMaxSize(0);
+        CPPUNIT_ASSERT(cache.flush());
+        stored = (MHSyncItemInfo*)items.getEntry(id);
+        CPPUNIT_ASSERT(stored != NULL);
+        CPPUNIT_ASSERT(stored->getLocalThumbPath().empty());
+        CPPUNIT_ASSERT(stored->getLocalThumbETag().empty());
+        delete stored;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MHThumbnailCacheTest );
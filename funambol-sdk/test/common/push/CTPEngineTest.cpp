@@ -0,0 +1,233 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "push/CTPConfig.h"
+#include "push/CTPSession.h"
+#include "push/CTPEngine.h"
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+/// Max time (msec) to wait for the engine to connect
+#define TEST_CONNECT_TIMEOUT    5000
+
+/**
+ * A listening socket on the IPv4 loopback, standing for the CTP Server.
+ */
+class LoopbackServer {
+public:
+    LoopbackServer() : fd(-1), port(0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        socklen_t len = sizeof(addr);
+        if (fd < 0 ||
+            ::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            ::listen(fd, 8) != 0 ||
+            ::getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+            return;
+        }
+        port = ntohs(addr.sin_port);
+    }
+
+    ~LoopbackServer() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /**
+     * Accepts a connection and reads the first bytes sent by the client.
+     * @return the number of bytes received, -1 if no connection within the timeout
+     */
+    int acceptAndRead(int timeout) {
+        struct pollfd pfd;
+        pfd.fd      = fd;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, timeout) != 1) {
+            return -1;
+        }
+        int client = ::accept(fd, NULL, NULL);
+        if (client < 0) {
+            return -1;
+        }
+
+        int n = -1;
+        pfd.fd      = client;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, timeout) == 1) {
+            char buf[256];
+            n = (int)::recv(client, buf, sizeof(buf), 0);
+        }
+        ::close(client);
+        return n;
+    }
+
+    int fd;
+    int port;
+};
+
+/**
+ * Test suite for the class CTPEngine, against a local listening socket.
+ */
+class CTPEngineTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(CTPEngineTest);
+    CPPUNIT_TEST(testConnect);
+    CPPUNIT_TEST(testResolveHostName);
+    CPPUNIT_TEST(testUnresolvedHostDoesNotBlock);
+    CPPUNIT_TEST(testRemoveSession);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {
+        clientConfig.setClientDefaults();
+        clientConfig.getAccessConfig().setUsername("guest");
+        clientConfig.getAccessConfig().setPassword("guest");
+        clientConfig.getDeviceConfig().setDevID("ctp-engine-test");
+    }
+
+private:
+    DMTClientConfig clientConfig;
+
+    static void initConfig(CTPConfig& config, const char* host, int port) {
+        config.setUrlTo(host);
+        config.setCtpPort(port);
+        config.setCtpCmdTimeout(5);
+        config.setCtpRetry(1);
+        config.getDeviceConfig().setDevID("ctp-engine-test");
+    }
+
+    /// The session sends its [AUTH] message as soon as the engine connects it.
+    void testConnect() {
+        LoopbackServer server;
+        CPPUNIT_ASSERT(server.port != 0);
+
+        CTPConfig config("ctp-engine-test");
+        initConfig(config, "127.0.0.1", server.port);
+        CTPSession session(config, &clientConfig);
+
+        CTPEngine engine;
+        CPPUNIT_ASSERT(engine.start());
+        CPPUNIT_ASSERT(engine.addSession(&session));
+        CPPUNIT_ASSERT(server.acceptAndRead(TEST_CONNECT_TIMEOUT) > 0);
+
+        CPPUNIT_ASSERT(engine.removeSession(&session));
+        CPPUNIT_ASSERT_EQUAL(0, (int)engine.getSessionCount());
+        engine.stop();
+    }
+
+    /**
+     * The name is resolved by the resolver thread. Where localhost resolves
+     * to ::1 first, the IPv4 server is reached by falling back to the next
+     * resolved address.
+     */
+    void testResolveHostName() {
+        LoopbackServer server;
+        CPPUNIT_ASSERT(server.port != 0);
+
+        CTPConfig config("ctp-engine-test");
+        initConfig(config, "localhost", server.port);
+        CTPSession session(config, &clientConfig);
+
+        CTPEngine engine;
+        CPPUNIT_ASSERT(engine.start());
+        engine.addSession(&session);
+        CPPUNIT_ASSERT(server.acceptAndRead(TEST_CONNECT_TIMEOUT) > 0);
+
+        engine.removeSession(&session);
+        engine.stop();
+    }
+
+    /// A name that can't be resolved does not delay the other sessions of the loop.
+    void testUnresolvedHostDoesNotBlock() {
+        LoopbackServer server;
+        CPPUNIT_ASSERT(server.port != 0);
+
+        CTPConfig badConfig("ctp-engine-test");
+        initConfig(badConfig, "ctp-engine-test.invalid", server.port);
+        CTPSession badSession(badConfig, &clientConfig);
+
+        CTPConfig config("ctp-engine-test");
+        initConfig(config, "127.0.0.1", server.port);
+        CTPSession session(config, &clientConfig);
+
+        // a single loop serves both sessions
+        CTPEngine engine(1);
+        CPPUNIT_ASSERT(engine.start());
+        engine.addSession(&badSession);
+        engine.addSession(&session);
+        CPPUNIT_ASSERT(server.acceptAndRead(TEST_CONNECT_TIMEOUT) > 0);
+        CPPUNIT_ASSERT_EQUAL(2, (int)engine.getSessionCount());
+
+        CPPUNIT_ASSERT(engine.removeSession(&badSession));
+        CPPUNIT_ASSERT(engine.removeSession(&session));
+        engine.stop();
+    }
+
+    /// A session can be removed while its name is being resolved.
+    void testRemoveSession() {
+        CTPConfig config("ctp-engine-test");
+        initConfig(config, "localhost", 1);
+        CTPSession session(config, &clientConfig);
+
+        CTPEngine engine;
+        CPPUNIT_ASSERT(engine.start());
+        engine.addSession(&session);
+        CPPUNIT_ASSERT(engine.removeSession(&session));
+        CPPUNIT_ASSERT(!engine.removeSession(&session));
+        CPPUNIT_ASSERT(session.isLeaving());
+        engine.stop();
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTPEngineTest );
@@ -0,0 +1,194 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "push/CTPRingBuffer.h"
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+/// Small packages: the ring is 64 bytes
+#define TEST_MAX_PACKAGE    16
+
+/**
+ * Test suite for the class CTPRingBuffer.
+ */
+class CTPRingBufferTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(CTPRingBufferTest);
+    CPPUNIT_TEST(testSplitPackage);
+    CPPUNIT_TEST(testSeveralMessages);
+    CPPUNIT_TEST(testWrapAround);
+    CPPUNIT_TEST(testInvalidLength);
+    CPPUNIT_TEST(testWriteSpace);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+
+    /// Fills 'pkg' with a package of 'msgLen' bytes (+2 of length)
+    int32_t makePackage(char* pkg, int32_t msgLen, char fill) {
+        pkg[0] = (char)(msgLen >> 8);
+        pkg[1] = (char)(msgLen & 0xff);
+        for (int32_t i = 0; i < msgLen; i++) {
+            pkg[i+2] = (char)(fill + i);
+        }
+        return msgLen + 2;
+    }
+
+    /// Writes 'len' bytes not framed as a package
+    void fill(CTPRingBuffer& ring, int32_t len) {
+        for (int32_t i = 0; i < len; i++) {
+            char c = 0;
+            ring.write(&c, 1);
+        }
+    }
+
+public:
+
+    void testSplitPackage() {
+        CTPRingBuffer ring(TEST_MAX_PACKAGE);
+        char pkg[TEST_MAX_PACKAGE];
+        int32_t len = makePackage(pkg, 6, 'a');
+        const char* msg = NULL;
+
+        // Only the first byte of the length
+        ring.write(pkg, 1);
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(msg == NULL);
+
+        ring.write(&pkg[1], 4);
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, ring.nextMessage(&msg));
+
+        ring.write(&pkg[5], len - 5);
+        CPPUNIT_ASSERT_EQUAL(len, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, pkg, len) == 0);
+
+        ring.consume(len);
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, ring.size());
+    }
+
+    void testSeveralMessages() {
+        CTPRingBuffer ring(TEST_MAX_PACKAGE);
+        char data[TEST_MAX_PACKAGE * 3];
+        int32_t len1 = makePackage(data, 4, 'a');
+        int32_t len2 = makePackage(&data[len1], 8, 'k');
+        int32_t len3 = makePackage(&data[len1+len2], 2, 'x');
+        const char* msg = NULL;
+
+        // All in a single read, plus the first byte of the next one
+        data[len1+len2+len3] = 0;
+        ring.write(data, len1 + len2 + len3 + 1);
+
+        CPPUNIT_ASSERT_EQUAL(len1, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, data, len1) == 0);
+        ring.consume(len1);
+
+        CPPUNIT_ASSERT_EQUAL(len2, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, &data[len1], len2) == 0);
+        ring.consume(len2);
+
+        CPPUNIT_ASSERT_EQUAL(len3, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, &data[len1+len2], len3) == 0);
+        ring.consume(len3);
+
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT_EQUAL((int32_t)1, ring.size());
+    }
+
+    void testWrapAround() {
+        CTPRingBuffer ring(TEST_MAX_PACKAGE);
+        char pkg[TEST_MAX_PACKAGE];
+        int32_t len = makePackage(pkg, 10, 'a');
+        const char* msg = NULL;
+
+        // Move the read position forward, keeping the first byte of the
+        // package buffered so that the positions are not reset
+        fill(ring, 40);
+        ring.write(pkg, 1);
+        ring.consume(40);
+        ring.write(&pkg[1], len - 1);
+        CPPUNIT_ASSERT_EQUAL(len, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, pkg, len) == 0);
+        ring.consume(len);
+
+        // Same, with the package split across the end of the ring (64 bytes)
+        fill(ring, 59);
+        ring.write(pkg, 1);
+        ring.consume(59);
+        ring.write(&pkg[1], len - 1);
+        CPPUNIT_ASSERT_EQUAL(len, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(memcmp(msg, pkg, len) == 0);
+        ring.consume(len);
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, ring.size());
+    }
+
+    void testInvalidLength() {
+        const char* msg = NULL;
+        char pkg[2];
+
+        CTPRingBuffer empty(TEST_MAX_PACKAGE);
+        pkg[0] = 0; pkg[1] = 0;
+        empty.write(pkg, 2);
+        CPPUNIT_ASSERT_EQUAL((int32_t)-1, empty.nextMessage(&msg));
+
+        CTPRingBuffer big(TEST_MAX_PACKAGE);
+        pkg[0] = 0; pkg[1] = TEST_MAX_PACKAGE - 1;
+        big.write(pkg, 2);
+        CPPUNIT_ASSERT_EQUAL((int32_t)-1, big.nextMessage(&msg));
+    }
+
+    void testWriteSpace() {
+        CTPRingBuffer ring(TEST_MAX_PACKAGE);
+        char pkg[TEST_MAX_PACKAGE];
+        int32_t len = makePackage(pkg, 5, 'a');
+        const char* msg = NULL;
+
+        int32_t space = 0;
+        char* dest = ring.getWriteSpace(&space);
+        CPPUNIT_ASSERT(space >= len);
+        memcpy(dest, pkg, len);
+        ring.commit(len);
+
+        // Framed in place, where it was received
+        CPPUNIT_ASSERT_EQUAL(len, ring.nextMessage(&msg));
+        CPPUNIT_ASSERT(msg == dest);
+        ring.consume(len);
+        CPPUNIT_ASSERT_EQUAL(ring.space(), ring.size() + space);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTPRingBufferTest );
@@ -0,0 +1,251 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "push/TaskExecutor.h"
+#include "spds/SyncManagerConfig.h"
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+#include <vector>
+
+USE_NAMESPACE
+
+/**
+ * A closed gate: tasks waiting on it keep their worker busy until open().
+ */
+class Gate {
+public:
+    Gate() : opened(false) {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~Gate() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+    void pass() {
+        pthread_mutex_lock(&mutex);
+        while (!opened) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    void open() {
+        pthread_mutex_lock(&mutex);
+        opened = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+private:
+    bool opened;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+};
+
+/**
+ * SyncManagerConfig leaves the credential info to the clients: only its
+ * abort flag is used here.
+ */
+class TestConfig : public SyncManagerConfig {
+public:
+    const char* getCredInfo() const { return credInfo.c_str(); }
+    void setCredInfo(const char* credInfo_) { credInfo = credInfo_; }
+private:
+    StringBuffer credInfo;
+};
+
+class GateTask : public Task {
+public:
+    GateTask(Gate& g) : gate(g) {}
+    void run() { gate.pass(); }
+    Gate& gate;
+};
+
+/**
+ * Sums the numbers in [from, to) and appends its id to a shared list.
+ */
+class SumTask : public Task {
+public:
+    SumTask(int f, int t, int i = 0, std::vector<int>* l = NULL, Priority p = NormalPriority)
+        : Task(p), from(f), to(t), id(i), list(l), sum(0) {}
+
+    void run() {
+        for (int i = from; i < to; i++) {
+            sum += i;
+        }
+        if (list) {
+            list->push_back(id);
+        }
+    }
+
+    int from, to, id;
+    std::vector<int>* list;
+    long sum;
+};
+
+/**
+ * Splits a sum in subtasks, submitted from the worker thread.
+ */
+class SplitTask : public Task {
+public:
+    SplitTask(TaskExecutor& e, int n) : executor(e), parts(n) {}
+
+    void run() {
+        for (int i = 0; i < parts; i++) {
+            futures.push_back(executor.submit(new SumTask(i * 100, (i + 1) * 100)));
+        }
+    }
+
+    TaskExecutor& executor;
+    int parts;
+    std::vector<TaskFuture> futures;
+};
+
+/**
+ * Test suite for the class TaskExecutor.
+ */
+class TaskExecutorTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(TaskExecutorTest);
+    CPPUNIT_TEST(testRunAll);
+    CPPUNIT_TEST(testSubtasks);
+    CPPUNIT_TEST(testPriority);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST(testAbortConfig);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {}
+    void tearDown() {}
+
+private:
+
+    void testRunAll() {
+        TaskExecutor executor(4);
+        CPPUNIT_ASSERT_EQUAL(4, executor.getWorkerCount());
+
+        std::vector<TaskFuture> futures;
+        for (int i = 0; i < 100; i++) {
+            futures.push_back(executor.submit(new SumTask(i * 100, (i + 1) * 100)));
+        }
+
+        long total = 0;
+        for (size_t i = 0; i < futures.size(); i++) {
+            CPPUNIT_ASSERT(futures[i].wait());
+            CPPUNIT_ASSERT(futures[i].isDone());
+            CPPUNIT_ASSERT(!futures[i].isCancelled());
+            total += static_cast<SumTask*>(futures[i].getTask())->sum;
+        }
+        CPPUNIT_ASSERT_EQUAL(10000L * 9999 / 2, total);
+        CPPUNIT_ASSERT_EQUAL(0, executor.getQueuedCount());
+    }
+
+    void testSubtasks() {
+        TaskExecutor executor(4);
+
+        TaskFuture f = executor.submit(new SplitTask(executor, 100));
+        CPPUNIT_ASSERT(f.wait());
+
+        // the subtasks are queued on the worker, the others steal them
+        SplitTask* split = static_cast<SplitTask*>(f.getTask());
+        CPPUNIT_ASSERT_EQUAL(100, (int)split->futures.size());
+        long total = 0;
+        for (size_t i = 0; i < split->futures.size(); i++) {
+            CPPUNIT_ASSERT(split->futures[i].wait());
+            total += static_cast<SumTask*>(split->futures[i].getTask())->sum;
+        }
+        CPPUNIT_ASSERT_EQUAL(10000L * 9999 / 2, total);
+    }
+
+    void testPriority() {
+        TaskExecutor executor(1);
+        Gate gate;
+        std::vector<int> order;
+
+        // keep the only worker busy while the tasks are queued
+        TaskFuture busy = executor.submit(new GateTask(gate));
+        executor.submit(new SumTask(0, 1, 1, &order, Task::LowPriority));
+        executor.submit(new SumTask(0, 1, 2, &order, Task::NormalPriority));
+        TaskFuture last = executor.submit(new SumTask(0, 1, 3, &order, Task::HighPriority));
+        gate.open();
+
+        CPPUNIT_ASSERT(busy.wait());
+        CPPUNIT_ASSERT(last.wait());
+        TaskFuture end = executor.submit(new SumTask(0, 1, 4, &order, Task::LowPriority));
+        CPPUNIT_ASSERT(end.wait());
+
+        CPPUNIT_ASSERT_EQUAL(4, (int)order.size());
+        CPPUNIT_ASSERT_EQUAL(3, order[0]);
+        CPPUNIT_ASSERT_EQUAL(2, order[1]);
+        CPPUNIT_ASSERT_EQUAL(1, order[2]);
+    }
+
+    void testCancel() {
+        TaskExecutor executor(1);
+        Gate gate;
+        std::vector<int> order;
+
+        executor.submit(new GateTask(gate));
+        TaskFuture f = executor.submit(new SumTask(0, 10, 1, &order));
+        CPPUNIT_ASSERT(!f.wait(50));
+        CPPUNIT_ASSERT(f.cancel());
+        gate.open();
+
+        CPPUNIT_ASSERT(f.wait());
+        CPPUNIT_ASSERT(f.isCancelled());
+        CPPUNIT_ASSERT(order.empty());
+    }
+
+    void testAbortConfig() {
+        TaskExecutor executor(2);
+        TestConfig config;
+
+        config.setToAbort(true);
+        TaskFuture f = executor.submit(new SumTask(0, 10), &config);
+        CPPUNIT_ASSERT(f.wait());
+        CPPUNIT_ASSERT(f.isCancelled());
+        CPPUNIT_ASSERT_EQUAL(0L, static_cast<SumTask*>(f.getTask())->sum);
+
+        config.setToAbort(false);
+        f = executor.submit(new SumTask(0, 10), &config);
+        CPPUNIT_ASSERT(f.wait());
+        CPPUNIT_ASSERT(!f.isCancelled());
+        CPPUNIT_ASSERT_EQUAL(45L, static_cast<SumTask*>(f.getTask())->sum);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TaskExecutorTest );
@@ -0,0 +1,223 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/util/utils.h"
+#include "push/TimerWheel.h"
+
+#include <pthread.h>
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+#define TEST_TICK   100
+
+/**
+ * Records the time it expired, optionally re-scheduling itself.
+ */
+class TestTask : public TimerTask {
+public:
+    TestTask(TimerWheel& w, int64_t& clock) : wheel(w), now(clock), fired(-1),
+                                             runs(0), period(0) {}
+
+    void onTimeout() {
+        fired = now;
+        runs++;
+        if (period) {
+            wheel.schedule(this, period, now);
+        }
+    }
+
+    TimerWheel& wheel;
+    int64_t& now;
+    int64_t fired;
+    int runs;
+    int64_t period;
+};
+
+/**
+ * Re-schedules itself from a slow onTimeout(), like the CTP heartbeat.
+ */
+class SlowPeriodicTask : public TimerTask {
+public:
+    SlowPeriodicTask(TimerWheel& w) : wheel(w), started(0) {}
+
+    void onTimeout() {
+        __sync_add_and_fetch(&started, 1);
+        sleepMilliSeconds(200);
+        wheel.schedule(this, 1000, TimerWheel::now());
+    }
+
+    TimerWheel& wheel;
+    volatile int started;
+};
+
+/**
+ * Test suite for the class TimerWheel.
+ */
+class TimerWheelTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(TimerWheelTest);
+    CPPUNIT_TEST(testExpireInOrder);
+    CPPUNIT_TEST(testCancel);
+    CPPUNIT_TEST(testCancelWhileRescheduling);
+    CPPUNIT_TEST(testLongDelayCascade);
+    CPPUNIT_TEST(testReschedule);
+    CPPUNIT_TEST(testNextExpiry);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+
+    /// Advances the clock as a driver would, up to 'until'.
+    void runUntil(TimerWheel& wheel, int64_t& now, int64_t until) {
+        while (now < until) {
+            int64_t next = wheel.getNextExpiry(now);
+            if (next < 0 || next > until) {
+                next = until;
+            }
+            now = next > now ? next : now + 1;
+            wheel.expire(now);
+        }
+    }
+
+    void testExpireInOrder() {
+        int64_t now = 1000;
+        TimerWheel wheel(TEST_TICK);
+        TestTask a(wheel, now), b(wheel, now), c(wheel, now);
+
+        wheel.schedule(&a, 250, now);
+        wheel.schedule(&b, 50, now);
+        wheel.schedule(&c, 0, now);
+        CPPUNIT_ASSERT_EQUAL(3, (int)wheel.size());
+
+        runUntil(wheel, now, 2000);
+        CPPUNIT_ASSERT_EQUAL(0, (int)wheel.size());
+        // Never before the delay, at most one tick later
+        CPPUNIT_ASSERT(c.fired >= 1000 && c.fired < 1000 + TEST_TICK);
+        CPPUNIT_ASSERT(b.fired >= 1050 && b.fired < 1050 + TEST_TICK);
+        CPPUNIT_ASSERT(a.fired >= 1250 && a.fired < 1250 + TEST_TICK);
+    }
+
+    void testCancel() {
+        int64_t now = 0;
+        TimerWheel wheel(TEST_TICK);
+        TestTask a(wheel, now), b(wheel, now);
+
+        wheel.schedule(&a, 500, now);
+        wheel.schedule(&b, 500, now);
+        CPPUNIT_ASSERT(wheel.cancel(&a));
+        CPPUNIT_ASSERT(!a.isScheduled());
+        CPPUNIT_ASSERT(!wheel.cancel(&a));
+
+        runUntil(wheel, now, 1000);
+        CPPUNIT_ASSERT_EQUAL(0, a.runs);
+        CPPUNIT_ASSERT_EQUAL(1, b.runs);
+    }
+
+    static void* expireMain(void* arg) {
+        TimerWheel* wheel = (TimerWheel*)arg;
+        // A task is due at most one tick after its delay
+        wheel->expire(TimerWheel::now() + TEST_TICK);
+        return NULL;
+    }
+
+    void testCancelWhileRescheduling() {
+        TimerWheel wheel(TEST_TICK);
+        SlowPeriodicTask task(wheel);
+        wheel.schedule(&task, 0, TimerWheel::now());
+
+        pthread_t timer;
+        CPPUNIT_ASSERT(pthread_create(&timer, NULL, expireMain, &wheel) == 0);
+        while (__sync_add_and_fetch(&task.started, 0) == 0) {
+            sleepMilliSeconds(1);
+        }
+
+        // The task schedules itself again after cancel() started waiting
+        wheel.cancel(&task);
+        CPPUNIT_ASSERT(!task.isScheduled());
+        CPPUNIT_ASSERT_EQUAL(0, (int)wheel.size());
+        pthread_join(timer, NULL);
+    }
+
+    void testLongDelayCascade() {
+        int64_t now = 12345;
+        TimerWheel wheel(TEST_TICK);
+        TestTask a(wheel, now), b(wheel, now);
+
+        // Beyond the first and the second level of the wheel
+        int64_t delayA = (int64_t)TEST_TICK * TIMER_WHEEL_SLOTS * 3 + 70;
+        int64_t delayB = (int64_t)TEST_TICK * TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS * 2 + 10;
+        wheel.schedule(&a, delayA, 12345);
+        wheel.schedule(&b, delayB, 12345);
+
+        runUntil(wheel, now, 12345 + delayB + 1000);
+        CPPUNIT_ASSERT(a.fired >= 12345 + delayA && a.fired < 12345 + delayA + TEST_TICK);
+        CPPUNIT_ASSERT(b.fired >= 12345 + delayB && b.fired < 12345 + delayB + TEST_TICK);
+    }
+
+    void testReschedule() {
+        int64_t now = 0;
+        TimerWheel wheel(TEST_TICK);
+        TestTask a(wheel, now);
+
+        // Periodic task, re-scheduled from onTimeout()
+        a.period = 1000;
+        wheel.schedule(&a, 1000, now);
+        runUntil(wheel, now, 10500);
+        CPPUNIT_ASSERT_EQUAL(10, a.runs);
+        CPPUNIT_ASSERT(a.isScheduled());
+
+        // Moving a scheduled task does not duplicate it
+        wheel.schedule(&a, 5000, now);
+        CPPUNIT_ASSERT_EQUAL(1, (int)wheel.size());
+    }
+
+    void testNextExpiry() {
+        int64_t now = 0;
+        TimerWheel wheel(TEST_TICK);
+        TestTask a(wheel, now);
+
+        CPPUNIT_ASSERT_EQUAL((int64_t)-1, wheel.getNextExpiry(now));
+        wheel.schedule(&a, 300, now);
+        int64_t next = wheel.getNextExpiry(now);
+        CPPUNIT_ASSERT(next >= 0 && next <= 300);
+        wheel.cancel(&a);
+        CPPUNIT_ASSERT_EQUAL((int64_t)-1, wheel.getNextExpiry(now));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TimerWheelTest );
@@ -67,6 +67,7 @@ class ItemReaderTest : public CppUnit::TestFixture {
         CPPUNIT_TEST(testSimpleItemReaderBin);
         CPPUNIT_TEST(testItemReaderMultiChunkBin);   
         CPPUNIT_TEST(testSimpleItemReaderDes);            
+        CPPUNIT_TEST(testChunkReleaseData);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -152,6 +153,27 @@ private:
         delete c;
     }
     
+    void testChunkReleaseData(){
+        int maxMsgSize = 1024;
+        EncodingHelper helper("b64", NULL, NULL);
+        ItemReader itemReader(maxMsgSize, helper);
+        itemReader.setSyncItem(syncItem);
+        Chunk* c = itemReader.getNextChunk(maxMsgSize);
+        CPPUNIT_ASSERT( c != NULL );
+        CPPUNIT_ASSERT_EQUAL((unsigned long)strlen(TEST_STRING_B64), c->getDataSize());
+        CPPUNIT_ASSERT(!strcmp(c->getDataEncoding().c_str(), "b64"));
+
+        // the data is handed over as is, and the chunk is left empty
+        const char* data = c->getData();
+        char* released = c->releaseData();
+        CPPUNIT_ASSERT(released == data);
+        CPPUNIT_ASSERT(!strcmp(released, TEST_STRING_B64));
+        CPPUNIT_ASSERT_EQUAL(0UL, c->getDataSize());
+        CPPUNIT_ASSERT(!strcmp(c->getData(), ""));
+        delete c;
+        delete [] released;
+    }
+
     char* getEncodedWithDes(const char* password) {
         
         DataTransformer* b64e;
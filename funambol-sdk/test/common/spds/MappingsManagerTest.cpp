@@ -0,0 +1,143 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include "base/fscapi.h"
+#include "base/util/PropertyFile.h"
+#include "base/util/StringBuffer.h"
+#include "spds/MappingsManager.h"
+
+USE_NAMESPACE
+
+/**
+ * Creates the mapping stores in the current folder.
+ */
+class TestMappingStoreBuilder : public MappingStoreBuilder {
+public:
+    KeyValueStore* createNewInstance(const char* name) const {
+        StringBuffer fullName(name);
+        fullName += ".map";
+        return new PropertyFile(fullName);
+    }
+};
+
+class MappingsManagerTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(MappingsManagerTest);
+    CPPUNIT_TEST(testLookupMapping);
+    CPPUNIT_TEST(testMappingsPersisted);
+    CPPUNIT_TEST(testResetMappings);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {
+        MappingsManager::setBuilder(new TestMappingStoreBuilder());
+        MappingsManager m("mappingsTest");
+        m.resetMappings();
+    }
+
+    void tearDown() {
+        MappingsManager::setBuilder(NULL);
+    }
+
+private:
+
+    /**
+     * The GUIDs are found both in the mappings of the store and in the
+     * ones added after the first lookup.
+     */
+    void testLookupMapping() {
+        MappingsManager m("mappingsTest");
+        CPPUNIT_ASSERT(m.addMapping("luid1", "guid1"));
+        CPPUNIT_ASSERT(m.lookupMapping("guid1") == "luid1");
+        CPPUNIT_ASSERT(m.lookupMapping("guid2") == "");
+
+        CPPUNIT_ASSERT(m.addMapping("luid2", "guid2"));
+        CPPUNIT_ASSERT(m.lookupMapping("guid2") == "luid2");
+
+        // a LUID mapped again
+        CPPUNIT_ASSERT(m.addMapping("luid1", "guid3"));
+        CPPUNIT_ASSERT(m.lookupMapping("guid1") == "");
+        CPPUNIT_ASSERT(m.lookupMapping("guid3") == "luid1");
+        CPPUNIT_ASSERT(m.closeMappings());
+    }
+
+    /**
+     * The mappings added are there after closeMappings(), and also if the
+     * manager is not closed, as after a crash.
+     */
+    void testMappingsPersisted() {
+        {
+            MappingsManager m("mappingsTest");
+            for (int i = 0; i < 100; i++) {
+                StringBuffer luid, guid;
+                luid.sprintf("luid%d", i);
+                guid.sprintf("guid%d", i);
+                CPPUNIT_ASSERT(m.addMapping(luid.c_str(), guid.c_str()));
+            }
+            CPPUNIT_ASSERT(m.closeMappings());
+            CPPUNIT_ASSERT(m.addMapping("luidJournal", "guidJournal"));
+        }
+
+        MappingsManager m("mappingsTest");
+        CPPUNIT_ASSERT(m.lookupMapping("guid0") == "luid0");
+        CPPUNIT_ASSERT(m.lookupMapping("guid99") == "luid99");
+        CPPUNIT_ASSERT(m.lookupMapping("guidJournal") == "luidJournal");
+        m.resetMappings();
+    }
+
+    /**
+     * Nothing is left after a reset, in memory or in the storage.
+     */
+    void testResetMappings() {
+        {
+            MappingsManager m("mappingsTest");
+            CPPUNIT_ASSERT(m.addMapping("luid1", "guid1"));
+            CPPUNIT_ASSERT(m.lookupMapping("guid1") == "luid1");
+            CPPUNIT_ASSERT(m.resetMappings());
+            CPPUNIT_ASSERT(m.lookupMapping("guid1") == "");
+            CPPUNIT_ASSERT(!m.getMappings().hasMoreElement());
+            CPPUNIT_ASSERT(m.closeMappings());
+        }
+
+        MappingsManager m("mappingsTest");
+        CPPUNIT_ASSERT(!m.getMappings().hasMoreElement());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MappingsManagerTest );
@@ -0,0 +1,206 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include "base/fscapi.h"
+#include "base/util/PropertyFile.h"
+#include "spds/SyncCheckpoint.h"
+
+USE_NAMESPACE
+
+#define CHECKPOINT_TEST_FILE "checkpointTest.chk"
+
+class SyncCheckpointTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(SyncCheckpointTest);
+    CPPUNIT_TEST(testNoCheckpoint);
+    CPPUNIT_TEST(testResume);
+    CPPUNIT_TEST(testUncommittedKeys);
+    CPPUNIT_TEST(testStartDropsPrevious);
+    CPPUNIT_TEST(testResumeRefused);
+    CPPUNIT_TEST(testRestartKeepsKeys);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {
+        PropertyFile(CHECKPOINT_TEST_FILE).removeAllProperties();
+    }
+
+    void tearDown() {
+        PropertyFile(CHECKPOINT_TEST_FILE).removeAllProperties();
+    }
+
+private:
+
+    SyncCheckpoint* open() {
+        return new SyncCheckpoint(new PropertyFile(CHECKPOINT_TEST_FILE));
+    }
+
+    void testNoCheckpoint() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT_EQUAL(SYNC_NONE, c->getSyncMode());
+        CPPUNIT_ASSERT_EQUAL(0, c->getAcknowledgedCount());
+
+        // keys without a session are ignored
+        c->addAcknowledged("key1");
+        CPPUNIT_ASSERT(!c->isAcknowledged("key1"));
+        delete c;
+    }
+
+    /**
+     * The session and the committed keys are found by the next sync,
+     * only if requested with the same sync mode.
+     */
+    void testResume() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_SLOW, SYNC_TWO_WAY, 1234));
+        c->addAcknowledged("key1");
+        c->addAcknowledged("key2");
+        c->addAcknowledged("key1");
+        CPPUNIT_ASSERT_EQUAL(0, c->commit());
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT(!c->canResume(SYNC_ONE_WAY_FROM_CLIENT));
+        CPPUNIT_ASSERT_EQUAL(SYNC_SLOW, c->getSyncMode());
+        CPPUNIT_ASSERT_EQUAL(SYNC_TWO_WAY, c->getPreferredSyncMode());
+        CPPUNIT_ASSERT_EQUAL(1234UL, c->getNextSync());
+        CPPUNIT_ASSERT_EQUAL(2, c->getAcknowledgedCount());
+        CPPUNIT_ASSERT(c->isAcknowledged("key1"));
+        CPPUNIT_ASSERT(c->isAcknowledged("key2"));
+        CPPUNIT_ASSERT(!c->isAcknowledged("key3"));
+        CPPUNIT_ASSERT(!c->isResumed());
+
+        CPPUNIT_ASSERT_EQUAL(0, c->clear());
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT_EQUAL(0, c->getAcknowledgedCount());
+        delete c;
+    }
+
+    /**
+     * The keys not committed are still saved in the journal, as when
+     * the sync is interrupted by a crash.
+     */
+    void testUncommittedKeys() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_TWO_WAY, SYNC_TWO_WAY, 1));
+        c->addAcknowledged("key1");
+        CPPUNIT_ASSERT_EQUAL(0, c->commit());
+        c->addAcknowledged("key2");
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT(c->isAcknowledged("key1"));
+        CPPUNIT_ASSERT(c->isAcknowledged("key2"));
+        delete c;
+    }
+
+    void testStartDropsPrevious() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_TWO_WAY, SYNC_TWO_WAY, 1));
+        c->addAcknowledged("key1");
+        CPPUNIT_ASSERT_EQUAL(0, c->commit());
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_REFRESH_FROM_SERVER, SYNC_REFRESH_FROM_SERVER, 2));
+        CPPUNIT_ASSERT(!c->isAcknowledged("key1"));
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(c->canResume(SYNC_REFRESH_FROM_SERVER));
+        CPPUNIT_ASSERT_EQUAL(2UL, c->getNextSync());
+        CPPUNIT_ASSERT_EQUAL(0, c->getAcknowledgedCount());
+        delete c;
+    }
+
+    /**
+     * Once the server has not answered the resume alert, it is not sent
+     * again, also after the checkpoint is cleared.
+     */
+    void testResumeRefused() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_TWO_WAY, SYNC_TWO_WAY, 1));
+        c->setResumeRefused();
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT_EQUAL(0, c->clear());
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(c->isResumeRefused());
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_TWO_WAY, SYNC_TWO_WAY, 2));
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        delete c;
+    }
+
+    /**
+     * A server going on with the same incremental sync in a new session
+     * keeps the keys acknowledged, with the new anchor.
+     */
+    void testRestartKeepsKeys() {
+        SyncCheckpoint* c = open();
+        CPPUNIT_ASSERT_EQUAL(0, c->start(SYNC_TWO_WAY, SYNC_TWO_WAY, 1));
+        c->setResumeRefused();
+        c->addAcknowledged("key1");
+        CPPUNIT_ASSERT_EQUAL(0, c->commit());
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT(!c->canResume(SYNC_TWO_WAY));
+        CPPUNIT_ASSERT(c->canContinue(SYNC_TWO_WAY, SYNC_TWO_WAY));
+        CPPUNIT_ASSERT(!c->canContinue(SYNC_TWO_WAY, SYNC_SLOW));
+        CPPUNIT_ASSERT(!c->canContinue(SYNC_ONE_WAY_FROM_CLIENT, SYNC_TWO_WAY));
+        CPPUNIT_ASSERT_EQUAL(0, c->restart(2));
+        c->addAcknowledged("key2");
+        CPPUNIT_ASSERT_EQUAL(0, c->commit());
+        delete c;
+
+        c = open();
+        CPPUNIT_ASSERT_EQUAL(2UL, c->getNextSync());
+        CPPUNIT_ASSERT(c->isAcknowledged("key1"));
+        CPPUNIT_ASSERT(c->isAcknowledged("key2"));
+        CPPUNIT_ASSERT(c->isResumeRefused());
+        delete c;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SyncCheckpointTest );
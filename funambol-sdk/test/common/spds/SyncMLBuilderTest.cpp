@@ -0,0 +1,246 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include "base/fscapi.h"
+#include "base/util/ArrayList.h"
+#include "base/util/StringBuffer.h"
+#include "spds/SyncMLBuilder.h"
+#include "spds/SyncSource.h"
+#include "spds/SyncSourceConfig.h"
+#include "spds/SyncMap.h"
+#include "syncml/core/Authentication.h"
+#include "syncml/core/Cred.h"
+#include "syncml/formatter/Formatter.h"
+
+USE_NAMESPACE
+
+/**
+ * A source that has nothing to send, used to prepare Sync commands.
+ */
+class BuilderTestSyncSource : public SyncSource {
+
+public:
+
+    BuilderTestSyncSource(const WCHAR* name, SyncSourceConfig* sc) : SyncSource(name, sc) {}
+
+    int addItem(SyncItem& item)    { return 200; }
+    int updateItem(SyncItem& item) { return 200; }
+    int deleteItem(SyncItem& item) { return 200; }
+
+    void updateItemInfo(SyncItem& item, int index) {}
+    int  updateItemStatus(SyncItem& item) { return 201; }
+    void saveAddressBook() {}
+
+    int removeAllItems() { return 0; }
+    SyncItem* getFirstItem() { return NULL; }
+    SyncItem* getNextItem() { return NULL; }
+    SyncItem* getFirstNewItem() { return NULL; }
+    SyncItem* getNextNewItem() { return NULL; }
+    SyncItem* getFirstUpdatedItem() { return NULL; }
+    SyncItem* getNextUpdatedItem() { return NULL; }
+    SyncItem* getFirstDeletedItem() { return NULL; }
+    SyncItem* getNextDeletedItem() { return NULL; }
+    ArrayElement* clone() { return NULL; }
+};
+
+class SyncMLBuilderTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(SyncMLBuilderTest);
+    CPPUNIT_TEST(testPrepareMsg);
+    CPPUNIT_TEST(testSyncCommand);
+    CPPUNIT_TEST(testCopyAndAdopt);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {}
+    void tearDown() {}
+
+private:
+
+    /**
+     * Checks that prepareMsg() returns what the Formatter does.
+     */
+    void checkMsg(SyncMLBuilder& builder, SyncML* syncml) {
+        char* msg = builder.prepareMsg(syncml);
+        StringBuffer* expected = Formatter::getSyncML(syncml);
+        CPPUNIT_ASSERT(msg);
+        CPPUNIT_ASSERT(expected);
+        CPPUNIT_ASSERT_EQUAL(std::string(expected->c_str()), std::string(msg));
+        delete [] msg;
+        delete expected;
+        delete syncml;
+    }
+
+    /**
+     * The SyncHdr reused from the previous messages must follow the
+     * changes of the credentials, of the target and of the message ID.
+     */
+    void testPrepareMsg() {
+        SyncMLBuilder builder("http://server/sync", "device-id");
+
+        Authentication* auth = new Authentication(AUTH_TYPE_BASIC, "user", "pass");
+        Cred* cred = new Cred(auth);
+        ArrayList alerts;
+        ArrayList commands;
+        checkMsg(builder, builder.prepareInitObject(cred, &alerts, &commands, 16000, 4000));
+        checkMsg(builder, builder.prepareSyncML(&commands, false));
+        checkMsg(builder, builder.prepareSyncML(&commands, true));
+
+        // the server can redirect the client to another URL
+        builder.setTarget("http://server/sync?sid=1234");
+        checkMsg(builder, builder.prepareSyncML(&commands, true));
+
+        delete cred;
+        delete auth;
+        CPPUNIT_ASSERT(builder.prepareMsg(NULL) == NULL);
+    }
+
+    /**
+     * The Target and Source of the Sync commands are formatted once per
+     * source, and as if they were formatted every time.
+     */
+    void testSyncCommand() {
+        SyncMLBuilder builder("http://server/sync", "device-id");
+
+        SyncSourceConfig* config1 = new SyncSourceConfig();
+        config1->setURI("card");
+        BuilderTestSyncSource source1(TEXT("contact"), config1);
+        SyncSourceConfig* config2 = new SyncSourceConfig();
+        config2->setURI("event");
+        BuilderTestSyncSource source2(TEXT("calendar"), config2);
+
+        for (int i = 0; i < 2; i++) {
+            Sync* sync1 = builder.prepareSyncCommand(source1);
+            Sync* sync2 = builder.prepareSyncCommand(source2);
+            CPPUNIT_ASSERT(sync1->getFormattedTargetSource());
+            CPPUNIT_ASSERT(sync2->getFormattedTargetSource());
+
+            StringBuffer* formatted1 = Formatter::getSync(sync1);
+            StringBuffer* formatted2 = Formatter::getSync(sync2);
+
+            // format them again from the objects
+            Target target1("card");
+            Source s1("contact");
+            sync1->setTarget(&target1);
+            sync1->setSource(&s1);
+            CPPUNIT_ASSERT(sync1->getFormattedTargetSource() == NULL);
+            StringBuffer* expected1 = Formatter::getSync(sync1);
+            Target target2("event");
+            Source s2("calendar");
+            sync2->setTarget(&target2);
+            sync2->setSource(&s2);
+            StringBuffer* expected2 = Formatter::getSync(sync2);
+
+            CPPUNIT_ASSERT_EQUAL(std::string(expected1->c_str()), std::string(formatted1->c_str()));
+            CPPUNIT_ASSERT_EQUAL(std::string(expected2->c_str()), std::string(formatted2->c_str()));
+            CPPUNIT_ASSERT(*formatted1 != *formatted2);
+
+            deleteAllStringBuffer(4, &formatted1, &formatted2, &expected1, &expected2);
+            delete sync1;
+            delete sync2;
+        }
+
+        delete config1;
+        delete config2;
+    }
+
+    /**
+     * The add/prepare functions copy their arguments, the adopt ones
+     * take their ownership.
+     */
+    void testCopyAndAdopt() {
+        SyncMLBuilder builder("http://server/sync", "device-id");
+
+        // The statuses of the same command are collapsed
+        ArrayList statusList;
+        Status* status1 = builder.prepareItemStatus(ADD_COMMAND_NAME, "key1", "3", 201);
+        Status* status2 = builder.prepareItemStatus(ADD_COMMAND_NAME, "key2", "3", 201);
+        builder.addItemStatus(&statusList, status1);
+        builder.addItemStatus(&statusList, status2);
+        CPPUNIT_ASSERT_EQUAL(1, statusList.size());
+        CPPUNIT_ASSERT_EQUAL(2, ((Status*)statusList.get(0))->getItems()->size());
+        CPPUNIT_ASSERT_EQUAL(1, status2->getItems()->size());
+        delete status1;
+        delete status2;
+
+        builder.adoptItemStatus(&statusList, builder.prepareItemStatus(ADD_COMMAND_NAME, "key3", "3", 201));
+        builder.adoptItemStatus(&statusList, builder.prepareItemStatus(REPLACE_COMMAND_NAME, "key4", "4", 200));
+        CPPUNIT_ASSERT_EQUAL(2, statusList.size());
+        CPPUNIT_ASSERT_EQUAL(3, ((Status*)statusList.get(0))->getItems()->size());
+
+        SyncML* syncml = builder.prepareSyncML(&statusList, false);
+        CPPUNIT_ASSERT_EQUAL(2, statusList.size());
+        CPPUNIT_ASSERT_EQUAL(2, syncml->getSyncBody()->getCommands()->size());
+        delete syncml;
+        syncml = builder.prepareSyncMLAdopt(&statusList, true);
+        CPPUNIT_ASSERT_EQUAL(0, statusList.size());
+        CPPUNIT_ASSERT_EQUAL(2, syncml->getSyncBody()->getCommands()->size());
+        delete syncml;
+
+        ArrayList alerts;
+        ArrayList commands;
+        commands.adopt(builder.prepareSyncHdrStatus(NULL, 200));
+        syncml = builder.prepareInitObject(NULL, &alerts, &commands);
+        CPPUNIT_ASSERT_EQUAL(1, commands.size());
+        CPPUNIT_ASSERT_EQUAL(1, syncml->getSyncBody()->getCommands()->size());
+        delete syncml;
+        syncml = builder.prepareInitObjectAdopt(NULL, &alerts, &commands);
+        CPPUNIT_ASSERT_EQUAL(0, commands.size());
+        CPPUNIT_ASSERT_EQUAL(1, syncml->getSyncBody()->getCommands()->size());
+        delete syncml;
+
+        SyncSourceConfig* config = new SyncSourceConfig();
+        config->setURI("card");
+        BuilderTestSyncSource source(TEXT("contact"), config);
+        Map* map = builder.prepareMapCommand(source);
+        SyncMap syncMap("guid", "luid");
+        MapItem* mapItem = builder.prepareMapItem(&syncMap);
+        builder.addMapItem(map, mapItem);
+        delete mapItem;
+        builder.adoptMapItem(map, builder.prepareMapItem(&syncMap));
+        CPPUNIT_ASSERT_EQUAL(2, map->getMapItems()->size());
+        delete map;
+        delete config;
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SyncMLBuilderTest );
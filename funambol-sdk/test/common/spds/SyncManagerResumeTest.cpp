@@ -0,0 +1,406 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include "base/fscapi.h"
+#include "base/Log.h"
+#include "base/adapter/PlatformAdapter.h"
+#include "base/util/utils.h"
+#include "base/util/StringMap.h"
+#include "client/DMTClientConfig.h"
+#include "client/SyncClient.h"
+#include "http/TransportAgent.h"
+#include "spds/SyncCheckpoint.h"
+#include "spds/SyncStatus.h"
+#include "spds/spdsutils.h"
+#include "syncml/core/Alert.h"
+#include "syncml/core/Item.h"
+#include "syncml/core/ModificationCommand.h"
+#include "syncml/core/Sync.h"
+#include "syncml/core/TagNames.h"
+#include "syncml/parser/Parser.h"
+
+USE_NAMESPACE
+
+#define RESUME_TEST_FOLDER  "resume-test-config"
+#define RESUME_TEST_SOURCE  "contact"
+#define RESUME_TEST_ITEMS   5
+
+static const char* vcard = "BEGIN:VCARD\r\nVERSION:2.1\r\nN:Resume;Test\r\nEND:VCARD\r\n";
+
+/**
+ * A source with only new items, whose keys are "item-<n>".
+ */
+class NewItemsSyncSource : public SyncSource {
+
+public:
+
+    NewItemsSyncSource(SyncSourceConfig* sc, int n)
+        : SyncSource(TEXT(RESUME_TEST_SOURCE), sc), count(n), next(0) {}
+
+    SyncItem* getFirstNewItem() {
+        next = 0;
+        return getNextNewItem();
+    }
+
+    SyncItem* getNextNewItem() {
+        if (next >= count) {
+            return NULL;
+        }
+        StringBuffer key;
+        key.sprintf("item-%d", next++);
+        WCHAR* wkey = toWideChar(key.c_str());
+        SyncItem* item = new SyncItem(wkey);
+        delete [] wkey;
+        item->setData(vcard, (long)strlen(vcard));
+        return item;
+    }
+
+    int addItem(SyncItem& /* item */)    { return STC_ITEM_ADDED; }
+    int updateItem(SyncItem& /* item */) { return STC_OK; }
+    int deleteItem(SyncItem& /* item */) { return STC_OK; }
+    void updateItemInfo(SyncItem& /* item */, int /* index */) {}
+    int  updateItemStatus(SyncItem& /* item */) { return STC_OK; }
+    void saveAddressBook() {}
+
+    int removeAllItems() { return 0; }
+    SyncItem* getFirstItem() { return getFirstNewItem(); }
+    SyncItem* getNextItem() { return getNextNewItem(); }
+    SyncItem* getFirstUpdatedItem() { return NULL; }
+    SyncItem* getNextUpdatedItem() { return NULL; }
+    SyncItem* getFirstDeletedItem() { return NULL; }
+    SyncItem* getNextDeletedItem() { return NULL; }
+    ArrayElement* clone() { return NULL; }
+
+private:
+
+    int count;
+    int next;
+};
+
+/**
+ * What the client has sent to the server.
+ */
+struct ClientLog {
+
+    /// The codes of the alerts, in order
+    std::vector<int> alerts;
+
+    /// The keys of the items, in order
+    std::vector<std::string> sentKeys;
+};
+
+/**
+ * Answers the messages of a two-way sync of one source, as a server that
+ * doesn't support the resume alert (225): it gets a 406 status and no
+ * Alert back. The server has no changes of its own. A sync deletes its
+ * transport agent, so what the client sends is kept in a ClientLog.
+ */
+class NoResumeTransportAgent : public TransportAgent {
+
+public:
+
+    NoResumeTransportAgent(ClientLog& l) : log(l), step(STEP_INIT), msgID(0), cmdID(0) {}
+
+    char* sendMessage(const char* msg) {
+        return sendMessage(msg, msg ? (unsigned int)strlen(msg) : 0);
+    }
+
+    char* sendMessage(const char* data, const unsigned int size) {
+        StringBuffer msg;
+        msg.append(data, size);
+        SyncML* request = Parser::getSyncML(msg.c_str());
+        if (request == NULL || request->getSyncHdr() == NULL || request->getSyncBody() == NULL) {
+            deleteSyncML(&request);
+            return NULL;
+        }
+        StringBuffer response;
+        respond(*request, response);
+        deleteSyncML(&request);
+        return stringdup(response.c_str());
+    }
+
+private:
+
+    typedef enum {
+        STEP_INIT,              // waiting for a sync alert
+        STEP_CLIENT_MODS,       // receiving the client modifications
+        STEP_SERVER_MODS,       // sending the (empty) server modifications
+        STEP_MAPPING            // waiting for the map message
+    } Step;
+
+    ClientLog& log;
+    Step step;
+    int  msgID;
+    int  cmdID;
+
+    void respond(SyncML& request, StringBuffer& response) {
+        SyncHdr* hdr = request.getSyncHdr();
+        const char* msgRef    = hdr->getMsgID();
+        const char* sessionID = hdr->getSessionID() ? hdr->getSessionID()->getSessionID() : "";
+        const char* deviceID  = hdr->getSource() ? hdr->getSource()->getLocURI() : "";
+
+        cmdID = 0;
+        StringBuffer body;
+        addStatus(body, msgRef, "0", SYNC_HDR, deviceID, msgID == 0 ? 212 : STC_OK);
+
+        bool syncAlerted = false;
+        ArrayList* commands = request.getSyncBody()->getCommands();
+        for (int i = 0; i < commands->size(); i++) {
+            AbstractCommand* command = (AbstractCommand*)commands->get(i);
+            const char* name   = command->getName();
+            const char* cmdRef = command->getCmdID() ? command->getCmdID()->getCmdID() : "";
+            if (strcmp(name, STATUS) == 0) {
+                continue;
+            }
+            if (strcmp(name, ALERT) == 0) {
+                int code = ((Alert*)command)->getData();
+                log.alerts.push_back(code);
+                if (code == SYNC_ALERT_RESUME) {
+                    addStatus(body, msgRef, cmdRef, ALERT, RESUME_TEST_SOURCE, STC_OPTIONAL_FEATURE_NOT_SUPPORTED);
+                } else {
+                    addStatus(body, msgRef, cmdRef, ALERT, RESUME_TEST_SOURCE, STC_OK);
+                    syncAlerted = syncAlerted || (code >= SYNC_TWO_WAY && code <= SYNC_REFRESH_FROM_SERVER);
+                }
+            } else if (strcmp(name, SYNC) == 0) {
+                addStatus(body, msgRef, cmdRef, SYNC, RESUME_TEST_SOURCE, STC_OK);
+                ArrayList* changes = ((Sync*)command)->getCommands();
+                for (int j = 0; changes && j < changes->size(); j++) {
+                    ModificationCommand* change = (ModificationCommand*)changes->get(j);
+                    const char* changeRef = change->getCmdID() ? change->getCmdID()->getCmdID() : "";
+                    ArrayList* items = change->getItems();
+                    for (int k = 0; items && k < items->size(); k++) {
+                        Item* item = (Item*)items->get(k);
+                        const char* key = item->getSource() ? item->getSource()->getLocURI() : "";
+                        log.sentKeys.push_back(key);
+                        addStatus(body, msgRef, changeRef, change->getName(), key,
+                                  strcmp(change->getName(), ADD) == 0 ? STC_ITEM_ADDED : STC_OK);
+                    }
+                }
+            } else {
+                addStatus(body, msgRef, cmdRef, name, NULL, STC_OK);
+            }
+        }
+
+        bool final = false;
+        switch (step) {
+            case STEP_INIT:
+                if (syncAlerted) {
+                    StringBuffer alert;
+                    alert.sprintf("<Alert>\n<CmdID>%d</CmdID>\n<Data>%d</Data>\n<Item>\n"
+                                  "<Target><LocURI>%s</LocURI></Target>\n"
+                                  "<Source><LocURI>%s</LocURI></Source>\n"
+                                  "</Item>\n</Alert>\n",
+                                  ++cmdID, SYNC_TWO_WAY, RESUME_TEST_SOURCE, RESUME_TEST_SOURCE);
+                    body.append(alert);
+                    step = STEP_CLIENT_MODS;
+                }
+                final = true;
+                break;
+            case STEP_CLIENT_MODS:
+                if (request.getSyncBody()->getFinalMsg()) {
+                    step = STEP_SERVER_MODS;
+                }
+                break;
+            case STEP_SERVER_MODS: {
+                StringBuffer sync;
+                sync.sprintf("<Sync>\n<CmdID>%d</CmdID>\n"
+                             "<Target><LocURI>%s</LocURI></Target>\n"
+                             "<Source><LocURI>%s</LocURI></Source>\n"
+                             "<NumberOfChanges>0</NumberOfChanges>\n</Sync>\n",
+                             ++cmdID, RESUME_TEST_SOURCE, RESUME_TEST_SOURCE);
+                body.append(sync);
+                final = true;
+                step = STEP_MAPPING;
+                break;
+            }
+            case STEP_MAPPING:
+                final = true;
+                break;
+        }
+        if (final) {
+            body.append("<Final/>\n");
+        }
+
+        response.sprintf("<SyncML>\n<SyncHdr>\n"
+                         "<VerDTD>1.2</VerDTD>\n<VerProto>SyncML/1.2</VerProto>\n"
+                         "<SessionID>%s</SessionID>\n<MsgID>%d</MsgID>\n"
+                         "<Target><LocURI>%s</LocURI></Target>\n"
+                         "<Source><LocURI>resume-test-server</LocURI></Source>\n"
+                         "</SyncHdr>\n<SyncBody>\n",
+                         sessionID, ++msgID, deviceID);
+        response.append(body);
+        response.append("</SyncBody>\n</SyncML>\n");
+    }
+
+    void addStatus(StringBuffer& body, const char* msgRef, const char* cmdRef,
+                   const char* cmd, const char* sourceRef, int code) {
+        StringBuffer status;
+        status.sprintf("<Status>\n<CmdID>%d</CmdID>\n<MsgRef>%s</MsgRef>\n"
+                       "<CmdRef>%s</CmdRef>\n<Cmd>%s</Cmd>\n",
+                       ++cmdID, msgRef, cmdRef, cmd);
+        if (sourceRef) {
+            status.append("<SourceRef>");
+            status.append(sourceRef);
+            status.append("</SourceRef>\n");
+        }
+        StringBuffer data;
+        data.sprintf("<Data>%d</Data>\n</Status>\n", code);
+        status.append(data);
+        body.append(status);
+    }
+};
+
+/**
+ * The sync of a source interrupted after some of its items were
+ * acknowledged, with a server that doesn't support the resume alert.
+ */
+class SyncManagerResumeTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(SyncManagerResumeTest);
+    CPPUNIT_TEST(testResumeRefused);
+    CPPUNIT_TEST(testResumeKnownRefused);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {
+        StringMap env;
+        env.put("HOME_FOLDER",   RESUME_TEST_FOLDER);
+        env.put("CONFIG_FOLDER", RESUME_TEST_FOLDER);
+        PlatformAdapter::init("Funambol/resume-test", env, true);
+        createFolder(RESUME_TEST_FOLDER);
+        removeFileInDir(RESUME_TEST_FOLDER);
+    }
+
+    void tearDown() {
+        removeFileInDir(RESUME_TEST_FOLDER);
+    }
+
+private:
+
+    /// Saves the checkpoint of a two-way sync interrupted after item-0 and item-1.
+    void interruptedSync(bool resumeRefused) {
+        SyncCheckpoint checkpoint(RESUME_TEST_SOURCE);
+        CPPUNIT_ASSERT_EQUAL(0, checkpoint.start(SYNC_TWO_WAY, SYNC_TWO_WAY, 1000));
+        if (resumeRefused) {
+            checkpoint.setResumeRefused();
+        }
+        checkpoint.addAcknowledged("item-0");
+        checkpoint.addAcknowledged("item-1");
+        CPPUNIT_ASSERT_EQUAL(0, checkpoint.commit());
+    }
+
+    /// Syncs the source with a server that doesn't support the resume alert.
+    int sync(ClientLog& log) {
+        DMTClientConfig config;
+        config.setClientDefaults();
+        config.setSourceDefaults(RESUME_TEST_SOURCE);
+        config.getAccessConfig().setCheckpoints(true);
+        config.getAccessConfig().setWBXML(false);
+        config.getDeviceConfig().setDevID("resume-test");
+        // the test server has no device info to exchange
+        config.setSendDevInfo(false);
+        config.setForceServerDevInfo(false);
+        config.setServerSwv("resume-test");
+        config.setServerLastSyncURL(config.getSyncURL());
+
+        SyncSourceConfig* sc = config.getSyncSourceConfig(RESUME_TEST_SOURCE);
+        sc->setSync(syncModeKeyword(SYNC_TWO_WAY));
+        sc->setLast(1);
+
+        NewItemsSyncSource source(sc, RESUME_TEST_ITEMS);
+        SyncSource* sources[] = { &source, NULL };
+
+        SyncClient client;
+        client.setTransportAgent(new NoResumeTransportAgent(log));
+        int ret = client.sync(config, sources);
+
+        // the source has not failed
+        CPPUNIT_ASSERT(source.getReport()->checkState());
+        return ret;
+    }
+
+    /**
+     * The server doesn't answer the resume alert: the sync alert is sent
+     * in the same session and the items acknowledged before the
+     * interruption are not sent again.
+     */
+    void testResumeRefused() {
+        interruptedSync(false);
+
+        ClientLog log;
+        CPPUNIT_ASSERT_EQUAL(0, sync(log));
+        CPPUNIT_ASSERT(log.alerts.size() >= 2);
+        CPPUNIT_ASSERT_EQUAL((int)SYNC_ALERT_RESUME, log.alerts[0]);
+        CPPUNIT_ASSERT_EQUAL((int)SYNC_TWO_WAY, log.alerts[1]);
+        checkSentKeys(log.sentKeys);
+
+        // the sync has completed, the resume alert won't be sent again
+        SyncCheckpoint checkpoint(RESUME_TEST_SOURCE);
+        CPPUNIT_ASSERT(checkpoint.isResumeRefused());
+        CPPUNIT_ASSERT_EQUAL(SYNC_NONE, checkpoint.getSyncMode());
+    }
+
+    /**
+     * The server is known not to support the resume alert: the sync alert
+     * is sent directly, still skipping the items acknowledged.
+     */
+    void testResumeKnownRefused() {
+        interruptedSync(true);
+
+        ClientLog log;
+        CPPUNIT_ASSERT_EQUAL(0, sync(log));
+        CPPUNIT_ASSERT(log.alerts.size() >= 1);
+        CPPUNIT_ASSERT_EQUAL((int)SYNC_TWO_WAY, log.alerts[0]);
+        checkSentKeys(log.sentKeys);
+    }
+
+    void checkSentKeys(const std::vector<std::string>& sentKeys) {
+        CPPUNIT_ASSERT_EQUAL((size_t)(RESUME_TEST_ITEMS - 2), sentKeys.size());
+        for (size_t i = 0; i < sentKeys.size(); i++) {
+            CPPUNIT_ASSERT(sentKeys[i] != "item-0");
+            CPPUNIT_ASSERT(sentKeys[i] != "item-1");
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SyncManagerResumeTest );
@@ -0,0 +1,269 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "base/fscapi.h"
+#include "base/util/ArrayList.h"
+#include "base/util/StringBuffer.h"
+#include "spds/SyncSource.h"
+#include "spds/SyncItem.h"
+#include "spds/SyncReport.h"
+#include "spds/SyncSourceReport.h"
+#include "push/TaskExecutor.h"
+
+USE_NAMESPACE
+
+/**
+ * A source that only records the order in which the items are applied.
+ * It can be thread safe or not.
+ */
+class RecordingSyncSource : public SyncSource {
+
+public:
+
+    RecordingSyncSource(bool ts) : SyncSource(TEXT("recording"), NULL), threadSafe(ts) {
+        pthread_mutex_init(&mutex, NULL);
+    }
+    ~RecordingSyncSource() { pthread_mutex_destroy(&mutex); }
+
+    /// The applied items, "<state><key>" in the order they were applied
+    std::vector<std::string> applied;
+
+    /// The new items, in the order of updateItemInfo()
+    std::vector<int> infoIndexes;
+
+    /// The item statuses, "<command> <status> <key>" in the order they were set
+    std::vector<std::string> statuses;
+
+    bool isThreadSafe() { return threadSafe; }
+
+    int addItem(SyncItem& item)    { return record('N', item); }
+    int updateItem(SyncItem& item) { return record('U', item); }
+    int deleteItem(SyncItem& item) { return record('D', item); }
+
+    void updateItemInfo(SyncItem& item, int index) { infoIndexes.push_back(index); }
+
+    void setItemStatus(const WCHAR* key, int status, const char* command) {
+        StringBuffer entry;
+        entry.sprintf("%s %d %s", command, status, WCharAsChar(key).c_str());
+        statuses.push_back(entry.c_str());
+    }
+    int  updateItemStatus(SyncItem& item) { return 201; }
+    void saveAddressBook() {}
+
+    int removeAllItems() { return 0; }
+    SyncItem* getFirstItem() { return NULL; }
+    SyncItem* getNextItem() { return NULL; }
+    SyncItem* getFirstNewItem() { return NULL; }
+    SyncItem* getNextNewItem() { return NULL; }
+    SyncItem* getFirstUpdatedItem() { return NULL; }
+    SyncItem* getNextUpdatedItem() { return NULL; }
+    SyncItem* getFirstDeletedItem() { return NULL; }
+    SyncItem* getNextDeletedItem() { return NULL; }
+    ArrayElement* clone() { return NULL; }
+
+    /// Position of the item in 'applied', -1 if not applied
+    int position(const char* entry) {
+        for (size_t i = 0; i < applied.size(); i++) {
+            if (applied[i] == entry) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+private:
+
+    bool threadSafe;
+    pthread_mutex_t mutex;
+
+    int record(char state, SyncItem& item) {
+        StringBuffer key;
+        key.convert(item.getKey());
+        pthread_mutex_lock(&mutex);
+        applied.push_back(std::string(1, state) + key.c_str());
+        pthread_mutex_unlock(&mutex);
+        return 200;
+    }
+};
+
+class SyncSourceTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(SyncSourceTest);
+    CPPUNIT_TEST(testApplyItems);
+    CPPUNIT_TEST(testApplyItemsInParallel);
+    CPPUNIT_TEST(testSetItemStatuses);
+    CPPUNIT_TEST(testReportItemKeys);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void setUp() {}
+    void tearDown() {}
+
+private:
+
+    static void addItem(ArrayList& items, const WCHAR* key, SyncState state,
+                        const WCHAR* parent = NULL) {
+        SyncItem item(key);
+        item.setState(state);
+        if (parent) {
+            item.setSourceParent(parent);
+        }
+        items.add(item);
+    }
+
+    /**
+     * Fills the package: independent items, two commands on the same key
+     * and a folder with a child.
+     */
+    static void fillItems(ArrayList& items) {
+        addItem(items, TEXT("a"), SYNC_STATE_NEW);
+        addItem(items, TEXT("b"), SYNC_STATE_UPDATED);
+        addItem(items, TEXT("c"), SYNC_STATE_DELETED);
+        addItem(items, TEXT("b"), SYNC_STATE_DELETED);
+        addItem(items, TEXT("folder"), SYNC_STATE_NEW);
+        for (int i = 0; i < 50; i++) {
+            StringBuffer key;
+            key.sprintf("item%d", i);
+            WCHAR* wkey = toWideChar(key.c_str());
+            addItem(items, wkey, SYNC_STATE_NEW);
+            delete [] wkey;
+        }
+        addItem(items, TEXT("child"), SYNC_STATE_NEW, TEXT("folder"));
+    }
+
+    /**
+     * A source not thread safe gets the items in the order of the commands.
+     */
+    void testApplyItems() {
+        ArrayList items;
+        fillItems(items);
+        RecordingSyncSource source(false);
+        source.applyItems(items);
+
+        CPPUNIT_ASSERT_EQUAL(items.size(), (int)source.applied.size());
+        for (int i = 0; i < items.size(); i++) {
+            StringBuffer key;
+            key.convert(((SyncItem*)items[i])->getKey());
+            CPPUNIT_ASSERT(source.applied[i].substr(1) == key.c_str());
+        }
+    }
+
+    /**
+     * A thread safe source gets all the items once, the dependent ones
+     * in order, and the new items info in the order of the commands.
+     */
+    void testApplyItemsInParallel() {
+        ArrayList items;
+        fillItems(items);
+        RecordingSyncSource source(true);
+        source.applyItems(items);
+
+        CPPUNIT_ASSERT_EQUAL(items.size(), (int)source.applied.size());
+        CPPUNIT_ASSERT(source.position("Na") >= 0);
+        CPPUNIT_ASSERT(source.position("Dc") >= 0);
+        CPPUNIT_ASSERT(source.position("Ub") < source.position("Db"));
+        CPPUNIT_ASSERT(source.position("Nfolder") < source.position("Nchild"));
+        for (int i = 0; i < 50; i++) {
+            StringBuffer entry;
+            entry.sprintf("Nitem%d", i);
+            CPPUNIT_ASSERT(source.position(entry.c_str()) >= 0);
+        }
+
+        // the new items are completed in order, after being applied
+        CPPUNIT_ASSERT_EQUAL(53, (int)source.infoIndexes.size());
+        for (int i = 0; i < 53; i++) {
+            CPPUNIT_ASSERT_EQUAL(i, source.infoIndexes[i]);
+        }
+        for (int i = 0; i < items.size(); i++) {
+            SyncItem* item = (SyncItem*)items[i];
+            if (item->getState() == SYNC_STATE_NEW) {
+                CPPUNIT_ASSERT_EQUAL(201, item->getSyncStatus());
+            }
+        }
+    }
+
+    /**
+     * The statuses with the UTF-8 keys reach the source one by one, in
+     * the order they were received.
+     */
+    void testSetItemStatuses() {
+        std::vector<SyncSource::ItemStatus> statuses;
+        const char* keys[] = { "key1", "key2", "key3" };
+        for (int i = 0; i < 3; i++) {
+            SyncSource::ItemStatus status;
+            status.key     = keys[i];
+            status.status  = 200 + i;
+            status.command = COMMAND_ADD;
+            statuses.push_back(status);
+        }
+        RecordingSyncSource source(false);
+        source.setItemStatuses(statuses);
+
+        CPPUNIT_ASSERT_EQUAL(3, (int)source.statuses.size());
+        CPPUNIT_ASSERT(source.statuses[0] == "Add 200 key1");
+        CPPUNIT_ASSERT(source.statuses[2] == "Add 202 key3");
+    }
+
+    /**
+     * The items reported with a UTF-8 ID are found with the WCHAR one,
+     * and the other way around.
+     */
+    void testReportItemKeys() {
+        SyncSourceReport report("recording");
+        report.addItem(SERVER, COMMAND_ADD, "key1", 200, NULL);
+        report.addItem(CLIENT, COMMAND_ADD, TEXT("key2"), 201, TEXT("ok"));
+        report.addItem(SERVER, COMMAND_ADD, "key1", 418, NULL);
+
+        ItemReport* item = report.find(SERVER, COMMAND_ADD, TEXT("key1"));
+        CPPUNIT_ASSERT(item != NULL);
+        CPPUNIT_ASSERT_EQUAL(418, item->getStatus());
+        CPPUNIT_ASSERT(wcscmp(item->getId(), TEXT("key1")) == 0);
+
+        item = report.find(CLIENT, COMMAND_ADD, "key2");
+        CPPUNIT_ASSERT(item != NULL);
+        CPPUNIT_ASSERT(wcscmp(item->getStatusMessage(), TEXT("ok")) == 0);
+        CPPUNIT_ASSERT(report.find(CLIENT, COMMAND_ADD, "key1") == NULL);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SyncSourceTest );
@@ -0,0 +1,120 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc.
+ * Copyright (C) 2003 - 2007 Funambol, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ *
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd.,
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ *
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ *
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include "base/fscapi.h"
+#include "base/util/StringBuffer.h"
+#include "base/globalsdef.h"
+#include "spds/SyncStats.h"
+
+USE_NAMESPACE
+
+
+class SyncStatsTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(SyncStatsTest);
+        CPPUNIT_TEST(testCounters);
+        CPPUNIT_TEST(testTimer);
+        CPPUNIT_TEST(testJSON);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp(){
+    }
+
+    void tearDown(){
+    }
+
+private:
+
+    void testCounters(){
+        SyncStats stats;
+        stats.add(PHASE_PARSE, 100, 2000);
+        stats.add(PHASE_PARSE, 50, 1000);
+        stats.add(PHASE_ITEM_READ, 10, 300, "contact");
+        stats.add(PHASE_ITEM_READ, 20, 400, "calendar");
+
+        PhaseCounter c = stats.getCounter(PHASE_PARSE);
+        CPPUNIT_ASSERT_EQUAL((int64_t)150, c.time);
+        CPPUNIT_ASSERT_EQUAL((int64_t)3000, c.bytes);
+        CPPUNIT_ASSERT_EQUAL((int32_t)2, c.calls);
+
+        c = stats.getCounter(PHASE_ITEM_READ);
+        CPPUNIT_ASSERT_EQUAL((int64_t)30, c.time);
+        c = stats.getCounter(PHASE_ITEM_READ, "contact");
+        CPPUNIT_ASSERT_EQUAL((int64_t)300, c.bytes);
+        c = stats.getCounter(PHASE_ITEM_READ, "unknown");
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, c.calls);
+
+        stats.reset();
+        c = stats.getCounter(PHASE_PARSE);
+        CPPUNIT_ASSERT_EQUAL((int32_t)0, c.calls);
+        CPPUNIT_ASSERT_EQUAL(0, stats.getMessageCount());
+    }
+
+    void testTimer(){
+        SyncStats stats;
+        {
+            SyncStats::Timer timer(stats, PHASE_FORMAT, "contact");
+            timer.setBytes(42);
+        }
+        PhaseCounter c = stats.getCounter(PHASE_FORMAT, "contact");
+        CPPUNIT_ASSERT_EQUAL((int32_t)1, c.calls);
+        CPPUNIT_ASSERT_EQUAL((int64_t)42, c.bytes);
+        CPPUNIT_ASSERT(c.time >= 0);
+    }
+
+    void testJSON(){
+        SyncStats stats;
+        stats.beginMessage();
+        stats.add(PHASE_FORMAT, 10, 100);
+        stats.beginMessage();
+        stats.add(PHASE_PARSE, 20, 200, "contact");
+
+        StringBuffer json;
+        stats.toJSON(json);
+        CPPUNIT_ASSERT_EQUAL(2, stats.getMessageCount());
+        CPPUNIT_ASSERT(json.find("\"messages\":2") != StringBuffer::npos);
+        CPPUNIT_ASSERT(json.find("\"format\"") != StringBuffer::npos);
+        CPPUNIT_ASSERT(json.find("\"contact\"") != StringBuffer::npos);
+        CPPUNIT_ASSERT(json.find("\"perMessage\"") != StringBuffer::npos);
+        // phases that never ran are omitted
+        CPPUNIT_ASSERT(json.find("\"cacheSave\"") == StringBuffer::npos);
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SyncStatsTest );
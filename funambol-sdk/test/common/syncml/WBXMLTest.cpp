@@ -0,0 +1,193 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+# include <cppunit/extensions/TestFactoryRegistry.h>
+# include <cppunit/extensions/HelperMacros.h>
+
+#include "base/util/StringBuffer.h"
+#include "base/util/utils.h"
+#include "syncml/formatter/WBXMLEncoder.h"
+#include "syncml/parser/WBXMLDecoder.h"
+#include "base/globalsdef.h"
+
+USE_NAMESPACE
+
+# define TESTDIR "testcases"
+
+/**
+ * Round trips of the SyncML messages through the WBXML encoder and decoder.
+ */
+class WBXMLTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(WBXMLTest);
+    CPPUNIT_TEST(roundTripsml1);
+    CPPUNIT_TEST(roundTripsml2);
+    CPPUNIT_TEST(roundTripsml3);
+    CPPUNIT_TEST(roundTripsml4);
+    CPPUNIT_TEST(roundTripsml5);
+    CPPUNIT_TEST(roundTripsml6);
+    CPPUNIT_TEST(roundTripsml7);
+    CPPUNIT_TEST(roundTripsml8);
+    CPPUNIT_TEST(roundTripDevInf);
+    CPPUNIT_TEST(testEscapedText);
+    CPPUNIT_TEST(testLiteralTag);
+    CPPUNIT_TEST(testInvalidMessages);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+
+    void loadTestFile(const char* fileName, StringBuffer& ret) {
+        char*       message;
+        size_t      len;
+
+        StringBuffer path;
+        path.sprintf("%s/%s", TESTDIR, fileName);
+
+        bool fileLoaded = readFile(path, &message, &len, false);
+        CPPUNIT_ASSERT_MESSAGE("Failed to load XML", fileLoaded);
+
+        ret = message;
+        delete [] message;
+    }
+
+    /**
+     * Encodes and decodes the message, checking that the encoded one
+     * is smaller.
+     */
+    void convertMessage(const StringBuffer& in, StringBuffer& out) {
+
+        unsigned int size = 0;
+        char* wbxml = WBXMLEncoder::encode(in.c_str(), &size);
+        CPPUNIT_ASSERT(wbxml);
+        CPPUNIT_ASSERT(size < in.length());
+        CPPUNIT_ASSERT(WBXMLDecoder::isWBXML(wbxml, size));
+
+        char* xml = WBXMLDecoder::decode(wbxml, size);
+        delete [] wbxml;
+        CPPUNIT_ASSERT(xml);
+        out = xml;
+        delete [] xml;
+    }
+
+    /*
+     * Compare two messages ignoring newlines and quotes: the decoder
+     * writes no whitespace between the tags.
+     */
+    bool compareMessages(const StringBuffer &msg1, const StringBuffer &msg2) {
+        StringBuffer cmp1(msg1), cmp2(msg2);
+        cmp1.replaceAll("\n", "");
+        cmp2.replaceAll("\n", "");
+        cmp1.replaceAll("\'", "\"");
+        return cmp1 == cmp2;
+    }
+
+    void roundTripTest(const char* filename) {
+        StringBuffer orig, conv;
+
+        loadTestFile(filename, orig);
+        convertMessage(orig, conv);
+
+        CPPUNIT_ASSERT( compareMessages(orig, conv) );
+    }
+
+    /* ------------------------------------------------------ TestCases */
+
+    void roundTripsml1() { roundTripTest("syncML1.xml"); }
+    void roundTripsml2() { roundTripTest("syncML2.xml"); }
+    void roundTripsml3() { roundTripTest("syncML3.xml"); }
+    void roundTripsml4() { roundTripTest("syncML4.xml"); }
+    void roundTripsml5() { roundTripTest("syncML5.xml"); }
+    void roundTripsml6() { roundTripTest("syncML6.xml"); }
+    void roundTripsml7() { roundTripTest("syncML7.xml"); }
+    void roundTripsml8() { roundTripTest("syncML8.xml"); }
+
+    /**
+     * The DevInf travels as a WBXML document of its own, inside the Data.
+     */
+    void roundTripDevInf() {
+        StringBuffer results, orig, conv;
+        loadTestFile("devInfResults.xml", results);
+
+        orig = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<SyncML><SyncHdr><VerDTD>1.2</VerDTD>"
+               "<VerProto>SyncML/1.2</VerProto><SessionID>1</SessionID><MsgID>1</MsgID>"
+               "</SyncHdr><SyncBody>";
+        orig.append(results);
+        orig.append("<Final/></SyncBody></SyncML>");
+
+        convertMessage(orig, conv);
+        CPPUNIT_ASSERT( compareMessages(orig, conv) );
+    }
+
+    void testEscapedText() {
+        StringBuffer orig, conv;
+        orig = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<SyncML><SyncHdr><VerDTD>1.1</VerDTD>"
+               "<VerProto>SyncML/1.1</VerProto></SyncHdr><SyncBody><Status><Data>"
+               "a &amp; b &lt;c&gt;</Data></Status><Final/></SyncBody></SyncML>";
+
+        convertMessage(orig, conv);
+        CPPUNIT_ASSERT( compareMessages(orig, conv) );
+    }
+
+    /**
+     * Tags not defined in the code pages are carried as literals.
+     */
+    void testLiteralTag() {
+        StringBuffer orig, conv;
+        orig = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<SyncML><SyncHdr><VerDTD>1.2</VerDTD>"
+               "<VerProto>SyncML/1.2</VerProto><X-Custom>value</X-Custom></SyncHdr>"
+               "<SyncBody><X-Custom/><Final/></SyncBody></SyncML>";
+
+        convertMessage(orig, conv);
+        CPPUNIT_ASSERT( compareMessages(orig, conv) );
+    }
+
+    void testInvalidMessages() {
+        unsigned int size = 0;
+        CPPUNIT_ASSERT(WBXMLEncoder::encode("<SyncML><SyncHdr></SyncML>", &size) == NULL);
+        CPPUNIT_ASSERT(WBXMLEncoder::encode("<SyncML><SyncHdr>", &size) == NULL);
+
+        CPPUNIT_ASSERT(!WBXMLDecoder::isWBXML("<SyncML/>", 9));
+        CPPUNIT_ASSERT(WBXMLDecoder::decode("<SyncML/>", 9) == NULL);
+
+        // truncated: SyncML 1.2 header, <SyncML> with content and no end
+        const char truncated[] = { 0x02, 0x00, 0x00, 0x6A, 0x1E,
+            '-','/','/','S','Y','N','C','M','L','/','/','D','T','D',' ',
+            'S','y','n','c','M','L',' ','1','.','2','/','/','E','N', 0x00,
+            0x6D, 0x6C };
+        CPPUNIT_ASSERT(WBXMLDecoder::decode(truncated, sizeof(truncated)) == NULL);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( WBXMLTest );
@@ -0,0 +1,355 @@
+/*
+ * Funambol is a mobile platform developed by Funambol, Inc. 
+ * Copyright (C) 2003 - 2011 Funambol, Inc.
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License version 3 as published by
+ * the Free Software Foundation with the addition of the following permission 
+ * added to Section 15 as permitted in Section 7(a): FOR ANY PART OF THE COVERED
+ * WORK IN WHICH THE COPYRIGHT IS OWNED BY FUNAMBOL, FUNAMBOL DISCLAIMS THE 
+ * WARRANTY OF NON INFRINGEMENT  OF THIRD PARTY RIGHTS.
+ * 
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License 
+ * along with this program; if not, see http://www.gnu.org/licenses or write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA.
+ * 
+ * You can contact Funambol, Inc. headquarters at 1065 East Hillsdale Blvd., 
+ * Ste.400, Foster City, CA 94404 USA, or at email address info@funambol.com.
+ * 
+ * The interactive user interfaces in modified source and object code versions
+ * of this program must display Appropriate Legal Notices, as required under
+ * Section 5 of the GNU Affero General Public License version 3.
+ * 
+ * In accordance with Section 7(b) of the GNU Affero General Public License
+ * version 3, these Appropriate Legal Notices must retain the display of the
+ * "Powered by Funambol" logo. If the display of the logo is not reasonably 
+ * feasible for technical reasons, the Appropriate Legal Notices must display
+ * the words "Powered by Funambol".
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#include "base/globalsdef.h"
+#include "base/fscapi.h"
+#include "base/posixlog.h"
+#include "base/util/utils.h"
+#include "client/RotatedLogAccessor.h"
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "cppunit/extensions/TestFactoryRegistry.h"
+#include "cppunit/extensions/HelperMacros.h"
+
+USE_NAMESPACE
+
+#define TEST_LOG_DIR        "posixlogtest"
+#define TEST_LOG_NAME       "test.log"
+#define TEST_LOG_MAX_COUNT  5
+
+/**
+ * Test suite for the flushing, the rotation and the compression of the
+ * POSIX log.
+ */
+class POSIXLogTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(POSIXLogTest);
+    CPPUNIT_TEST(testFlushOnExit);
+    CPPUNIT_TEST(testFlushOnCrash);
+    CPPUNIT_TEST(testRotateBySize);
+    CPPUNIT_TEST(testRotateWithoutSegments);
+    CPPUNIT_TEST(testRotatedLogAccessor);
+    CPPUNIT_TEST(testRotateWhileReadingSegments);
+#ifdef USE_ZLIB
+    CPPUNIT_TEST(testCompressRotated);
+    CPPUNIT_TEST(testRotateBySizeWhileCompressing);
+#endif
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() {
+        cleanup();
+        createFolder(TEST_LOG_DIR);
+    }
+
+    void tearDown() {
+        cleanup();
+    }
+
+private:
+    void cleanup() {
+        removeFileInDir(TEST_LOG_DIR);
+        rmdir(TEST_LOG_DIR);
+    }
+
+    StringBuffer segmentName(unsigned int index, const char* suffix = "") {
+        StringBuffer name;
+        if (index == 0) {
+            name.sprintf("%s/%s%s", TEST_LOG_DIR, TEST_LOG_NAME, suffix);
+        } else {
+            name.sprintf("%s/%s.%u%s", TEST_LOG_DIR, TEST_LOG_NAME, index, suffix);
+        }
+        return name;
+    }
+
+    bool segmentContains(unsigned int index, const char* text) {
+        char* content = NULL;
+        size_t len = 0;
+        bool found = readFile(segmentName(index).c_str(), &content, &len, false) &&
+                     strstr(content, text) != NULL;
+        delete [] content;
+        return found;
+    }
+
+    POSIXLog* createLog() {
+        POSIXLog* log = new POSIXLog();
+        log->setLogFile(TEST_LOG_DIR, TEST_LOG_NAME);
+        log->setLevel(LOG_LEVEL_INFO);
+        return log;
+    }
+
+    /**
+     * Logs a message in a child process that ends right away, without
+     * flushing the log.
+     * @return the wait() status of the child
+     */
+    int logAndEnd(bool crash) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            POSIXLog* log = createLog();
+            log->info("last message before the end");
+            if (crash) {
+                abort();
+            }
+            exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return status;
+    }
+
+    void testFlushOnExit() {
+        int status = logAndEnd(false);
+        CPPUNIT_ASSERT(WIFEXITED(status));
+        CPPUNIT_ASSERT(segmentContains(0, "last message before the end"));
+    }
+
+    void testFlushOnCrash() {
+        int status = logAndEnd(true);
+        CPPUNIT_ASSERT(WIFSIGNALED(status));
+        CPPUNIT_ASSERT_EQUAL(SIGABRT, WTERMSIG(status));
+        CPPUNIT_ASSERT(segmentContains(0, "last message before the end"));
+    }
+
+    void testRotateBySize() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(1000, 2, false);
+        // The size is checked after each write of the queued messages
+        for (int i = 0; i < 200; i++) {
+            log->info("message %d of the rotation test", i);
+            log->flush();
+        }
+        delete log;
+
+        CPPUNIT_ASSERT(fileExists(segmentName(0).c_str()));
+        CPPUNIT_ASSERT(fileExists(segmentName(1).c_str()));
+        CPPUNIT_ASSERT(fileExists(segmentName(2).c_str()));
+        CPPUNIT_ASSERT(!fileExists(segmentName(3).c_str()));
+
+        // The last message is in the last rotated segment if it filled
+        // the current file, the first ones have been dropped
+        CPPUNIT_ASSERT(segmentContains(0, "message 199 ") || segmentContains(1, "message 199 "));
+        CPPUNIT_ASSERT(!segmentContains(2, "message 199 "));
+        CPPUNIT_ASSERT(!segmentContains(2, "message 0 "));
+
+        char* content = NULL;
+        size_t len = 0;
+        CPPUNIT_ASSERT(readFile(segmentName(1).c_str(), &content, &len, true));
+        delete [] content;
+        CPPUNIT_ASSERT(len >= 1000);
+        CPPUNIT_ASSERT(len < 2000);
+    }
+
+    void testRotateWithoutSegments() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(0, 0, false);
+        log->info("before the rotation");
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("after the rotation");
+        log->flush();
+        delete log;
+
+        CPPUNIT_ASSERT(!fileExists(segmentName(1).c_str()));
+        CPPUNIT_ASSERT(!segmentContains(0, "before the rotation"));
+        CPPUNIT_ASSERT(segmentContains(0, "after the rotation"));
+    }
+
+    /// Reads a segment of the snapshot in small parts
+    StringBuffer readSegment(LogAccessor& accessor, int index) {
+        size_t size = 0;
+        bool compressed = false;
+        CPPUNIT_ASSERT(accessor.getSegmentInfo(index, &size, &compressed));
+
+        StringBuffer result;
+        char buffer[7];
+        size_t offset = 0;
+        long read;
+        while ((read = accessor.readSegment(index, offset, buffer, sizeof(buffer))) > 0) {
+            result.append(StringBuffer(buffer, read));
+            offset += read;
+        }
+        CPPUNIT_ASSERT_EQUAL(0L, read);
+        CPPUNIT_ASSERT_EQUAL(size, offset);
+        return result;
+    }
+
+    void testRotatedLogAccessor() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(0, TEST_LOG_MAX_COUNT, false);
+        log->info("segment A");
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment B");
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment C");
+        log->flush();
+        delete log;
+
+        RotatedLogAccessor accessor(segmentName(0), TEST_LOG_MAX_COUNT);
+        CPPUNIT_ASSERT_EQUAL(3, accessor.getSegmentCount());
+
+        const char* expected[] = { "segment A", "segment B", "segment C" };
+        for (int i = 0; i < 3; i++) {
+            size_t size = 0;
+            bool compressed = true;
+            CPPUNIT_ASSERT(accessor.getSegmentInfo(i, &size, &compressed));
+            CPPUNIT_ASSERT(!compressed);
+            CPPUNIT_ASSERT(readSegment(accessor, i).find(expected[i]) != StringBuffer::npos);
+        }
+        size_t size = 0;
+        bool compressed = false;
+        CPPUNIT_ASSERT(!accessor.getSegmentInfo(3, &size, &compressed));
+        CPPUNIT_ASSERT_EQUAL(-1L, accessor.readSegment(3, 0, NULL, 0));
+        CPPUNIT_ASSERT(accessor.getLog().find("segment C") != StringBuffer::npos);
+
+        accessor.releaseSegments();
+        CPPUNIT_ASSERT(!accessor.getSegmentInfo(0, &size, &compressed));
+    }
+
+    void testRotateWhileReadingSegments() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(0, TEST_LOG_MAX_COUNT, false);
+        log->info("segment A");
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment B");
+        log->flush();
+
+        RotatedLogAccessor accessor(segmentName(0), TEST_LOG_MAX_COUNT);
+        CPPUNIT_ASSERT_EQUAL(2, accessor.getSegmentCount());
+
+        // The files are renamed and the current one grows: the snapshot
+        // still reads the segments as they were
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment C");
+        log->flush();
+        CPPUNIT_ASSERT(readSegment(accessor, 0).find("segment A") != StringBuffer::npos);
+        StringBuffer last = readSegment(accessor, 1);
+        CPPUNIT_ASSERT(last.find("segment B") != StringBuffer::npos);
+        CPPUNIT_ASSERT(last.find("segment C") == StringBuffer::npos);
+        delete log;
+
+        CPPUNIT_ASSERT_EQUAL(3, accessor.getSegmentCount());
+        CPPUNIT_ASSERT(readSegment(accessor, 2).find("segment C") != StringBuffer::npos);
+    }
+
+#ifdef USE_ZLIB
+    StringBuffer gunzip(const StringBuffer& name) {
+        StringBuffer result;
+        gzFile in = gzopen(name.c_str(), "rb");
+        CPPUNIT_ASSERT(in != NULL);
+        char buffer[1024];
+        int len;
+        while ((len = gzread(in, buffer, sizeof(buffer))) > 0) {
+            result.append(StringBuffer(buffer, len));
+        }
+        gzclose(in);
+        return result;
+    }
+
+    void testCompressRotated() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(0, TEST_LOG_MAX_COUNT, true);
+        log->info("segment A");
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment B");
+        // Waits for the compression of the first segment
+        CPPUNIT_ASSERT(log->rotate());
+        log->info("segment C");
+        log->flush();
+        // Waits for the compression of the second segment
+        delete log;
+
+        CPPUNIT_ASSERT(!fileExists(segmentName(1).c_str()));
+        CPPUNIT_ASSERT(!fileExists(segmentName(2).c_str()));
+        CPPUNIT_ASSERT(!fileExists(segmentName(1, ".gz.tmp").c_str()));
+        CPPUNIT_ASSERT(!fileExists(segmentName(2, ".gz.tmp").c_str()));
+        CPPUNIT_ASSERT(gunzip(segmentName(2, ".gz")).find("segment A") != StringBuffer::npos);
+        CPPUNIT_ASSERT(gunzip(segmentName(1, ".gz")).find("segment B") != StringBuffer::npos);
+
+        RotatedLogAccessor accessor(segmentName(0), TEST_LOG_MAX_COUNT);
+        CPPUNIT_ASSERT_EQUAL(3, accessor.getSegmentCount());
+        for (int i = 0; i < 3; i++) {
+            size_t size = 0;
+            bool compressed = false;
+            CPPUNIT_ASSERT(accessor.getSegmentInfo(i, &size, &compressed));
+            CPPUNIT_ASSERT_EQUAL(i < 2, compressed);
+            if (compressed) {
+                // gzip magic number
+                char data[2];
+                CPPUNIT_ASSERT(size > 2);
+                CPPUNIT_ASSERT_EQUAL(2L, accessor.readSegment(i, 0, data, sizeof(data)));
+                CPPUNIT_ASSERT_EQUAL(0x1f, (int)(unsigned char)data[0]);
+                CPPUNIT_ASSERT_EQUAL(0x8b, (int)(unsigned char)data[1]);
+            }
+        }
+    }
+
+    void testRotateBySizeWhileCompressing() {
+        POSIXLog* log = createLog();
+        log->setLogRotation(500, TEST_LOG_MAX_COUNT, true);
+        for (int i = 0; i < 500; i++) {
+            log->info("message %d of the compression test", i);
+            log->flush();
+        }
+        delete log;
+
+        // Every rotated segment has been compressed, none is lost in the
+        // middle of the sequence
+        CPPUNIT_ASSERT(fileExists(segmentName(1, ".gz").c_str()));
+        bool missing = false;
+        for (unsigned int i = 1; i <= TEST_LOG_MAX_COUNT + 1; i++) {
+            CPPUNIT_ASSERT(!fileExists(segmentName(i).c_str()));
+            CPPUNIT_ASSERT(!fileExists(segmentName(i, ".gz.tmp").c_str()));
+            bool exists = fileExists(segmentName(i, ".gz").c_str());
+            CPPUNIT_ASSERT(!(exists && missing));
+            missing = !exists;
+        }
+        CPPUNIT_ASSERT(missing);
+        CPPUNIT_ASSERT(segmentContains(0, "message 499 ") ||
+                       gunzip(segmentName(1, ".gz")).find("message 499 ") != StringBuffer::npos);
+    }
+#endif
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( POSIXLogTest );